@@ -0,0 +1,284 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Helpers shared by the benchmarks: monotonic time and a uniform result line. 
+//
+// Results are printed as aligned text, or machine readable with BENCH_FORMAT=json (one 
+// object per line) or BENCH_FORMAT=csv in the environment, or bench_set_format(). The 
+// parameters of a run (bench_set_params()) are part of every record.
+
+#ifndef __BENCH_COMMON_H_
+#define __BENCH_COMMON_H_
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_FORMAT_TEXT       0U
+#define BENCH_FORMAT_JSON       1U
+#define BENCH_FORMAT_CSV        2U
+#define BENCH_FORMAT_UNSET      0xFFU
+
+static u8 bench_format = BENCH_FORMAT_UNSET;
+static u8 bench_csv_header = 0U;
+static char bench_params[256] = "";
+
+/**
+ * @name    static inline u64 bench_now_ns(void)
+ * 
+ * @brief   CLOCK_MONOTONIC in ns
+ * 
+ * @param   none.
+ * 
+ * @return  u64 : timestamp.
+ */
+static inline u64 bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+}
+
+
+/**
+ * @name    static inline u8 bench_get_format(void)
+ * 
+ * @brief   output format, BENCH_FORMAT from the environment unless set by the benchmark
+ * 
+ * @param   none.
+ * 
+ * @return  u8 : BENCH_FORMAT_xxx.
+ */
+static inline u8 bench_get_format(void)
+{
+    char const * env;
+
+    if (bench_format == BENCH_FORMAT_UNSET)
+    {
+        env = getenv("BENCH_FORMAT");
+        bench_format = BENCH_FORMAT_TEXT;
+        if (env != NULLPTR)
+        {
+            bench_format = (strcmp(env, "json") == 0) ? BENCH_FORMAT_JSON : 
+                           ((strcmp(env, "csv") == 0) ? BENCH_FORMAT_CSV : BENCH_FORMAT_TEXT);
+        }
+    }
+
+    return bench_format;
+}
+
+
+/**
+ * @name    static inline void bench_csv_begin(void)
+ * 
+ * @brief   prints the CSV header before the first record
+ * 
+ * @param   none.
+ * 
+ * @return  none.
+ */
+static inline void bench_csv_begin(void)
+{
+    if (bench_csv_header == 0U)
+    {
+        printf("kind,name,params,ops,unit,elapsed_ns,ops_per_s,ns_per_op,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n");
+        bench_csv_header = 1U;
+    }
+}
+
+
+/**
+ * @name    static inline int bench_compare_u64(void const * a, void const * b)
+ * 
+ * @brief   qsort order of u64 samples
+ * 
+ * @param   void const * : first sample 
+ *          void const * : second sample 
+ * 
+ * @return  int : <0, 0 or >0.
+ */
+static inline int bench_compare_u64(void const * a, void const * b)
+{
+    u64 const x = *(u64 const *) a;
+    u64 const y = *(u64 const *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+/**
+ * @name    static inline void bench_report(char const * const name, u64 ops, u64 elapsed_ns, char const * const unit)
+ * 
+ * @brief   prints rate and time per operation of a measurement
+ * 
+ * @param   char const * const : name of the measurement 
+ *          u64                : operations done 
+ *          u64                : time taken 
+ *          char const * const : name of an operation 
+ * 
+ * @return  none.
+ */
+static inline void bench_report(char const * const name, u64 ops, u64 elapsed_ns, char const * const unit)
+{
+    f64 const seconds = (f64) elapsed_ns / 1e9;
+    f64 const rate = (seconds > 0.0) ? ((f64) ops / seconds) : 0.0;
+    f64 const per_op = (ops > 0U) ? ((f64) elapsed_ns / (f64) ops) : 0.0;
+
+    switch (bench_get_format())
+    {
+        case BENCH_FORMAT_JSON:
+            printf("{\"name\":\"%s\",\"params\":\"%s\",\"ops\":%llu,\"unit\":\"%s\",\"elapsed_ns\":%llu,"
+                   "\"ops_per_s\":%.0f,\"ns_per_op\":%.2f}\n", name, bench_params, ops, unit, elapsed_ns, rate, per_op);
+            break;
+        case BENCH_FORMAT_CSV:
+            bench_csv_begin();
+            printf("throughput,%s,\"%s\",%llu,%s,%llu,%.0f,%.2f,,,,,\n", name, bench_params, ops, unit, elapsed_ns, rate, per_op);
+            break;
+        default:
+            printf("%-24s %12llu %-8s %10.3f ms %14.0f %s/s %9.2f ns/%s\n", name, ops, unit, (f64) elapsed_ns / 1e6, 
+                   rate, unit, per_op, unit);
+            break;
+    }
+    fflush(stdout);
+}
+
+
+/**
+ * @name    static inline void bench_report_latency(char const * const name, u64* const samples, u64 count)
+ * 
+ * @brief   prints the percentiles of latency samples, sorts the samples in place
+ * 
+ * @param   char const * const : name of the measurement 
+ *          u64* const         : samples in ns 
+ *          u64                : number of samples 
+ * 
+ * @return  none.
+ */
+static inline void bench_report_latency(char const * const name, u64* const samples, u64 count)
+{
+    u64 p50 = 0U;
+    u64 p90 = 0U;
+    u64 p99 = 0U;
+    u64 p999 = 0U;
+    u64 max = 0U;
+
+    if (count != 0U)
+    {
+        qsort(samples, count, sizeof(u64), bench_compare_u64);
+        p50  = samples[(count * 500U) / 1000U];
+        p90  = samples[(count * 900U) / 1000U];
+        p99  = samples[(count * 990U) / 1000U];
+        p999 = samples[(count * 999U) / 1000U];
+        max  = samples[count - 1U];
+    }
+
+    switch (bench_get_format())
+    {
+        case BENCH_FORMAT_JSON:
+            printf("{\"name\":\"%s\",\"params\":\"%s\",\"samples\":%llu,\"unit\":\"ns\",\"p50_ns\":%llu,"
+                   "\"p90_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu}\n", name, bench_params, count,
+                   p50, p90, p99, p999, max);
+            break;
+        case BENCH_FORMAT_CSV:
+            bench_csv_begin();
+            printf("latency,%s,\"%s\",%llu,ns,,,,%llu,%llu,%llu,%llu,%llu\n", name, bench_params, count, p50, p90, p99,
+                   p999, max);
+            break;
+        default:
+            printf("%-24s %12llu samples  p50 %9.2f us  p90 %9.2f us  p99 %9.2f us  p99.9 %9.2f us  max %9.2f us\n",
+                   name, count, (f64) p50 / 1e3, (f64) p90 / 1e3, (f64) p99 / 1e3, (f64) p999 / 1e3, (f64) max / 1e3);
+            break;
+    }
+    fflush(stdout);
+}
+
+
+/**
+ * @name    static inline __boolean bench_set_format(char const * const name)
+ * 
+ * @brief   selects the output format, overrides BENCH_FORMAT
+ * 
+ * @param   char const * const : "text", "json" or "csv"
+ * 
+ * @return  __boolean : false for an unknown name.
+ */
+static inline __boolean bench_set_format(char const * const name)
+{
+    if (strcmp(name, "text") == 0)
+    {
+        bench_format = BENCH_FORMAT_TEXT;
+    }
+    else if (strcmp(name, "json") == 0)
+    {
+        bench_format = BENCH_FORMAT_JSON;
+    }
+    else if (strcmp(name, "csv") == 0)
+    {
+        bench_format = BENCH_FORMAT_CSV;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    static inline void bench_set_params(char const * const params)
+ * 
+ * @brief   describes the parameters of the following results, e.g. "payload=8 capacity=4096"
+ * 
+ * @param   char const * const : parameters, no quotes 
+ * 
+ * @return  none.
+ */
+static inline void bench_set_params(char const * const params)
+{
+    snprintf(bench_params, sizeof(bench_params), "%s", params);
+}
+
+
+/**
+ * @name    static inline void bench_note(char const * const format, ...)
+ * 
+ * @brief   printf for lines that are no results: stdout next to text results, stderr 
+ *          otherwise so the JSON/CSV output stays parsable
+ * 
+ * @param   char const * const : printf format 
+ *          ...                : arguments 
+ * 
+ * @return  none.
+ */
+static inline void bench_note(char const * const format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    vfprintf((bench_get_format() == BENCH_FORMAT_TEXT) ? stdout : stderr, format, args);
+    va_end(args);
+}
+
+#endif /* __BENCH_COMMON_H_ */
@@ -0,0 +1,377 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "can_socket.h"
+#include "bus_stats.h"
+#include "bench_common.h"
+
+#define BENCH_BATCH             64U
+#define BENCH_PERIOD_NS         10000000ULL
+#define BENCH_INTERVAL_NS       4000000000ULL
+#define BENCH_SOCKET_BUFFER     (8U << 20U)
+
+static u64 rng_state = 0x9E3779B97F4A7C15ULL;
+
+static u64 rng_next(void)
+{
+    rng_state ^= rng_state << 13U;
+    rng_state ^= rng_state >> 7U;
+    rng_state ^= rng_state << 17U;
+    return rng_state;
+}
+
+// reference: the frame as bit string, stuff bits counted one by one
+struct bench_bits_t
+{
+    u8  bit[1024];
+    u32 count;
+};
+
+static void push_bits(struct bench_bits_t* const me, u64 value, u32 count)
+{
+    while (count-- > 0U)
+    {
+        me->bit[me->count++] = (u8) ((value >> count) & 1U);
+    }
+}
+
+static u32 count_stuff(struct bench_bits_t const * const me, u32 from, u32 to, u32* const last, u32* const run)
+{
+    u32 stuff = 0U;
+
+    for (u32 i = from; i < to; ++i)
+    {
+        if ((*run != 0U) && (me->bit[i] == *last))
+        {
+            (*run)++;
+        }
+        else
+        {
+            *last = me->bit[i];
+            *run  = 1U;
+        }
+
+        if (*run == 5U)
+        {
+            stuff++;
+            *last ^= 1U;
+            *run   = 1U;
+        }
+    }
+
+    return stuff;
+}
+
+static u32 reference_bits(can_frame_rec const * const frame, u32* const data_phase)
+{
+    struct bench_bits_t s = { .count = 0U };
+    u32 const id   = CAN_FRAME_ID(frame->can_id);
+    u32 const ext  = CAN_FRAME_IS_EXT(frame->can_id) ? 1U : 0U;
+    u32 const rtr  = CAN_FRAME_IS_RTR(frame->can_id) ? 1U : 0U;
+    u32 const fd   = ((frame->flags & CAN_FRAME_FLAG_FD) != 0U) ? 1U : 0U;
+    u32 const brs  = ((frame->flags & CAN_FRAME_FLAG_BRS) != 0U) ? 1U : 0U;
+    u32 const len  = frame->len;
+    u32 last = 1U;
+    u32 run = 0U;
+    u32 arbitration;
+    u32 nominal;
+    u32 data;
+    u32 crc;
+
+    push_bits(&s, 0U, 1U);
+    push_bits(&s, (ext != 0U) ? (id >> 18U) : id, 11U);
+    if (ext != 0U)
+    {
+        push_bits(&s, 3U, 2U);                  /* SRR IDE */
+        push_bits(&s, id & 0x3FFFFU, 18U);
+    }
+
+    if (fd == 0U)
+    {
+        push_bits(&s, rtr, 1U);
+        push_bits(&s, 0U, 2U);                  /* IDE r0, or r1 r0 */
+        push_bits(&s, can_frame_len_to_dlc((u8) len), 4U);
+        for (u32 i = 0U; (rtr == 0U) && (i < len); ++i)
+        {
+            push_bits(&s, frame->data[i], 8U);
+        }
+        *data_phase = 0U;
+        return s.count + count_stuff(&s, 0U, s.count, &last, &run) + 15U + 1U + 1U + 12U;
+    }
+
+    if (ext == 0U)
+    {
+        push_bits(&s, 0U, 2U);                  /* RRS IDE */
+    }
+    else
+    {
+        push_bits(&s, 0U, 1U);                  /* RRS */
+    }
+    push_bits(&s, 2U, 2U);                      /* FDF res */
+    push_bits(&s, brs, 1U);
+    arbitration = s.count;
+    nominal = arbitration + count_stuff(&s, 0U, arbitration, &last, &run);
+
+    push_bits(&s, ((frame->flags & CAN_FRAME_FLAG_ESI) != 0U) ? 1U : 0U, 1U);
+    push_bits(&s, can_frame_len_to_dlc((u8) len), 4U);
+    for (u32 i = 0U; i < len; ++i)
+    {
+        push_bits(&s, frame->data[i], 8U);
+    }
+    data = (s.count - arbitration) + count_stuff(&s, arbitration, s.count, &last, &run);
+    crc  = (len > 16U) ? 21U : 17U;
+    data += 4U + crc + ((crc + 4U + 3U) / 4U) + 1U;
+    nominal += 12U;
+
+    if (brs == 0U)
+    {
+        nominal += data;
+        data = 0U;
+    }
+    *data_phase = data;
+
+    return nominal + data;
+}
+
+static void make_frame(can_frame_rec* const frame, u32 id, __boolean fd)
+{
+    static u8 const fd_lens[8U] = { 12U, 16U, 20U, 24U, 32U, 48U, 64U, 8U };
+    u64 const r = rng_next();
+
+    memset(frame, 0, sizeof(*frame));
+    frame->can_id = id;
+    if (fd == true)
+    {
+        frame->flags = CAN_FRAME_FLAG_FD | (((r & 1U) != 0U) ? CAN_FRAME_FLAG_BRS : 0U) |
+                       (((r & 2U) != 0U) ? CAN_FRAME_FLAG_ESI : 0U);
+        frame->len   = fd_lens[(r >> 2U) & 7U];
+    }
+    else
+    {
+        frame->len = (u8) ((r >> 2U) % 9U);
+        if (((r >> 8U) & 0x1FU) == 0U)
+        {
+            frame->can_id |= CAN_RTR_FLAG;
+        }
+    }
+
+    // mostly runs of equal bits, they stuff the most
+    for (u32 i = 0U; i < frame->len; ++i)
+    {
+        u64 const v = rng_next();
+        frame->data[i] = ((v & 3U) == 0U) ? (u8) (v >> 8U) : (((v & 4U) != 0U) ? 0xFFU : 0x00U);
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    static bus_stats stats;
+    static bus_stats_id ids[BUS_STATS_STD_IDS + BUS_STATS_DEFAULT_EXT_SLOTS];
+    static can_socket tx_socket;
+    static can_socket rx_socket;
+    bus_stats_bus bus;
+    can_frame_rec* frames;
+    char const * ifname = NULLPTR;
+    u32 id_count = 64U;
+    u32 rounds = 16000U;
+    u32 mismatches = 0U;
+    u32 bad_periods = 0U;
+    u32 count;
+    u64 frame_count;
+    u64 slot_ns;
+    u64 start;
+    u64 elapsed;
+    u64 bits = 0U;
+    __boolean fd = false;
+    __boolean ext = false;
+    char params[128];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:n:r:Fxh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'i':
+                ifname = optarg;
+                break;
+            case 'n':
+                id_count = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'r':
+                rounds = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'F':
+                fd = true;
+                break;
+            case 'x':
+                ext = true;
+                break;
+            default:
+                printf("usage: %s [-n ids, max 1024] [-r rounds of all ids] [-F CAN FD] [-x 29 bit ids] [-i vcan]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    id_count    = GET_MIN(GET_MAX(id_count, 1U), 1024U);
+    rounds      = GET_MAX(rounds, 2U);
+    frame_count = (u64) id_count * rounds;
+    slot_ns     = BENCH_PERIOD_NS / id_count;
+    snprintf(params, sizeof(params), "ids=%u rounds=%u fd=%u ext=%u if=%s", id_count, rounds, (u32) fd, (u32) ext,
+             (ifname != NULLPTR) ? ifname : "none");
+    bench_set_params(params);
+
+    frames = (can_frame_rec*) malloc(frame_count * sizeof(can_frame_rec));
+    if ((frames == NULLPTR) ||
+        (bus_stats_init(&stats, 0U, NULLPTR, 1000000U, 5000000U, 0U, BENCH_INTERVAL_NS) == false))
+    {
+        bench_note("out of memory\n");
+        return 1;
+    }
+
+    // every id once per 10 ms in its own time slot, id i jitters by up to (i % 4) / 8 slot
+    for (u32 r = 0U; r < rounds; ++r)
+    {
+        for (u32 i = 0U; i < id_count; ++i)
+        {
+            can_frame_rec* const frame = &frames[((u64) r * id_count) + i];
+            u64 const amplitude = ((i % 4U) * slot_ns) / 8U;
+            s64 const offset = (amplitude != 0U) ? ((s64) (rng_next() % ((2U * amplitude) + 1U)) - (s64) amplitude) : 0;
+            u32 const id = (ext == true) ? ((0x18DA0000U + (i * 0x101U)) | CAN_EFF_FLAG) : (0x100U + i);
+
+            make_frame(frame, id, fd);
+            frame->timestamp_ns = 1000000000ULL + ((u64) r * BENCH_PERIOD_NS) + ((u64) i * slot_ns) + (u64) (slot_ns / 2U) + (u64) offset;
+        }
+    }
+
+    for (u64 k = 0U; k < frame_count; ++k)
+    {
+        u32 data_phase;
+        u32 ref_data_phase;
+        u32 const total = bus_stats_frame_bits(&frames[k], &data_phase);
+
+        if ((total != reference_bits(&frames[k], &ref_data_phase)) || (data_phase != ref_data_phase))
+        {
+            mismatches++;
+        }
+    }
+
+    start = bench_now_ns();
+    for (u64 k = 0U; k < frame_count; ++k)
+    {
+        bits += bus_stats_frame_bits(&frames[k], NULLPTR);
+    }
+    elapsed = bench_now_ns() - start;
+    bench_report("frame bits", frame_count, elapsed, "frame");
+
+    start = bench_now_ns();
+    for (u64 k = 0U; k < frame_count; k += BENCH_BATCH)
+    {
+        bus_stats_update_batch(&stats, &frames[k], (u32) GET_MIN(frame_count - k, (u64) BENCH_BATCH));
+    }
+    elapsed = bench_now_ns() - start;
+    bench_report("update batch", frame_count, elapsed, "frame");
+
+    count = bus_stats_read(&stats, &bus, ids, sizeof(ids) / sizeof(ids[0]));
+    if (count == 0U)
+    {
+        bench_note("no snapshot, use more rounds\n");
+        return 1;
+    }
+
+    bench_note("%u ids, last interval %.1f ms: %llu frames, %.0f frames/s, load %.1f %%, %llu snapshots\n", count,
+               (f64) (bus.end_ns - bus.start_ns) / 1e6, bus.frames, bus.frame_rate, bus.load * 100.0, stats.snapshots);
+
+    // the period has to be found again, the jitter of a uniform offset of +-a is a * sqrt(2/3)
+    for (u32 i = 0U; i < count; ++i)
+    {
+        f64 const amplitude = (f64) (((i % 4U) * slot_ns) / 8U);
+        f64 const expected = amplitude * sqrt(2.0 / 3.0);
+
+        if ((fabs(ids[i].period_mean_ns - (f64) BENCH_PERIOD_NS) > (0.01 * (f64) BENCH_PERIOD_NS)) ||
+            (fabs(ids[i].jitter_ns - expected) > ((0.15 * expected) + 100.0)))
+        {
+            bad_periods++;
+        }
+
+        if (i < 4U)
+        {
+            bench_note("  id %08X: %.1f/s period %.3f ms jitter %.2f us (expected %.2f) min %.3f max %.3f ms\n",
+                       ids[i].can_id, ids[i].rate, ids[i].period_mean_ns / 1e6, ids[i].jitter_ns / 1e3, expected / 1e3,
+                       (f64) ids[i].period_min_ns / 1e6, (f64) ids[i].period_max_ns / 1e6);
+        }
+    }
+
+    bench_note("%u bit count mismatches, %u wrong periods, %llu bits per frame on average\n", mismatches, bad_periods,
+               bits / frame_count);
+
+    // RX over a real interface, once plain and once with the statistics
+    if (ifname != NULLPTR)
+    {
+        if ((can_socket_open(&tx_socket, 0U, ifname, 0U, fd) == false) ||
+            (can_socket_open(&rx_socket, 0U, ifname, 0U, fd) == false))
+        {
+            bench_note("%s not available, skipped\n", ifname);
+        }
+        else
+        {
+            can_frame_rec batch[BENCH_BATCH];
+            u64 rx_ns[2U] = { 0U, 0U };
+            u64 received[2U] = { 0U, 0U };
+
+            can_socket_set_nonblocking(&rx_socket, true);
+            can_socket_set_buffers(&tx_socket, BENCH_SOCKET_BUFFER, BENCH_SOCKET_BUFFER);
+            can_socket_set_buffers(&rx_socket, BENCH_SOCKET_BUFFER, BENCH_SOCKET_BUFFER);
+
+            for (u32 pass = 0U; pass < 2U; ++pass)
+            {
+                for (u64 k = 0U; k < frame_count; k += BENCH_BATCH)
+                {
+                    u32 const n = (u32) GET_MIN(frame_count - k, (u64) BENCH_BATCH);
+                    u32 got = 0U;
+                    u32 spins = 0U;
+
+                    can_socket_send_batch(&tx_socket, &frames[k], n);
+                    start = bench_now_ns();
+                    while ((got < n) && (spins < 100000U))
+                    {
+                        u32 const r = can_socket_recv_batch(&rx_socket, batch, n - got);
+
+                        if ((pass == 1U) && (r != 0U))
+                        {
+                            bus_stats_update_batch(&stats, batch, r);
+                        }
+                        got += r;
+                        spins++;
+                    }
+                    rx_ns[pass]    += bench_now_ns() - start;
+                    received[pass] += got;
+                }
+            }
+
+            bench_report("socket rx", received[0], rx_ns[0], "frame");
+            bench_report("socket rx + stats", received[1], rx_ns[1], "frame");
+            if ((received[0] != 0U) && (received[1] != 0U))
+            {
+                f64 const plain = (f64) rx_ns[0] / (f64) received[0];
+                f64 const with = (f64) rx_ns[1] / (f64) received[1];
+
+                bench_note("statistics overhead %.1f %% of RX\n", ((with - plain) / plain) * 100.0);
+            }
+
+            can_socket_close(&tx_socket);
+            can_socket_close(&rx_socket);
+        }
+    }
+
+    bus_stats_destruct(&stats);
+    free(frames);
+
+    return ((mismatches != 0U) || (bad_periods != 0U)) ? 1 : 0;
+}
@@ -0,0 +1,260 @@
+#include <math.h>
+#include <stdio.h> 
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "dbc.h"
+#include "dbc_decoder.h"
+#include "bench_common.h"
+
+#define RING_SIZE       4096U
+
+static u64 rng_state = 0x9E3779B97F4A7C15ULL;
+
+static u64 rng_next(void)
+{
+    rng_state ^= rng_state << 13U;
+    rng_state ^= rng_state >> 7U;
+    rng_state ^= rng_state << 17U;
+    return rng_state;
+}
+
+// synthetic network: classic and FD messages, both byte orders, signed and scaled 
+// signals, one multiplexed message 
+static FILE* generate_dbc(u32 messages)
+{
+    static char text[4U * 1024U * 1024U];
+    u32 pos = 0U;
+
+    pos += (u32) snprintf(&text[pos], sizeof(text) - pos, "VERSION \"\"\n\nBU_: ECU\n\n");
+    for (u32 m = 0U; m < messages; ++m)
+    {
+        u32 const fd = ((m % 4U) == 3U);
+        u32 const size = fd ? 64U : 8U;
+        u32 const big_endian = ((m % 2U) == 1U);
+        u32 const mux = (m == 0U);
+        u32 id = 0x100U + m;
+        u32 bit = 0U;
+        u32 s = 0U;
+
+        if ((m % 8U) == 5U)
+        {
+            id = 0x80000000U | (0x18FF0000U + m);
+        }
+        pos += (u32) snprintf(&text[pos], sizeof(text) - pos, "BO_ %u MSG_%u: %u ECU\n", id, m, size);
+
+        while (bit < (size * 8U))
+        {
+            u32 const random_length = 1U + (u32) (rng_next() % 16U);
+            u32 const length = GET_MIN(random_length, (size * 8U) - bit);
+            // signals are laid out in stream order, the Motorola start bit is the MSB 
+            u32 const start = big_endian ? (((bit / 8U) * 8U) + (7U - (bit % 8U))) : bit;
+            char mux_text[16] = "";
+
+            if (mux && (s == 0U))
+            {
+                strcpy(mux_text, "M ");
+            }
+            else if (mux)
+            {
+                snprintf(mux_text, sizeof(mux_text), "m%u ", s % 4U);
+            }
+            pos += (u32) snprintf(&text[pos], sizeof(text) - pos, 
+                                  " SG_ SIG_%u_%u %s: %u|%u@%c%c (%g,%g) [0|0] \"\" ECU\n", m, s, mux_text, start, length, 
+                                  big_endian ? '0' : '1', ((s % 3U) == 0U) ? '-' : '+', 
+                                  ((s % 2U) == 0U) ? 0.5 : 1.0, ((s % 5U) == 0U) ? -40.0 : 0.0);
+            bit += length;
+            ++s;
+        }
+        pos += (u32) snprintf(&text[pos], sizeof(text) - pos, "\n");
+    }
+
+    return fmemopen(text, pos, "r");
+}
+
+// per frame lookup and per signal bit walking, as a straightforward decoder does it 
+static void decode_naive(dbc_database const * const db, can_frame_rec const * const frames, u32 count, dbc_store* const store)
+{
+    for (u32 i = 0U; i < count; ++i)
+    {
+        can_frame_rec const * const frame = &frames[i];
+        dbc_message const * const msg = dbc_find_message(db, frame->can_id);
+        f64 mux = -1.0;
+
+        if ((msg == NULLPTR) || (frame->len < msg->size))
+        {
+            continue;
+        }
+        for (u32 s = msg->first_signal; s < (msg->first_signal + msg->signal_count); ++s)
+        {
+            dbc_signal const * const sig = &db->signals[s];
+            f64 value = dbc_signal_decode(sig, frame->data);
+
+            if (sig->mux_type == DBC_MUX_MULTIPLEXOR)
+            {
+                dbc_signal raw = *sig;
+                raw.factor = 1.0;
+                raw.offset = 0.0;
+                mux = dbc_signal_decode(&raw, frame->data);
+            }
+            else if ((sig->mux_type == DBC_MUX_MULTIPLEXED) && (mux != (f64) sig->mux_value))
+            {
+                continue;
+            }
+            dbc_store_push(store, s, &value, &frame->timestamp_ns, 1U);
+        }
+    }
+}
+
+static void usage(char const * const name)
+{
+    fprintf(stderr, "usage: %s [-n frames] [-m messages] [-s store depth] [-d file.dbc]\n", name);
+}
+
+// usage: bench_dbc [-n frames] [-m messages] [-s store depth] [-d file.dbc]
+int main(int argc, char** argv) 
+{ 
+    static can_frame_rec storage[RING_SIZE];
+    static dbc_decoder decoder;
+    dbc_database db;
+    dbc_store naive_store;
+    dbc_store plan_store;
+    frame_ring ring;
+    can_frame_rec* frames;
+    char const * path = NULLPTR;
+    u32 count = 2000000U;
+    u32 messages = 64U;
+    u32 depth = 1024U;
+    u64 signals = 0U;
+    u64 start;
+    u64 naive_ns;
+    u64 plan_ns;
+    u32 mismatches = 0U;
+    char params[160];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:m:s:d:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                count = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'm':
+                messages = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 's':
+                depth = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'd':
+                path = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (path != NULLPTR)
+    {
+        if (dbc_load(&db, 1U, path) == false)
+        {
+            fprintf(stderr, "%s: parse error in line %u\n", path, db.error_line);
+            return 1;
+        }
+    }
+    else
+    {
+        FILE* const stream = generate_dbc(messages);
+        if ((stream == NULLPTR) || (dbc_load_stream(&db, 1U, stream) == false))
+        {
+            fprintf(stderr, "generated DBC: parse error in line %u\n", db.error_line);
+            return 1;
+        }
+        fclose(stream);
+    }
+
+    if ((dbc_decoder_init(&decoder, 2U, &db) == false) || 
+        (dbc_store_init(&naive_store, db.signal_count, depth) == false) || 
+        (dbc_store_init(&plan_store, db.signal_count, depth) == false) || 
+        (frame_ring_init(&ring, 3U, storage, RING_SIZE) == false))
+    {
+        fprintf(stderr, "init failed\n");
+        return 1;
+    }
+
+    snprintf(params, sizeof(params), "frames=%u messages=%u depth=%u dbc=%s", count, db.message_count, depth,
+             (path != NULLPTR) ? path : "generated");
+    bench_set_params(params);
+
+    frames = (can_frame_rec*) calloc(count, sizeof(can_frame_rec));
+    if (frames == NULLPTR)
+    {
+        return 1;
+    }
+    for (u32 i = 0U; i < count; ++i)
+    {
+        dbc_message const * const msg = &db.messages[rng_next() % db.message_count];
+        frames[i].timestamp_ns = (u64) i * 1000U;
+        frames[i].can_id       = msg->can_id;
+        frames[i].len          = msg->size;
+        frames[i].flags        = (msg->size > 8U) ? CAN_FRAME_FLAG_FD : 0U;
+        for (u32 b = 0U; b < CAN_FRAME_MAX_DATA; b += 8U)
+        {
+            u64 const word = rng_next();
+            memcpy(&frames[i].data[b], &word, sizeof(word));
+        }
+        signals += msg->signal_count;
+    }
+
+    bench_note("%u messages, %u signals, %u plans, %u ops, %u frames\n", 
+               db.message_count, db.signal_count, decoder.plan_count, decoder.op_count, count);
+
+    start = bench_now_ns();
+    decode_naive(&db, frames, count, &naive_store);
+    naive_ns = bench_now_ns() - start;
+
+    // the plan path takes its frames from a ring in batches, as a consumer thread would 
+    start = bench_now_ns();
+    for (u32 done = 0U; done < count; )
+    {
+        can_frame_rec* slots;
+        u32 const n = frame_ring_reserve(&ring, &slots, GET_MIN(DBC_DECODER_MAX_BATCH, count - done));
+        memcpy(slots, &frames[done], (u64) n * sizeof(can_frame_rec));
+        frame_ring_commit(&ring, n);
+        done += n;
+        (void) dbc_decoder_decode_ring(&decoder, &ring, &plan_store);
+    }
+    plan_ns = bench_now_ns() - start;
+
+    for (u32 s = 0U; s < db.signal_count; ++s)
+    {
+        f64 a = 0.0;
+        f64 b = 0.0;
+        if ((dbc_store_count(&naive_store, s) != dbc_store_count(&plan_store, s)) || 
+            (dbc_store_latest(&naive_store, s, &a, NULLPTR) != dbc_store_latest(&plan_store, s, &b, NULLPTR)) || 
+            (fabs(a - b) > (1e-9 * GET_MAX(fabs(a), 1.0))))
+        {
+            ++mismatches;
+        }
+    }
+
+    bench_report("naive per signal", count, naive_ns, "frame");
+    bench_report("compiled plans", count, plan_ns, "frame");
+    bench_report("naive per signal", signals, naive_ns, "signal");
+    bench_report("compiled plans", signals, plan_ns, "signal");
+    bench_note("speedup %.2fx, %u mismatching signals\n", (f64) naive_ns / (f64) GET_MAX(plan_ns, 1U), mismatches);
+
+    free(frames);
+    frame_ring_destruct(&ring);
+    dbc_store_destruct(&naive_store);
+    dbc_store_destruct(&plan_store);
+    dbc_decoder_destruct(&decoder);
+    dbc_destruct(&db);
+
+    return (mismatches == 0U) ? 0 : 1; 
+}
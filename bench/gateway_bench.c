@@ -0,0 +1,472 @@
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "can_socket.h"
+#include "can_id_table.h"
+#include "can_gateway.h"
+#include "bench_common.h"
+
+#define BENCH_RING_SIZE         4096U
+#define BENCH_MAX_PAIRS         (CAN_GATEWAY_MAX_BUSES / 2U)
+#define BENCH_SOCKET_BUFFER     (4U << 20U)
+#define BENCH_IDLE_NS           2000000000ULL
+
+struct bench_sink_t
+{
+    u64 frames;
+    u64 checksum;
+};
+
+struct bench_vcan_t
+{
+    char const*     ifname[2];
+    can_socket      gateway_socket[2];
+    can_socket      generator;
+    can_socket      sink;
+    u32             frames;
+    u64             received;
+    volatile u32    done;
+};
+
+static u64 rng_state = 0x2545F4914F6CDD1DULL;
+
+static u64 rng_next(void)
+{
+    rng_state ^= rng_state << 13U;
+    rng_state ^= rng_state >> 7U;
+    rng_state ^= rng_state << 17U;
+    return rng_state;
+}
+
+static u64 realtime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+}
+
+static void make_frame(can_frame_rec* const frame, u8 bus, u32 rules, u64 timestamp_ns)
+{
+    u64 const r = rng_next();
+
+    // one frame in eight has an id without a rule
+    frame->timestamp_ns = timestamp_ns;
+    frame->can_id       = ((r & 7U) == 0U) ? (0x700U + (u32) ((r >> 3U) & 0xFFU)) : (0x100U + (u32) ((r >> 3U) % (rules * 4U)));
+    frame->len          = 8U;
+    frame->flags        = 0U;
+    frame->bus          = bus;
+    memcpy(frame->data, &r, sizeof(r));
+}
+
+// rule r of a pair covers 4 ids, every 4th rewrites the id and every 8th flips byte 0
+static void make_rule(can_gateway_rule* const rule, u8 src, u8 dst, u32 r)
+{
+    memset(rule, 0, sizeof(*rule));
+    rule->src_bus = src;
+    rule->dst_bus = dst;
+    rule->can_id  = 0x100U + (r * 4U);
+    rule->mask    = 0x7FCU;
+
+    if ((r % 4U) == 0U)
+    {
+        rule->rewrite_id   = 0x500U + r;
+        rule->rewrite_mask = CAN_SFF_MASK;
+    }
+    if ((r % 8U) == 0U)
+    {
+        rule->mods[0].op    = CAN_GATEWAY_OP_XOR;
+        rule->mods[0].index = 0U;
+        rule->mods[0].value = 0xFFU;
+        rule->mod_count     = 1U;
+    }
+}
+
+static void sink_frame(struct bench_sink_t* const sink, can_frame_rec const * const frame)
+{
+    sink->frames++;
+    sink->checksum += ((u64) frame->can_id << 8U) + frame->data[0];
+}
+
+static u32 sink_output(void* ctx, can_frame_rec* const * frames, u32 count)
+{
+    struct bench_sink_t* const sink = (struct bench_sink_t*) ctx;
+
+    for (u32 i = 0U; i < count; ++i)
+    {
+        sink_frame(sink, frames[i]);
+    }
+
+    return count;
+}
+
+// reference: every frame is checked against all rules and copied for the output
+static void linear_forward(can_gateway const * const gateway, frame_ring* const ring, struct bench_sink_t* const sink)
+{
+    can_frame_rec copies[CAN_GATEWAY_BATCH];
+    can_frame_rec* slots;
+    u32 const n = frame_ring_peek(ring, &slots, CAN_GATEWAY_BATCH);
+    u32 count = 0U;
+
+    for (u32 i = 0U; i < n; ++i)
+    {
+        for (u32 r = 0U; r < gateway->route_count; ++r)
+        {
+            can_gateway_rule const * const rule = &gateway->routes[r].rule;
+
+            if ((rule->src_bus != slots[i].bus) || (((slots[i].can_id ^ rule->can_id) & rule->mask) != 0U))
+            {
+                continue;
+            }
+
+            copies[count] = slots[i];
+            if (rule->rewrite_mask != 0U)
+            {
+                copies[count].can_id = (copies[count].can_id & ~rule->rewrite_mask) | (rule->rewrite_id & rule->rewrite_mask);
+            }
+            for (u32 m = 0U; m < rule->mod_count; ++m)
+            {
+                copies[count].data[rule->mods[m].index] ^= rule->mods[m].value;
+            }
+            count++;
+        }
+    }
+
+    for (u32 i = 0U; i < count; ++i)
+    {
+        sink_frame(sink, &copies[i]);
+    }
+    frame_ring_release(ring, n);
+}
+
+static void* generator(void* arg)
+{
+    struct bench_vcan_t* const pair = (struct bench_vcan_t*) arg;
+    can_frame_rec frames[CAN_SOCKET_MAX_BATCH];
+    u32 sent = 0U;
+    u64 state = 0x9E3779B97F4A7C15ULL ^ (u64) (uintptr_t) arg;
+
+    while (sent < pair->frames)
+    {
+        u32 const n = GET_MIN(pair->frames - sent, CAN_SOCKET_MAX_BATCH);
+
+        for (u32 i = 0U; i < n; ++i)
+        {
+            state ^= state << 13U;
+            state ^= state >> 7U;
+            state ^= state << 17U;
+            frames[i].can_id = 0x100U + (u32) (state % 0x100U);
+            frames[i].len    = 8U;
+            frames[i].flags  = 0U;
+            memcpy(frames[i].data, &state, sizeof(state));
+        }
+        sent += can_socket_send_batch(&pair->generator, frames, n);
+    }
+
+    return NULLPTR;
+}
+
+static void* sink(void* arg)
+{
+    struct bench_vcan_t* const pair = (struct bench_vcan_t*) arg;
+    can_frame_rec frames[CAN_SOCKET_MAX_BATCH];
+    struct pollfd pfd = { pair->sink.fd, POLLIN, 0 };
+
+    while ((pair->received < pair->frames) && (pair->done == 0U))
+    {
+        u32 const n = can_socket_recv_batch(&pair->sink, frames, CAN_SOCKET_MAX_BATCH);
+
+        pair->received += n;
+        if (n == 0U)
+        {
+            (void) poll(&pfd, 1, 10);
+        }
+    }
+    __atomic_store_n(&pair->done, 1U, __ATOMIC_RELEASE);
+
+    return NULLPTR;
+}
+
+static int run_memory(u32 pairs, u32 rules, u64 frame_count)
+{
+    static can_gateway gateway;
+    static frame_ring rings[CAN_GATEWAY_MAX_BUSES];
+    static can_frame_rec* storage[CAN_GATEWAY_MAX_BUSES];
+    struct bench_sink_t reference = { 0U, 0U };
+    struct bench_sink_t sinks[CAN_GATEWAY_MAX_BUSES];
+    struct bench_sink_t total = { 0U, 0U };
+    can_gateway_rule rule;
+    u64 unrouted = 0U;
+    u64 generated;
+    u64 elapsed;
+    u64 start;
+
+    if (can_gateway_init(&gateway, 0U, pairs * rules) == false)
+    {
+        bench_note("out of memory\n");
+        return 1;
+    }
+
+    for (u32 b = 0U; b < (pairs * 2U); ++b)
+    {
+        storage[b] = (can_frame_rec*) aligned_alloc(64U, BENCH_RING_SIZE * sizeof(can_frame_rec));
+        if ((storage[b] == NULLPTR) || (frame_ring_init(&rings[b], 0U, storage[b], BENCH_RING_SIZE) == false) ||
+            (can_gateway_add_bus(&gateway, NULLPTR, &rings[b]) != b))
+        {
+            bench_note("out of memory\n");
+            return 1;
+        }
+        sinks[b].frames   = 0U;
+        sinks[b].checksum = 0U;
+        can_gateway_set_output(&gateway, b, sink_output, &sinks[b]);
+    }
+
+    for (u32 p = 0U; p < pairs; ++p)
+    {
+        for (u32 r = 0U; r < rules; ++r)
+        {
+            make_rule(&rule, (u8) (p * 2U), (u8) ((p * 2U) + 1U), r);
+            (void) can_gateway_add_rule(&gateway, &rule);
+        }
+    }
+
+    start = bench_now_ns();
+    if (can_gateway_compile(&gateway) == false)
+    {
+        bench_note("compile failed\n");
+        return 1;
+    }
+    bench_note("%u pairs, %u rules, compiled in %.3f ms, %u list entries\n", pairs, gateway.route_count,
+               (f64) (bench_now_ns() - start) / 1e6, gateway.list_size);
+
+    // reference and gateway see the same frames, the generator is reseeded
+    for (u32 pass = 0U; pass < 2U; ++pass)
+    {
+        rng_state = 0x2545F4914F6CDD1DULL;
+        generated = 0U;
+        elapsed   = 0U;
+
+        while (generated < frame_count)
+        {
+            for (u32 p = 0U; p < pairs; ++p)
+            {
+                u32 const b = p * 2U;
+                can_frame_rec* slots;
+                u32 const n = frame_ring_reserve(&rings[b], &slots, BENCH_RING_SIZE);
+
+                for (u32 i = 0U; i < n; ++i)
+                {
+                    make_frame(&slots[i], (u8) b, rules, realtime_ns());
+                }
+                frame_ring_commit(&rings[b], n);
+                generated += n;
+            }
+
+            start = bench_now_ns();
+            for (u32 p = 0U; p < pairs; ++p)
+            {
+                while (frame_ring_count(&rings[p * 2U]) != 0U)
+                {
+                    if (pass == 0U)
+                    {
+                        linear_forward(&gateway, &rings[p * 2U], &reference);
+                    }
+                    else
+                    {
+                        (void) can_gateway_forward(&gateway, p * 2U);
+                    }
+                }
+            }
+            elapsed += bench_now_ns() - start;
+        }
+
+        bench_report((pass == 0U) ? "linear scan + copy" : "gateway", generated, elapsed, "frame");
+    }
+
+    for (u32 b = 0U; b < (pairs * 2U); ++b)
+    {
+        total.frames   += sinks[b].frames;
+        total.checksum += sinks[b].checksum;
+        unrouted       += gateway.buses[b].unrouted;
+    }
+    bench_note("%llu frames forwarded, %llu unrouted, output %s\n", total.frames, unrouted,
+               ((total.frames == reference.frames) && (total.checksum == reference.checksum)) ? "matches" : "DIFFERS");
+
+    can_gateway_destruct(&gateway);
+    for (u32 b = 0U; b < (pairs * 2U); ++b)
+    {
+        frame_ring_destruct(&rings[b]);
+        free(storage[b]);
+    }
+
+    return ((total.frames == reference.frames) && (total.checksum == reference.checksum)) ? 0 : 1;
+}
+
+static int run_vcan(struct bench_vcan_t* const pairs, u32 pair_count, u64 frame_count)
+{
+    static can_gateway gateway;
+    pthread_t threads[BENCH_MAX_PAIRS * 2U];
+    can_gateway_route_stats stats;
+    can_gateway_rule rule;
+    u64 received = 0U;
+    u64 last_progress;
+    u64 elapsed;
+    u64 start;
+    u32 done;
+
+    (void) can_gateway_init(&gateway, 0U, pair_count);
+    for (u32 p = 0U; p < pair_count; ++p)
+    {
+        struct bench_vcan_t* const pair = &pairs[p];
+
+        if ((can_socket_open(&pair->gateway_socket[0], 0U, pair->ifname[0], (u8) (p * 2U), false) == false) ||
+            (can_socket_open(&pair->gateway_socket[1], 0U, pair->ifname[1], (u8) ((p * 2U) + 1U), false) == false) ||
+            (can_socket_open(&pair->generator, 0U, pair->ifname[0], 0U, false) == false) ||
+            (can_socket_open(&pair->sink, 0U, pair->ifname[1], 0U, false) == false))
+        {
+            bench_note("%s/%s not available, skipped\n", pair->ifname[0], pair->ifname[1]);
+            can_gateway_destruct(&gateway);
+            return 0;
+        }
+
+        can_socket_set_buffers(&pair->gateway_socket[0], BENCH_SOCKET_BUFFER, BENCH_SOCKET_BUFFER);
+        can_socket_set_buffers(&pair->gateway_socket[1], BENCH_SOCKET_BUFFER, BENCH_SOCKET_BUFFER);
+        can_socket_set_buffers(&pair->generator, BENCH_SOCKET_BUFFER, BENCH_SOCKET_BUFFER);
+        can_socket_set_buffers(&pair->sink, BENCH_SOCKET_BUFFER, BENCH_SOCKET_BUFFER);
+        can_socket_set_nonblocking(&pair->sink, true);
+        (void) can_gateway_add_bus(&gateway, &pair->gateway_socket[0], NULLPTR);
+        (void) can_gateway_add_bus(&gateway, &pair->gateway_socket[1], NULLPTR);
+
+        memset(&rule, 0, sizeof(rule));
+        rule.src_bus = (u8) (p * 2U);
+        rule.dst_bus = (u8) ((p * 2U) + 1U);
+        rule.can_id  = 0x100U;
+        rule.mask    = 0x700U;
+        (void) can_gateway_add_rule(&gateway, &rule);
+
+        pair->frames   = (u32) (frame_count / pair_count);
+        pair->received = 0U;
+        pair->done     = 0U;
+    }
+
+    for (u32 p = 0U; p < pair_count; ++p)
+    {
+        pthread_create(&threads[p * 2U], NULLPTR, sink, &pairs[p]);
+        pthread_create(&threads[(p * 2U) + 1U], NULLPTR, generator, &pairs[p]);
+    }
+
+    // the gateway runs here until every sink has all frames or nothing moved for a while
+    start = bench_now_ns();
+    last_progress = start;
+    do
+    {
+        if (can_gateway_process(&gateway, 10) != 0U)
+        {
+            last_progress = bench_now_ns();
+        }
+
+        done = 0U;
+        for (u32 p = 0U; p < pair_count; ++p)
+        {
+            done += __atomic_load_n(&pairs[p].done, __ATOMIC_ACQUIRE);
+        }
+    } while ((done < pair_count) && ((bench_now_ns() - last_progress) < BENCH_IDLE_NS));
+    elapsed = last_progress - start;
+
+    for (u32 p = 0U; p < pair_count; ++p)
+    {
+        pairs[p].done = 1U;
+    }
+    for (u32 t = 0U; t < (pair_count * 2U); ++t)
+    {
+        pthread_join(threads[t], NULLPTR);
+    }
+
+    for (u32 p = 0U; p < pair_count; ++p)
+    {
+        can_gateway_get_route_stats(&gateway, p, &stats);
+        bench_note("%s -> %s: %u sent, %llu forwarded, %llu received, %llu tx dropped, latency p50 %.1f us p99 %.1f us max %.1f us\n",
+                   pairs[p].ifname[0], pairs[p].ifname[1], pairs[p].frames, stats.forwarded, pairs[p].received, stats.tx_dropped,
+                   (f64) can_gateway_latency_percentile(&stats, 0.5) / 1e3, (f64) can_gateway_latency_percentile(&stats, 0.99) / 1e3,
+                   (f64) stats.latency_max_ns / 1e3);
+        received += pairs[p].received;
+    }
+    bench_report("vcan gateway", received, elapsed, "frame");
+
+    can_gateway_destruct(&gateway);
+    for (u32 p = 0U; p < pair_count; ++p)
+    {
+        can_socket_close(&pairs[p].gateway_socket[0]);
+        can_socket_close(&pairs[p].gateway_socket[1]);
+        can_socket_close(&pairs[p].generator);
+        can_socket_close(&pairs[p].sink);
+    }
+
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    static struct bench_vcan_t vcan[BENCH_MAX_PAIRS];
+    static char names[BENCH_MAX_PAIRS][2][CAN_SOCKET_IFNAME_SIZE];
+    u32 vcan_count = 0U;
+    u32 pairs = 4U;
+    u32 rules = 64U;
+    u64 frame_count = 4000000U;
+    char params[128];
+    int ret;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:r:n:v:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p':
+                pairs = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'r':
+                rules = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'n':
+                frame_count = strtoull(optarg, NULLPTR, 0);
+                break;
+            case 'v':
+                if ((vcan_count == BENCH_MAX_PAIRS) ||
+                    (sscanf(optarg, "%15[^:]:%15s", names[vcan_count][0], names[vcan_count][1]) != 2))
+                {
+                    bench_note("-v takes up to %u pairs like vcan0:vcan1\n", BENCH_MAX_PAIRS);
+                    return 1;
+                }
+                vcan[vcan_count].ifname[0] = names[vcan_count][0];
+                vcan[vcan_count].ifname[1] = names[vcan_count][1];
+                vcan_count++;
+                break;
+            default:
+                printf("usage: %s [-p bus pairs, max 4] [-r rules per pair, max 256] [-n frames] [-v vcan0:vcan1]...\n", argv[0]);
+                return 1;
+        }
+    }
+
+    pairs = GET_MIN(GET_MAX(pairs, 1U), BENCH_MAX_PAIRS);
+    rules = GET_MIN(GET_MAX(rules, 1U), 256U);
+    snprintf(params, sizeof(params), "pairs=%u rules=%u frames=%llu vcan_pairs=%u", pairs, rules, frame_count, vcan_count);
+    bench_set_params(params);
+
+    ret = run_memory(pairs, rules, frame_count);
+
+    if (vcan_count != 0U)
+    {
+        ret |= run_vcan(vcan, vcan_count, frame_count / 4U);
+    }
+
+    return ret;
+}
@@ -0,0 +1,308 @@
+#include <stdio.h> 
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "can_socket.h"
+#include "can_id_table.h"
+#include "timer_wheel.h"
+#include "isotp.h"
+#include "bench_common.h"
+
+#define BENCH_TESTER_ID(__I)    ((0x10000000U + (__I)) | CAN_EFF_FLAG)
+#define BENCH_ECU_ID(__I)       ((0x11000000U + (__I)) | CAN_EFF_FLAG)
+#define BENCH_LINK_FRAMES       (1U << 16U)
+#define BENCH_SOCKET_BUFFER     (8U << 20U)
+#define BENCH_TIMEOUT_NS        60000000000ULL
+
+// in process stand in for the bus, frames of one side are fed to the other 
+struct bench_link_t
+{
+    can_frame_rec*  frames[2];
+    u32             count[2];
+    u32             write;
+};
+
+struct bench_ctx_t
+{
+    isotp_engine        tester;
+    isotp_engine        ecu;
+    u8*                 tx_data;        /* one message per session */
+    u32*                tx_seq;
+    u32*                rx_seq;
+    u32                 sessions;
+    u32                 messages;
+    u32                 size;
+    u64                 received;
+    u64                 corrupt;
+    u64                 errors;
+};
+
+static u8 pattern(u32 session, u32 seq, u32 pos)
+{
+    return (u8) ((session * 31U) + (seq * 7U) + pos);
+}
+
+static void fill_message(struct bench_ctx_t* const ctx, u32 session)
+{
+    u8* const data = &ctx->tx_data[(size_t) session * ctx->size];
+
+    for (u32 k = 0U; k < ctx->size; ++k)
+    {
+        data[k] = pattern(session, ctx->tx_seq[session], k);
+    }
+}
+
+static void tester_sent(void* arg, u32 session, s32 result)
+{
+    struct bench_ctx_t* const ctx = (struct bench_ctx_t*) arg;
+
+    if (result != ISOTP_OK)
+    {
+        ctx->errors++;
+        return;
+    }
+
+    ctx->tx_seq[session]++;
+    if (ctx->tx_seq[session] < ctx->messages)
+    {
+        fill_message(ctx, session);
+        isotp_send(&ctx->tester, session, &ctx->tx_data[(size_t) session * ctx->size], ctx->size, bench_now_ns());
+    }
+}
+
+static void ecu_received(void* arg, u32 session, u8 const * data, u32 len, s32 result)
+{
+    struct bench_ctx_t* const ctx = (struct bench_ctx_t*) arg;
+    u32 const seq = ctx->rx_seq[session]++;
+
+    if (result != ISOTP_OK)
+    {
+        ctx->errors++;
+        return;
+    }
+
+    ctx->received++;
+    if (len != ctx->size)
+    {
+        ctx->corrupt++;
+        return;
+    }
+
+    for (u32 k = 0U; k < len; ++k)
+    {
+        if (data[k] != pattern(session, seq, k))
+        {
+            ctx->corrupt++;
+            return;
+        }
+    }
+}
+
+static u32 link_output(void* arg, can_frame_rec* frames, u32 count)
+{
+    struct bench_link_t* const link = (struct bench_link_t*) arg;
+    u32 const room = BENCH_LINK_FRAMES - link->count[link->write];
+    u32 const n = GET_MIN(count, room);
+
+    memcpy(&link->frames[link->write][link->count[link->write]], frames, n * sizeof(can_frame_rec));
+    link->count[link->write] += n;
+
+    return n;
+}
+
+static u32 link_deliver(struct bench_link_t* const link, isotp_engine* const engine)
+{
+    u32 const read = link->write;
+    u32 const count = link->count[read];
+
+    link->write = 1U - read;
+    isotp_receive(engine, link->frames[read], count, bench_now_ns());
+    link->count[read] = 0U;
+
+    return count;
+}
+
+// usage: bench_isotp [-i vcan0] [-n sessions] [-m messages] [-s size] [-b block size] [-t stmin] [-F]
+int main(int argc, char** argv) 
+{ 
+    static struct bench_ctx_t ctx;
+    static can_socket tester_socket;
+    static can_socket ecu_socket;
+    struct bench_link_t to_ecu = { 0 };
+    struct bench_link_t to_tester = { 0 };
+    char const * ifname = NULLPTR;
+    u8 block_size = 8U;
+    u8 st_min = 0U;
+    __boolean fd = false;
+    u64 start;
+    u64 elapsed;
+    u64 total;
+    char params[128];
+    int opt;
+
+    ctx.sessions = 256U;
+    ctx.messages = 20U;
+    ctx.size     = 4095U;
+
+    while ((opt = getopt(argc, argv, "i:n:m:s:b:t:Fh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'i':
+                ifname = optarg;
+                break;
+            case 'n':
+                ctx.sessions = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'm':
+                ctx.messages = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 's':
+                ctx.size = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'b':
+                block_size = (u8) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 't':
+                st_min = (u8) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'F':
+                fd = true;
+                break;
+            default:
+                printf("usage: %s [-i interface, in process link if not given] [-n sessions] [-m messages per session]\n"
+                       "          [-s message size] [-b block size] [-t stmin] [-F for CAN FD]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if ((ctx.sessions == 0U) || (ctx.messages == 0U) || (ctx.size == 0U))
+    {
+        bench_note("sessions, messages and size must not be 0\n");
+        return 1;
+    }
+
+    if (ifname != NULLPTR)
+    {
+        if ((can_socket_open(&tester_socket, 0U, ifname, 0U, fd) == false) || 
+            (can_socket_open(&ecu_socket, 0U, ifname, 0U, fd) == false))
+        {
+            bench_note("%s not available, skipped\n", ifname);
+            return 0;
+        }
+        can_socket_set_nonblocking(&tester_socket, true);
+        can_socket_set_nonblocking(&ecu_socket, true);
+        can_socket_set_buffers(&tester_socket, BENCH_SOCKET_BUFFER, BENCH_SOCKET_BUFFER);
+        can_socket_set_buffers(&ecu_socket, BENCH_SOCKET_BUFFER, BENCH_SOCKET_BUFFER);
+    }
+
+    ctx.tx_data = (u8*) malloc((size_t) ctx.sessions * ctx.size);
+    ctx.tx_seq  = (u32*) calloc(ctx.sessions, sizeof(u32));
+    ctx.rx_seq  = (u32*) calloc(ctx.sessions, sizeof(u32));
+    to_ecu.frames[0]    = (can_frame_rec*) malloc(BENCH_LINK_FRAMES * sizeof(can_frame_rec));
+    to_ecu.frames[1]    = (can_frame_rec*) malloc(BENCH_LINK_FRAMES * sizeof(can_frame_rec));
+    to_tester.frames[0] = (can_frame_rec*) malloc(BENCH_LINK_FRAMES * sizeof(can_frame_rec));
+    to_tester.frames[1] = (can_frame_rec*) malloc(BENCH_LINK_FRAMES * sizeof(can_frame_rec));
+
+    if ((ctx.tx_data == NULLPTR) || (ctx.tx_seq == NULLPTR) || (ctx.rx_seq == NULLPTR) || 
+        (to_ecu.frames[0] == NULLPTR) || (to_ecu.frames[1] == NULLPTR) || 
+        (to_tester.frames[0] == NULLPTR) || (to_tester.frames[1] == NULLPTR) || 
+        (isotp_init(&ctx.tester, 0U, (ifname != NULLPTR) ? &tester_socket : NULLPTR, ctx.sessions, 1U, 64U, bench_now_ns()) == false) || 
+        (isotp_init(&ctx.ecu, 0U, (ifname != NULLPTR) ? &ecu_socket : NULLPTR, ctx.sessions, ctx.sessions, ctx.size, bench_now_ns()) == false))
+    {
+        bench_note("out of memory\n");
+        return 1;
+    }
+
+    snprintf(params, sizeof(params), "if=%s sessions=%u messages=%u size=%u bs=%u stmin=%u fd=%u",
+             (ifname != NULLPTR) ? ifname : "none", ctx.sessions, ctx.messages, ctx.size, block_size, st_min, (u32) fd);
+    bench_set_params(params);
+
+    isotp_set_callbacks(&ctx.tester, NULLPTR, tester_sent, &ctx);
+    isotp_set_callbacks(&ctx.ecu, ecu_received, NULLPTR, &ctx);
+    isotp_set_output(&ctx.tester, link_output, &to_ecu);
+    isotp_set_output(&ctx.ecu, link_output, &to_tester);
+
+    for (u32 i = 0U; i < ctx.sessions; ++i)
+    {
+        isotp_config config = { 0 };
+
+        config.tx_dl      = (fd == true) ? CAN_FRAME_MAX_DATA : ISOTP_CLASSIC_DL;
+        config.block_size = block_size;
+        config.st_min     = st_min;
+        config.flags      = ISOTP_FLAG_PADDING | ISOTP_FLAG_BRS;
+
+        config.tx_id = BENCH_TESTER_ID(i);
+        config.rx_id = BENCH_ECU_ID(i);
+        if (isotp_open(&ctx.tester, &config) != i)
+        {
+            bench_note("session %u not opened\n", i);
+            return 1;
+        }
+
+        config.tx_id = BENCH_ECU_ID(i);
+        config.rx_id = BENCH_TESTER_ID(i);
+        if (isotp_open(&ctx.ecu, &config) != i)
+        {
+            bench_note("session %u not opened\n", i);
+            return 1;
+        }
+    }
+
+    bench_note("%u sessions x %u messages of %u bytes, %s, BS %u, STmin 0x%02X, %s\n", ctx.sessions, ctx.messages, ctx.size, 
+               (fd == true) ? "CAN FD" : "classic CAN", block_size, st_min, (ifname != NULLPTR) ? ifname : "in process");
+
+    start = bench_now_ns();
+    for (u32 i = 0U; i < ctx.sessions; ++i)
+    {
+        fill_message(&ctx, i);
+        isotp_send(&ctx.tester, i, &ctx.tx_data[(size_t) i * ctx.size], ctx.size, bench_now_ns());
+    }
+
+    total = (u64) ctx.sessions * ctx.messages;
+    while (((ctx.received + ctx.errors) < total) && ((bench_now_ns() - start) < BENCH_TIMEOUT_NS))
+    {
+        u64 const now = bench_now_ns();
+
+        if (ifname != NULLPTR)
+        {
+            isotp_process(&ctx.ecu, now);
+            isotp_process(&ctx.tester, now);
+        }
+        else
+        {
+            link_deliver(&to_ecu, &ctx.ecu);
+            link_deliver(&to_tester, &ctx.tester);
+            isotp_poll(&ctx.ecu, now);
+            isotp_poll(&ctx.tester, now);
+        }
+    }
+    elapsed = bench_now_ns() - start;
+
+    bench_report("isotp messages", ctx.received, elapsed, "msg");
+    bench_report("isotp payload", ctx.received * ctx.size, elapsed, "byte");
+    bench_report("isotp frames", ctx.tester.frames_tx + ctx.ecu.frames_tx, elapsed, "frame");
+    bench_note("%llu of %llu messages, %llu corrupt, %llu errors, %llu frames dropped\n", ctx.received, total, ctx.corrupt, 
+               ctx.errors, ctx.tester.frames_dropped + ctx.ecu.frames_dropped);
+
+    isotp_destruct(&ctx.tester);
+    isotp_destruct(&ctx.ecu);
+    if (ifname != NULLPTR)
+    {
+        can_socket_close(&tester_socket);
+        can_socket_close(&ecu_socket);
+    }
+    free(ctx.tx_data);
+    free(ctx.tx_seq);
+    free(ctx.rx_seq);
+    free(to_ecu.frames[0]);
+    free(to_ecu.frames[1]);
+    free(to_tester.frames[0]);
+    free(to_tester.frames[1]);
+
+    return ((ctx.received != total) || (ctx.corrupt != 0U) || (ctx.errors != 0U)) ? 1 : 0; 
+}
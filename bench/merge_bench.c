@@ -0,0 +1,347 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "capture.h"
+#include "can_socket.h"
+#include "replay.h"
+#include "frame_merge.h"
+#include "bench_common.h"
+
+#define BENCH_RING_SIZE         4096U
+#define BENCH_BATCH             256U
+#define BENCH_MAX_BUSES         32U
+
+struct bench_bus_t
+{
+    frame_ring      ring;
+    can_frame_rec*  storage;
+    u64             next_ns;
+    u32             seq;
+    u32             rx_seq;
+};
+
+struct bench_live_t
+{
+    struct bench_bus_t*     bus;
+    u8                      index;
+    u32                     frames;
+    u32                     source;
+    frame_merge*            merge;
+};
+
+static u64 rng_state = 0x2545F4914F6CDD1DULL;
+
+static u64 rng_next(void)
+{
+    rng_state ^= rng_state << 13U;
+    rng_state ^= rng_state >> 7U;
+    rng_state ^= rng_state << 17U;
+    return rng_state;
+}
+
+static void make_frame(can_frame_rec* const frame, u8 bus, u32 seq, u64 timestamp_ns)
+{
+    frame->timestamp_ns = timestamp_ns;
+    frame->can_id       = 0x100U + bus;
+    frame->len          = 8U;
+    frame->flags        = 0U;
+    frame->bus          = bus;
+    memcpy(frame->data, &seq, sizeof(seq));
+}
+
+// fills the rings in global time order until one is full or all frames are made
+static u64 generate(struct bench_bus_t* const buses, u32 count, u64* const remaining)
+{
+    u64 now = 0U;
+
+    while (*remaining != 0U)
+    {
+        u32 best = 0U;
+        can_frame_rec* slot;
+
+        for (u32 b = 1U; b < count; ++b)
+        {
+            if (buses[b].next_ns < buses[best].next_ns)
+            {
+                best = b;
+            }
+        }
+
+        if (frame_ring_reserve(&buses[best].ring, &slot, 1U) == 0U)
+        {
+            break;
+        }
+
+        make_frame(slot, (u8) best, buses[best].seq++, buses[best].next_ns);
+        frame_ring_commit(&buses[best].ring, 1U);
+        now = buses[best].next_ns;
+        buses[best].next_ns += 50000U + (rng_next() % 400000U);
+        (*remaining)--;
+    }
+
+    return now;
+}
+
+static __boolean check(struct bench_bus_t* const buses, can_frame_rec const * const frame, u64* const last)
+{
+    u32 seq;
+    __boolean ok = (frame->timestamp_ns >= *last);
+
+    memcpy(&seq, frame->data, sizeof(seq));
+    ok = ok && (seq == buses[frame->bus].rx_seq);
+    buses[frame->bus].rx_seq = seq + 1U;
+    *last = frame->timestamp_ns;
+
+    return ok;
+}
+
+static void reset(struct bench_bus_t* const buses, u32 count)
+{
+    for (u32 b = 0U; b < count; ++b)
+    {
+        frame_ring_destruct(&buses[b].ring);
+        (void) frame_ring_init(&buses[b].ring, 0U, buses[b].storage, BENCH_RING_SIZE);
+        buses[b].next_ns = 1000000000ULL + (rng_next() % 1000000U);
+        buses[b].seq     = 0U;
+        buses[b].rx_seq  = 0U;
+    }
+}
+
+static void* producer(void* arg)
+{
+    struct bench_live_t* const live = (struct bench_live_t*) arg;
+    u32 state = 0x9E3779B9U + live->index;
+
+    for (u32 i = 0U; i < live->frames; ++i)
+    {
+        can_frame_rec* slot;
+
+        while (frame_ring_reserve(&live->bus->ring, &slot, 1U) == 0U)
+        {
+            utils_cpu_relax();
+        }
+        make_frame(slot, live->index, i, bench_now_ns());
+        frame_ring_commit(&live->bus->ring, 1U);
+
+        state ^= state << 13U;
+        state ^= state >> 17U;
+        state ^= state << 5U;
+        for (u32 spin = state % 200U; spin > 0U; --spin)
+        {
+            utils_cpu_relax();
+        }
+    }
+
+    frame_merge_finish(live->merge, live->source);
+
+    return NULLPTR;
+}
+
+
+int main(int argc, char** argv)
+{
+    static struct bench_bus_t buses[BENCH_MAX_BUSES];
+    static struct bench_live_t live[BENCH_MAX_BUSES];
+    static pthread_t threads[BENCH_MAX_BUSES];
+    static frame_merge merge;
+    can_frame_rec const * batch[BENCH_BATCH];
+    frame_merge_stats stats;
+    u32 bus_count = 8U;
+    u64 frame_count = 4000000U;
+    u64 remaining;
+    u64 merged;
+    u64 elapsed;
+    u64 start;
+    u64 last;
+    u64 now;
+    u64 errors = 0U;
+    char params[128];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:n:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b':
+                bus_count = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'n':
+                frame_count = strtoull(optarg, NULLPTR, 0);
+                break;
+            default:
+                printf("usage: %s [-b buses, max 32] [-n frames]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    bus_count = GET_MIN(GET_MAX(bus_count, 1U), BENCH_MAX_BUSES);
+    snprintf(params, sizeof(params), "buses=%u frames=%llu", bus_count, frame_count);
+    bench_set_params(params);
+
+    for (u32 b = 0U; b < bus_count; ++b)
+    {
+        buses[b].storage = (can_frame_rec*) aligned_alloc(64U, BENCH_RING_SIZE * sizeof(can_frame_rec));
+        if ((buses[b].storage == NULLPTR) || (frame_ring_init(&buses[b].ring, 0U, buses[b].storage, BENCH_RING_SIZE) == false))
+        {
+            bench_note("out of memory\n");
+            return 1;
+        }
+    }
+
+    // reference: scan all ring heads for every frame
+    reset(buses, bus_count);
+    remaining = frame_count;
+    merged = 0U;
+    elapsed = 0U;
+    last = 0U;
+    while (merged < frame_count)
+    {
+        (void) generate(buses, bus_count, &remaining);
+
+        start = bench_now_ns();
+        for (;;)
+        {
+            can_frame_rec* best = NULLPTR;
+            u32 best_bus = 0U;
+
+            for (u32 b = 0U; b < bus_count; ++b)
+            {
+                can_frame_rec* head;
+
+                if (frame_ring_peek(&buses[b].ring, &head, 1U) == 0U)
+                {
+                    if (remaining != 0U)
+                    {
+                        best = NULLPTR;
+                        break;
+                    }
+                    continue;
+                }
+                if ((best == NULLPTR) || (head->timestamp_ns < best->timestamp_ns))
+                {
+                    best = head;
+                    best_bus = b;
+                }
+            }
+
+            if (best == NULLPTR)
+            {
+                break;
+            }
+            errors += (check(buses, best, &last) == true) ? 0U : 1U;
+            frame_ring_release(&buses[best_bus].ring, 1U);
+            merged++;
+        }
+        elapsed += bench_now_ns() - start;
+    }
+    bench_report("linear scan", merged, elapsed, "frame");
+
+    // loser tree in batches, now is the time the generator reached
+    reset(buses, bus_count);
+    (void) frame_merge_init(&merge, 0U, 1U);
+    for (u32 b = 0U; b < bus_count; ++b)
+    {
+        (void) frame_merge_add_ring(&merge, &buses[b].ring);
+    }
+
+    remaining = frame_count;
+    merged = 0U;
+    elapsed = 0U;
+    last = 0U;
+    now = 0U;
+    while (merged < frame_count)
+    {
+        u64 const reached = generate(buses, bus_count, &remaining);
+        u32 n;
+
+        now = GET_MAX(now, reached + 1U);
+        if (remaining == 0U)
+        {
+            for (u32 b = 0U; b < bus_count; ++b)
+            {
+                frame_merge_finish(&merge, b);
+            }
+        }
+
+        start = bench_now_ns();
+        while ((n = frame_merge_next(&merge, batch, BENCH_BATCH, now)) != 0U)
+        {
+            for (u32 i = 0U; i < n; ++i)
+            {
+                errors += (check(buses, batch[i], &last) == true) ? 0U : 1U;
+            }
+            merged += n;
+        }
+        frame_merge_release(&merge);
+        elapsed += bench_now_ns() - start;
+    }
+    frame_merge_get_stats(&merge, &stats);
+    bench_report("loser tree", merged, elapsed, "frame");
+    bench_note("%u buses, %llu batches of %.1f frames, %llu waits, %llu late, %llu order errors\n", bus_count,
+               stats.batches, (f64) stats.frames / (f64) GET_MAX(stats.batches, 1U), stats.waits, stats.late, errors);
+    frame_merge_destruct(&merge);
+
+    // live: one producer thread per bus stamps frames with the clock, 1 ms window
+    reset(buses, bus_count);
+    (void) frame_merge_init(&merge, 0U, 1000000U);
+    for (u32 b = 0U; b < bus_count; ++b)
+    {
+        live[b].bus    = &buses[b];
+        live[b].index  = (u8) b;
+        live[b].frames = (u32) (frame_count / 4U / bus_count);
+        live[b].merge  = &merge;
+        live[b].source = frame_merge_add_ring(&merge, &buses[b].ring);
+    }
+    for (u32 b = 0U; b < bus_count; ++b)
+    {
+        pthread_create(&threads[b], NULLPTR, producer, &live[b]);
+    }
+
+    merged = 0U;
+    last = 0U;
+    start = bench_now_ns();
+    while (frame_merge_done(&merge) == false)
+    {
+        u32 const n = frame_merge_next(&merge, batch, BENCH_BATCH, bench_now_ns());
+
+        for (u32 i = 0U; i < n; ++i)
+        {
+            u32 seq;
+
+            memcpy(&seq, batch[i]->data, sizeof(seq));
+            errors += (seq == buses[batch[i]->bus].rx_seq) ? 0U : 1U;
+            buses[batch[i]->bus].rx_seq = seq + 1U;
+        }
+        merged += n;
+        if (n == 0U)
+        {
+            utils_cpu_relax();
+        }
+    }
+    frame_merge_release(&merge);
+    elapsed = bench_now_ns() - start;
+
+    for (u32 b = 0U; b < bus_count; ++b)
+    {
+        pthread_join(threads[b], NULLPTR);
+    }
+
+    frame_merge_get_stats(&merge, &stats);
+    bench_report("live merge", merged, elapsed, "frame");
+    bench_note("%llu batches, %llu waits, %llu late, %llu sequence errors\n", stats.batches, stats.waits, stats.late, errors);
+    frame_merge_destruct(&merge);
+
+    for (u32 b = 0U; b < bus_count; ++b)
+    {
+        frame_ring_destruct(&buses[b].ring);
+        free(buses[b].storage);
+    }
+
+    return (errors != 0U) ? 1 : 0;
+}
@@ -0,0 +1,346 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "flash_sim.h"
+#include "nvm_store.h"
+#include "bench_common.h"
+
+#define BENCH_PAGE_SIZE         4096U
+#define BENCH_WRITE_UNIT        8U
+#define BENCH_MAX_VALUE         64U
+
+static u64 rng_state = 0x2545F4914F6CDD1DULL;
+
+static u64 rng_next(void)
+{
+    rng_state ^= rng_state << 13U;
+    rng_state ^= rng_state >> 7U;
+    rng_state ^= rng_state << 17U;
+    return rng_state;
+}
+
+// value of a key after its n-th update, the length varies with n
+static u32 make_value(u8* const value, u32 key, u64 n, u32 size)
+{
+    u32 const len = (size / 2U) + (u32) (n % ((size / 2U) + 1U));
+
+    for (u32 i = 0U; i < len; ++i)
+    {
+        value[i] = (u8) ((key * 31U) + (n * 7U) + i);
+    }
+
+    return len;
+}
+
+static __boolean value_equal(nvm_store* const store, u32 key, u8 const * const expected, u32 len)
+{
+    u8 value[BENCH_MAX_VALUE];
+
+    return ((nvm_store_read(store, key, value, sizeof(value)) == len) && (memcmp(value, expected, len) == 0));
+}
+
+static void print_stats(nvm_store* const store)
+{
+    nvm_store_stats stats;
+
+    nvm_store_get_stats(store, &stats);
+    bench_note("%llu writes, %llu coalesced, %llu unchanged, %llu records, %llu relocated, %llu gc runs, "
+               "%llu wear moves, %llu seals, %llu errors\n", stats.writes, stats.coalesced, stats.unchanged, stats.records,
+               stats.relocated, stats.gc_runs, stats.wear_moves, stats.seals, stats.errors);
+}
+
+static void print_wear(flash_sim const * const flash)
+{
+    u32 min = 0xFFFFFFFFU;
+    u32 max = 0U;
+    u64 sum = 0U;
+
+    for (u32 p = 0U; p < flash->page_count; ++p)
+    {
+        u32 const count = flash_sim_erase_count(flash, p);
+
+        min = GET_MIN(min, count);
+        max = GET_MAX(max, count);
+        sum += count;
+    }
+    bench_note("erase counts: min %u, max %u, mean %.1f over %u pages\n", min, max, (f64) sum / flash->page_count,
+               flash->page_count);
+}
+
+// control thread view: write() calls while the worker persists every interval
+static int run_control(nvm_store* const store, u32 keys, u32 size, u64 writes, u64 interval_ns)
+{
+    u8 value[BENCH_MAX_VALUE];
+    u64 worst = 0U;
+    u64 start;
+    u64 elapsed;
+
+    (void) nvm_store_start(store, interval_ns);
+
+    start = bench_now_ns();
+    for (u64 i = 0U; i < writes; ++i)
+    {
+        u32 const key = (u32) (rng_next() % keys);
+        u32 const len = make_value(value, key, i, size);
+        u64 const t = bench_now_ns();
+
+        (void) nvm_store_write(store, key, value, len);
+        worst = GET_MAX(worst, bench_now_ns() - t);
+    }
+    elapsed = bench_now_ns() - start;
+
+    nvm_store_stop(store);
+
+    bench_report("nvm_store_write", writes, elapsed, "write");
+    bench_note("worst write call %.1f us\n", (f64) worst / 1e3);
+    print_stats(store);
+
+    return 0;
+}
+
+// flash side: every round rewrites the hot keys, the first quarter is written once like calibration data
+static int run_endurance(nvm_store* const store, flash_sim const * const flash, u32 keys, u32 size, u32 rounds,
+                         u64* const versions)
+{
+    u8 value[BENCH_MAX_VALUE];
+    u64 records = 0U;
+    u64 start;
+    u64 elapsed;
+
+    start = bench_now_ns();
+    for (u32 r = 0U; r < rounds; ++r)
+    {
+        for (u32 key = ((r == 0U) ? 0U : (keys / 4U)); key < keys; ++key)
+        {
+            u32 const len = make_value(value, key, ++versions[key], size);
+
+            (void) nvm_store_write(store, key, value, len);
+        }
+        records += nvm_store_flush(store);
+    }
+    elapsed = bench_now_ns() - start;
+
+    bench_report("nvm_store_flush", records, elapsed, "record");
+    print_stats(store);
+    print_wear(flash);
+
+    return 0;
+}
+
+// restart from the flash contents and compare every key with the last version written
+static int run_restart(nvm_store* const store, flash_sim* const flash, u32 keys, u32 size, u64 const * const versions)
+{
+    u8 value[BENCH_MAX_VALUE];
+    nvm_store_stats stats;
+    u32 wrong = 0U;
+
+    nvm_store_destruct(store);
+    if (nvm_store_init(store, 0U, flash, keys, size) == false)
+    {
+        bench_note("restart failed\n");
+        return 1;
+    }
+
+    for (u32 key = 0U; key < keys; ++key)
+    {
+        u32 const len = make_value(value, key, versions[key], size);
+
+        if ((versions[key] != 0U) && (value_equal(store, key, value, len) == false))
+        {
+            wrong++;
+        }
+    }
+
+    nvm_store_get_stats(store, &stats);
+    bench_note("restart %.1f us, %u pages from summaries, %u scanned, %u of %u keys wrong\n", (f64) stats.startup_ns / 1e3,
+               stats.summary_pages, stats.scanned_pages, wrong, keys);
+
+    return (wrong == 0U) ? 0 : 1;
+}
+
+// cuts the power at a random byte of a flush, after the restart every key has to hold its old or its new value
+static int run_power_cut(nvm_store* const store, flash_sim* const flash, u32 keys, u32 size, u32 trials,
+                         u64* const versions)
+{
+    u8 value[BENCH_MAX_VALUE];
+    u64* const updated = (u64*) calloc(keys, sizeof(u64));
+    u32 torn = 0U;
+    u32 lost = 0U;
+    u32 wrong = 0U;
+
+    if (updated == NULLPTR)
+    {
+        return 1;
+    }
+
+    for (u32 t = 0U; (t < trials) && (wrong == 0U); ++t)
+    {
+        u32 const changes = 1U + (u32) (rng_next() % keys);
+
+        memcpy(updated, versions, keys * sizeof(u64));
+        for (u32 c = 0U; c < changes; ++c)
+        {
+            u32 const key = (u32) (rng_next() % keys);
+            u32 const len = make_value(value, key, ++updated[key], size);
+
+            (void) nvm_store_write(store, key, value, len);
+        }
+
+        flash_sim_arm_power_cut(flash, rng_next() % ((u64) changes * (size + 64U)));
+        (void) nvm_store_flush(store);
+        torn += (flash->powered == false) ? 1U : 0U;
+        flash_sim_power_on(flash);
+
+        nvm_store_destruct(store);
+        if (nvm_store_init(store, 0U, flash, keys, size) == false)
+        {
+            bench_note("restart after power cut %u failed\n", t);
+            free(updated);
+            return 1;
+        }
+
+        for (u32 key = 0U; key < keys; ++key)
+        {
+            u32 len;
+
+            if (updated[key] == versions[key])
+            {
+                len = make_value(value, key, versions[key], size);
+                wrong += ((versions[key] != 0U) && (value_equal(store, key, value, len) == false)) ? 1U : 0U;
+                continue;
+            }
+
+            len = make_value(value, key, updated[key], size);
+            if (value_equal(store, key, value, len) == true)
+            {
+                versions[key] = updated[key];
+                continue;
+            }
+
+            len = make_value(value, key, versions[key], size);
+            if ((versions[key] == 0U) ? (nvm_store_read(store, key, value, sizeof(value)) == 0U) :
+                                        (value_equal(store, key, value, len) == true))
+            {
+                lost++;
+                continue;
+            }
+            wrong++;
+        }
+    }
+
+    bench_note("%u power cuts in %u flushes, %u updates lost, %u keys wrong\n", torn, trials, lost, wrong);
+    free(updated);
+
+    return (wrong == 0U) ? 0 : 1;
+}
+
+
+int main(int argc, char** argv)
+{
+    static flash_sim flash;
+    static nvm_store store;
+    char const * path = "nvm_bench.flash";
+    u64* versions;
+    u32 pages = 64U;
+    u32 keys = 256U;
+    u32 size = 32U;
+    u32 rounds = 2000U;
+    u32 trials = 500U;
+    u64 writes = 4000000U;
+    u64 interval_ns = 10000000U;
+    char params[128];
+    int ret;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:p:k:s:n:i:r:c:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f':
+                path = optarg;
+                break;
+            case 'p':
+                pages = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'k':
+                keys = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 's':
+                size = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'n':
+                writes = strtoull(optarg, NULLPTR, 0);
+                break;
+            case 'i':
+                interval_ns = strtoull(optarg, NULLPTR, 0) * 1000000ULL;
+                break;
+            case 'r':
+                rounds = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'c':
+                trials = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            default:
+                printf("usage: %s [-f flash file] [-p pages] [-k keys] [-s value size, max %u] [-n writes] "
+                       "[-i worker interval ms] [-r flush rounds] [-c power cuts]\n", argv[0], BENCH_MAX_VALUE);
+                return 1;
+        }
+    }
+
+    keys = GET_MAX(keys, 1U);
+    size = GET_MIN(GET_MAX(size, 2U), BENCH_MAX_VALUE);
+    snprintf(params, sizeof(params), "pages=%u keys=%u size=%u writes=%llu interval_ms=%llu rounds=%u cuts=%u", pages,
+             keys, size, writes, interval_ns / 1000000ULL, rounds, trials);
+    bench_set_params(params);
+
+    // a fresh file every run, the restarts below reopen it
+    (void) unlink(path);
+    versions = (u64*) calloc(keys, sizeof(u64));
+    if ((versions == NULLPTR) ||
+        (flash_sim_open(&flash, 0U, path, BENCH_PAGE_SIZE, pages, BENCH_WRITE_UNIT) == false) ||
+        (nvm_store_init(&store, 0U, &flash, keys, size) == false))
+    {
+        bench_note("%u keys of %u bytes do not fit %u pages of %u bytes\n", keys, size, pages, BENCH_PAGE_SIZE);
+        free(versions);
+        flash_sim_close(&flash);
+        return 1;
+    }
+
+    ret = run_control(&store, keys, size, writes, interval_ns);
+
+    // the control phase wrote values the endurance phase does not track, start over
+    nvm_store_destruct(&store);
+    flash_sim_close(&flash);
+    (void) unlink(path);
+    (void) flash_sim_open(&flash, 0U, path, BENCH_PAGE_SIZE, pages, BENCH_WRITE_UNIT);
+    (void) nvm_store_init(&store, 0U, &flash, keys, size);
+
+    ret |= run_endurance(&store, &flash, keys, size, rounds, versions);
+
+    // a real restart: the file is closed and mapped again
+    nvm_store_destruct(&store);
+    (void) flash_sim_sync(&flash);
+    flash_sim_close(&flash);
+    if (flash_sim_open(&flash, 0U, path, BENCH_PAGE_SIZE, pages, BENCH_WRITE_UNIT) == false)
+    {
+        bench_note("%s: reopen failed\n", path);
+        free(versions);
+        return 1;
+    }
+    (void) nvm_store_init(&store, 0U, &flash, keys, size);
+    ret |= run_restart(&store, &flash, keys, size, versions);
+
+    ret |= run_power_cut(&store, &flash, keys, size, trials, versions);
+    print_wear(&flash);
+
+    nvm_store_destruct(&store);
+    flash_sim_close(&flash);
+    (void) unlink(path);
+    free(versions);
+
+    return ret;
+}
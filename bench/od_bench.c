@@ -0,0 +1,130 @@
+#include <stdio.h> 
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "canopen_od.h"
+#include "bench_od.h"
+#include "bench_common.h"
+
+static u64 rng_state = 0x2545F4914F6CDD1DULL;
+
+static u64 rng_next(void)
+{
+    rng_state ^= rng_state << 13U;
+    rng_state ^= rng_state >> 7U;
+    rng_state ^= rng_state << 17U;
+    return rng_state;
+}
+
+static int compare_entry(void const * a, void const * b)
+{
+    u32 const key_a = *(u32 const *) a;
+    canopen_od_entry const * const entry = (canopen_od_entry const *) b;
+    u32 const key_b = CANOPEN_OD_KEY(entry->index, entry->sub);
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+// what a dictionary without generated tables typically does 
+static canopen_od_entry const * find_linear(canopen_od const * const od, u16 index, u8 sub)
+{
+    for (u32 i = 0U; i < od->count; ++i)
+    {
+        if ((od->entries[i].index == index) && (od->entries[i].sub == sub))
+        {
+            return &od->entries[i];
+        }
+    }
+    return NULLPTR;
+}
+
+// usage: bench_od [-n lookups]
+int main(int argc, char** argv) 
+{ 
+    canopen_od const * const od = &bench_od;
+    u32* keys;
+    u32 count = 4000000U;
+    u32 linear_count;
+    u64 found = 0U;
+    u64 start;
+    u64 value = 0U;
+    char params[64];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                count = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n lookups]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    snprintf(params, sizeof(params), "lookups=%u entries=%u", count, od->count);
+    bench_set_params(params);
+
+    keys = (u32*) malloc((u64) count * sizeof(u32));
+    if (keys == NULLPTR)
+    {
+        return 1;
+    }
+    // every 16th lookup misses 
+    for (u32 i = 0U; i < count; ++i)
+    {
+        u32 const key = od->keys[rng_next() % od->count];
+        keys[i] = ((i % 16U) == 15U) ? (key | 0xFFU) : key;
+    }
+
+    bench_note("%u entries, %u data bytes, %u lookups\n", od->count, od->data_size, count);
+
+    start = bench_now_ns();
+    for (u32 i = 0U; i < count; ++i)
+    {
+        found += (canopen_od_find(od, (u16) (keys[i] >> 8U), (u8) keys[i]) != NULLPTR);
+    }
+    bench_report("generated tables", count, bench_now_ns() - start, "lookup");
+
+    start = bench_now_ns();
+    for (u32 i = 0U; i < count; ++i)
+    {
+        found += (bsearch(&keys[i], od->entries, od->count, sizeof(canopen_od_entry), compare_entry) != NULLPTR);
+    }
+    bench_report("bsearch on entries", count, bench_now_ns() - start, "lookup");
+
+    linear_count = GET_MIN(count, 200000U);
+    start = bench_now_ns();
+    for (u32 i = 0U; i < linear_count; ++i)
+    {
+        found += (find_linear(od, (u16) (keys[i] >> 8U), (u8) keys[i]) != NULLPTR);
+    }
+    bench_report("linear scan", linear_count, bench_now_ns() - start, "lookup");
+
+    start = bench_now_ns();
+    for (u32 i = 0U; i < count; ++i)
+    {
+        u64 buffer = 0U;
+        if (canopen_od_sdo_read(od, (u16) (keys[i] >> 8U), (u8) keys[i], &buffer, sizeof(buffer), NULLPTR) == CANOPEN_OD_OK)
+        {
+            value += buffer;
+        }
+    }
+    bench_report("lookup and read", count, bench_now_ns() - start, "access");
+
+    // entries known at compile time need no lookup at all 
+    start = bench_now_ns();
+    for (u32 i = 0U; i < count; ++i)
+    {
+        BENCH_OD_VAR_2000_00 += (u8) i;
+    }
+    bench_report("compile time entry", count, bench_now_ns() - start, "access");
+
+    bench_note("found %llu, checksum %llu\n", found, value + BENCH_OD_VAR_2000_00);
+    free(keys);
+
+    return 0; 
+}
@@ -0,0 +1,277 @@
+#include <pthread.h>
+#include <stdio.h> 
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "can_socket.h"
+#include "can_id_table.h"
+#include "canopen_od.h"
+#include "canopen_pdo.h"
+#include "device_od.h"
+#include "bench_common.h"
+
+#define BENCH_PDO_PER_NODE      4U
+
+static u32 const tpdo_maps[BENCH_PDO_PER_NODE][4] = 
+{
+    { CANOPEN_PDO_MAP(0x6000U, 0x01U, 8U),  CANOPEN_PDO_MAP(0x6000U, 0x02U, 8U),  0U, 0U },
+    { CANOPEN_PDO_MAP(0x6401U, 0x01U, 16U), CANOPEN_PDO_MAP(0x6401U, 0x02U, 16U), CANOPEN_PDO_MAP(0x6401U, 0x03U, 16U), CANOPEN_PDO_MAP(0x6401U, 0x04U, 16U) },
+    { CANOPEN_PDO_MAP(0x6401U, 0x05U, 16U), CANOPEN_PDO_MAP(0x6401U, 0x06U, 16U), CANOPEN_PDO_MAP(0x6401U, 0x07U, 16U), CANOPEN_PDO_MAP(0x6401U, 0x08U, 16U) },
+    { CANOPEN_PDO_MAP(0x6000U, 0x01U, 3U),  CANOPEN_PDO_MAP(0x6401U, 0x01U, 13U), CANOPEN_PDO_MAP(0x6000U, 0x02U, 5U),  CANOPEN_PDO_MAP(0x6401U, 0x02U, 11U) },
+};
+
+static u32 const rpdo_maps[BENCH_PDO_PER_NODE][4] = 
+{
+    { CANOPEN_PDO_MAP(0x6200U, 0x01U, 8U),  CANOPEN_PDO_MAP(0x6200U, 0x02U, 8U),  0U, 0U },
+    { CANOPEN_PDO_MAP(0x6411U, 0x01U, 16U), CANOPEN_PDO_MAP(0x6411U, 0x02U, 16U), CANOPEN_PDO_MAP(0x6411U, 0x03U, 16U), CANOPEN_PDO_MAP(0x6411U, 0x04U, 16U) },
+    { CANOPEN_PDO_MAP(0x0005U, 0x00U, 8U),  CANOPEN_PDO_MAP(0x6200U, 0x01U, 8U),  CANOPEN_PDO_MAP(0x6411U, 0x03U, 16U), 0U },
+    { CANOPEN_PDO_MAP(0x6200U, 0x02U, 3U),  CANOPEN_PDO_MAP(0x6411U, 0x04U, 13U), 0U, 0U },
+};
+
+static u32 const map_counts[BENCH_PDO_PER_NODE] = { 2U, 4U, 4U, 4U };
+static u32 const rpdo_counts[BENCH_PDO_PER_NODE] = { 2U, 4U, 3U, 2U };
+
+struct remap_ctx_t
+{
+    canopen_pdo_engine* engine;
+    u32                 pdo;
+    volatile u32        stop;
+    u64                 remaps;
+};
+
+// what an engine without plans does: every mapping entry is looked up and copied bit by bit 
+static u32 naive_sync(canopen_pdo_config const * const configs, u32 count, can_frame_rec* const frames)
+{
+    u32 built = 0U;
+
+    for (u32 i = 0U; i < count; ++i)
+    {
+        canopen_pdo_config const * const config = &configs[i];
+        can_frame_rec* const frame = &frames[built];
+        u32 bit = 0U;
+
+        if (config->direction != CANOPEN_PDO_TX)
+        {
+            continue;
+        }
+
+        memset(frame, 0, sizeof(*frame));
+        for (u32 k = 0U; k < config->map_count; ++k)
+        {
+            canopen_od_entry const * const entry = canopen_od_find(config->od, CANOPEN_PDO_MAP_INDEX(config->map[k]), CANOPEN_PDO_MAP_SUB(config->map[k]));
+            u8 const * const value = (u8 const *) canopen_od_value(config->od, entry);
+
+            for (u32 b = 0U; b < CANOPEN_PDO_MAP_BITS(config->map[k]); ++b, ++bit)
+            {
+                if (((value[b / 8U] >> (b % 8U)) & 1U) != 0U)
+                {
+                    frame->data[bit / 8U] |= (u8) (1U << (bit % 8U));
+                }
+            }
+        }
+        frame->can_id = config->cob_id & CAN_SFF_MASK;
+        frame->len    = (u8) ((bit + 7U) / 8U);
+        built++;
+    }
+
+    return built;
+}
+
+static void* remap_thread(void* arg)
+{
+    struct remap_ctx_t* const ctx = (struct remap_ctx_t*) arg;
+    u32 const a[2] = { CANOPEN_PDO_MAP(0x6401U, 0x01U, 16U), CANOPEN_PDO_MAP(0x6401U, 0x02U, 16U) };
+    u32 const b[2] = { CANOPEN_PDO_MAP(0x6401U, 0x02U, 16U), CANOPEN_PDO_MAP(0x6401U, 0x01U, 16U) };
+
+    while (ctx->stop == 0U)
+    {
+        canopen_pdo_set_mapping(ctx->engine, ctx->pdo, ((ctx->remaps & 1U) == 0U) ? b : a, 2U);
+        ctx->remaps++;
+    }
+
+    return NULLPTR;
+}
+
+// usage: bench_pdo [-n nodes] [-s syncs]
+int main(int argc, char** argv) 
+{ 
+    static canopen_pdo_engine engine;
+    struct remap_ctx_t ctx = { 0 };
+    pthread_t thread;
+    can_frame_rec* frames;
+    can_frame_rec* naive;
+    can_frame_rec* rpdos;
+    u32 nodes = 32U;
+    u32 syncs = 100000U;
+    u32 mismatches = 0U;
+    u32 torn = 0U;
+    u32 tx_count = 0U;
+    u64 built = 0U;
+    u64 start;
+    char params[64];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                nodes = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 's':
+                syncs = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            default:
+                printf("usage: %s [-n nodes, max 127] [-s syncs]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    nodes = GET_MIN(GET_MAX(nodes, 1U), 127U);
+    snprintf(params, sizeof(params), "nodes=%u syncs=%u", nodes, syncs);
+    bench_set_params(params);
+
+    frames = (can_frame_rec*) calloc(nodes * BENCH_PDO_PER_NODE * 2U, sizeof(can_frame_rec));
+    naive  = (can_frame_rec*) calloc(nodes * BENCH_PDO_PER_NODE * 2U, sizeof(can_frame_rec));
+    rpdos  = (can_frame_rec*) calloc(nodes * BENCH_PDO_PER_NODE, sizeof(can_frame_rec));
+    if ((frames == NULLPTR) || (naive == NULLPTR) || (rpdos == NULLPTR) || 
+        (canopen_pdo_init(&engine, 0U, NULLPTR, nodes * BENCH_PDO_PER_NODE * 2U) == false))
+    {
+        bench_note("out of memory\n");
+        return 1;
+    }
+
+    // every node gets the predefined connection set: TPDOn on 0x180 + 0x100 * n + node, 
+    // RPDOn on 0x200 + 0x100 * n + node, all of them mapped onto the same dictionary 
+    for (u32 node = 1U; node <= nodes; ++node)
+    {
+        for (u32 n = 0U; n < BENCH_PDO_PER_NODE; ++n)
+        {
+            canopen_pdo_config config = { 0 };
+
+            config.od           = &device_od;
+            config.direction    = CANOPEN_PDO_TX;
+            config.transmission = 1U;
+            config.cob_id       = 0x180U + (0x100U * n) + node;
+            config.map_count    = map_counts[n];
+            memcpy(config.map, tpdo_maps[n], sizeof(tpdo_maps[n]));
+            if (canopen_pdo_add(&engine, &config) == CANOPEN_PDO_NONE)
+            {
+                bench_note("TPDO %u of node %u rejected\n", n + 1U, node);
+                return 1;
+            }
+
+            config.direction    = CANOPEN_PDO_RX;
+            config.transmission = CANOPEN_PDO_EVENT_PROFILE;
+            config.cob_id       = 0x200U + (0x100U * n) + node;
+            config.map_count    = rpdo_counts[n];
+            memcpy(config.map, rpdo_maps[n], sizeof(rpdo_maps[n]));
+            if (canopen_pdo_add(&engine, &config) == CANOPEN_PDO_NONE)
+            {
+                bench_note("RPDO %u of node %u rejected\n", n + 1U, node);
+                return 1;
+            }
+
+            rpdos[((node - 1U) * BENCH_PDO_PER_NODE) + n].can_id = config.cob_id;
+            rpdos[((node - 1U) * BENCH_PDO_PER_NODE) + n].len    = 8U;
+            memset(rpdos[((node - 1U) * BENCH_PDO_PER_NODE) + n].data, (int) (node + n), 8U);
+        }
+    }
+
+    bench_note("%u nodes, %u PDOs\n", nodes, engine.config_count);
+
+    DEVICE_OD_VAR_6000_01 = 0x5AU;
+    DEVICE_OD_VAR_6000_02 = 0xC3U;
+    for (u32 i = 0U; i < 8U; ++i)
+    {
+        s16 const value = (s16) ((1000 * (s32) i) - 3333);
+        memcpy(canopen_od_value(&device_od, canopen_od_find(&device_od, 0x6401U, (u8) (i + 1U))), &value, sizeof(value));
+    }
+
+    // both ways have to produce the same frames 
+    tx_count = canopen_pdo_build_sync(&engine, frames, engine.max_pdos);
+    if ((naive_sync(engine.configs, engine.config_count, naive) != tx_count))
+    {
+        mismatches++;
+    }
+    for (u32 i = 0U; (mismatches == 0U) && (i < tx_count); ++i)
+    {
+        if ((frames[i].can_id != naive[i].can_id) || (frames[i].len != naive[i].len) || 
+            (memcmp(frames[i].data, naive[i].data, frames[i].len) != 0))
+        {
+            mismatches++;
+        }
+    }
+
+    start = bench_now_ns();
+    for (u32 i = 0U; i < syncs; ++i)
+    {
+        built += naive_sync(engine.configs, engine.config_count, naive);
+    }
+    bench_report("tpdo naive", built, bench_now_ns() - start, "frame");
+
+    built = 0U;
+    start = bench_now_ns();
+    for (u32 i = 0U; i < syncs; ++i)
+    {
+        built += canopen_pdo_build_sync(&engine, frames, engine.max_pdos);
+    }
+    bench_report("tpdo plans", built, bench_now_ns() - start, "frame");
+
+    built = 0U;
+    start = bench_now_ns();
+    for (u32 i = 0U; i < syncs; ++i)
+    {
+        built += canopen_pdo_receive(&engine, rpdos, nodes * BENCH_PDO_PER_NODE);
+    }
+    bench_report("rpdo apply", built, bench_now_ns() - start, "frame");
+
+    // TPDO2 of the first node is remapped all the time, a frame must show one of 
+    // the two mappings completely 
+    ctx.engine = &engine;
+    ctx.pdo    = 2U;
+    DEVICE_OD_VAR_6401_01 = 0x1111;
+    DEVICE_OD_VAR_6401_02 = 0x2222;
+    pthread_create(&thread, NULLPTR, remap_thread, &ctx);
+
+    built = 0U;
+    start = bench_now_ns();
+    for (u32 i = 0U; i < syncs; ++i)
+    {
+        u32 const count = canopen_pdo_build_sync(&engine, frames, engine.max_pdos);
+
+        for (u32 k = 0U; k < count; ++k)
+        {
+            u32 word;
+
+            if (frames[k].can_id != 0x281U)
+            {
+                continue;
+            }
+
+            memcpy(&word, frames[k].data, sizeof(word));
+            if (((frames[k].len != 4U) && (frames[k].len != 8U)) || 
+                ((word != 0x22221111U) && (word != 0x11112222U)))
+            {
+                torn++;
+            }
+        }
+        built += count;
+    }
+    bench_report("tpdo while remapping", built, bench_now_ns() - start, "frame");
+
+    ctx.stop = 1U;
+    pthread_join(thread, NULLPTR);
+
+    bench_note("%llu remaps under traffic, %u torn frames, %u mismatches\n", ctx.remaps, torn, mismatches);
+
+    canopen_pdo_destruct(&engine);
+    free(frames);
+    free(naive);
+    free(rpdos);
+
+    return ((torn != 0U) || (mismatches != 0U)) ? 1 : 0; 
+}
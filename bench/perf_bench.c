@@ -0,0 +1,233 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "perf_counters.h"
+#include "bench_common.h"
+
+#define BENCH_MAX_THREADS       16U
+
+struct worker_t
+{
+    pthread_t       thread;
+    u8              module;
+    u64             ops;
+    int             cpu;
+    u8 volatile*    go;
+    u64             elapsed_ns;
+};
+
+typedef struct worker_t worker;
+
+static void pin(int cpu)
+{
+    cpu_set_t set;
+    long const cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cpus <= 0)
+    {
+        return;
+    }
+
+    // a negative cpu releases the thread to all cpus again
+    CPU_ZERO(&set);
+    for (long c = 0; c < cpus; ++c)
+    {
+        if ((cpu < 0) || (c == (cpu % cpus)))
+        {
+            CPU_SET((int) c, &set);
+        }
+    }
+    (void) pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// what an instrumented call adds: a counter update and one traced section
+static inline void instrumented_op(u8 module, u64 i)
+{
+    u64 const start = perf_counters_enter();
+
+    perf_counters_count(module, 1U, 16U);
+    perf_counters_queue_depth(module, i & 0xFFU);
+    perf_counters_exit(module, start);
+}
+
+static void run_cost(char const * const name, u8 module, u64 ops)
+{
+    u64 start;
+
+    start = bench_now_ns();
+    for (u64 i = 0U; i < ops; ++i)
+    {
+        instrumented_op(module, i);
+        __asm__ volatile("" ::: "memory");
+    }
+    bench_report(name, ops, bench_now_ns() - start, "op");
+}
+
+static void* worker_thread(void* arg)
+{
+    worker* const me = (worker*) arg;
+    u64 start;
+
+    pin(me->cpu);
+    while (*me->go == 0U)
+    {
+        sched_yield();
+    }
+
+    start = bench_now_ns();
+    for (u64 i = 0U; i < me->ops; ++i)
+    {
+        instrumented_op(me->module, i);
+    }
+    me->elapsed_ns = bench_now_ns() - start;
+
+    return NULLPTR;
+}
+
+// every thread counts into the same module, the per cpu slots keep them apart 
+static int run_threads(perf_counters* const perf, u8 module, u32 threads, u64 ops)
+{
+    static worker workers[BENCH_MAX_THREADS];
+    perf_counters_total total;
+    u8 volatile go = 0U;
+    u64 elapsed = 0U;
+    char name[64];
+
+    perf_counters_reset(perf, module);
+    for (u32 t = 0U; t < threads; ++t)
+    {
+        workers[t].module = module;
+        workers[t].ops    = ops;
+        workers[t].cpu    = (int) t;
+        workers[t].go     = &go;
+        (void) pthread_create(&workers[t].thread, NULLPTR, worker_thread, &workers[t]);
+    }
+
+    go = 1U;
+    for (u32 t = 0U; t < threads; ++t)
+    {
+        (void) pthread_join(workers[t].thread, NULLPTR);
+        elapsed = GET_MAX(elapsed, workers[t].elapsed_ns);
+    }
+
+    snprintf(name, sizeof(name), "instrumented op, %u threads", threads);
+    bench_report(name, ops * threads, elapsed, "op");
+
+    if ((perf_counters_get(perf, module, &total) == false) || (total.ops != (ops * threads)) || 
+        (total.traces != (ops * threads)) || (total.bytes != (ops * threads * 16U)))
+    {
+        printf("%s: counted %llu ops, %llu traces, expected %llu\n", name, total.ops, total.traces, ops * threads);
+        return 1;
+    }
+
+    return 0;
+}
+
+// a second mapping of the file sees what another process would 
+static int run_reader(perf_counters* const perf, char const * const path, u8 module)
+{
+    static perf_counters reader;
+    perf_counters_total mine;
+    perf_counters_total theirs;
+    int ret = 0;
+
+    if (perf_counters_open_read_only(&reader, path) == false)
+    {
+        printf("%s: read only open failed\n", path);
+        return 1;
+    }
+
+    (void) perf_counters_get(perf, module, &mine);
+    if ((perf_counters_get(&reader, module, &theirs) == false) || (theirs.ops != mine.ops) || 
+        (strcmp(theirs.name, mine.name) != 0))
+    {
+        printf("reader sees %llu ops of %s, expected %llu of %s\n", theirs.ops, theirs.name, mine.ops, mine.name);
+        ret = 1;
+    }
+
+    bench_note("tsc %.3f GHz, traced op p50 %.0f ns, p99 %.0f ns, max %.0f ns\n", (f64) reader.file->tsc_hz / 1e9,
+               perf_counters_percentile_ns(&reader, &theirs, 0.5), perf_counters_percentile_ns(&reader, &theirs, 0.99),
+               perf_counters_cycles_to_ns(&reader, theirs.max_cycles));
+    if (bench_get_format() == BENCH_FORMAT_TEXT)
+    {
+        perf_counters_dump(&reader);
+    }
+    perf_counters_close(&reader);
+
+    return ret;
+}
+
+
+int main(int argc, char** argv)
+{
+    static perf_counters perf;
+    char const * path = "/dev/shm/perf_bench";
+    char params[128];
+    u64 ops = 20000000U;
+    u32 threads = 4U;
+    u8 module;
+    int ret = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:n:t:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f':
+                path = optarg;
+                break;
+            case 'n':
+                ops = strtoull(optarg, NULLPTR, 0);
+                break;
+            case 't':
+                threads = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'o':
+                if (bench_set_format(optarg) == false)
+                {
+                    printf("-o takes text, json or csv\n");
+                    return 1;
+                }
+                break;
+            default:
+                printf("usage: %s [-f counter file] [-n ops] [-t threads, max %u] [-o text|json|csv]\n", argv[0],
+                       BENCH_MAX_THREADS);
+                return 1;
+        }
+    }
+
+    threads = GET_MIN(GET_MAX(threads, 1U), BENCH_MAX_THREADS);
+    snprintf(params, sizeof(params), "ops=%llu threads=%u", ops, threads);
+    bench_set_params(params);
+
+    // registered before the counters exist, the hot path has to stay a load and a branch 
+    module = utils_register_module("PERF_BENCH", 0U);
+    run_cost("instrumented op, counters closed", module, ops);
+
+    if (perf_counters_open(&perf, 0U, path) == false)
+    {
+        printf("%s: cannot create\n", path);
+        utils_remove_module_registration(module);
+        return 1;
+    }
+    bench_note("%u cpus, %llu bytes mapped\n", perf.cpu_count, perf.map_size);
+
+    run_cost("instrumented op, counters open", module, ops);
+    for (u32 t = 1U; t <= threads; t *= 2U)
+    {
+        ret |= run_threads(&perf, module, t, ops / t);
+    }
+    ret |= run_reader(&perf, path, module);
+
+    utils_remove_module_registration(module);
+    perf_counters_close(&perf);
+    (void) unlink(path);
+
+    return ret;
+}
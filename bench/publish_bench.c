@@ -0,0 +1,382 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "epoll_handler.h"
+#include "frame_publisher.h"
+#include "bench_common.h"
+
+#define BENCH_RING_SIZE         8192U
+#define BENCH_MAX_CLIENTS       16U
+#define BENCH_READ_SIZE         (256U * 1024U)
+#define BENCH_SAMPLE_EVERY      256U
+#define BENCH_SPINS             1024U
+
+struct bench_client_t
+{
+    pthread_t       thread;
+    char const *    path;
+    char const *    filter;
+    u64             frames;
+    u64             gaps;               /* frames the publisher dropped */
+    u64             disorder;
+    u64             bytes;
+    u64             reads;
+    u64*            samples;
+    u64             sample_count;
+    u64             max_samples;
+    u64             first_ns;
+    u64             last_ns;
+    u32 volatile    ready;
+};
+
+typedef struct bench_client_t bench_client;
+
+struct bench_producer_t
+{
+    frame_ring*     ring;
+    u64             frames;
+    u32             payload;
+    u64             rate;               /* frames per second, 0 for as fast as possible */
+    u64             start_ns;
+    u64             end_ns;
+    u32 volatile*   go;
+    u32 volatile    done;
+};
+
+typedef struct bench_producer_t bench_producer;
+
+static inline void backoff(u32* const spins)
+{
+    if (++(*spins) >= BENCH_SPINS)
+    {
+        sched_yield();
+        *spins = 0U;
+    }
+}
+
+static void* producer_thread(void* arg)
+{
+    bench_producer* const me = (bench_producer*) arg;
+    can_frame_rec* slot;
+    u32 spins = 0U;
+
+    while (*me->go == 0U)
+    {
+        sched_yield();
+    }
+
+    me->start_ns = bench_now_ns();
+    for (u64 seq = 0U; seq < me->frames; )
+    {
+        if ((me->rate != 0U) && (bench_now_ns() < (me->start_ns + ((seq * 1000000000ULL) / me->rate))))
+        {
+            backoff(&spins);
+            continue;
+        }
+
+        if (frame_ring_reserve(me->ring, &slot, 1U) == 0U)
+        {
+            backoff(&spins);
+            continue;
+        }
+
+        slot->timestamp_ns = bench_now_ns();
+        slot->can_id       = (u32) (seq & CAN_SFF_MASK);
+        slot->len          = (u8) me->payload;
+        slot->flags        = 0U;
+        slot->bus          = (u8) (seq & 1U);
+        memset(slot->data, 0, me->payload);
+        memcpy(slot->data, &seq, sizeof(seq));
+        frame_ring_commit(me->ring, 1U);
+        seq++;
+    }
+    me->end_ns = bench_now_ns();
+    __atomic_store_n(&me->done, 1U, __ATOMIC_RELEASE);
+
+    return NULLPTR;
+}
+
+// reads records until the server closes, checks the sequence in the payload
+static void* client_thread(void* arg)
+{
+    bench_client* const me = (bench_client*) arg;
+    struct sockaddr_un addr;
+    u8* const buf = (u8*) malloc(BENCH_READ_SIZE);
+    char line[64];
+    u64 expected = 0U;
+    u32 used = 0U;
+    int fd;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, me->path, sizeof(addr.sun_path) - 1U);
+    if ((buf == NULLPTR) || (fd < 0) || (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0))
+    {
+        printf("%s: connect failed\n", me->path);
+        free(buf);
+        me->ready = 1U;
+        return NULLPTR;
+    }
+
+    snprintf(line, sizeof(line), "filter %s\n", me->filter);
+    (void) write(fd, line, strlen(line));
+    me->ready = 1U;
+
+    for (;;)
+    {
+        ssize_t const n = read(fd, &buf[used], BENCH_READ_SIZE - used);
+        u64 const now = bench_now_ns();
+        u32 pos = 0U;
+
+        if (n <= 0)
+        {
+            break;
+        }
+        used += (u32) n;
+        me->bytes += (u64) n;
+        me->reads++;
+        if (me->first_ns == 0U)
+        {
+            me->first_ns = now;
+        }
+        me->last_ns = now;
+
+        while ((used - pos) >= FRAME_PUBLISHER_RECORD_HEADER)
+        {
+            can_frame_rec const * const rec = (can_frame_rec const *) &buf[pos];
+            u32 const size = FRAME_PUBLISHER_RECORD_HEADER + rec->len;
+            u64 seq;
+
+            if ((used - pos) < size)
+            {
+                break;
+            }
+
+            memcpy(&seq, rec->data, sizeof(seq));
+            if (seq > expected)
+            {
+                me->gaps += seq - expected;
+            }
+            else if (seq < expected)
+            {
+                me->disorder++;
+            }
+            expected = seq + 1U;
+
+            if (((me->frames % BENCH_SAMPLE_EVERY) == 0U) && (me->sample_count < me->max_samples))
+            {
+                me->samples[me->sample_count++] = now - rec->timestamp_ns;
+            }
+            me->frames++;
+            pos += size;
+        }
+
+        memmove(buf, &buf[pos], used - pos);
+        used -= pos;
+    }
+
+    close(fd);
+    free(buf);
+
+    return NULLPTR;
+}
+
+static __boolean subscribed(frame_publisher const * const pub, u32 clients)
+{
+    u32 count = 0U;
+
+    for (u32 c = 0U; c < FRAME_PUBLISHER_MAX_CLIENTS; ++c)
+    {
+        count += ((pub->clients[c].fd >= 0) && (pub->clients[c].filter_count != 0U)) ? 1U : 0U;
+    }
+
+    return (count == clients) ? true : false;
+}
+
+static __boolean drained(frame_publisher const * const pub)
+{
+    for (u32 c = 0U; c < FRAME_PUBLISHER_MAX_CLIENTS; ++c)
+    {
+        if ((pub->clients[c].fd >= 0) && (pub->clients[c].head != pub->clients[c].tail))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    static frame_publisher pub;
+    static frame_ring ring;
+    static bench_client clients[BENCH_MAX_CLIENTS];
+    static can_frame_rec storage[BENCH_RING_SIZE];
+    frame_publisher_config config;
+    frame_publisher_stats stats;
+    bench_producer producer;
+    pthread_t producer_tid;
+    u32 volatile go = 0U;
+    char const * path = "/tmp/publish_bench.sock";
+    char const * filter = "all";
+    char params[160];
+    char name[64];
+    u32 client_count = 4U;
+    u32 payload = 8U;
+    u64 frames = 2000000U;
+    u64 rate = 0U;
+    u64 writes = 0U;
+    u64 elapsed;
+    int ret = 0;
+    int opt;
+
+    memset(&config, 0, sizeof(config));
+    while ((opt = getopt(argc, argv, "s:c:n:e:r:q:l:f:po:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 's':
+                path = optarg;
+                break;
+            case 'c':
+                client_count = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'n':
+                frames = strtoull(optarg, NULLPTR, 0);
+                break;
+            case 'e':
+                payload = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'r':
+                rate = strtoull(optarg, NULLPTR, 0);
+                break;
+            case 'q':
+                config.queue_bytes = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'l':
+                config.latency_ns = strtoull(optarg, NULLPTR, 0) * 1000ULL;
+                break;
+            case 'f':
+                filter = optarg;
+                break;
+            case 'p':
+                config.policy = FRAME_PUBLISHER_DISCONNECT;
+                break;
+            case 'o':
+                if (bench_set_format(optarg) == false)
+                {
+                    printf("-o takes text, json or csv\n");
+                    return 1;
+                }
+                break;
+            default:
+                printf("usage: %s [-s socket] [-c clients, max %u] [-n frames] [-e payload bytes, 8..%u] "
+                       "[-r frames/s, 0 unpaced] [-q client queue bytes] [-l latency target us] [-f filter] "
+                       "[-p disconnect slow clients instead of dropping] [-o text|json|csv]\n", argv[0],
+                       BENCH_MAX_CLIENTS, CAN_FRAME_MAX_DATA);
+                return 1;
+        }
+    }
+
+    client_count = GET_MIN(GET_MAX(client_count, 1U), BENCH_MAX_CLIENTS);
+    payload = GET_MIN(GET_MAX(payload, 8U), CAN_FRAME_MAX_DATA);
+
+    if ((frame_ring_init(&ring, 0U, storage, BENCH_RING_SIZE) == false) || 
+        (frame_publisher_init(&pub, 0U, path, &config) == false) || (frame_publisher_add_source(&pub, &ring) == false))
+    {
+        printf("%s: publisher init failed\n", path);
+        return 1;
+    }
+
+    snprintf(params, sizeof(params), "clients=%u payload=%u rate=%llu queue=%u latency_us=%llu policy=%s filter=%s",
+             client_count, payload, rate, pub.config.queue_bytes, pub.config.latency_ns / 1000U,
+             (pub.config.policy == FRAME_PUBLISHER_DROP) ? "drop" : "disconnect", filter);
+    bench_set_params(params);
+
+    for (u32 c = 0U; c < client_count; ++c)
+    {
+        clients[c].path        = path;
+        clients[c].filter      = filter;
+        clients[c].max_samples = (frames / BENCH_SAMPLE_EVERY) + 1U;
+        clients[c].samples     = (u64*) calloc(clients[c].max_samples, sizeof(u64));
+        (void) pthread_create(&clients[c].thread, NULLPTR, client_thread, &clients[c]);
+    }
+
+    // the subscriptions have to be in place before the first frame
+    while (subscribed(&pub, client_count) == false)
+    {
+        (void) frame_publisher_process(&pub, 1);
+    }
+
+    memset(&producer, 0, sizeof(producer));
+    producer.ring    = &ring;
+    producer.frames  = frames;
+    producer.payload = payload;
+    producer.rate    = rate;
+    producer.go      = &go;
+    (void) pthread_create(&producer_tid, NULLPTR, producer_thread, &producer);
+
+    go = 1U;
+    while ((__atomic_load_n(&producer.done, __ATOMIC_ACQUIRE) == 0U) || (frame_ring_count(&ring) != 0U) || 
+           (drained(&pub) == false))
+    {
+        (void) frame_publisher_process(&pub, 1);
+    }
+    elapsed = bench_now_ns() - producer.start_ns;
+
+    (void) pthread_join(producer_tid, NULLPTR);
+    for (u32 c = 0U; c < FRAME_PUBLISHER_MAX_CLIENTS; ++c)
+    {
+        frame_publisher_client_stats client_stats;
+
+        if (frame_publisher_get_client_stats(&pub, c, &client_stats) == true)
+        {
+            writes += client_stats.writes;
+        }
+    }
+    frame_publisher_get_stats(&pub, &stats);
+    frame_publisher_destruct(&pub);
+
+    bench_report("ring -> publisher", stats.frames, elapsed, "frame");
+    for (u32 c = 0U; c < client_count; ++c)
+    {
+        (void) pthread_join(clients[c].thread, NULLPTR);
+
+        snprintf(name, sizeof(name), "client %u", c);
+        bench_report(name, clients[c].frames, elapsed, "frame");
+        snprintf(name, sizeof(name), "client %u ring -> read", c);
+        bench_report_latency(name, clients[c].samples, clients[c].sample_count);
+        bench_note("client %u: %llu frames, %llu dropped, %llu out of order, %llu reads of %.0f bytes\n", c,
+                   clients[c].frames, clients[c].gaps, clients[c].disorder, clients[c].reads,
+                   (clients[c].reads != 0U) ? ((f64) clients[c].bytes / (f64) clients[c].reads) : 0.0);
+
+        // every frame once and in order, unless the policy dropped some 
+        if ((clients[c].disorder != 0U) || 
+            ((strcmp(filter, "all") == 0) && (stats.disconnected == 0U) && ((clients[c].frames + clients[c].gaps) != frames)))
+        {
+            printf("client %u: %llu frames + %llu dropped of %llu, %llu out of order\n", c, clients[c].frames,
+                   clients[c].gaps, frames, clients[c].disorder);
+            ret = 1;
+        }
+        free(clients[c].samples);
+    }
+
+    bench_note("%llu frames to %u clients in %.3f s, %llu writes, %llu accepted, %llu disconnected by policy\n",
+               stats.frames, client_count, (f64) elapsed / 1e9, writes, stats.accepted, stats.disconnected);
+
+    frame_ring_destruct(&ring);
+
+    return ret;
+}
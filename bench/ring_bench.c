@@ -0,0 +1,532 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "bench_common.h"
+
+#define BENCH_MAX_THREADS       16U
+#define BENCH_MAX_BATCH         256U
+#define BENCH_SPINS             1024U       /* busy polls before the core is yielded */
+
+#define BENCH_LOCK_NONE         0U
+#define BENCH_LOCK_MUTEX        1U
+#define BENCH_LOCK_SPIN         2U
+
+struct bench_producer_t
+{
+    frame_ring*         ring;
+    u32                 lock;           /* BENCH_LOCK_xxx, how producers share the ring */
+    pthread_mutex_t*    mutex;
+    u8*                 spin;
+    u32                 payload;
+    u32                 batch;
+    u64                 frames;
+    u64                 checksum;
+    int                 cpu;
+    u32 volatile*       go;
+};
+
+struct bench_consumer_t
+{
+    frame_ring*         rings;
+    u32                 ring_count;
+    u32                 batch;
+    u64                 frames;
+    u64                 checksum;
+    int                 cpu;
+    u32 volatile*       go;
+};
+
+struct bench_echo_t
+{
+    frame_ring*         ping;
+    frame_ring*         pong;
+    u64                 samples;
+    int                 cpu;
+};
+
+// a single core machine only makes progress when a waiting side gives up the core
+static inline void backoff(u32* const spins)
+{
+    if (++(*spins) >= BENCH_SPINS)
+    {
+        sched_yield();
+        *spins = 0U;
+    }
+}
+
+static void pin(int cpu)
+{
+    cpu_set_t set;
+    long const cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cpus <= 0)
+    {
+        return;
+    }
+
+    // a negative cpu releases the thread to all cpus again
+    CPU_ZERO(&set);
+    for (long c = 0; c < cpus; ++c)
+    {
+        if ((cpu < 0) || (c == (cpu % cpus)))
+        {
+            CPU_SET((int) c, &set);
+        }
+    }
+    (void) pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static inline void fill(can_frame_rec* const frame, u64 seq, u32 payload)
+{
+    frame->timestamp_ns = seq;
+    frame->can_id       = (u32) seq & CAN_SFF_MASK;
+    frame->len          = (u8) payload;
+    memset(frame->data, (int) (seq & 0xFFU), payload);
+}
+
+static inline u64 fill_checksum(u64 seq, u32 payload)
+{
+    return (seq & CAN_SFF_MASK) + ((u64) payload * (seq & 0xFFU));
+}
+
+// reads every payload byte like a handler would
+static inline u64 consume(can_frame_rec const * const frame)
+{
+    u64 sum = frame->can_id;
+
+    for (u32 i = 0U; i < frame->len; ++i)
+    {
+        sum += frame->data[i];
+    }
+
+    return sum;
+}
+
+static void* producer(void* arg)
+{
+    struct bench_producer_t* const me = (struct bench_producer_t*) arg;
+    can_frame_rec* slots;
+    u32 spins = 0U;
+    u64 sent = 0U;
+    u32 n;
+
+    pin(me->cpu);
+    while (*me->go == 0U)
+    {
+        backoff(&spins);
+    }
+
+    while (sent < me->frames)
+    {
+        u32 const want = (u32) GET_MIN((u64) me->batch, me->frames - sent);
+
+        if (me->lock == BENCH_LOCK_MUTEX)
+        {
+            pthread_mutex_lock(me->mutex);
+        }
+        else if (me->lock == BENCH_LOCK_SPIN)
+        {
+            while (__atomic_test_and_set(me->spin, __ATOMIC_ACQUIRE) == true)
+            {
+                backoff(&spins);
+            }
+        }
+
+        n = frame_ring_reserve(me->ring, &slots, want);
+        for (u32 i = 0U; i < n; ++i)
+        {
+            fill(&slots[i], sent + i, me->payload);
+            me->checksum += fill_checksum(sent + i, me->payload);
+        }
+        frame_ring_commit(me->ring, n);
+
+        if (me->lock == BENCH_LOCK_MUTEX)
+        {
+            pthread_mutex_unlock(me->mutex);
+        }
+        else if (me->lock == BENCH_LOCK_SPIN)
+        {
+            __atomic_clear(me->spin, __ATOMIC_RELEASE);
+        }
+
+        if (n == 0U)
+        {
+            backoff(&spins);
+        }
+        sent += n;
+    }
+
+    return NULLPTR;
+}
+
+static void* consumer(void* arg)
+{
+    struct bench_consumer_t* const me = (struct bench_consumer_t*) arg;
+    can_frame_rec* slots;
+    u64 received = 0U;
+    u32 spins = 0U;
+
+    pin(me->cpu);
+    while (*me->go == 0U)
+    {
+        backoff(&spins);
+    }
+
+    while (received < me->frames)
+    {
+        u32 got = 0U;
+
+        for (u32 r = 0U; r < me->ring_count; ++r)
+        {
+            u32 const n = frame_ring_peek(&me->rings[r], &slots, me->batch);
+
+            for (u32 i = 0U; i < n; ++i)
+            {
+                me->checksum += consume(&slots[i]);
+            }
+            frame_ring_release(&me->rings[r], n);
+            got += n;
+        }
+
+        if (got == 0U)
+        {
+            backoff(&spins);
+        }
+        received += got;
+    }
+
+    return NULLPTR;
+}
+
+static void* echo(void* arg)
+{
+    struct bench_echo_t* const me = (struct bench_echo_t*) arg;
+    can_frame_rec frame;
+    u32 spins = 0U;
+
+    pin(me->cpu);
+    for (u64 i = 0U; i < me->samples; ++i)
+    {
+        while (frame_ring_pop(me->ping, &frame) == false)
+        {
+            backoff(&spins);
+        }
+        while (frame_ring_push(me->pong, &frame) == false)
+        {
+            backoff(&spins);
+        }
+    }
+
+    return NULLPTR;
+}
+
+// both sides on one thread: copying push/pop and in place batches
+static int run_single(frame_ring* const ring, u32 payload, u32 batch, u64 frames)
+{
+    u32 const capacity = frame_ring_capacity(ring);
+    u32 const chunk = GET_MAX(capacity / 2U, 1U);
+    can_frame_rec frame;
+    can_frame_rec* slots;
+    u64 expected = 0U;
+    u64 checksum = 0U;
+    u64 start;
+    u64 done;
+
+    memset(&frame, 0, sizeof(frame));
+
+    start = bench_now_ns();
+    for (done = 0U; done < frames; done += chunk)
+    {
+        for (u32 i = 0U; i < chunk; ++i)
+        {
+            fill(&frame, done + i, payload);
+            expected += fill_checksum(done + i, payload);
+            (void) frame_ring_push(ring, &frame);
+        }
+        for (u32 i = 0U; i < chunk; ++i)
+        {
+            (void) frame_ring_pop(ring, &frame);
+            checksum += consume(&frame);
+        }
+    }
+    bench_report("single push+pop", done, bench_now_ns() - start, "frame");
+
+    if (checksum != expected)
+    {
+        bench_note("single push+pop: checksum differs\n");
+        return 1;
+    }
+
+    start = bench_now_ns();
+    for (done = 0U; done < frames; )
+    {
+        u32 const n = frame_ring_reserve(ring, &slots, batch);
+        u32 m;
+
+        for (u32 i = 0U; i < n; ++i)
+        {
+            fill(&slots[i], done + i, payload);
+            expected += fill_checksum(done + i, payload);
+        }
+        frame_ring_commit(ring, n);
+
+        m = frame_ring_peek(ring, &slots, batch);
+        for (u32 i = 0U; i < m; ++i)
+        {
+            checksum += consume(&slots[i]);
+        }
+        frame_ring_release(ring, m);
+        done += n;
+    }
+    bench_report("single batch", done, bench_now_ns() - start, "frame");
+
+    if (checksum != expected)
+    {
+        bench_note("single batch: checksum differs\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// producer and consumer on their own cores, batch 1 is push/pop granularity
+static int run_spsc(frame_ring* const ring, u32 payload, u32 batch, u64 frames, int const * const cpu)
+{
+    u32 const batches[2] = { 1U, batch };
+    int ret = 0;
+
+    for (u32 b = 0U; b < ((batch == 1U) ? 1U : 2U); ++b)
+    {
+        u32 volatile go = 0U;
+        struct bench_producer_t prod = { ring, BENCH_LOCK_NONE, NULLPTR, NULLPTR, payload, batches[b], frames, 0U, cpu[0], &go };
+        struct bench_consumer_t cons = { ring, 1U, batches[b], frames, 0U, cpu[1], &go };
+        pthread_t threads[2];
+        char name[32];
+        u64 start;
+
+        pthread_create(&threads[0], NULLPTR, producer, &prod);
+        pthread_create(&threads[1], NULLPTR, consumer, &cons);
+
+        start = bench_now_ns();
+        __atomic_store_n(&go, 1U, __ATOMIC_RELEASE);
+        pthread_join(threads[0], NULLPTR);
+        pthread_join(threads[1], NULLPTR);
+
+        snprintf(name, sizeof(name), "spsc batch %u", batches[b]);
+        bench_report(name, frames, bench_now_ns() - start, "frame");
+
+        if (prod.checksum != cons.checksum)
+        {
+            bench_note("%s: checksum differs\n", name);
+            ret = 1;
+        }
+    }
+
+    return ret;
+}
+
+// one frame bounces between two cores, the sample is the round trip
+static int run_latency(frame_ring* const ping, frame_ring* const pong, u32 payload, u64 samples, int const * const cpu)
+{
+    u64* const rtt = (u64*) malloc(samples * sizeof(u64));
+    struct bench_echo_t peer = { ping, pong, samples, cpu[1] };
+    can_frame_rec frame;
+    pthread_t thread;
+    u32 spins = 0U;
+
+    if (rtt == NULLPTR)
+    {
+        return 1;
+    }
+
+    memset(&frame, 0, sizeof(frame));
+    pin(cpu[0]);
+    pthread_create(&thread, NULLPTR, echo, &peer);
+
+    for (u64 i = 0U; i < samples; ++i)
+    {
+        u64 const start = bench_now_ns();
+
+        fill(&frame, i, payload);
+        (void) frame_ring_push(ping, &frame);
+        while (frame_ring_pop(pong, &frame) == false)
+        {
+            backoff(&spins);
+        }
+        rtt[i] = bench_now_ns() - start;
+    }
+    pthread_join(thread, NULLPTR);
+    pin(-1);
+
+    bench_report_latency("spsc round trip", rtt, samples);
+    free(rtt);
+
+    return 0;
+}
+
+// several producers into one consumer: a shared ring behind a lock against a ring per producer
+static int run_contention(frame_ring* const rings, u32 threads, u32 payload, u32 batch, u64 frames, int const * const cpu)
+{
+    static char const * const names[3] = { "mpsc ring per producer", "mpsc shared + mutex", "mpsc shared + spinlock" };
+    static u32 const locks[3] = { BENCH_LOCK_NONE, BENCH_LOCK_MUTEX, BENCH_LOCK_SPIN };
+    struct bench_producer_t prod[BENCH_MAX_THREADS];
+    pthread_t tids[BENCH_MAX_THREADS];
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    u64 const per_thread = frames / threads;
+    int ret = 0;
+
+    for (u32 v = 0U; v < 3U; ++v)
+    {
+        u32 volatile go = 0U;
+        u8 spin = 0U;
+        struct bench_consumer_t cons = { rings, (locks[v] == BENCH_LOCK_NONE) ? threads : 1U, batch,
+                                         per_thread * threads, 0U, cpu[1], &go };
+        u64 expected = 0U;
+        u64 start;
+
+        for (u32 t = 0U; t < threads; ++t)
+        {
+            prod[t] = (struct bench_producer_t) { (locks[v] == BENCH_LOCK_NONE) ? &rings[t] : &rings[0], locks[v], &mutex,
+                                                   &spin, payload, batch, per_thread, 0U, -1, &go };
+            pthread_create(&tids[t], NULLPTR, producer, &prod[t]);
+        }
+
+        start = bench_now_ns();
+        __atomic_store_n(&go, 1U, __ATOMIC_RELEASE);
+        (void) consumer(&cons);
+        for (u32 t = 0U; t < threads; ++t)
+        {
+            pthread_join(tids[t], NULLPTR);
+            expected += prod[t].checksum;
+        }
+        bench_report(names[v], per_thread * threads, bench_now_ns() - start, "frame");
+        pin(-1);
+
+        if (expected != cons.checksum)
+        {
+            bench_note("%s: checksum differs\n", names[v]);
+            ret = 1;
+        }
+    }
+    pthread_mutex_destroy(&mutex);
+
+    return ret;
+}
+
+
+int main(int argc, char** argv)
+{
+    static frame_ring rings[BENCH_MAX_THREADS];
+    can_frame_rec* storage[BENCH_MAX_THREADS];
+    char params[128];
+    char const * mode = "all";
+    int cpu[2] = { 0, 1 };
+    u32 payload = 8U;
+    u32 capacity = 4096U;
+    u32 batch = 32U;
+    u32 threads = 4U;
+    u64 frames = 10000000U;
+    u64 samples = 100000U;
+    int ret = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "e:c:b:t:n:s:a:m:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'e':
+                payload = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'c':
+                capacity = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'b':
+                batch = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 't':
+                threads = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'n':
+                frames = strtoull(optarg, NULLPTR, 0);
+                break;
+            case 's':
+                samples = strtoull(optarg, NULLPTR, 0);
+                break;
+            case 'a':
+                if (sscanf(optarg, "%d,%d", &cpu[0], &cpu[1]) != 2)
+                {
+                    printf("-a takes producer and consumer cpu like 2,3\n");
+                    return 1;
+                }
+                break;
+            case 'm':
+                mode = optarg;
+                break;
+            case 'o':
+                if (bench_set_format(optarg) == false)
+                {
+                    printf("-o takes text, json or csv\n");
+                    return 1;
+                }
+                break;
+            default:
+                printf("usage: %s [-e payload bytes, max %u] [-c capacity, power of two] [-b batch, max %u] "
+                       "[-t producer threads, max %u] [-n frames] [-s latency samples] [-a cpu,cpu] "
+                       "[-m all|single|spsc|latency|contention] [-o text|json|csv]\n", argv[0], CAN_FRAME_MAX_DATA,
+                       BENCH_MAX_BATCH, BENCH_MAX_THREADS);
+                return 1;
+        }
+    }
+
+    payload = GET_MIN(payload, CAN_FRAME_MAX_DATA);
+    batch   = GET_MIN(GET_MAX(batch, 1U), BENCH_MAX_BATCH);
+    threads = GET_MIN(GET_MAX(threads, 1U), BENCH_MAX_THREADS);
+    samples = GET_MAX(samples, 1U);
+
+    for (u32 t = 0U; t < BENCH_MAX_THREADS; ++t)
+    {
+        storage[t] = (can_frame_rec*) calloc(capacity, sizeof(can_frame_rec));
+        if ((storage[t] == NULLPTR) || (frame_ring_init(&rings[t], 0U, storage[t], capacity) == false))
+        {
+            bench_note("capacity %u: not a power of two or out of memory\n", capacity);
+            return 1;
+        }
+    }
+
+    snprintf(params, sizeof(params), "payload=%u capacity=%u batch=%u threads=%u cpus=%d,%d", payload, capacity,
+             batch, threads, cpu[0], cpu[1]);
+    bench_set_params(params);
+
+    if ((strcmp(mode, "all") == 0) || (strcmp(mode, "single") == 0))
+    {
+        ret |= run_single(&rings[0], payload, batch, frames);
+    }
+    if ((strcmp(mode, "all") == 0) || (strcmp(mode, "spsc") == 0))
+    {
+        ret |= run_spsc(&rings[0], payload, batch, frames, cpu);
+    }
+    if ((strcmp(mode, "all") == 0) || (strcmp(mode, "latency") == 0))
+    {
+        ret |= run_latency(&rings[0], &rings[1], payload, samples, cpu);
+    }
+    if ((strcmp(mode, "all") == 0) || (strcmp(mode, "contention") == 0))
+    {
+        ret |= run_contention(rings, threads, payload, batch, frames, cpu);
+    }
+
+    for (u32 t = 0U; t < BENCH_MAX_THREADS; ++t)
+    {
+        frame_ring_destruct(&rings[t]);
+        free(storage[t]);
+    }
+
+    return ret;
+}
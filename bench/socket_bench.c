@@ -0,0 +1,417 @@
+#define _GNU_SOURCE
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "can_socket.h"
+#include "bench_common.h"
+
+#define BENCH_RING_SIZE         4096U
+#define BENCH_SOCKET_BUFFER     (4U << 20U)
+#define BENCH_IDLE_NS           1000000000ULL
+#define BENCH_SPINS             1024U
+
+// socket -> ring (the receive thread), ring -> counting or the handler
+struct bench_rx_t
+{
+    can_socket*     socket;
+    frame_ring*     ring;               /* NULLPTR: frames are only counted */
+    u64             frames;
+    u64             received;
+    u64             last_ns;
+    int             cpu;
+    u32 volatile    done;
+};
+
+struct bench_handler_t
+{
+    frame_ring*     ring;
+    u64*            total;              /* send -> handler */
+    u64*            kernel;             /* send -> socket receive timestamp */
+    u64*            dispatch;           /* socket receive timestamp -> handler */
+    u64             samples;
+    u64             count;
+    int             cpu;
+    u32 volatile*   done;
+};
+
+static void pin(int cpu)
+{
+    cpu_set_t set;
+    long const cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cpus <= 0)
+    {
+        return;
+    }
+
+    // a negative cpu releases the thread to all cpus again
+    CPU_ZERO(&set);
+    for (long c = 0; c < cpus; ++c)
+    {
+        if ((cpu < 0) || (c == (cpu % cpus)))
+        {
+            CPU_SET((int) c, &set);
+        }
+    }
+    (void) pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// same clock as the kernel receive timestamps
+static u64 realtime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+}
+
+static void make_frame(can_frame_rec* const frame, u64 seq, u32 payload)
+{
+    frame->can_id = 0x100U + (u32) (seq & 0xFFU);
+    frame->len    = (u8) payload;
+    frame->flags  = (payload > CAN_MAX_DLEN) ? CAN_FRAME_FLAG_FD : 0U;
+    memset(frame->data, (int) (seq & 0xFFU), payload);
+}
+
+static void* receiver(void* arg)
+{
+    struct bench_rx_t* const me = (struct bench_rx_t*) arg;
+    can_frame_rec frames[CAN_SOCKET_MAX_BATCH];
+    struct pollfd pfd = { me->socket->fd, POLLIN, 0 };
+    can_frame_rec* slots;
+    u32 n;
+
+    pin(me->cpu);
+    while ((me->received < me->frames) && (__atomic_load_n(&me->done, __ATOMIC_ACQUIRE) == 0U))
+    {
+        if (me->ring != NULLPTR)
+        {
+            // straight into the ring slots, the handler is behind when there is no space
+            u32 const space = frame_ring_reserve(me->ring, &slots, CAN_SOCKET_MAX_BATCH);
+
+            if (space == 0U)
+            {
+                sched_yield();
+                continue;
+            }
+            n = can_socket_recv_batch(me->socket, slots, space);
+            frame_ring_commit(me->ring, n);
+        }
+        else
+        {
+            n = can_socket_recv_batch(me->socket, frames, CAN_SOCKET_MAX_BATCH);
+        }
+
+        if (n == 0U)
+        {
+            (void) poll(&pfd, 1, 10);
+            continue;
+        }
+
+        __atomic_store_n(&me->last_ns, bench_now_ns(), __ATOMIC_RELAXED);
+        __atomic_store_n(&me->received, me->received + n, __ATOMIC_RELEASE);
+    }
+
+    return NULLPTR;
+}
+
+static void* handler(void* arg)
+{
+    struct bench_handler_t* const me = (struct bench_handler_t*) arg;
+    can_frame_rec* slots;
+    u32 spins = 0U;
+
+    pin(me->cpu);
+    while (me->count < me->samples)
+    {
+        u32 const n = frame_ring_peek(me->ring, &slots, CAN_SOCKET_MAX_BATCH);
+        u64 const now = realtime_ns();
+
+        if (n == 0U)
+        {
+            // the receiver stopped and everything it received is handled
+            if (__atomic_load_n(me->done, __ATOMIC_ACQUIRE) != 0U)
+            {
+                break;
+            }
+            if (++spins >= BENCH_SPINS)
+            {
+                sched_yield();
+                spins = 0U;
+            }
+            continue;
+        }
+
+        for (u32 i = 0U; (i < n) && (me->count < me->samples); ++i)
+        {
+            u64 sent;
+
+            memcpy(&sent, slots[i].data, sizeof(sent));
+            me->total[me->count]    = (now > sent) ? (now - sent) : 0U;
+            me->kernel[me->count]   = (slots[i].timestamp_ns > sent) ? (slots[i].timestamp_ns - sent) : 0U;
+            me->dispatch[me->count] = (now > slots[i].timestamp_ns) ? (now - slots[i].timestamp_ns) : 0U;
+            me->count++;
+        }
+        frame_ring_release(me->ring, n);
+    }
+
+    return NULLPTR;
+}
+
+// waits for the receiver until all frames are in or nothing arrived for a while
+static void wait_receiver(struct bench_rx_t* const rx)
+{
+    u64 const sent_ns = bench_now_ns();
+
+    while (__atomic_load_n(&rx->received, __ATOMIC_ACQUIRE) < rx->frames)
+    {
+        u64 const last = GET_MAX(__atomic_load_n(&rx->last_ns, __ATOMIC_RELAXED), sent_ns);
+
+        if ((bench_now_ns() - last) > BENCH_IDLE_NS)
+        {
+            break;
+        }
+        usleep(1000);
+    }
+    __atomic_store_n(&rx->done, 1U, __ATOMIC_RELEASE);
+}
+
+static void drain(can_socket* const socket)
+{
+    can_frame_rec frames[CAN_SOCKET_MAX_BATCH];
+
+    while (can_socket_recv_batch(socket, frames, CAN_SOCKET_MAX_BATCH) != 0U)
+    {
+    }
+}
+
+// batches of frames as fast as the socket takes them, counted by a receiver on another socket
+static int run_throughput(can_socket* const tx, can_socket* const rx, u32 payload, u32 batch, u64 frames,
+                          int const * const cpu)
+{
+    can_frame_rec out[CAN_SOCKET_MAX_BATCH];
+    struct bench_rx_t sink = { rx, NULLPTR, frames, 0U, 0U, cpu[1], 0U };
+    pthread_t thread;
+    u64 sent = 0U;
+    u64 start;
+    u64 elapsed;
+
+    memset(out, 0, sizeof(out));
+    pthread_create(&thread, NULLPTR, receiver, &sink);
+
+    pin(cpu[0]);
+    start = bench_now_ns();
+    while (sent < frames)
+    {
+        u32 const n = (u32) GET_MIN((u64) batch, frames - sent);
+        u32 done;
+
+        for (u32 i = 0U; i < n; ++i)
+        {
+            make_frame(&out[i], sent + i, payload);
+        }
+        done = can_socket_send_batch(tx, out, n);
+        if (done == 0U)
+        {
+            break;
+        }
+        sent += done;
+    }
+    elapsed = bench_now_ns() - start;
+    pin(-1);
+
+    wait_receiver(&sink);
+    pthread_join(thread, NULLPTR);
+
+    bench_report("socket tx", sent, elapsed, "frame");
+    bench_report("socket rx", sink.received, (sink.received != 0U) ? (sink.last_ns - start) : 0U, "frame");
+    if (sink.received != sent)
+    {
+        bench_note("%llu of %llu frames lost\n", sent - sink.received, sent);
+    }
+
+    return (sent == frames) ? 0 : 1;
+}
+
+// paced frames carry their send time, the handler behind the receive thread and the ring takes the samples
+static int run_latency(can_socket* const tx, can_socket* const rx, u32 payload, u64 samples, u64 rate,
+                       int const * const cpu)
+{
+    static frame_ring ring;
+    can_frame_rec* const storage = (can_frame_rec*) calloc(BENCH_RING_SIZE, sizeof(can_frame_rec));
+    u64* const buffer = (u64*) malloc(samples * 3U * sizeof(u64));
+    u64 const period = 1000000000ULL / GET_MAX(rate, 1U);
+    struct bench_rx_t reader = { rx, &ring, samples, 0U, 0U, cpu[1], 0U };
+    struct bench_handler_t app = { &ring, buffer, buffer + samples, buffer + (2U * samples), samples, 0U, cpu[1],
+                                   &reader.done };
+    can_frame_rec frame;
+    pthread_t threads[2];
+    u64 next;
+
+    if ((storage == NULLPTR) || (buffer == NULLPTR) || (frame_ring_init(&ring, 0U, storage, BENCH_RING_SIZE) == false))
+    {
+        free(storage);
+        free(buffer);
+        return 1;
+    }
+
+    memset(&frame, 0, sizeof(frame));
+    pthread_create(&threads[0], NULLPTR, receiver, &reader);
+    pthread_create(&threads[1], NULLPTR, handler, &app);
+
+    pin(cpu[0]);
+    next = realtime_ns();
+    for (u64 i = 0U; i < samples; ++i)
+    {
+        u64 now;
+        u64 stamp;
+
+        // sleep most of the gap, spin the rest
+        next += period;
+        while ((now = realtime_ns()) < next)
+        {
+            if ((next - now) > 100000U)
+            {
+                struct timespec const gap = { 0, (long) (next - now - 50000U) };
+                nanosleep(&gap, NULLPTR);
+            }
+        }
+
+        make_frame(&frame, i, payload);
+        stamp = realtime_ns();
+        memcpy(frame.data, &stamp, sizeof(stamp));
+        (void) can_socket_send_batch(tx, &frame, 1U);
+    }
+    pin(-1);
+
+    wait_receiver(&reader);
+    pthread_join(threads[0], NULLPTR);
+    pthread_join(threads[1], NULLPTR);
+
+    bench_report_latency("send -> handler", app.total, app.count);
+    bench_report_latency("send -> socket rx", app.kernel, app.count);
+    bench_report_latency("socket rx -> handler", app.dispatch, app.count);
+    if (app.count != samples)
+    {
+        bench_note("%llu of %llu frames lost\n", samples - app.count, samples);
+    }
+
+    frame_ring_destruct(&ring);
+    free(storage);
+    free(buffer);
+
+    return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+    static can_socket tx;
+    static can_socket rx;
+    char params[128];
+    char const * ifname = "vcan0";
+    char const * mode = "all";
+    int cpu[2] = { 0, 1 };
+    u32 payload = 8U;
+    u32 batch = CAN_SOCKET_MAX_BATCH;
+    u64 frames = 1000000U;
+    u64 samples = 20000U;
+    u64 rate = 10000U;
+    int ret = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:e:b:n:s:r:a:m:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'i':
+                ifname = optarg;
+                break;
+            case 'e':
+                payload = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'b':
+                batch = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'n':
+                frames = strtoull(optarg, NULLPTR, 0);
+                break;
+            case 's':
+                samples = strtoull(optarg, NULLPTR, 0);
+                break;
+            case 'r':
+                rate = strtoull(optarg, NULLPTR, 0);
+                break;
+            case 'a':
+                if (sscanf(optarg, "%d,%d", &cpu[0], &cpu[1]) != 2)
+                {
+                    printf("-a takes sender and receiver cpu like 2,3\n");
+                    return 1;
+                }
+                break;
+            case 'm':
+                mode = optarg;
+                break;
+            case 'o':
+                if (bench_set_format(optarg) == false)
+                {
+                    printf("-o takes text, json or csv\n");
+                    return 1;
+                }
+                break;
+            default:
+                printf("usage: %s [-i vcan] [-e payload bytes, FD above 8] [-b batch, max %u] [-n frames] "
+                       "[-s latency samples] [-r latency frames/s] [-a cpu,cpu] [-m all|throughput|latency] "
+                       "[-o text|json|csv]\n", argv[0], CAN_SOCKET_MAX_BATCH);
+                return 1;
+        }
+    }
+
+    payload = GET_MIN(payload, CAN_FRAME_MAX_DATA);
+    batch   = GET_MIN(GET_MAX(batch, 1U), CAN_SOCKET_MAX_BATCH);
+    samples = GET_MAX(samples, 1U);
+
+    tx.fd = -1;
+    rx.fd = -1;
+    if ((can_socket_open(&tx, 0U, ifname, 0U, (payload > CAN_MAX_DLEN) ? true : false) == false) ||
+        (can_socket_open(&rx, 0U, ifname, 0U, (payload > CAN_MAX_DLEN) ? true : false) == false))
+    {
+        bench_note("%s not available, skipped\n", ifname);
+        can_socket_close(&tx);
+        can_socket_close(&rx);
+        return 0;
+    }
+    can_socket_set_buffers(&tx, BENCH_SOCKET_BUFFER, BENCH_SOCKET_BUFFER);
+    can_socket_set_buffers(&rx, BENCH_SOCKET_BUFFER, BENCH_SOCKET_BUFFER);
+    can_socket_set_nonblocking(&rx, true);
+
+    snprintf(params, sizeof(params), "if=%s payload=%u batch=%u rate=%llu cpus=%d,%d", ifname, payload, batch, rate,
+             cpu[0], cpu[1]);
+    bench_set_params(params);
+
+    if ((strcmp(mode, "all") == 0) || (strcmp(mode, "throughput") == 0))
+    {
+        ret |= run_throughput(&tx, &rx, payload, batch, frames, cpu);
+        drain(&rx);
+    }
+    if ((strcmp(mode, "all") == 0) || (strcmp(mode, "latency") == 0))
+    {
+        // the send time travels in the first 8 payload bytes
+        payload = GET_MAX(payload, 8U);
+        ret |= run_latency(&tx, &rx, payload, samples, rate, cpu);
+    }
+
+    can_socket_close(&tx);
+    can_socket_close(&rx);
+
+    return ret;
+}
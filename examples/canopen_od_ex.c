@@ -0,0 +1,32 @@
+#include <stdio.h> 
+
+#include "utils.h"
+#include "canopen_od.h"
+#include "device_od.h"
+
+#define SOMETHING_WENT_WRONG(__X) do {  if( (__X) == false )  { printf("Something is Wrong!!\n"); return 1;} } while (0)     
+
+int main(void) 
+{ 
+    canopen_od const * const od = &device_od;
+    canopen_od_entry const * entry;
+    u16 heartbeat = 250U;
+    u32 value = 0U;
+    char name[17] = { 0 };
+
+    // runtime access, as an SDO server does it 
+    SOMETHING_WENT_WRONG(canopen_od_sdo_write(od, 0x1017U, 0x00U, &heartbeat, sizeof(heartbeat)) == CANOPEN_OD_OK);
+    SOMETHING_WENT_WRONG(canopen_od_sdo_read(od, 0x1018U, 0x03U, &value, sizeof(value), NULLPTR) == CANOPEN_OD_OK);
+    SOMETHING_WENT_WRONG(canopen_od_sdo_read(od, 0x1008U, 0x00U, name, sizeof(name) - 1U, NULLPTR) == CANOPEN_OD_OK);
+    SOMETHING_WENT_WRONG(canopen_od_sdo_write(od, 0x1000U, 0x00U, &value, sizeof(value)) == CANOPEN_OD_ABORT_READ_ONLY);
+    SOMETHING_WENT_WRONG(canopen_od_find(od, 0x1017U, 0x01U) == NULLPTR);
+
+    // compile time access, no lookup 
+    printf("device %s, revision 0x%08X, heartbeat %u ms\n", name, value, DEVICE_OD_VAR_1017_00);
+    printf("TPDO1 COB-ID 0x%03X, %u objects mapped\n", DEVICE_OD_VAR_1800_01, DEVICE_OD_VAR_1A00_00);
+
+    entry = &od->entries[DEVICE_OD_POS_1A00_01];
+    printf("%s: 0x%08X\n", od->names[DEVICE_OD_POS_1A00_01], *(u32 const *) canopen_od_value(od, entry));
+
+    return 0; 
+}
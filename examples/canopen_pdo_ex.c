@@ -0,0 +1,79 @@
+#include <pthread.h>
+#include <stdio.h> 
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "can_socket.h"
+#include "can_id_table.h"
+#include "canopen_od.h"
+#include "canopen_pdo.h"
+#include "device_od.h"
+
+#define SOMETHING_WENT_WRONG(__X) do {  if( (__X) == false )  { printf("Something is Wrong!!\n"); return 1;} } while (0)     
+
+static void print_frames(char const * const title, can_frame_rec const * const frames, u32 count)
+{
+    printf("%s: %u TPDOs\n", title, count);
+    for (u32 i = 0U; i < count; ++i)
+    {
+        printf("  %03X [%u]", frames[i].can_id, frames[i].len);
+        for (u32 k = 0U; k < frames[i].len; ++k)
+        {
+            printf(" %02X", frames[i].data[k]);
+        }
+        printf("\n");
+    }
+}
+
+int main(void) 
+{ 
+    static canopen_pdo_engine engine;
+    can_frame_rec frames[8];
+    can_frame_rec rpdo = { 0 };
+    u32 const remap[2] = { CANOPEN_PDO_MAP(0x6401U, 0x02U, 16U), CANOPEN_PDO_MAP(0x6000U, 0x01U, 4U) };
+    u32 const invalid[1] = { CANOPEN_PDO_MAP(0x1000U, 0x00U, 32U) };
+    u32 tpdo1 = CANOPEN_PDO_NONE;
+    u32 count;
+
+    // no socket, the frames are only built 
+    SOMETHING_WENT_WRONG(canopen_pdo_init(&engine, 0U, NULLPTR, 16U));
+    SOMETHING_WENT_WRONG(canopen_pdo_add_od(&engine, &device_od) != 0U);
+
+    for (u32 i = 0U; i < engine.config_count; ++i)
+    {
+        if (engine.configs[i].comm_index == 0x1800U)
+        {
+            tpdo1 = i;
+        }
+    }
+    SOMETHING_WENT_WRONG(tpdo1 != CANOPEN_PDO_NONE);
+
+    DEVICE_OD_VAR_6000_01 = 0xA5U;
+    DEVICE_OD_VAR_6000_02 = 0x3CU;
+    DEVICE_OD_VAR_6401_01 = 1000;
+    DEVICE_OD_VAR_6401_02 = -1000;
+
+    count = canopen_pdo_build_sync(&engine, frames, 8U);
+    print_frames("SYNC 1", frames, count);
+
+    // RPDO1 with event driven transmission is applied as soon as it arrives 
+    rpdo.can_id  = DEVICE_OD_VAR_1400_01 & CAN_SFF_MASK;
+    rpdo.len     = 2U;
+    rpdo.data[0] = 0x12U;
+    rpdo.data[1] = 0x34U;
+    SOMETHING_WENT_WRONG(canopen_pdo_receive(&engine, &rpdo, 1U) == 1U);
+    SOMETHING_WENT_WRONG((DEVICE_OD_VAR_6200_01 == 0x12U) && (DEVICE_OD_VAR_6200_02 == 0x34U));
+    printf("RPDO %03X -> 6200: %02X %02X\n", rpdo.can_id, DEVICE_OD_VAR_6200_01, DEVICE_OD_VAR_6200_02);
+
+    // remapping while running, the next SYNC already uses the new plan 
+    SOMETHING_WENT_WRONG(canopen_pdo_set_mapping(&engine, tpdo1, remap, 2U));
+    SOMETHING_WENT_WRONG(canopen_pdo_set_mapping(&engine, tpdo1, invalid, 1U) == false);
+
+    count = canopen_pdo_build_sync(&engine, frames, 8U);
+    print_frames("SYNC 2 (TPDO1 remapped)", frames, count);
+    printf("%llu syncs, %llu RPDOs, %llu remaps\n", engine.syncs, engine.rpdos_applied, engine.remaps);
+
+    canopen_pdo_destruct(&engine);
+
+    return 0; 
+}
@@ -0,0 +1,114 @@
+#include <pthread.h>
+#include <stdio.h> 
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "capture.h"
+
+#define NUM_BUSES      4U
+#define RING_SIZE      4096U
+
+#define SOMETHING_WENT_WRONG(__X) do {  if( (__X) == false )  { printf("Something is Wrong!!\n"); return 1;} } while (0)     
+
+struct bus_sim_t
+{
+    frame_ring    ring;
+    can_frame_rec storage[RING_SIZE];
+    u8            bus;
+    u32           frames;
+};
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+}
+
+// produces saturated CAN FD traffic on one simulated bus 
+static void* bus_producer(void* arg)
+{
+    struct bus_sim_t* const sim = (struct bus_sim_t*) arg;
+    u32 sent = 0U;
+
+    while (sent < sim->frames)
+    {
+        can_frame_rec* slots;
+        u32 n = frame_ring_reserve(&sim->ring, &slots, 64U);
+        u64 const ts = now_ns();
+
+        n = GET_MIN(n, sim->frames - sent);
+        for (u32 i = 0U; i < n; ++i)
+        {
+            u32 const seq = sent + i;
+            slots[i].timestamp_ns = ts;
+            slots[i].can_id = ((seq % 8U) == 0U) ? (CAN_EFF_FLAG | (0x18FEF100U + sim->bus)) : (0x100U + (seq % 32U));
+            if ((seq % 50000U) == 1U)
+            {
+                slots[i].can_id = 0x7DFU;   /* rare diagnostic request */
+            }
+            slots[i].len    = 64U;
+            slots[i].flags  = CAN_FRAME_FLAG_FD | CAN_FRAME_FLAG_BRS;
+            slots[i].bus    = sim->bus;
+            memset(slots[i].data, (u8) seq, 64U);
+        }
+        frame_ring_commit(&sim->ring, n);
+        sent += n;
+    }
+
+    return NULLPTR;
+}
+
+// usage: main_capture <directory> [frames per bus]
+int main(int argc, char** argv) 
+{ 
+    static struct bus_sim_t sims[NUM_BUSES];
+    pthread_t       threads[NUM_BUSES];
+    capture         writer;
+    capture_stats   stats;
+    capture_config  config = { 0 };
+    u32 const       frames = (argc > 2) ? (u32) strtoul(argv[2], NULLPTR, 0) : 1000000U;
+    u64             start;
+    u64             elapsed;
+
+    config.directory    = (argc > 1) ? argv[1] : ".";
+    config.prefix       = "bus";
+    config.segment_size = 64ULL * 1024ULL * 1024ULL;
+
+    SOMETHING_WENT_WRONG(capture_init(&writer, 5U, &config));
+
+    for (u8 b = 0U; b < NUM_BUSES; ++b)
+    {
+        sims[b].bus    = b;
+        sims[b].frames = frames;
+        SOMETHING_WENT_WRONG(frame_ring_init(&sims[b].ring, 10U + b, sims[b].storage, RING_SIZE));
+        SOMETHING_WENT_WRONG(capture_add_ring(&writer, &sims[b].ring));
+    }
+
+    start = now_ns();
+    SOMETHING_WENT_WRONG(capture_start(&writer));
+    for (u8 b = 0U; b < NUM_BUSES; ++b)
+    {
+        pthread_create(&threads[b], NULLPTR, bus_producer, &sims[b]);
+    }
+    for (u8 b = 0U; b < NUM_BUSES; ++b)
+    {
+        pthread_join(threads[b], NULLPTR);
+    }
+    capture_stop(&writer);
+    elapsed = now_ns() - start;
+
+    capture_get_stats(&writer, &stats);
+    printf("frames %llu, bytes %llu, blocks %llu, segments %llu, errors %llu\n", 
+           stats.frames, stats.bytes, stats.blocks, stats.segments, stats.errors);
+    printf("%.0f frames/s, %.1f bytes/frame\n", (f64) stats.frames * 1e9 / (f64) elapsed, 
+           (f64) stats.bytes / (f64) GET_MAX(stats.frames, 1U));
+
+    capture_destruct(&writer);
+
+    return 0; 
+}
@@ -0,0 +1,120 @@
+#include <pthread.h>
+#include <stdio.h> 
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_cache.h"
+
+#define CACHE_PATH      "/dev/shm/can4linux_frame_cache_ex"
+#define STD_IDS         512U
+#define EXT_IDS         256U
+#define RUN_NS          500000000ULL
+
+#define SOMETHING_WENT_WRONG(__X) do {  if( (__X) == false )  { printf("Something is Wrong!!\n"); return 1;} } while (0)     
+
+struct reader_stats_t
+{
+    u64 visits;
+    u64 torn;
+};
+
+static volatile u32 stop = 0U;
+
+static u64 now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+}
+
+// the RX thread: every frame carries its own sequence in all 8 bytes; a few ids 
+// repeat the same payload and must not show up as changed 
+static void* rx_thread(void* arg)
+{
+    frame_cache* const cache = (frame_cache*) arg;
+    can_frame_rec frames[64];
+    u64 seq = 0U;
+
+    memset(frames, 0, sizeof(frames));
+
+    while (stop == 0U)
+    {
+        for (u32 i = 0U; i < 64U; ++i, ++seq)
+        {
+            u32 const n = (u32) (seq % (STD_IDS + EXT_IDS));
+            u8 const value = (n < 16U) ? 0x55U : (u8) (seq >> 10U);
+
+            frames[i].timestamp_ns = now_ns();
+            frames[i].can_id = (n < STD_IDS) ? n : ((0x18FF0000U + n) | CAN_EFF_FLAG);
+            frames[i].len    = 8U;
+            memset(frames[i].data, value, 8U);
+        }
+        frame_cache_update_batch(cache, frames, 64U);
+    }
+
+    return NULLPTR;
+}
+
+static void check_frame(void* const ctx, can_frame_rec const * const frame, u64 changes)
+{
+    struct reader_stats_t* const stats = (struct reader_stats_t*) ctx;
+
+    (void) changes;
+    stats->visits++;
+    for (u32 k = 1U; k < frame->len; ++k)
+    {
+        if (frame->data[k] != frame->data[0])
+        {
+            stats->torn++;
+            return;
+        }
+    }
+}
+
+int main(void) 
+{ 
+    static frame_cache writer;
+    static frame_cache reader;
+    frame_cache_cursor cursor;
+    struct reader_stats_t stats = { 0 };
+    can_frame_rec frame;
+    pthread_t thread;
+    u64 changes = 0U;
+    u64 polls = 0U;
+    u64 start;
+
+    SOMETHING_WENT_WRONG(frame_cache_open(&writer, 0U, CACHE_PATH, 0U));
+    SOMETHING_WENT_WRONG(pthread_create(&thread, NULLPTR, rx_thread, &writer) == 0);
+
+    // a reader of its own mapping, as another process would have it 
+    SOMETHING_WENT_WRONG(frame_cache_open_read_only(&reader, CACHE_PATH));
+    SOMETHING_WENT_WRONG(frame_cache_cursor_init(&reader, &cursor));
+
+    start = now_ns();
+    while ((now_ns() - start) < RUN_NS)
+    {
+        frame_cache_poll(&reader, &cursor, check_frame, &stats);
+        polls++;
+    }
+
+    stop = 1U;
+    pthread_join(thread, NULLPTR);
+
+    SOMETHING_WENT_WRONG(frame_cache_read(&reader, 0x005U, &frame, &changes));
+    printf("0x005: payload %02X, changed %llu times\n", frame.data[0], changes);
+    SOMETHING_WENT_WRONG(frame_cache_read(&reader, (0x18FF0000U + STD_IDS) | CAN_EFF_FLAG, &frame, &changes));
+    printf("0x%08X: payload %02X, changed %llu times\n", frame.can_id & CAN_EFF_MASK, frame.data[0], changes);
+    SOMETHING_WENT_WRONG(frame_cache_read(&reader, 0x7FFU, &frame, NULLPTR) == false);
+
+    printf("%llu updates, %llu polls, %llu changed ids visited, %llu torn\n", reader.file->updates, polls, stats.visits, stats.torn);
+
+    frame_cache_cursor_destruct(&cursor);
+    frame_cache_close(&reader);
+    frame_cache_close(&writer);
+    remove(CACHE_PATH);
+
+    return (stats.torn == 0U) ? 0 : 1; 
+}
@@ -0,0 +1,59 @@
+#include <stdio.h> 
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "log_history.h"
+#include "event_logger.h"
+
+#define SOMETHING_WENT_WRONG(__X) do {  if( (__X) == false )  { printf("Something is Wrong!!\n"); return 1;} } while (0)     
+
+static void print_record(void* const ctx, log_history_record const * const record)
+{
+    (void) ctx;
+    printf("%llu %llu.%09llu lvl=%x mod=%u %s\n", record->seq, 
+           record->timestamp_ns / 1000000000ULL, record->timestamp_ns % 1000000000ULL,
+           record->level, record->module_id, record->msg);
+}
+
+// usage: main_log_history <file> write <count> | dump 
+int main(int argc, char** argv) 
+{ 
+    log_history  history; 
+    event_logger logger; 
+
+    if (argc < 3)
+    {
+        printf("usage: %s <file> write <count> | dump\n", argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[2], "write") == 0)
+    {
+        u32 count = (argc > 3) ? (u32) strtoul(argv[3], NULLPTR, 0) : 1000U;
+
+        SOMETHING_WENT_WRONG(log_history_open(&history, 3U, argv[1], 1024U * 1024U, 0U));
+        printf("recovered head %llu, oldest %llu\n", log_history_newest_seq(&history), log_history_oldest_seq(&history));
+
+        event_logger_init(&logger, 4U, LOG_EVENT_FATAL);
+        event_logger_set_history(&logger, &history, LOG_EVENT_ALL);
+
+        for (u32 i = 0U; i < count; ++i)
+        {
+            event_logger_log(&logger, LOG_EVENT_INFO, "event %u of %u", i, count);
+        }
+
+        // survives a crash from here without any sync, only needed for power loss
+        SOMETHING_WENT_WRONG(log_history_sync(&history, false));
+        log_history_close(&history);
+        return 0;
+    }
+
+    // offline reading, the file is never touched
+    SOMETHING_WENT_WRONG(log_history_open_read_only(&history, argv[1]));
+    printf("records %llu .. %llu\n", log_history_oldest_seq(&history), log_history_newest_seq(&history));
+    log_history_for_each(&history, 0U, print_record, NULLPTR);
+    log_history_close(&history);
+
+    return 0; 
+}
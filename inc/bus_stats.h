@@ -0,0 +1,265 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Incremental bus statistics of one bus, updated by the RX thread batch by batch: bus 
+// load with the exact dynamic stuff bits of every frame, frame rates, the DLC 
+// distribution and per id the inter-arrival period with its jitter. Per id state sits 
+// in a dense table for 11 bit ids and a fixed hash for 29 bit ids, nothing is allocated 
+// or locked on the hot path.
+//
+// Every interval the RX thread turns the counters into a snapshot. Snapshots are double 
+// buffered in a memory mapped file (on /dev/shm for other processes): the new one is 
+// written into the buffer readers do not use and then published, each buffer has a 
+// seqlock so a reader that was too slow retries instead of seeing a mix.
+//
+//   [header page][buffer 0: snapshot header, ids][buffer 1: snapshot header, ids]
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define BUS_STATS_STD_IDS               2048U
+#define BUS_STATS_MIN_EXT_SLOTS         64U
+#define BUS_STATS_MAX_EXT_SLOTS         16384U
+#define BUS_STATS_DEFAULT_EXT_SLOTS     1024U
+#define BUS_STATS_DEFAULT_INTERVAL_NS   1000000000ULL
+#define BUS_STATS_DLC_COUNT             16U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __BUS_STATS_H_
+    #define BUS_STATS_MODULE_NAME       "BUS_STATS"
+    #define BUS_STATS_MAGIC             "C4LBSTA1"
+    #define BUS_STATS_VERSION           1U
+    #define BUS_STATS_HEADER_SIZE       4096U
+    #define BUS_STATS_KEY_FREE          0xFFFFFFFFU
+    #define BUS_STATS_IS_POWER_OF_TWO(__X)      (((__X) != 0U) && (((__X) & ((__X) - 1U)) == 0U))
+
+    // stuff state: last bit << 3 | length of its run (0..4) 
+    #define BUS_STATS_STUFF_STATES      16U
+    #define BUS_STATS_STUFF_IDLE        0x08U   /* recessive bus before SOF */
+
+    // fields after the CRC delimiter: ACK slot and delimiter, EOF, IFS 
+    #define BUS_STATS_TAIL_BITS         12U
+
+    // classic CRC is not computed, its field is charged the mean stuff bits of 15 random bits 
+    #define BUS_STATS_CRC15_STUFF       1U
+#endif /*  __BUS_STATS_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+// live counters of one id, owned by the RX thread 
+struct bus_stats_entry_t
+{
+    u64 frames_total;
+    u64 last_ns;
+    s64 dev_sum;            /* of period - period_ref in this interval */
+    f64 dev_sq;
+    u32 frames;             /* in this interval */
+    u32 periods;
+    u32 period_min;         /* ns, saturated */
+    u32 period_max;
+    u32 period_ref;         /* mean of the last interval, keeps the sums small */
+    u32 can_id;
+    u8  dlc;
+    u8  reserved[7];
+};
+
+typedef struct bus_stats_entry_t bus_stats_entry;
+
+_Static_assert(sizeof(bus_stats_entry) == 64U, "bus_stats_entry must fill one cache line");
+
+// bus part of a snapshot 
+struct bus_stats_bus_t
+{
+    u64 start_ns;
+    u64 end_ns;
+    u64 frames;             /* in the interval */
+    u64 frames_total;
+    u64 error_frames;
+    u64 dropped_ids;        /* 29 bit ids without a slot, total */
+    u64 bits;               /* on the wire in the interval, stuff bits included */
+    f64 load;               /* 0..1 */
+    f64 frame_rate;         /* per s */
+    u64 dlc[BUS_STATS_DLC_COUNT];
+};
+
+typedef struct bus_stats_bus_t bus_stats_bus;
+
+// id part of a snapshot 
+struct bus_stats_id_t
+{
+    u32 can_id;             /* kernel layout */
+    u32 frames;             /* in the interval */
+    u64 frames_total;
+    u64 last_ns;
+    f64 rate;               /* frames per s */
+    f64 period_mean_ns;
+    f64 jitter_ns;          /* standard deviation of the period */
+    u32 period_min_ns;
+    u32 period_max_ns;
+    u8  dlc;                /* of the last frame */
+    u8  reserved[7];
+};
+
+typedef struct bus_stats_id_t bus_stats_id;
+
+_Static_assert(sizeof(bus_stats_id) == 64U, "bus_stats_id must fill one cache line");
+
+struct bus_stats_buffer_t
+{
+    u32             seq;            /* odd while written */
+    u32             id_count;
+    u64             snapshot;       /* number of the snapshot */
+    bus_stats_bus   bus;
+    bus_stats_id    ids[];
+};
+
+typedef struct bus_stats_buffer_t bus_stats_buffer;
+
+struct bus_stats_file_t
+{
+    char magic[8];
+    u32  version;
+    u32  max_ids;
+    u32  nominal_bitrate;
+    u32  data_bitrate;
+    u64  interval_ns;
+    u64  buffer_size;
+    u32  published;         /* buffer readers use */
+    u32  reserved;
+};
+
+typedef struct bus_stats_file_t bus_stats_file;
+
+struct bus_stats_t
+{
+    int                 fd;
+    __boolean           read_only;
+    bus_stats_file*     file;
+    bus_stats_buffer*   buffers[2];
+    u64                 map_size;
+
+    // live state, RX thread only 
+    bus_stats_entry*    entries;        /* 11 bit ids, then the 29 bit hash slots */
+    u32*                ext_keys;
+    u32                 ext_mask;
+    u32                 ext_count;
+    u32*                active;         /* entries seen, in order of appearance */
+    u32                 active_count;
+    u32                 max_ids;
+
+    u64                 interval_start;
+    u64                 next_snapshot;
+    u64                 snapshots;
+    u64                 frames;
+    u64                 frames_total;
+    u64                 error_frames;
+    u64                 dropped_ids;    /* 29 bit ids that found the hash full */
+    u64                 nominal_bits;
+    u64                 data_bits;
+    u64                 dlc[BUS_STATS_DLC_COUNT];
+    u8                  module_position;
+};
+
+typedef struct bus_stats_t bus_stats; 
+
+#ifdef __BUS_STATS_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean bus_stats_init(bus_stats* const me, u8 __id, char const * const path, u32 nominal_bitrate, u32 data_bitrate, u32 ext_slots, u64 interval_ns);
+__boolean bus_stats_open_read_only(bus_stats* const me, char const * const path);
+void bus_stats_destruct(bus_stats* const me);
+
+void bus_stats_update(bus_stats* const me, can_frame_rec const * const frame);
+void bus_stats_update_batch(bus_stats* const me, can_frame_rec const * const frames, u32 count);
+void bus_stats_snapshot(bus_stats* const me, u64 now_ns);
+
+u32 bus_stats_read(bus_stats const * const me, bus_stats_bus* const bus, bus_stats_id* const ids, u32 max);
+u32 bus_stats_frame_bits(can_frame_rec const * const frame, u32* const data_phase_bits);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static void bus_stats_build_stuff_table(void);
+static inline u32 bus_stats_stuff(u8* const state, u64 bits, u32 count);
+static inline u32 bus_stats_stuff_bytes(u8* const state, u8 const * const data, u32 len);
+static inline void bus_stats_account(bus_stats* const me, can_frame_rec const * const frame);
+static u32 bus_stats_slot(bus_stats* const me, u32 can_id);
+static u64 bus_stats_buffer_size(u32 max_ids);
+
+#else 
+
+extern __boolean bus_stats_init(bus_stats* const me, u8 __id, char const * const path, u32 nominal_bitrate, u32 data_bitrate, u32 ext_slots, u64 interval_ns);
+extern __boolean bus_stats_open_read_only(bus_stats* const me, char const * const path);
+extern void bus_stats_destruct(bus_stats* const me);
+
+extern void bus_stats_update(bus_stats* const me, can_frame_rec const * const frame);
+extern void bus_stats_update_batch(bus_stats* const me, can_frame_rec const * const frames, u32 count);
+extern void bus_stats_snapshot(bus_stats* const me, u64 now_ns);
+
+extern u32 bus_stats_read(bus_stats const * const me, bus_stats_bus* const bus, bus_stats_id* const ids, u32 max);
+extern u32 bus_stats_frame_bits(can_frame_rec const * const frame, u32* const data_phase_bits);
+
+#endif /* __BUS_STATS_H_ */
+
+
+
+
+#ifdef __BUS_STATS_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- VARIABLES   
+*****************************************************************************************
+****************************************************************************************/
+
+// next state << 8 | stuff bits for every state and byte, MSB first. The partial table 
+// takes fields of n < 8 bits at index 1 << n | bits. 
+static u16 bus_stats_stuff_table[BUS_STATS_STUFF_STATES][256];
+static u16 bus_stats_stuff_partial[BUS_STATS_STUFF_STATES][256];
+static u8 bus_stats_stuff_ready = 0U;
+
+#endif /* __BUS_STATS_H_ */
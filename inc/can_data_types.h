@@ -0,0 +1,145 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef __CAN_DATA_TYPES_H_
+#define __CAN_DATA_TYPES_H_
+
+#include <linux/can.h>
+#include "utils.h"
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define CAN_FRAME_MAX_DATA      64U
+#define CAN_FRAME_MAX_BUSES     32U
+
+// same values as the kernel uses in canfd_frame.flags 
+#define CAN_FRAME_FLAG_BRS      0x01U
+#define CAN_FRAME_FLAG_ESI      0x02U
+#define CAN_FRAME_FLAG_FD       0x04U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+#define CAN_FRAME_IS_EXT(__ID)      (((__ID) & CAN_EFF_FLAG) != 0U)
+#define CAN_FRAME_IS_RTR(__ID)      (((__ID) & CAN_RTR_FLAG) != 0U)
+#define CAN_FRAME_IS_ERR(__ID)      (((__ID) & CAN_ERR_FLAG) != 0U)
+#define CAN_FRAME_ID(__ID)          (CAN_FRAME_IS_EXT(__ID) ? ((__ID) & CAN_EFF_MASK) : ((__ID) & CAN_SFF_MASK))
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+// One received or to be sent frame. Everything behind the timestamp has the layout of 
+// struct canfd_frame, so sockets read into and write from a record without copying, 
+// the kernel leaves __res0 (bus) untouched on send and zero on receive.
+struct can_frame_rec_t
+{
+    u64 timestamp_ns;
+    u32 can_id;             /* kernel layout, CAN_EFF_FLAG/CAN_RTR_FLAG/CAN_ERR_FLAG */
+    u8  len;                /* payload length in bytes, not the dlc */
+    u8  flags;              /* CAN_FRAME_FLAG_xxx */
+    u8  bus;                /* index of the bus the frame belongs to */
+    u8  reserved;
+    u8  data[CAN_FRAME_MAX_DATA] __attribute__ ((aligned(8)));
+};
+
+typedef struct can_frame_rec_t can_frame_rec;
+
+typedef struct can_frame_rec_t* can_frame_rec_ptr;
+
+_Static_assert(sizeof(can_frame_rec) == (8U + sizeof(struct canfd_frame)), "can_frame_rec must wrap canfd_frame");
+_Static_assert(__builtin_offsetof(can_frame_rec, data) == (8U + __builtin_offsetof(struct canfd_frame, data)), 
+               "can_frame_rec payload must match canfd_frame");
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- INLINE UTILS FUNCS 
+*****************************************************************************************
+****************************************************************************************/
+
+/**
+ * @name    static inline struct canfd_frame* can_frame_rec_kernel(can_frame_rec* const rec)
+ * 
+ * @brief   view of a record as kernel frame, for read/write/sendmmsg/recvmmsg
+ * 
+ * @param   can_frame_rec* const : record
+ * 
+ * @return  struct canfd_frame* : same memory seen as kernel frame.
+ */
+static inline struct canfd_frame* can_frame_rec_kernel(can_frame_rec* const rec)
+{
+    return (struct canfd_frame*) &rec->can_id;
+}
+
+
+/**
+ * @name    static inline u8 can_frame_len_to_dlc(u8 len)
+ * 
+ * @brief   smallest dlc that can carry len bytes 
+ * 
+ * @param   u8 : payload length
+ * 
+ * @return  u8 : data length code 0..15.
+ */
+static inline u8 can_frame_len_to_dlc(u8 len)
+{
+    static u8 const dlc[65U] = 
+    {
+        0,  1,  2,  3,  4,  5,  6,  7,  8,                              /* 0 - 8 */
+        9,  9,  9,  9,                                                  /* 9 - 12 */
+        10, 10, 10, 10,                                                 /* 13 - 16 */
+        11, 11, 11, 11,                                                 /* 17 - 20 */
+        12, 12, 12, 12,                                                 /* 21 - 24 */
+        13, 13, 13, 13, 13, 13, 13, 13,                                 /* 25 - 32 */
+        14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, /* 33 - 48 */
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15  /* 49 - 64 */
+    };
+    return dlc[GET_MIN(len, CAN_FRAME_MAX_DATA)];
+}
+
+
+/**
+ * @name    static inline u8 can_frame_dlc_to_len(u8 dlc)
+ * 
+ * @brief   payload length of a CAN FD data length code
+ * 
+ * @param   u8 : data length code 
+ * 
+ * @return  u8 : payload length in bytes.
+ */
+static inline u8 can_frame_dlc_to_len(u8 dlc)
+{
+    static u8 const len[16U] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+    return len[dlc & 0x0FU];
+}
+
+
+#endif /* __CAN_DATA_TYPES_H_ */
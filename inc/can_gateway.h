@@ -0,0 +1,243 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Frame gateway between SocketCAN buses, a user space cangw. Rules match an id under a 
+// mask on one bus and forward the frame to another one, optionally with a new id, 
+// modified payload bytes and a rate limit.
+//
+// Rules are compiled into one can_id_table per source bus that maps a frame id to the 
+// list of its routes, so a frame costs one lookup no matter how many rules exist. 11 bit 
+// masks are expanded over all ids at compile time, 29 bit ids under a partial mask are 
+// resolved on their first frame and remembered in the table.
+//
+// Frames are forwarded from the slots of the RX ring: the TX batch of a bus is a list 
+// of pointers into the rings (can_socket_send_ptrs()), a rewrite is done in place when 
+// the frame has only that one route and on a copy otherwise. The ring slots are released 
+// after the TX batches are flushed.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define CAN_GATEWAY_MAX_BUSES           8U
+#define CAN_GATEWAY_MAX_MODS            8U
+#define CAN_GATEWAY_BATCH               CAN_SOCKET_MAX_BATCH
+#define CAN_GATEWAY_RING_SIZE           1024U
+#define CAN_GATEWAY_LATENCY_BUCKETS     32U             /* bucket b: latency < 2^b ns */
+#define CAN_GATEWAY_NONE                0xFFFFFFFFU
+
+// payload modifications, data[index] = data[index] op value 
+#define CAN_GATEWAY_OP_SET              1U
+#define CAN_GATEWAY_OP_AND              2U
+#define CAN_GATEWAY_OP_OR               3U
+#define CAN_GATEWAY_OP_XOR              4U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __CAN_GATEWAY_H_
+    #define CAN_GATEWAY_MODULE_NAME     "CAN_GATEWAY"
+    #define CAN_GATEWAY_MAX_LEARNED     8192U           /* 29 bit ids resolved per bus */
+    #define CAN_GATEWAY_MIN_LISTS       1024U
+#endif /*  __CAN_GATEWAY_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct can_gateway_mod_t
+{
+    u8  op;                     /* CAN_GATEWAY_OP_xxx */
+    u8  index;                  /* payload byte, ignored by shorter frames */
+    u8  value;
+};
+
+typedef struct can_gateway_mod_t can_gateway_mod;
+
+// a frame of src_bus matches if (frame id ^ can_id) & mask == 0 and both have the same 
+// CAN_EFF_FLAG, RTR frames go the way of their id. The new id is 
+// (id & ~rewrite_mask) | (rewrite_id & rewrite_mask) in kernel layout, so a rewrite mask 
+// with CAN_EFF_FLAG may also change the format; rewrite_mask 0 keeps the id.
+struct can_gateway_rule_t
+{
+    u8              src_bus;
+    u8              dst_bus;
+    u32             can_id;
+    u32             mask;
+    u32             rewrite_id;
+    u32             rewrite_mask;
+    can_gateway_mod mods[CAN_GATEWAY_MAX_MODS];
+    u8              mod_count;
+    u32             rate;       /* frames per second, 0 for no limit */
+    u32             burst;      /* frames above the rate that may pass at once */
+};
+
+typedef struct can_gateway_rule_t can_gateway_rule;
+
+struct can_gateway_route_stats_t
+{
+    u64 matched;
+    u64 forwarded;
+    u64 rate_limited;
+    u64 tx_dropped;             /* not accepted by the output */
+    u64 latency_sum_ns;         /* receive timestamp to hand over to the output */
+    u64 latency_max_ns;
+    u64 latency[CAN_GATEWAY_LATENCY_BUCKETS];
+};
+
+typedef struct can_gateway_route_stats_t can_gateway_route_stats;
+
+struct can_gateway_route_t
+{
+    can_gateway_rule        rule;
+    __boolean               active;
+    __boolean               rewrites;       /* id or payload change */
+    u64                     interval_ns;    /* rate limit as GCRA */
+    u64                     tolerance_ns;
+    u64                     tat_ns;         /* theoretical arrival time */
+    can_gateway_route_stats stats;
+};
+
+typedef struct can_gateway_route_t can_gateway_route;
+
+// frames to be sent instead of the socket of the bus, returns how many were taken 
+typedef u32 (*can_gateway_output_callback)(void* ctx, can_frame_rec* const * frames, u32 count);
+
+struct can_gateway_bus_t
+{
+    can_socket*                 socket;
+    frame_ring*                 ring;           /* RX ring, the gateway is its consumer */
+    frame_ring                  own_ring;       /* filled from the socket by the gateway */
+    can_frame_rec*              storage;        /* of own_ring, NULLPTR for a ring of the caller */
+    can_gateway_output_callback output;
+    void*                       output_ctx;
+
+    can_id_table                dispatch;       /* frame id -> offset of a route list */
+    u32*                        wildcards;      /* 29 bit routes with a partial mask */
+    u32                         wildcard_count;
+    u32                         learned;
+
+    can_frame_rec*              tx[CAN_GATEWAY_BATCH];
+    u32                         tx_route[CAN_GATEWAY_BATCH];
+    u32                         tx_count;
+    can_frame_rec*              copies;         /* CAN_GATEWAY_BATCH rewritten frames */
+    u32                         copy_count;
+
+    u64                         rx_frames;
+    u64                         unrouted;
+    u64                         tx_frames;
+    u64                         tx_dropped;
+};
+
+typedef struct can_gateway_bus_t can_gateway_bus;
+
+struct can_gateway_t
+{
+    can_gateway_bus     buses[CAN_GATEWAY_MAX_BUSES];
+    u32                 bus_count;
+    can_gateway_route*  routes;
+    u32                 route_count;
+    u32                 max_routes;
+
+    // route lists: count followed by the route indexes, offset 0 is the empty list 
+    u32*                lists;
+    u32                 list_size;
+    u32                 list_capacity;
+    u32*                scan;           /* list of an id that could not be remembered */
+    __boolean           compiled;
+    u8                  id;             /* module id of the tables and rings of the buses */
+    u8                  module_position;
+};
+
+typedef struct can_gateway_t can_gateway; 
+
+#ifdef __CAN_GATEWAY_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean can_gateway_init(can_gateway* const me, u8 __id, u32 max_routes);
+void can_gateway_destruct(can_gateway* const me);
+
+u32 can_gateway_add_bus(can_gateway* const me, can_socket* const socket, frame_ring* const ring);
+void can_gateway_set_output(can_gateway* const me, u32 bus, can_gateway_output_callback output, void* ctx);
+
+u32 can_gateway_add_rule(can_gateway* const me, can_gateway_rule const * const rule);
+__boolean can_gateway_remove_rule(can_gateway* const me, u32 route);
+__boolean can_gateway_compile(can_gateway* const me);
+
+u32 can_gateway_receive(can_gateway* const me, u32 bus);
+u32 can_gateway_forward(can_gateway* const me, u32 bus);
+u32 can_gateway_process(can_gateway* const me, s32 timeout_ms);
+
+void can_gateway_get_route_stats(can_gateway const * const me, u32 route, can_gateway_route_stats* const stats);
+u64 can_gateway_latency_percentile(can_gateway_route_stats const * const stats, f64 percentile);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static __boolean can_gateway_matches(can_gateway_rule const * const rule, u32 can_id);
+static u32 can_gateway_build_list(can_gateway* const me, u32 bus, u32 can_id, u32* const list);
+static u32 can_gateway_store_list(can_gateway* const me, u32 const * const list, u32 previous);
+static u32 const * can_gateway_resolve(can_gateway* const me, u32 bus, u32 can_id);
+static void can_gateway_rewrite(can_gateway_rule const * const rule, can_frame_rec* const frame);
+static __boolean can_gateway_admit(can_gateway_route* const route, u64 timestamp_ns);
+static void can_gateway_flush(can_gateway* const me, u32 bus);
+
+#else 
+
+extern __boolean can_gateway_init(can_gateway* const me, u8 __id, u32 max_routes);
+extern void can_gateway_destruct(can_gateway* const me);
+
+extern u32 can_gateway_add_bus(can_gateway* const me, can_socket* const socket, frame_ring* const ring);
+extern void can_gateway_set_output(can_gateway* const me, u32 bus, can_gateway_output_callback output, void* ctx);
+
+extern u32 can_gateway_add_rule(can_gateway* const me, can_gateway_rule const * const rule);
+extern __boolean can_gateway_remove_rule(can_gateway* const me, u32 route);
+extern __boolean can_gateway_compile(can_gateway* const me);
+
+extern u32 can_gateway_receive(can_gateway* const me, u32 bus);
+extern u32 can_gateway_forward(can_gateway* const me, u32 bus);
+extern u32 can_gateway_process(can_gateway* const me, s32 timeout_ms);
+
+extern void can_gateway_get_route_stats(can_gateway const * const me, u32 route, can_gateway_route_stats* const stats);
+extern u64 can_gateway_latency_percentile(can_gateway_route_stats const * const stats, f64 percentile);
+
+#endif /* __CAN_GATEWAY_H_ */
@@ -0,0 +1,172 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// O(1) lookup from a CAN id to a small value (an index into the caller's own tables). 
+// 11 bit ids index a dense array directly, 29 bit ids go through an open addressing 
+// hash with linear probing that stays at most half full. Lookups never allocate and 
+// never lock, building the table is left to a single writer.
+
+#ifndef __CAN_ID_TABLE_TYPES_H_
+#define __CAN_ID_TABLE_TYPES_H_
+
+#include "can_data_types.h"
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define CAN_ID_TABLE_STD_SIZE       2048U
+#define CAN_ID_TABLE_NONE           0xFFFFFFFFU     /* no value, also marks free hash slots */
+#define CAN_ID_TABLE_MIN_EXT        16U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct can_id_table_t
+{
+    u32     std[CAN_ID_TABLE_STD_SIZE];     /* value per 11 bit id */
+    u32*    ext_keys;                       /* 29 bit ids, CAN_ID_TABLE_NONE if free */
+    u32*    ext_values;
+    u32     ext_mask;                       /* slots - 1, slots is a power of two */
+    u32     ext_count;
+    u8      module_position;
+};
+
+typedef struct can_id_table_t can_id_table; 
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- INLINE FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+/**
+ * @name    static inline u32 can_id_table_hash(u32 id)
+ * 
+ * @brief   spreads sequential 29 bit ids over the slots 
+ * 
+ * @param   u32 : id without flags 
+ * 
+ * @return  u32 : hash.
+ */
+static inline u32 can_id_table_hash(u32 id)
+{
+    u32 const h = id * 0x9E3779B1U;
+
+    return h ^ (h >> 16U);
+}
+
+
+/**
+ * @name    static inline u32 can_id_table_lookup(can_id_table const * const me, u32 can_id)
+ * 
+ * @brief   value stored for an id, RTR and error flags are ignored 
+ * 
+ * @param   can_id_table const * const : table 
+ *          u32                        : id in kernel layout 
+ * 
+ * @return  u32 : value, CAN_ID_TABLE_NONE if the id is unknown.
+ */
+static inline u32 can_id_table_lookup(can_id_table const * const me, u32 can_id)
+{
+    u32 id;
+    u32 slot;
+
+    if (CAN_FRAME_IS_EXT(can_id) == false)
+    {
+        return me->std[can_id & CAN_SFF_MASK];
+    }
+
+    if (me->ext_count == 0U)
+    {
+        return CAN_ID_TABLE_NONE;
+    }
+
+    id   = can_id & CAN_EFF_MASK;
+    slot = can_id_table_hash(id) & me->ext_mask;
+    while (me->ext_keys[slot] != CAN_ID_TABLE_NONE)
+    {
+        if (me->ext_keys[slot] == id)
+        {
+            return me->ext_values[slot];
+        }
+        slot = (slot + 1U) & me->ext_mask;
+    }
+
+    return CAN_ID_TABLE_NONE;
+}
+
+#endif /* __CAN_ID_TABLE_TYPES_H_ */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __CAN_ID_TABLE_H_
+    #define CAN_ID_TABLE_MODULE_NAME    "CAN_ID_TABLE"
+#endif /*  __CAN_ID_TABLE_H_   */
+
+#ifdef __CAN_ID_TABLE_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean can_id_table_init(can_id_table* const me, u8 __id, u32 ext_capacity);
+void can_id_table_destruct(can_id_table* const me);
+void can_id_table_clear(can_id_table* const me);
+
+__boolean can_id_table_insert(can_id_table* const me, u32 can_id, u32 value);
+__boolean can_id_table_remove(can_id_table* const me, u32 can_id);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static __boolean can_id_table_grow(can_id_table* const me, u32 slots);
+
+#else 
+
+extern __boolean can_id_table_init(can_id_table* const me, u8 __id, u32 ext_capacity);
+extern void can_id_table_destruct(can_id_table* const me);
+extern void can_id_table_clear(can_id_table* const me);
+
+extern __boolean can_id_table_insert(can_id_table* const me, u32 can_id, u32 value);
+extern __boolean can_id_table_remove(can_id_table* const me, u32 can_id);
+
+#endif /* __CAN_ID_TABLE_H_ */
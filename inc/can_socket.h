@@ -0,0 +1,117 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Raw SocketCAN access on top of can_frame_rec. Frames are sent and received in batches
+// with sendmmsg/recvmmsg, straight from/into the records (no intermediate frame copy).
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define CAN_SOCKET_MAX_BATCH        64U
+#define CAN_SOCKET_IFNAME_SIZE      16U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __CAN_SOCKET_H_
+    #define CAN_SOCKET_MODULE_NAME  "CAN_SOCKET"
+    #define CAN_SOCKET_TX_RETRIES   100U
+    #define CAN_SOCKET_TX_BACKOFF_NS 50000L
+#endif /*  __CAN_SOCKET_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct can_socket_t
+{
+    int     fd;
+    int     ifindex;
+    char    ifname[CAN_SOCKET_IFNAME_SIZE];
+    u8      bus;                /* stored into every received frame */
+    u8      fd_enabled;
+    u8      module_position;
+
+    u64     rx_frames;
+    u64     tx_frames;
+    u64     tx_errors;
+};
+
+typedef struct can_socket_t can_socket; 
+
+typedef struct can_socket_t* can_socket_ptr; 
+
+#ifdef __CAN_SOCKET_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean can_socket_open(can_socket* const me, u8 __id, char const * const ifname, u8 bus, __boolean enable_fd);
+void can_socket_close(can_socket* const me);
+
+__boolean can_socket_set_nonblocking(can_socket* const me, __boolean nonblocking);
+__boolean can_socket_set_filters(can_socket* const me, struct can_filter const * const filters, u32 count);
+__boolean can_socket_set_buffers(can_socket* const me, u32 rx_bytes, u32 tx_bytes);
+
+u32 can_socket_send_batch(can_socket* const me, can_frame_rec* const frames, u32 count);
+u32 can_socket_send_ptrs(can_socket* const me, can_frame_rec* const * const frames, u32 count);
+u32 can_socket_recv_batch(can_socket* const me, can_frame_rec* const frames, u32 max);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static u32 can_socket_sendmmsg(can_socket* const me, struct mmsghdr* const msgs, u32 count);
+static inline u32 can_socket_mtu(can_frame_rec const * const frame);
+
+#else 
+
+extern __boolean can_socket_open(can_socket* const me, u8 __id, char const * const ifname, u8 bus, __boolean enable_fd);
+extern void can_socket_close(can_socket* const me);
+
+extern __boolean can_socket_set_nonblocking(can_socket* const me, __boolean nonblocking);
+extern __boolean can_socket_set_filters(can_socket* const me, struct can_filter const * const filters, u32 count);
+extern __boolean can_socket_set_buffers(can_socket* const me, u32 rx_bytes, u32 tx_bytes);
+
+extern u32 can_socket_send_batch(can_socket* const me, can_frame_rec* const frames, u32 count);
+extern u32 can_socket_send_ptrs(can_socket* const me, can_frame_rec* const * const frames, u32 count);
+extern u32 can_socket_recv_batch(can_socket* const me, can_frame_rec* const frames, u32 max);
+
+#endif /* __CAN_SOCKET_H_ */
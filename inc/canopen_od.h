@@ -0,0 +1,159 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Runtime side of generated CANopen object dictionaries. tools/canopen_od_gen.py turns a 
+// JSON description into const tables: the sorted (index << 8 | subindex) keys on their 
+// own for the search, the access metadata of every entry in a parallel array and the 
+// values in one generated struct. Entries known at compile time are reached through the 
+// generated position and variable macros without any search.
+
+#ifndef __CANOPEN_OD_TYPES_H_
+#define __CANOPEN_OD_TYPES_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+#define CANOPEN_OD_KEY(__INDEX, __SUB)      ((((u32) (__INDEX)) << 8U) | ((u32) (__SUB)))
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+// keys per cache line, the key array is padded to whole lines with CANOPEN_OD_KEY_PAD 
+#define CANOPEN_OD_LINE_KEYS                16U
+#define CANOPEN_OD_KEY_PAD                  0xFFFFFFFFU
+
+// data types, numbered as the static data types of CiA 301 
+#define CANOPEN_OD_BOOLEAN                  0x0001U
+#define CANOPEN_OD_INTEGER8                 0x0002U
+#define CANOPEN_OD_INTEGER16                0x0003U
+#define CANOPEN_OD_INTEGER32                0x0004U
+#define CANOPEN_OD_UNSIGNED8                0x0005U
+#define CANOPEN_OD_UNSIGNED16               0x0006U
+#define CANOPEN_OD_UNSIGNED32               0x0007U
+#define CANOPEN_OD_REAL32                   0x0008U
+#define CANOPEN_OD_VISIBLE_STRING           0x0009U
+#define CANOPEN_OD_OCTET_STRING             0x000AU
+#define CANOPEN_OD_DOMAIN                   0x000FU
+#define CANOPEN_OD_REAL64                   0x0011U
+#define CANOPEN_OD_INTEGER64                0x0015U
+#define CANOPEN_OD_UNSIGNED64               0x001BU
+
+// access flags 
+#define CANOPEN_OD_READ                     0x01U
+#define CANOPEN_OD_WRITE                    0x02U
+#define CANOPEN_OD_CONST                    0x04U
+#define CANOPEN_OD_TPDO                     0x10U   /* mappable into transmit PDOs */
+#define CANOPEN_OD_RPDO                     0x20U   /* mappable into receive PDOs */
+
+// SDO abort codes of CiA 301, 0 is success 
+#define CANOPEN_OD_OK                       0x00000000U
+#define CANOPEN_OD_ABORT_WRITE_ONLY         0x06010001U
+#define CANOPEN_OD_ABORT_READ_ONLY          0x06010002U
+#define CANOPEN_OD_ABORT_NO_OBJECT          0x06020000U
+#define CANOPEN_OD_ABORT_LENGTH             0x06070010U
+#define CANOPEN_OD_ABORT_LENGTH_HIGH        0x06070012U
+#define CANOPEN_OD_ABORT_LENGTH_LOW         0x06070013U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct canopen_od_entry_t
+{
+    u32 offset;             /* of the value in the data struct */
+    u16 index;
+    u8  sub;
+    u8  access;             /* CANOPEN_OD_READ | ... */
+    u16 type;               /* CANOPEN_OD_UNSIGNED8 ... */
+    u16 size;               /* bytes, fixed for every type */
+};
+
+typedef struct canopen_od_entry_t canopen_od_entry;
+
+struct canopen_od_t
+{
+    u32 const *                 keys;       /* sorted CANOPEN_OD_KEY() of all entries, padded */
+    u32 const *                 fences;     /* first key of every cache line of keys */
+    u32                         fence_count;
+    canopen_od_entry const *    entries;    /* same order as keys */
+    char const * const *        names;
+    u32                         count;
+    u8*                         data;       /* values, entries[].offset is relative to it */
+    u32                         data_size;
+};
+
+typedef struct canopen_od_t canopen_od; 
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- INLINE FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+/**
+ * @name    static inline void* canopen_od_value(canopen_od const * const me, canopen_od_entry const * const entry)
+ * 
+ * @brief   address of the value of an entry, no access check 
+ * 
+ * @param   canopen_od const * const       : dictionary 
+ *          canopen_od_entry const * const : entry of the dictionary
+ * 
+ * @return  void* : value.
+ */
+static inline void* canopen_od_value(canopen_od const * const me, canopen_od_entry const * const entry)
+{
+    return &me->data[entry->offset];
+}
+
+#endif /* __CANOPEN_OD_TYPES_H_ */
+
+#ifdef __CANOPEN_OD_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+canopen_od_entry const * canopen_od_find(canopen_od const * const me, u16 index, u8 sub);
+u32 canopen_od_read(canopen_od const * const me, canopen_od_entry const * const entry, void* const dst, u32 size, u32* const read);
+u32 canopen_od_write(canopen_od const * const me, canopen_od_entry const * const entry, void const * const src, u32 size);
+u32 canopen_od_sdo_read(canopen_od const * const me, u16 index, u8 sub, void* const dst, u32 size, u32* const read);
+u32 canopen_od_sdo_write(canopen_od const * const me, u16 index, u8 sub, void const * const src, u32 size);
+
+#else 
+
+extern canopen_od_entry const * canopen_od_find(canopen_od const * const me, u16 index, u8 sub);
+extern u32 canopen_od_read(canopen_od const * const me, canopen_od_entry const * const entry, void* const dst, u32 size, u32* const read);
+extern u32 canopen_od_write(canopen_od const * const me, canopen_od_entry const * const entry, void const * const src, u32 size);
+extern u32 canopen_od_sdo_read(canopen_od const * const me, u16 index, u8 sub, void* const dst, u32 size, u32* const read);
+extern u32 canopen_od_sdo_write(canopen_od const * const me, u16 index, u8 sub, void const * const src, u32 size);
+
+#endif /* __CANOPEN_OD_H_ */
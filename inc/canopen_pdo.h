@@ -0,0 +1,232 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// PDO engine for CANopen devices and masters. Every PDO mapping is compiled once into a 
+// plan of shift/mask ops between the dictionary values and one 64 bit payload, so a 
+// SYNC only runs the ops of the due TPDOs and sends all of them with one batch, and a 
+// received RPDO costs an id table lookup plus its ops. The PDOs of many dictionaries 
+// (one per node) live in one engine.
+//
+// Compiled plans sit in two sets. Configuration changes compile into the idle set and 
+// swap it in with one atomic store, the traffic side never waits for a reconfiguration 
+// and never sees a half built mapping. Traffic (canopen_pdo_receive/sync/flush_events) 
+// runs on one thread, configuration and canopen_pdo_trigger may come from any thread.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+#define CANOPEN_PDO_MAP(__INDEX, __SUB, __BITS)     ((((u32) (__INDEX)) << 16U) | (((u32) (__SUB)) << 8U) | ((u32) (__BITS)))
+#define CANOPEN_PDO_MAP_INDEX(__MAP)                ((u16) ((__MAP) >> 16U))
+#define CANOPEN_PDO_MAP_SUB(__MAP)                  ((u8) ((__MAP) >> 8U))
+#define CANOPEN_PDO_MAP_BITS(__MAP)                 ((u8) (__MAP))
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define CANOPEN_PDO_MAX_MAPPED          64U         /* mapping entries per PDO */
+#define CANOPEN_PDO_MAX_BITS            64U         /* payload of a classic CAN frame */
+#define CANOPEN_PDO_PER_OD              512U        /* RPDOs and TPDOs a dictionary may have */
+#define CANOPEN_PDO_NONE                0xFFFFFFFFU
+
+#define CANOPEN_PDO_RX                  0U
+#define CANOPEN_PDO_TX                  1U
+
+// COB-ID entry of the communication parameters 
+#define CANOPEN_PDO_COB_INVALID         0x80000000U
+#define CANOPEN_PDO_COB_EXTENDED        0x20000000U
+
+// transmission types 
+#define CANOPEN_PDO_SYNC_ACYCLIC        0U          /* on the SYNC after a trigger */
+#define CANOPEN_PDO_SYNC_MAX            240U        /* 1..240: every nth SYNC */
+#define CANOPEN_PDO_EVENT_MANUFACTURER  254U
+#define CANOPEN_PDO_EVENT_PROFILE       255U
+
+#define CANOPEN_PDO_SYNC_COB_ID         0x080U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __CANOPEN_PDO_H_
+    #define CANOPEN_PDO_MODULE_NAME     "CANOPEN_PDO"
+    #define CANOPEN_PDO_RPDO_COMM       0x1400U
+    #define CANOPEN_PDO_RPDO_MAP        0x1600U
+    #define CANOPEN_PDO_TPDO_COMM       0x1800U
+    #define CANOPEN_PDO_TPDO_MAP        0x1A00U
+    #define CANOPEN_PDO_DUMMY_LAST      0x0007U     /* indexes 1..7 are dummy entries */
+#endif /*  __CANOPEN_PDO_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct canopen_pdo_config_t
+{
+    canopen_od const *  od;             /* dictionary the mapped values live in */
+    u32                 cob_id;         /* CiA 301 layout, CANOPEN_PDO_COB_xxx */
+    u16                 comm_index;     /* 0x1400.. or 0x1800.. when read from od, else 0 */
+    u8                  direction;      /* CANOPEN_PDO_RX / CANOPEN_PDO_TX */
+    u8                  transmission;
+    u32                 map_count;
+    u32                 map[CANOPEN_PDO_MAX_MAPPED];    /* CANOPEN_PDO_MAP() */
+};
+
+typedef struct canopen_pdo_config_t canopen_pdo_config;
+
+// one mapped value: payload |= (value & mask) << shift, and back for RPDOs 
+struct canopen_pdo_op_t
+{
+    u8*     value;          /* NULLPTR for dummy entries */
+    u64     mask;
+    u8      shift;
+    u8      size;           /* bytes loaded and stored, 1, 2, 4 or 8 */
+    u8      partial;        /* RPDO keeps the unmapped bits of the value */
+    u8      reserved;
+};
+
+typedef struct canopen_pdo_op_t canopen_pdo_op;
+
+struct canopen_pdo_plan_t
+{
+    u32     can_id;         /* kernel layout */
+    u32     pdo;            /* configuration, also indexes the runtime state */
+    u32     first_op;
+    u8      op_count;
+    u8      len;            /* payload bytes */
+    u8      transmission;
+    u8      reserved;
+};
+
+typedef struct canopen_pdo_plan_t canopen_pdo_plan;
+
+struct canopen_pdo_set_t
+{
+    canopen_pdo_plan*   plans;          /* TPDOs first, then RPDOs */
+    canopen_pdo_op*     ops;
+    u32                 tx_count;
+    u32                 rx_count;
+    u32                 plan_capacity;
+    u32                 op_capacity;
+    can_id_table        rx_ids;         /* can id -> plan */
+    u32                 users;          /* traffic calls working on the set */
+};
+
+typedef struct canopen_pdo_set_t canopen_pdo_set;
+
+struct canopen_pdo_engine_t
+{
+    can_socket*         socket;         /* NULLPTR: frames are only built */
+    canopen_pdo_set     sets[2];
+    canopen_pdo_set*    active;
+
+    canopen_pdo_config* configs;
+    u32                 config_count;
+    u32                 max_pdos;
+    u32                 sync_id;        /* kernel layout, CAN_ID_TABLE_NONE to ignore SYNC */
+
+    // runtime state per configuration, survives remapping 
+    u8*                 sync_counters;
+    u8*                 pending;        /* TPDO triggered / RPDO latched until SYNC */
+    u64*                latched;        /* payload of synchronous RPDOs */
+    can_frame_rec*      tx_frames;      /* traffic thread only */
+
+    pthread_mutex_t     config_lock;
+
+    u64                 syncs;
+    u64                 tpdos_sent;
+    u64                 tpdos_dropped;  /* built but not accepted by the socket */
+    u64                 rpdos_applied;
+    u64                 rpdos_short;    /* shorter than the mapping */
+    u64                 remaps;
+    u8                  module_position;
+};
+
+typedef struct canopen_pdo_engine_t canopen_pdo_engine; 
+
+#ifdef __CANOPEN_PDO_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean canopen_pdo_init(canopen_pdo_engine* const me, u8 __id, can_socket* const socket, u32 max_pdos);
+void canopen_pdo_destruct(canopen_pdo_engine* const me);
+
+u32 canopen_pdo_add(canopen_pdo_engine* const me, canopen_pdo_config const * const config);
+u32 canopen_pdo_add_od(canopen_pdo_engine* const me, canopen_od const * const od);
+__boolean canopen_pdo_reload_od(canopen_pdo_engine* const me, canopen_od const * const od);
+__boolean canopen_pdo_set_mapping(canopen_pdo_engine* const me, u32 pdo, u32 const * const map, u32 count);
+__boolean canopen_pdo_set_cob_id(canopen_pdo_engine* const me, u32 pdo, u32 cob_id);
+
+void canopen_pdo_trigger(canopen_pdo_engine* const me, u32 pdo);
+u32 canopen_pdo_build_sync(canopen_pdo_engine* const me, can_frame_rec* const frames, u32 max);
+u32 canopen_pdo_sync(canopen_pdo_engine* const me);
+u32 canopen_pdo_flush_events(canopen_pdo_engine* const me);
+u32 canopen_pdo_receive(canopen_pdo_engine* const me, can_frame_rec const * const frames, u32 count);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static canopen_pdo_set* canopen_pdo_acquire(canopen_pdo_engine* const me);
+static inline void canopen_pdo_release(canopen_pdo_set* const set);
+static __boolean canopen_pdo_validate(canopen_pdo_config const * const config);
+static __boolean canopen_pdo_read_od(canopen_od const * const od, u16 comm_index, canopen_pdo_config* const config);
+static __boolean canopen_pdo_publish(canopen_pdo_engine* const me);
+static __boolean canopen_pdo_compile(canopen_pdo_engine* const me, canopen_pdo_set* const set);
+static u32 canopen_pdo_build(canopen_pdo_engine* const me, canopen_pdo_set* const set, can_frame_rec* const frames, u32 max, __boolean sync);
+static u32 canopen_pdo_send(canopen_pdo_engine* const me, u32 count);
+static void canopen_pdo_apply_latched(canopen_pdo_engine* const me, canopen_pdo_set* const set);
+static inline u64 canopen_pdo_load(u8 const * const src, u8 size);
+static inline void canopen_pdo_store(u8* const dst, u8 size, u64 value);
+
+#else 
+
+extern __boolean canopen_pdo_init(canopen_pdo_engine* const me, u8 __id, can_socket* const socket, u32 max_pdos);
+extern void canopen_pdo_destruct(canopen_pdo_engine* const me);
+
+extern u32 canopen_pdo_add(canopen_pdo_engine* const me, canopen_pdo_config const * const config);
+extern u32 canopen_pdo_add_od(canopen_pdo_engine* const me, canopen_od const * const od);
+extern __boolean canopen_pdo_reload_od(canopen_pdo_engine* const me, canopen_od const * const od);
+extern __boolean canopen_pdo_set_mapping(canopen_pdo_engine* const me, u32 pdo, u32 const * const map, u32 count);
+extern __boolean canopen_pdo_set_cob_id(canopen_pdo_engine* const me, u32 pdo, u32 cob_id);
+
+extern void canopen_pdo_trigger(canopen_pdo_engine* const me, u32 pdo);
+extern u32 canopen_pdo_build_sync(canopen_pdo_engine* const me, can_frame_rec* const frames, u32 max);
+extern u32 canopen_pdo_sync(canopen_pdo_engine* const me);
+extern u32 canopen_pdo_flush_events(canopen_pdo_engine* const me);
+extern u32 canopen_pdo_receive(canopen_pdo_engine* const me, can_frame_rec const * const frames, u32 count);
+
+#endif /* __CANOPEN_PDO_H_ */
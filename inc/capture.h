@@ -0,0 +1,368 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Binary bus capture. A writer thread drains frame rings into preallocated, memory 
+// mapped segment files. Frames are packed into blocks, every closed segment ends with a 
+// footer index of all blocks (time) and all CAN IDs, followed by a fixed size trailer.
+//
+//   [file header][block][block]...[block][footer][block entries][id entries][postings][trailer]
+//   block: [block header][records][sorted IDs of the block]
+//
+// The ID index is built incrementally: every block is sealed with the directory of the 
+// IDs it contains, the footer posting lists (ID -> blocks) only aggregate these. A 
+// segment of a crashed or still running writer has no footer, readers rebuild the block 
+// index by walking the block headers and can still use the directories.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+#define CAPTURE_ALIGN(__X, __A)          (((__X) + ((__A) - 1U)) & ~((u64) (__A) - 1U))
+#define CAPTURE_RECORD_SIZE(__LEN)       (sizeof(capture_record_hdr) + CAPTURE_ALIGN((u64) (__LEN), 4U))
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define CAPTURE_FILE_MAGIC              "C4LCAPS1"
+#define CAPTURE_FOOTER_MAGIC            "C4LCIDX1"
+#define CAPTURE_TRAILER_MAGIC           "C4LCEND1"
+#define CAPTURE_BLOCK_MAGIC             0x4B4C4243U     /* "CBLK" */
+#define CAPTURE_VERSION                 2U
+
+#define CAPTURE_DEFAULT_SEGMENT_SIZE    (256ULL * 1024ULL * 1024ULL)
+#define CAPTURE_DEFAULT_BLOCK_SIZE      (64U * 1024U)
+#define CAPTURE_MIN_BLOCK_SIZE          1024U
+#define CAPTURE_MAX_RINGS               8U
+#define CAPTURE_PATH_MAX                512U
+
+#define CAPTURE_EXPORT_CANDUMP          0U
+#define CAPTURE_EXPORT_ASC              1U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __CAPTURE_H_
+    #define CAPTURE_MODULE_NAME         "CAPTURE"
+    #define CAPTURE_BATCH               256U
+    #define CAPTURE_IDLE_SLEEP_NS       100000L
+    #define CAPTURE_ID_EMPTY            0xFFFFFFFFU
+    #define CAPTURE_ID_MIN_CAPACITY     256U
+    #define CAPTURE_BLOCK_MIN_CAPACITY  64U
+    #define CAPTURE_LIST_MIN_CAPACITY   256U
+#endif /*  __CAPTURE_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+// on-disk structures, all little endian 
+struct capture_file_hdr_t
+{
+    char magic[8];
+    u32  version;
+    u32  header_size;
+    u64  segment_index;
+    u64  created_ns;
+    u32  block_size;
+    u32  reserved0;
+    u8   reserved[24];
+};
+
+typedef struct capture_file_hdr_t capture_file_hdr;
+
+// frame_count, size and the timestamps are kept current while the block is open, crc 
+// and the ID directory are only written when the block is sealed (id_count 0 while open)
+struct capture_block_hdr_t
+{
+    u32 magic;
+    u32 frame_count;
+    u32 size;               /* bytes including this header and the ID directory */
+    u32 crc;                /* CRC-32C over records and ID directory */
+    u64 base_ts;            /* reference of the record deltas */
+    u64 min_ts;
+    u64 max_ts;
+    u32 records_size;       /* bytes of records behind the header */
+    u32 id_count;           /* sorted u32 can_ids behind the records */
+};
+
+typedef struct capture_block_hdr_t capture_block_hdr;
+
+// followed by len bytes of data, padded to 4 bytes
+struct capture_record_hdr_t
+{
+    s32 ts_delta_ns;        /* relative to base_ts of the block */
+    u32 can_id;
+    u8  len;
+    u8  flags;
+    u8  bus;
+    u8  reserved;
+};
+
+typedef struct capture_record_hdr_t capture_record_hdr;
+
+struct capture_block_entry_t
+{
+    u64 offset;
+    u64 first_ts;
+    u64 last_ts;
+    u32 frame_count;
+    u32 size;
+};
+
+typedef struct capture_block_entry_t capture_block_entry;
+
+// postings_start/postings_count select the blocks of the ID in the posting table
+struct capture_id_entry_t
+{
+    u32 can_id;
+    u32 bus_mask;
+    u64 count;
+    u64 first_ts;
+    u64 last_ts;
+    u32 postings_start;
+    u32 postings_count;
+};
+
+typedef struct capture_id_entry_t capture_id_entry;
+
+// in memory only, one entry per ID and sealed block 
+struct capture_posting_t
+{
+    u32 can_id;
+    u32 block;
+};
+
+typedef struct capture_posting_t capture_posting;
+
+struct capture_footer_t
+{
+    char magic[8];
+    u32  version;
+    u32  block_count;
+    u32  id_count;
+    u32  reserved;
+    u64  frame_count;
+    u64  first_ts;
+    u64  last_ts;
+    u64  blocks_offset;     /* absolute file offsets of the tables */
+    u64  ids_offset;
+    u64  postings_offset;   /* u32 block numbers, ascending per ID */
+    u64  posting_count;
+};
+
+typedef struct capture_footer_t capture_footer;
+
+struct capture_trailer_t
+{
+    u64  footer_offset;
+    u64  footer_size;       /* footer and all tables */
+    u32  crc;               /* CRC-32C over footer_size bytes */
+    u32  reserved;
+    char magic[8];
+};
+
+typedef struct capture_trailer_t capture_trailer;
+
+struct capture_config_t
+{
+    char const * directory;
+    char const * prefix;
+    u64          segment_size;      /* preallocated size of a segment file */
+    u64          rotate_ns;         /* 0: rotate by size only */
+    u32          block_size;
+};
+
+typedef struct capture_config_t capture_config;
+
+struct capture_stats_t
+{
+    u64 frames;
+    u64 bytes;
+    u64 blocks;
+    u64 segments;
+    u64 errors;
+};
+
+typedef struct capture_stats_t capture_stats;
+
+struct capture_t
+{
+    char            directory[CAPTURE_PATH_MAX];
+    char            prefix[64];
+    char            path[CAPTURE_PATH_MAX];
+    u64             segment_size;
+    u64             rotate_ns;
+    u32             block_size;
+    u8              module_position;
+
+    frame_ring*     rings[CAPTURE_MAX_RINGS];
+    u8              ring_count;
+    pthread_t       thread;
+    volatile u8     running;
+    volatile u8     rotate_request;
+
+    // open segment 
+    int             fd;
+    u8*             map;
+    u64             used;
+    u64             segment_index;
+    u64             segment_open_ns;
+    u64             segment_frames;
+    u64             segment_first_ts;
+    u64             segment_last_ts;
+    capture_block_hdr* block;
+    u64             block_offset;
+
+    // index of the open segment, built while writing 
+    capture_block_entry* blocks;
+    u32             block_count;
+    u32             block_capacity;
+    capture_id_entry* ids;          /* open addressing, CAPTURE_ID_EMPTY marks free */
+    u32             id_count;
+    u32             id_capacity;
+    u32*            block_ids;      /* distinct IDs of the open block */
+    u32             block_id_count;
+    u32             block_id_capacity;
+    capture_posting* postings;      /* (ID, block) pairs of all sealed blocks */
+    u32             posting_count;
+    u32             posting_capacity;
+
+    capture_stats   stats;
+};
+
+typedef struct capture_t capture; 
+
+typedef struct capture_t* capture_ptr; 
+
+struct capture_reader_t
+{
+    int                         fd;
+    u8 const *                  map;
+    u64                         map_size;
+    capture_file_hdr const *    hdr;
+    capture_footer const *      footer;     /* NULLPTR for a segment without footer */
+    capture_block_entry const * blocks;
+    u32                         block_count;
+    capture_id_entry const *    ids;        /* NULLPTR for a segment without footer */
+    u32                         id_count;
+    u32 const *                 postings;   /* NULLPTR for a segment without footer */
+    capture_block_entry*        recovered;  /* heap copy of a rebuilt block index */
+    u64*                        max_last_ts;    /* per block: latest last_ts up to it */
+    u64*                        min_first_ts;   /* per block: earliest first_ts from it on */
+};
+
+typedef struct capture_reader_t capture_reader; 
+
+struct capture_cursor_t
+{
+    u8 const * pos;
+    u8 const * end;
+    u64        base_ts;
+    u32        remaining;
+};
+
+typedef struct capture_cursor_t capture_cursor; 
+
+#ifdef __CAPTURE_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean capture_init(capture* const me, u8 __id, capture_config const * const config);
+void capture_destruct(capture* const me);
+__boolean capture_add_ring(capture* const me, frame_ring* const ring);
+__boolean capture_start(capture* const me);
+void capture_stop(capture* const me);
+u32 capture_write(capture* const me, can_frame_rec const * const frames, u32 count);
+u32 capture_write_ptrs(capture* const me, can_frame_rec const * const * const frames, u32 count);
+__boolean capture_rotate(capture* const me);
+void capture_get_stats(capture const * const me, capture_stats* const stats);
+
+__boolean capture_reader_open(capture_reader* const me, char const * const path);
+void capture_reader_close(capture_reader* const me);
+u32 capture_reader_find_block(capture_reader const * const me, u64 timestamp_ns);
+u32 capture_reader_find_block_end(capture_reader const * const me, u64 timestamp_ns);
+capture_id_entry const * capture_reader_find_id(capture_reader const * const me, u32 can_id);
+u32 const * capture_reader_postings(capture_reader const * const me, capture_id_entry const * const entry);
+u32 const * capture_reader_block_ids(capture_reader const * const me, u32 block, u32* const count);
+__boolean capture_cursor_init(capture_cursor* const me, capture_reader const * const reader, u32 block);
+__boolean capture_cursor_next(capture_cursor* const me, can_frame_rec* const frame);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static void* capture_thread(void* arg);
+static __boolean capture_open_segment(capture* const me, u64 timestamp_ns);
+static __boolean capture_close_segment(capture* const me);
+static __boolean capture_open_block(capture* const me, u64 timestamp_ns);
+static void capture_seal_block(capture* const me);
+static __boolean capture_write_frame(capture* const me, can_frame_rec const * const frame);
+static void capture_index_id(capture* const me, can_frame_rec const * const frame);
+static __boolean capture_grow_ids(capture* const me);
+static __boolean capture_grow_list(void** const list, u32* const capacity, u32 element_size);
+static void capture_build_postings(capture* const me, capture_id_entry* const ids, u32 count, u32* const postings);
+static u32 capture_find_id(capture_id_entry const * const ids, u32 count, u32 can_id);
+static int capture_compare_u32(void const * a, void const * b);
+static int capture_compare_ids(void const * a, void const * b);
+static __boolean capture_reader_footer_valid(capture_reader const * const me, capture_trailer const * const trailer);
+static __boolean capture_reader_recover(capture_reader* const me);
+static __boolean capture_reader_index_times(capture_reader* const me);
+static inline u64 capture_now_ns(void);
+
+#else 
+
+extern __boolean capture_init(capture* const me, u8 __id, capture_config const * const config);
+extern void capture_destruct(capture* const me);
+extern __boolean capture_add_ring(capture* const me, frame_ring* const ring);
+extern __boolean capture_start(capture* const me);
+extern void capture_stop(capture* const me);
+extern u32 capture_write(capture* const me, can_frame_rec const * const frames, u32 count);
+extern u32 capture_write_ptrs(capture* const me, can_frame_rec const * const * const frames, u32 count);
+extern __boolean capture_rotate(capture* const me);
+extern void capture_get_stats(capture const * const me, capture_stats* const stats);
+
+extern __boolean capture_reader_open(capture_reader* const me, char const * const path);
+extern void capture_reader_close(capture_reader* const me);
+extern u32 capture_reader_find_block(capture_reader const * const me, u64 timestamp_ns);
+extern u32 capture_reader_find_block_end(capture_reader const * const me, u64 timestamp_ns);
+extern capture_id_entry const * capture_reader_find_id(capture_reader const * const me, u32 can_id);
+extern u32 const * capture_reader_postings(capture_reader const * const me, capture_id_entry const * const entry);
+extern u32 const * capture_reader_block_ids(capture_reader const * const me, u32 block, u32* const count);
+extern __boolean capture_cursor_init(capture_cursor* const me, capture_reader const * const reader, u32 block);
+extern __boolean capture_cursor_next(capture_cursor* const me, can_frame_rec* const frame);
+
+#endif /* __CAPTURE_H_ */
@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Conversion of capture segments into text formats of existing tools: the candump log 
+// format (candump -l, canplayer) and Vector ASC.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define CAPTURE_EXPORT_MAX_BUS_NAME     16U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct capture_export_t
+{
+    FILE*   out;
+    u8      format;                 /* CAPTURE_EXPORT_CANDUMP or CAPTURE_EXPORT_ASC */
+    u64     start_ns;               /* ASC times are relative to this */
+    char    bus_names[CAN_FRAME_MAX_BUSES][CAPTURE_EXPORT_MAX_BUS_NAME];
+};
+
+typedef struct capture_export_t capture_export; 
+
+#ifdef __CAPTURE_EXPORT_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+void capture_export_init(capture_export* const me, FILE* const out, u8 format, u64 start_ns);
+void capture_export_set_bus_name(capture_export* const me, u8 bus, char const * const name);
+void capture_export_begin(capture_export* const me);
+void capture_export_frame(capture_export* const me, can_frame_rec const * const frame);
+u64 capture_export_segment(capture_export* const me, capture_reader const * const reader);
+void capture_export_end(capture_export* const me);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static void capture_export_candump(capture_export* const me, can_frame_rec const * const frame);
+static void capture_export_asc(capture_export* const me, can_frame_rec const * const frame);
+static void capture_export_asc_date(capture_export* const me, char const * const prefix);
+
+#else 
+
+extern void capture_export_init(capture_export* const me, FILE* const out, u8 format, u64 start_ns);
+extern void capture_export_set_bus_name(capture_export* const me, u8 bus, char const * const name);
+extern void capture_export_begin(capture_export* const me);
+extern void capture_export_frame(capture_export* const me, can_frame_rec const * const frame);
+extern u64 capture_export_segment(capture_export* const me, capture_reader const * const reader);
+extern void capture_export_end(capture_export* const me);
+
+#endif /* __CAPTURE_EXPORT_H_ */
+
+
+
+
+#ifdef __CAPTURE_EXPORT_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- VARIABLES   
+*****************************************************************************************
+****************************************************************************************/
+
+static char const hex_digits[16U] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
+
+#else 
+
+
+
+#endif /* __CAPTURE_EXPORT_H_ */
@@ -0,0 +1,155 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Filtered reads of capture segments. The time range and the ID filters are resolved 
+// against the segment index first: the ID table and its posting lists of a finished 
+// segment, the ID directories of the sealed blocks of a segment without footer. Only the 
+// remaining candidate blocks are decoded, optionally by several worker threads, and the 
+// matching frames are delivered in block order to a callback of the calling thread.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define CAPTURE_QUERY_MAX_FILTERS       32U
+#define CAPTURE_QUERY_MAX_THREADS       16U
+#define CAPTURE_QUERY_ALL_BUSES         0xFFFFFFFFU
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __CAPTURE_QUERY_H_
+    #define CAPTURE_QUERY_WINDOW        4U      /* blocks in flight per worker */
+    #define CAPTURE_QUERY_ID_FLAGS      (CAN_RTR_FLAG | CAN_ERR_FLAG)
+#endif /*  __CAPTURE_QUERY_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+// matches if ((frame.can_id ^ can_id) & mask) == 0, can_id carries the kernel flags 
+struct capture_query_filter_t
+{
+    u32 can_id;
+    u32 mask;
+};
+
+typedef struct capture_query_filter_t capture_query_filter;
+
+struct capture_query_stats_t
+{
+    u64 blocks_total;
+    u64 blocks_candidate;       /* left after time range and ID index */
+    u64 frames_scanned;
+    u64 frames_matched;
+};
+
+typedef struct capture_query_stats_t capture_query_stats;
+
+// called from the thread running the query, frames are only valid during the call 
+typedef void (*capture_query_visit)(void* ctx, can_frame_rec const * frames, u32 count);
+
+struct capture_query_t
+{
+    u64                     from_ns;
+    u64                     to_ns;          /* inclusive */
+    u32                     bus_mask;
+    capture_query_filter    filters[CAPTURE_QUERY_MAX_FILTERS];
+    u8                      filter_count;   /* 0: all IDs */
+    u8                      threads;
+    capture_query_stats     stats;
+};
+
+typedef struct capture_query_t capture_query; 
+
+typedef struct capture_query_t* capture_query_ptr; 
+
+#ifdef __CAPTURE_QUERY_H_
+
+// state shared by the workers of one segment scan 
+struct capture_query_scan_t
+{
+    capture_query const *   query;
+    capture_reader const *  reader;
+    u32 const *             blocks;         /* candidate block numbers, ascending */
+    u32                     count;
+    u32                     window;
+    u32                     frame_capacity; /* per slot */
+
+    pthread_mutex_t         lock;
+    pthread_cond_t          cond;
+    u32                     next;           /* next candidate to claim */
+    u32                     delivered;      /* candidates handed to the visitor */
+    can_frame_rec*          frames;         /* window slots of frame_capacity frames */
+    u32*                    slot_count;
+    u8*                     slot_ready;
+    u64                     scanned;
+};
+
+typedef struct capture_query_scan_t capture_query_scan; 
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+void capture_query_init(capture_query* const me);
+__boolean capture_query_add_id(capture_query* const me, u32 can_id, u32 mask);
+void capture_query_set_time(capture_query* const me, u64 from_ns, u64 to_ns);
+void capture_query_set_threads(capture_query* const me, u8 threads);
+__boolean capture_query_match(capture_query const * const me, can_frame_rec const * const frame);
+u32 capture_query_candidates(capture_query const * const me, capture_reader const * const reader, u32* const blocks);
+u64 capture_query_segment(capture_query* const me, capture_reader const * const reader, capture_query_visit visit, void* ctx);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static void capture_query_time_range(capture_query const * const me, capture_reader const * const reader, u32* const first, u32* const last);
+static void capture_query_mark_ids(capture_query const * const me, capture_reader const * const reader, u64* const bitmap);
+static void capture_query_mark_entry(capture_query const * const me, capture_reader const * const reader, capture_id_entry const * const entry, u64* const bitmap);
+static __boolean capture_query_block_matches(capture_query const * const me, capture_reader const * const reader, u32 block);
+static __boolean capture_query_id_matches(capture_query const * const me, u32 can_id);
+static u32 capture_query_scan_block(capture_query const * const me, capture_reader const * const reader, u32 block, can_frame_rec* const frames, u32 capacity, u64* const scanned);
+static void* capture_query_worker(void* arg);
+static u64 capture_query_parallel(capture_query* const me, capture_query_scan* const scan, capture_query_visit visit, void* ctx);
+
+#else 
+
+extern void capture_query_init(capture_query* const me);
+extern __boolean capture_query_add_id(capture_query* const me, u32 can_id, u32 mask);
+extern void capture_query_set_time(capture_query* const me, u64 from_ns, u64 to_ns);
+extern void capture_query_set_threads(capture_query* const me, u8 threads);
+extern __boolean capture_query_match(capture_query const * const me, can_frame_rec const * const frame);
+extern u32 capture_query_candidates(capture_query const * const me, capture_reader const * const reader, u32* const blocks);
+extern u64 capture_query_segment(capture_query* const me, capture_reader const * const reader, capture_query_visit visit, void* ctx);
+
+#endif /* __CAPTURE_QUERY_H_ */
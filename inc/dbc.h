@@ -0,0 +1,148 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// DBC database: messages and signals of a CAN network description. Only what decoding 
+// needs is kept (BO_, SG_, SIG_VALTYPE_), everything else in the file is skipped. The 
+// signals of a message are stored contiguously, messages can be looked up by ID.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define DBC_NAME_MAX                64U
+#define DBC_UNIT_MAX                16U
+
+#define DBC_VALUE_UNSIGNED          0U
+#define DBC_VALUE_SIGNED            1U
+#define DBC_VALUE_FLOAT32           2U
+#define DBC_VALUE_FLOAT64           3U
+
+#define DBC_MUX_NONE                0U
+#define DBC_MUX_MULTIPLEXOR         1U      /* "M" */
+#define DBC_MUX_MULTIPLEXED         2U      /* "m<value>" */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __DBC_H_
+    #define DBC_MODULE_NAME         "DBC"
+    #define DBC_MAX_LINE            4096U
+    #define DBC_MIN_CAPACITY        64U
+    #define DBC_ID_EXTENDED         0x80000000U     /* extended ID marker of the file format */
+    #define DBC_PSEUDO_MESSAGE      "VECTOR__INDEPENDENT_SIG_MSG"
+#endif /*  __DBC_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct dbc_signal_t
+{
+    char    name[DBC_NAME_MAX];
+    char    unit[DBC_UNIT_MAX];
+    u32     message;            /* index of the message */
+    u16     start_bit;          /* LSB for little endian, MSB for big endian (file numbering) */
+    u8      length;
+    u8      big_endian;
+    u8      value_type;         /* DBC_VALUE_* */
+    u8      mux_type;           /* DBC_MUX_* */
+    u16     mux_value;
+    f64     factor;
+    f64     offset;
+    f64     minimum;
+    f64     maximum;
+};
+
+typedef struct dbc_signal_t dbc_signal;
+
+struct dbc_message_t
+{
+    char    name[DBC_NAME_MAX];
+    u32     can_id;             /* CAN_EFF_FLAG set for extended IDs */
+    u8      size;               /* bytes */
+    u32     first_signal;
+    u32     signal_count;
+};
+
+typedef struct dbc_message_t dbc_message;
+
+struct dbc_database_t
+{
+    dbc_message*    messages;
+    u32             message_count;
+    u32             message_capacity;
+    dbc_signal*     signals;
+    u32             signal_count;
+    u32             signal_capacity;
+    u32*            by_id;          /* message indexes sorted by can_id */
+    u32             error_line;     /* first line that could not be parsed, 0 if none */
+    u8              module_position;
+};
+
+typedef struct dbc_database_t dbc_database; 
+
+typedef struct dbc_database_t* dbc_database_ptr; 
+
+#ifdef __DBC_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean dbc_load(dbc_database* const me, u8 __id, char const * const path);
+__boolean dbc_load_stream(dbc_database* const me, u8 __id, FILE* const stream);
+void dbc_destruct(dbc_database* const me);
+dbc_message const * dbc_find_message(dbc_database const * const me, u32 can_id);
+dbc_signal const * dbc_find_signal(dbc_database const * const me, char const * const message, char const * const signal);
+f64 dbc_signal_decode(dbc_signal const * const signal, u8 const * const data);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static __boolean dbc_parse_message(dbc_database* const me, char const * line);
+static __boolean dbc_parse_signal(dbc_database* const me, char const * line);
+static __boolean dbc_parse_value_type(dbc_database* const me, char const * line);
+static __boolean dbc_grow(void** const list, u32* const capacity, u32 element_size);
+static void dbc_build_index(dbc_database* const me);
+static int dbc_compare_ids(void const * a, void const * b, void* arg);
+
+#else 
+
+extern __boolean dbc_load(dbc_database* const me, u8 __id, char const * const path);
+extern __boolean dbc_load_stream(dbc_database* const me, u8 __id, FILE* const stream);
+extern void dbc_destruct(dbc_database* const me);
+extern dbc_message const * dbc_find_message(dbc_database const * const me, u32 can_id);
+extern dbc_signal const * dbc_find_signal(dbc_database const * const me, char const * const message, char const * const signal);
+extern f64 dbc_signal_decode(dbc_signal const * const signal, u8 const * const data);
+
+#endif /* __DBC_H_ */
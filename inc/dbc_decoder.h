@@ -0,0 +1,188 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Compiled decoding of DBC messages. Every message is compiled once into a plan: per 
+// signal the payload word, shifts and the scaling, with the bit numbering, byte order 
+// and sign resolved up front. Frames are decoded in batches: the frames of a message are 
+// gathered into payload word columns and every signal is then extracted for all of them 
+// in one straight loop the compiler can vectorize. Values go to a structure-of-arrays 
+// store with one value column and one timestamp column per signal.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define DBC_DECODER_MAX_BATCH           256U
+#define DBC_DECODER_MAX_WORDS           (CAN_FRAME_MAX_DATA / 8U)
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __DBC_DECODER_H_
+    #define DBC_DECODER_MODULE_NAME     "DBC_DECODER"
+    #define DBC_DECODER_NO_MUX          (-1)
+    #define DBC_DECODER_NO_PLAN         0xFFFFFFFFU
+    #define DBC_OP_BIG_ENDIAN           0x01U
+    #define DBC_OP_SPLIT                0x02U   /* the signal spans two payload words */
+#endif /*  __DBC_DECODER_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+// raw = W[word] >> shift, or two words combined for DBC_OP_SPLIT, then 
+// value = (raw << width_shift) >> width_shift, signed or unsigned
+struct dbc_op_t
+{
+    f64     factor;
+    f64     offset;
+    u32     signal;             /* index in the database and in the store */
+    u8      word;
+    u8      shift;
+    u8      spill;              /* shift of the second word of a split signal */
+    u8      width_shift;        /* 64 - length */
+    u8      flags;
+    u8      value_type;
+    u8      mux_type;
+    u16     mux_value;
+};
+
+typedef struct dbc_op_t dbc_op;
+
+struct dbc_plan_t
+{
+    u32     can_id;
+    u32     message;
+    u32     first_op;
+    u16     op_count;
+    u8      min_len;            /* shorter frames are not decoded */
+    u8      word_count;         /* payload words read by the ops */
+    u8      big_endian;         /* some op reads big endian words */
+    s32     mux_op;             /* op of the multiplexor, DBC_DECODER_NO_MUX if none */
+};
+
+typedef struct dbc_plan_t dbc_plan;
+
+// column per signal: depth values and timestamps, counts[signal] samples written so far 
+struct dbc_store_t
+{
+    u32     signal_count;
+    u32     depth;
+    u32     mask;
+    f64*    values;
+    u64*    timestamps;
+    u64*    counts;
+};
+
+typedef struct dbc_store_t dbc_store; 
+
+struct dbc_decoder_t
+{
+    dbc_plan*   plans;
+    u32         plan_count;
+    dbc_op*     ops;
+    u32         op_count;
+    u16         std_plans[CAN_SFF_MASK + 1U];   /* plan + 1, 0 for unknown IDs */
+    u32*        ext_ids;                        /* sorted extended IDs */
+    u16*        ext_plans;
+    u32         ext_count;
+    u32         skipped_signals;                /* outside the message, not compiled */
+    u8          module_position;
+
+    // batch scratch, frames grouped by plan 
+    u32*        plan_frames;
+    u32*        plan_start;
+    u32         frame_plan[DBC_DECODER_MAX_BATCH];
+    u32         touched[DBC_DECODER_MAX_BATCH];
+    u32         order[DBC_DECODER_MAX_BATCH];
+    u64         le_words[DBC_DECODER_MAX_WORDS][DBC_DECODER_MAX_BATCH];
+    u64         be_words[DBC_DECODER_MAX_WORDS][DBC_DECODER_MAX_BATCH];
+    u64         timestamps[DBC_DECODER_MAX_BATCH];
+    u64         raw[DBC_DECODER_MAX_BATCH];
+    u64         mux[DBC_DECODER_MAX_BATCH];
+    u64         mux_timestamps[DBC_DECODER_MAX_BATCH];
+    f64         values[DBC_DECODER_MAX_BATCH];
+
+    u64         decoded;
+    u64         unknown;
+    u64         short_frames;
+};
+
+typedef struct dbc_decoder_t dbc_decoder; 
+
+typedef struct dbc_decoder_t* dbc_decoder_ptr; 
+
+#ifdef __DBC_DECODER_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean dbc_decoder_init(dbc_decoder* const me, u8 __id, dbc_database const * const db);
+void dbc_decoder_destruct(dbc_decoder* const me);
+dbc_plan const * dbc_decoder_find_plan(dbc_decoder const * const me, u32 can_id);
+u32 dbc_decoder_decode(dbc_decoder* const me, can_frame_rec const * const frames, u32 count, dbc_store* const store);
+u32 dbc_decoder_decode_ring(dbc_decoder* const me, frame_ring* const ring, dbc_store* const store);
+
+__boolean dbc_store_init(dbc_store* const me, u32 signal_count, u32 depth);
+void dbc_store_destruct(dbc_store* const me);
+void dbc_store_push(dbc_store* const me, u32 signal, f64 const * const values, u64 const * const timestamps, u32 count);
+__boolean dbc_store_latest(dbc_store const * const me, u32 signal, f64* const value, u64* const timestamp_ns);
+u64 dbc_store_count(dbc_store const * const me, u32 signal);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static __boolean dbc_decoder_compile_op(dbc_signal const * const signal, u32 index, dbc_op* const op, u32* const end_byte);
+static void dbc_decoder_decode_plan(dbc_decoder* const me, dbc_plan const * const plan, can_frame_rec const * const frames, 
+                                    u32 const * const order, u32 count, dbc_store* const store);
+static void dbc_decoder_extract(dbc_decoder* const me, dbc_op const * const op, u32 count, u64* const raw);
+static void dbc_decoder_scale(dbc_op const * const op, u64 const * const raw, u32 count, f64* const values);
+static int dbc_decoder_compare_ext(void const * a, void const * b);
+static inline u64 dbc_decoder_load_le(u8 const * const data);
+
+#else 
+
+extern __boolean dbc_decoder_init(dbc_decoder* const me, u8 __id, dbc_database const * const db);
+extern void dbc_decoder_destruct(dbc_decoder* const me);
+extern dbc_plan const * dbc_decoder_find_plan(dbc_decoder const * const me, u32 can_id);
+extern u32 dbc_decoder_decode(dbc_decoder* const me, can_frame_rec const * const frames, u32 count, dbc_store* const store);
+extern u32 dbc_decoder_decode_ring(dbc_decoder* const me, frame_ring* const ring, dbc_store* const store);
+
+extern __boolean dbc_store_init(dbc_store* const me, u32 signal_count, u32 depth);
+extern void dbc_store_destruct(dbc_store* const me);
+extern void dbc_store_push(dbc_store* const me, u32 signal, f64 const * const values, u64 const * const timestamps, u32 count);
+extern __boolean dbc_store_latest(dbc_store const * const me, u32 signal, f64* const value, u64* const timestamp_ns);
+extern u64 dbc_store_count(dbc_store const * const me, u32 signal);
+
+#endif /* __DBC_DECODER_H_ */
@@ -0,0 +1,125 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Event loop on epoll for one thread. Every file descriptor comes with a callback and 
+// its context, epoll_handler_run_once() waits and dispatches what is ready. Entries are 
+// slots of a fixed table, an event carries slot and generation, so an event of a fd that 
+// a callback before it in the same round removed is dropped instead of reaching a new 
+// owner of the slot. An eventfd lets other threads wake the loop.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define EPOLL_HANDLER_MAX_FDS           256U
+#define EPOLL_HANDLER_MAX_EVENTS        64U         /* dispatched per epoll_wait */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __EPOLL_HANDLER_H_
+    #define EPOLL_HANDLER_MODULE_NAME   "EPOLL_HANDLER"
+    #define EPOLL_HANDLER_WAKE_SLOT     0xFFFFFFFFU
+#endif /*  __EPOLL_HANDLER_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+// events are EPOLLIN/EPOLLOUT/EPOLLERR/EPOLLHUP/... of the fd 
+typedef void (*epoll_handler_callback)(void* ctx, int fd, u32 events);
+
+struct epoll_handler_entry_t
+{
+    int                     fd;             /* -1 for a free slot */
+    u32                     generation;
+    u32                     events;
+    epoll_handler_callback  callback;
+    void*                   ctx;
+};
+
+typedef struct epoll_handler_entry_t epoll_handler_entry;
+
+struct epoll_handler_t
+{
+    int                 epfd;
+    int                 wake_fd;
+    epoll_handler_entry entries[EPOLL_HANDLER_MAX_FDS];
+    u32                 count;
+    u64                 waits;
+    u64                 dispatched;
+    u8                  module_position;
+};
+
+typedef struct epoll_handler_t epoll_handler; 
+
+#ifdef __EPOLL_HANDLER_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean epoll_handler_init(epoll_handler* const me, u8 __id);
+void epoll_handler_destruct(epoll_handler* const me);
+
+__boolean epoll_handler_add(epoll_handler* const me, int fd, u32 events, epoll_handler_callback callback, void* ctx);
+__boolean epoll_handler_modify(epoll_handler* const me, int fd, u32 events);
+__boolean epoll_handler_remove(epoll_handler* const me, int fd);
+
+s32 epoll_handler_run_once(epoll_handler* const me, s32 timeout_ms);
+void epoll_handler_wake(epoll_handler* const me);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static epoll_handler_entry* epoll_handler_find(epoll_handler* const me, int fd);
+
+#else 
+
+extern __boolean epoll_handler_init(epoll_handler* const me, u8 __id);
+extern void epoll_handler_destruct(epoll_handler* const me);
+
+extern __boolean epoll_handler_add(epoll_handler* const me, int fd, u32 events, epoll_handler_callback callback, void* ctx);
+extern __boolean epoll_handler_modify(epoll_handler* const me, int fd, u32 events);
+extern __boolean epoll_handler_remove(epoll_handler* const me, int fd);
+
+extern s32 epoll_handler_run_once(epoll_handler* const me, s32 timeout_ms);
+extern void epoll_handler_wake(epoll_handler* const me);
+
+#endif /* __EPOLL_HANDLER_H_ */
@@ -40,7 +40,7 @@ SOFTWARE.
 
 // Add Logging Print with colors 
 // Add Log Queue using ringbuffer class
-// Logging Hisory manager for RAM or EEPROM          
+// Logging Hisory manager for RAM or EEPROM, see log_history.h          
 #define     LOG_EVENT_INFO       0x01U 
 #define     LOG_EVENT_WARN       0x02U 
 #define     LOG_EVENT_FATAL      0x04U 
@@ -48,16 +48,21 @@ SOFTWARE.
 #define     LOG_EVENT_TRACE      0x10U
 #define     LOG_EVENT_ALL        (LOG_EVENT_INFO | LOG_EVENT_WARN | LOG_EVENT_FATAL | LOG_EVENT_DEBUG | LOG_EVENT_TRACE) 
 
+#define     LOG_EVENT_MAX_MSG_LEN   256U
+
 typedef u8 logging_type;  
 
-typedef struct event_logger_t
+struct event_logger_t
 {
-    /* data */
+    logging_type  print_mask;     /* events printed on stdout */
+    logging_type  history_mask;   /* events kept in the persistent history */
+    u8            module_id; 
+    log_history*  history;        /* optional, NULLPTR if no history is kept */
 };
 
-typedef event_logger_t event_logger; 
+typedef struct event_logger_t event_logger; 
 
-typedef event_logger_t* event_logger_ptr;
+typedef struct event_logger_t* event_logger_ptr;
 
 #ifdef __EVENT_LOGGER_H_
 
@@ -74,6 +79,9 @@ typedef event_logger_t* event_logger_ptr;
 *****************************************************************************************
 ****************************************************************************************/
 
+void event_logger_init(event_logger* const me, u8 __id, logging_type print_mask);
+void event_logger_set_history(event_logger* const me, log_history* const history, logging_type history_mask);
+void event_logger_log(event_logger* const me, logging_type type, char const * const fmt, ...) __attribute__ ((format (printf, 3, 4)));
 
 
 /*****************************************************************************************
@@ -81,9 +89,14 @@ typedef event_logger_t* event_logger_ptr;
 ***             --- PRIVATE FUNCTIONS
 *****************************************************************************************
 ****************************************************************************************/
-#else 
 
+static inline char const * event_logger_type_name(logging_type type);
+
+#else 
 
+extern void event_logger_init(event_logger* const me, u8 __id, logging_type print_mask);
+extern void event_logger_set_history(event_logger* const me, log_history* const history, logging_type history_mask);
+extern void event_logger_log(event_logger* const me, logging_type type, char const * const fmt, ...) __attribute__ ((format (printf, 3, 4)));
 
 #endif /* __EVENT_LOGGER_H_ */
 
@@ -98,11 +111,16 @@ typedef event_logger_t* event_logger_ptr;
 *****************************************************************************************
 ****************************************************************************************/
 
+static u8 module_position = 0U; 
+
 /*****************************************************************************************
 *****************************************************************************************
 ***             -- PRIVATE MACROS    
 *****************************************************************************************
 ****************************************************************************************/
+
+#define EVENT_LOGGER_MODULE_NAME "EVENT_LOGGER"
+
 #else 
 
 
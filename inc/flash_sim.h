@@ -0,0 +1,153 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// NOR flash simulated on a memory mapped file, so storage layers above it can be tested 
+// and benchmarked on a PC. The constraints of the real part are enforced: a page can only 
+// be erased as a whole (all bytes 0xFF), programming can only clear bits and has to be 
+// aligned to the write unit. Reads go straight to the mapping.
+//
+// Erase counts are kept per page behind the header, and a power cut can be armed to 
+// stop programming after a number of bytes, leaving a torn write behind like a real 
+// reset would. The file survives the process, a restart test reopens it.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define FLASH_SIM_ERASED            0xFFU
+#define FLASH_SIM_MAX_WRITE_UNIT    16U
+#define FLASH_SIM_NO_POWER_CUT      0xFFFFFFFFFFFFFFFFULL
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __FLASH_SIM_H_
+    #define FLASH_SIM_MODULE_NAME   "FLASH_SIM"
+    #define FLASH_SIM_MAGIC         "C4LFLSH1"
+    #define FLASH_SIM_VERSION       1U
+    #define FLASH_SIM_HEADER_SIZE   4096U
+    #define FLASH_SIM_IS_POWER_OF_TWO(__X)  (((__X) != 0U) && (((__X) & ((__X) - 1U)) == 0U))
+#endif /*  __FLASH_SIM_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+// on-disk file header, the erase counts follow it, the pages start at data_offset
+struct flash_sim_file_t
+{
+    char magic[8];
+    u32  version;
+    u32  page_size;
+    u32  page_count;
+    u32  write_unit;
+    u64  data_offset;
+    u32  hdr_crc;
+    u32  reserved;
+};
+
+typedef struct flash_sim_file_t flash_sim_file;
+
+struct flash_sim_stats_t
+{
+    u64 erases;
+    u64 programs;
+    u64 bytes;
+    u64 violations;         /* refused programs: unaligned, across a page, or setting bits */
+};
+
+typedef struct flash_sim_stats_t flash_sim_stats;
+
+struct flash_sim_t
+{
+    int                 fd;
+    u8*                 map;
+    u64                 map_size;
+    u8*                 data;           /* page 0 */
+    u32*                erase_counts;
+    u32                 page_size;
+    u32                 page_count;
+    u32                 write_unit;
+    u64                 power_cut;      /* bytes left until the cut, FLASH_SIM_NO_POWER_CUT */
+    __boolean           powered;        /* false after the cut until flash_sim_power_on() */
+    flash_sim_stats     stats;
+    u8                  module_position;
+};
+
+typedef struct flash_sim_t flash_sim; 
+
+#ifdef __FLASH_SIM_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean flash_sim_open(flash_sim* const me, u8 __id, char const * const path, u32 page_size, u32 page_count, u32 write_unit);
+void flash_sim_close(flash_sim* const me);
+
+__boolean flash_sim_erase(flash_sim* const me, u32 page);
+__boolean flash_sim_program(flash_sim* const me, u32 page, u32 offset, void const * const data, u32 len);
+u8 const * flash_sim_page(flash_sim const * const me, u32 page);
+u32 flash_sim_erase_count(flash_sim const * const me, u32 page);
+__boolean flash_sim_sync(flash_sim* const me);
+
+void flash_sim_arm_power_cut(flash_sim* const me, u64 bytes);
+void flash_sim_power_on(flash_sim* const me);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static __boolean flash_sim_header_valid(flash_sim_file const * const file, u64 map_size);
+static void flash_sim_format(flash_sim* const me);
+
+#else 
+
+extern __boolean flash_sim_open(flash_sim* const me, u8 __id, char const * const path, u32 page_size, u32 page_count, u32 write_unit);
+extern void flash_sim_close(flash_sim* const me);
+
+extern __boolean flash_sim_erase(flash_sim* const me, u32 page);
+extern __boolean flash_sim_program(flash_sim* const me, u32 page, u32 offset, void const * const data, u32 len);
+extern u8 const * flash_sim_page(flash_sim const * const me, u32 page);
+extern u32 flash_sim_erase_count(flash_sim const * const me, u32 page);
+extern __boolean flash_sim_sync(flash_sim* const me);
+
+extern void flash_sim_arm_power_cut(flash_sim* const me, u64 bytes);
+extern void flash_sim_power_on(flash_sim* const me);
+
+#endif /* __FLASH_SIM_H_ */
@@ -0,0 +1,179 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Latest frame per CAN id, kept in a memory mapped file (put it on /dev/shm to share it 
+// between processes). The RX thread is the only writer, every entry is protected by its 
+// own seqlock, so readers in any thread or process copy consistent frames without 
+// locks and never slow the writer down.
+//
+//   [header page: header, group change counters][2048 entries for 11 bit ids]
+//   [29 bit id hash keys][29 bit id entries]
+//
+// Entries are cache line aligned. Besides the seqlock sequence (which counts updates) 
+// every entry counts the updates that changed its payload, and each group of 64 entries 
+// has a change counter of its own, so a reader polling for changes only looks into the 
+// groups that moved.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define FRAME_CACHE_STD_IDS             2048U
+#define FRAME_CACHE_GROUP_SIZE          64U
+#define FRAME_CACHE_MIN_EXT_SLOTS       64U
+#define FRAME_CACHE_MAX_EXT_SLOTS       16384U
+#define FRAME_CACHE_DEFAULT_EXT_SLOTS   1024U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __FRAME_CACHE_H_
+    #define FRAME_CACHE_MODULE_NAME     "FRAME_CACHE"
+    #define FRAME_CACHE_MAGIC           "C4LFCAC1"
+    #define FRAME_CACHE_VERSION         1U
+    #define FRAME_CACHE_HEADER_SIZE     4096U
+    #define FRAME_CACHE_GROUPS_OFFSET   256U
+    #define FRAME_CACHE_KEY_FREE        0xFFFFFFFFU
+    #define FRAME_CACHE_IS_POWER_OF_TWO(__X)    (((__X) != 0U) && (((__X) & ((__X) - 1U)) == 0U))
+#endif /*  __FRAME_CACHE_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct frame_cache_entry_t
+{
+    u32             seq;            /* odd while written, 0 if the id was never seen */
+    u32             reserved;
+    u64             changes;        /* updates that changed length or payload */
+    can_frame_rec   frame;
+} __attribute__ ((aligned(64)));
+
+typedef struct frame_cache_entry_t frame_cache_entry;
+
+_Static_assert(sizeof(frame_cache_entry) == 128U, "frame_cache_entry must fill two cache lines");
+
+// file header, the group change counters follow at FRAME_CACHE_GROUPS_OFFSET 
+struct frame_cache_file_t
+{
+    char magic[8];
+    u32  version;
+    u32  ext_slots;
+    u64  created_ns;
+    u32  entry_size;
+    u32  group_count;
+    u64  updates;           /* frames written by the RX thread */
+    u64  ext_dropped;       /* 29 bit ids that found the hash full */
+    u32  ext_count;
+    u32  reserved;
+};
+
+typedef struct frame_cache_file_t frame_cache_file;
+
+struct frame_cache_t
+{
+    int                 fd;
+    __boolean           read_only;
+    frame_cache_file*   file;
+    u64*                groups;         /* std groups first, then ext groups */
+    frame_cache_entry*  std;
+    u32*                ext_keys;       /* 29 bit id, FRAME_CACHE_KEY_FREE if unused */
+    frame_cache_entry*  ext;
+    u32                 ext_mask;
+    u32                 group_count;
+    u64                 map_size;
+    u8                  module_position;
+};
+
+typedef struct frame_cache_t frame_cache; 
+
+// what a reader has seen already, see frame_cache_poll() 
+struct frame_cache_cursor_t
+{
+    u64*    groups;
+    u64*    changes;        /* per entry, std entries first */
+    u32     group_count;
+};
+
+typedef struct frame_cache_cursor_t frame_cache_cursor;
+
+typedef void (*frame_cache_visit)(void* const ctx, can_frame_rec const * const frame, u64 changes);
+
+#ifdef __FRAME_CACHE_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean frame_cache_open(frame_cache* const me, u8 __id, char const * const path, u32 ext_slots);
+__boolean frame_cache_open_read_only(frame_cache* const me, char const * const path);
+void frame_cache_close(frame_cache* const me);
+
+__boolean frame_cache_update(frame_cache* const me, can_frame_rec const * const frame);
+u32 frame_cache_update_batch(frame_cache* const me, can_frame_rec const * const frames, u32 count);
+
+__boolean frame_cache_read(frame_cache const * const me, u32 can_id, can_frame_rec* const frame, u64* const changes);
+__boolean frame_cache_cursor_init(frame_cache const * const me, frame_cache_cursor* const cursor);
+void frame_cache_cursor_destruct(frame_cache_cursor* const cursor);
+u32 frame_cache_poll(frame_cache const * const me, frame_cache_cursor* const cursor, frame_cache_visit visit, void* const ctx);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static __boolean frame_cache_map(frame_cache* const me, u32 ext_slots);
+static u64 frame_cache_file_size(u32 ext_slots);
+static frame_cache_entry* frame_cache_slot(frame_cache* const me, u32 can_id);
+static frame_cache_entry const * frame_cache_find(frame_cache const * const me, u32 can_id);
+static __boolean frame_cache_copy(frame_cache_entry const * const entry, can_frame_rec* const frame, u64* const changes);
+
+#else 
+
+extern __boolean frame_cache_open(frame_cache* const me, u8 __id, char const * const path, u32 ext_slots);
+extern __boolean frame_cache_open_read_only(frame_cache* const me, char const * const path);
+extern void frame_cache_close(frame_cache* const me);
+
+extern __boolean frame_cache_update(frame_cache* const me, can_frame_rec const * const frame);
+extern u32 frame_cache_update_batch(frame_cache* const me, can_frame_rec const * const frames, u32 count);
+
+extern __boolean frame_cache_read(frame_cache const * const me, u32 can_id, can_frame_rec* const frame, u64* const changes);
+extern __boolean frame_cache_cursor_init(frame_cache const * const me, frame_cache_cursor* const cursor);
+extern void frame_cache_cursor_destruct(frame_cache_cursor* const cursor);
+extern u32 frame_cache_poll(frame_cache const * const me, frame_cache_cursor* const cursor, frame_cache_visit visit, void* const ctx);
+
+#endif /* __FRAME_CACHE_H_ */
@@ -0,0 +1,169 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Merge of several time ordered frame streams into one timeline, e.g. the per bus rings 
+// of can0..can7 or capture segments and candump logs of different buses. A loser tree 
+// over the sources picks the oldest head frame with log2(N) comparisons per frame.
+//
+// The output is a batch of pointers into the sources: ring frames are handed out in 
+// place (peek), frames of files from a small decode buffer per source. They stay valid 
+// until the next batch, so consumers like capture_write_ptrs() or can_socket_send_ptrs() 
+// work on them without another copy.
+//
+// Live rings are only ordered against each other up to the reorder window: while a 
+// ring is empty a frame is emitted once it is older than now - window, a frame that 
+// arrives later than that is still emitted and counted as late.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define FRAME_MERGE_MAX_SOURCES         64U
+#define FRAME_MERGE_FILE_BATCH          256U
+#define FRAME_MERGE_DEFAULT_WINDOW_NS   2000000ULL
+#define FRAME_MERGE_NONE                0xFFFFFFFFU
+#define FRAME_MERGE_KEEP_BUS            0xFFU
+
+// now_ns of merges that never wait for empty sources, e.g. of files 
+#define FRAME_MERGE_OFFLINE             0xFFFFFFFFFFFFFFFFULL
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __FRAME_MERGE_H_
+    #define FRAME_MERGE_MODULE_NAME     "FRAME_MERGE"
+    #define FRAME_MERGE_SOURCE_RING     1U
+    #define FRAME_MERGE_SOURCE_FILE     2U
+
+    // tree keys: frames 2 * ts + 1, an empty live ring 2 * (now - window) + 2 so frames of 
+    // that age still win, a source that needs a refill 0 and a drained one the maximum 
+    #define FRAME_MERGE_KEY_REFILL      0ULL
+    #define FRAME_MERGE_KEY_END         0xFFFFFFFFFFFFFFFFULL
+    #define FRAME_MERGE_KEY_FRAME(__TS)     (((__TS) << 1U) | 1U)
+    #define FRAME_MERGE_KEY_WAIT(__TS)      (((__TS) << 1U) + 2U)
+#endif /*  __FRAME_MERGE_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct frame_merge_source_t
+{
+    u8              type;
+    u8              bus;            /* file frames are moved to it unless FRAME_MERGE_KEEP_BUS */
+    __boolean       finished;       /* ring: producer is done, file: end reached */
+    frame_ring*     ring;
+    replay_source*  file;
+    can_frame_rec*  buffer;         /* decode buffer of a file */
+    can_frame_rec*  window;         /* frames of the batch */
+    u32             pos;            /* next frame of the window */
+    u32             count;
+    u64             frames;
+    u64             late;
+};
+
+typedef struct frame_merge_source_t frame_merge_source;
+
+struct frame_merge_stats_t
+{
+    u64 frames;
+    u64 batches;
+    u64 late;               /* emitted after a newer frame */
+    u64 waits;              /* batches that ended at the reorder window */
+};
+
+typedef struct frame_merge_stats_t frame_merge_stats;
+
+struct frame_merge_t
+{
+    frame_merge_source  sources[FRAME_MERGE_MAX_SOURCES];
+    u64                 keys[FRAME_MERGE_MAX_SOURCES];
+    u32                 tree[FRAME_MERGE_MAX_SOURCES];     /* [0] winner, [1..] losers */
+    u32                 source_count;
+    u32                 leaves;
+    u64                 window_ns;
+    u64                 last_ns;
+    frame_merge_stats   stats;
+    u8                  module_position;
+};
+
+typedef struct frame_merge_t frame_merge; 
+
+#ifdef __FRAME_MERGE_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean frame_merge_init(frame_merge* const me, u8 __id, u64 window_ns);
+void frame_merge_destruct(frame_merge* const me);
+
+u32 frame_merge_add_ring(frame_merge* const me, frame_ring* const ring);
+u32 frame_merge_add_file(frame_merge* const me, replay_source* const file, u8 bus);
+void frame_merge_finish(frame_merge* const me, u32 source);
+
+u32 frame_merge_next(frame_merge* const me, can_frame_rec const ** const frames, u32 max, u64 now_ns);
+void frame_merge_release(frame_merge* const me);
+__boolean frame_merge_done(frame_merge const * const me);
+void frame_merge_get_stats(frame_merge const * const me, frame_merge_stats* const stats);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static void frame_merge_refill(frame_merge_source* const source);
+static u64 frame_merge_key(frame_merge_source* const source, u64 wait_key);
+static void frame_merge_build(frame_merge* const me);
+static inline void frame_merge_replay(frame_merge* const me, u32 leaf);
+static inline __boolean frame_merge_less(frame_merge const * const me, u32 a, u32 b);
+
+#else 
+
+extern __boolean frame_merge_init(frame_merge* const me, u8 __id, u64 window_ns);
+extern void frame_merge_destruct(frame_merge* const me);
+
+extern u32 frame_merge_add_ring(frame_merge* const me, frame_ring* const ring);
+extern u32 frame_merge_add_file(frame_merge* const me, replay_source* const file, u8 bus);
+extern void frame_merge_finish(frame_merge* const me, u32 source);
+
+extern u32 frame_merge_next(frame_merge* const me, can_frame_rec const ** const frames, u32 max, u64 now_ns);
+extern void frame_merge_release(frame_merge* const me);
+extern __boolean frame_merge_done(frame_merge const * const me);
+extern void frame_merge_get_stats(frame_merge const * const me, frame_merge_stats* const stats);
+
+#endif /* __FRAME_MERGE_H_ */
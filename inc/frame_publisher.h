@@ -0,0 +1,216 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Publish server for local clients on a UNIX stream socket. A client subscribes with 
+// text lines and reads a stream of binary frame records:
+//
+//   filter ID[/MASK][@BUS]    frames with ((id ^ ID) & MASK) == 0, hex like candump, 8 
+//                             digits are a 29 bit id; without MASK the id has to match 
+//   filter all                every frame, error frames included 
+//   clear                     no frames until the next filter 
+//
+// A record is the first 16 bytes of can_frame_rec (timestamp_ns, can_id, len, flags, 
+// bus, reserved) in host byte order followed by len payload bytes.
+//
+// Frames come from frame_rings the server consumes or from frame_publisher_publish(). 
+// Every client has a bounded byte queue; a full queue drops the frame or disconnects 
+// the client, as configured. Queues are written with one gather write over their two 
+// ring segments once the queued bytes reach the batch size of the client or the oldest 
+// frame waited latency_ns. The batch size follows the measured rate of the client: 
+// half of what arrives within latency_ns, so slow feeds go out at once and fast ones in 
+// large writes. A client whose socket is full waits for EPOLLOUT with the data queued.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define FRAME_PUBLISHER_MAX_CLIENTS         32U
+#define FRAME_PUBLISHER_MAX_SOURCES         8U
+#define FRAME_PUBLISHER_MAX_FILTERS         16U
+#define FRAME_PUBLISHER_RECORD_HEADER       16U                 /* bytes in front of the payload */
+#define FRAME_PUBLISHER_ANY_BUS             0xFFU
+#define FRAME_PUBLISHER_DEFAULT_QUEUE       (256U * 1024U)      /* bytes per client */
+#define FRAME_PUBLISHER_DEFAULT_LATENCY_NS  1000000U
+
+// what happens to a frame that does not fit the queue of a client 
+#define FRAME_PUBLISHER_DROP                0U
+#define FRAME_PUBLISHER_DISCONNECT          1U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __FRAME_PUBLISHER_H_
+    #define FRAME_PUBLISHER_MODULE_NAME     "FRAME_PUBLISHER"
+    #define FRAME_PUBLISHER_MIN_QUEUE       4096U
+    #define FRAME_PUBLISHER_SOURCE_BATCH    256U
+    #define FRAME_PUBLISHER_SOURCE_ROUNDS   16U                 /* batches per source and round */
+    #define FRAME_PUBLISHER_BACKLOG         16
+    #define FRAME_PUBLISHER_IS_POWER_OF_TWO(__X)   (((__X) != 0U) && (((__X) & ((__X) - 1U)) == 0U))
+#endif /*  __FRAME_PUBLISHER_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct frame_publisher_config_t
+{
+    u32 queue_bytes;            /* per client, power of two, 0 for the default */
+    u64 latency_ns;             /* longest a frame waits for its batch, 0 for the default */
+    u8  policy;                 /* FRAME_PUBLISHER_DROP or FRAME_PUBLISHER_DISCONNECT */
+    u32 sndbuf;                 /* SO_SNDBUF of the clients, 0 keeps the system default */
+};
+
+typedef struct frame_publisher_config_t frame_publisher_config;
+
+// can_id and mask in kernel layout, see can_gateway_rule 
+struct frame_publisher_filter_t
+{
+    u32 can_id;
+    u32 mask;
+    u8  bus;                    /* FRAME_PUBLISHER_ANY_BUS for all */
+};
+
+typedef struct frame_publisher_filter_t frame_publisher_filter;
+
+struct frame_publisher_client_stats_t
+{
+    u64 frames;                 /* queued */
+    u64 dropped;                /* queue full */
+    u64 bytes;                  /* written to the socket */
+    u64 writes;
+    u64 blocked;                /* writes the socket did not take completely */
+    u32 batch_bytes;            /* current batch size */
+    u32 queue_hwm;              /* most bytes queued */
+};
+
+typedef struct frame_publisher_client_stats_t frame_publisher_client_stats;
+
+struct frame_publisher_client_t
+{
+    struct frame_publisher_t*       owner;
+    int                             fd;             /* -1 for a free slot */
+    u8*                             queue;
+    u32                             mask;           /* queue bytes - 1 */
+    u64                             head;           /* bytes queued so far */
+    u64                             tail;           /* bytes written so far */
+    u64                             oldest_ns;      /* queue time of the oldest unwritten frame */
+    u64                             rate;           /* bytes per second, smoothed */
+    u64                             rate_head;      /* head at rate_ns */
+    u64                             rate_ns;
+    __boolean                       blocked;        /* waiting for EPOLLOUT */
+    frame_publisher_filter          filters[FRAME_PUBLISHER_MAX_FILTERS];
+    u32                             filter_count;
+    char                            command[64];
+    u32                             command_len;
+    frame_publisher_client_stats    stats;
+};
+
+typedef struct frame_publisher_client_t frame_publisher_client;
+
+struct frame_publisher_stats_t
+{
+    u64 frames;                 /* taken from the sources and frame_publisher_publish() */
+    u64 accepted;
+    u64 rejected;               /* all client slots taken */
+    u64 disconnected;           /* by the policy */
+    u64 closed;                 /* by the client or a socket error */
+};
+
+typedef struct frame_publisher_stats_t frame_publisher_stats;
+
+struct frame_publisher_t
+{
+    epoll_handler           loop;
+    int                     listen_fd;
+    char                    path[108];
+    frame_publisher_config  config;
+    frame_ring*             sources[FRAME_PUBLISHER_MAX_SOURCES];
+    u32                     source_count;
+    frame_publisher_client  clients[FRAME_PUBLISHER_MAX_CLIENTS];
+    u32                     client_count;
+    u64                     now_ns;                 /* CLOCK_MONOTONIC of the current round */
+    frame_publisher_stats   stats;
+    u8                      module_position;
+};
+
+typedef struct frame_publisher_t frame_publisher; 
+
+#ifdef __FRAME_PUBLISHER_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean frame_publisher_init(frame_publisher* const me, u8 __id, char const * const path, frame_publisher_config const * const config);
+void frame_publisher_destruct(frame_publisher* const me);
+
+__boolean frame_publisher_add_source(frame_publisher* const me, frame_ring* const ring);
+u32 frame_publisher_publish(frame_publisher* const me, can_frame_rec const * const frames, u32 count);
+u32 frame_publisher_process(frame_publisher* const me, s32 timeout_ms);
+
+void frame_publisher_get_stats(frame_publisher const * const me, frame_publisher_stats* const stats);
+__boolean frame_publisher_get_client_stats(frame_publisher const * const me, u32 client, frame_publisher_client_stats* const stats);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static void frame_publisher_on_listen(void* ctx, int fd, u32 events);
+static void frame_publisher_on_client(void* ctx, int fd, u32 events);
+static void frame_publisher_command(frame_publisher_client* const client, char* const line);
+static void frame_publisher_fan_out(frame_publisher* const me, can_frame_rec const * const frame);
+static void frame_publisher_flush(frame_publisher* const me, frame_publisher_client* const client);
+static void frame_publisher_adapt(frame_publisher* const me, frame_publisher_client* const client);
+static void frame_publisher_close_client(frame_publisher* const me, frame_publisher_client* const client);
+static s32 frame_publisher_timeout(frame_publisher const * const me, s32 timeout_ms);
+static inline u64 frame_publisher_batch(frame_publisher const * const me, frame_publisher_client const * const client);
+static inline u64 frame_publisher_now(void);
+
+#else 
+
+extern __boolean frame_publisher_init(frame_publisher* const me, u8 __id, char const * const path, frame_publisher_config const * const config);
+extern void frame_publisher_destruct(frame_publisher* const me);
+
+extern __boolean frame_publisher_add_source(frame_publisher* const me, frame_ring* const ring);
+extern u32 frame_publisher_publish(frame_publisher* const me, can_frame_rec const * const frames, u32 count);
+extern u32 frame_publisher_process(frame_publisher* const me, s32 timeout_ms);
+
+extern void frame_publisher_get_stats(frame_publisher const * const me, frame_publisher_stats* const stats);
+extern __boolean frame_publisher_get_client_stats(frame_publisher const * const me, u32 client, frame_publisher_client_stats* const stats);
+
+#endif /* __FRAME_PUBLISHER_H_ */
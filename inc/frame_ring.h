@@ -0,0 +1,126 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Lock free single producer / single consumer ring of can_frame_rec. Both sides work on 
+// batches of slots inside the ring (reserve/commit and peek/release), frames are 
+// written and consumed in place without copying them through the ring.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE MACROS 
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __FRAME_RING_H_
+    #define FRAME_RING_IS_POWER_OF_TWO(__X)  (((__X) != 0U) && (((__X) & ((__X) - 1U)) == 0U))
+#endif /* __FRAME_RING_H_ */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define FRAME_RING_CACHE_LINE   64U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __FRAME_RING_H_
+    #define FRAME_RING_MODULE_NAME "FRAME_RING"
+#endif /*  __FRAME_RING_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+// producer and consumer indexes live on their own cache lines, each side keeps a 
+// private copy of the other index and only reloads it when the ring looks full/empty
+struct frame_ring_t
+{
+    can_frame_rec* slots;
+    u32            mask;
+    u8             module_position;
+
+    u64 head                __attribute__ ((aligned(FRAME_RING_CACHE_LINE)));   /* written by producer */
+    u64 cached_tail;
+
+    u64 tail                __attribute__ ((aligned(FRAME_RING_CACHE_LINE)));   /* written by consumer */
+    u64 cached_head;
+
+    u64 dropped             __attribute__ ((aligned(FRAME_RING_CACHE_LINE)));
+};
+
+typedef struct frame_ring_t frame_ring; 
+
+typedef struct frame_ring_t* frame_ring_ptr; 
+
+#ifdef __FRAME_RING_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean frame_ring_init(frame_ring* const me, u8 __id, can_frame_rec* const storage, u32 capacity);
+void frame_ring_destruct(frame_ring* const me);
+
+u32 frame_ring_reserve(frame_ring* const me, can_frame_rec** const slots, u32 max);
+void frame_ring_commit(frame_ring* const me, u32 count);
+__boolean frame_ring_push(frame_ring* const me, can_frame_rec const * const frame);
+
+u32 frame_ring_peek(frame_ring* const me, can_frame_rec** const slots, u32 max);
+void frame_ring_release(frame_ring* const me, u32 count);
+__boolean frame_ring_pop(frame_ring* const me, can_frame_rec* const frame);
+
+u32 frame_ring_count(frame_ring const * const me);
+u32 frame_ring_capacity(frame_ring const * const me);
+u64 frame_ring_dropped(frame_ring const * const me);
+
+#else 
+
+extern __boolean frame_ring_init(frame_ring* const me, u8 __id, can_frame_rec* const storage, u32 capacity);
+extern void frame_ring_destruct(frame_ring* const me);
+
+extern u32 frame_ring_reserve(frame_ring* const me, can_frame_rec** const slots, u32 max);
+extern void frame_ring_commit(frame_ring* const me, u32 count);
+extern __boolean frame_ring_push(frame_ring* const me, can_frame_rec const * const frame);
+
+extern u32 frame_ring_peek(frame_ring* const me, can_frame_rec** const slots, u32 max);
+extern void frame_ring_release(frame_ring* const me, u32 count);
+extern __boolean frame_ring_pop(frame_ring* const me, can_frame_rec* const frame);
+
+extern u32 frame_ring_count(frame_ring const * const me);
+extern u32 frame_ring_capacity(frame_ring const * const me);
+extern u64 frame_ring_dropped(frame_ring const * const me);
+
+#endif /* __FRAME_RING_H_ */
@@ -0,0 +1,259 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// ISO-TP (ISO 15765-2) in user space on top of can_socket, for classic CAN and CAN FD 
+// with normal addressing. One engine runs any number of sessions, a session is one 
+// tx/rx id pair and is found through the id table by the id its frames arrive on. 
+// Segmented messages are reassembled straight into buffers of a fixed pool and handed 
+// to the receive callback in place, single frames are handed out from the frame itself.
+// N_Bs, N_Cr and STmin of all sessions run on one timer wheel, and every frame produced 
+// while handling a batch of received frames or expired timers leaves with one batch.
+//
+// The engine is single threaded: isotp_receive(), isotp_poll() (or isotp_process() 
+// that does both with the socket) and the session calls belong to one thread.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define ISOTP_NONE                  0xFFFFFFFFU
+#define ISOTP_CLASSIC_DL            8U
+#define ISOTP_FF_DL_12BIT_MAX       4095U       /* longer messages use the 32 bit escape */
+#define ISOTP_TX_BATCH              256U
+
+// session flags 
+#define ISOTP_FLAG_PADDING          0x01U       /* pad classic frames to 8 bytes */
+#define ISOTP_FLAG_BRS              0x02U       /* bit rate switch on CAN FD frames */
+
+// results, given to the callbacks and returned by isotp_send() 
+#define ISOTP_OK                    0
+#define ISOTP_ERR_BUSY              (-1)        /* a message is still being sent */
+#define ISOTP_ERR_TIMEOUT_BS        (-2)        /* no flow control from the receiver */
+#define ISOTP_ERR_TIMEOUT_CR        (-3)        /* consecutive frame missing */
+#define ISOTP_ERR_WRONG_SN          (-4)
+#define ISOTP_ERR_OVERFLOW          (-5)        /* the receiver has no room */
+#define ISOTP_ERR_UNEXPECTED        (-6)        /* a new message interrupted the running one */
+#define ISOTP_ERR_WFT_OVERRUN       (-7)        /* too many flow control WAITs */
+#define ISOTP_ERR_NO_BUFFER         (-8)        /* pool empty or message bigger than a buffer */
+#define ISOTP_ERR_INVALID           (-9)
+#define ISOTP_ERR_ABORTED           (-10)       /* session closed */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __ISOTP_H_
+    #define ISOTP_MODULE_NAME       "ISOTP"
+
+    #define ISOTP_PCI_SF            0x00U
+    #define ISOTP_PCI_FF            0x10U
+    #define ISOTP_PCI_CF            0x20U
+    #define ISOTP_PCI_FC            0x30U
+
+    #define ISOTP_FC_CTS            0x00U
+    #define ISOTP_FC_WAIT           0x01U
+    #define ISOTP_FC_OVERFLOW       0x02U
+
+    #define ISOTP_N_BS_NS           1000000000ULL
+    #define ISOTP_N_CR_NS           1000000000ULL
+    #define ISOTP_WFT_MAX           16U
+    #define ISOTP_PAD_BYTE          0xCCU
+
+    #define ISOTP_WHEEL_SLOTS       1024U
+    #define ISOTP_WHEEL_TICK_NS     100000ULL   /* finest STmin */
+
+    #define ISOTP_TX_IDLE           0U
+    #define ISOTP_TX_WAIT_FC        1U
+    #define ISOTP_TX_SENDING        2U
+
+    #define ISOTP_RX_IDLE           0U
+    #define ISOTP_RX_RECEIVING      1U
+#endif /*  __ISOTP_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct isotp_config_t
+{
+    u32     tx_id;          /* kernel layout */
+    u32     rx_id;          /* kernel layout, unique within the engine */
+    u8      tx_dl;          /* 8 for classic CAN, 12..64 for CAN FD */
+    u8      block_size;     /* BS granted in our flow control, 0: no limit */
+    u8      st_min;         /* STmin asked for in our flow control, raw encoding */
+    u8      flags;          /* ISOTP_FLAG_xxx */
+};
+
+typedef struct isotp_config_t isotp_config;
+
+struct isotp_session_t
+{
+    timer_wheel_node    tx_timer;       /* N_Bs or STmin */
+    timer_wheel_node    rx_timer;       /* N_Cr */
+    isotp_config        config;
+    u8                  in_use;
+
+    // sender 
+    u8                  tx_state;
+    u8                  tx_sn;
+    u8                  tx_wait_count;
+    u8                  tx_block_size;  /* BS of the receiver */
+    u8                  tx_block_left;
+    u8 const *          tx_data;        /* caller's message, until the send callback */
+    u32                 tx_len;
+    u32                 tx_pos;
+    u64                 tx_st_min_ns;   /* STmin of the receiver */
+
+    // receiver 
+    u8                  rx_state;
+    u8                  rx_sn;
+    u8                  rx_block_count;
+    u8                  rx_dl;          /* frame length the sender uses */
+    u8*                 rx_buffer;      /* from the pool */
+    u32                 rx_len;
+    u32                 rx_pos;
+
+    u64                 messages_tx;
+    u64                 messages_rx;
+    u64                 errors;
+};
+
+typedef struct isotp_session_t isotp_session;
+
+// a received message, data is only valid during the call; NULLPTR with result < 0 
+typedef void (*isotp_receive_callback)(void* ctx, u32 session, u8 const * data, u32 len, s32 result);
+// the message given to isotp_send() is done with 
+typedef void (*isotp_sent_callback)(void* ctx, u32 session, s32 result);
+// frames to be sent when the engine has no socket 
+typedef u32 (*isotp_output_callback)(void* ctx, can_frame_rec* frames, u32 count);
+
+struct isotp_engine_t
+{
+    can_socket*             socket;
+    isotp_output_callback   output;
+    void*                   output_ctx;
+    isotp_receive_callback  on_receive;
+    isotp_sent_callback     on_sent;
+    void*                   ctx;
+
+    isotp_session*          sessions;
+    u32*                    free_sessions;
+    u32                     free_session_count;
+    u32                     max_sessions;
+    can_id_table            rx_index;       /* rx id -> session */
+    timer_wheel             wheel;
+
+    // reassembly buffers 
+    u8*                     pool;
+    u32*                    free_buffers;
+    u32                     free_buffer_count;
+    u32                     buffer_count;
+    u32                     buffer_size;
+
+    can_frame_rec*          tx_frames;      /* ISOTP_TX_BATCH */
+    u32                     tx_count;
+    can_frame_rec*          rx_frames;      /* CAN_SOCKET_MAX_BATCH, for isotp_process() */
+    u64                     now_ns;         /* time of the running call */
+
+    u64                     frames_rx;
+    u64                     frames_tx;
+    u64                     frames_dropped; /* not accepted by the socket */
+    u64                     messages_rx;
+    u64                     messages_tx;
+    u64                     errors;
+    u8                      module_position;
+};
+
+typedef struct isotp_engine_t isotp_engine; 
+
+#ifdef __ISOTP_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean isotp_init(isotp_engine* const me, u8 __id, can_socket* const socket, u32 max_sessions, u32 buffer_count, u32 buffer_size, u64 now_ns);
+void isotp_destruct(isotp_engine* const me);
+void isotp_set_callbacks(isotp_engine* const me, isotp_receive_callback on_receive, isotp_sent_callback on_sent, void* ctx);
+void isotp_set_output(isotp_engine* const me, isotp_output_callback output, void* ctx);
+
+u32 isotp_open(isotp_engine* const me, isotp_config const * const config);
+void isotp_close(isotp_engine* const me, u32 session);
+u32 isotp_find(isotp_engine const * const me, u32 tx_id, u32 rx_id);
+s32 isotp_send(isotp_engine* const me, u32 session, u8 const * const data, u32 len, u64 now_ns);
+
+u32 isotp_receive(isotp_engine* const me, can_frame_rec const * const frames, u32 count, u64 now_ns);
+u32 isotp_poll(isotp_engine* const me, u64 now_ns);
+u32 isotp_process(isotp_engine* const me, u64 now_ns);
+u32 isotp_flush(isotp_engine* const me);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static can_frame_rec* isotp_next_frame(isotp_engine* const me, isotp_session const * const session);
+static void isotp_finish_frame(isotp_session const * const session, can_frame_rec* const frame, u32 len);
+static void isotp_send_flow_control(isotp_engine* const me, isotp_session const * const session, u8 status);
+static void isotp_send_consecutive(isotp_engine* const me, u32 index);
+static void isotp_tx_done(isotp_engine* const me, u32 index, s32 result);
+static void isotp_rx_abort(isotp_engine* const me, u32 index, s32 result);
+static void isotp_rx_single(isotp_engine* const me, u32 index, can_frame_rec const * const frame);
+static void isotp_rx_first(isotp_engine* const me, u32 index, can_frame_rec const * const frame);
+static void isotp_rx_consecutive(isotp_engine* const me, u32 index, can_frame_rec const * const frame);
+static void isotp_rx_flow_control(isotp_engine* const me, u32 index, can_frame_rec const * const frame);
+static void isotp_timer_expired(void* ctx, timer_wheel_node* node);
+static inline u64 isotp_st_min_ns(u8 st_min);
+static inline u32 isotp_frame_len(u32 len);
+
+#else 
+
+extern __boolean isotp_init(isotp_engine* const me, u8 __id, can_socket* const socket, u32 max_sessions, u32 buffer_count, u32 buffer_size, u64 now_ns);
+extern void isotp_destruct(isotp_engine* const me);
+extern void isotp_set_callbacks(isotp_engine* const me, isotp_receive_callback on_receive, isotp_sent_callback on_sent, void* ctx);
+extern void isotp_set_output(isotp_engine* const me, isotp_output_callback output, void* ctx);
+
+extern u32 isotp_open(isotp_engine* const me, isotp_config const * const config);
+extern void isotp_close(isotp_engine* const me, u32 session);
+extern u32 isotp_find(isotp_engine const * const me, u32 tx_id, u32 rx_id);
+extern s32 isotp_send(isotp_engine* const me, u32 session, u8 const * const data, u32 len, u64 now_ns);
+
+extern u32 isotp_receive(isotp_engine* const me, can_frame_rec const * const frames, u32 count, u64 now_ns);
+extern u32 isotp_poll(isotp_engine* const me, u64 now_ns);
+extern u32 isotp_process(isotp_engine* const me, u64 now_ns);
+extern u32 isotp_flush(isotp_engine* const me);
+
+#endif /* __ISOTP_H_ */
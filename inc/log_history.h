@@ -0,0 +1,203 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Persistent circular history of log records, kept in a memory mapped file. 
+// Records are written with plain stores into the shared mapping, the page cache keeps 
+// them alive when the process crashes; log_history_sync() pushes them to the medium.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE MACROS 
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __LOG_HISTORY_H_
+    #define LOG_HISTORY_IS_POWER_OF_TWO(__X)  (((__X) != 0U) && (((__X) & ((__X) - 1U)) == 0U))
+    #define LOG_HISTORY_SLOT(__ME, __SEQ)     ((log_history_slot*) ((__ME)->records + \
+                                              (((__SEQ) & ((__ME)->slot_count - 1U)) * (__ME)->record_size)))
+#endif /* __LOG_HISTORY_H_ */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define LOG_HISTORY_MIN_RECORD_SIZE     64U
+#define LOG_HISTORY_MAX_RECORD_SIZE     4096U
+#define LOG_HISTORY_DEFAULT_RECORD_SIZE 128U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __LOG_HISTORY_H_
+    #define LOG_HISTORY_MODULE_NAME  "LOG_HISTORY"
+    #define LOG_HISTORY_MAGIC        "C4LHIST1"
+    #define LOG_HISTORY_VERSION      1U
+    #define LOG_HISTORY_HEADER_SIZE  4096U
+    // a torn record of a writer that died half way must not stop the recovery walk, 
+    // allow as many holes as there can be concurrent writers 
+    #define LOG_HISTORY_MAX_HOLES    64U
+#endif /*  __LOG_HISTORY_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+// on-disk layout of a record slot, the message follows the header directly
+struct log_history_slot_t
+{
+    u64 seq;                /* 0 while the slot is being written */
+    u64 timestamp_ns;       /* CLOCK_REALTIME */
+    u32 crc;                /* CRC-32C over header (crc = 0) and message */
+    u16 len;
+    u8  level;
+    u8  module_id;
+    u8  reserved[8];
+};
+
+typedef struct log_history_slot_t log_history_slot;
+
+// on-disk file header, the static part is protected by hdr_crc
+struct log_history_file_t
+{
+    char magic[8];
+    u32  version;
+    u32  record_size;
+    u64  slot_count;
+    u64  created_ns;
+    u32  hdr_crc;
+    u32  reserved;
+    u64  head_hint;         /* last sequence known complete, updated without sync */
+};
+
+typedef struct log_history_file_t log_history_file;
+
+// decoded record handed out to readers 
+struct log_history_record_t
+{
+    u64  seq;
+    u64  timestamp_ns;
+    u8   level;
+    u8   module_id;
+    u16  len;
+    char msg[LOG_HISTORY_MAX_RECORD_SIZE];
+};
+
+typedef struct log_history_record_t log_history_record;
+
+struct log_history_t
+{
+    int               fd;
+    __boolean         read_only;
+    log_history_file* file;
+    u8*               records;
+    u64               map_size;
+    u64               slot_count;
+    u32               record_size;
+    u64               next_seq;     /* last handed out sequence, shared by writers */
+};
+
+typedef struct log_history_t log_history;
+
+typedef struct log_history_t* log_history_ptr;
+
+typedef void (*log_history_visit)(void* const ctx, log_history_record const * const record);
+
+#ifdef __LOG_HISTORY_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean log_history_open(log_history* const me, u8 __id, char const * const path, u64 capacity, u32 record_size);
+__boolean log_history_open_read_only(log_history* const me, char const * const path);
+void log_history_close(log_history* const me);
+
+__boolean log_history_append(log_history* const me, u8 level, u8 module_id, char const * const msg, u16 len);
+__boolean log_history_sync(log_history* const me, __boolean blocking);
+
+__boolean log_history_get(log_history const * const me, u64 seq, log_history_record* const record);
+u64 log_history_newest_seq(log_history const * const me);
+u64 log_history_oldest_seq(log_history const * const me);
+u64 log_history_for_each(log_history const * const me, u64 from_seq, log_history_visit visit, void* const ctx);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static __boolean log_history_map(log_history* const me, u64 capacity, u32 record_size);
+static __boolean log_history_header_valid(log_history_file const * const file, u64 map_size);
+static __boolean log_history_header_blank(log_history_file const * const file);
+static void log_history_format(log_history* const me, u64 slot_count, u32 record_size);
+static void log_history_recover(log_history* const me);
+static inline __boolean log_history_slot_valid(log_history const * const me, u64 seq);
+static inline u32 log_history_slot_crc(log_history_slot const * const slot);
+static inline u64 log_history_now_ns(void);
+
+#else 
+
+extern __boolean log_history_open(log_history* const me, u8 __id, char const * const path, u64 capacity, u32 record_size);
+extern __boolean log_history_open_read_only(log_history* const me, char const * const path);
+extern void log_history_close(log_history* const me);
+
+extern __boolean log_history_append(log_history* const me, u8 level, u8 module_id, char const * const msg, u16 len);
+extern __boolean log_history_sync(log_history* const me, __boolean blocking);
+
+extern __boolean log_history_get(log_history const * const me, u64 seq, log_history_record* const record);
+extern u64 log_history_newest_seq(log_history const * const me);
+extern u64 log_history_oldest_seq(log_history const * const me);
+extern u64 log_history_for_each(log_history const * const me, u64 from_seq, log_history_visit visit, void* const ctx);
+
+#endif /* __LOG_HISTORY_H_ */
+
+
+
+
+#ifdef __LOG_HISTORY_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- VARIABLES   
+*****************************************************************************************
+****************************************************************************************/
+
+static u8 module_position = 0U; 
+
+#else 
+
+
+
+#endif /* __LOG_HISTORY_H_ */
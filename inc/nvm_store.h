@@ -0,0 +1,250 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Memory worker for data that has to survive a reset: counters, calibration values, 
+// learned parameters. The control thread writes and reads a RAM copy of every key and 
+// never waits for the flash; a worker thread persists the keys that changed since its 
+// last round, so a counter updated at 1 kHz costs one record per round instead of a 
+// thousand (write coalescing).
+//
+// The flash is used as a log. Records (key, length, CRC, value) are appended to the 
+// active page, older records of the key become garbage. A full page is sealed with a 
+// summary of the newest record per key it holds, so the start up only reads the page 
+// headers, the summaries and the live values instead of every record ever written. The 
+// page that was active at the reset is scanned, a torn record ends the scan.
+//
+// Garbage collection keeps two pages free: it picks the sealed page with the least live 
+// data, or the least worn one when the erase counts drift apart by more than 
+// NVM_STORE_WEAR_DELTA, so static calibration data does not pin its pages forever. New 
+// pages are taken by lowest erase count. All flash access goes through flash_sim.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define NVM_STORE_MAX_VALUE             1024U
+#define NVM_STORE_MAX_KEYS              0xFFFFU
+#define NVM_STORE_DEFAULT_INTERVAL_NS   100000000ULL
+#define NVM_STORE_NONE                  0xFFFFFFFFU
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __NVM_STORE_H_
+    #define NVM_STORE_MODULE_NAME       "NVM_STORE"
+    #define NVM_STORE_PAGE_MAGIC        0x314D564EU     /* "NVM1" */
+    #define NVM_STORE_SUMMARY_MAGIC     0x4D4D5553U     /* "SUMM" */
+    #define NVM_STORE_ERASED_KEY        0xFFFFU
+    #define NVM_STORE_ERASED_WORD       0xFFFFFFFFU
+    #define NVM_STORE_RESERVE_PAGES     2U
+    #define NVM_STORE_WEAR_DELTA        16U
+    #define NVM_STORE_PAGE_FREE         0U
+    #define NVM_STORE_PAGE_ACTIVE       1U
+    #define NVM_STORE_PAGE_SEALED       2U
+    #define NVM_STORE_ALIGN(__X, __U)   (((__X) + (__U) - 1U) & ~((__U) - 1U))
+    #define NVM_STORE_SUMMARY_SIZE(__N) (sizeof(nvm_store_summary_hdr) + ((__N) * sizeof(nvm_store_summary_entry)))
+#endif /*  __NVM_STORE_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+// on flash page header, the summary fields are programmed when the page is sealed 
+struct nvm_store_page_hdr_t
+{
+    u32 magic;
+    u32 seq;                /* order of the pages in the log */
+    u32 erase_count;        /* wear of the page, carried over its erases */
+    u32 crc;                /* over magic, seq and erase_count */
+    u32 summary_offset;     /* 0xFFFFFFFF while the page is open */
+    u32 summary_crc;
+    u32 reserved[2];
+};
+
+typedef struct nvm_store_page_hdr_t nvm_store_page_hdr;
+
+// on flash record, the value follows, padded to the write unit 
+struct nvm_store_record_hdr_t
+{
+    u16 key;                /* 0xFFFF: erased, end of the page */
+    u16 len;
+    u32 crc;                /* over key, len and value */
+};
+
+typedef struct nvm_store_record_hdr_t nvm_store_record_hdr;
+
+struct nvm_store_summary_hdr_t
+{
+    u32 magic;
+    u32 count;
+};
+
+typedef struct nvm_store_summary_hdr_t nvm_store_summary_hdr;
+
+struct nvm_store_summary_entry_t
+{
+    u16 key;
+    u16 len;
+    u32 offset;             /* of the record header in the page */
+};
+
+typedef struct nvm_store_summary_entry_t nvm_store_summary_entry;
+
+struct nvm_store_page_t
+{
+    u8  state;              /* NVM_STORE_PAGE_xxx */
+    u8  erased;             /* free and blank, no erase needed before use */
+    u32 seq;
+    u32 erase_count;
+    u32 used;               /* append offset of the active page */
+    u32 live;               /* bytes of records that are the newest of their key */
+    u32 keys;               /* keys whose newest record is in the page */
+};
+
+typedef struct nvm_store_page_t nvm_store_page;
+
+struct nvm_store_entry_t
+{
+    u32 page;               /* NVM_STORE_NONE if the key was never written */
+    u32 offset;
+    u32 crc;                /* of the persisted record, unchanged values are not written again */
+    u16 len;
+};
+
+typedef struct nvm_store_entry_t nvm_store_entry;
+
+struct nvm_store_stats_t
+{
+    u64 writes;             /* nvm_store_write() calls */
+    u64 coalesced;          /* writes that replaced a value not yet persisted */
+    u64 unchanged;          /* persisted values that were equal to the flash */
+    u64 records;            /* records programmed, relocations included */
+    u64 relocated;
+    u64 gc_runs;
+    u64 wear_moves;         /* collections of the least worn page */
+    u64 seals;
+    u64 errors;
+    u64 startup_ns;
+    u32 summary_pages;      /* pages recovered from their summary */
+    u32 scanned_pages;      /* pages recovered by reading all records */
+};
+
+typedef struct nvm_store_stats_t nvm_store_stats;
+
+struct nvm_store_t
+{
+    flash_sim*          flash;
+    nvm_store_page*     pages;
+    u32                 page_count;
+    u32                 free_pages;
+    u32                 active;         /* NVM_STORE_NONE before the first write */
+    u32                 next_seq;
+    u32                 unit;           /* write unit of the flash */
+
+    // RAM image of all keys, guarded by lock; the flash side by flash_lock 
+    nvm_store_entry*    index;
+    u8*                 values;
+    u16*                lengths;
+    u64*                dirty;
+    u64*                pending;
+    u32                 max_keys;
+    u32                 max_value;
+    u8*                 scratch;        /* value being persisted */
+    u8*                 record;         /* record being programmed */
+    u8*                 summary;        /* summary block of the page being sealed */
+
+    pthread_mutex_t     lock;
+    pthread_mutex_t     flash_lock;
+    pthread_cond_t      wake;
+    pthread_t           thread;
+    __boolean           running;
+    u64                 interval_ns;
+
+    nvm_store_stats     stats;
+    u8                  module_position;
+};
+
+typedef struct nvm_store_t nvm_store; 
+
+#ifdef __NVM_STORE_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean nvm_store_init(nvm_store* const me, u8 __id, flash_sim* const flash, u32 max_keys, u32 max_value);
+void nvm_store_destruct(nvm_store* const me);
+
+__boolean nvm_store_start(nvm_store* const me, u64 interval_ns);
+void nvm_store_stop(nvm_store* const me);
+
+__boolean nvm_store_write(nvm_store* const me, u32 key, void const * const data, u32 len);
+u32 nvm_store_read(nvm_store* const me, u32 key, void* const data, u32 max);
+u32 nvm_store_flush(nvm_store* const me);
+void nvm_store_get_stats(nvm_store* const me, nvm_store_stats* const stats);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static void* nvm_store_thread(void* arg);
+static __boolean nvm_store_recover(nvm_store* const me);
+static void nvm_store_recover_page(nvm_store* const me, u32 page);
+static void nvm_store_take(nvm_store* const me, u32 page, u32 offset, u16 key, u16 len);
+static __boolean nvm_store_append(nvm_store* const me, u32 key, u8 const * const value, u32 len);
+static __boolean nvm_store_open_page(nvm_store* const me);
+static void nvm_store_seal(nvm_store* const me);
+static void nvm_store_collect(nvm_store* const me);
+static __boolean nvm_store_relocate(nvm_store* const me, u32 page);
+static u32 nvm_store_record_crc(u32 key, u32 len, u8 const * const value);
+static inline u32 nvm_store_record_size(nvm_store const * const me, u32 len);
+
+#else 
+
+extern __boolean nvm_store_init(nvm_store* const me, u8 __id, flash_sim* const flash, u32 max_keys, u32 max_value);
+extern void nvm_store_destruct(nvm_store* const me);
+
+extern __boolean nvm_store_start(nvm_store* const me, u64 interval_ns);
+extern void nvm_store_stop(nvm_store* const me);
+
+extern __boolean nvm_store_write(nvm_store* const me, u32 key, void const * const data, u32 len);
+extern u32 nvm_store_read(nvm_store* const me, u32 key, void* const data, u32 max);
+extern u32 nvm_store_flush(nvm_store* const me);
+extern void nvm_store_get_stats(nvm_store* const me, nvm_store_stats* const stats);
+
+#endif /* __NVM_STORE_H_ */
@@ -0,0 +1,465 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Performance counters for every module of the registry (utils_register_module()). The 
+// position of a module selects its counters: operations, failures, bytes, the high 
+// watermark of a queue depth and TSC based enter/exit tracepoints with a log2 histogram 
+// of the cycles in between.
+//
+// Every module has one slot per cpu, cache line aligned, so the hot path only touches 
+// lines of its own cpu with uncontended relaxed atomics. 
+// Readers add the slots up. Without open counters the hot path is a load and a branch.
+//
+//   [header page][module table, 64 bytes per position][slots: position x cpu]
+//
+// The counters live in a memory mapped file (put it on /dev/shm), so tools read them at 
+// runtime from another process with perf_counters_open_read_only(). 
+
+#ifndef __PERF_COUNTERS_TYPES_H_
+#define __PERF_COUNTERS_TYPES_H_
+
+#include "utils.h"
+
+// glibc 2.35 and later register an rseq area per thread, the cpu is a plain load there 
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 35)))
+    #include <sys/rseq.h>
+    #define PERF_COUNTERS_HAVE_RSEQ
+#endif
+
+// tracepoints count TSC ticks on x86, the virtual counter on aarch64, else nanoseconds 
+#if !defined(__x86_64__) && !defined(__i386__) && !defined(__aarch64__)
+    #include <time.h>
+#endif
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define PERF_COUNTERS_HIST_BUCKETS      32U         /* bucket b: [2^b, 2^(b+1)) cycles */
+#define PERF_COUNTERS_NAME_SIZE         40U
+#define PERF_COUNTERS_DEFAULT_PATH      "/dev/shm/can4linux_perf"
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+// one module on one cpu, the first line is what every call touches 
+struct perf_counters_cpu_t
+{
+    u64 ops;
+    u64 failures;
+    u64 bytes;
+    u64 queue_hwm;          /* highest queue depth reported */
+    u64 cycles;             /* sum over all traces */
+    u64 max_cycles;
+    u64 reserved[2];
+    u64 histogram[PERF_COUNTERS_HIST_BUCKETS];  /* adds up to the enter/exit pairs */
+} __attribute__ ((aligned(64)));
+
+typedef struct perf_counters_cpu_t perf_counters_cpu;
+
+_Static_assert((sizeof(perf_counters_cpu) % 64U) == 0U, "perf_counters_cpu must fill whole cache lines");
+
+struct perf_counters_module_t
+{
+    char name[PERF_COUNTERS_NAME_SIZE];
+    u32  seq;               /* odd while written, counts the registrations of the position */
+    u8   id;
+    u8   active;
+    u8   reserved[18];
+};
+
+typedef struct perf_counters_module_t perf_counters_module;
+
+_Static_assert(sizeof(perf_counters_module) == 64U, "perf_counters_module must fill one cache line");
+
+struct perf_counters_file_t
+{
+    char magic[8];
+    u32  version;
+    u32  cpu_count;
+    u32  module_count;
+    u32  slot_size;         /* sizeof(perf_counters_cpu) */
+    u64  tsc_hz;            /* calibrated at open */
+    u64  created_ns;
+    u32  pid;
+    u32  reserved;
+};
+
+typedef struct perf_counters_file_t perf_counters_file;
+
+struct perf_counters_t
+{
+    int                     fd;
+    __boolean               read_only;
+    perf_counters_file*     file;
+    perf_counters_module*   modules;
+    perf_counters_cpu*      slots;          /* slots[position * cpu_count + cpu] */
+    u32                     cpu_count;
+    u64                     map_size;
+    u8                      module_position;
+};
+
+typedef struct perf_counters_t perf_counters;
+
+// all cpus of a module added up 
+struct perf_counters_total_t
+{
+    char name[PERF_COUNTERS_NAME_SIZE];
+    u8   id;
+    u64  ops;
+    u64  failures;
+    u64  bytes;
+    u64  queue_hwm;
+    u64  traces;
+    u64  cycles;
+    u64  max_cycles;
+    u64  histogram[PERF_COUNTERS_HIST_BUCKETS];
+};
+
+typedef struct perf_counters_total_t perf_counters_total;
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- VARIABLES   
+*****************************************************************************************
+****************************************************************************************/
+
+// slots of the open counters of this process, NULLPTR while there are none 
+extern perf_counters_cpu* perf_counters_active_slots;
+extern u32 perf_counters_active_cpus;
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- INLINE FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+/**
+ * @name    static inline u64 perf_counters_ticks(void)
+ * 
+ * @brief   clock of the tracepoints: rdtsc on x86, CNTVCT_EL0 on aarch64, 
+ *          CLOCK_MONOTONIC_RAW in nanoseconds elsewhere 
+ * 
+ * @param   none.
+ * 
+ * @return  u64 : ticks.
+ */
+static inline u64 perf_counters_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    u64 ticks;
+
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+#endif
+}
+
+
+/**
+ * @name    static inline u32 perf_counters_cpu_index(void)
+ * 
+ * @brief   cpu of the calling thread: the cpu_id the kernel keeps in the rseq area of 
+ *          the thread (glibc registers it), else TSC_AUX of rdtscp (node << 12 | cpu) 
+ *          on x86 and cpu 0 elsewhere, the atomics keep a shared slot correct 
+ * 
+ * @param   none.
+ * 
+ * @return  u32 : cpu, may exceed the cpus of the counters.
+ */
+static inline u32 perf_counters_cpu_index(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    u32 aux;
+#endif
+
+#ifdef PERF_COUNTERS_HAVE_RSEQ
+    if (__rseq_size != 0U)
+    {
+        return ((struct rseq const volatile *) ((u8*) __builtin_thread_pointer() + __rseq_offset))->cpu_id;
+    }
+#endif /* PERF_COUNTERS_HAVE_RSEQ */
+
+#if defined(__x86_64__) || defined(__i386__)
+    (void) __builtin_ia32_rdtscp(&aux);
+    return aux & 0xFFFU;
+#else
+    return 0U;
+#endif
+}
+
+
+/**
+ * @name    static inline perf_counters_cpu* perf_counters_slot(u8 module)
+ * 
+ * @brief   slot of a module on the cpu of the calling thread 
+ * 
+ * @param   u8 : module position 
+ * 
+ * @return  perf_counters_cpu* : slot, NULLPTR without open counters.
+ */
+static inline perf_counters_cpu* perf_counters_slot(u8 module)
+{
+    perf_counters_cpu* const slots = __atomic_load_n(&perf_counters_active_slots, __ATOMIC_ACQUIRE);
+    u32 cpus;
+    u32 cpu;
+
+    if ((slots == NULLPTR) || (module >= MAX_NUMBER_MODULES))
+    {
+        return NULLPTR;
+    }
+
+    cpus = perf_counters_active_cpus;
+    cpu  = perf_counters_cpu_index();
+    if (cpu >= cpus)
+    {
+        cpu %= cpus;
+    }
+
+    return &slots[((u32) module * cpus) + cpu];
+}
+
+
+/**
+ * @name    static inline void perf_counters_count(u8 module, u64 ops, u64 bytes)
+ * 
+ * @brief   counts operations and the bytes they moved
+ * 
+ * @param   u8  : module position 
+ *          u64 : operations 
+ *          u64 : bytes 
+ * 
+ * @return  none.
+ */
+static inline void perf_counters_count(u8 module, u64 ops, u64 bytes)
+{
+    perf_counters_cpu* const slot = perf_counters_slot(module);
+
+    if (slot != NULLPTR)
+    {
+        __atomic_fetch_add(&slot->ops, ops, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&slot->bytes, bytes, __ATOMIC_RELAXED);
+    }
+}
+
+
+/**
+ * @name    static inline void perf_counters_fail(u8 module, u64 failures)
+ * 
+ * @brief   counts failed operations
+ * 
+ * @param   u8  : module position 
+ *          u64 : failures 
+ * 
+ * @return  none.
+ */
+static inline void perf_counters_fail(u8 module, u64 failures)
+{
+    perf_counters_cpu* const slot = perf_counters_slot(module);
+
+    if (slot != NULLPTR)
+    {
+        __atomic_fetch_add(&slot->failures, failures, __ATOMIC_RELAXED);
+    }
+}
+
+
+/**
+ * @name    static inline void perf_counters_queue_depth(u8 module, u64 depth)
+ * 
+ * @brief   raises the high watermark of the queue depth, a plain load while it is lower
+ * 
+ * @param   u8  : module position 
+ *          u64 : current depth 
+ * 
+ * @return  none.
+ */
+static inline void perf_counters_queue_depth(u8 module, u64 depth)
+{
+    perf_counters_cpu* const slot = perf_counters_slot(module);
+    u64 hwm;
+
+    if (slot == NULLPTR)
+    {
+        return;
+    }
+
+    hwm = __atomic_load_n(&slot->queue_hwm, __ATOMIC_RELAXED);
+    while ((depth > hwm) && 
+           (__atomic_compare_exchange_n(&slot->queue_hwm, &hwm, depth, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) == false))
+    {
+    }
+}
+
+
+/**
+ * @name    static inline u64 perf_counters_enter(void)
+ * 
+ * @brief   start of a traced section
+ * 
+ * @param   none.
+ * 
+ * @return  u64 : ticks, 0 without open counters.
+ */
+static inline u64 perf_counters_enter(void)
+{
+    if (__atomic_load_n(&perf_counters_active_slots, __ATOMIC_RELAXED) == NULLPTR)
+    {
+        return 0U;
+    }
+
+    return perf_counters_ticks();
+}
+
+
+/**
+ * @name    static inline void perf_counters_exit(u8 module, u64 start)
+ * 
+ * @brief   end of a traced section: counts the trace and its cycles into the histogram 
+ *          of the cpu it ends on. A thread that moved cpus in between may see a TSC 
+ *          that is a little behind, such a trace counts as 0 cycles.
+ * 
+ * @param   u8  : module position 
+ *          u64 : value of perf_counters_enter()
+ * 
+ * @return  none.
+ */
+static inline void perf_counters_exit(u8 module, u64 start)
+{
+    perf_counters_cpu* slot;
+    u64 now;
+    u64 cycles;
+    u64 max;
+    u32 bucket;
+
+    if (start == 0U)
+    {
+        return;
+    }
+
+    now  = perf_counters_ticks();
+    slot = perf_counters_slot(module);
+    if (slot == NULLPTR)
+    {
+        return;
+    }
+
+    cycles = (now > start) ? (now - start) : 0U;
+    bucket = 63U - (u32) __builtin_clzll(cycles | 1U);
+    bucket = GET_MIN(bucket, PERF_COUNTERS_HIST_BUCKETS - 1U);
+
+    __atomic_fetch_add(&slot->cycles, cycles, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&slot->histogram[bucket], 1U, __ATOMIC_RELAXED);
+
+    max = __atomic_load_n(&slot->max_cycles, __ATOMIC_RELAXED);
+    while ((cycles > max) && 
+           (__atomic_compare_exchange_n(&slot->max_cycles, &max, cycles, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) == false))
+    {
+    }
+}
+
+#endif /* __PERF_COUNTERS_TYPES_H_ */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __PERF_COUNTERS_H_
+    #define PERF_COUNTERS_MODULE_NAME   "PERF_COUNTERS"
+    #define PERF_COUNTERS_MAGIC         "C4LPERF1"
+    #define PERF_COUNTERS_VERSION       1U
+    #define PERF_COUNTERS_HEADER_SIZE   4096U
+    #define PERF_COUNTERS_CALIBRATE_NS  20000000L
+#endif /*  __PERF_COUNTERS_H_   */
+
+#ifdef __PERF_COUNTERS_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean perf_counters_open(perf_counters* const me, u8 __id, char const * const path);
+__boolean perf_counters_open_read_only(perf_counters* const me, char const * const path);
+void perf_counters_close(perf_counters* const me);
+
+__boolean perf_counters_get(perf_counters const * const me, u8 module, perf_counters_total* const total);
+void perf_counters_reset(perf_counters* const me, u8 module);
+f64 perf_counters_percentile_ns(perf_counters const * const me, perf_counters_total const * const total, f64 q);
+f64 perf_counters_cycles_to_ns(perf_counters const * const me, u64 cycles);
+
+void perf_counters_on_register(u8 module, char const * const name, u8 id);
+void perf_counters_on_remove(u8 module);
+
+#ifdef RUNNING_OS 
+void perf_counters_dump(perf_counters const * const me);
+#endif /* RUNNING_OS */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static void perf_counters_map(perf_counters* const me, u32 cpu_count);
+static u64 perf_counters_file_size(u32 cpu_count);
+static u64 perf_counters_calibrate(void);
+static void perf_counters_describe(perf_counters* const me, u8 module, char const * const name, u8 id, __boolean registered);
+
+#else 
+
+extern __boolean perf_counters_open(perf_counters* const me, u8 __id, char const * const path);
+extern __boolean perf_counters_open_read_only(perf_counters* const me, char const * const path);
+extern void perf_counters_close(perf_counters* const me);
+
+extern __boolean perf_counters_get(perf_counters const * const me, u8 module, perf_counters_total* const total);
+extern void perf_counters_reset(perf_counters* const me, u8 module);
+extern f64 perf_counters_percentile_ns(perf_counters const * const me, perf_counters_total const * const total, f64 q);
+extern f64 perf_counters_cycles_to_ns(perf_counters const * const me, u64 cycles);
+
+extern void perf_counters_on_register(u8 module, char const * const name, u8 id);
+extern void perf_counters_on_remove(u8 module);
+
+#ifdef RUNNING_OS 
+extern void perf_counters_dump(perf_counters const * const me);
+#endif /* RUNNING_OS */
+
+#endif /* __PERF_COUNTERS_H_ */
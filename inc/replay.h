@@ -0,0 +1,192 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Replay of recorded traffic into CAN interfaces at recorded speed, scaled speed or as 
+// fast as possible. Sources are capture segments or candump logs, both read through 
+// mmap with explicit read-ahead. Transmissions are scheduled with a timerfd sleep up to 
+// a short spin window before the due time and a busy wait for the rest.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+#define REPLAY_SOURCE_CAPTURE           0U
+#define REPLAY_SOURCE_CANDUMP           1U
+
+#define REPLAY_SPEED_MAX                0.0     /* no pacing at all */
+#define REPLAY_DEFAULT_SPIN_NS          200000U
+#define REPLAY_DEFAULT_WINDOW_NS        20000U
+#define REPLAY_MAX_BATCH                CAN_SOCKET_MAX_BATCH
+#define REPLAY_ERROR_BUCKETS            40U
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __REPLAY_H_
+    #define REPLAY_MODULE_NAME          "REPLAY"
+    #define REPLAY_READAHEAD_BYTES      (8U * 1024U * 1024U)
+    #define REPLAY_MAX_LINE             512U
+#endif /*  __REPLAY_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct replay_source_t
+{
+    u8              type;
+
+    // capture segment 
+    capture_reader  reader;
+    capture_cursor  cursor;
+    u32             block;
+
+    // candump log, interface names are turned into bus numbers in order of appearance
+    int             fd;
+    u8 const *      map;
+    u64             size;
+    u64             pos;
+    u64             readahead;
+    char            bus_names[CAN_FRAME_MAX_BUSES][CAN_SOCKET_IFNAME_SIZE];
+    u8              bus_count;
+};
+
+typedef struct replay_source_t replay_source; 
+
+struct replay_config_t
+{
+    f64 speed;              /* 1.0 recorded speed, 2.0 twice as fast, REPLAY_SPEED_MAX */
+    u32 spin_ns;            /* busy wait this long before a due time instead of sleeping */
+    u32 window_ns;          /* frames due within this window go out in one batch */
+    u8  dry_run;            /* schedule and account everything, but send nothing */
+};
+
+typedef struct replay_config_t replay_config; 
+
+struct replay_stats_t
+{
+    u64 frames;
+    u64 batches;
+    u64 tx_errors;
+    u64 unmapped;           /* frames of buses without interface */
+    u64 elapsed_ns;
+    f64 rate_fps;
+
+    // timing error = actual send time - due time, per frame 
+    s64 error_min_ns;
+    s64 error_max_ns;
+    f64 error_mean_ns;
+    u64 error_p50_ns;       /* of the absolute error, from the histogram */
+    u64 error_p99_ns;
+    u64 error_hist[REPLAY_ERROR_BUCKETS];   /* bucket i: |error| < 2^i ns */
+};
+
+typedef struct replay_stats_t replay_stats; 
+
+struct replay_t
+{
+    can_socket*     sockets[CAN_FRAME_MAX_BUSES];   /* bus -> interface */
+    u8              batch_of[CAN_FRAME_MAX_BUSES];  /* bus -> first bus on the same interface */
+    replay_config   config;
+    replay_stats    stats;
+    int             timer_fd;
+    volatile u8     stop;
+    u8              module_position;
+
+    // time base, set by the first frame 
+    u8              started;
+    u64             first_ts;
+    u64             start_mono_ns;
+    u64             window_start_ns;
+    u32             window_frames;
+    f64             error_sum;
+
+    // per socket batches of the current window, indexed by batch_of 
+    can_frame_rec   pending[CAN_FRAME_MAX_BUSES][REPLAY_MAX_BATCH];
+    u64             due[CAN_FRAME_MAX_BUSES][REPLAY_MAX_BATCH];
+    u8              pending_count[CAN_FRAME_MAX_BUSES];
+};
+
+typedef struct replay_t replay; 
+
+typedef struct replay_t* replay_ptr; 
+
+#ifdef __REPLAY_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean replay_source_open(replay_source* const me, char const * const path);
+void replay_source_close(replay_source* const me);
+__boolean replay_source_next(replay_source* const me, can_frame_rec* const frame);
+
+__boolean replay_init(replay* const me, u8 __id, replay_config const * const config);
+void replay_destruct(replay* const me);
+__boolean replay_map_bus(replay* const me, u8 bus, can_socket* const socket);
+__boolean replay_run(replay* const me, replay_source* const source);
+void replay_stop(replay* const me);
+void replay_get_stats(replay* const me, replay_stats* const stats);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static __boolean replay_source_next_candump(replay_source* const me, can_frame_rec* const frame);
+static __boolean replay_parse_candump(replay_source* const me, char const * line, u32 len, can_frame_rec* const frame);
+static void replay_readahead(u8 const * const base, u64 size, u64 pos, u64* const readahead);
+static void replay_wait_until(replay* const me, u64 due_ns);
+static void replay_flush(replay* const me);
+static void replay_account(replay* const me, s64 error_ns);
+static inline u64 replay_mono_ns(void);
+static inline s32 replay_hex(char c);
+
+#else 
+
+extern __boolean replay_source_open(replay_source* const me, char const * const path);
+extern void replay_source_close(replay_source* const me);
+extern __boolean replay_source_next(replay_source* const me, can_frame_rec* const frame);
+
+extern __boolean replay_init(replay* const me, u8 __id, replay_config const * const config);
+extern void replay_destruct(replay* const me);
+extern __boolean replay_map_bus(replay* const me, u8 bus, can_socket* const socket);
+extern __boolean replay_run(replay* const me, replay_source* const source);
+extern void replay_stop(replay* const me);
+extern void replay_get_stats(replay* const me, replay_stats* const stats);
+
+#endif /* __REPLAY_H_ */
@@ -0,0 +1,117 @@
+/*
+Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Hashed timer wheel for many short lived timeouts. Timer nodes are embedded in the 
+// caller's objects, scheduling and cancelling are O(1) list operations, and advancing 
+// only looks at the slots of the ticks that passed. Timers further out than one 
+// revolution stay in their slot and are skipped until their tick comes up.
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC MACROS 
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+
+/*****************************************************************************************
+*****************************************************************************************
+***             -- PRIVATE DEFINES  
+*****************************************************************************************
+****************************************************************************************/
+#ifdef __TIMER_WHEEL_H_
+    #define TIMER_WHEEL_MODULE_NAME     "TIMER_WHEEL"
+    #define TIMER_WHEEL_IS_POWER_OF_TWO(__X)    (((__X) != 0U) && (((__X) & ((__X) - 1U)) == 0U))
+#endif /*  __TIMER_WHEEL_H_   */
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC DATATYPES  
+*****************************************************************************************
+****************************************************************************************/
+
+struct timer_wheel_node_t
+{
+    struct timer_wheel_node_t*  next;
+    struct timer_wheel_node_t*  prev;
+    u64                         tick;       /* first tick at or after the expiry */
+    u32                         cookie;     /* free for the owner */
+    u32                         armed;
+};
+
+typedef struct timer_wheel_node_t timer_wheel_node;
+
+typedef void (*timer_wheel_callback)(void* ctx, timer_wheel_node* node);
+
+struct timer_wheel_t
+{
+    timer_wheel_node*   slots;          /* list heads */
+    timer_wheel_node    expired;        /* collected while advancing */
+    u32                 mask;
+    u32                 armed_count;
+    u64                 tick_ns;
+    u64                 current;        /* last tick advanced to */
+    u8                  module_position;
+};
+
+typedef struct timer_wheel_t timer_wheel; 
+
+#ifdef __TIMER_WHEEL_H_
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PUBLIC FUNCTIONS 
+*****************************************************************************************
+****************************************************************************************/
+
+__boolean timer_wheel_init(timer_wheel* const me, u8 __id, u32 slots, u64 tick_ns, u64 now_ns);
+void timer_wheel_destruct(timer_wheel* const me);
+
+void timer_wheel_node_init(timer_wheel_node* const node, u32 cookie);
+void timer_wheel_schedule(timer_wheel* const me, timer_wheel_node* const node, u64 expires_ns);
+void timer_wheel_cancel(timer_wheel* const me, timer_wheel_node* const node);
+u32 timer_wheel_advance(timer_wheel* const me, u64 now_ns, timer_wheel_callback callback, void* ctx);
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+static inline void timer_wheel_link(timer_wheel_node* const head, timer_wheel_node* const node);
+static inline void timer_wheel_unlink(timer_wheel_node* const node);
+
+#else 
+
+extern __boolean timer_wheel_init(timer_wheel* const me, u8 __id, u32 slots, u64 tick_ns, u64 now_ns);
+extern void timer_wheel_destruct(timer_wheel* const me);
+
+extern void timer_wheel_node_init(timer_wheel_node* const node, u32 cookie);
+extern void timer_wheel_schedule(timer_wheel* const me, timer_wheel_node* const node, u64 expires_ns);
+extern void timer_wheel_cancel(timer_wheel* const me, timer_wheel_node* const node);
+extern u32 timer_wheel_advance(timer_wheel* const me, u64 now_ns, timer_wheel_callback callback, void* ctx);
+
+#endif /* __TIMER_WHEEL_H_ */
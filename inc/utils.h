@@ -20,7 +20,8 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
-
+#ifndef __UTILS_H_
+#define __UTILS_H_
 
 /*****************************************************************************************
 *****************************************************************************************
@@ -30,12 +31,12 @@ SOFTWARE.
 
 typedef unsigned char u8; 
 typedef unsigned short int u16; 
-typedef unsigned long int u32; 
+typedef unsigned int u32; 
 typedef unsigned long long int u64; 
 
 typedef signed char s8; 
 typedef short int s16; 
-typedef long int s32; 
+typedef int s32; 
 typedef long long int s64; 
 
 typedef float f32; 
@@ -117,6 +118,8 @@ inline static void utils_cpu_relax(void)
 {
 #if defined(__x86_64__) || defined(__i386__)
   asm volatile("pause" ::: "memory");
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
 #else
 #error "Extend for other architectures ..."
 #endif
@@ -125,78 +128,20 @@ inline static void utils_cpu_relax(void)
 #define MAX_NUMBER_MODULES    64U
 #define UNDEFINED_MODULE_ID   0xFFU
 
-static char * __module_names[MAX_NUMBER_MODULES] = { NULLPTR }; 
-static u8     __modules_ids[MAX_NUMBER_MODULES] = { 0U };
-static u8     place_holder = 0U; 
-static u8     free_place_holder = UNDEFINED_MODULE_ID; 
-
-
-/**
- * @name    void ring_destruct(ring_buffer** const me)
- * 
- * @brief   Frees and destroys the memory either allocated on heap or stack
- * 
- * @param   ring_buffer** const: pointer to the object pointer of the rb struct
- * 
- * @return  none.
- */
-inline static u8 utils_register_module(char * const __module_name, u8 const __id)
-{
-  u8 ret = (free_place_holder == UNDEFINED_MODULE_ID) ? place_holder : free_place_holder;
-  __module_names[ret] = __module_name; 
-  __modules_ids[ret] = __id; 
-  if (free_place_holder == UNDEFINED_MODULE_ID)
-  {
-    INCR_WITH_SATURATION(place_holder);
-  }
-  free_place_holder = UNDEFINED_MODULE_ID;
-  return ret; 
-}
-
-
-
-/**
- * @name    void ring_destruct(ring_buffer** const me)
- * 
- * @brief   Frees and destroys the memory either allocated on heap or stack
- * 
- * @param   ring_buffer** const: pointer to the object pointer of the rb struct
- * 
- * @return  none.
- */
-inline static void utils_remove_module_registration(u8 __pos)
-{
-  __module_names[__pos] = NULLPTR; 
-  __modules_ids[__pos] = UNDEFINED_MODULE_ID;
-  free_place_holder = __pos;
-} 
+ /*****************************************************************************************
+*****************************************************************************************
+***             --- MODULE REGISTRY 
+*****************************************************************************************
+****************************************************************************************/
 
+// One table for the whole process (src/utils.c), the position of a module is its handle 
+// in other process wide tables like the performance counters. A full table hands out 
+// UNDEFINED_MODULE_ID, which every registry function and the counters accept and ignore. 
 
-/**
- * @name    void ring_destruct(ring_buffer** const me)
- * 
- * @brief   Frees and destroys the memory either allocated on heap or stack
- * 
- * @param   ring_buffer** const: pointer to the object pointer of the rb struct
- * 
- * @return  none.
- */
-inline static char * utils_get_registered_module_name(u8 __pos)
-{
-  return __module_names[__pos]; 
-}
+extern u8 utils_register_module(char * const __module_name, u8 const __id);
+extern void utils_remove_module_registration(u8 __pos);
+extern char * utils_get_registered_module_name(u8 __pos);
+extern u8 utils_get_registered_module_id(u8 __pos);
 
 
-/**
- * @name    void ring_destruct(ring_buffer** const me)
- * 
- * @brief   Frees and destroys the memory either allocated on heap or stack
- * 
- * @param   ring_buffer** const: pointer to the object pointer of the rb struct
- * 
- * @return  none.
- */
-inline static u8 utils_get_registered_module_id(u8 __pos)
-{
-  return __modules_ids[__pos];
-}
+#endif /*   __UTILS_H_   */
@@ -0,0 +1,837 @@
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "can_id_table.h"
+
+#define __BUS_STATS_H_
+#include "bus_stats.h"
+
+/**
+ * @name    __boolean bus_stats_init(bus_stats* const me, u8 __id, char const * const path, u32 nominal_bitrate, u32 data_bitrate, u32 ext_slots, u64 interval_ns)
+ * 
+ * @brief   creates the statistics of one bus for its RX thread. An existing file is
+ *          formatted again, in place if its size fits so that readers still mapping 
+ *          it do not get SIGBUS.
+ * 
+ * @param   bus_stats* const   : object pointer to the struct.
+ *          u8                 : module id for the registration
+ *          char const * const : snapshot file, e.g. on /dev/shm; NULLPTR for a private mapping
+ *          u32                : arbitration bit rate in bit/s
+ *          u32                : CAN FD data bit rate in bit/s, 0 if the bus has none
+ *          u32                : hash slots for 29 bit ids, power of two, 0 for the default
+ *          u64                : snapshot interval in ns of the frame clock, 0 for the default
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean bus_stats_init(bus_stats* const me, u8 __id, char const * const path, u32 nominal_bitrate, u32 data_bitrate, u32 ext_slots, u64 interval_ns)
+{
+    u64 buffer_size;
+    struct stat st;
+    __boolean reset = false;
+
+    CHECK_NULLPTR_RET(me);
+
+    if (ext_slots == 0U)
+    {
+        ext_slots = BUS_STATS_DEFAULT_EXT_SLOTS;
+    }
+
+    if ((nominal_bitrate == 0U) || (BUS_STATS_IS_POWER_OF_TWO(ext_slots) == false) ||
+        (ext_slots < BUS_STATS_MIN_EXT_SLOTS) || (ext_slots > BUS_STATS_MAX_EXT_SLOTS))
+    {
+        return false;
+    }
+
+    if (data_bitrate == 0U)
+    {
+        data_bitrate = nominal_bitrate;
+    }
+
+    if (interval_ns == 0U)
+    {
+        interval_ns = BUS_STATS_DEFAULT_INTERVAL_NS;
+    }
+
+    bus_stats_build_stuff_table();
+
+    memset(me, 0, sizeof(*me));
+    me->fd        = -1;
+    me->read_only = false;
+    me->max_ids   = BUS_STATS_STD_IDS + ext_slots;
+    me->ext_mask  = ext_slots - 1U;
+    buffer_size   = bus_stats_buffer_size(me->max_ids);
+    me->map_size  = BUS_STATS_HEADER_SIZE + (2U * buffer_size);
+
+    me->entries  = (bus_stats_entry*) aligned_alloc(64U, me->max_ids * sizeof(bus_stats_entry));
+    me->ext_keys = (u32*) malloc(ext_slots * sizeof(u32));
+    me->active   = (u32*) malloc(me->max_ids * sizeof(u32));
+    if ((me->entries == NULLPTR) || (me->ext_keys == NULLPTR) || (me->active == NULLPTR))
+    {
+        bus_stats_destruct(me);
+        return false;
+    }
+
+    memset(me->entries, 0, me->max_ids * sizeof(bus_stats_entry));
+    memset(me->ext_keys, 0xFF, ext_slots * sizeof(u32));
+
+    if (path != NULLPTR)
+    {
+        me->fd = open(path, O_RDWR | O_CREAT, 0644);
+        if ((me->fd < 0) || (fstat(me->fd, &st) != 0))
+        {
+            bus_stats_destruct(me);
+            return false;
+        }
+        reset = ((u64) st.st_size == me->map_size);
+        if ((reset == false) && ((ftruncate(me->fd, 0) != 0) || (ftruncate(me->fd, (off_t) me->map_size) != 0)))
+        {
+            bus_stats_destruct(me);
+            return false;
+        }
+        me->file = (bus_stats_file*) mmap(NULLPTR, me->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, me->fd, 0);
+    }
+    else
+    {
+        me->file = (bus_stats_file*) mmap(NULLPTR, me->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if ((void*) me->file == MAP_FAILED)
+    {
+        me->file = NULLPTR;
+        bus_stats_destruct(me);
+        return false;
+    }
+
+    if (reset == true)
+    {
+        memset(me->file, 0, me->map_size);
+    }
+    memcpy(me->file->magic, BUS_STATS_MAGIC, sizeof(me->file->magic));
+    me->file->version         = BUS_STATS_VERSION;
+    me->file->max_ids         = me->max_ids;
+    me->file->nominal_bitrate = nominal_bitrate;
+    me->file->data_bitrate    = data_bitrate;
+    me->file->interval_ns     = interval_ns;
+    me->file->buffer_size     = buffer_size;
+    me->file->published       = 0U;
+
+    me->buffers[0] = (bus_stats_buffer*) ((u8*) me->file + BUS_STATS_HEADER_SIZE);
+    me->buffers[1] = (bus_stats_buffer*) ((u8*) me->buffers[0] + buffer_size);
+
+    me->module_position = utils_register_module(BUS_STATS_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean bus_stats_open_read_only(bus_stats* const me, char const * const path)
+ * 
+ * @brief   maps the snapshots of another thread or process for bus_stats_read()
+ * 
+ * @param   bus_stats* const   : object pointer to the struct.
+ *          char const * const : file given to bus_stats_init()
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean bus_stats_open_read_only(bus_stats* const me, char const * const path)
+{
+    bus_stats_file hdr;
+    struct stat st;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(path);
+
+    memset(me, 0, sizeof(*me));
+    me->read_only = true;
+    me->fd = open(path, O_RDONLY);
+    if (me->fd < 0)
+    {
+        return false;
+    }
+
+    if ((fstat(me->fd, &st) != 0) || (pread(me->fd, &hdr, sizeof(hdr), 0) != (ssize_t) sizeof(hdr)) ||
+        (memcmp(hdr.magic, BUS_STATS_MAGIC, sizeof(hdr.magic)) != 0) || (hdr.version != BUS_STATS_VERSION) ||
+        (hdr.max_ids > (BUS_STATS_STD_IDS + BUS_STATS_MAX_EXT_SLOTS)) ||
+        (hdr.buffer_size != bus_stats_buffer_size(hdr.max_ids)) ||
+        ((u64) st.st_size != (BUS_STATS_HEADER_SIZE + (2U * hdr.buffer_size))))
+    {
+        bus_stats_destruct(me);
+        return false;
+    }
+
+    me->max_ids  = hdr.max_ids;
+    me->map_size = (u64) st.st_size;
+    me->file = (bus_stats_file*) mmap(NULLPTR, me->map_size, PROT_READ, MAP_SHARED, me->fd, 0);
+    if ((void*) me->file == MAP_FAILED)
+    {
+        me->file = NULLPTR;
+        bus_stats_destruct(me);
+        return false;
+    }
+
+    me->buffers[0] = (bus_stats_buffer*) ((u8*) me->file + BUS_STATS_HEADER_SIZE);
+    me->buffers[1] = (bus_stats_buffer*) ((u8*) me->buffers[0] + hdr.buffer_size);
+
+    return true;
+}
+
+
+/**
+ * @name    void bus_stats_destruct(bus_stats* const me)
+ * 
+ * @brief   releases the live tables and unmaps the snapshots, the file stays for readers
+ * 
+ * @param   bus_stats* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void bus_stats_destruct(bus_stats* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->file != NULLPTR)
+    {
+        munmap(me->file, me->map_size);
+        if (me->read_only == false)
+        {
+            utils_remove_module_registration(me->module_position);
+        }
+    }
+
+    if (me->fd >= 0)
+    {
+        close(me->fd);
+    }
+
+    free(me->entries);
+    free(me->ext_keys);
+    free(me->active);
+
+    me->fd       = -1;
+    me->file     = NULLPTR;
+    me->entries  = NULLPTR;
+    me->ext_keys = NULLPTR;
+    me->active   = NULLPTR;
+
+    return;
+}
+
+
+/**
+ * @name    void bus_stats_update(bus_stats* const me, can_frame_rec const * const frame)
+ * 
+ * @brief   accounts one received frame, takes the snapshot once its timestamp crossed
+ *          the interval. RX thread only.
+ * 
+ * @param   bus_stats* const            : object pointer to the struct.
+ *          can_frame_rec const * const : frame with its timestamp
+ * 
+ * @return  none.
+ */
+void bus_stats_update(bus_stats* const me, can_frame_rec const * const frame)
+{
+    CHECK_NULLPTR_VOID(me);
+    CHECK_NULLPTR_VOID(frame);
+
+    if (me->read_only == true)
+    {
+        return;
+    }
+
+    bus_stats_account(me, frame);
+
+    if (frame->timestamp_ns >= me->next_snapshot)
+    {
+        bus_stats_snapshot(me, frame->timestamp_ns);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    void bus_stats_update_batch(bus_stats* const me, can_frame_rec const * const frames, u32 count)
+ * 
+ * @brief   accounts a batch as it came from recvmmsg, the interval is checked once per
+ *          batch against the last timestamp. RX thread only.
+ * 
+ * @param   bus_stats* const            : object pointer to the struct.
+ *          can_frame_rec const * const : frames in order of reception
+ *          u32                         : number of frames
+ * 
+ * @return  none.
+ */
+void bus_stats_update_batch(bus_stats* const me, can_frame_rec const * const frames, u32 count)
+{
+    u32 i;
+
+    CHECK_NULLPTR_VOID(me);
+    CHECK_NULLPTR_VOID(frames);
+
+    if ((me->read_only == true) || (count == 0U))
+    {
+        return;
+    }
+
+    for (i = 0U; i < count; i++)
+    {
+        bus_stats_account(me, &frames[i]);
+    }
+
+    if (frames[count - 1U].timestamp_ns >= me->next_snapshot)
+    {
+        bus_stats_snapshot(me, frames[count - 1U].timestamp_ns);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    void bus_stats_snapshot(bus_stats* const me, u64 now_ns)
+ * 
+ * @brief   turns the counters of the interval into a snapshot in the buffer readers do
+ *          not use, publishes it and starts the next interval. Called by the updates,
+ *          call it directly on an idle bus with the clock of the frame timestamps.
+ * 
+ * @param   bus_stats* const : object pointer to the struct.
+ *          u64              : end of the interval in ns
+ * 
+ * @return  none.
+ */
+void bus_stats_snapshot(bus_stats* const me, u64 now_ns)
+{
+    bus_stats_buffer* buffer;
+    bus_stats_entry* entry;
+    bus_stats_id* out;
+    u32 published;
+    u32 seq;
+    f64 seconds;
+    f64 busy;
+    u32 i;
+
+    CHECK_NULLPTR_VOID(me);
+
+    if ((me->read_only == true) || (me->file == NULLPTR))
+    {
+        return;
+    }
+
+    published = me->file->published;
+    buffer    = me->buffers[published ^ 1U];
+    seq       = buffer->seq;
+
+    __atomic_store_n(&buffer->seq, seq + 1U, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    seconds = (now_ns > me->interval_start) ? ((f64) (now_ns - me->interval_start) / 1e9) : 1e-9;
+    busy    = ((f64) me->nominal_bits / (f64) me->file->nominal_bitrate) +
+              ((f64) me->data_bits / (f64) me->file->data_bitrate);
+
+    buffer->snapshot          = ++me->snapshots;
+    buffer->id_count          = me->active_count;
+    buffer->bus.start_ns      = me->interval_start;
+    buffer->bus.end_ns        = now_ns;
+    buffer->bus.frames        = me->frames;
+    buffer->bus.frames_total  = me->frames_total;
+    buffer->bus.error_frames  = me->error_frames;
+    buffer->bus.dropped_ids   = me->dropped_ids;
+    buffer->bus.bits          = me->nominal_bits + me->data_bits;
+    buffer->bus.load          = busy / seconds;
+    buffer->bus.frame_rate    = (f64) me->frames / seconds;
+    memcpy(buffer->bus.dlc, me->dlc, sizeof(me->dlc));
+
+    for (i = 0U; i < me->active_count; i++)
+    {
+        entry = &me->entries[me->active[i]];
+        out   = &buffer->ids[i];
+
+        out->can_id         = entry->can_id;
+        out->frames         = entry->frames;
+        out->frames_total   = entry->frames_total;
+        out->last_ns        = entry->last_ns;
+        out->rate           = (f64) entry->frames / seconds;
+        out->dlc            = entry->dlc;
+        out->period_mean_ns = 0.0;
+        out->jitter_ns      = 0.0;
+        out->period_min_ns  = 0U;
+        out->period_max_ns  = 0U;
+
+        if (entry->periods != 0U)
+        {
+            f64 const mean_dev = (f64) entry->dev_sum / (f64) entry->periods;
+            f64 const variance = (entry->dev_sq / (f64) entry->periods) - (mean_dev * mean_dev);
+
+            out->period_mean_ns = (f64) entry->period_ref + mean_dev;
+            out->jitter_ns      = (variance > 0.0) ? sqrt(variance) : 0.0;
+            out->period_min_ns  = entry->period_min;
+            out->period_max_ns  = entry->period_max;
+
+            // the next interval measures its deviations around this mean
+            entry->period_ref = (u32) GET_MIN(out->period_mean_ns + 0.5, (f64) 0xFFFFFFFFU);
+        }
+
+        entry->frames     = 0U;
+        entry->periods    = 0U;
+        entry->dev_sum    = 0;
+        entry->dev_sq     = 0.0;
+        entry->period_min = 0xFFFFFFFFU;
+        entry->period_max = 0U;
+    }
+
+    __atomic_store_n(&buffer->seq, seq + 2U, __ATOMIC_RELEASE);
+    __atomic_store_n(&me->file->published, published ^ 1U, __ATOMIC_RELEASE);
+
+    me->frames         = 0U;
+    me->nominal_bits   = 0U;
+    me->data_bits      = 0U;
+    me->interval_start = now_ns;
+    me->next_snapshot  = now_ns + me->file->interval_ns;
+    memset(me->dlc, 0, sizeof(me->dlc));
+
+    return;
+}
+
+
+/**
+ * @name    u32 bus_stats_read(bus_stats const * const me, bus_stats_bus* const bus, bus_stats_id* const ids, u32 max)
+ * 
+ * @brief   copies the published snapshot, retries when the writer reused its buffer
+ *          during the copy. Works on the writer and on read only mappings.
+ * 
+ * @param   bus_stats const * const : object pointer to the struct.
+ *          bus_stats_bus* const    : bus part, may be NULLPTR
+ *          bus_stats_id* const     : ids in order of their first frame, may be NULLPTR
+ *          u32                     : capacity of ids
+ * 
+ * @return  u32 : number of ids in the snapshot, it may be more than max. 0 before the
+ *                first snapshot.
+ */
+u32 bus_stats_read(bus_stats const * const me, bus_stats_bus* const bus, bus_stats_id* const ids, u32 max)
+{
+    bus_stats_buffer const * buffer;
+    u32 count;
+    u32 seq;
+
+    if ((me == NULLPTR) || (me->file == NULLPTR))
+    {
+        return 0U;
+    }
+
+    for (;;)
+    {
+        buffer = me->buffers[__atomic_load_n(&me->file->published, __ATOMIC_ACQUIRE)];
+        seq    = __atomic_load_n(&buffer->seq, __ATOMIC_ACQUIRE);
+
+        if (seq == 0U)
+        {
+            return 0U;
+        }
+
+        if ((seq & 1U) != 0U)
+        {
+            utils_cpu_relax();
+            continue;
+        }
+
+        count = GET_MIN(buffer->id_count, me->max_ids);
+        if (bus != NULLPTR)
+        {
+            memcpy(bus, &buffer->bus, sizeof(*bus));
+        }
+        if (ids != NULLPTR)
+        {
+            memcpy(ids, buffer->ids, GET_MIN(count, max) * sizeof(bus_stats_id));
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&buffer->seq, __ATOMIC_RELAXED) == seq)
+        {
+            break;
+        }
+    }
+
+    return count;
+}
+
+
+/**
+ * @name    u32 bus_stats_frame_bits(can_frame_rec const * const frame, u32* const data_phase_bits)
+ * 
+ * @brief   bits a frame occupies on the wire from SOF to the end of the intermission,
+ *          with the exact dynamic stuff bits of header and payload and the fixed stuff
+ *          bits of the CAN FD CRC field. The classic CRC field is charged its mean.
+ * 
+ * @param   can_frame_rec const * const : frame
+ *          u32* const                  : bits sent with the data bit rate (BRS), may be NULLPTR
+ * 
+ * @return  u32 : all bits of the frame, data phase included.
+ */
+u32 bus_stats_frame_bits(can_frame_rec const * const frame, u32* const data_phase_bits)
+{
+    u64 header;
+    u32 id;
+    u32 len;
+    u32 bits;
+    u32 data_bits;
+    u32 crc_bits;
+    u8  dlc;
+    u8  state;
+
+    if (bus_stats_stuff_ready == 0U)
+    {
+        bus_stats_build_stuff_table();
+    }
+
+    id    = CAN_FRAME_ID(frame->can_id);
+    len   = GET_MIN(frame->len, CAN_FRAME_MAX_DATA);
+    dlc   = can_frame_len_to_dlc((u8) len);
+    state = BUS_STATS_STUFF_IDLE;
+
+    if ((frame->flags & CAN_FRAME_FLAG_FD) == 0U)
+    {
+        u32 const rtr = CAN_FRAME_IS_RTR(frame->can_id) ? 1U : 0U;
+
+        // SOF ID RTR IDE r0 DLC, or SOF ID-A SRR IDE ID-B RTR r1 r0 DLC
+        if (CAN_FRAME_IS_EXT(frame->can_id) == false)
+        {
+            header = ((u64) id << 7U) | ((u64) rtr << 6U) | dlc;
+            bits   = 19U;
+        }
+        else
+        {
+            header = ((u64) (id >> 18U) << 27U) | (3ULL << 25U) | ((u64) (id & 0x3FFFFU) << 7U) |
+                     ((u64) rtr << 6U) | dlc;
+            bits   = 39U;
+        }
+
+        bits += bus_stats_stuff(&state, header, bits);
+        if (rtr == 0U)
+        {
+            len   = GET_MIN(len, 8U);
+            bits += (len * 8U) + bus_stats_stuff_bytes(&state, frame->data, len);
+        }
+
+        if (data_phase_bits != NULLPTR)
+        {
+            *data_phase_bits = 0U;
+        }
+
+        return bits + 15U + BUS_STATS_CRC15_STUFF + 1U + BUS_STATS_TAIL_BITS;
+    }
+
+    // arbitration up to BRS: SOF ID RRS IDE FDF res BRS, or SOF ID-A SRR IDE ID-B RRS FDF res BRS
+    if (CAN_FRAME_IS_EXT(frame->can_id) == false)
+    {
+        header = ((u64) id << 5U) | (1ULL << 2U);
+        bits   = 17U;
+    }
+    else
+    {
+        header = ((u64) (id >> 18U) << 24U) | (3ULL << 22U) | ((u64) (id & 0x3FFFFU) << 4U) | (1ULL << 2U);
+        bits   = 36U;
+    }
+    header |= ((frame->flags & CAN_FRAME_FLAG_BRS) != 0U) ? 1U : 0U;
+    bits   += bus_stats_stuff(&state, header, bits);
+
+    // ESI DLC payload, then stuff count, CRC with its fixed stuff bits and CRC delimiter
+    data_bits  = 5U + (len * 8U);
+    data_bits += bus_stats_stuff(&state, (((frame->flags & CAN_FRAME_FLAG_ESI) != 0U) ? 0x10U : 0U) | dlc, 5U);
+    data_bits += bus_stats_stuff_bytes(&state, frame->data, len);
+    crc_bits   = (len <= 16U) ? 17U : 21U;
+    data_bits += 4U + crc_bits + ((4U + crc_bits + 3U) / 4U) + 1U;
+
+    bits += BUS_STATS_TAIL_BITS;
+    if ((frame->flags & CAN_FRAME_FLAG_BRS) == 0U)
+    {
+        bits     += data_bits;
+        data_bits = 0U;
+    }
+
+    if (data_phase_bits != NULLPTR)
+    {
+        *data_phase_bits = data_bits;
+    }
+
+    return bits + data_bits;
+}
+
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+/**
+ * @name    static void bus_stats_build_stuff_table(void)
+ * 
+ * @brief   fills the stuff tables by running every byte and every shorter field bit by 
+ *          bit through every state. A run of five equal bits gets the complement 
+ *          inserted, which starts a run.
+ *          The contents never change, a second concurrent build writes the same values.
+ * 
+ * @param   none.
+ * 
+ * @return  none.
+ */
+static void bus_stats_build_stuff_table(void)
+{
+    u32 s;
+    u32 index;
+    u32 bit;
+
+    if (__atomic_load_n(&bus_stats_stuff_ready, __ATOMIC_ACQUIRE) != 0U)
+    {
+        return;
+    }
+
+    for (s = 0U; s < BUS_STATS_STUFF_STATES; s++)
+    {
+        for (index = 0U; index < 512U; index++)
+        {
+            u32 const width = (index < 256U) ? 8U : (31U - (u32) __builtin_clz((index - 256U) | 1U));
+            u32 const value = (index < 256U) ? index : ((index - 256U) & ((1U << width) - 1U));
+            u32 last  = s >> 3U;
+            u32 run   = s & 0x07U;
+            u32 stuff = 0U;
+
+            for (bit = width; bit-- > 0U; )
+            {
+                u32 const b = (value >> bit) & 1U;
+
+                run  = ((b == last) && (run != 0U)) ? (run + 1U) : 1U;
+                last = b;
+                if (run == 5U)
+                {
+                    stuff++;
+                    last ^= 1U;
+                    run   = 1U;
+                }
+            }
+
+            if (index < 256U)
+            {
+                bus_stats_stuff_table[s][index] = (u16) ((((last << 3U) | run) << 8U) | stuff);
+            }
+            else
+            {
+                bus_stats_stuff_partial[s][index - 256U] = (u16) ((((last << 3U) | run) << 8U) | stuff);
+            }
+        }
+    }
+
+    __atomic_store_n(&bus_stats_stuff_ready, 1U, __ATOMIC_RELEASE);
+
+    return;
+}
+
+
+/**
+ * @name    static inline u32 bus_stats_stuff(u8* const state, u64 bits, u32 count)
+ *
+ * @brief   stuff bits of the count low bits of a value sent MSB first, whole bytes go
+ *          through the table, a leading rest of fewer bits through the partial one.
+ *
+ * @param   u8* const : stuff state, carried from field to field
+ *          u64       : bits
+ *          u32       : number of bits, up to 64
+ *
+ * @return  u32 : stuff bits.
+ */
+static inline u32 bus_stats_stuff(u8* const state, u64 bits, u32 count)
+{
+    u16 const * const table = &bus_stats_stuff_table[0][0];
+    u32 const rest = count & 0x07U;
+    u32 entry;
+
+    // the leading rest first, index 1 marks an empty one and keeps the state 
+    entry = bus_stats_stuff_partial[*state][(1U << rest) | ((u32) (bits >> (count - rest)) & ((1U << rest) - 1U))];
+
+    // the next state sits in the high byte of an entry, that is its row offset already 
+    for (count -= rest; count != 0U; )
+    {
+        u32 const stuff = entry & 0xFFU;
+
+        entry = table[(entry & 0xFF00U) | ((u32) (bits >> (count -= 8U)) & 0xFFU)] + stuff;
+    }
+
+    *state = (u8) (entry >> 8U);
+
+    return entry & 0xFFU;
+}
+
+
+/**
+ * @name    static inline u32 bus_stats_stuff_bytes(u8* const state, u8 const * const data, u32 len)
+ * 
+ * @brief   stuff bits of a payload, one table lookup per byte
+ * 
+ * @param   u8* const       : stuff state, carried from field to field
+ *          u8 const* const : payload
+ *          u32             : bytes
+ * 
+ * @return  u32 : stuff bits.
+ */
+static inline u32 bus_stats_stuff_bytes(u8* const state, u8 const * const data, u32 len)
+{
+    u16 const * const table = &bus_stats_stuff_table[0][0];
+    u32 entry = (u32) *state << 8U;
+    u32 stuff = 0U;
+    u32 i;
+
+    for (i = 0U; i < len; i++)
+    {
+        entry  = table[(entry & 0xFF00U) | data[i]];
+        stuff += entry & 0xFFU;
+    }
+
+    *state = (u8) (entry >> 8U);
+
+    return stuff;
+}
+
+
+/**
+ * @name    static inline void bus_stats_account(bus_stats* const me, can_frame_rec const * const frame)
+ * 
+ * @brief   hot path of the updates: bus counters, then the entry of the id
+ * 
+ * @param   bus_stats* const            : object pointer to the struct.
+ *          can_frame_rec const * const : frame
+ * 
+ * @return  none.
+ */
+static inline void bus_stats_account(bus_stats* const me, can_frame_rec const * const frame)
+{
+    bus_stats_entry* entry;
+    u64 const now = frame->timestamp_ns;
+    u32 data_bits;
+    u32 bits;
+    u32 index;
+    u8  dlc;
+
+    if (me->interval_start == 0U)
+    {
+        me->interval_start = now;
+        me->next_snapshot  = now + me->file->interval_ns;
+    }
+
+    // error frames are reports of the controller, they carry no id
+    if (CAN_FRAME_IS_ERR(frame->can_id) == true)
+    {
+        me->error_frames++;
+        return;
+    }
+
+    bits = bus_stats_frame_bits(frame, &data_bits);
+    dlc  = can_frame_len_to_dlc((u8) GET_MIN(frame->len, CAN_FRAME_MAX_DATA));
+
+    me->frames++;
+    me->frames_total++;
+    me->nominal_bits += bits - data_bits;
+    me->data_bits    += data_bits;
+    me->dlc[dlc]++;
+
+    index = bus_stats_slot(me, frame->can_id);
+    if (index == BUS_STATS_KEY_FREE)
+    {
+        me->dropped_ids++;
+        return;
+    }
+
+    entry = &me->entries[index];
+    if (entry->frames_total == 0U)
+    {
+        entry->can_id     = frame->can_id & (CAN_EFF_FLAG | CAN_EFF_MASK);
+        entry->period_min = 0xFFFFFFFFU;
+        me->active[me->active_count++] = index;
+    }
+    else if (now > entry->last_ns)
+    {
+        u64 const period = now - entry->last_ns;
+        u32 const clamped = (u32) GET_MIN(period, 0xFFFFFFFFULL);
+        s64 const dev = (s64) period - (s64) entry->period_ref;
+
+        entry->periods++;
+        entry->dev_sum    += dev;
+        entry->dev_sq     += (f64) dev * (f64) dev;
+        entry->period_min  = GET_MIN(entry->period_min, clamped);
+        entry->period_max  = GET_MAX(entry->period_max, clamped);
+    }
+
+    entry->frames_total++;
+    entry->frames++;
+    entry->last_ns = now;
+    entry->dlc     = dlc;
+
+    return;
+}
+
+
+/**
+ * @name    static u32 bus_stats_slot(bus_stats* const me, u32 can_id)
+ * 
+ * @brief   entry index of an id, 29 bit ids claim a hash slot on their first frame
+ * 
+ * @param   bus_stats* const : object pointer to the struct.
+ *          u32              : id in kernel layout
+ * 
+ * @return  u32 : index into entries, BUS_STATS_KEY_FREE if the hash is full.
+ */
+static u32 bus_stats_slot(bus_stats* const me, u32 can_id)
+{
+    u32 id;
+    u32 slot;
+
+    if (CAN_FRAME_IS_EXT(can_id) == false)
+    {
+        return can_id & CAN_SFF_MASK;
+    }
+
+    id   = can_id & CAN_EFF_MASK;
+    slot = can_id_table_hash(id) & me->ext_mask;
+    while (me->ext_keys[slot] != BUS_STATS_KEY_FREE)
+    {
+        if (me->ext_keys[slot] == id)
+        {
+            return BUS_STATS_STD_IDS + slot;
+        }
+        slot = (slot + 1U) & me->ext_mask;
+    }
+
+    if (((me->ext_count + 1U) * 4U) > ((me->ext_mask + 1U) * 3U))
+    {
+        return BUS_STATS_KEY_FREE;
+    }
+
+    me->ext_keys[slot] = id;
+    me->ext_count++;
+
+    return BUS_STATS_STD_IDS + slot;
+}
+
+
+/**
+ * @name    static u64 bus_stats_buffer_size(u32 max_ids)
+ * 
+ * @brief   size of one snapshot buffer, a multiple of the cache line
+ * 
+ * @param   u32 : ids the buffer holds
+ * 
+ * @return  u64 : size in bytes.
+ */
+static u64 bus_stats_buffer_size(u32 max_ids)
+{
+    u64 const size = sizeof(bus_stats_buffer) + ((u64) max_ids * sizeof(bus_stats_id));
+
+    return (size + 63U) & ~63ULL;
+}
@@ -0,0 +1,941 @@
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "can_socket.h"
+#include "can_id_table.h"
+#include "perf_counters.h"
+
+#define __CAN_GATEWAY_H_
+#include "can_gateway.h"
+
+/**
+ * @name    __boolean can_gateway_init(can_gateway* const me, u8 __id, u32 max_routes)
+ * 
+ * @brief   creates a gateway without buses and rules
+ * 
+ * @param   can_gateway* const : object pointer to the struct.
+ *          u8                 : module id for the registration
+ *          u32                : maximum number of rules
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean can_gateway_init(can_gateway* const me, u8 __id, u32 max_routes)
+{
+    CHECK_NULLPTR_RET(me);
+
+    if (max_routes == 0U)
+    {
+        return false;
+    }
+
+    memset(me, 0, sizeof(*me));
+    me->id            = __id;
+    me->max_routes    = max_routes;
+    me->list_capacity = CAN_GATEWAY_MIN_LISTS;
+    me->routes        = (can_gateway_route*) calloc(max_routes, sizeof(can_gateway_route));
+    me->lists         = (u32*) malloc(me->list_capacity * sizeof(u32));
+    me->scan          = (u32*) malloc((max_routes + 1U) * sizeof(u32));
+
+    if ((me->routes == NULLPTR) || (me->lists == NULLPTR) || (me->scan == NULLPTR))
+    {
+        free(me->routes);
+        free(me->lists);
+        free(me->scan);
+        return false;
+    }
+
+    me->lists[0]  = 0U;
+    me->list_size = 1U;
+    me->compiled  = true;
+    me->module_position = utils_register_module(CAN_GATEWAY_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void can_gateway_destruct(can_gateway* const me)
+ * 
+ * @brief   frees rules, tables and own rings. Sockets and rings of the caller stay open.
+ * 
+ * @param   can_gateway* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void can_gateway_destruct(can_gateway* const me)
+{
+    u32 i;
+
+    CHECK_NULLPTR_VOID(me);
+
+    for (i = 0U; i < me->bus_count; i++)
+    {
+        can_gateway_bus* const bus = &me->buses[i];
+
+        if (bus->storage != NULLPTR)
+        {
+            frame_ring_destruct(&bus->own_ring);
+            free(bus->storage);
+        }
+        can_id_table_destruct(&bus->dispatch);
+        free(bus->wildcards);
+        free(bus->copies);
+    }
+    me->bus_count = 0U;
+
+    free(me->routes);
+    free(me->lists);
+    free(me->scan);
+    me->routes = NULLPTR;
+    me->lists  = NULLPTR;
+    me->scan   = NULLPTR;
+
+    utils_remove_module_registration(me->module_position);
+
+    return;
+}
+
+
+/**
+ * @name    u32 can_gateway_add_bus(can_gateway* const me, can_socket* const socket, frame_ring* const ring)
+ * 
+ * @brief   adds a bus. Without a ring the gateway receives from the socket itself into
+ *          an own ring and switches the socket to non blocking; with a ring another
+ *          thread fills it and the socket is only used for sending.
+ * 
+ * @param   can_gateway* const : object pointer to the struct.
+ *          can_socket* const  : socket of the bus, NULLPTR if frames only go to the output callback
+ *          frame_ring* const  : RX ring of the caller or NULLPTR
+ * 
+ * @return  u32 : bus index for the rules, CAN_GATEWAY_NONE if out of buses or memory.
+ */
+u32 can_gateway_add_bus(can_gateway* const me, can_socket* const socket, frame_ring* const ring)
+{
+    can_gateway_bus* bus;
+
+    if ((me == NULLPTR) || (me->bus_count == CAN_GATEWAY_MAX_BUSES) || ((socket == NULLPTR) && (ring == NULLPTR)))
+    {
+        return CAN_GATEWAY_NONE;
+    }
+
+    bus = &me->buses[me->bus_count];
+    memset(bus, 0, sizeof(*bus));
+    bus->socket    = socket;
+    bus->ring      = ring;
+    bus->wildcards = (u32*) malloc(me->max_routes * sizeof(u32));
+    bus->copies    = (can_frame_rec*) malloc(CAN_GATEWAY_BATCH * sizeof(can_frame_rec));
+
+    if ((bus->wildcards == NULLPTR) || (bus->copies == NULLPTR) ||
+        (can_id_table_init(&bus->dispatch, me->id, 0U) == false))
+    {
+        free(bus->wildcards);
+        free(bus->copies);
+        return CAN_GATEWAY_NONE;
+    }
+
+    if (ring == NULLPTR)
+    {
+        bus->storage = (can_frame_rec*) aligned_alloc(FRAME_RING_CACHE_LINE, CAN_GATEWAY_RING_SIZE * sizeof(can_frame_rec));
+        if ((bus->storage == NULLPTR) ||
+            (frame_ring_init(&bus->own_ring, me->id, bus->storage, CAN_GATEWAY_RING_SIZE) == false))
+        {
+            free(bus->storage);
+            free(bus->wildcards);
+            free(bus->copies);
+            can_id_table_destruct(&bus->dispatch);
+            return CAN_GATEWAY_NONE;
+        }
+        bus->ring = &bus->own_ring;
+        (void) can_socket_set_nonblocking(socket, true);
+    }
+
+    return me->bus_count++;
+}
+
+
+/**
+ * @name    void can_gateway_set_output(can_gateway* const me, u32 bus, can_gateway_output_callback output, void* ctx)
+ * 
+ * @brief   hands the frames for a bus to a callback instead of its socket, e.g. to
+ *          another queue or a test sink. The frames are only valid during the call.
+ * 
+ * @param   can_gateway* const          : object pointer to the struct.
+ *          u32                         : bus index
+ *          can_gateway_output_callback : takes a batch of frames, NULLPTR for the socket
+ *          void*                       : passed to the callback
+ * 
+ * @return  none.
+ */
+void can_gateway_set_output(can_gateway* const me, u32 bus, can_gateway_output_callback output, void* ctx)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (bus < me->bus_count)
+    {
+        me->buses[bus].output     = output;
+        me->buses[bus].output_ctx = ctx;
+    }
+
+    return;
+}
+
+
+/**
+ * @name    u32 can_gateway_add_rule(can_gateway* const me, can_gateway_rule const * const rule)
+ * 
+ * @brief   adds a route, it is used from the next can_gateway_compile() on
+ * 
+ * @param   can_gateway* const             : object pointer to the struct.
+ *          can_gateway_rule const * const : rule, buses have to be added already
+ * 
+ * @return  u32 : route index for stats and removal, CAN_GATEWAY_NONE if invalid or full.
+ */
+u32 can_gateway_add_rule(can_gateway* const me, can_gateway_rule const * const rule)
+{
+    can_gateway_route* route = NULLPTR;
+    u32 index;
+    u32 i;
+
+    if ((me == NULLPTR) || (rule == NULLPTR) || (rule->src_bus >= me->bus_count) ||
+        (rule->dst_bus >= me->bus_count) || (rule->mod_count > CAN_GATEWAY_MAX_MODS))
+    {
+        return CAN_GATEWAY_NONE;
+    }
+
+    for (i = 0U; i < rule->mod_count; i++)
+    {
+        if ((rule->mods[i].op < CAN_GATEWAY_OP_SET) || (rule->mods[i].op > CAN_GATEWAY_OP_XOR) ||
+            (rule->mods[i].index >= CAN_FRAME_MAX_DATA))
+        {
+            return CAN_GATEWAY_NONE;
+        }
+    }
+
+    // slots of removed rules are taken first
+    for (index = 0U; index < me->route_count; index++)
+    {
+        if (me->routes[index].active == false)
+        {
+            break;
+        }
+    }
+    if (index == me->max_routes)
+    {
+        return CAN_GATEWAY_NONE;
+    }
+
+    route = &me->routes[index];
+    memset(route, 0, sizeof(*route));
+    route->rule     = *rule;
+    route->active   = true;
+    route->rewrites = ((rule->rewrite_mask != 0U) || (rule->mod_count != 0U)) ? true : false;
+    if (rule->rate != 0U)
+    {
+        route->interval_ns  = 1000000000ULL / rule->rate;
+        route->tolerance_ns = route->interval_ns * rule->burst;
+    }
+
+    if (index == me->route_count)
+    {
+        me->route_count++;
+    }
+    me->compiled = false;
+
+    return index;
+}
+
+
+/**
+ * @name    __boolean can_gateway_remove_rule(can_gateway* const me, u32 route)
+ * 
+ * @brief   removes a route from the next can_gateway_compile() on
+ * 
+ * @param   can_gateway* const : object pointer to the struct.
+ *          u32                : route index
+ * 
+ * @return  __boolean          : true if the route existed.
+ */
+__boolean can_gateway_remove_rule(can_gateway* const me, u32 route)
+{
+    CHECK_NULLPTR_RET(me);
+
+    if ((route >= me->route_count) || (me->routes[route].active == false))
+    {
+        return false;
+    }
+
+    me->routes[route].active = false;
+    me->compiled = false;
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean can_gateway_compile(can_gateway* const me)
+ * 
+ * @brief   rebuilds the dispatch tables of all buses from the active rules. Called by
+ *          can_gateway_forward() after rule changes, rules and forwarding belong to
+ *          the same thread.
+ * 
+ * @param   can_gateway* const : object pointer to the struct.
+ * 
+ * @return  __boolean          : true if success, false if out of memory.
+ */
+__boolean can_gateway_compile(can_gateway* const me)
+{
+    u32 b;
+    u32 id;
+    u32 r;
+
+    CHECK_NULLPTR_RET(me);
+
+    me->list_size = 1U;
+
+    for (b = 0U; b < me->bus_count; b++)
+    {
+        can_gateway_bus* const bus = &me->buses[b];
+        u32 previous = CAN_GATEWAY_NONE;
+
+        can_id_table_clear(&bus->dispatch);
+        bus->wildcard_count = 0U;
+        bus->learned        = 0U;
+
+        // every 11 bit id gets its list, neighbouring ids mostly share one
+        for (id = 0U; id < CAN_ID_TABLE_STD_SIZE; id++)
+        {
+            u32 offset;
+
+            if (can_gateway_build_list(me, b, id, me->scan) == 0U)
+            {
+                continue;
+            }
+
+            offset = can_gateway_store_list(me, me->scan, previous);
+            if ((offset == CAN_GATEWAY_NONE) || (can_id_table_insert(&bus->dispatch, id, offset) == false))
+            {
+                return false;
+            }
+            previous = offset;
+        }
+
+        // 29 bit ids of exact rules are known now, the others on their first frame
+        for (r = 0U; r < me->route_count; r++)
+        {
+            can_gateway_rule const * const rule = &me->routes[r].rule;
+            u32 offset;
+
+            if ((me->routes[r].active == false) || (rule->src_bus != b) || (CAN_FRAME_IS_EXT(rule->can_id) == false))
+            {
+                continue;
+            }
+
+            if ((rule->mask & CAN_EFF_MASK) != CAN_EFF_MASK)
+            {
+                bus->wildcards[bus->wildcard_count++] = r;
+                continue;
+            }
+
+            (void) can_gateway_build_list(me, b, rule->can_id, me->scan);
+            offset = can_gateway_store_list(me, me->scan, CAN_GATEWAY_NONE);
+            if ((offset == CAN_GATEWAY_NONE) || (can_id_table_insert(&bus->dispatch, rule->can_id, offset) == false))
+            {
+                return false;
+            }
+        }
+    }
+
+    me->compiled = true;
+
+    return true;
+}
+
+
+/**
+ * @name    u32 can_gateway_receive(can_gateway* const me, u32 bus)
+ * 
+ * @brief   receives one batch from the socket of a bus straight into the slots of its
+ *          own ring, nothing for buses with a ring of the caller
+ * 
+ * @param   can_gateway* const : object pointer to the struct.
+ *          u32                : bus index
+ * 
+ * @return  u32 : number of received frames.
+ */
+u32 can_gateway_receive(can_gateway* const me, u32 bus)
+{
+    can_gateway_bus* target;
+    can_frame_rec* slots;
+    u32 space;
+    u32 n;
+
+    if ((me == NULLPTR) || (bus >= me->bus_count) || (me->buses[bus].storage == NULLPTR))
+    {
+        return 0U;
+    }
+
+    target = &me->buses[bus];
+    space = frame_ring_reserve(target->ring, &slots, CAN_GATEWAY_BATCH);
+    if (space == 0U)
+    {
+        return 0U;
+    }
+
+    n = can_socket_recv_batch(target->socket, slots, space);
+    frame_ring_commit(target->ring, n);
+
+    return n;
+}
+
+
+/**
+ * @name    u32 can_gateway_forward(can_gateway* const me, u32 bus)
+ * 
+ * @brief   forwards one batch from the RX ring of a bus. The frames are queued as
+ *          pointers to the ring slots, the TX batches of all buses are flushed before
+ *          the slots are released.
+ * 
+ * @param   can_gateway* const : object pointer to the struct.
+ *          u32                : bus index
+ * 
+ * @return  u32 : number of frames taken from the ring.
+ */
+u32 can_gateway_forward(can_gateway* const me, u32 bus)
+{
+    can_gateway_bus* source;
+    can_frame_rec* slots;
+    u64 start;
+    u32 n;
+    u32 i;
+    u32 k;
+    u32 b;
+
+    if ((me == NULLPTR) || (bus >= me->bus_count))
+    {
+        return 0U;
+    }
+
+    if ((me->compiled == false) && (can_gateway_compile(me) == false))
+    {
+        return 0U;
+    }
+
+    source = &me->buses[bus];
+    n = frame_ring_peek(source->ring, &slots, CAN_GATEWAY_BATCH);
+    if (n == 0U)
+    {
+        return 0U;
+    }
+
+    start = perf_counters_enter();
+    perf_counters_queue_depth(me->module_position, frame_ring_count(source->ring));
+
+    for (i = 0U; i < n; i++)
+    {
+        can_frame_rec* const frame = &slots[i];
+        u32 const * const list = can_gateway_resolve(me, bus, frame->can_id);
+
+        if ((list == NULLPTR) || (list[0] == 0U))
+        {
+            source->unrouted++;
+            continue;
+        }
+
+        for (k = 1U; k <= list[0]; k++)
+        {
+            can_gateway_route* const route = &me->routes[list[k]];
+            can_gateway_bus* const dst = &me->buses[route->rule.dst_bus];
+            can_frame_rec* out = frame;
+
+            route->stats.matched++;
+            if (can_gateway_admit(route, frame->timestamp_ns) == false)
+            {
+                route->stats.rate_limited++;
+                continue;
+            }
+
+            // the only route may change the slot itself, others get a copy
+            if (route->rewrites == true)
+            {
+                if (list[0] != 1U)
+                {
+                    out = &dst->copies[dst->copy_count++];
+                    memcpy(out, frame, __builtin_offsetof(can_frame_rec, data) + frame->len);
+                }
+                can_gateway_rewrite(&route->rule, out);
+            }
+
+            dst->tx[dst->tx_count]       = out;
+            dst->tx_route[dst->tx_count] = list[k];
+            dst->tx_count++;
+            if (dst->tx_count == CAN_GATEWAY_BATCH)
+            {
+                can_gateway_flush(me, route->rule.dst_bus);
+            }
+        }
+    }
+
+    for (b = 0U; b < me->bus_count; b++)
+    {
+        can_gateway_flush(me, b);
+    }
+
+    source->rx_frames += n;
+    frame_ring_release(source->ring, n);
+
+    perf_counters_count(me->module_position, n, 0U);
+    perf_counters_exit(me->module_position, start);
+
+    return n;
+}
+
+
+/**
+ * @name    u32 can_gateway_process(can_gateway* const me, s32 timeout_ms)
+ * 
+ * @brief   one round of a gateway thread: receives on the buses with an own ring,
+ *          waits up to timeout_ms for frames if there were none, and forwards all rings
+ * 
+ * @param   can_gateway* const : object pointer to the struct.
+ *          s32                : poll timeout, 0 to not wait, -1 forever
+ * 
+ * @return  u32 : number of frames taken from the rings.
+ */
+u32 can_gateway_process(can_gateway* const me, s32 timeout_ms)
+{
+    struct pollfd fds[CAN_GATEWAY_MAX_BUSES];
+    u32 received = 0U;
+    u32 forwarded = 0U;
+    u32 count = 0U;
+    u32 b;
+
+    CHECK_NULLPTR_RET(me);
+
+    for (b = 0U; b < me->bus_count; b++)
+    {
+        received += can_gateway_receive(me, b);
+    }
+
+    if ((received == 0U) && (timeout_ms != 0))
+    {
+        for (b = 0U; b < me->bus_count; b++)
+        {
+            if ((me->buses[b].storage != NULLPTR) && (frame_ring_count(me->buses[b].ring) == 0U))
+            {
+                fds[count].fd     = me->buses[b].socket->fd;
+                fds[count].events = POLLIN;
+                count++;
+            }
+        }
+
+        if ((count != 0U) && (poll(fds, count, timeout_ms) > 0))
+        {
+            for (b = 0U; b < me->bus_count; b++)
+            {
+                (void) can_gateway_receive(me, b);
+            }
+        }
+    }
+
+    for (b = 0U; b < me->bus_count; b++)
+    {
+        forwarded += can_gateway_forward(me, b);
+    }
+
+    return forwarded;
+}
+
+
+/**
+ * @name    void can_gateway_get_route_stats(can_gateway const * const me, u32 route, can_gateway_route_stats* const stats)
+ * 
+ * @brief   copies the counters of a route, zero for unknown routes
+ * 
+ * @param   can_gateway const * const      : object pointer to the struct.
+ *          u32                            : route index
+ *          can_gateway_route_stats* const : destination
+ * 
+ * @return  none.
+ */
+void can_gateway_get_route_stats(can_gateway const * const me, u32 route, can_gateway_route_stats* const stats)
+{
+    CHECK_NULLPTR_VOID(me);
+    CHECK_NULLPTR_VOID(stats);
+
+    if (route < me->route_count)
+    {
+        *stats = me->routes[route].stats;
+    }
+    else
+    {
+        memset(stats, 0, sizeof(*stats));
+    }
+
+    return;
+}
+
+
+/**
+ * @name    u64 can_gateway_latency_percentile(can_gateway_route_stats const * const stats, f64 percentile)
+ * 
+ * @brief   latency below which the given share of the forwarded frames stayed,
+ *          resolution is the power of two of the histogram bucket
+ * 
+ * @param   can_gateway_route_stats const * const : route counters
+ *          f64                                   : 0.0 .. 1.0
+ * 
+ * @return  u64 : latency in ns, 0 without frames.
+ */
+u64 can_gateway_latency_percentile(can_gateway_route_stats const * const stats, f64 percentile)
+{
+    u64 total = 0U;
+    u64 target;
+    u64 sum = 0U;
+    u32 b;
+
+    CHECK_NULLPTR_RET(stats);
+
+    for (b = 0U; b < CAN_GATEWAY_LATENCY_BUCKETS; b++)
+    {
+        total += stats->latency[b];
+    }
+    if (total == 0U)
+    {
+        return 0U;
+    }
+
+    target = (u64) ((f64) total * percentile);
+    target = GET_MAX(target, 1U);
+    for (b = 0U; b < CAN_GATEWAY_LATENCY_BUCKETS; b++)
+    {
+        sum += stats->latency[b];
+        if (sum >= target)
+        {
+            u64 const bound = 1ULL << b;
+            return GET_MIN(bound, stats->latency_max_ns);
+        }
+    }
+
+    return stats->latency_max_ns;
+}
+
+
+/**
+ * @name    static __boolean can_gateway_matches(can_gateway_rule const * const rule, u32 can_id)
+ * 
+ * @brief   tells whether a frame id matches a rule
+ * 
+ * @param   can_gateway_rule const * const : rule
+ *          u32                            : id in kernel layout
+ * 
+ * @return  __boolean : true on a match.
+ */
+static __boolean can_gateway_matches(can_gateway_rule const * const rule, u32 can_id)
+{
+    if (CAN_FRAME_IS_EXT(can_id) != CAN_FRAME_IS_EXT(rule->can_id))
+    {
+        return false;
+    }
+
+    return (((can_id ^ rule->can_id) & rule->mask & CAN_EFF_MASK) == 0U);
+}
+
+
+/**
+ * @name    static u32 can_gateway_build_list(can_gateway* const me, u32 bus, u32 can_id, u32* const list)
+ * 
+ * @brief   collects the routes of an id in rule order
+ * 
+ * @param   can_gateway* const : object pointer to the struct.
+ *          u32                : source bus
+ *          u32                : id in kernel layout
+ *          u32* const         : list, count followed by the route indexes
+ * 
+ * @return  u32 : number of routes.
+ */
+static u32 can_gateway_build_list(can_gateway* const me, u32 bus, u32 can_id, u32* const list)
+{
+    u32 r;
+
+    list[0] = 0U;
+
+    for (r = 0U; r < me->route_count; r++)
+    {
+        can_gateway_route const * const route = &me->routes[r];
+
+        if ((route->active == true) && (route->rule.src_bus == bus) && (can_gateway_matches(&route->rule, can_id) == true))
+        {
+            list[++list[0]] = r;
+        }
+    }
+
+    return list[0];
+}
+
+
+/**
+ * @name    static u32 can_gateway_store_list(can_gateway* const me, u32 const * const list, u32 previous)
+ * 
+ * @brief   appends a route list to the list storage unless it equals the previous one
+ * 
+ * @param   can_gateway* const : object pointer to the struct.
+ *          u32 const * const  : list, count followed by the route indexes
+ *          u32                : offset of the list stored last, CAN_GATEWAY_NONE for none
+ * 
+ * @return  u32 : offset of the list, CAN_GATEWAY_NONE if out of memory.
+ */
+static u32 can_gateway_store_list(can_gateway* const me, u32 const * const list, u32 previous)
+{
+    u32 const size = list[0] + 1U;
+    u32 offset;
+
+    if (list[0] == 0U)
+    {
+        return 0U;
+    }
+
+    if ((previous != CAN_GATEWAY_NONE) && (me->lists[previous] == list[0]) &&
+        (memcmp(&me->lists[previous], list, size * sizeof(u32)) == 0))
+    {
+        return previous;
+    }
+
+    if ((me->list_size + size) > me->list_capacity)
+    {
+        u32 capacity = me->list_capacity * 2U;
+        u32* lists;
+
+        while ((me->list_size + size) > capacity)
+        {
+            capacity *= 2U;
+        }
+
+        lists = (u32*) realloc(me->lists, capacity * sizeof(u32));
+        if (lists == NULLPTR)
+        {
+            return CAN_GATEWAY_NONE;
+        }
+        me->lists = lists;
+        me->list_capacity = capacity;
+    }
+
+    offset = me->list_size;
+    memcpy(&me->lists[offset], list, size * sizeof(u32));
+    me->list_size += size;
+
+    return offset;
+}
+
+
+/**
+ * @name    static u32 const * can_gateway_resolve(can_gateway* const me, u32 bus, u32 can_id)
+ * 
+ * @brief   route list of a frame. A 29 bit id without an entry is matched against the
+ *          partial mask rules once, the result (also an empty one) goes into the table.
+ * 
+ * @param   can_gateway* const : object pointer to the struct.
+ *          u32                : source bus
+ *          u32                : id in kernel layout
+ * 
+ * @return  u32 const * : list, NULLPTR if the frame has no route.
+ */
+static u32 const * can_gateway_resolve(can_gateway* const me, u32 bus, u32 can_id)
+{
+    can_gateway_bus* const source = &me->buses[bus];
+    u32 offset;
+    u32 w;
+
+    if (CAN_FRAME_IS_ERR(can_id) == true)
+    {
+        return NULLPTR;
+    }
+
+    offset = can_id_table_lookup(&source->dispatch, can_id);
+    if (offset != CAN_ID_TABLE_NONE)
+    {
+        return &me->lists[offset];
+    }
+
+    if ((CAN_FRAME_IS_EXT(can_id) == false) || (source->wildcard_count == 0U))
+    {
+        return NULLPTR;
+    }
+
+    me->scan[0] = 0U;
+    for (w = 0U; w < source->wildcard_count; w++)
+    {
+        if (can_gateway_matches(&me->routes[source->wildcards[w]].rule, can_id) == true)
+        {
+            me->scan[++me->scan[0]] = source->wildcards[w];
+        }
+    }
+
+    // without room the id is matched again on every frame
+    if (source->learned < CAN_GATEWAY_MAX_LEARNED)
+    {
+        offset = can_gateway_store_list(me, me->scan, CAN_GATEWAY_NONE);
+        if ((offset != CAN_GATEWAY_NONE) && (can_id_table_insert(&source->dispatch, can_id, offset) == true))
+        {
+            source->learned++;
+            return &me->lists[offset];
+        }
+    }
+
+    return me->scan;
+}
+
+
+/**
+ * @name    static void can_gateway_rewrite(can_gateway_rule const * const rule, can_frame_rec* const frame)
+ * 
+ * @brief   applies the id rewrite and the payload modifications of a rule
+ * 
+ * @param   can_gateway_rule const * const : rule
+ *          can_frame_rec* const           : frame, changed in place
+ * 
+ * @return  none.
+ */
+static void can_gateway_rewrite(can_gateway_rule const * const rule, can_frame_rec* const frame)
+{
+    u32 i;
+
+    if (rule->rewrite_mask != 0U)
+    {
+        u32 const id = (frame->can_id & ~rule->rewrite_mask) | (rule->rewrite_id & rule->rewrite_mask);
+
+        frame->can_id = id & (CAN_EFF_FLAG | CAN_RTR_FLAG | (CAN_FRAME_IS_EXT(id) ? CAN_EFF_MASK : CAN_SFF_MASK));
+    }
+
+    for (i = 0U; i < rule->mod_count; i++)
+    {
+        can_gateway_mod const * const mod = &rule->mods[i];
+
+        if (mod->index >= frame->len)
+        {
+            continue;
+        }
+
+        switch (mod->op)
+        {
+            case CAN_GATEWAY_OP_SET:
+                frame->data[mod->index] = mod->value;
+                break;
+            case CAN_GATEWAY_OP_AND:
+                frame->data[mod->index] &= mod->value;
+                break;
+            case CAN_GATEWAY_OP_OR:
+                frame->data[mod->index] |= mod->value;
+                break;
+            default:
+                frame->data[mod->index] ^= mod->value;
+                break;
+        }
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static __boolean can_gateway_admit(can_gateway_route* const route, u64 timestamp_ns)
+ * 
+ * @brief   rate limit as generic cell rate algorithm: a frame passes while it is at
+ *          most the burst tolerance ahead of its theoretical arrival time. Uses the
+ *          receive timestamps, so it limits what arrived and not when it was forwarded.
+ * 
+ * @param   can_gateway_route* const : route
+ *          u64                      : receive time of the frame
+ * 
+ * @return  __boolean : true if the frame may pass.
+ */
+static __boolean can_gateway_admit(can_gateway_route* const route, u64 timestamp_ns)
+{
+    u64 tat;
+
+    if (route->interval_ns == 0U)
+    {
+        return true;
+    }
+
+    tat = GET_MAX(route->tat_ns, timestamp_ns);
+    if ((tat - timestamp_ns) > route->tolerance_ns)
+    {
+        return false;
+    }
+    route->tat_ns = tat + route->interval_ns;
+
+    return true;
+}
+
+
+/**
+ * @name    static void can_gateway_flush(can_gateway* const me, u32 bus)
+ * 
+ * @brief   sends the TX batch of a bus and accounts every frame to its route
+ * 
+ * @param   can_gateway* const : object pointer to the struct.
+ *          u32                : bus index
+ * 
+ * @return  none.
+ */
+static void can_gateway_flush(can_gateway* const me, u32 bus)
+{
+    can_gateway_bus* const target = &me->buses[bus];
+    struct timespec ts;
+    u64 now;
+    u32 sent = 0U;
+    u32 i;
+
+    if (target->tx_count == 0U)
+    {
+        return;
+    }
+
+    if (target->output != NULLPTR)
+    {
+        sent = target->output(target->output_ctx, target->tx, target->tx_count);
+    }
+    else if (target->socket != NULLPTR)
+    {
+        sent = can_socket_send_ptrs(target->socket, target->tx, target->tx_count);
+    }
+
+    // receive timestamps are CLOCK_REALTIME
+    clock_gettime(CLOCK_REALTIME, &ts);
+    now = ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+
+    for (i = 0U; i < target->tx_count; i++)
+    {
+        can_gateway_route_stats* const stats = &me->routes[target->tx_route[i]].stats;
+        u64 latency;
+        u32 bucket;
+
+        if (i >= sent)
+        {
+            stats->tx_dropped++;
+            continue;
+        }
+
+        latency = (now > target->tx[i]->timestamp_ns) ? (now - target->tx[i]->timestamp_ns) : 0U;
+        bucket  = (latency == 0U) ? 0U : (64U - (u32) __builtin_clzll(latency));
+        bucket  = GET_MIN(bucket, CAN_GATEWAY_LATENCY_BUCKETS - 1U);
+
+        stats->forwarded++;
+        stats->latency_sum_ns += latency;
+        stats->latency_max_ns  = GET_MAX(stats->latency_max_ns, latency);
+        stats->latency[bucket]++;
+    }
+
+    target->tx_frames  += sent;
+    target->tx_dropped += target->tx_count - sent;
+    target->tx_count   = 0U;
+    target->copy_count = 0U;
+
+    return;
+}
@@ -0,0 +1,264 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+
+#define __CAN_ID_TABLE_H_
+#include "can_id_table.h"
+
+/**
+ * @name    __boolean can_id_table_init(can_id_table* const me, u8 __id, u32 ext_capacity)
+ * 
+ * @brief   empty table, the hash is sized for ext_capacity 29 bit ids and grows when 
+ *          more are inserted
+ * 
+ * @param   can_id_table* const : object pointer to the struct.
+ *          u8                  : module id for the registration 
+ *          u32                 : expected number of 29 bit ids, 0 for none
+ * 
+ * @return  __boolean           : true if success, false if something went wrong.
+ */
+__boolean can_id_table_init(can_id_table* const me, u8 __id, u32 ext_capacity)
+{
+    u32 slots = CAN_ID_TABLE_MIN_EXT;
+
+    CHECK_NULLPTR_RET(me);
+
+    memset(me, 0, sizeof(*me));
+    memset(me->std, 0xFF, sizeof(me->std));
+
+    while ((slots / 2U) < ext_capacity)
+    {
+        slots *= 2U;
+    }
+
+    if (can_id_table_grow(me, slots) == false)
+    {
+        return false;
+    }
+
+    me->module_position = utils_register_module(CAN_ID_TABLE_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void can_id_table_destruct(can_id_table* const me)
+ * 
+ * @brief   frees the hash and releases the registration 
+ * 
+ * @param   can_id_table* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void can_id_table_destruct(can_id_table* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    free(me->ext_keys);
+    free(me->ext_values);
+    me->ext_keys   = NULLPTR;
+    me->ext_values = NULLPTR;
+    me->ext_count  = 0U;
+
+    utils_remove_module_registration(me->module_position);
+
+    return;
+}
+
+
+/**
+ * @name    void can_id_table_clear(can_id_table* const me)
+ * 
+ * @brief   removes every id, the hash keeps its size 
+ * 
+ * @param   can_id_table* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void can_id_table_clear(can_id_table* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    memset(me->std, 0xFF, sizeof(me->std));
+    memset(me->ext_keys, 0xFF, (me->ext_mask + 1U) * sizeof(u32));
+    me->ext_count = 0U;
+
+    return;
+}
+
+
+/**
+ * @name    __boolean can_id_table_insert(can_id_table* const me, u32 can_id, u32 value)
+ * 
+ * @brief   stores or replaces the value of an id 
+ * 
+ * @param   can_id_table* const : object pointer to the struct.
+ *          u32                 : id in kernel layout, CAN_EFF_FLAG selects the 29 bit table
+ *          u32                 : value, anything but CAN_ID_TABLE_NONE
+ * 
+ * @return  __boolean           : true if success, false if something went wrong.
+ */
+__boolean can_id_table_insert(can_id_table* const me, u32 can_id, u32 value)
+{
+    u32 id;
+    u32 slot;
+
+    CHECK_NULLPTR_RET(me);
+
+    if (value == CAN_ID_TABLE_NONE)
+    {
+        return false;
+    }
+
+    if (CAN_FRAME_IS_EXT(can_id) == false)
+    {
+        me->std[can_id & CAN_SFF_MASK] = value;
+        return true;
+    }
+
+    // at most half full, probe sequences stay short 
+    if (((me->ext_count + 1U) * 2U) > (me->ext_mask + 1U))
+    {
+        if (can_id_table_grow(me, (me->ext_mask + 1U) * 2U) == false)
+        {
+            return false;
+        }
+    }
+
+    id   = can_id & CAN_EFF_MASK;
+    slot = can_id_table_hash(id) & me->ext_mask;
+    while ((me->ext_keys[slot] != CAN_ID_TABLE_NONE) && (me->ext_keys[slot] != id))
+    {
+        slot = (slot + 1U) & me->ext_mask;
+    }
+
+    if (me->ext_keys[slot] == CAN_ID_TABLE_NONE)
+    {
+        me->ext_keys[slot] = id;
+        me->ext_count++;
+    }
+    me->ext_values[slot] = value;
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean can_id_table_remove(can_id_table* const me, u32 can_id)
+ * 
+ * @brief   removes an id. The hash uses backward shift deletion, so no tombstones 
+ *          pile up on tables that are rebuilt often.
+ * 
+ * @param   can_id_table* const : object pointer to the struct.
+ *          u32                 : id in kernel layout 
+ * 
+ * @return  __boolean           : true if the id was present.
+ */
+__boolean can_id_table_remove(can_id_table* const me, u32 can_id)
+{
+    u32 id;
+    u32 slot;
+    u32 next;
+
+    CHECK_NULLPTR_RET(me);
+
+    if (CAN_FRAME_IS_EXT(can_id) == false)
+    {
+        if (me->std[can_id & CAN_SFF_MASK] == CAN_ID_TABLE_NONE)
+        {
+            return false;
+        }
+        me->std[can_id & CAN_SFF_MASK] = CAN_ID_TABLE_NONE;
+        return true;
+    }
+
+    id   = can_id & CAN_EFF_MASK;
+    slot = can_id_table_hash(id) & me->ext_mask;
+    while (me->ext_keys[slot] != id)
+    {
+        if (me->ext_keys[slot] == CAN_ID_TABLE_NONE)
+        {
+            return false;
+        }
+        slot = (slot + 1U) & me->ext_mask;
+    }
+
+    // pull every following entry of the cluster back that may not stay behind the hole 
+    next = (slot + 1U) & me->ext_mask;
+    while (me->ext_keys[next] != CAN_ID_TABLE_NONE)
+    {
+        u32 const home = can_id_table_hash(me->ext_keys[next]) & me->ext_mask;
+
+        if (((next - home) & me->ext_mask) >= ((next - slot) & me->ext_mask))
+        {
+            me->ext_keys[slot]   = me->ext_keys[next];
+            me->ext_values[slot] = me->ext_values[next];
+            slot = next;
+        }
+        next = (next + 1U) & me->ext_mask;
+    }
+
+    me->ext_keys[slot] = CAN_ID_TABLE_NONE;
+    me->ext_count--;
+
+    return true;
+}
+
+
+/**
+ * @name    static __boolean can_id_table_grow(can_id_table* const me, u32 slots)
+ * 
+ * @brief   moves the hash into a new allocation of slots entries 
+ * 
+ * @param   can_id_table* const : object pointer to the struct.
+ *          u32                 : new number of slots, power of two 
+ * 
+ * @return  __boolean           : true if success, false if something went wrong.
+ */
+static __boolean can_id_table_grow(can_id_table* const me, u32 slots)
+{
+    u32* const keys   = (u32*) malloc(slots * sizeof(u32));
+    u32* const values = (u32*) malloc(slots * sizeof(u32));
+    u32 i;
+
+    if ((keys == NULLPTR) || (values == NULLPTR))
+    {
+        free(keys);
+        free(values);
+        return false;
+    }
+
+    memset(keys, 0xFF, slots * sizeof(u32));
+
+    if (me->ext_keys != NULLPTR)
+    {
+        for (i = 0U; i <= me->ext_mask; ++i)
+        {
+            u32 slot;
+
+            if (me->ext_keys[i] == CAN_ID_TABLE_NONE)
+            {
+                continue;
+            }
+
+            slot = can_id_table_hash(me->ext_keys[i]) & (slots - 1U);
+            while (keys[slot] != CAN_ID_TABLE_NONE)
+            {
+                slot = (slot + 1U) & (slots - 1U);
+            }
+            keys[slot]   = me->ext_keys[i];
+            values[slot] = me->ext_values[i];
+        }
+    }
+
+    free(me->ext_keys);
+    free(me->ext_values);
+    me->ext_keys   = keys;
+    me->ext_values = values;
+    me->ext_mask   = slots - 1U;
+
+    return true;
+}
@@ -0,0 +1,427 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can/raw.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "perf_counters.h"
+
+#define __CAN_SOCKET_H_
+#include "can_socket.h"
+
+/**
+ * @name    __boolean can_socket_open(can_socket* const me, u8 __id, char const * const ifname, u8 bus, __boolean enable_fd)
+ * 
+ * @brief   opens a raw CAN socket bound to one interface, with kernel receive timestamps
+ * 
+ * @param   can_socket* const  : object pointer to the struct.
+ *          u8                 : module id for the registration 
+ *          char const * const : interface name, e.g. "vcan0"
+ *          u8                 : bus index written into received frames
+ *          __boolean          : true to send and receive CAN FD frames 
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean can_socket_open(can_socket* const me, u8 __id, char const * const ifname, u8 bus, __boolean enable_fd)
+{
+    struct sockaddr_can addr;
+    int const on = 1;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(ifname);
+
+    memset(me, 0, sizeof(*me));
+    me->fd = socket(PF_CAN, SOCK_RAW | SOCK_CLOEXEC, CAN_RAW);
+    if (me->fd < 0)
+    {
+        return false;
+    }
+
+    me->ifindex = (int) if_nametoindex(ifname);
+    if (me->ifindex == 0)
+    {
+        close(me->fd);
+        me->fd = -1;
+        return false;
+    }
+
+    if ((enable_fd == true) && (setsockopt(me->fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &on, sizeof(on)) != 0))
+    {
+        close(me->fd);
+        me->fd = -1;
+        return false;
+    }
+    (void) setsockopt(me->fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family  = AF_CAN;
+    addr.can_ifindex = me->ifindex;
+    if (bind(me->fd, (struct sockaddr*) &addr, sizeof(addr)) != 0)
+    {
+        close(me->fd);
+        me->fd = -1;
+        return false;
+    }
+
+    strncpy(me->ifname, ifname, sizeof(me->ifname) - 1U);
+    me->bus        = bus;
+    me->fd_enabled = enable_fd;
+    me->module_position = utils_register_module(CAN_SOCKET_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void can_socket_close(can_socket* const me)
+ * 
+ * @brief   closes the socket 
+ * 
+ * @param   can_socket* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void can_socket_close(can_socket* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->fd >= 0)
+    {
+        close(me->fd);
+        utils_remove_module_registration(me->module_position);
+    }
+    me->fd = -1;
+
+    return;
+}
+
+
+/**
+ * @name    __boolean can_socket_set_nonblocking(can_socket* const me, __boolean nonblocking)
+ * 
+ * @brief   switches the socket between blocking and non blocking mode (for epoll users)
+ * 
+ * @param   can_socket* const : object pointer to the struct.
+ *          __boolean         : true for non blocking 
+ * 
+ * @return  __boolean         : true if success, false if something went wrong.
+ */
+__boolean can_socket_set_nonblocking(can_socket* const me, __boolean nonblocking)
+{
+    int flags;
+
+    CHECK_NULLPTR_RET(me);
+
+    flags = fcntl(me->fd, F_GETFL, 0);
+    if (flags < 0)
+    {
+        return false;
+    }
+    flags = (nonblocking == true) ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+
+    return (fcntl(me->fd, F_SETFL, flags) == 0);
+}
+
+
+/**
+ * @name    __boolean can_socket_set_filters(can_socket* const me, struct can_filter const * const filters, u32 count)
+ * 
+ * @brief   installs kernel receive filters, count 0 receives nothing 
+ * 
+ * @param   can_socket* const               : object pointer to the struct.
+ *          struct can_filter const * const : id/mask pairs
+ *          u32                             : number of filters
+ * 
+ * @return  __boolean : true if success, false if something went wrong.
+ */
+__boolean can_socket_set_filters(can_socket* const me, struct can_filter const * const filters, u32 count)
+{
+    CHECK_NULLPTR_RET(me);
+
+    return (setsockopt(me->fd, SOL_CAN_RAW, CAN_RAW_FILTER, filters, count * sizeof(struct can_filter)) == 0);
+}
+
+
+/**
+ * @name    __boolean can_socket_set_buffers(can_socket* const me, u32 rx_bytes, u32 tx_bytes)
+ * 
+ * @brief   sizes the kernel socket buffers for bursts of many frames. The limits of 
+ *          net.core.rmem_max/wmem_max are bypassed when the process may (CAP_NET_ADMIN).
+ * 
+ * @param   can_socket* const : object pointer to the struct.
+ *          u32               : receive buffer in bytes, 0 leaves it 
+ *          u32               : send buffer in bytes, 0 leaves it 
+ * 
+ * @return  __boolean         : true if both could be set, possibly capped by the kernel.
+ */
+__boolean can_socket_set_buffers(can_socket* const me, u32 rx_bytes, u32 tx_bytes)
+{
+    int const rx = (int) rx_bytes;
+    int const tx = (int) tx_bytes;
+    __boolean ret = true;
+
+    CHECK_NULLPTR_RET(me);
+
+    if ((rx_bytes != 0U) && 
+        (setsockopt(me->fd, SOL_SOCKET, SO_RCVBUFFORCE, &rx, sizeof(rx)) != 0) && 
+        (setsockopt(me->fd, SOL_SOCKET, SO_RCVBUF, &rx, sizeof(rx)) != 0))
+    {
+        ret = false;
+    }
+
+    if ((tx_bytes != 0U) && 
+        (setsockopt(me->fd, SOL_SOCKET, SO_SNDBUFFORCE, &tx, sizeof(tx)) != 0) && 
+        (setsockopt(me->fd, SOL_SOCKET, SO_SNDBUF, &tx, sizeof(tx)) != 0))
+    {
+        ret = false;
+    }
+
+    return ret;
+}
+
+
+/**
+ * @name    u32 can_socket_send_batch(can_socket* const me, can_frame_rec* const frames, u32 count)
+ * 
+ * @brief   sends an array of frames with as few sendmmsg calls as possible 
+ * 
+ * @param   can_socket* const    : object pointer to the struct.
+ *          can_frame_rec* const : frames, sent from their own memory
+ *          u32                  : number of frames 
+ * 
+ * @return  u32 : number of frames accepted by the kernel.
+ */
+u32 can_socket_send_batch(can_socket* const me, can_frame_rec* const frames, u32 count)
+{
+    struct mmsghdr msgs[CAN_SOCKET_MAX_BATCH];
+    struct iovec   iovs[CAN_SOCKET_MAX_BATCH];
+    u32 sent = 0U;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frames);
+
+    while (sent < count)
+    {
+        u32 const n = GET_MIN(count - sent, CAN_SOCKET_MAX_BATCH);
+        u32 done;
+        u32 i;
+
+        for (i = 0U; i < n; ++i)
+        {
+            iovs[i].iov_base = can_frame_rec_kernel(&frames[sent + i]);
+            iovs[i].iov_len  = can_socket_mtu(&frames[sent + i]);
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov    = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1U;
+        }
+
+        done = can_socket_sendmmsg(me, msgs, n);
+        sent += done;
+        if (done < n)
+        {
+            break;
+        }
+    }
+
+    return sent;
+}
+
+
+/**
+ * @name    u32 can_socket_send_ptrs(can_socket* const me, can_frame_rec* const * const frames, u32 count)
+ * 
+ * @brief   like can_socket_send_batch() for frames scattered in memory, e.g. still 
+ *          sitting in the slots of a receive ring 
+ * 
+ * @param   can_socket* const            : object pointer to the struct.
+ *          can_frame_rec* const * const : pointers to the frames 
+ *          u32                          : number of frames 
+ * 
+ * @return  u32 : number of frames accepted by the kernel.
+ */
+u32 can_socket_send_ptrs(can_socket* const me, can_frame_rec* const * const frames, u32 count)
+{
+    struct mmsghdr msgs[CAN_SOCKET_MAX_BATCH];
+    struct iovec   iovs[CAN_SOCKET_MAX_BATCH];
+    u32 sent = 0U;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frames);
+
+    while (sent < count)
+    {
+        u32 const n = GET_MIN(count - sent, CAN_SOCKET_MAX_BATCH);
+        u32 done;
+        u32 i;
+
+        for (i = 0U; i < n; ++i)
+        {
+            iovs[i].iov_base = can_frame_rec_kernel(frames[sent + i]);
+            iovs[i].iov_len  = can_socket_mtu(frames[sent + i]);
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov    = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1U;
+        }
+
+        done = can_socket_sendmmsg(me, msgs, n);
+        sent += done;
+        if (done < n)
+        {
+            break;
+        }
+    }
+
+    return sent;
+}
+
+
+/**
+ * @name    u32 can_socket_recv_batch(can_socket* const me, can_frame_rec* const frames, u32 max)
+ * 
+ * @brief   receives up to max frames with one recvmmsg call. Blocks for the first frame 
+ *          on a blocking socket, returns 0 at once on a non blocking one. The timestamp 
+ *          is the kernel receive time (CLOCK_REALTIME).
+ * 
+ * @param   can_socket* const    : object pointer to the struct.
+ *          can_frame_rec* const : destination records 
+ *          u32                  : capacity of the destination
+ * 
+ * @return  u32 : number of received frames.
+ */
+u32 can_socket_recv_batch(can_socket* const me, can_frame_rec* const frames, u32 max)
+{
+    struct mmsghdr msgs[CAN_SOCKET_MAX_BATCH];
+    struct iovec   iovs[CAN_SOCKET_MAX_BATCH];
+    u8             ctrl[CAN_SOCKET_MAX_BATCH][CMSG_SPACE(sizeof(struct timespec))];
+    struct timespec now;
+    u64 bytes = 0U;
+    int n;
+    int i;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frames);
+
+    max = GET_MIN(max, CAN_SOCKET_MAX_BATCH);
+    for (i = 0; i < (int) max; ++i)
+    {
+        iovs[i].iov_base = can_frame_rec_kernel(&frames[i]);
+        iovs[i].iov_len  = sizeof(struct canfd_frame);
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov        = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen     = 1U;
+        msgs[i].msg_hdr.msg_control    = ctrl[i];
+        msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+    }
+
+    n = recvmmsg(me->fd, msgs, max, MSG_WAITFORONE, NULLPTR);
+    if (n <= 0)
+    {
+        return 0U;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    for (i = 0; i < n; ++i)
+    {
+        can_frame_rec* const frame = &frames[i];
+        struct cmsghdr* cmsg;
+        struct timespec const * ts = &now;
+
+        for (cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg != NULLPTR; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg))
+        {
+            if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_TIMESTAMPNS))
+            {
+                ts = (struct timespec const *) CMSG_DATA(cmsg);
+            }
+        }
+
+        frame->timestamp_ns = ((u64) ts->tv_sec * 1000000000ULL) + (u64) ts->tv_nsec;
+        frame->flags = (msgs[i].msg_len == CANFD_MTU) ? (frame->flags | CAN_FRAME_FLAG_FD) : 0U;
+        frame->bus   = me->bus;
+        bytes += msgs[i].msg_len;
+    }
+
+    me->rx_frames += (u64) n;
+    perf_counters_count(me->module_position, (u64) n, bytes);
+
+    return (u32) n;
+}
+
+
+/**
+ * @name    static u32 can_socket_sendmmsg(can_socket* const me, struct mmsghdr* const msgs, u32 count)
+ * 
+ * @brief   sendmmsg with a short back off while the device queue is full (ENOBUFS), 
+ *          which real controllers report long before the socket buffer is exhausted
+ * 
+ * @param   can_socket* const     : object pointer to the struct.
+ *          struct mmsghdr* const : prepared messages 
+ *          u32                   : number of messages
+ * 
+ * @return  u32 : number of sent messages.
+ */
+static u32 can_socket_sendmmsg(can_socket* const me, struct mmsghdr* const msgs, u32 count)
+{
+    struct timespec const backoff = { 0, CAN_SOCKET_TX_BACKOFF_NS };
+    u32 sent = 0U;
+    u32 retries = 0U;
+    u64 bytes = 0U;
+    u32 i;
+
+    while (sent < count)
+    {
+        int const n = sendmmsg(me->fd, &msgs[sent], count - sent, 0);
+        if (n > 0)
+        {
+            sent += (u32) n;
+            continue;
+        }
+
+        if (((errno == ENOBUFS) || (errno == EAGAIN)) && (retries++ < CAN_SOCKET_TX_RETRIES))
+        {
+            nanosleep(&backoff, NULLPTR);
+            continue;
+        }
+
+        if (errno != EINTR)
+        {
+            me->tx_errors += count - sent;
+            break;
+        }
+    }
+
+    me->tx_frames += sent;
+
+    for (i = 0U; i < sent; ++i)
+    {
+        bytes += msgs[i].msg_len;
+    }
+    perf_counters_count(me->module_position, sent, bytes);
+    if (sent < count)
+    {
+        perf_counters_fail(me->module_position, count - sent);
+    }
+
+    return sent;
+}
+
+
+/**
+ * @name    static inline u32 can_socket_mtu(can_frame_rec const * const frame)
+ * 
+ * @brief   size of the kernel frame to be written for a record 
+ * 
+ * @param   can_frame_rec const * const : frame 
+ * 
+ * @return  u32 : CAN_MTU or CANFD_MTU.
+ */
+static inline u32 can_socket_mtu(can_frame_rec const * const frame)
+{
+    return ((frame->flags & CAN_FRAME_FLAG_FD) != 0U) ? CANFD_MTU : CAN_MTU;
+}
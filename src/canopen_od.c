@@ -0,0 +1,189 @@
+#include <string.h>
+
+#include "utils.h"
+
+#define __CANOPEN_OD_H_
+#include "canopen_od.h"
+
+/**
+ * @name    canopen_od_entry const * canopen_od_find(canopen_od const * const me, u16 index, u8 sub)
+ * 
+ * @brief   two level search: a branch free binary search over the fences selects one 
+ *          cache line of keys, which is then compared as a whole. A dictionary of 
+ *          thousands of entries costs a handful of fence probes and one key line. 
+ * 
+ * @param   canopen_od const * const : dictionary 
+ *          u16                      : index 
+ *          u8                       : subindex 
+ * 
+ * @return  canopen_od_entry const * : entry, NULLPTR if it does not exist.
+ */
+canopen_od_entry const * canopen_od_find(canopen_od const * const me, u16 index, u8 sub)
+{
+    u32 const key = CANOPEN_OD_KEY(index, sub);
+    u32 const * const fences = me->fences;
+    u32 const * line;
+    u32 base = 0U;
+    u32 n = me->fence_count;
+    u32 pos = 0U;
+    u32 i;
+
+    if (n == 0U)
+    {
+        return NULLPTR;
+    }
+
+    while (n > 1U)
+    {
+        u32 const half = n / 2U;
+        base = (fences[base + half] <= key) ? (base + half) : base;
+        n -= half;
+    }
+
+    // keys below the wanted one in the line, the padding never counts 
+    line = &me->keys[base * CANOPEN_OD_LINE_KEYS];
+    for (i = 0U; i < CANOPEN_OD_LINE_KEYS; ++i)
+    {
+        pos += (line[i] < key);
+    }
+
+    if ((pos == CANOPEN_OD_LINE_KEYS) || (line[pos] != key))
+    {
+        return NULLPTR;
+    }
+
+    return &me->entries[(base * CANOPEN_OD_LINE_KEYS) + pos];
+}
+
+
+/**
+ * @name    u32 canopen_od_read(canopen_od const * const me, canopen_od_entry const * const entry, void* const dst, u32 size, u32* const read)
+ * 
+ * @brief   copies the value of an entry after the access check 
+ * 
+ * @param   canopen_od const * const       : dictionary 
+ *          canopen_od_entry const * const : entry 
+ *          void* const                    : destination 
+ *          u32                            : size of the destination 
+ *          u32* const                     : returns the bytes copied, may be NULLPTR 
+ * 
+ * @return  u32 : CANOPEN_OD_OK or an SDO abort code.
+ */
+u32 canopen_od_read(canopen_od const * const me, canopen_od_entry const * const entry, void* const dst, u32 size, u32* const read)
+{
+    if (entry == NULLPTR)
+    {
+        return CANOPEN_OD_ABORT_NO_OBJECT;
+    }
+
+    if ((entry->access & CANOPEN_OD_READ) == 0U)
+    {
+        return CANOPEN_OD_ABORT_WRITE_ONLY;
+    }
+
+    if (size < entry->size)
+    {
+        return CANOPEN_OD_ABORT_LENGTH_HIGH;
+    }
+
+    memcpy(dst, canopen_od_value(me, entry), entry->size);
+    if (read != NULLPTR)
+    {
+        *read = entry->size;
+    }
+
+    return CANOPEN_OD_OK;
+}
+
+
+/**
+ * @name    u32 canopen_od_write(canopen_od const * const me, canopen_od_entry const * const entry, void const * const src, u32 size)
+ * 
+ * @brief   stores a value after the access and length check. Numbers need their exact 
+ *          size, strings and domains may be shorter and are zero padded. 
+ * 
+ * @param   canopen_od const * const       : dictionary 
+ *          canopen_od_entry const * const : entry 
+ *          void const * const             : new value 
+ *          u32                            : size of the new value 
+ * 
+ * @return  u32 : CANOPEN_OD_OK or an SDO abort code.
+ */
+u32 canopen_od_write(canopen_od const * const me, canopen_od_entry const * const entry, void const * const src, u32 size)
+{
+    u8* value;
+
+    if (entry == NULLPTR)
+    {
+        return CANOPEN_OD_ABORT_NO_OBJECT;
+    }
+
+    if (((entry->access & CANOPEN_OD_WRITE) == 0U) || ((entry->access & CANOPEN_OD_CONST) != 0U))
+    {
+        return CANOPEN_OD_ABORT_READ_ONLY;
+    }
+
+    if (size > entry->size)
+    {
+        return CANOPEN_OD_ABORT_LENGTH_HIGH;
+    }
+
+    value = (u8*) canopen_od_value(me, entry);
+    switch (entry->type)
+    {
+        case CANOPEN_OD_VISIBLE_STRING:
+        case CANOPEN_OD_OCTET_STRING:
+        case CANOPEN_OD_DOMAIN:
+            memcpy(value, src, size);
+            memset(&value[size], 0, entry->size - size);
+            break;
+        default:
+            if (size < entry->size)
+            {
+                return CANOPEN_OD_ABORT_LENGTH_LOW;
+            }
+            memcpy(value, src, size);
+            break;
+    }
+
+    return CANOPEN_OD_OK;
+}
+
+
+/**
+ * @name    u32 canopen_od_sdo_read(canopen_od const * const me, u16 index, u8 sub, void* const dst, u32 size, u32* const read)
+ * 
+ * @brief   lookup and read, as an SDO upload needs it 
+ * 
+ * @param   canopen_od const * const : dictionary 
+ *          u16                      : index 
+ *          u8                       : subindex 
+ *          void* const              : destination 
+ *          u32                      : size of the destination 
+ *          u32* const               : returns the bytes copied, may be NULLPTR 
+ * 
+ * @return  u32 : CANOPEN_OD_OK or an SDO abort code.
+ */
+u32 canopen_od_sdo_read(canopen_od const * const me, u16 index, u8 sub, void* const dst, u32 size, u32* const read)
+{
+    return canopen_od_read(me, canopen_od_find(me, index, sub), dst, size, read);
+}
+
+
+/**
+ * @name    u32 canopen_od_sdo_write(canopen_od const * const me, u16 index, u8 sub, void const * const src, u32 size)
+ * 
+ * @brief   lookup and write, as an SDO download needs it 
+ * 
+ * @param   canopen_od const * const : dictionary 
+ *          u16                      : index 
+ *          u8                       : subindex 
+ *          void const * const       : new value 
+ *          u32                      : size of the new value 
+ * 
+ * @return  u32 : CANOPEN_OD_OK or an SDO abort code.
+ */
+u32 canopen_od_sdo_write(canopen_od const * const me, u16 index, u8 sub, void const * const src, u32 size)
+{
+    return canopen_od_write(me, canopen_od_find(me, index, sub), src, size);
+}
@@ -0,0 +1,1088 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "can_socket.h"
+#include "can_id_table.h"
+#include "canopen_od.h"
+
+#define __CANOPEN_PDO_H_
+#include "canopen_pdo.h"
+
+/**
+ * @name    __boolean canopen_pdo_init(canopen_pdo_engine* const me, u8 __id, can_socket* const socket, u32 max_pdos)
+ * 
+ * @brief   engine without PDOs, SYNC is expected on CANOPEN_PDO_SYNC_COB_ID
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ *          u8                        : module id for the registration 
+ *          can_socket* const         : socket the TPDOs go to, NULLPTR to only build them
+ *          u32                       : maximum number of RPDOs and TPDOs of all nodes
+ * 
+ * @return  __boolean                 : true if success, false if something went wrong.
+ */
+__boolean canopen_pdo_init(canopen_pdo_engine* const me, u8 __id, can_socket* const socket, u32 max_pdos)
+{
+    CHECK_NULLPTR_RET(me);
+
+    if (max_pdos == 0U)
+    {
+        return false;
+    }
+
+    memset(me, 0, sizeof(*me));
+    me->socket        = socket;
+    me->max_pdos      = max_pdos;
+    me->sync_id       = CANOPEN_PDO_SYNC_COB_ID;
+    me->configs       = (canopen_pdo_config*) calloc(max_pdos, sizeof(canopen_pdo_config));
+    me->sync_counters = (u8*) calloc(max_pdos, sizeof(u8));
+    me->pending       = (u8*) calloc(max_pdos, sizeof(u8));
+    me->latched       = (u64*) calloc(max_pdos, sizeof(u64));
+    me->tx_frames     = (can_frame_rec*) calloc(max_pdos, sizeof(can_frame_rec));
+
+    if ((me->configs == NULLPTR) || (me->sync_counters == NULLPTR) || (me->pending == NULLPTR) || 
+        (me->latched == NULLPTR) || (me->tx_frames == NULLPTR))
+    {
+        canopen_pdo_destruct(me);
+        return false;
+    }
+
+    if ((can_id_table_init(&me->sets[0].rx_ids, __id, 0U) == false) || 
+        (can_id_table_init(&me->sets[1].rx_ids, __id, 0U) == false))
+    {
+        canopen_pdo_destruct(me);
+        return false;
+    }
+
+    pthread_mutex_init(&me->config_lock, NULLPTR);
+    me->active = &me->sets[0];
+    me->module_position = utils_register_module(CANOPEN_PDO_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void canopen_pdo_destruct(canopen_pdo_engine* const me)
+ * 
+ * @brief   frees the plans and the runtime state, no traffic call may be running 
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void canopen_pdo_destruct(canopen_pdo_engine* const me)
+{
+    u32 i;
+
+    CHECK_NULLPTR_VOID(me);
+
+    for (i = 0U; i < 2U; ++i)
+    {
+        free(me->sets[i].plans);
+        free(me->sets[i].ops);
+        if (me->sets[i].rx_ids.ext_keys != NULLPTR)
+        {
+            can_id_table_destruct(&me->sets[i].rx_ids);
+        }
+    }
+
+    free(me->configs);
+    free(me->sync_counters);
+    free(me->pending);
+    free(me->latched);
+    free(me->tx_frames);
+
+    if (me->active != NULLPTR)
+    {
+        pthread_mutex_destroy(&me->config_lock);
+        utils_remove_module_registration(me->module_position);
+    }
+
+    memset(me, 0, sizeof(*me));
+
+    return;
+}
+
+
+/**
+ * @name    u32 canopen_pdo_add(canopen_pdo_engine* const me, canopen_pdo_config const * const config)
+ * 
+ * @brief   adds one PDO and publishes the new plans
+ * 
+ * @param   canopen_pdo_engine* const        : object pointer to the struct.
+ *          canopen_pdo_config const * const : PDO, the mapping must fit the dictionary
+ * 
+ * @return  u32 : number of the PDO, CANOPEN_PDO_NONE if it was rejected.
+ */
+u32 canopen_pdo_add(canopen_pdo_engine* const me, canopen_pdo_config const * const config)
+{
+    u32 pdo = CANOPEN_PDO_NONE;
+
+    if ((me == NULLPTR) || (config == NULLPTR) || (canopen_pdo_validate(config) == false))
+    {
+        return CANOPEN_PDO_NONE;
+    }
+
+    pthread_mutex_lock(&me->config_lock);
+
+    if (me->config_count < me->max_pdos)
+    {
+        me->configs[me->config_count] = *config;
+        me->config_count++;
+
+        if (canopen_pdo_publish(me) == true)
+        {
+            pdo = me->config_count - 1U;
+        }
+        else
+        {
+            me->config_count--;
+        }
+    }
+
+    pthread_mutex_unlock(&me->config_lock);
+
+    return pdo;
+}
+
+
+/**
+ * @name    u32 canopen_pdo_add_od(canopen_pdo_engine* const me, canopen_od const * const od)
+ * 
+ * @brief   adds every PDO described by the communication (0x1400.., 0x1800..) and 
+ *          mapping parameters (0x1600.., 0x1A00..) of a dictionary with one publish. 
+ *          PDOs with an unusable mapping are added disabled, canopen_pdo_reload_od() 
+ *          picks them up once the mapping got fixed.
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ *          canopen_od const * const  : dictionary of one node 
+ * 
+ * @return  u32 : number of PDOs added.
+ */
+u32 canopen_pdo_add_od(canopen_pdo_engine* const me, canopen_od const * const od)
+{
+    u16 const comm[2] = { CANOPEN_PDO_RPDO_COMM, CANOPEN_PDO_TPDO_COMM };
+    u32 const first = (me != NULLPTR) ? me->config_count : 0U;
+    u32 added = 0U;
+    u32 dir;
+    u32 i;
+
+    if ((me == NULLPTR) || (od == NULLPTR))
+    {
+        return 0U;
+    }
+
+    pthread_mutex_lock(&me->config_lock);
+
+    for (dir = 0U; dir < 2U; ++dir)
+    {
+        for (i = 0U; i < CANOPEN_PDO_PER_OD; ++i)
+        {
+            canopen_pdo_config* const config = &me->configs[me->config_count];
+
+            if (me->config_count == me->max_pdos)
+            {
+                break;
+            }
+
+            if (canopen_pdo_read_od(od, (u16) (comm[dir] + i), config) == false)
+            {
+                continue;
+            }
+
+            if (canopen_pdo_validate(config) == false)
+            {
+                config->map_count = 0U;
+            }
+
+            me->config_count++;
+            added++;
+        }
+    }
+
+    if ((added != 0U) && (canopen_pdo_publish(me) == false))
+    {
+        me->config_count = first;
+        added = 0U;
+    }
+
+    pthread_mutex_unlock(&me->config_lock);
+
+    return added;
+}
+
+
+/**
+ * @name    __boolean canopen_pdo_reload_od(canopen_pdo_engine* const me, canopen_od const * const od)
+ * 
+ * @brief   reads the PDO parameters of a dictionary again, e.g. after an SDO client 
+ *          remapped it, and publishes all changes at once. PDOs whose new mapping 
+ *          is unusable keep the old one.
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ *          canopen_od const * const  : dictionary given to canopen_pdo_add_od()
+ * 
+ * @return  __boolean                 : true if every PDO took its new parameters.
+ */
+__boolean canopen_pdo_reload_od(canopen_pdo_engine* const me, canopen_od const * const od)
+{
+    canopen_pdo_config config;
+    __boolean all = true;
+    u32 i;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(od);
+
+    pthread_mutex_lock(&me->config_lock);
+
+    for (i = 0U; i < me->config_count; ++i)
+    {
+        if ((me->configs[i].od != od) || (me->configs[i].comm_index == 0U))
+        {
+            continue;
+        }
+
+        if ((canopen_pdo_read_od(od, me->configs[i].comm_index, &config) == true) && 
+            (canopen_pdo_validate(&config) == true))
+        {
+            me->configs[i] = config;
+        }
+        else
+        {
+            all = false;
+        }
+    }
+
+    if (canopen_pdo_publish(me) == false)
+    {
+        all = false;
+    }
+
+    pthread_mutex_unlock(&me->config_lock);
+
+    return all;
+}
+
+
+/**
+ * @name    __boolean canopen_pdo_set_mapping(canopen_pdo_engine* const me, u32 pdo, u32 const * const map, u32 count)
+ * 
+ * @brief   replaces the mapping of a PDO while traffic goes on, frames built or 
+ *          applied at the same time use either the old or the new mapping completely
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ *          u32                       : PDO number 
+ *          u32 const * const         : mapping entries, CANOPEN_PDO_MAP()
+ *          u32                       : number of entries, 0 disables the PDO 
+ * 
+ * @return  __boolean                 : true if success, false if the mapping was rejected.
+ */
+__boolean canopen_pdo_set_mapping(canopen_pdo_engine* const me, u32 pdo, u32 const * const map, u32 count)
+{
+    canopen_pdo_config config;
+    __boolean ret = false;
+
+    CHECK_NULLPTR_RET(me);
+
+    if ((count > CANOPEN_PDO_MAX_MAPPED) || ((count != 0U) && (map == NULLPTR)))
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&me->config_lock);
+
+    if (pdo < me->config_count)
+    {
+        config = me->configs[pdo];
+        config.map_count = count;
+        if (count != 0U)
+        {
+            memcpy(config.map, map, count * sizeof(u32));
+        }
+
+        if (canopen_pdo_validate(&config) == true)
+        {
+            canopen_pdo_config const old = me->configs[pdo];
+
+            me->configs[pdo] = config;
+            ret = canopen_pdo_publish(me);
+            if (ret == false)
+            {
+                me->configs[pdo] = old;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&me->config_lock);
+
+    return ret;
+}
+
+
+/**
+ * @name    __boolean canopen_pdo_set_cob_id(canopen_pdo_engine* const me, u32 pdo, u32 cob_id)
+ * 
+ * @brief   moves a PDO to another id or (in)validates it, atomically like a remap 
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ *          u32                       : PDO number 
+ *          u32                       : COB-ID, CiA 301 layout 
+ * 
+ * @return  __boolean                 : true if success, false if something went wrong.
+ */
+__boolean canopen_pdo_set_cob_id(canopen_pdo_engine* const me, u32 pdo, u32 cob_id)
+{
+    __boolean ret = false;
+
+    CHECK_NULLPTR_RET(me);
+
+    pthread_mutex_lock(&me->config_lock);
+
+    if (pdo < me->config_count)
+    {
+        u32 const old = me->configs[pdo].cob_id;
+
+        me->configs[pdo].cob_id = cob_id;
+        ret = canopen_pdo_publish(me);
+        if (ret == false)
+        {
+            me->configs[pdo].cob_id = old;
+        }
+    }
+
+    pthread_mutex_unlock(&me->config_lock);
+
+    return ret;
+}
+
+
+/**
+ * @name    void canopen_pdo_trigger(canopen_pdo_engine* const me, u32 pdo)
+ * 
+ * @brief   marks a TPDO for sending: acyclic synchronous ones go out with the next 
+ *          SYNC, event driven ones with the next canopen_pdo_flush_events()
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ *          u32                       : PDO number 
+ * 
+ * @return  none.
+ */
+void canopen_pdo_trigger(canopen_pdo_engine* const me, u32 pdo)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (pdo < me->max_pdos)
+    {
+        __atomic_store_n(&me->pending[pdo], 1U, __ATOMIC_RELEASE);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    u32 canopen_pdo_build_sync(canopen_pdo_engine* const me, can_frame_rec* const frames, u32 max)
+ * 
+ * @brief   handles a SYNC without sending: latched synchronous RPDOs are applied and 
+ *          the due TPDOs are built into frames
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ *          can_frame_rec* const      : frames to fill 
+ *          u32                       : room in frames, due TPDOs beyond are dropped 
+ * 
+ * @return  u32 : number of frames built.
+ */
+u32 canopen_pdo_build_sync(canopen_pdo_engine* const me, can_frame_rec* const frames, u32 max)
+{
+    canopen_pdo_set* set;
+    u32 count;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frames);
+
+    set = canopen_pdo_acquire(me);
+    canopen_pdo_apply_latched(me, set);
+    count = canopen_pdo_build(me, set, frames, max, true);
+    canopen_pdo_release(set);
+    me->syncs++;
+
+    return count;
+}
+
+
+/**
+ * @name    u32 canopen_pdo_sync(canopen_pdo_engine* const me)
+ * 
+ * @brief   handles a SYNC and sends all due TPDOs of all nodes as one batch 
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ * 
+ * @return  u32 : number of TPDOs sent (built without a socket).
+ */
+u32 canopen_pdo_sync(canopen_pdo_engine* const me)
+{
+    CHECK_NULLPTR_RET(me);
+
+    return canopen_pdo_send(me, canopen_pdo_build_sync(me, me->tx_frames, me->max_pdos));
+}
+
+
+/**
+ * @name    u32 canopen_pdo_flush_events(canopen_pdo_engine* const me)
+ * 
+ * @brief   sends the triggered event driven TPDOs as one batch 
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ * 
+ * @return  u32 : number of TPDOs sent (built without a socket).
+ */
+u32 canopen_pdo_flush_events(canopen_pdo_engine* const me)
+{
+    canopen_pdo_set* set;
+    u32 count;
+
+    CHECK_NULLPTR_RET(me);
+
+    set = canopen_pdo_acquire(me);
+    count = canopen_pdo_build(me, set, me->tx_frames, me->max_pdos, false);
+    canopen_pdo_release(set);
+
+    return canopen_pdo_send(me, count);
+}
+
+
+/**
+ * @name    u32 canopen_pdo_receive(canopen_pdo_engine* const me, can_frame_rec const * const frames, u32 count)
+ * 
+ * @brief   feeds received frames to the engine. RPDOs are found through the id table 
+ *          of the active plans and applied at once (event driven) or latched until 
+ *          the next SYNC (synchronous), a SYNC frame runs canopen_pdo_sync(). Other 
+ *          frames are ignored, so a whole receive batch can be passed in. Shares 
+ *          tx_frames with canopen_pdo_sync/flush_events, all of them run on one thread.
+ * 
+ * @param   canopen_pdo_engine* const   : object pointer to the struct.
+ *          can_frame_rec const * const : received frames 
+ *          u32                         : number of frames 
+ * 
+ * @return  u32 : number of RPDOs applied or latched.
+ */
+u32 canopen_pdo_receive(canopen_pdo_engine* const me, can_frame_rec const * const frames, u32 count)
+{
+    canopen_pdo_set* set;
+    u32 applied = 0U;
+    u32 i;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frames);
+
+    set = canopen_pdo_acquire(me);
+
+    for (i = 0U; i < count; ++i)
+    {
+        can_frame_rec const * const frame = &frames[i];
+        canopen_pdo_plan const * plan;
+        canopen_pdo_op const * op;
+        u64 payload = 0U;
+        u32 slot;
+        u32 k;
+
+        if (frame->can_id == me->sync_id)
+        {
+            canopen_pdo_release(set);
+            canopen_pdo_sync(me);
+            set = canopen_pdo_acquire(me);
+            continue;
+        }
+
+        if ((frame->can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG)) != 0U)
+        {
+            continue;
+        }
+
+        slot = can_id_table_lookup(&set->rx_ids, frame->can_id);
+        if (slot == CAN_ID_TABLE_NONE)
+        {
+            continue;
+        }
+
+        plan = &set->plans[slot];
+        if (frame->len < plan->len)
+        {
+            me->rpdos_short++;
+            continue;
+        }
+
+        memcpy(&payload, frame->data, sizeof(payload));
+        applied++;
+
+        if (plan->transmission <= CANOPEN_PDO_SYNC_MAX)
+        {
+            me->latched[plan->pdo] = payload;
+            __atomic_store_n(&me->pending[plan->pdo], 1U, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        op = &set->ops[plan->first_op];
+        for (k = 0U; k < plan->op_count; ++k, ++op)
+        {
+            u64 value;
+
+            if (op->value == NULLPTR)
+            {
+                continue;
+            }
+
+            value = (payload >> op->shift) & op->mask;
+            if (op->partial != 0U)
+            {
+                value |= canopen_pdo_load(op->value, op->size) & ~op->mask;
+            }
+            canopen_pdo_store(op->value, op->size, value);
+        }
+    }
+
+    canopen_pdo_release(set);
+    me->rpdos_applied += applied;
+
+    return applied;
+}
+
+
+/**
+ * @name    static canopen_pdo_set* canopen_pdo_acquire(canopen_pdo_engine* const me)
+ * 
+ * @brief   pins the active set. The user count is raised before the set is checked 
+ *          to still be the active one, a publish that saw no users therefore can not 
+ *          be overtaken by a traffic call on the set it is about to rewrite.
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ * 
+ * @return  canopen_pdo_set* : active set, to be given back with canopen_pdo_release().
+ */
+static canopen_pdo_set* canopen_pdo_acquire(canopen_pdo_engine* const me)
+{
+    for (;;)
+    {
+        canopen_pdo_set* const set = __atomic_load_n(&me->active, __ATOMIC_ACQUIRE);
+
+        __atomic_add_fetch(&set->users, 1U, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&me->active, __ATOMIC_SEQ_CST) == set)
+        {
+            return set;
+        }
+        __atomic_sub_fetch(&set->users, 1U, __ATOMIC_RELEASE);
+    }
+}
+
+
+/**
+ * @name    static inline void canopen_pdo_release(canopen_pdo_set* const set)
+ * 
+ * @brief   unpins a set taken with canopen_pdo_acquire()
+ * 
+ * @param   canopen_pdo_set* const : set 
+ * 
+ * @return  none.
+ */
+static inline void canopen_pdo_release(canopen_pdo_set* const set)
+{
+    __atomic_sub_fetch(&set->users, 1U, __ATOMIC_RELEASE);
+
+    return;
+}
+
+
+/**
+ * @name    static __boolean canopen_pdo_validate(canopen_pdo_config const * const config)
+ * 
+ * @brief   checks a mapping against its dictionary: the objects exist, may be mapped 
+ *          in this direction, have a scalar type and all bits fit into 8 bytes
+ * 
+ * @param   canopen_pdo_config const * const : PDO 
+ * 
+ * @return  __boolean : true if the PDO can be compiled.
+ */
+static __boolean canopen_pdo_validate(canopen_pdo_config const * const config)
+{
+    u8 const access = (config->direction == CANOPEN_PDO_TX) ? CANOPEN_OD_TPDO : CANOPEN_OD_RPDO;
+    u32 bits = 0U;
+    u32 i;
+
+    if ((config->od == NULLPTR) || (config->direction > CANOPEN_PDO_TX) || (config->map_count > CANOPEN_PDO_MAX_MAPPED))
+    {
+        return false;
+    }
+
+    for (i = 0U; i < config->map_count; ++i)
+    {
+        u16 const index = CANOPEN_PDO_MAP_INDEX(config->map[i]);
+        u8 const length = CANOPEN_PDO_MAP_BITS(config->map[i]);
+        canopen_od_entry const * entry;
+
+        if (length == 0U)
+        {
+            return false;
+        }
+        bits += length;
+
+        if ((index != 0U) && (index <= CANOPEN_PDO_DUMMY_LAST))
+        {
+            continue;
+        }
+
+        entry = canopen_od_find(config->od, index, CANOPEN_PDO_MAP_SUB(config->map[i]));
+        if ((entry == NULLPTR) || ((entry->access & access) == 0U))
+        {
+            return false;
+        }
+
+        if (((entry->size != 1U) && (entry->size != 2U) && (entry->size != 4U) && (entry->size != 8U)) || 
+            (length > (entry->size * 8U)))
+        {
+            return false;
+        }
+    }
+
+    return (bits <= CANOPEN_PDO_MAX_BITS);
+}
+
+
+/**
+ * @name    static __boolean canopen_pdo_read_od(canopen_od const * const od, u16 comm_index, canopen_pdo_config* const config)
+ * 
+ * @brief   fills a configuration from the communication and mapping parameters 
+ * 
+ * @param   canopen_od const * const  : dictionary 
+ *          u16                       : index of the communication parameters 
+ *          canopen_pdo_config* const : configuration to fill 
+ * 
+ * @return  __boolean : false if the dictionary has no such PDO.
+ */
+static __boolean canopen_pdo_read_od(canopen_od const * const od, u16 comm_index, canopen_pdo_config* const config)
+{
+    u16 const map_index = (u16) (comm_index + (CANOPEN_PDO_RPDO_MAP - CANOPEN_PDO_RPDO_COMM));
+    canopen_od_entry const * cob = canopen_od_find(od, comm_index, 1U);
+    canopen_od_entry const * type = canopen_od_find(od, comm_index, 2U);
+    canopen_od_entry const * count = canopen_od_find(od, map_index, 0U);
+    u32 i;
+
+    if ((cob == NULLPTR) || (cob->size != sizeof(u32)) || (type == NULLPTR) || (type->size != sizeof(u8)) || 
+        (count == NULLPTR) || (count->size != sizeof(u8)))
+    {
+        return false;
+    }
+
+    memset(config, 0, sizeof(*config));
+    config->od           = od;
+    config->comm_index   = comm_index;
+    config->direction    = (comm_index >= CANOPEN_PDO_TPDO_COMM) ? CANOPEN_PDO_TX : CANOPEN_PDO_RX;
+    config->transmission = *(u8 const *) canopen_od_value(od, type);
+    config->map_count    = GET_MIN(*(u8 const *) canopen_od_value(od, count), CANOPEN_PDO_MAX_MAPPED);
+    memcpy(&config->cob_id, canopen_od_value(od, cob), sizeof(u32));
+
+    for (i = 0U; i < config->map_count; ++i)
+    {
+        canopen_od_entry const * const entry = canopen_od_find(od, map_index, (u8) (i + 1U));
+
+        if ((entry == NULLPTR) || (entry->size != sizeof(u32)))
+        {
+            return false;
+        }
+        memcpy(&config->map[i], canopen_od_value(od, entry), sizeof(u32));
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    static __boolean canopen_pdo_publish(canopen_pdo_engine* const me)
+ * 
+ * @brief   compiles all configurations into the idle set and makes it the active one.
+ *          The idle set may still be pinned by a traffic call that started before the 
+ *          last publish, that one is waited for. Called with config_lock held.
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ * 
+ * @return  __boolean : false if memory ran out, the active set is unchanged then.
+ */
+static __boolean canopen_pdo_publish(canopen_pdo_engine* const me)
+{
+    canopen_pdo_set* const idle = (me->active == &me->sets[0]) ? &me->sets[1] : &me->sets[0];
+
+    while (__atomic_load_n(&idle->users, __ATOMIC_SEQ_CST) != 0U)
+    {
+        sched_yield();
+    }
+
+    if (canopen_pdo_compile(me, idle) == false)
+    {
+        return false;
+    }
+
+    __atomic_store_n(&me->active, idle, __ATOMIC_SEQ_CST);
+    me->remaps++;
+
+    return true;
+}
+
+
+/**
+ * @name    static __boolean canopen_pdo_compile(canopen_pdo_engine* const me, canopen_pdo_set* const set)
+ * 
+ * @brief   turns the valid and enabled configurations into plans, TPDOs first. Every 
+ *          mapping entry becomes one op with its final bit position in the payload, 
+ *          dictionary lookups happen here and never on the traffic side.
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ *          canopen_pdo_set* const    : idle set to overwrite 
+ * 
+ * @return  __boolean : false if memory ran out.
+ */
+static __boolean canopen_pdo_compile(canopen_pdo_engine* const me, canopen_pdo_set* const set)
+{
+    u32 ops = 0U;
+    u32 pass;
+    u32 i;
+
+    for (i = 0U; i < me->config_count; ++i)
+    {
+        ops += me->configs[i].map_count;
+    }
+
+    if (set->plan_capacity < me->config_count)
+    {
+        canopen_pdo_plan* const plans = (canopen_pdo_plan*) realloc(set->plans, me->config_count * sizeof(canopen_pdo_plan));
+
+        if (plans == NULLPTR)
+        {
+            return false;
+        }
+        set->plans = plans;
+        set->plan_capacity = me->config_count;
+    }
+
+    if (set->op_capacity < ops)
+    {
+        canopen_pdo_op* const op = (canopen_pdo_op*) realloc(set->ops, ops * sizeof(canopen_pdo_op));
+
+        if (op == NULLPTR)
+        {
+            return false;
+        }
+        set->ops = op;
+        set->op_capacity = ops;
+    }
+
+    can_id_table_clear(&set->rx_ids);
+    set->tx_count = 0U;
+    set->rx_count = 0U;
+    ops = 0U;
+
+    for (pass = 0U; pass < 2U; ++pass)
+    {
+        u8 const direction = (pass == 0U) ? CANOPEN_PDO_TX : CANOPEN_PDO_RX;
+
+        for (i = 0U; i < me->config_count; ++i)
+        {
+            canopen_pdo_config const * const config = &me->configs[i];
+            canopen_pdo_plan* const plan = &set->plans[set->tx_count + set->rx_count];
+            u32 bit = 0U;
+            u32 k;
+
+            if ((config->direction != direction) || (config->map_count == 0U) || 
+                ((config->cob_id & CANOPEN_PDO_COB_INVALID) != 0U))
+            {
+                continue;
+            }
+
+            plan->can_id = ((config->cob_id & CANOPEN_PDO_COB_EXTENDED) != 0U) ? 
+                           ((config->cob_id & CAN_EFF_MASK) | CAN_EFF_FLAG) : (config->cob_id & CAN_SFF_MASK);
+            plan->pdo          = i;
+            plan->first_op     = ops;
+            plan->op_count     = (u8) config->map_count;
+            plan->transmission = config->transmission;
+            plan->reserved     = 0U;
+
+            for (k = 0U; k < config->map_count; ++k)
+            {
+                u32 const map = config->map[k];
+                u8 const length = CANOPEN_PDO_MAP_BITS(map);
+                canopen_pdo_op* const op = &set->ops[ops + k];
+                canopen_od_entry const * const entry = canopen_od_find(config->od, CANOPEN_PDO_MAP_INDEX(map), CANOPEN_PDO_MAP_SUB(map));
+
+                op->shift    = (u8) bit;
+                op->mask     = (length == 64U) ? ~0ULL : ((1ULL << length) - 1ULL);
+                op->reserved = 0U;
+
+                if (entry == NULLPTR)
+                {
+                    // dummy entry, validated before 
+                    op->value   = NULLPTR;
+                    op->size    = 0U;
+                    op->partial = 0U;
+                }
+                else
+                {
+                    op->value   = (u8*) canopen_od_value(config->od, entry);
+                    op->size    = (u8) entry->size;
+                    op->partial = (length < (entry->size * 8U)) ? 1U : 0U;
+                }
+                bit += length;
+            }
+
+            plan->len = (u8) ((bit + 7U) / 8U);
+            ops += config->map_count;
+
+            if (direction == CANOPEN_PDO_TX)
+            {
+                set->tx_count++;
+            }
+            else
+            {
+                if (can_id_table_insert(&set->rx_ids, plan->can_id, set->tx_count + set->rx_count) == false)
+                {
+                    return false;
+                }
+                set->rx_count++;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    static u32 canopen_pdo_build(canopen_pdo_engine* const me, canopen_pdo_set* const set, can_frame_rec* const frames, u32 max, __boolean sync)
+ * 
+ * @brief   one pass over the TPDO plans, the due ones run their ops into a payload. 
+ *          Cyclic counters advance on every SYNC even if the frame does not fit.
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ *          canopen_pdo_set* const    : pinned set 
+ *          can_frame_rec* const      : frames to fill 
+ *          u32                       : room in frames 
+ *          __boolean                 : true for the synchronous TPDOs, false for the 
+ *                                      triggered event driven ones
+ * 
+ * @return  u32 : number of frames built.
+ */
+static u32 canopen_pdo_build(canopen_pdo_engine* const me, canopen_pdo_set* const set, can_frame_rec* const frames, u32 max, __boolean sync)
+{
+    u32 count = 0U;
+    u32 i;
+
+    for (i = 0U; i < set->tx_count; ++i)
+    {
+        canopen_pdo_plan const * const plan = &set->plans[i];
+        canopen_pdo_op const * op = &set->ops[plan->first_op];
+        can_frame_rec* frame;
+        __boolean due = false;
+        u64 payload = 0U;
+        u32 k;
+
+        if (sync == true)
+        {
+            if (plan->transmission == CANOPEN_PDO_SYNC_ACYCLIC)
+            {
+                due = (__atomic_exchange_n(&me->pending[plan->pdo], 0U, __ATOMIC_ACQ_REL) != 0U);
+            }
+            else if (plan->transmission <= CANOPEN_PDO_SYNC_MAX)
+            {
+                me->sync_counters[plan->pdo]++;
+                if (me->sync_counters[plan->pdo] >= plan->transmission)
+                {
+                    me->sync_counters[plan->pdo] = 0U;
+                    due = true;
+                }
+            }
+        }
+        else if (plan->transmission >= CANOPEN_PDO_EVENT_MANUFACTURER)
+        {
+            due = (__atomic_exchange_n(&me->pending[plan->pdo], 0U, __ATOMIC_ACQ_REL) != 0U);
+        }
+
+        if (due == false)
+        {
+            continue;
+        }
+
+        if (count == max)
+        {
+            me->tpdos_dropped++;
+            continue;
+        }
+
+        for (k = 0U; k < plan->op_count; ++k, ++op)
+        {
+            if (op->value != NULLPTR)
+            {
+                payload |= (canopen_pdo_load(op->value, op->size) & op->mask) << op->shift;
+            }
+        }
+
+        frame = &frames[count++];
+        frame->timestamp_ns = 0U;
+        frame->can_id   = plan->can_id;
+        frame->len      = plan->len;
+        frame->flags    = 0U;
+        frame->bus      = 0U;
+        frame->reserved = 0U;
+        memcpy(frame->data, &payload, sizeof(payload));
+    }
+
+    return count;
+}
+
+
+/**
+ * @name    static u32 canopen_pdo_send(canopen_pdo_engine* const me, u32 count)
+ * 
+ * @brief   sends the frames built into tx_frames with one batch 
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ *          u32                       : number of frames 
+ * 
+ * @return  u32 : number of frames sent, count without a socket.
+ */
+static u32 canopen_pdo_send(canopen_pdo_engine* const me, u32 count)
+{
+    u32 sent = count;
+
+    if ((me->socket != NULLPTR) && (count != 0U))
+    {
+        sent = can_socket_send_batch(me->socket, me->tx_frames, count);
+        me->tpdos_dropped += count - sent;
+    }
+    me->tpdos_sent += sent;
+
+    return sent;
+}
+
+
+/**
+ * @name    static void canopen_pdo_apply_latched(canopen_pdo_engine* const me, canopen_pdo_set* const set)
+ * 
+ * @brief   applies the synchronous RPDOs received since the last SYNC 
+ * 
+ * @param   canopen_pdo_engine* const : object pointer to the struct.
+ *          canopen_pdo_set* const    : pinned set 
+ * 
+ * @return  none.
+ */
+static void canopen_pdo_apply_latched(canopen_pdo_engine* const me, canopen_pdo_set* const set)
+{
+    u32 i;
+
+    for (i = set->tx_count; i < (set->tx_count + set->rx_count); ++i)
+    {
+        canopen_pdo_plan const * const plan = &set->plans[i];
+        canopen_pdo_op const * op = &set->ops[plan->first_op];
+        u64 payload;
+        u32 k;
+
+        if ((plan->transmission > CANOPEN_PDO_SYNC_MAX) || 
+            (__atomic_exchange_n(&me->pending[plan->pdo], 0U, __ATOMIC_ACQ_REL) == 0U))
+        {
+            continue;
+        }
+        payload = me->latched[plan->pdo];
+
+        for (k = 0U; k < plan->op_count; ++k, ++op)
+        {
+            u64 value;
+
+            if (op->value == NULLPTR)
+            {
+                continue;
+            }
+
+            value = (payload >> op->shift) & op->mask;
+            if (op->partial != 0U)
+            {
+                value |= canopen_pdo_load(op->value, op->size) & ~op->mask;
+            }
+            canopen_pdo_store(op->value, op->size, value);
+        }
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static inline u64 canopen_pdo_load(u8 const * const src, u8 size)
+ * 
+ * @brief   reads a dictionary value of 1, 2, 4 or 8 bytes, CANopen and the host are 
+ *          both little endian 
+ * 
+ * @param   u8 const * const : value 
+ *          u8               : size 
+ * 
+ * @return  u64 : value, zero extended.
+ */
+static inline u64 canopen_pdo_load(u8 const * const src, u8 size)
+{
+    u8  v8;
+    u16 v16;
+    u32 v32;
+    u64 v64;
+
+    switch (size)
+    {
+        case 1U:
+            memcpy(&v8, src, sizeof(v8));
+            return v8;
+        case 2U:
+            memcpy(&v16, src, sizeof(v16));
+            return v16;
+        case 4U:
+            memcpy(&v32, src, sizeof(v32));
+            return v32;
+        default:
+            memcpy(&v64, src, sizeof(v64));
+            return v64;
+    }
+}
+
+
+/**
+ * @name    static inline void canopen_pdo_store(u8* const dst, u8 size, u64 value)
+ * 
+ * @brief   writes a dictionary value of 1, 2, 4 or 8 bytes 
+ * 
+ * @param   u8* const : value 
+ *          u8        : size 
+ *          u64       : new value, truncated to size
+ * 
+ * @return  none.
+ */
+static inline void canopen_pdo_store(u8* const dst, u8 size, u64 value)
+{
+    u8  const v8  = (u8) value;
+    u16 const v16 = (u16) value;
+    u32 const v32 = (u32) value;
+
+    switch (size)
+    {
+        case 1U:
+            memcpy(dst, &v8, sizeof(v8));
+            break;
+        case 2U:
+            memcpy(dst, &v16, sizeof(v16));
+            break;
+        case 4U:
+            memcpy(dst, &v32, sizeof(v32));
+            break;
+        default:
+            memcpy(dst, &value, sizeof(value));
+            break;
+    }
+
+    return;
+}
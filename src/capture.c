@@ -0,0 +1,1515 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "checksum.h"
+#include "frame_ring.h"
+
+#define __CAPTURE_H_
+#include "capture.h"
+
+/**
+ * @name    __boolean capture_init(capture* const me, u8 __id, capture_config const * const config)
+ * 
+ * @brief   sets up a capture writer, no file is created before the first frame arrives
+ * 
+ * @param   capture* const               : object pointer to the struct.
+ *          u8                           : module id for the registration 
+ *          capture_config const * const : directory, prefix, segment and block sizes
+ * 
+ * @return  __boolean                    : true if success, false if something went wrong.
+ */
+__boolean capture_init(capture* const me, u8 __id, capture_config const * const config)
+{
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(config);
+
+    memset(me, 0, sizeof(*me));
+    me->fd = -1;
+
+    snprintf(me->directory, sizeof(me->directory), "%s", (config->directory != NULLPTR) ? config->directory : ".");
+    snprintf(me->prefix, sizeof(me->prefix), "%s", (config->prefix != NULLPTR) ? config->prefix : "capture");
+
+    me->segment_size = (config->segment_size != 0U) ? config->segment_size : CAPTURE_DEFAULT_SEGMENT_SIZE;
+    me->block_size   = (config->block_size != 0U) ? config->block_size : CAPTURE_DEFAULT_BLOCK_SIZE;
+    me->rotate_ns    = config->rotate_ns;
+
+    if ((me->block_size < CAPTURE_MIN_BLOCK_SIZE) || 
+        (me->segment_size < (sizeof(capture_file_hdr) + me->block_size)))
+    {
+        return false;
+    }
+
+    me->module_position = utils_register_module(CAPTURE_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void capture_destruct(capture* const me)
+ * 
+ * @brief   stops the writer, closes the open segment and frees the index memory
+ * 
+ * @param   capture* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void capture_destruct(capture* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    capture_stop(me);
+    (void) capture_close_segment(me);
+
+    free(me->blocks);
+    free(me->ids);
+    free(me->block_ids);
+    free(me->postings);
+    me->blocks    = NULLPTR;
+    me->ids       = NULLPTR;
+    me->block_ids = NULLPTR;
+    me->postings  = NULLPTR;
+
+    utils_remove_module_registration(me->module_position);
+
+    return;
+}
+
+
+/**
+ * @name    __boolean capture_add_ring(capture* const me, frame_ring* const ring)
+ * 
+ * @brief   adds a ring the writer thread drains, typically one per bus. Only allowed 
+ *          while the writer is stopped.
+ * 
+ * @param   capture* const    : object pointer to the struct.
+ *          frame_ring* const : ring fed by a receiver 
+ * 
+ * @return  __boolean         : true if success, false if something went wrong.
+ */
+__boolean capture_add_ring(capture* const me, frame_ring* const ring)
+{
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(ring);
+
+    if ((me->running == true) || (me->ring_count >= CAPTURE_MAX_RINGS))
+    {
+        return false;
+    }
+
+    me->rings[me->ring_count++] = ring;
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean capture_start(capture* const me)
+ * 
+ * @brief   starts the writer thread, it is the only consumer of the added rings 
+ * 
+ * @param   capture* const : object pointer to the struct.
+ * 
+ * @return  __boolean      : true if success, false if something went wrong.
+ */
+__boolean capture_start(capture* const me)
+{
+    CHECK_NULLPTR_RET(me);
+
+    if ((me->running == true) || (me->ring_count == 0U))
+    {
+        return false;
+    }
+
+    me->running = true;
+    if (pthread_create(&me->thread, NULLPTR, capture_thread, me) != 0)
+    {
+        me->running = false;
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    void capture_stop(capture* const me)
+ * 
+ * @brief   stops the writer thread after it drained all rings, the segment is closed 
+ *          with its footer
+ * 
+ * @param   capture* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void capture_stop(capture* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->running == false)
+    {
+        return;
+    }
+
+    __atomic_store_n(&me->running, false, __ATOMIC_RELEASE);
+    pthread_join(me->thread, NULLPTR);
+
+    return;
+}
+
+
+/**
+ * @name    u32 capture_write(capture* const me, can_frame_rec const * const frames, u32 count)
+ * 
+ * @brief   writes a batch of frames into the open segment, opens/rotates segments as 
+ *          needed. Called by the writer thread, or directly when no thread is running.
+ * 
+ * @param   capture* const              : object pointer to the struct.
+ *          can_frame_rec const * const : frames 
+ *          u32                         : number of frames
+ * 
+ * @return  u32 : number of written frames.
+ */
+u32 capture_write(capture* const me, can_frame_rec const * const frames, u32 count)
+{
+    u32 i;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frames);
+
+    for (i = 0U; i < count; ++i)
+    {
+        if (capture_write_frame(me, &frames[i]) == false)
+        {
+            ++me->stats.errors;
+            break;
+        }
+    }
+
+    return i;
+}
+
+
+/**
+ * @name    u32 capture_write_ptrs(capture* const me, can_frame_rec const * const * const frames, u32 count)
+ * 
+ * @brief   like capture_write() for frames that are not contiguous, e.g. a batch of 
+ *          frame_merge_next() that points into several rings 
+ * 
+ * @param   capture* const                      : object pointer to the struct.
+ *          can_frame_rec const * const * const : frames 
+ *          u32                                 : number of frames
+ * 
+ * @return  u32 : number of written frames.
+ */
+u32 capture_write_ptrs(capture* const me, can_frame_rec const * const * const frames, u32 count)
+{
+    u32 i;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frames);
+
+    for (i = 0U; i < count; ++i)
+    {
+        if (capture_write_frame(me, frames[i]) == false)
+        {
+            ++me->stats.errors;
+            break;
+        }
+    }
+
+    return i;
+}
+
+
+/**
+ * @name    __boolean capture_rotate(capture* const me)
+ * 
+ * @brief   closes the open segment, the next frame starts a new one. With a running 
+ *          writer thread the rotation is only requested and done by the thread.
+ * 
+ * @param   capture* const : object pointer to the struct.
+ * 
+ * @return  __boolean      : true if success, false if something went wrong.
+ */
+__boolean capture_rotate(capture* const me)
+{
+    CHECK_NULLPTR_RET(me);
+
+    if (__atomic_load_n(&me->running, __ATOMIC_ACQUIRE) == true)
+    {
+        __atomic_store_n(&me->rotate_request, true, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    return capture_close_segment(me);
+}
+
+
+/**
+ * @name    void capture_get_stats(capture const * const me, capture_stats* const stats)
+ * 
+ * @brief   copies the counters of the writer, may be slightly stale while running
+ * 
+ * @param   capture const * const : object pointer to the struct.
+ *          capture_stats* const  : destination 
+ * 
+ * @return  none.
+ */
+void capture_get_stats(capture const * const me, capture_stats* const stats)
+{
+    CHECK_NULLPTR_VOID(me);
+    CHECK_NULLPTR_VOID(stats);
+
+    *stats = me->stats;
+
+    return;
+}
+
+
+/**
+ * @name    __boolean capture_reader_open(capture_reader* const me, char const * const path)
+ * 
+ * @brief   maps a segment read only. Without a valid footer (writer crashed or still 
+ *          writing, tables outside the file) the block index is rebuilt from the block 
+ *          headers and no ID index is available.
+ * 
+ * @param   capture_reader* const : object pointer to the struct.
+ *          char const * const    : segment file 
+ * 
+ * @return  __boolean             : true if success, false if something went wrong.
+ */
+__boolean capture_reader_open(capture_reader* const me, char const * const path)
+{
+    struct stat st;
+    capture_trailer const * trailer;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(path);
+
+    memset(me, 0, sizeof(*me));
+    me->fd = open(path, O_RDONLY);
+    if (me->fd < 0)
+    {
+        return false;
+    }
+
+    if ((fstat(me->fd, &st) != 0) || ((u64) st.st_size < sizeof(capture_file_hdr)))
+    {
+        close(me->fd);
+        return false;
+    }
+
+    me->map_size = (u64) st.st_size;
+    me->map = (u8 const *) mmap(NULLPTR, me->map_size, PROT_READ, MAP_SHARED, me->fd, 0);
+    if ((void*) me->map == MAP_FAILED)
+    {
+        close(me->fd);
+        return false;
+    }
+    (void) madvise((void*) me->map, me->map_size, MADV_SEQUENTIAL);
+
+    me->hdr = (capture_file_hdr const *) me->map;
+    if ((memcmp(me->hdr->magic, CAPTURE_FILE_MAGIC, 8U) != 0) || (me->hdr->version != CAPTURE_VERSION))
+    {
+        capture_reader_close(me);
+        return false;
+    }
+
+    trailer = (capture_trailer const *) (me->map + me->map_size - sizeof(capture_trailer));
+    if ((me->map_size >= (sizeof(capture_file_hdr) + sizeof(capture_trailer))) &&
+        (capture_reader_footer_valid(me, trailer) == true))
+    {
+        me->footer      = (capture_footer const *) (me->map + trailer->footer_offset);
+        me->blocks      = (capture_block_entry const *) (me->map + me->footer->blocks_offset);
+        me->block_count = me->footer->block_count;
+        me->ids         = (capture_id_entry const *) (me->map + me->footer->ids_offset);
+        me->id_count    = me->footer->id_count;
+        me->postings    = (u32 const *) (me->map + me->footer->postings_offset);
+    }
+    else if (capture_reader_recover(me) == false)
+    {
+        return false;
+    }
+
+    return capture_reader_index_times(me);
+}
+
+
+/**
+ * @name    void capture_reader_close(capture_reader* const me)
+ * 
+ * @brief   unmaps the segment 
+ * 
+ * @param   capture_reader* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void capture_reader_close(capture_reader* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->map != NULLPTR)
+    {
+        munmap((void*) me->map, me->map_size);
+    }
+    if (me->fd >= 0)
+    {
+        close(me->fd);
+    }
+    free(me->recovered);
+    free(me->max_last_ts);
+
+    memset(me, 0, sizeof(*me));
+    me->fd = -1;
+
+    return;
+}
+
+
+/**
+ * @name    u32 capture_reader_find_block(capture_reader const * const me, u64 timestamp_ns)
+ * 
+ * @brief   binary search for the first block that may hold frames at or after 
+ *          timestamp_ns. Blocks of several rings are not sorted by time, the search 
+ *          runs on the running maximum of last_ts: every block before the result 
+ *          ends earlier.
+ * 
+ * @param   capture_reader const * const : object pointer to the struct.
+ *          u64                          : timestamp 
+ * 
+ * @return  u32 : block number, block_count if all blocks are older.
+ */
+u32 capture_reader_find_block(capture_reader const * const me, u64 timestamp_ns)
+{
+    u32 low = 0U;
+    u32 high;
+
+    CHECK_NULLPTR_RET(me);
+
+    high = me->block_count;
+    while (low < high)
+    {
+        u32 const mid = low + ((high - low) / 2U);
+        if (me->max_last_ts[mid] < timestamp_ns)
+        {
+            low = mid + 1U;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+
+/**
+ * @name    u32 capture_reader_find_block_end(capture_reader const * const me, u64 timestamp_ns)
+ * 
+ * @brief   binary search on the running minimum of first_ts for the first block from 
+ *          which on all blocks start after timestamp_ns 
+ * 
+ * @param   capture_reader const * const : object pointer to the struct.
+ *          u64                          : timestamp 
+ * 
+ * @return  u32 : block number, block_count if the last block starts at or before it.
+ */
+u32 capture_reader_find_block_end(capture_reader const * const me, u64 timestamp_ns)
+{
+    u32 low = 0U;
+    u32 high;
+
+    CHECK_NULLPTR_RET(me);
+
+    high = me->block_count;
+    while (low < high)
+    {
+        u32 const mid = low + ((high - low) / 2U);
+        if (me->min_first_ts[mid] <= timestamp_ns)
+        {
+            low = mid + 1U;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+
+/**
+ * @name    capture_id_entry const * capture_reader_find_id(capture_reader const * const me, u32 can_id)
+ * 
+ * @brief   binary search in the sorted ID table of the footer
+ * 
+ * @param   capture_reader const * const : object pointer to the struct.
+ *          u32                          : can_id with the kernel flags 
+ * 
+ * @return  capture_id_entry const * : entry, NULLPTR if the ID does not occur or no 
+ *                                     index is available.
+ */
+capture_id_entry const * capture_reader_find_id(capture_reader const * const me, u32 can_id)
+{
+    u32 slot;
+
+    if ((me == NULLPTR) || (me->ids == NULLPTR))
+    {
+        return NULLPTR;
+    }
+
+    slot = capture_find_id(me->ids, me->id_count, can_id);
+
+    return (slot < me->id_count) ? &me->ids[slot] : NULLPTR;
+}
+
+
+/**
+ * @name    u32 const * capture_reader_postings(capture_reader const * const me, capture_id_entry const * const entry)
+ * 
+ * @brief   ascending numbers of the blocks that contain an ID, entry->postings_count long
+ * 
+ * @param   capture_reader const * const   : object pointer to the struct.
+ *          capture_id_entry const * const : entry of the footer ID table
+ * 
+ * @return  u32 const * : block numbers, NULLPTR for a segment without footer.
+ */
+u32 const * capture_reader_postings(capture_reader const * const me, capture_id_entry const * const entry)
+{
+    if ((me == NULLPTR) || (entry == NULLPTR) || (me->postings == NULLPTR))
+    {
+        return NULLPTR;
+    }
+
+    return &me->postings[entry->postings_start];
+}
+
+
+/**
+ * @name    u32 const * capture_reader_block_ids(capture_reader const * const me, u32 block, u32* const count)
+ * 
+ * @brief   sorted directory of the IDs in a sealed block, works without footer 
+ * 
+ * @param   capture_reader const * const : object pointer to the struct.
+ *          u32                          : block number 
+ *          u32* const                   : returns the number of IDs 
+ * 
+ * @return  u32 const * : sorted can_ids, NULLPTR for a block that is still open.
+ */
+u32 const * capture_reader_block_ids(capture_reader const * const me, u32 block, u32* const count)
+{
+    capture_block_hdr const * hdr;
+    capture_block_entry const * entry;
+
+    *count = 0U;
+    if ((me == NULLPTR) || (block >= me->block_count))
+    {
+        return NULLPTR;
+    }
+
+    entry = &me->blocks[block];
+    hdr   = (capture_block_hdr const *) (me->map + entry->offset);
+    if ((hdr->id_count == 0U) || 
+        ((sizeof(capture_block_hdr) + hdr->records_size + ((u64) hdr->id_count * sizeof(u32))) > entry->size))
+    {
+        return NULLPTR;
+    }
+
+    *count = hdr->id_count;
+    return (u32 const *) ((u8 const *) hdr + sizeof(capture_block_hdr) + hdr->records_size);
+}
+
+
+/**
+ * @name    __boolean capture_cursor_init(capture_cursor* const me, capture_reader const * const reader, u32 block)
+ * 
+ * @brief   positions a cursor on the first frame of a block 
+ * 
+ * @param   capture_cursor* const        : object pointer to the struct.
+ *          capture_reader const * const : opened segment 
+ *          u32                          : block number 
+ * 
+ * @return  __boolean : true if the block is valid.
+ */
+__boolean capture_cursor_init(capture_cursor* const me, capture_reader const * const reader, u32 block)
+{
+    capture_block_hdr const * hdr;
+    capture_block_entry const * entry;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(reader);
+
+    if (block >= reader->block_count)
+    {
+        return false;
+    }
+
+    entry = &reader->blocks[block];
+    if ((entry->offset + entry->size) > reader->map_size)
+    {
+        return false;
+    }
+
+    hdr = (capture_block_hdr const *) (reader->map + entry->offset);
+    if ((hdr->magic != CAPTURE_BLOCK_MAGIC) || ((sizeof(capture_block_hdr) + hdr->records_size) > entry->size))
+    {
+        return false;
+    }
+
+    me->pos       = (u8 const *) hdr + sizeof(capture_block_hdr);
+    me->end       = me->pos + hdr->records_size;
+    me->base_ts   = hdr->base_ts;
+    me->remaining = entry->frame_count;
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean capture_cursor_next(capture_cursor* const me, can_frame_rec* const frame)
+ * 
+ * @brief   decodes the next frame of the block 
+ * 
+ * @param   capture_cursor* const : object pointer to the struct.
+ *          can_frame_rec* const  : destination 
+ * 
+ * @return  __boolean : false at the end of the block.
+ */
+__boolean capture_cursor_next(capture_cursor* const me, can_frame_rec* const frame)
+{
+    capture_record_hdr const * rec;
+
+    if ((me->remaining == 0U) || ((me->pos + sizeof(capture_record_hdr)) > me->end))
+    {
+        return false;
+    }
+
+    rec = (capture_record_hdr const *) me->pos;
+    if ((rec->len > CAN_FRAME_MAX_DATA) || ((me->pos + CAPTURE_RECORD_SIZE(rec->len)) > me->end))
+    {
+        me->remaining = 0U;
+        return false;
+    }
+
+    frame->timestamp_ns = me->base_ts + (u64) (s64) rec->ts_delta_ns;
+    frame->can_id       = rec->can_id;
+    frame->len          = rec->len;
+    frame->flags        = rec->flags;
+    frame->bus          = rec->bus;
+    frame->reserved     = 0U;
+    memcpy(frame->data, me->pos + sizeof(capture_record_hdr), rec->len);
+
+    me->pos += CAPTURE_RECORD_SIZE(rec->len);
+    --me->remaining;
+
+    return true;
+}
+
+
+/**
+ * @name    static void* capture_thread(void* arg)
+ * 
+ * @brief   writer loop, drains the rings round robin in batches straight from the ring 
+ *          slots into the mapping. Sleeps shortly when all rings are empty.
+ * 
+ * @param   void* : the capture object 
+ * 
+ * @return  void* : NULLPTR.
+ */
+static void* capture_thread(void* arg)
+{
+    capture* const me = (capture*) arg;
+    struct timespec const idle = { 0, CAPTURE_IDLE_SLEEP_NS };
+
+    for (;;)
+    {
+        __boolean const running = __atomic_load_n(&me->running, __ATOMIC_ACQUIRE);
+        u32 drained = 0U;
+        u8 r;
+
+        for (r = 0U; r < me->ring_count; ++r)
+        {
+            can_frame_rec* frames;
+            u32 const n = frame_ring_peek(me->rings[r], &frames, CAPTURE_BATCH);
+            if (n > 0U)
+            {
+                (void) capture_write(me, frames, n);
+                frame_ring_release(me->rings[r], n);
+                drained += n;
+            }
+        }
+
+        if ((__atomic_exchange_n(&me->rotate_request, false, __ATOMIC_ACQ_REL) == true) || 
+            ((me->rotate_ns != 0U) && (me->map != NULLPTR) && 
+             ((capture_now_ns() - me->segment_open_ns) >= me->rotate_ns)))
+        {
+            (void) capture_close_segment(me);
+        }
+
+        if (drained == 0U)
+        {
+            if (running == false)
+            {
+                break;
+            }
+            nanosleep(&idle, NULLPTR);
+        }
+    }
+
+    (void) capture_close_segment(me);
+
+    return NULLPTR;
+}
+
+
+/**
+ * @name    static __boolean capture_open_segment(capture* const me, u64 timestamp_ns)
+ * 
+ * @brief   creates, preallocates and maps the next segment file. Preallocation keeps a 
+ *          full disk from turning into a SIGBUS inside the mapping.
+ * 
+ * @param   capture* const : object pointer to the struct.
+ *          u64            : timestamp of the first frame, used in the file name
+ * 
+ * @return  __boolean      : true if success, false if something went wrong.
+ */
+static __boolean capture_open_segment(capture* const me, u64 timestamp_ns)
+{
+    capture_file_hdr* hdr;
+    int len;
+
+    // a truncated name would write into some other file 
+    len = snprintf(me->path, sizeof(me->path), "%s/%s_%llu_%06llu.c4c", me->directory, me->prefix, 
+                   timestamp_ns / 1000000000ULL, me->segment_index);
+    if ((len < 0) || ((u32) len >= sizeof(me->path)))
+    {
+        me->path[0] = '\0';
+        return false;
+    }
+
+    me->fd = open(me->path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (me->fd < 0)
+    {
+        return false;
+    }
+
+    if (posix_fallocate(me->fd, 0, (off_t) me->segment_size) != 0)
+    {
+        close(me->fd);
+        me->fd = -1;
+        return false;
+    }
+
+    me->map = (u8*) mmap(NULLPTR, me->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, me->fd, 0);
+    if ((void*) me->map == MAP_FAILED)
+    {
+        me->map = NULLPTR;
+        close(me->fd);
+        me->fd = -1;
+        return false;
+    }
+    (void) madvise(me->map, me->segment_size, MADV_SEQUENTIAL);
+
+    hdr = (capture_file_hdr*) me->map;
+    memcpy(hdr->magic, CAPTURE_FILE_MAGIC, 8U);
+    hdr->version       = CAPTURE_VERSION;
+    hdr->header_size   = sizeof(capture_file_hdr);
+    hdr->segment_index = me->segment_index;
+    hdr->created_ns    = capture_now_ns();
+    hdr->block_size    = me->block_size;
+
+    me->used             = sizeof(capture_file_hdr);
+    me->segment_open_ns  = hdr->created_ns;
+    me->segment_frames   = 0U;
+    me->segment_first_ts = 0U;
+    me->segment_last_ts  = 0U;
+    me->block            = NULLPTR;
+    me->block_count      = 0U;
+    me->posting_count    = 0U;
+    me->id_count         = 0U;
+    if (me->ids != NULLPTR)
+    {
+        memset(me->ids, 0xFF, me->id_capacity * sizeof(capture_id_entry));
+    }
+
+    ++me->segment_index;
+    ++me->stats.segments;
+
+    return true;
+}
+
+
+/**
+ * @name    static __boolean capture_close_segment(capture* const me)
+ * 
+ * @brief   seals the open block, truncates the preallocated file to the used size and 
+ *          appends footer, block table, sorted ID table and trailer
+ * 
+ * @param   capture* const : object pointer to the struct.
+ * 
+ * @return  __boolean      : true if success, false if something went wrong.
+ */
+static __boolean capture_close_segment(capture* const me)
+{
+    capture_footer  footer;
+    capture_trailer trailer;
+    capture_id_entry* ids;
+    u32* postings;
+    u64 offset;
+    u32 crc;
+    u32 i;
+    u32 n = 0U;
+    __boolean ret = true;
+
+    if (me->map == NULLPTR)
+    {
+        return true;
+    }
+
+    capture_seal_block(me);
+
+    // compact the hash table in place and sort it by ID 
+    ids = me->ids;
+    for (i = 0U; i < me->id_capacity; ++i)
+    {
+        if (ids[i].can_id != CAPTURE_ID_EMPTY)
+        {
+            ids[n++] = ids[i];
+        }
+    }
+    if (n > 1U)
+    {
+        qsort(ids, n, sizeof(capture_id_entry), capture_compare_ids);
+    }
+
+    postings = (u32*) malloc(((u64) me->posting_count + 1U) * sizeof(u32));
+    if (postings == NULLPTR)
+    {
+        ++me->stats.errors;
+        me->posting_count = 0U;
+        for (i = 0U; i < n; ++i)
+        {
+            ids[i].postings_count = 0U;
+        }
+    }
+    capture_build_postings(me, ids, n, postings);
+
+    munmap(me->map, me->segment_size);
+    me->map = NULLPTR;
+
+    offset = CAPTURE_ALIGN(me->used, 8U);
+    memset(&footer, 0, sizeof(footer));
+    memcpy(footer.magic, CAPTURE_FOOTER_MAGIC, 8U);
+    footer.version       = CAPTURE_VERSION;
+    footer.block_count   = me->block_count;
+    footer.id_count      = n;
+    footer.frame_count   = me->segment_frames;
+    footer.first_ts      = me->segment_first_ts;
+    footer.last_ts       = me->segment_last_ts;
+    footer.blocks_offset = offset + sizeof(footer);
+    footer.ids_offset    = footer.blocks_offset + ((u64) me->block_count * sizeof(capture_block_entry));
+    footer.postings_offset = footer.ids_offset + ((u64) n * sizeof(capture_id_entry));
+    footer.posting_count = me->posting_count;
+
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.footer_offset = offset;
+    trailer.footer_size   = sizeof(footer) + ((u64) me->block_count * sizeof(capture_block_entry)) + 
+                            ((u64) n * sizeof(capture_id_entry)) + ((u64) me->posting_count * sizeof(u32));
+    memcpy(trailer.magic, CAPTURE_TRAILER_MAGIC, 8U);
+
+    crc = checksum_crc32c_update(CHECKSUM_CRC32C_INIT, &footer, sizeof(footer));
+    crc = checksum_crc32c_update(crc, me->blocks, (u64) me->block_count * sizeof(capture_block_entry));
+    crc = checksum_crc32c_update(crc, ids, (u64) n * sizeof(capture_id_entry));
+    crc = checksum_crc32c_update(crc, postings, (u64) me->posting_count * sizeof(u32));
+    trailer.crc = crc ^ CHECKSUM_CRC32C_INIT;
+
+    if ((ftruncate(me->fd, (off_t) offset) != 0) ||
+        (pwrite(me->fd, &footer, sizeof(footer), (off_t) offset) != (ssize_t) sizeof(footer)) ||
+        (pwrite(me->fd, me->blocks, (u64) me->block_count * sizeof(capture_block_entry), (off_t) footer.blocks_offset) 
+            != (ssize_t) ((u64) me->block_count * sizeof(capture_block_entry))) ||
+        (pwrite(me->fd, ids, (u64) n * sizeof(capture_id_entry), (off_t) footer.ids_offset) 
+            != (ssize_t) ((u64) n * sizeof(capture_id_entry))) ||
+        (pwrite(me->fd, postings, (u64) me->posting_count * sizeof(u32), (off_t) footer.postings_offset) 
+            != (ssize_t) ((u64) me->posting_count * sizeof(u32))) ||
+        (pwrite(me->fd, &trailer, sizeof(trailer), (off_t) (offset + trailer.footer_size)) != (ssize_t) sizeof(trailer)))
+    {
+        ++me->stats.errors;
+        ret = false;
+    }
+
+    free(postings);
+    close(me->fd);
+    me->fd = -1;
+
+    // the table was compacted, start the next segment from an empty one 
+    if (me->ids != NULLPTR)
+    {
+        memset(me->ids, 0xFF, me->id_capacity * sizeof(capture_id_entry));
+    }
+    me->id_count = 0U;
+
+    return ret;
+}
+
+
+/**
+ * @name    static __boolean capture_open_block(capture* const me, u64 timestamp_ns)
+ * 
+ * @brief   starts a new block at the end of the used area
+ * 
+ * @param   capture* const : object pointer to the struct.
+ *          u64            : timestamp of the first frame, base of the deltas 
+ * 
+ * @return  __boolean      : true if success, false if something went wrong.
+ */
+static __boolean capture_open_block(capture* const me, u64 timestamp_ns)
+{
+    if (me->block_count == me->block_capacity)
+    {
+        u32 const capacity = GET_MAX(CAPTURE_BLOCK_MIN_CAPACITY, me->block_capacity * 2U);
+        capture_block_entry* const blocks = (capture_block_entry*) realloc(me->blocks, capacity * sizeof(capture_block_entry));
+        if (blocks == NULLPTR)
+        {
+            return false;
+        }
+        me->blocks         = blocks;
+        me->block_capacity = capacity;
+    }
+
+    me->used         = CAPTURE_ALIGN(me->used, 8U);
+    me->block_offset = me->used;
+    me->block        = (capture_block_hdr*) (me->map + me->used);
+    me->block->frame_count = 0U;
+    me->block->size        = sizeof(capture_block_hdr);
+    me->block->crc         = 0U;
+    me->block->base_ts     = timestamp_ns;
+    me->block->min_ts      = timestamp_ns;
+    me->block->max_ts      = timestamp_ns;
+    me->block->records_size = 0U;
+    me->block->id_count    = 0U;
+    __atomic_store_n(&me->block->magic, CAPTURE_BLOCK_MAGIC, __ATOMIC_RELEASE);
+
+    me->block_id_count = 0U;
+
+    me->used += sizeof(capture_block_hdr);
+
+    return true;
+}
+
+
+/**
+ * @name    static void capture_seal_block(capture* const me)
+ * 
+ * @brief   appends the sorted ID directory, writes the checksum of the open block and 
+ *          adds it to the block index and the postings of the segment
+ * 
+ * @param   capture* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+static void capture_seal_block(capture* const me)
+{
+    capture_block_hdr* const block = me->block;
+    capture_block_entry* entry;
+    u32 const dir_size = me->block_id_count * sizeof(u32);
+    __boolean room = true;
+    u32 i;
+
+    if (block == NULLPTR)
+    {
+        return;
+    }
+
+    // the directory space was reserved while writing, see capture_write_frame()
+    if (me->block_id_count > 1U)
+    {
+        qsort(me->block_ids, me->block_id_count, sizeof(u32), capture_compare_u32);
+    }
+    memcpy(me->map + me->used, me->block_ids, dir_size);
+    me->used    += dir_size;
+    block->size += dir_size;
+
+    // all postings of the block or none, capture_build_postings() counts what is there 
+    while ((room == true) && ((me->posting_count + me->block_id_count) > me->posting_capacity))
+    {
+        if (capture_grow_list((void**) &me->postings, &me->posting_capacity, sizeof(capture_posting)) == false)
+        {
+            ++me->stats.errors;
+            room = false;
+        }
+    }
+    for (i = 0U; (room == true) && (i < me->block_id_count); ++i)
+    {
+        me->postings[me->posting_count].can_id = me->block_ids[i];
+        me->postings[me->posting_count].block  = me->block_count;
+        ++me->posting_count;
+    }
+
+    block->crc = checksum_crc32c((u8 const *) block + sizeof(capture_block_hdr), block->size - sizeof(capture_block_hdr));
+    __atomic_store_n(&block->id_count, me->block_id_count, __ATOMIC_RELEASE);
+
+    entry = &me->blocks[me->block_count++];
+    entry->offset      = me->block_offset;
+    entry->first_ts    = block->min_ts;
+    entry->last_ts     = block->max_ts;
+    entry->frame_count = block->frame_count;
+    entry->size        = block->size;
+
+    me->block = NULLPTR;
+    ++me->stats.blocks;
+
+    return;
+}
+
+
+/**
+ * @name    static __boolean capture_write_frame(capture* const me, can_frame_rec const * const frame)
+ * 
+ * @brief   appends one record, sealing the block when it is full or the timestamp no 
+ *          longer fits the delta, and rotating the segment when it is full or too old
+ * 
+ * @param   capture* const              : object pointer to the struct.
+ *          can_frame_rec const * const : frame 
+ * 
+ * @return  __boolean : true if success, false if something went wrong.
+ */
+static __boolean capture_write_frame(capture* const me, can_frame_rec const * const frame)
+{
+    u8 const len = GET_MIN(frame->len, CAN_FRAME_MAX_DATA);
+    u64 const size = CAPTURE_RECORD_SIZE(len);
+    u64 const ts = frame->timestamp_ns;
+    u64 const dir_reserve = ((u64) me->block_id_count + 1U) * sizeof(u32);
+    capture_block_hdr* block = me->block;
+    capture_record_hdr* rec;
+    s64 delta = 0;
+
+    // room for the record and a possibly growing ID directory must stay in block and segment
+    if (block != NULLPTR)
+    {
+        delta = (s64) (ts - block->base_ts);
+        if (((block->size + size + dir_reserve) > me->block_size) || (delta > 0x7FFFFFFFLL) || (delta < -0x7FFFFFFFLL) ||
+            ((me->used + size + dir_reserve) > me->segment_size))
+        {
+            capture_seal_block(me);
+            block = NULLPTR;
+            delta = 0;
+        }
+    }
+
+    if ((me->map != NULLPTR) && (block == NULLPTR) && 
+        ((CAPTURE_ALIGN(me->used, 8U) + sizeof(capture_block_hdr) + size + sizeof(u32)) > me->segment_size))
+    {
+        (void) capture_close_segment(me);
+    }
+
+    if (me->map == NULLPTR)
+    {
+        if (capture_open_segment(me, ts) == false)
+        {
+            return false;
+        }
+    }
+
+    if (me->block == NULLPTR)
+    {
+        if (capture_open_block(me, ts) == false)
+        {
+            return false;
+        }
+        block = me->block;
+    }
+
+    rec = (capture_record_hdr*) (me->map + me->used);
+    rec->ts_delta_ns = (s32) delta;
+    rec->can_id      = frame->can_id;
+    rec->len         = len;
+    rec->flags       = frame->flags;
+    rec->bus         = frame->bus;
+    rec->reserved    = 0U;
+    memcpy((u8*) rec + sizeof(capture_record_hdr), frame->data, len);
+
+    me->used    += size;
+    block->size += (u32) size;
+    block->records_size += (u32) size;
+    block->min_ts = GET_MIN(block->min_ts, ts);
+    block->max_ts = GET_MAX(block->max_ts, ts);
+    __atomic_store_n(&block->frame_count, block->frame_count + 1U, __ATOMIC_RELEASE);
+
+    if (me->segment_frames == 0U)
+    {
+        me->segment_first_ts = ts;
+        me->segment_last_ts  = ts;
+    }
+    me->segment_first_ts = GET_MIN(me->segment_first_ts, ts);
+    me->segment_last_ts  = GET_MAX(me->segment_last_ts, ts);
+    ++me->segment_frames;
+
+    capture_index_id(me, frame);
+
+    ++me->stats.frames;
+    me->stats.bytes += size;
+
+    return true;
+}
+
+
+/**
+ * @name    static void capture_index_id(capture* const me, can_frame_rec const * const frame)
+ * 
+ * @brief   counts the frame in the per ID table of the open segment (linear probing)
+ * 
+ * @param   capture* const              : object pointer to the struct.
+ *          can_frame_rec const * const : frame 
+ * 
+ * @return  none.
+ */
+static void capture_index_id(capture* const me, can_frame_rec const * const frame)
+{
+    capture_id_entry* entry;
+    u32 pos;
+
+    if (((me->id_count + 1U) * 2U) > me->id_capacity)
+    {
+        if (capture_grow_ids(me) == false)
+        {
+            return;
+        }
+    }
+
+    pos = (frame->can_id * 0x9E3779B1U) & (me->id_capacity - 1U);
+    for (;;)
+    {
+        entry = &me->ids[pos];
+        if (entry->can_id == frame->can_id)
+        {
+            break;
+        }
+        if (entry->can_id == CAPTURE_ID_EMPTY)
+        {
+            entry->can_id   = frame->can_id;
+            entry->bus_mask = 0U;
+            entry->count    = 0U;
+            entry->first_ts = frame->timestamp_ns;
+            entry->last_ts  = frame->timestamp_ns;
+            entry->postings_start = 0U;
+            entry->postings_count = 0U;
+            ++me->id_count;
+            break;
+        }
+        pos = (pos + 1U) & (me->id_capacity - 1U);
+    }
+
+    entry->bus_mask |= (1U << (frame->bus % CAN_FRAME_MAX_BUSES));
+    entry->first_ts  = GET_MIN(entry->first_ts, frame->timestamp_ns);
+    entry->last_ts   = GET_MAX(entry->last_ts, frame->timestamp_ns);
+    ++entry->count;
+
+    // while writing postings_start marks the last block (+1) the ID was seen in
+    if (entry->postings_start != (me->block_count + 1U))
+    {
+        if ((me->block_id_count == me->block_id_capacity) && 
+            (capture_grow_list((void**) &me->block_ids, &me->block_id_capacity, sizeof(u32)) == false))
+        {
+            return;
+        }
+        entry->postings_start = me->block_count + 1U;
+        ++entry->postings_count;
+        me->block_ids[me->block_id_count++] = frame->can_id;
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static __boolean capture_grow_ids(capture* const me)
+ * 
+ * @brief   doubles the ID hash table and rehashes the entries
+ * 
+ * @param   capture* const : object pointer to the struct.
+ * 
+ * @return  __boolean      : true if success, false if out of memory.
+ */
+static __boolean capture_grow_ids(capture* const me)
+{
+    u32 const capacity = GET_MAX(CAPTURE_ID_MIN_CAPACITY, me->id_capacity * 2U);
+    capture_id_entry* const ids = (capture_id_entry*) malloc(capacity * sizeof(capture_id_entry));
+    u32 i;
+
+    if (ids == NULLPTR)
+    {
+        return false;
+    }
+    memset(ids, 0xFF, capacity * sizeof(capture_id_entry));
+
+    for (i = 0U; i < me->id_capacity; ++i)
+    {
+        if (me->ids[i].can_id != CAPTURE_ID_EMPTY)
+        {
+            u32 pos = (me->ids[i].can_id * 0x9E3779B1U) & (capacity - 1U);
+            while (ids[pos].can_id != CAPTURE_ID_EMPTY)
+            {
+                pos = (pos + 1U) & (capacity - 1U);
+            }
+            ids[pos] = me->ids[i];
+        }
+    }
+
+    free(me->ids);
+    me->ids         = ids;
+    me->id_capacity = capacity;
+
+    return true;
+}
+
+
+/**
+ * @name    static __boolean capture_grow_list(void** const list, u32* const capacity, u32 element_size)
+ * 
+ * @brief   doubles a dynamic array of the writer 
+ * 
+ * @param   void** const : array, reallocated 
+ *          u32* const   : capacity in elements, updated 
+ *          u32          : size of an element 
+ * 
+ * @return  __boolean    : true if success, false if out of memory.
+ */
+static __boolean capture_grow_list(void** const list, u32* const capacity, u32 element_size)
+{
+    u32 const grown = GET_MAX(CAPTURE_LIST_MIN_CAPACITY, *capacity * 2U);
+    void* const ptr = realloc(*list, (u64) grown * element_size);
+
+    if (ptr == NULLPTR)
+    {
+        return false;
+    }
+
+    *list     = ptr;
+    *capacity = grown;
+
+    return true;
+}
+
+
+/**
+ * @name    static void capture_build_postings(capture* const me, capture_id_entry* const ids, u32 count, u32* const postings)
+ * 
+ * @brief   turns the (ID, block) pairs of the sealed blocks into one posting list per 
+ *          ID. The pairs are in block order, so every list comes out ascending.
+ * 
+ * @param   capture* const          : object pointer to the struct.
+ *          capture_id_entry* const : sorted ID table, postings_start/count are set 
+ *          u32                     : number of IDs 
+ *          u32* const              : destination, posting_count elements 
+ * 
+ * @return  none.
+ */
+static void capture_build_postings(capture* const me, capture_id_entry* const ids, u32 count, u32* const postings)
+{
+    u32 start = 0U;
+    u32 slot;
+    u32 i;
+
+    if (postings == NULLPTR)
+    {
+        return;
+    }
+
+    // the counts of the writer include blocks whose postings did not fit, count the pairs 
+    for (i = 0U; i < count; ++i)
+    {
+        ids[i].postings_count = 0U;
+    }
+    for (i = 0U; i < me->posting_count; ++i)
+    {
+        slot = capture_find_id(ids, count, me->postings[i].can_id);
+        if (slot < count)
+        {
+            ++ids[slot].postings_count;
+        }
+    }
+
+    for (i = 0U; i < count; ++i)
+    {
+        ids[i].postings_start = start;
+        start += ids[i].postings_count;
+        ids[i].postings_count = 0U;
+    }
+
+    for (i = 0U; i < me->posting_count; ++i)
+    {
+        slot = capture_find_id(ids, count, me->postings[i].can_id);
+        if (slot < count)
+        {
+            postings[ids[slot].postings_start + ids[slot].postings_count++] = me->postings[i].block;
+        }
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static u32 capture_find_id(capture_id_entry const * const ids, u32 count, u32 can_id)
+ * 
+ * @brief   binary search in the sorted ID table 
+ * 
+ * @param   capture_id_entry const * const : sorted ID table 
+ *          u32                            : number of IDs 
+ *          u32                            : ID to look for 
+ * 
+ * @return  u32 : position, count if the ID is not in the table.
+ */
+static u32 capture_find_id(capture_id_entry const * const ids, u32 count, u32 can_id)
+{
+    u32 low = 0U;
+    u32 high = count;
+
+    while (low < high)
+    {
+        u32 const mid = low + ((high - low) / 2U);
+        if (ids[mid].can_id < can_id)
+        {
+            low = mid + 1U;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return ((low < count) && (ids[low].can_id == can_id)) ? low : count;
+}
+
+
+/**
+ * @name    static int capture_compare_u32(void const * a, void const * b)
+ * 
+ * @brief   qsort order of the block ID directory 
+ * 
+ * @param   void const * : first ID 
+ *          void const * : second ID
+ * 
+ * @return  int : <0, 0, >0.
+ */
+static int capture_compare_u32(void const * a, void const * b)
+{
+    u32 const id_a = *(u32 const *) a;
+    u32 const id_b = *(u32 const *) b;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+
+/**
+ * @name    static int capture_compare_ids(void const * a, void const * b)
+ * 
+ * @brief   qsort order of the footer ID table
+ * 
+ * @param   void const * : first entry 
+ *          void const * : second entry
+ * 
+ * @return  int : <0, 0, >0.
+ */
+static int capture_compare_ids(void const * a, void const * b)
+{
+    u32 const id_a = ((capture_id_entry const *) a)->can_id;
+    u32 const id_b = ((capture_id_entry const *) b)->can_id;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+
+/**
+ * @name    static __boolean capture_reader_footer_valid(capture_reader const * const me, capture_trailer const * const trailer)
+ * 
+ * @brief   checks trailer and footer before the tables are used: checksum, and that 
+ *          every table, block and posting range lies within the file 
+ * 
+ * @param   capture_reader const * const  : object pointer to the struct, file mapped 
+ *          capture_trailer const * const : trailer at the end of the file 
+ * 
+ * @return  __boolean : true if the footer can be used.
+ */
+static __boolean capture_reader_footer_valid(capture_reader const * const me, capture_trailer const * const trailer)
+{
+    u64 const end = me->map_size - sizeof(capture_trailer);
+    capture_footer const * footer;
+    capture_block_entry const * blocks;
+    capture_id_entry const * ids;
+    u32 const * postings;
+    u64 i;
+
+    if ((memcmp(trailer->magic, CAPTURE_TRAILER_MAGIC, 8U) != 0) || 
+        (trailer->footer_size < sizeof(capture_footer)) || (trailer->footer_size > end) || 
+        (trailer->footer_offset != (end - trailer->footer_size)) || 
+        (trailer->footer_offset < sizeof(capture_file_hdr)) || 
+        (checksum_crc32c(me->map + trailer->footer_offset, trailer->footer_size) != trailer->crc))
+    {
+        return false;
+    }
+
+    // the checksum proves the tables are intact, not that they point into the file 
+    footer = (capture_footer const *) (me->map + trailer->footer_offset);
+    if ((memcmp(footer->magic, CAPTURE_FOOTER_MAGIC, 8U) != 0) || 
+        (footer->blocks_offset > end) || 
+        (((u64) footer->block_count * sizeof(capture_block_entry)) > (end - footer->blocks_offset)) || 
+        (footer->ids_offset > end) || 
+        (((u64) footer->id_count * sizeof(capture_id_entry)) > (end - footer->ids_offset)) || 
+        (footer->postings_offset > end) || 
+        (footer->posting_count > ((end - footer->postings_offset) / sizeof(u32))))
+    {
+        return false;
+    }
+
+    blocks = (capture_block_entry const *) (me->map + footer->blocks_offset);
+    for (i = 0U; i < footer->block_count; ++i)
+    {
+        if ((blocks[i].offset > trailer->footer_offset) || (blocks[i].size < sizeof(capture_block_hdr)) || 
+            (blocks[i].size > (trailer->footer_offset - blocks[i].offset)))
+        {
+            return false;
+        }
+    }
+
+    ids = (capture_id_entry const *) (me->map + footer->ids_offset);
+    for (i = 0U; i < footer->id_count; ++i)
+    {
+        if (((u64) ids[i].postings_start + ids[i].postings_count) > footer->posting_count)
+        {
+            return false;
+        }
+    }
+
+    postings = (u32 const *) (me->map + footer->postings_offset);
+    for (i = 0U; i < footer->posting_count; ++i)
+    {
+        if (postings[i] >= footer->block_count)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    static __boolean capture_reader_recover(capture_reader* const me)
+ * 
+ * @brief   rebuilds the block index of a segment without footer by walking the block 
+ *          headers until the first one that is not valid
+ * 
+ * @param   capture_reader* const : object pointer to the struct.
+ * 
+ * @return  __boolean             : true if success, false if out of memory.
+ */
+static __boolean capture_reader_recover(capture_reader* const me)
+{
+    u64 offset = me->hdr->header_size;
+    u32 capacity = 0U;
+
+    while ((offset + sizeof(capture_block_hdr)) <= me->map_size)
+    {
+        capture_block_hdr const * const hdr = (capture_block_hdr const *) (me->map + offset);
+        capture_block_entry* entry;
+
+        if ((hdr->magic != CAPTURE_BLOCK_MAGIC) || (hdr->size < sizeof(capture_block_hdr)) || 
+            ((offset + hdr->size) > me->map_size) || (hdr->frame_count == 0U))
+        {
+            break;
+        }
+
+        if (me->block_count == capacity)
+        {
+            capture_block_entry* blocks;
+            capacity = GET_MAX(64U, capacity * 2U);
+            blocks = (capture_block_entry*) realloc(me->recovered, capacity * sizeof(capture_block_entry));
+            if (blocks == NULLPTR)
+            {
+                capture_reader_close(me);
+                return false;
+            }
+            me->recovered = blocks;
+        }
+
+        entry = &me->recovered[me->block_count++];
+        entry->offset      = offset;
+        entry->first_ts    = hdr->min_ts;
+        entry->last_ts     = hdr->max_ts;
+        entry->frame_count = hdr->frame_count;
+        entry->size        = hdr->size;
+
+        offset = CAPTURE_ALIGN(offset + hdr->size, 8U);
+    }
+
+    me->blocks = me->recovered;
+
+    return true;
+}
+
+
+/**
+ * @name    static inline u64 capture_now_ns(void)
+ * 
+ * @brief   wall clock, same base as the socket timestamps 
+ * 
+ * @param   none.
+ * 
+ * @return  u64 : nanoseconds since the epoch.
+ */
+static inline u64 capture_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+}
+
+
+/**
+ * @name    static __boolean capture_reader_index_times(capture_reader* const me)
+ * 
+ * @brief   running maximum of last_ts and running minimum of first_ts (from the end) 
+ *          over the block index, both sorted for capture_reader_find_block/_end() 
+ * 
+ * @param   capture_reader* const : object pointer to the struct, blocks set 
+ * 
+ * @return  __boolean             : true if success, false if out of memory.
+ */
+static __boolean capture_reader_index_times(capture_reader* const me)
+{
+    u64 max_last = 0U;
+    u64 min_first = (u64) -1;
+    u32 b;
+
+    me->max_last_ts = (u64*) malloc((((u64) me->block_count * 2U) + 1U) * sizeof(u64));
+    if (me->max_last_ts == NULLPTR)
+    {
+        capture_reader_close(me);
+        return false;
+    }
+    me->min_first_ts = me->max_last_ts + me->block_count;
+
+    for (b = 0U; b < me->block_count; ++b)
+    {
+        max_last = GET_MAX(max_last, me->blocks[b].last_ts);
+        me->max_last_ts[b] = max_last;
+    }
+    for (b = me->block_count; b > 0U; --b)
+    {
+        min_first = GET_MIN(min_first, me->blocks[b - 1U].first_ts);
+        me->min_first_ts[b - 1U] = min_first;
+    }
+
+    return true;
+}
@@ -0,0 +1,331 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "capture.h"
+
+#define __CAPTURE_EXPORT_H_
+#include "capture_export.h"
+
+/**
+ * @name    void capture_export_init(capture_export* const me, FILE* const out, u8 format, u64 start_ns)
+ * 
+ * @brief   sets up an exporter, buses are named can0, can1, ... unless renamed
+ * 
+ * @param   capture_export* const : object pointer to the struct.
+ *          FILE* const           : output stream 
+ *          u8                    : CAPTURE_EXPORT_CANDUMP or CAPTURE_EXPORT_ASC
+ *          u64                   : start of the measurement for ASC relative times
+ * 
+ * @return  none.
+ */
+void capture_export_init(capture_export* const me, FILE* const out, u8 format, u64 start_ns)
+{
+    u8 i;
+
+    CHECK_NULLPTR_VOID(me);
+
+    me->out      = out;
+    me->format   = format;
+    me->start_ns = start_ns;
+
+    for (i = 0U; i < CAN_FRAME_MAX_BUSES; ++i)
+    {
+        snprintf(me->bus_names[i], CAPTURE_EXPORT_MAX_BUS_NAME, "can%u", i);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    void capture_export_set_bus_name(capture_export* const me, u8 bus, char const * const name)
+ * 
+ * @brief   interface name printed for a bus in candump format 
+ * 
+ * @param   capture_export* const : object pointer to the struct.
+ *          u8                    : bus index 
+ *          char const * const    : interface name 
+ * 
+ * @return  none.
+ */
+void capture_export_set_bus_name(capture_export* const me, u8 bus, char const * const name)
+{
+    CHECK_NULLPTR_VOID(me);
+    CHECK_NULLPTR_VOID(name);
+
+    if (bus < CAN_FRAME_MAX_BUSES)
+    {
+        snprintf(me->bus_names[bus], CAPTURE_EXPORT_MAX_BUS_NAME, "%s", name);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    void capture_export_begin(capture_export* const me)
+ * 
+ * @brief   writes the file header, ASC only 
+ * 
+ * @param   capture_export* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void capture_export_begin(capture_export* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->format == CAPTURE_EXPORT_ASC)
+    {
+        capture_export_asc_date(me, "date");
+        fputs("base hex  timestamps absolute\n", me->out);
+        fputs("internal events logged\n", me->out);
+        fputs("// version 9.0.0\n", me->out);
+        capture_export_asc_date(me, "Begin Triggerblock");
+        fputs("   0.000000 Start of measurement\n", me->out);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    void capture_export_frame(capture_export* const me, can_frame_rec const * const frame)
+ * 
+ * @brief   writes one frame as text line
+ * 
+ * @param   capture_export* const       : object pointer to the struct.
+ *          can_frame_rec const * const : frame
+ * 
+ * @return  none.
+ */
+void capture_export_frame(capture_export* const me, can_frame_rec const * const frame)
+{
+    if (me->format == CAPTURE_EXPORT_ASC)
+    {
+        capture_export_asc(me, frame);
+    }
+    else
+    {
+        capture_export_candump(me, frame);
+    }
+}
+
+
+/**
+ * @name    u64 capture_export_segment(capture_export* const me, capture_reader const * const reader)
+ * 
+ * @brief   writes all frames of a segment in file order 
+ * 
+ * @param   capture_export* const        : object pointer to the struct.
+ *          capture_reader const * const : opened segment 
+ * 
+ * @return  u64 : number of exported frames.
+ */
+u64 capture_export_segment(capture_export* const me, capture_reader const * const reader)
+{
+    capture_cursor cursor;
+    can_frame_rec  frame;
+    u64 count = 0U;
+    u32 block;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(reader);
+
+    for (block = 0U; block < reader->block_count; ++block)
+    {
+        if (capture_cursor_init(&cursor, reader, block) == false)
+        {
+            continue;
+        }
+        while (capture_cursor_next(&cursor, &frame) == true)
+        {
+            capture_export_frame(me, &frame);
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+
+/**
+ * @name    void capture_export_end(capture_export* const me)
+ * 
+ * @brief   writes the file trailer, ASC only, and flushes the stream
+ * 
+ * @param   capture_export* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void capture_export_end(capture_export* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->format == CAPTURE_EXPORT_ASC)
+    {
+        fputs("End TriggerBlock\n", me->out);
+    }
+    fflush(me->out);
+
+    return;
+}
+
+
+/**
+ * @name    static void capture_export_candump(capture_export* const me, can_frame_rec const * const frame)
+ * 
+ * @brief   "(sec.usec) ifname id#data", "id##Fdata" for CAN FD, "id#R" for remote frames.
+ *          The line is built by hand, printf per byte dominates the export otherwise.
+ * 
+ * @param   capture_export* const       : object pointer to the struct.
+ *          can_frame_rec const * const : frame
+ * 
+ * @return  none.
+ */
+static void capture_export_candump(capture_export* const me, can_frame_rec const * const frame)
+{
+    char line[256U];
+    int  pos;
+    u8   i;
+    u8 const len = GET_MIN(frame->len, CAN_FRAME_MAX_DATA);
+
+    pos = snprintf(line, sizeof(line), "(%010llu.%06llu) %s ", frame->timestamp_ns / 1000000000ULL, 
+                   (frame->timestamp_ns % 1000000000ULL) / 1000ULL, me->bus_names[frame->bus % CAN_FRAME_MAX_BUSES]);
+
+    if (CAN_FRAME_IS_EXT(frame->can_id) || CAN_FRAME_IS_ERR(frame->can_id))
+    {
+        pos += snprintf(&line[pos], sizeof(line) - (u32) pos, "%08X#", frame->can_id & (CAN_EFF_MASK | CAN_ERR_FLAG));
+    }
+    else
+    {
+        pos += snprintf(&line[pos], sizeof(line) - (u32) pos, "%03X#", frame->can_id & CAN_SFF_MASK);
+    }
+
+    if ((frame->flags & CAN_FRAME_FLAG_FD) != 0U)
+    {
+        line[pos++] = '#';
+        line[pos++] = hex_digits[frame->flags & (CAN_FRAME_FLAG_BRS | CAN_FRAME_FLAG_ESI)];
+    }
+    else if (CAN_FRAME_IS_RTR(frame->can_id))
+    {
+        line[pos++] = 'R';
+    }
+
+    if (CAN_FRAME_IS_RTR(frame->can_id) == false)
+    {
+        for (i = 0U; i < len; ++i)
+        {
+            line[pos++] = hex_digits[frame->data[i] >> 4U];
+            line[pos++] = hex_digits[frame->data[i] & 0x0FU];
+        }
+    }
+
+    line[pos++] = '\n';
+    fwrite(line, 1U, (u32) pos, me->out);
+
+    return;
+}
+
+
+/**
+ * @name    static void capture_export_asc(capture_export* const me, can_frame_rec const * const frame)
+ * 
+ * @brief   Vector ASC line, channels count from 1. For CAN FD the bus timing related 
+ *          columns (duration, bit count, crc) are not captured and written as 0.
+ * 
+ * @param   capture_export* const       : object pointer to the struct.
+ *          can_frame_rec const * const : frame
+ * 
+ * @return  none.
+ */
+static void capture_export_asc(capture_export* const me, can_frame_rec const * const frame)
+{
+    char line[512U];
+    char stamp[32U];
+    char id[16U];
+    int  pos;
+    u8   i;
+    u8 const len = GET_MIN(frame->len, CAN_FRAME_MAX_DATA);
+    s64 const rel = (s64) (frame->timestamp_ns - me->start_ns);
+    u64 const abs_rel = (rel < 0) ? (u64) -rel : (u64) rel;
+
+    snprintf(stamp, sizeof(stamp), "%s%llu.%06llu", (rel < 0) ? "-" : "", abs_rel / 1000000000ULL, (abs_rel % 1000000000ULL) / 1000ULL);
+
+    if (CAN_FRAME_IS_EXT(frame->can_id))
+    {
+        snprintf(id, sizeof(id), "%Xx", frame->can_id & CAN_EFF_MASK);
+    }
+    else
+    {
+        snprintf(id, sizeof(id), "%X", frame->can_id & CAN_SFF_MASK);
+    }
+
+    if ((frame->flags & CAN_FRAME_FLAG_FD) != 0U)
+    {
+        pos = snprintf(line, sizeof(line), "%11s CANFD %3u Rx %10s %32s %u %u %X %2u", stamp,
+                       (frame->bus % CAN_FRAME_MAX_BUSES) + 1U, id, "", (frame->flags & CAN_FRAME_FLAG_BRS) ? 1U : 0U, (frame->flags & CAN_FRAME_FLAG_ESI) ? 1U : 0U,
+                       can_frame_len_to_dlc(len), len);
+    }
+    else if (CAN_FRAME_IS_RTR(frame->can_id))
+    {
+        pos = snprintf(line, sizeof(line), "%11s %u  %-15s Rx   r", stamp, (frame->bus % CAN_FRAME_MAX_BUSES) + 1U, id);
+    }
+    else
+    {
+        pos = snprintf(line, sizeof(line), "%11s %u  %-15s Rx   d %u", stamp, (frame->bus % CAN_FRAME_MAX_BUSES) + 1U, id, len);
+    }
+
+    if (CAN_FRAME_IS_RTR(frame->can_id) == false)
+    {
+        for (i = 0U; i < len; ++i)
+        {
+            line[pos++] = ' ';
+            line[pos++] = hex_digits[frame->data[i] >> 4U];
+            line[pos++] = hex_digits[frame->data[i] & 0x0FU];
+        }
+    }
+
+    if ((frame->flags & CAN_FRAME_FLAG_FD) != 0U)
+    {
+        pos += snprintf(&line[pos], sizeof(line) - (u32) pos, "        0    0   %6X        0        0        0        0        0",
+                        ((frame->flags & CAN_FRAME_FLAG_BRS) ? 0x3000U : 0x1000U));
+    }
+
+    line[pos++] = '\n';
+    fwrite(line, 1U, (u32) pos, me->out);
+
+    return;
+}
+
+
+/**
+ * @name    static void capture_export_asc_date(capture_export* const me, char const * const prefix)
+ * 
+ * @brief   "<prefix> Mon Oct 19 10:02:03.000 am 2026" line of the ASC header 
+ * 
+ * @param   capture_export* const : object pointer to the struct.
+ *          char const * const    : leading keyword
+ * 
+ * @return  none.
+ */
+static void capture_export_asc_date(capture_export* const me, char const * const prefix)
+{
+    time_t const sec = (time_t) (me->start_ns / 1000000000ULL);
+    struct tm tm;
+    char date[32U];
+    char year[8U];
+
+    localtime_r(&sec, &tm);
+    strftime(date, sizeof(date), "%a %b %d %I:%M:%S", &tm);
+    strftime(year, sizeof(year), "%Y", &tm);
+    fprintf(me->out, "%s %s.%03llu %s %s\n", prefix, date, (me->start_ns % 1000000000ULL) / 1000000ULL, 
+            (tm.tm_hour < 12) ? "am" : "pm", year);
+
+    return;
+}
@@ -0,0 +1,654 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "capture.h"
+
+#define __CAPTURE_QUERY_H_
+#include "capture_query.h"
+
+/**
+ * @name    void capture_query_init(capture_query* const me)
+ * 
+ * @brief   query for all frames of all buses, scanned by the calling thread 
+ * 
+ * @param   capture_query* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void capture_query_init(capture_query* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    memset(me, 0, sizeof(*me));
+    me->from_ns  = 0U;
+    me->to_ns    = (u64) -1;
+    me->bus_mask = CAPTURE_QUERY_ALL_BUSES;
+    me->threads  = 1U;
+
+    return;
+}
+
+
+/**
+ * @name    __boolean capture_query_add_id(capture_query* const me, u32 can_id, u32 mask)
+ * 
+ * @brief   adds an ID filter, a frame passes if it matches any of the filters 
+ * 
+ * @param   capture_query* const : object pointer to the struct.
+ *          u32                  : can_id, CAN_EFF_FLAG set for extended IDs 
+ *          u32                  : bits of can_id that have to match 
+ * 
+ * @return  __boolean            : true if success, false if the filter table is full.
+ */
+__boolean capture_query_add_id(capture_query* const me, u32 can_id, u32 mask)
+{
+    CHECK_NULLPTR_RET(me);
+
+    if (me->filter_count >= CAPTURE_QUERY_MAX_FILTERS)
+    {
+        return false;
+    }
+
+    me->filters[me->filter_count].can_id = can_id & mask;
+    me->filters[me->filter_count].mask   = mask;
+    ++me->filter_count;
+
+    return true;
+}
+
+
+/**
+ * @name    void capture_query_set_time(capture_query* const me, u64 from_ns, u64 to_ns)
+ * 
+ * @brief   restricts the query to frames with from_ns <= timestamp <= to_ns 
+ * 
+ * @param   capture_query* const : object pointer to the struct.
+ *          u64                  : first timestamp 
+ *          u64                  : last timestamp, inclusive
+ * 
+ * @return  none.
+ */
+void capture_query_set_time(capture_query* const me, u64 from_ns, u64 to_ns)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    me->from_ns = from_ns;
+    me->to_ns   = to_ns;
+
+    return;
+}
+
+
+/**
+ * @name    void capture_query_set_threads(capture_query* const me, u8 threads)
+ * 
+ * @brief   number of worker threads decoding candidate blocks, 0 and 1 scan in the 
+ *          calling thread 
+ * 
+ * @param   capture_query* const : object pointer to the struct.
+ *          u8                   : threads 
+ * 
+ * @return  none.
+ */
+void capture_query_set_threads(capture_query* const me, u8 threads)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    me->threads = (u8) GET_MIN(GET_MAX(threads, 1U), CAPTURE_QUERY_MAX_THREADS);
+
+    return;
+}
+
+
+/**
+ * @name    __boolean capture_query_match(capture_query const * const me, can_frame_rec const * const frame)
+ * 
+ * @brief   exact test of one frame against time range, buses and ID filters 
+ * 
+ * @param   capture_query const * const : object pointer to the struct.
+ *          can_frame_rec const * const : frame
+ * 
+ * @return  __boolean : true if the frame is part of the result.
+ */
+__boolean capture_query_match(capture_query const * const me, can_frame_rec const * const frame)
+{
+    if ((frame->timestamp_ns < me->from_ns) || (frame->timestamp_ns > me->to_ns))
+    {
+        return false;
+    }
+
+    if ((frame->bus >= 32U) || ((me->bus_mask & (1U << frame->bus)) == 0U))
+    {
+        return false;
+    }
+
+    return capture_query_id_matches(me, frame->can_id);
+}
+
+
+/**
+ * @name    u32 capture_query_candidates(capture_query const * const me, capture_reader const * const reader, u32* const blocks)
+ * 
+ * @brief   resolves the query against the segment index. The time range narrows the 
+ *          block range by binary search; the posting lists of the matching IDs, or the 
+ *          block ID directories without footer, drop the blocks in it that cannot hold 
+ *          a matching frame. 
+ * 
+ * @param   capture_query const * const  : object pointer to the struct.
+ *          capture_reader const * const : opened segment 
+ *          u32* const                   : returns the candidate blocks, ascending, 
+ *                                         room for reader->block_count entries
+ * 
+ * @return  u32 : number of candidate blocks.
+ */
+u32 capture_query_candidates(capture_query const * const me, capture_reader const * const reader, u32* const blocks)
+{
+    u64* bitmap = NULLPTR;
+    u32 first;
+    u32 last;
+    u32 count = 0U;
+    u32 b;
+
+    if ((me == NULLPTR) || (reader == NULLPTR) || (blocks == NULLPTR))
+    {
+        return 0U;
+    }
+
+    capture_query_time_range(me, reader, &first, &last);
+    if (first >= last)
+    {
+        return 0U;
+    }
+
+    if ((me->filter_count > 0U) && (reader->postings != NULLPTR))
+    {
+        bitmap = (u64*) calloc(((u64) reader->block_count + 63U) / 64U, sizeof(u64));
+        if (bitmap != NULLPTR)
+        {
+            capture_query_mark_ids(me, reader, bitmap);
+        }
+    }
+
+    for (b = first; b < last; ++b)
+    {
+        capture_block_entry const * const entry = &reader->blocks[b];
+
+        if ((entry->last_ts < me->from_ns) || (entry->first_ts > me->to_ns) || (entry->frame_count == 0U))
+        {
+            continue;
+        }
+        if (bitmap != NULLPTR)
+        {
+            if ((bitmap[b / 64U] & (1ULL << (b % 64U))) == 0U)
+            {
+                continue;
+            }
+        }
+        else if ((me->filter_count > 0U) && (capture_query_block_matches(me, reader, b) == false))
+        {
+            continue;
+        }
+        blocks[count++] = b;
+    }
+
+    free(bitmap);
+
+    return count;
+}
+
+
+/**
+ * @name    u64 capture_query_segment(capture_query* const me, capture_reader const * const reader, capture_query_visit visit, void* ctx)
+ * 
+ * @brief   runs the query on one segment. visit is called from the calling thread for 
+ *          every candidate block with matching frames, in block order. 
+ * 
+ * @param   capture_query* const         : object pointer to the struct, stats are added up 
+ *          capture_reader const * const : opened segment 
+ *          capture_query_visit          : result callback 
+ *          void*                        : passed to visit 
+ * 
+ * @return  u64 : number of matching frames.
+ */
+u64 capture_query_segment(capture_query* const me, capture_reader const * const reader, capture_query_visit visit, void* ctx)
+{
+    capture_query_scan scan;
+    can_frame_rec* frames;
+    u32* blocks;
+    u32 capacity = 0U;
+    u32 count;
+    u32 i;
+    u64 scanned = 0U;
+    u64 matched = 0U;
+
+    if ((me == NULLPTR) || (reader == NULLPTR) || (visit == NULLPTR) || (reader->block_count == 0U))
+    {
+        return 0U;
+    }
+
+    blocks = (u32*) malloc((u64) reader->block_count * sizeof(u32));
+    if (blocks == NULLPTR)
+    {
+        return 0U;
+    }
+
+    count = capture_query_candidates(me, reader, blocks);
+    me->stats.blocks_total     += reader->block_count;
+    me->stats.blocks_candidate += count;
+
+    for (i = 0U; i < count; ++i)
+    {
+        capacity = GET_MAX(capacity, reader->blocks[blocks[i]].frame_count);
+    }
+
+    if ((me->threads > 1U) && (count > 1U))
+    {
+        memset(&scan, 0, sizeof(scan));
+        scan.query          = me;
+        scan.reader         = reader;
+        scan.blocks         = blocks;
+        scan.count          = count;
+        scan.window         = (u32) me->threads * CAPTURE_QUERY_WINDOW;
+        scan.frame_capacity = capacity;
+        matched = capture_query_parallel(me, &scan, visit, ctx);
+        if (matched != (u64) -1)
+        {
+            free(blocks);
+            return matched;
+        }
+        matched = 0U;
+    }
+
+    // single threaded: decode and deliver block by block 
+    frames = (can_frame_rec*) malloc(((u64) capacity + 1U) * sizeof(can_frame_rec));
+    if (frames != NULLPTR)
+    {
+        for (i = 0U; i < count; ++i)
+        {
+            u32 const n = capture_query_scan_block(me, reader, blocks[i], frames, capacity, &scanned);
+            if (n > 0U)
+            {
+                visit(ctx, frames, n);
+                matched += n;
+            }
+        }
+    }
+
+    me->stats.frames_scanned += scanned;
+    me->stats.frames_matched += matched;
+
+    free(frames);
+    free(blocks);
+
+    return matched;
+}
+
+
+/**
+ * @name    static void capture_query_time_range(capture_query const * const me, capture_reader const * const reader, u32* const first, u32* const last)
+ * 
+ * @brief   block range [first, last) that holds every block overlapping the time 
+ *          range. Blocks of several rings are not sorted by time, the reader searches 
+ *          its running maximum of last_ts and minimum of first_ts, so no overlapping 
+ *          block falls outside. The blocks in between are checked one by one.
+ * 
+ * @param   capture_query const * const  : object pointer to the struct.
+ *          capture_reader const * const : opened segment 
+ *          u32* const                   : first block 
+ *          u32* const                   : behind the last block 
+ * 
+ * @return  none.
+ */
+static void capture_query_time_range(capture_query const * const me, capture_reader const * const reader, u32* const first, u32* const last)
+{
+    *first = capture_reader_find_block(reader, me->from_ns);
+    *last  = capture_reader_find_block_end(reader, me->to_ns);
+
+    return;
+}
+
+
+/**
+ * @name    static void capture_query_mark_ids(capture_query const * const me, capture_reader const * const reader, u64* const bitmap)
+ * 
+ * @brief   sets the bits of all blocks in the posting lists of the IDs that pass a 
+ *          filter. Exact filters are looked up, masked filters walk the ID table. 
+ * 
+ * @param   capture_query const * const  : object pointer to the struct.
+ *          capture_reader const * const : segment with footer 
+ *          u64* const                   : block bitmap 
+ * 
+ * @return  none.
+ */
+static void capture_query_mark_ids(capture_query const * const me, capture_reader const * const reader, u64* const bitmap)
+{
+    u32 f;
+    u32 i;
+
+    for (f = 0U; f < me->filter_count; ++f)
+    {
+        capture_query_filter const * const filter = &me->filters[f];
+        u32 const id_bits = CAN_EFF_FLAG | (((filter->can_id & CAN_EFF_FLAG) != 0U) ? CAN_EFF_MASK : CAN_SFF_MASK);
+
+        if ((filter->mask & id_bits) == id_bits)
+        {
+            // one lookup per combination of the flags the filter does not care about 
+            u32 const open = CAPTURE_QUERY_ID_FLAGS & ~filter->mask;
+            u32 flags = 0U;
+            do
+            {
+                capture_query_mark_entry(me, reader, capture_reader_find_id(reader, filter->can_id | flags), bitmap);
+                flags = (flags - open) & open;
+            } while (flags != 0U);
+        }
+        else
+        {
+            for (i = 0U; i < reader->id_count; ++i)
+            {
+                if (((reader->ids[i].can_id ^ filter->can_id) & filter->mask) == 0U)
+                {
+                    capture_query_mark_entry(me, reader, &reader->ids[i], bitmap);
+                }
+            }
+        }
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static void capture_query_mark_entry(capture_query const * const me, capture_reader const * const reader, capture_id_entry const * const entry, u64* const bitmap)
+ * 
+ * @brief   sets the bits of the posting list of one ID, unless its time span or its 
+ *          buses rule it out 
+ * 
+ * @param   capture_query const * const    : object pointer to the struct.
+ *          capture_reader const * const   : segment with footer 
+ *          capture_id_entry const * const : ID, NULLPTR is ignored 
+ *          u64* const                     : block bitmap 
+ * 
+ * @return  none.
+ */
+static void capture_query_mark_entry(capture_query const * const me, capture_reader const * const reader, capture_id_entry const * const entry, u64* const bitmap)
+{
+    u32 const * postings;
+    u32 i;
+
+    if ((entry == NULLPTR) || (entry->last_ts < me->from_ns) || (entry->first_ts > me->to_ns) || 
+        ((entry->bus_mask & me->bus_mask) == 0U))
+    {
+        return;
+    }
+
+    postings = capture_reader_postings(reader, entry);
+    if ((postings == NULLPTR) || 
+        (((u64) entry->postings_start + entry->postings_count) > reader->footer->posting_count))
+    {
+        return;
+    }
+
+    for (i = 0U; i < entry->postings_count; ++i)
+    {
+        u32 const b = postings[i];
+        if (b < reader->block_count)
+        {
+            bitmap[b / 64U] |= 1ULL << (b % 64U);
+        }
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static __boolean capture_query_block_matches(capture_query const * const me, capture_reader const * const reader, u32 block)
+ * 
+ * @brief   tests the ID directory of a block of a segment without footer 
+ * 
+ * @param   capture_query const * const  : object pointer to the struct.
+ *          capture_reader const * const : opened segment 
+ *          u32                          : block number 
+ * 
+ * @return  __boolean : true if the block may hold a matching frame, always true for 
+ *                      the block that was open when the writer stopped.
+ */
+static __boolean capture_query_block_matches(capture_query const * const me, capture_reader const * const reader, u32 block)
+{
+    u32 count;
+    u32 const * const ids = capture_reader_block_ids(reader, block, &count);
+    u32 i;
+
+    if (ids == NULLPTR)
+    {
+        return true;
+    }
+
+    for (i = 0U; i < count; ++i)
+    {
+        if (capture_query_id_matches(me, ids[i]) == true)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @name    static __boolean capture_query_id_matches(capture_query const * const me, u32 can_id)
+ * 
+ * @brief   tests an ID against the filters 
+ * 
+ * @param   capture_query const * const : object pointer to the struct.
+ *          u32                         : can_id with the kernel flags 
+ * 
+ * @return  __boolean : true if there are no filters or one of them matches.
+ */
+static __boolean capture_query_id_matches(capture_query const * const me, u32 can_id)
+{
+    u32 f;
+
+    if (me->filter_count == 0U)
+    {
+        return true;
+    }
+
+    for (f = 0U; f < me->filter_count; ++f)
+    {
+        if (((can_id ^ me->filters[f].can_id) & me->filters[f].mask) == 0U)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @name    static u32 capture_query_scan_block(capture_query const * const me, capture_reader const * const reader, u32 block, can_frame_rec* const frames, u32 capacity, u64* const scanned)
+ * 
+ * @brief   decodes one block and keeps the matching frames 
+ * 
+ * @param   capture_query const * const  : object pointer to the struct.
+ *          capture_reader const * const : opened segment 
+ *          u32                          : block number 
+ *          can_frame_rec* const         : result buffer 
+ *          u32                          : capacity of the buffer 
+ *          u64* const                   : decoded frames are added 
+ * 
+ * @return  u32 : number of matching frames.
+ */
+static u32 capture_query_scan_block(capture_query const * const me, capture_reader const * const reader, u32 block, can_frame_rec* const frames, u32 capacity, u64* const scanned)
+{
+    capture_cursor cursor;
+    u32 n = 0U;
+
+    if (capture_cursor_init(&cursor, reader, block) == false)
+    {
+        return 0U;
+    }
+
+    // the slot behind the last kept frame serves as decode buffer 
+    while ((n <= capacity) && (capture_cursor_next(&cursor, &frames[n]) == true))
+    {
+        ++(*scanned);
+        if (capture_query_match(me, &frames[n]) == true)
+        {
+            ++n;
+        }
+    }
+
+    return GET_MIN(n, capacity);
+}
+
+
+/**
+ * @name    static void* capture_query_worker(void* arg)
+ * 
+ * @brief   claims candidate blocks in order and decodes them into their window slot. 
+ *          A block is only claimed when its slot was handed to the visitor, which 
+ *          bounds the memory in flight to the window. 
+ * 
+ * @param   void* : capture_query_scan of the segment
+ * 
+ * @return  NULLPTR.
+ */
+static void* capture_query_worker(void* arg)
+{
+    capture_query_scan* const scan = (capture_query_scan*) arg;
+
+    for (;;)
+    {
+        u64 scanned = 0U;
+        u32 index;
+        u32 slot;
+        u32 n;
+
+        pthread_mutex_lock(&scan->lock);
+        while ((scan->next < scan->count) && (scan->next >= (scan->delivered + scan->window)))
+        {
+            pthread_cond_wait(&scan->cond, &scan->lock);
+        }
+        if (scan->next >= scan->count)
+        {
+            pthread_mutex_unlock(&scan->lock);
+            break;
+        }
+        index = scan->next++;
+        pthread_mutex_unlock(&scan->lock);
+
+        slot = index % scan->window;
+        n = capture_query_scan_block(scan->query, scan->reader, scan->blocks[index], 
+                                     &scan->frames[(u64) slot * (scan->frame_capacity + 1U)], 
+                                     scan->frame_capacity, &scanned);
+
+        pthread_mutex_lock(&scan->lock);
+        scan->slot_count[slot] = n;
+        scan->slot_ready[slot] = 1U;
+        scan->scanned += scanned;
+        pthread_cond_broadcast(&scan->cond);
+        pthread_mutex_unlock(&scan->lock);
+    }
+
+    return NULLPTR;
+}
+
+
+/**
+ * @name    static u64 capture_query_parallel(capture_query* const me, capture_query_scan* const scan, capture_query_visit visit, void* ctx)
+ * 
+ * @brief   decodes the candidate blocks with worker threads and delivers the slots in 
+ *          candidate order from the calling thread 
+ * 
+ * @param   capture_query* const      : object pointer to the struct.
+ *          capture_query_scan* const : prepared scan 
+ *          capture_query_visit       : result callback 
+ *          void*                     : passed to visit 
+ * 
+ * @return  u64 : number of matching frames, (u64) -1 if no worker could be started.
+ */
+static u64 capture_query_parallel(capture_query* const me, capture_query_scan* const scan, capture_query_visit visit, void* ctx)
+{
+    pthread_t threads[CAPTURE_QUERY_MAX_THREADS];
+    u32 const workers = GET_MIN((u32) me->threads, scan->count);
+    u32 started = 0U;
+    u32 d;
+    u64 matched = 0U;
+
+    scan->frames     = (can_frame_rec*) malloc((u64) scan->window * (scan->frame_capacity + 1U) * sizeof(can_frame_rec));
+    scan->slot_count = (u32*) calloc(scan->window, sizeof(u32));
+    scan->slot_ready = (u8*) calloc(scan->window, sizeof(u8));
+    if ((scan->frames == NULLPTR) || (scan->slot_count == NULLPTR) || (scan->slot_ready == NULLPTR))
+    {
+        free(scan->frames);
+        free(scan->slot_count);
+        free(scan->slot_ready);
+        return (u64) -1;
+    }
+
+    pthread_mutex_init(&scan->lock, NULLPTR);
+    pthread_cond_init(&scan->cond, NULLPTR);
+
+    for (d = 0U; d < workers; ++d)
+    {
+        if (pthread_create(&threads[started], NULLPTR, capture_query_worker, scan) == 0)
+        {
+            ++started;
+        }
+    }
+
+    if (started > 0U)
+    {
+        for (d = 0U; d < scan->count; ++d)
+        {
+            u32 const slot = d % scan->window;
+
+            pthread_mutex_lock(&scan->lock);
+            while (scan->slot_ready[slot] == 0U)
+            {
+                pthread_cond_wait(&scan->cond, &scan->lock);
+            }
+            pthread_mutex_unlock(&scan->lock);
+
+            if (scan->slot_count[slot] > 0U)
+            {
+                visit(ctx, &scan->frames[(u64) slot * (scan->frame_capacity + 1U)], scan->slot_count[slot]);
+                matched += scan->slot_count[slot];
+            }
+
+            pthread_mutex_lock(&scan->lock);
+            scan->slot_ready[slot] = 0U;
+            ++scan->delivered;
+            pthread_cond_broadcast(&scan->cond);
+            pthread_mutex_unlock(&scan->lock);
+        }
+
+        for (d = 0U; d < started; ++d)
+        {
+            pthread_join(threads[d], NULLPTR);
+        }
+
+        me->stats.frames_scanned += scan->scanned;
+        me->stats.frames_matched += matched;
+    }
+    else
+    {
+        matched = (u64) -1;
+    }
+
+    pthread_cond_destroy(&scan->cond);
+    pthread_mutex_destroy(&scan->lock);
+    free(scan->frames);
+    free(scan->slot_count);
+    free(scan->slot_ready);
+
+    return matched;
+}
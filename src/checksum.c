@@ -0,0 +1,65 @@
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif /* __SSE4_2__ */
+#include "utils.h"
+
+#define __CHECKSUM_H_
+#include "checksum.h"
+
+/**
+ * @name    u32 checksum_crc32c_update(u32 crc, void const * const data, u64 size)
+ * 
+ * @brief   continues a CRC-32C over a further chunk of data. The crc passed in and
+ *          returned is the raw register value, start with CHECKSUM_CRC32C_INIT and 
+ *          xor the result with CHECKSUM_CRC32C_INIT when done.
+ * 
+ * @param   u32               : running crc register 
+ *          void const* const : data to be added 
+ *          u64               : number of bytes
+ * 
+ * @return  u32 : updated crc register.
+ */
+u32 checksum_crc32c_update(u32 crc, void const * const data, u64 size)
+{
+    u8 const * ptr = (u8 const *) data;
+
+#if defined(__SSE4_2__) && defined(__x86_64__)
+    u64 crc64 = crc;
+    while (size >= 8U)
+    {
+        u64 word;
+        __builtin_memcpy(&word, ptr, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        ptr  += 8U;
+        size -= 8U;
+    }
+    crc = (u32) crc64;
+    while (size--)
+    {
+        crc = _mm_crc32_u8(crc, *ptr++);
+    }
+#else
+    while (size--)
+    {
+        crc = crc32c_table[(crc ^ *ptr++) & 0xFFU] ^ (crc >> 8U);
+    }
+#endif /* __SSE4_2__ */
+
+    return crc;
+}
+
+
+/**
+ * @name    u32 checksum_crc32c(void const * const data, u64 size)
+ * 
+ * @brief   one shot CRC-32C over a buffer
+ * 
+ * @param   void const* const : data  
+ *          u64               : number of bytes
+ * 
+ * @return  u32 : final crc value.
+ */
+u32 checksum_crc32c(void const * const data, u64 size)
+{
+    return checksum_crc32c_update(CHECKSUM_CRC32C_INIT, data, size) ^ CHECKSUM_CRC32C_INIT;
+}
@@ -0,0 +1,520 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+
+#define __DBC_H_
+#include "dbc.h"
+
+/**
+ * @name    __boolean dbc_load(dbc_database* const me, u8 __id, char const * const path)
+ * 
+ * @brief   parses a DBC file 
+ * 
+ * @param   dbc_database* const : object pointer to the struct.
+ *          u8                  : module id 
+ *          char const * const  : path of the file
+ * 
+ * @return  __boolean           : true if success, false if the file could not be read or 
+ *                                a line could not be parsed (see error_line).
+ */
+__boolean dbc_load(dbc_database* const me, u8 __id, char const * const path)
+{
+    FILE* stream;
+    __boolean ret;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(path);
+
+    stream = fopen(path, "r");
+    if (stream == NULLPTR)
+    {
+        memset(me, 0, sizeof(*me));
+        return false;
+    }
+
+    ret = dbc_load_stream(me, __id, stream);
+    fclose(stream);
+
+    return ret;
+}
+
+
+/**
+ * @name    __boolean dbc_load_stream(dbc_database* const me, u8 __id, FILE* const stream)
+ * 
+ * @brief   parses DBC text from a stream, e.g. fmemopen() of a string
+ * 
+ * @param   dbc_database* const : object pointer to the struct.
+ *          u8                  : module id 
+ *          FILE* const         : DBC text
+ * 
+ * @return  __boolean           : true if success, false if a line could not be parsed.
+ */
+__boolean dbc_load_stream(dbc_database* const me, u8 __id, FILE* const stream)
+{
+    char line[DBC_MAX_LINE];
+    u32 number = 0U;
+    __boolean in_message = false;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(stream);
+
+    memset(me, 0, sizeof(*me));
+
+    while (fgets(line, sizeof(line), stream) != NULLPTR)
+    {
+        char const * text = line;
+        __boolean ok = true;
+
+        ++number;
+        while ((*text == ' ') || (*text == '\t'))
+        {
+            ++text;
+        }
+
+        if (strncmp(text, "BO_ ", 4U) == 0)
+        {
+            // the pseudo message collects signals without message, they are not decoded 
+            in_message = false;
+            if (strstr(text, DBC_PSEUDO_MESSAGE) == NULLPTR)
+            {
+                ok = dbc_parse_message(me, &text[4]);
+                in_message = ok;
+            }
+        }
+        else if (strncmp(text, "SG_ ", 4U) == 0)
+        {
+            // signals of skipped pseudo messages are skipped as well 
+            ok = (in_message == false) || dbc_parse_signal(me, &text[4]);
+        }
+        else if (strncmp(text, "SIG_VALTYPE_ ", 13U) == 0)
+        {
+            ok = dbc_parse_value_type(me, &text[13]);
+        }
+        else if ((*text != '\r') && (*text != '\n') && (*text != '\0'))
+        {
+            in_message = false;
+        }
+
+        if ((ok == false) && (me->error_line == 0U))
+        {
+            me->error_line = number;
+        }
+    }
+
+    dbc_build_index(me);
+    me->module_position = utils_register_module(DBC_MODULE_NAME, __id);
+
+    return (me->error_line == 0U) && ((me->message_count == 0U) || (me->by_id != NULLPTR));
+}
+
+
+/**
+ * @name    void dbc_destruct(dbc_database* const me)
+ * 
+ * @brief   frees the tables of the database 
+ * 
+ * @param   dbc_database* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void dbc_destruct(dbc_database* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    free(me->messages);
+    free(me->signals);
+    free(me->by_id);
+    utils_remove_module_registration(me->module_position);
+    memset(me, 0, sizeof(*me));
+
+    return;
+}
+
+
+/**
+ * @name    dbc_message const * dbc_find_message(dbc_database const * const me, u32 can_id)
+ * 
+ * @brief   binary search of a message by ID 
+ * 
+ * @param   dbc_database const * const : object pointer to the struct.
+ *          u32                        : can_id, CAN_EFF_FLAG set for extended IDs 
+ * 
+ * @return  dbc_message const * : message, NULLPTR if unknown.
+ */
+dbc_message const * dbc_find_message(dbc_database const * const me, u32 can_id)
+{
+    u32 low = 0U;
+    u32 high;
+
+    if ((me == NULLPTR) || (me->by_id == NULLPTR))
+    {
+        return NULLPTR;
+    }
+
+    can_id &= CAN_EFF_FLAG | CAN_EFF_MASK;
+    high = me->message_count;
+    while (low < high)
+    {
+        u32 const mid = low + ((high - low) / 2U);
+        if (me->messages[me->by_id[mid]].can_id < can_id)
+        {
+            low = mid + 1U;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return ((low < me->message_count) && (me->messages[me->by_id[low]].can_id == can_id)) ? 
+           &me->messages[me->by_id[low]] : NULLPTR;
+}
+
+
+/**
+ * @name    dbc_signal const * dbc_find_signal(dbc_database const * const me, char const * const message, char const * const signal)
+ * 
+ * @brief   looks up a signal by message and signal name 
+ * 
+ * @param   dbc_database const * const : object pointer to the struct.
+ *          char const * const         : message name 
+ *          char const * const         : signal name
+ * 
+ * @return  dbc_signal const * : signal, NULLPTR if unknown.
+ */
+dbc_signal const * dbc_find_signal(dbc_database const * const me, char const * const message, char const * const signal)
+{
+    u32 m;
+    u32 s;
+
+    if ((me == NULLPTR) || (message == NULLPTR) || (signal == NULLPTR))
+    {
+        return NULLPTR;
+    }
+
+    for (m = 0U; m < me->message_count; ++m)
+    {
+        if (strcmp(me->messages[m].name, message) != 0)
+        {
+            continue;
+        }
+        for (s = 0U; s < me->messages[m].signal_count; ++s)
+        {
+            dbc_signal const * const sig = &me->signals[me->messages[m].first_signal + s];
+            if (strcmp(sig->name, signal) == 0)
+            {
+                return sig;
+            }
+        }
+    }
+
+    return NULLPTR;
+}
+
+
+/**
+ * @name    f64 dbc_signal_decode(dbc_signal const * const signal, u8 const * const data)
+ * 
+ * @brief   reference decoding of one signal, bit by bit as the DBC numbering defines 
+ *          it. The compiled plans of dbc_decoder give the same results much faster. 
+ * 
+ * @param   dbc_signal const * const : signal 
+ *          u8 const * const         : payload, at least the message size
+ * 
+ * @return  f64 : physical value.
+ */
+f64 dbc_signal_decode(dbc_signal const * const signal, u8 const * const data)
+{
+    u64 raw = 0U;
+    u32 bit = signal->start_bit;
+    u32 i;
+
+    if (signal->big_endian == false)
+    {
+        for (i = 0U; i < signal->length; ++i, ++bit)
+        {
+            raw |= (u64) ((data[bit / 8U] >> (bit % 8U)) & 1U) << i;
+        }
+    }
+    else
+    {
+        // MSB first, walking down inside a byte and on to the next byte 
+        for (i = signal->length; i > 0U; --i)
+        {
+            raw |= (u64) ((data[bit / 8U] >> (bit % 8U)) & 1U) << (i - 1U);
+            bit = ((bit % 8U) == 0U) ? (bit + 15U) : (bit - 1U);
+        }
+    }
+
+    switch (signal->value_type)
+    {
+        case DBC_VALUE_SIGNED:
+        {
+            u32 const shift = 64U - signal->length;
+            return ((f64) ((s64) (raw << shift) >> shift) * signal->factor) + signal->offset;
+        }
+        case DBC_VALUE_FLOAT32:
+        {
+            u32 const bits = (u32) raw;
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return ((f64) value * signal->factor) + signal->offset;
+        }
+        case DBC_VALUE_FLOAT64:
+        {
+            f64 value;
+            memcpy(&value, &raw, sizeof(value));
+            return (value * signal->factor) + signal->offset;
+        }
+        default:
+            return ((f64) raw * signal->factor) + signal->offset;
+    }
+}
+
+
+/**
+ * @name    static __boolean dbc_parse_message(dbc_database* const me, char const * line)
+ * 
+ * @brief   BO_ <id> <name>: <size> <transmitter>
+ * 
+ * @param   dbc_database* const : object pointer to the struct.
+ *          char const *        : line behind "BO_ "
+ * 
+ * @return  __boolean : true if success, false if something went wrong.
+ */
+static __boolean dbc_parse_message(dbc_database* const me, char const * line)
+{
+    dbc_message* msg;
+    unsigned long id;
+    unsigned size;
+    char name[DBC_NAME_MAX];
+
+    if (sscanf(line, "%lu %63[^: ] : %u", &id, name, &size) != 3)
+    {
+        return false;
+    }
+
+    if ((me->message_count == me->message_capacity) && 
+        (dbc_grow((void**) &me->messages, &me->message_capacity, sizeof(dbc_message)) == false))
+    {
+        return false;
+    }
+
+    msg = &me->messages[me->message_count++];
+    memset(msg, 0, sizeof(*msg));
+    strcpy(msg->name, name);
+    msg->can_id       = ((id & DBC_ID_EXTENDED) != 0U) ? (CAN_EFF_FLAG | ((u32) id & CAN_EFF_MASK)) : ((u32) id & CAN_SFF_MASK);
+    msg->size         = (u8) GET_MIN(size, CAN_FRAME_MAX_DATA);
+    msg->first_signal = me->signal_count;
+
+    return true;
+}
+
+
+/**
+ * @name    static __boolean dbc_parse_signal(dbc_database* const me, char const * line)
+ * 
+ * @brief   SG_ <name> [M|m<value>] : <start>|<length>@<order><sign> (<factor>,<offset>) 
+ *          [<min>|<max>] "<unit>" <receivers>, added to the last message
+ * 
+ * @param   dbc_database* const : object pointer to the struct.
+ *          char const *        : line behind "SG_ "
+ * 
+ * @return  __boolean : true if success, false if something went wrong.
+ */
+static __boolean dbc_parse_signal(dbc_database* const me, char const * line)
+{
+    dbc_signal sig;
+    unsigned start;
+    unsigned length;
+    char order;
+    char sign;
+    char mux[16];
+    int used = 0;
+
+    memset(&sig, 0, sizeof(sig));
+    if ((me->message_count == 0U) || (sscanf(line, "%63s %n", sig.name, &used) != 1))
+    {
+        return false;
+    }
+    line += used;
+
+    if (*line != ':')
+    {
+        if (sscanf(line, "%15s %n", mux, &used) != 1)
+        {
+            return false;
+        }
+        line += used;
+        if (mux[0] == 'M')
+        {
+            sig.mux_type = DBC_MUX_MULTIPLEXOR;
+        }
+        else if (mux[0] == 'm')
+        {
+            sig.mux_type  = DBC_MUX_MULTIPLEXED;
+            sig.mux_value = (u16) strtoul(&mux[1], NULLPTR, 10);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if ((sscanf(line, ": %u|%u@%c%c ( %lf , %lf ) [ %lf | %lf ] \"%15[^\"]", &start, &length, &order, &sign, 
+                &sig.factor, &sig.offset, &sig.minimum, &sig.maximum, sig.unit) < 8) || 
+        (length == 0U) || (length > 64U) || (start >= (CAN_FRAME_MAX_DATA * 8U)) || 
+        ((order != '0') && (order != '1')) || ((sign != '+') && (sign != '-')))
+    {
+        return false;
+    }
+
+    sig.message    = me->message_count - 1U;
+    sig.start_bit  = (u16) start;
+    sig.length     = (u8) length;
+    sig.big_endian = (order == '0');
+    sig.value_type = (sign == '-') ? DBC_VALUE_SIGNED : DBC_VALUE_UNSIGNED;
+
+    if ((me->signal_count == me->signal_capacity) && 
+        (dbc_grow((void**) &me->signals, &me->signal_capacity, sizeof(dbc_signal)) == false))
+    {
+        return false;
+    }
+
+    me->signals[me->signal_count++] = sig;
+    ++me->messages[sig.message].signal_count;
+
+    return true;
+}
+
+
+/**
+ * @name    static __boolean dbc_parse_value_type(dbc_database* const me, char const * line)
+ * 
+ * @brief   SIG_VALTYPE_ <id> <signal> : <1: float32, 2: float64> ;
+ * 
+ * @param   dbc_database* const : object pointer to the struct.
+ *          char const *        : line behind "SIG_VALTYPE_ "
+ * 
+ * @return  __boolean : true if success, false for syntax errors and unknown signals.
+ */
+static __boolean dbc_parse_value_type(dbc_database* const me, char const * line)
+{
+    unsigned long id;
+    unsigned type;
+    char name[DBC_NAME_MAX];
+    u32 m;
+    u32 s;
+
+    if (sscanf(line, "%lu %63[^: ] : %u", &id, name, &type) != 3)
+    {
+        return false;
+    }
+
+    id = ((id & DBC_ID_EXTENDED) != 0U) ? (CAN_EFF_FLAG | ((u32) id & CAN_EFF_MASK)) : ((u32) id & CAN_SFF_MASK);
+    for (m = 0U; m < me->message_count; ++m)
+    {
+        if (me->messages[m].can_id != (u32) id)
+        {
+            continue;
+        }
+        for (s = me->messages[m].first_signal; s < (me->messages[m].first_signal + me->messages[m].signal_count); ++s)
+        {
+            if (strcmp(me->signals[s].name, name) == 0)
+            {
+                me->signals[s].value_type = (type == 1U) ? DBC_VALUE_FLOAT32 : 
+                                            ((type == 2U) ? DBC_VALUE_FLOAT64 : me->signals[s].value_type);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @name    static __boolean dbc_grow(void** const list, u32* const capacity, u32 element_size)
+ * 
+ * @brief   doubles a table of the database 
+ * 
+ * @param   void** const : table, reallocated 
+ *          u32* const   : capacity in elements, updated 
+ *          u32          : size of an element 
+ * 
+ * @return  __boolean    : true if success, false if out of memory.
+ */
+static __boolean dbc_grow(void** const list, u32* const capacity, u32 element_size)
+{
+    u32 const grown = GET_MAX(DBC_MIN_CAPACITY, *capacity * 2U);
+    void* const ptr = realloc(*list, (u64) grown * element_size);
+
+    if (ptr == NULLPTR)
+    {
+        return false;
+    }
+
+    *list     = ptr;
+    *capacity = grown;
+
+    return true;
+}
+
+
+/**
+ * @name    static void dbc_build_index(dbc_database* const me)
+ * 
+ * @brief   sorts the message indexes by ID for dbc_find_message()
+ * 
+ * @param   dbc_database* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+static void dbc_build_index(dbc_database* const me)
+{
+    u32 i;
+
+    if (me->message_count == 0U)
+    {
+        return;
+    }
+
+    me->by_id = (u32*) malloc((u64) me->message_count * sizeof(u32));
+    if (me->by_id == NULLPTR)
+    {
+        return;
+    }
+
+    for (i = 0U; i < me->message_count; ++i)
+    {
+        me->by_id[i] = i;
+    }
+    qsort_r(me->by_id, me->message_count, sizeof(u32), dbc_compare_ids, me->messages);
+
+    return;
+}
+
+
+/**
+ * @name    static int dbc_compare_ids(void const * a, void const * b, void* arg)
+ * 
+ * @brief   qsort_r order of message indexes by can_id 
+ * 
+ * @param   void const * : first index 
+ *          void const * : second index
+ *          void*        : message table 
+ * 
+ * @return  int : <0, 0, >0.
+ */
+static int dbc_compare_ids(void const * a, void const * b, void* arg)
+{
+    dbc_message const * const messages = (dbc_message const *) arg;
+    u32 const id_a = messages[*(u32 const *) a].can_id;
+    u32 const id_b = messages[*(u32 const *) b].can_id;
+    return (id_a > id_b) - (id_a < id_b);
+}
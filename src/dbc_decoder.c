@@ -0,0 +1,815 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "dbc.h"
+
+#define __DBC_DECODER_H_
+#include "dbc_decoder.h"
+
+/**
+ * @name    __boolean dbc_decoder_init(dbc_decoder* const me, u8 __id, dbc_database const * const db)
+ * 
+ * @brief   compiles a plan for every message of the database and builds the ID lookup: 
+ *          a direct table for standard IDs, a sorted table for extended IDs 
+ * 
+ * @param   dbc_decoder* const         : object pointer to the struct.
+ *          u8                         : module id 
+ *          dbc_database const * const : parsed database, signal indexes are kept 
+ * 
+ * @return  __boolean : true if success, false if something went wrong.
+ */
+__boolean dbc_decoder_init(dbc_decoder* const me, u8 __id, dbc_database const * const db)
+{
+    u64* ext;
+    u32 m;
+    u32 s;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(db);
+
+    memset(me, 0, sizeof(*me));
+    // not registered yet, a failing init must not release position 0 in its destruct 
+    me->module_position = UNDEFINED_MODULE_ID;
+    if ((db->message_count == 0U) || (db->message_count > 0xFFFEU))
+    {
+        return false;
+    }
+
+    me->plans       = (dbc_plan*) calloc(db->message_count, sizeof(dbc_plan));
+    me->ops         = (dbc_op*) calloc(GET_MAX(db->signal_count, 1U), sizeof(dbc_op));
+    me->plan_frames = (u32*) calloc(db->message_count, sizeof(u32));
+    me->plan_start  = (u32*) calloc(db->message_count, sizeof(u32));
+    ext             = (u64*) calloc(db->message_count, sizeof(u64));
+    if ((me->plans == NULLPTR) || (me->ops == NULLPTR) || (me->plan_frames == NULLPTR) || 
+        (me->plan_start == NULLPTR) || (ext == NULLPTR))
+    {
+        free(ext);
+        dbc_decoder_destruct(me);
+        return false;
+    }
+
+    for (m = 0U; m < db->message_count; ++m)
+    {
+        dbc_message const * const msg = &db->messages[m];
+        dbc_plan* const plan = &me->plans[me->plan_count];
+        u32 end_byte = 0U;
+
+        plan->can_id   = msg->can_id;
+        plan->message  = m;
+        plan->first_op = me->op_count;
+        plan->mux_op   = DBC_DECODER_NO_MUX;
+
+        for (s = msg->first_signal; s < (msg->first_signal + msg->signal_count); ++s)
+        {
+            dbc_op* const op = &me->ops[me->op_count];
+            u32 end;
+
+            // signals reaching beyond the message size are errors of the database 
+            if ((dbc_decoder_compile_op(&db->signals[s], s, op, &end) == false) || (end >= msg->size))
+            {
+                ++me->skipped_signals;
+                continue;
+            }
+            if (op->mux_type == DBC_MUX_MULTIPLEXOR)
+            {
+                plan->mux_op = (s32) plan->op_count;
+            }
+            end_byte           = GET_MAX(end_byte, end);
+            plan->word_count   = (u8) GET_MAX(plan->word_count, op->word + (((op->flags & DBC_OP_SPLIT) != 0U) ? 2U : 1U));
+            plan->big_endian  |= op->flags & DBC_OP_BIG_ENDIAN;
+            ++plan->op_count;
+            ++me->op_count;
+        }
+
+        if (plan->op_count == 0U)
+        {
+            continue;
+        }
+        plan->min_len = (u8) (end_byte + 1U);
+
+        if (CAN_FRAME_IS_EXT(msg->can_id))
+        {
+            ext[me->ext_count++] = ((u64) msg->can_id << 32U) | me->plan_count;
+        }
+        else
+        {
+            me->std_plans[msg->can_id & CAN_SFF_MASK] = (u16) (me->plan_count + 1U);
+        }
+        ++me->plan_count;
+    }
+
+    if (me->ext_count > 0U)
+    {
+        qsort(ext, me->ext_count, sizeof(u64), dbc_decoder_compare_ext);
+        me->ext_ids   = (u32*) malloc((u64) me->ext_count * sizeof(u32));
+        me->ext_plans = (u16*) malloc((u64) me->ext_count * sizeof(u16));
+        if ((me->ext_ids == NULLPTR) || (me->ext_plans == NULLPTR))
+        {
+            free(ext);
+            dbc_decoder_destruct(me);
+            return false;
+        }
+        for (m = 0U; m < me->ext_count; ++m)
+        {
+            me->ext_ids[m]   = (u32) (ext[m] >> 32U);
+            me->ext_plans[m] = (u16) ext[m];
+        }
+    }
+    free(ext);
+
+    me->module_position = utils_register_module(DBC_DECODER_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void dbc_decoder_destruct(dbc_decoder* const me)
+ * 
+ * @brief   frees the plans 
+ * 
+ * @param   dbc_decoder* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void dbc_decoder_destruct(dbc_decoder* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    free(me->plans);
+    free(me->ops);
+    free(me->ext_ids);
+    free(me->ext_plans);
+    free(me->plan_frames);
+    free(me->plan_start);
+    me->plans       = NULLPTR;
+    me->ops         = NULLPTR;
+    me->ext_ids     = NULLPTR;
+    me->ext_plans   = NULLPTR;
+    me->plan_frames = NULLPTR;
+    me->plan_start  = NULLPTR;
+    me->plan_count  = 0U;
+    me->ext_count   = 0U;
+    utils_remove_module_registration(me->module_position);
+    me->module_position = UNDEFINED_MODULE_ID;
+
+    return;
+}
+
+
+/**
+ * @name    dbc_plan const * dbc_decoder_find_plan(dbc_decoder const * const me, u32 can_id)
+ * 
+ * @brief   plan of an ID, a table index for standard IDs, a binary search for extended 
+ * 
+ * @param   dbc_decoder const * const : object pointer to the struct.
+ *          u32                       : can_id with the kernel flags 
+ * 
+ * @return  dbc_plan const * : plan, NULLPTR for IDs without plan and RTR/error frames.
+ */
+dbc_plan const * dbc_decoder_find_plan(dbc_decoder const * const me, u32 can_id)
+{
+    u32 low = 0U;
+    u32 high;
+
+    if ((can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG)) != 0U)
+    {
+        return NULLPTR;
+    }
+
+    if (CAN_FRAME_IS_EXT(can_id) == false)
+    {
+        u16 const plan = me->std_plans[can_id & CAN_SFF_MASK];
+        return (plan != 0U) ? &me->plans[plan - 1U] : NULLPTR;
+    }
+
+    high = me->ext_count;
+    while (low < high)
+    {
+        u32 const mid = low + ((high - low) / 2U);
+        if (me->ext_ids[mid] < can_id)
+        {
+            low = mid + 1U;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return ((low < me->ext_count) && (me->ext_ids[low] == can_id)) ? &me->plans[me->ext_plans[low]] : NULLPTR;
+}
+
+
+/**
+ * @name    u32 dbc_decoder_decode(dbc_decoder* const me, can_frame_rec const * const frames, u32 count, dbc_store* const store)
+ * 
+ * @brief   decodes a batch of frames into the store. The frames are grouped by plan 
+ *          (counting sort, arrival order kept inside a group) and every group is 
+ *          decoded signal by signal.
+ * 
+ * @param   dbc_decoder* const        : object pointer to the struct.
+ *          can_frame_rec const * const : frames
+ *          u32                       : number of frames 
+ *          dbc_store* const          : destination, sized for the signals of the database
+ * 
+ * @return  u32 : number of frames that were decoded.
+ */
+u32 dbc_decoder_decode(dbc_decoder* const me, can_frame_rec const * const frames, u32 count, dbc_store* const store)
+{
+    u32 decoded = 0U;
+    u32 done = 0U;
+
+    if ((me == NULLPTR) || (frames == NULLPTR) || (store == NULLPTR))
+    {
+        return 0U;
+    }
+
+    while (done < count)
+    {
+        u32 const n = GET_MIN(count - done, DBC_DECODER_MAX_BATCH);
+        can_frame_rec const * const batch = &frames[done];
+        u32 touched = 0U;
+        u32 start = 0U;
+        u32 i;
+
+        for (i = 0U; i < n; ++i)
+        {
+            dbc_plan const * const plan = dbc_decoder_find_plan(me, batch[i].can_id);
+            u32 p;
+
+            if (plan == NULLPTR)
+            {
+                ++me->unknown;
+                me->frame_plan[i] = DBC_DECODER_NO_PLAN;
+                continue;
+            }
+            if (batch[i].len < plan->min_len)
+            {
+                ++me->short_frames;
+                me->frame_plan[i] = DBC_DECODER_NO_PLAN;
+                continue;
+            }
+            p = (u32) (plan - me->plans);
+            if (me->plan_frames[p]++ == 0U)
+            {
+                me->touched[touched++] = p;
+            }
+            me->frame_plan[i] = p;
+        }
+
+        for (i = 0U; i < touched; ++i)
+        {
+            me->plan_start[me->touched[i]] = start;
+            start += me->plan_frames[me->touched[i]];
+            me->plan_frames[me->touched[i]] = 0U;
+        }
+
+        for (i = 0U; i < n; ++i)
+        {
+            if (me->frame_plan[i] != DBC_DECODER_NO_PLAN)
+            {
+                u32 const p = me->frame_plan[i];
+                me->order[me->plan_start[p] + me->plan_frames[p]++] = i;
+            }
+        }
+
+        for (i = 0U; i < touched; ++i)
+        {
+            u32 const p = me->touched[i];
+            dbc_decoder_decode_plan(me, &me->plans[p], batch, &me->order[me->plan_start[p]], me->plan_frames[p], store);
+            decoded += me->plan_frames[p];
+            me->plan_frames[p] = 0U;
+        }
+
+        done += n;
+    }
+
+    me->decoded += decoded;
+
+    return decoded;
+}
+
+
+/**
+ * @name    u32 dbc_decoder_decode_ring(dbc_decoder* const me, frame_ring* const ring, dbc_store* const store)
+ * 
+ * @brief   decodes the frames waiting in a ring in place and releases them 
+ * 
+ * @param   dbc_decoder* const : object pointer to the struct.
+ *          frame_ring* const  : consumer side of the ring 
+ *          dbc_store* const   : destination
+ * 
+ * @return  u32 : number of frames taken from the ring.
+ */
+u32 dbc_decoder_decode_ring(dbc_decoder* const me, frame_ring* const ring, dbc_store* const store)
+{
+    can_frame_rec* slots;
+    u32 total = 0U;
+    u32 n;
+
+    if ((me == NULLPTR) || (ring == NULLPTR))
+    {
+        return 0U;
+    }
+
+    while ((n = frame_ring_peek(ring, &slots, DBC_DECODER_MAX_BATCH)) > 0U)
+    {
+        (void) dbc_decoder_decode(me, slots, n, store);
+        frame_ring_release(ring, n);
+        total += n;
+    }
+
+    return total;
+}
+
+
+/**
+ * @name    __boolean dbc_store_init(dbc_store* const me, u32 signal_count, u32 depth)
+ * 
+ * @brief   allocates the value and timestamp columns 
+ * 
+ * @param   dbc_store* const : object pointer to the struct.
+ *          u32              : number of signals of the database
+ *          u32              : samples kept per signal, rounded up to a power of two 
+ * 
+ * @return  __boolean : true if success, false if something went wrong.
+ */
+__boolean dbc_store_init(dbc_store* const me, u32 signal_count, u32 depth)
+{
+    u32 size = 1U;
+
+    CHECK_NULLPTR_RET(me);
+
+    memset(me, 0, sizeof(*me));
+    while ((size < depth) && (size < 0x80000000U))
+    {
+        size <<= 1U;
+    }
+
+    me->signal_count = GET_MAX(signal_count, 1U);
+    me->depth        = size;
+    me->mask         = size - 1U;
+    me->values       = (f64*) calloc((u64) me->signal_count * size, sizeof(f64));
+    me->timestamps   = (u64*) calloc((u64) me->signal_count * size, sizeof(u64));
+    me->counts       = (u64*) calloc(me->signal_count, sizeof(u64));
+    if ((me->values == NULLPTR) || (me->timestamps == NULLPTR) || (me->counts == NULLPTR))
+    {
+        dbc_store_destruct(me);
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    void dbc_store_destruct(dbc_store* const me)
+ * 
+ * @brief   frees the columns 
+ * 
+ * @param   dbc_store* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void dbc_store_destruct(dbc_store* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    free(me->values);
+    free(me->timestamps);
+    free(me->counts);
+    memset(me, 0, sizeof(*me));
+
+    return;
+}
+
+
+/**
+ * @name    void dbc_store_push(dbc_store* const me, u32 signal, f64 const * const values, u64 const * const timestamps, u32 count)
+ * 
+ * @brief   appends samples to the column of a signal, the oldest are overwritten 
+ * 
+ * @param   dbc_store* const : object pointer to the struct.
+ *          u32              : signal 
+ *          f64 const * const : values 
+ *          u64 const * const : timestamps 
+ *          u32              : number of samples 
+ * 
+ * @return  none.
+ */
+void dbc_store_push(dbc_store* const me, u32 signal, f64 const * const values, u64 const * const timestamps, u32 count)
+{
+    u64 base;
+    u32 skip;
+    u32 head;
+    u32 first;
+    u32 n;
+    u32 i;
+
+    if (signal >= me->signal_count)
+    {
+        return;
+    }
+
+    // a batch longer than the column only leaves its newest samples 
+    base  = (u64) signal * me->depth;
+    skip  = (count > me->depth) ? (count - me->depth) : 0U;
+    n     = count - skip;
+    head  = (u32) ((me->counts[signal] + skip) & me->mask);
+    first = GET_MIN(n, me->depth - head);
+    me->counts[signal] += count;
+
+    // batches of a message are short, plain loops beat memcpy calls here 
+    if (first == n)
+    {
+        f64* const dst_values = &me->values[base + head];
+        u64* const dst_timestamps = &me->timestamps[base + head];
+        for (i = 0U; i < n; ++i)
+        {
+            dst_values[i]     = values[skip + i];
+            dst_timestamps[i] = timestamps[skip + i];
+        }
+        return;
+    }
+
+    memcpy(&me->values[base + head], &values[skip], (u64) first * sizeof(f64));
+    memcpy(&me->timestamps[base + head], &timestamps[skip], (u64) first * sizeof(u64));
+    memcpy(&me->values[base], &values[skip + first], (u64) (n - first) * sizeof(f64));
+    memcpy(&me->timestamps[base], &timestamps[skip + first], (u64) (n - first) * sizeof(u64));
+
+    return;
+}
+
+
+/**
+ * @name    __boolean dbc_store_latest(dbc_store const * const me, u32 signal, f64* const value, u64* const timestamp_ns)
+ * 
+ * @brief   newest sample of a signal 
+ * 
+ * @param   dbc_store const * const : object pointer to the struct.
+ *          u32                     : signal 
+ *          f64* const              : returns the value 
+ *          u64* const              : returns the timestamp, may be NULLPTR
+ * 
+ * @return  __boolean : false if the signal was never decoded.
+ */
+__boolean dbc_store_latest(dbc_store const * const me, u32 signal, f64* const value, u64* const timestamp_ns)
+{
+    u64 index;
+
+    if ((me == NULLPTR) || (signal >= me->signal_count) || (me->counts[signal] == 0U))
+    {
+        return false;
+    }
+
+    index = ((u64) signal * me->depth) + ((me->counts[signal] - 1U) & me->mask);
+    *value = me->values[index];
+    if (timestamp_ns != NULLPTR)
+    {
+        *timestamp_ns = me->timestamps[index];
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    u64 dbc_store_count(dbc_store const * const me, u32 signal)
+ * 
+ * @brief   number of samples of a signal since init 
+ * 
+ * @param   dbc_store const * const : object pointer to the struct.
+ *          u32                     : signal 
+ * 
+ * @return  u64 : samples.
+ */
+u64 dbc_store_count(dbc_store const * const me, u32 signal)
+{
+    if ((me == NULLPTR) || (signal >= me->signal_count))
+    {
+        return 0U;
+    }
+
+    return me->counts[signal];
+}
+
+
+/**
+ * @name    static __boolean dbc_decoder_compile_op(dbc_signal const * const signal, u32 index, dbc_op* const op, u32* const end_byte)
+ * 
+ * @brief   resolves the bit position of a signal into word and shifts. Little endian 
+ *          signals are read from little endian payload words, big endian signals from 
+ *          byte swapped words in which the DBC MSB numbering becomes a plain bit index. 
+ * 
+ * @param   dbc_signal const * const : signal 
+ *          u32                      : index of the signal 
+ *          dbc_op* const            : compiled op 
+ *          u32* const               : returns the last payload byte of the signal 
+ * 
+ * @return  __boolean : false if the signal does not fit into a CAN FD payload.
+ */
+static __boolean dbc_decoder_compile_op(dbc_signal const * const signal, u32 index, dbc_op* const op, u32* const end_byte)
+{
+    u32 const length = signal->length;
+    u32 const start = signal->start_bit;
+
+    memset(op, 0, sizeof(*op));
+    op->factor      = signal->factor;
+    op->offset      = signal->offset;
+    op->signal      = index;
+    op->width_shift = (u8) (64U - length);
+    op->value_type  = signal->value_type;
+    op->mux_type    = signal->mux_type;
+    op->mux_value   = signal->mux_value;
+
+    if (signal->big_endian == false)
+    {
+        op->word  = (u8) (start / 64U);
+        op->shift = (u8) (start % 64U);
+        *end_byte = (start + length - 1U) / 8U;
+        if ((op->shift + length) > 64U)
+        {
+            op->flags |= DBC_OP_SPLIT;
+            op->spill  = (u8) (64U - op->shift);
+        }
+    }
+    else
+    {
+        // position of the MSB inside its byte swapped word, the LSB follows in stream order 
+        u32 const byte = start / 8U;
+        u32 const msb = (8U * (7U - (byte % 8U))) + (start % 8U);
+        u32 const msb_stream = (8U * byte) + (7U - (start % 8U));
+
+        op->flags |= DBC_OP_BIG_ENDIAN;
+        op->word   = (u8) (byte / 8U);
+        *end_byte  = (msb_stream + length - 1U) / 8U;
+        if ((msb + 1U) >= length)
+        {
+            op->shift = (u8) (msb + 1U - length);
+        }
+        else
+        {
+            op->flags |= DBC_OP_SPLIT;
+            op->spill  = (u8) (length - (msb + 1U));
+            op->shift  = (u8) (64U - op->spill);
+        }
+    }
+
+    if ((op->value_type == DBC_VALUE_FLOAT32) && (length != 32U))
+    {
+        return false;
+    }
+    if ((op->value_type == DBC_VALUE_FLOAT64) && (length != 64U))
+    {
+        return false;
+    }
+
+    return *end_byte < CAN_FRAME_MAX_DATA;
+}
+
+
+/**
+ * @name    static void dbc_decoder_decode_plan(dbc_decoder* const me, dbc_plan const * const plan, can_frame_rec const * const frames, u32 const * const order, u32 count, dbc_store* const store)
+ * 
+ * @brief   decodes the frames of one message. The payload words are gathered into 
+ *          columns once, then every op runs over all frames. Multiplexed signals keep 
+ *          the frames whose multiplexor matches.
+ * 
+ * @param   dbc_decoder* const          : object pointer to the struct.
+ *          dbc_plan const * const      : plan of the message 
+ *          can_frame_rec const * const : batch 
+ *          u32 const * const           : indexes of the frames of this message 
+ *          u32                         : number of frames 
+ *          dbc_store* const            : destination
+ * 
+ * @return  none.
+ */
+static void dbc_decoder_decode_plan(dbc_decoder* const me, dbc_plan const * const plan, can_frame_rec const * const frames, 
+                                    u32 const * const order, u32 count, dbc_store* const store)
+{
+    dbc_op const * const ops = &me->ops[plan->first_op];
+    u32 i;
+    u32 j;
+    u32 w;
+
+    for (j = 0U; j < count; ++j)
+    {
+        can_frame_rec const * const frame = &frames[order[j]];
+        me->timestamps[j] = frame->timestamp_ns;
+        for (w = 0U; w < plan->word_count; ++w)
+        {
+            me->le_words[w][j] = dbc_decoder_load_le(&frame->data[w * 8U]);
+        }
+    }
+
+    if (plan->big_endian != 0U)
+    {
+        for (w = 0U; w < plan->word_count; ++w)
+        {
+            for (j = 0U; j < count; ++j)
+            {
+                me->be_words[w][j] = __builtin_bswap64(me->le_words[w][j]);
+            }
+        }
+    }
+
+    if (plan->mux_op != DBC_DECODER_NO_MUX)
+    {
+        u32 const ws = ops[plan->mux_op].width_shift;
+        dbc_decoder_extract(me, &ops[plan->mux_op], count, me->mux);
+        for (j = 0U; j < count; ++j)
+        {
+            me->mux[j] = (me->mux[j] << ws) >> ws;
+        }
+    }
+
+    for (i = 0U; i < plan->op_count; ++i)
+    {
+        dbc_op const * const op = &ops[i];
+
+        dbc_decoder_extract(me, op, count, me->raw);
+        dbc_decoder_scale(op, me->raw, count, me->values);
+
+        if ((op->mux_type == DBC_MUX_MULTIPLEXED) && (plan->mux_op != DBC_DECODER_NO_MUX))
+        {
+            u32 n = 0U;
+            for (j = 0U; j < count; ++j)
+            {
+                if (me->mux[j] == op->mux_value)
+                {
+                    me->values[n]         = me->values[j];
+                    me->mux_timestamps[n] = me->timestamps[j];
+                    ++n;
+                }
+            }
+            if (n > 0U)
+            {
+                dbc_store_push(store, op->signal, me->values, me->mux_timestamps, n);
+            }
+        }
+        else
+        {
+            dbc_store_push(store, op->signal, me->values, me->timestamps, count);
+        }
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static void dbc_decoder_extract(dbc_decoder* const me, dbc_op const * const op, u32 count, u64* const raw)
+ * 
+ * @brief   raw value of one signal for all gathered frames. Each case is a branch free 
+ *          loop over a word column.
+ * 
+ * @param   dbc_decoder* const   : object pointer to the struct.
+ *          dbc_op const * const : op 
+ *          u32                  : number of frames 
+ *          u64* const           : returns the raw values, bits above the signal not cleared 
+ * 
+ * @return  none.
+ */
+static void dbc_decoder_extract(dbc_decoder* const me, dbc_op const * const op, u32 count, u64* const raw)
+{
+    u64 const (* const words)[DBC_DECODER_MAX_BATCH] = ((op->flags & DBC_OP_BIG_ENDIAN) != 0U) ? me->be_words : me->le_words;
+    u64 const * __restrict const w0 = words[op->word];
+    u64* __restrict const out = raw;
+    u32 const shift = op->shift;
+    u32 const spill = op->spill;
+    u32 j;
+
+    switch (op->flags & (DBC_OP_SPLIT | DBC_OP_BIG_ENDIAN))
+    {
+        case DBC_OP_SPLIT:
+        {
+            u64 const * __restrict const w1 = words[op->word + 1U];
+            for (j = 0U; j < count; ++j)
+            {
+                out[j] = (w0[j] >> shift) | (w1[j] << spill);
+            }
+            break;
+        }
+        case (DBC_OP_SPLIT | DBC_OP_BIG_ENDIAN):
+        {
+            u64 const * __restrict const w1 = words[op->word + 1U];
+            for (j = 0U; j < count; ++j)
+            {
+                out[j] = (w0[j] << spill) | (w1[j] >> shift);
+            }
+            break;
+        }
+        default:
+            for (j = 0U; j < count; ++j)
+            {
+                out[j] = w0[j] >> shift;
+            }
+            break;
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static void dbc_decoder_scale(dbc_op const * const op, u64 const * const raw, u32 count, f64* const values)
+ * 
+ * @brief   width and sign extension or float reinterpretation, then factor/offset for 
+ *          all frames
+ * 
+ * @param   dbc_op const * const : op 
+ *          u64 const * const    : raw values 
+ *          u32                  : number of frames 
+ *          f64* const           : returns the physical values 
+ * 
+ * @return  none.
+ */
+static void dbc_decoder_scale(dbc_op const * const op, u64 const * const raw, u32 count, f64* const values)
+{
+    u64 const * __restrict const in = raw;
+    f64* __restrict const out = values;
+    f64 const factor = op->factor;
+    f64 const offset = op->offset;
+    u32 const ws = op->width_shift;
+    u32 j;
+
+    switch (op->value_type)
+    {
+        case DBC_VALUE_SIGNED:
+            for (j = 0U; j < count; ++j)
+            {
+                out[j] = ((f64) ((s64) (in[j] << ws) >> ws) * factor) + offset;
+            }
+            break;
+        case DBC_VALUE_FLOAT32:
+            for (j = 0U; j < count; ++j)
+            {
+                u32 const bits = (u32) in[j];
+                float value;
+                memcpy(&value, &bits, sizeof(value));
+                out[j] = ((f64) value * factor) + offset;
+            }
+            break;
+        case DBC_VALUE_FLOAT64:
+            for (j = 0U; j < count; ++j)
+            {
+                f64 value;
+                memcpy(&value, &in[j], sizeof(value));
+                out[j] = (value * factor) + offset;
+            }
+            break;
+        default:
+            for (j = 0U; j < count; ++j)
+            {
+                out[j] = ((f64) ((in[j] << ws) >> ws) * factor) + offset;
+            }
+            break;
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static int dbc_decoder_compare_ext(void const * a, void const * b)
+ * 
+ * @brief   qsort order of the (ID << 32 | plan) pairs of extended IDs 
+ * 
+ * @param   void const * : first pair 
+ *          void const * : second pair
+ * 
+ * @return  int : <0, 0, >0.
+ */
+static int dbc_decoder_compare_ext(void const * a, void const * b)
+{
+    u64 const pair_a = *(u64 const *) a;
+    u64 const pair_b = *(u64 const *) b;
+    return (pair_a > pair_b) - (pair_a < pair_b);
+}
+
+
+/**
+ * @name    static inline u64 dbc_decoder_load_le(u8 const * const data)
+ * 
+ * @brief   unaligned little endian load of a payload word 
+ * 
+ * @param   u8 const * const : 8 payload bytes 
+ * 
+ * @return  u64 : word, byte 0 in the least significant bits.
+ */
+static inline u64 dbc_decoder_load_le(u8 const * const data)
+{
+    u64 word;
+
+    memcpy(&word, data, sizeof(word));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    word = __builtin_bswap64(word);
+#endif
+
+    return word;
+}
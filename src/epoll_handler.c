@@ -0,0 +1,335 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "utils.h"
+
+#define __EPOLL_HANDLER_H_
+#include "epoll_handler.h"
+
+/**
+ * @name    __boolean epoll_handler_init(epoll_handler* const me, u8 __id)
+ * 
+ * @brief   creates the epoll instance and its wake up eventfd 
+ * 
+ * @param   epoll_handler* const : object pointer to the struct.
+ *          u8                   : module id for the registration 
+ * 
+ * @return  __boolean            : true if success, false if something went wrong.
+ */
+__boolean epoll_handler_init(epoll_handler* const me, u8 __id)
+{
+    struct epoll_event ev;
+    u32 i;
+
+    CHECK_NULLPTR_RET(me);
+
+    memset(me, 0, sizeof(*me));
+    for (i = 0U; i < EPOLL_HANDLER_MAX_FDS; ++i)
+    {
+        me->entries[i].fd = -1;
+    }
+
+    me->epfd    = epoll_create1(EPOLL_CLOEXEC);
+    me->wake_fd = eventfd(0U, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = EPOLLIN;
+    ev.data.u64 = EPOLL_HANDLER_WAKE_SLOT;
+    if ((me->epfd < 0) || (me->wake_fd < 0) || (epoll_ctl(me->epfd, EPOLL_CTL_ADD, me->wake_fd, &ev) != 0))
+    {
+        if (me->epfd >= 0)
+        {
+            close(me->epfd);
+        }
+        if (me->wake_fd >= 0)
+        {
+            close(me->wake_fd);
+        }
+        me->epfd    = -1;
+        me->wake_fd = -1;
+        return false;
+    }
+
+    me->module_position = utils_register_module(EPOLL_HANDLER_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void epoll_handler_destruct(epoll_handler* const me)
+ * 
+ * @brief   closes the epoll instance, the registered fds stay open, they belong to 
+ *          their callers 
+ * 
+ * @param   epoll_handler* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void epoll_handler_destruct(epoll_handler* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->epfd < 0)
+    {
+        return;
+    }
+
+    close(me->wake_fd);
+    close(me->epfd);
+    me->epfd    = -1;
+    me->wake_fd = -1;
+    me->count   = 0U;
+
+    utils_remove_module_registration(me->module_position);
+
+    return;
+}
+
+
+/**
+ * @name    __boolean epoll_handler_add(epoll_handler* const me, int fd, u32 events, epoll_handler_callback callback, void* ctx)
+ * 
+ * @brief   watches a fd, level triggered unless events has EPOLLET 
+ * 
+ * @param   epoll_handler* const   : object pointer to the struct.
+ *          int                    : file descriptor, once per handler 
+ *          u32                    : EPOLLIN, EPOLLOUT, ...
+ *          epoll_handler_callback : called with ctx when the fd is ready 
+ *          void*                  : context of the callback 
+ * 
+ * @return  __boolean : false if the table is full, the fd is known or epoll refused it.
+ */
+__boolean epoll_handler_add(epoll_handler* const me, int fd, u32 events, epoll_handler_callback callback, void* ctx)
+{
+    epoll_handler_entry* entry = NULLPTR;
+    struct epoll_event ev;
+    u32 slot;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(callback);
+
+    if ((fd < 0) || (epoll_handler_find(me, fd) != NULLPTR))
+    {
+        return false;
+    }
+
+    for (slot = 0U; slot < EPOLL_HANDLER_MAX_FDS; ++slot)
+    {
+        if (me->entries[slot].fd < 0)
+        {
+            entry = &me->entries[slot];
+            break;
+        }
+    }
+
+    if (entry == NULLPTR)
+    {
+        return false;
+    }
+
+    entry->generation++;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = events;
+    ev.data.u64 = ((u64) entry->generation << 32U) | slot;
+    if (epoll_ctl(me->epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+    {
+        return false;
+    }
+
+    entry->fd       = fd;
+    entry->events   = events;
+    entry->callback = callback;
+    entry->ctx      = ctx;
+    me->count++;
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean epoll_handler_modify(epoll_handler* const me, int fd, u32 events)
+ * 
+ * @brief   changes the events a fd is watched for, no syscall if they are the same 
+ * 
+ * @param   epoll_handler* const : object pointer to the struct.
+ *          int                  : file descriptor 
+ *          u32                  : EPOLLIN, EPOLLOUT, ...
+ * 
+ * @return  __boolean : false if the fd is unknown or epoll refused the change.
+ */
+__boolean epoll_handler_modify(epoll_handler* const me, int fd, u32 events)
+{
+    epoll_handler_entry* entry;
+    struct epoll_event ev;
+
+    CHECK_NULLPTR_RET(me);
+
+    entry = epoll_handler_find(me, fd);
+    if (entry == NULLPTR)
+    {
+        return false;
+    }
+
+    if (entry->events == events)
+    {
+        return true;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = events;
+    ev.data.u64 = ((u64) entry->generation << 32U) | (u32) (entry - me->entries);
+    if (epoll_ctl(me->epfd, EPOLL_CTL_MOD, fd, &ev) != 0)
+    {
+        return false;
+    }
+    entry->events = events;
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean epoll_handler_remove(epoll_handler* const me, int fd)
+ * 
+ * @brief   stops watching a fd, may be called from a callback, also for other fds. 
+ *          Remove before close, epoll forgets a closed fd only with its last duplicate.
+ * 
+ * @param   epoll_handler* const : object pointer to the struct.
+ *          int                  : file descriptor 
+ * 
+ * @return  __boolean : false if the fd is unknown.
+ */
+__boolean epoll_handler_remove(epoll_handler* const me, int fd)
+{
+    epoll_handler_entry* entry;
+
+    CHECK_NULLPTR_RET(me);
+
+    entry = epoll_handler_find(me, fd);
+    if (entry == NULLPTR)
+    {
+        return false;
+    }
+
+    (void) epoll_ctl(me->epfd, EPOLL_CTL_DEL, fd, NULLPTR);
+    entry->fd       = -1;
+    entry->callback = NULLPTR;
+    entry->ctx      = NULLPTR;
+    entry->generation++;
+    me->count--;
+
+    return true;
+}
+
+
+/**
+ * @name    s32 epoll_handler_run_once(epoll_handler* const me, s32 timeout_ms)
+ * 
+ * @brief   waits up to timeout_ms and calls the callbacks of the ready fds 
+ * 
+ * @param   epoll_handler* const : object pointer to the struct.
+ *          s32                  : 0 to not wait, -1 forever
+ * 
+ * @return  s32 : number of callbacks, -1 on an epoll error other than EINTR.
+ */
+s32 epoll_handler_run_once(epoll_handler* const me, s32 timeout_ms)
+{
+    struct epoll_event events[EPOLL_HANDLER_MAX_EVENTS];
+    s32 dispatched = 0;
+    int n;
+    int i;
+
+    if ((me == NULLPTR) || (me->epfd < 0))
+    {
+        return -1;
+    }
+
+    n = epoll_wait(me->epfd, events, EPOLL_HANDLER_MAX_EVENTS, timeout_ms);
+    me->waits++;
+    if (n < 0)
+    {
+        return (errno == EINTR) ? 0 : -1;
+    }
+
+    for (i = 0; i < n; ++i)
+    {
+        u32 const slot = (u32) events[i].data.u64;
+        u32 const generation = (u32) (events[i].data.u64 >> 32U);
+        epoll_handler_entry* entry;
+        u64 value;
+
+        if (slot == EPOLL_HANDLER_WAKE_SLOT)
+        {
+            (void) read(me->wake_fd, &value, sizeof(value));
+            continue;
+        }
+
+        entry = &me->entries[slot];
+        if ((entry->fd < 0) || (entry->generation != generation))
+        {
+            continue;
+        }
+
+        entry->callback(entry->ctx, entry->fd, events[i].events);
+        dispatched++;
+    }
+    me->dispatched += (u64) dispatched;
+
+    return dispatched;
+}
+
+
+/**
+ * @name    void epoll_handler_wake(epoll_handler* const me)
+ * 
+ * @brief   ends the current or next wait of the loop, from any thread 
+ * 
+ * @param   epoll_handler* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void epoll_handler_wake(epoll_handler* const me)
+{
+    u64 const one = 1U;
+
+    CHECK_NULLPTR_VOID(me);
+
+    (void) write(me->wake_fd, &one, sizeof(one));
+
+    return;
+}
+
+
+/**
+ * @name    static epoll_handler_entry* epoll_handler_find(epoll_handler* const me, int fd)
+ * 
+ * @brief   slot of a fd
+ * 
+ * @param   epoll_handler* const : object pointer to the struct.
+ *          int                  : file descriptor 
+ * 
+ * @return  epoll_handler_entry* : slot, NULLPTR if the fd is not watched.
+ */
+static epoll_handler_entry* epoll_handler_find(epoll_handler* const me, int fd)
+{
+    u32 i;
+
+    if (fd < 0)
+    {
+        return NULLPTR;
+    }
+
+    for (i = 0U; i < EPOLL_HANDLER_MAX_FDS; ++i)
+    {
+        if (me->entries[i].fd == fd)
+        {
+            return &me->entries[i];
+        }
+    }
+
+    return NULLPTR;
+}
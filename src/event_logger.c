@@ -1,5 +1,129 @@
+#include <stdarg.h>
+#include <stdio.h>
 #include "utils.h"
-
+#include "log_history.h"
 
 #define __EVENT_LOGGER_H_
-#include "event_logger.h"
\ No newline at end of file
+#include "event_logger.h"
+
+/**
+ * @name    void event_logger_init(event_logger* const me, u8 __id, logging_type print_mask)
+ * 
+ * @brief   sets up a logger without persistent history
+ * 
+ * @param   event_logger* const : object pointer to the struct.
+ *          u8                  : module id of the owner, stored in every history record
+ *          logging_type        : events to be printed (LOG_EVENT_xxx)
+ * 
+ * @return  none.
+ */
+void event_logger_init(event_logger* const me, u8 __id, logging_type print_mask)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    module_position = utils_register_module(EVENT_LOGGER_MODULE_NAME, __id);
+
+    me->print_mask   = print_mask;
+    me->history_mask = 0U;
+    me->module_id    = __id;
+    me->history      = NULLPTR;
+
+    return;
+}
+
+
+/**
+ * @name    void event_logger_set_history(event_logger* const me, log_history* const history, logging_type history_mask)
+ * 
+ * @brief   attaches a persistent history, the history stays owned by the caller
+ * 
+ * @param   event_logger* const : object pointer to the struct.
+ *          log_history* const  : opened history, NULLPTR to detach
+ *          logging_type        : events to be kept in the history 
+ * 
+ * @return  none.
+ */
+void event_logger_set_history(event_logger* const me, log_history* const history, logging_type history_mask)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    me->history      = history;
+    me->history_mask = history_mask;
+
+    return;
+}
+
+
+/**
+ * @name    void event_logger_log(event_logger* const me, logging_type type, char const * const fmt, ...)
+ * 
+ * @brief   formats an event once and hands it to stdout and/or the history
+ * 
+ * @param   event_logger* const : object pointer to the struct.
+ *          logging_type        : type of the event (one LOG_EVENT_xxx)
+ *          char const * const  : printf like format 
+ * 
+ * @return  none.
+ */
+void event_logger_log(event_logger* const me, logging_type type, char const * const fmt, ...)
+{
+    char    msg[LOG_EVENT_MAX_MSG_LEN];
+    va_list args;
+    int     len;
+
+    CHECK_NULLPTR_VOID(me);
+    CHECK_NULLPTR_VOID(fmt);
+
+    if (((me->print_mask & type) == 0U) && 
+        ((me->history == NULLPTR) || ((me->history_mask & type) == 0U)))
+    {
+        return;
+    }
+
+    va_start(args, fmt);
+    len = vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+
+    if (len < 0)
+    {
+        return;
+    }
+    len = GET_MIN(len, (int) sizeof(msg) - 1);
+
+#ifdef RUNNING_OS
+    if ((me->print_mask & type) != 0U)
+    {
+        printf("[%s] %s\n", event_logger_type_name(type), msg);
+    }
+#endif /* RUNNING_OS */
+
+    if ((me->history != NULLPTR) && ((me->history_mask & type) != 0U))
+    {
+        (void) log_history_append(me->history, type, me->module_id, msg, (u16) len);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static inline char const * event_logger_type_name(logging_type type)
+ * 
+ * @brief   printable name of an event type 
+ * 
+ * @param   logging_type : type of the event 
+ * 
+ * @return  char const * : name of the type.
+ */
+static inline char const * event_logger_type_name(logging_type type)
+{
+    switch (type)
+    {
+        case LOG_EVENT_INFO:  return "INFO";
+        case LOG_EVENT_WARN:  return "WARN";
+        case LOG_EVENT_FATAL: return "FATAL";
+        case LOG_EVENT_DEBUG: return "DEBUG";
+        case LOG_EVENT_TRACE: return "TRACE";
+        default:              return "EVENT";
+    }
+}
@@ -0,0 +1,393 @@
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "checksum.h"
+
+#define __FLASH_SIM_H_
+#include "flash_sim.h"
+
+/**
+ * @name    __boolean flash_sim_open(flash_sim* const me, u8 __id, char const * const path, u32 page_size, u32 page_count, u32 write_unit)
+ * 
+ * @brief   opens (or creates) a simulated flash. A valid existing file keeps its contents
+ *          and geometry, a new one starts fully erased.
+ * 
+ * @param   flash_sim* const   : object pointer to the struct.
+ *          u8                 : module id for the registration
+ *          char const * const : path of the backing file, NULLPTR for anonymous memory
+ *          u32                : page (erase sector) size, power of two of at least 256
+ *          u32                : number of pages
+ *          u32                : program granularity, power of two up to 16
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean flash_sim_open(flash_sim* const me, u8 __id, char const * const path, u32 page_size, u32 page_count, u32 write_unit)
+{
+    struct stat st;
+    flash_sim_file hdr;
+    u64 data_offset;
+    __boolean format = true;
+
+    CHECK_NULLPTR_RET(me);
+
+    if ((FLASH_SIM_IS_POWER_OF_TWO(page_size) == false) || (page_size < 256U) || (page_count == 0U) ||
+        (FLASH_SIM_IS_POWER_OF_TWO(write_unit) == false) || (write_unit > FLASH_SIM_MAX_WRITE_UNIT))
+    {
+        return false;
+    }
+
+    memset(me, 0, sizeof(*me));
+    me->fd = -1;
+
+    if (path != NULLPTR)
+    {
+        me->fd = open(path, O_RDWR | O_CREAT, 0644);
+        if ((me->fd < 0) || (fstat(me->fd, &st) != 0))
+        {
+            flash_sim_close(me);
+            return false;
+        }
+
+        // adopt the geometry of a valid file, whatever was requested
+        if (((u64) st.st_size > FLASH_SIM_HEADER_SIZE) &&
+            (pread(me->fd, &hdr, sizeof(hdr), 0) == (ssize_t) sizeof(hdr)) &&
+            (flash_sim_header_valid(&hdr, (u64) st.st_size) == true))
+        {
+            page_size  = hdr.page_size;
+            page_count = hdr.page_count;
+            write_unit = hdr.write_unit;
+            format     = false;
+        }
+    }
+
+    data_offset  = (FLASH_SIM_HEADER_SIZE + ((u64) page_count * sizeof(u32)) + 4095U) & ~4095ULL;
+    me->map_size = data_offset + ((u64) page_count * page_size);
+
+    if ((me->fd >= 0) && (format == true) &&
+        ((ftruncate(me->fd, 0) != 0) || (posix_fallocate(me->fd, 0, (off_t) me->map_size) != 0)))
+    {
+        flash_sim_close(me);
+        return false;
+    }
+
+    me->map = (u8*) mmap(NULLPTR, me->map_size, PROT_READ | PROT_WRITE,
+                         (me->fd >= 0) ? MAP_SHARED : (MAP_PRIVATE | MAP_ANONYMOUS), me->fd, 0);
+    if ((void*) me->map == MAP_FAILED)
+    {
+        me->map = NULLPTR;
+        flash_sim_close(me);
+        return false;
+    }
+
+    me->data         = me->map + data_offset;
+    me->erase_counts = (u32*) (me->map + FLASH_SIM_HEADER_SIZE);
+    me->page_size    = page_size;
+    me->page_count   = page_count;
+    me->write_unit   = write_unit;
+    me->power_cut    = FLASH_SIM_NO_POWER_CUT;
+    me->powered      = true;
+
+    if (format == true)
+    {
+        flash_sim_format(me);
+    }
+
+    me->module_position = utils_register_module(FLASH_SIM_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void flash_sim_close(flash_sim* const me)
+ * 
+ * @brief   unmaps the flash, the file keeps its contents
+ * 
+ * @param   flash_sim* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void flash_sim_close(flash_sim* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->map != NULLPTR)
+    {
+        munmap(me->map, me->map_size);
+        me->map = NULLPTR;
+        utils_remove_module_registration(me->module_position);
+    }
+
+    if (me->fd >= 0)
+    {
+        close(me->fd);
+        me->fd = -1;
+    }
+
+    return;
+}
+
+
+/**
+ * @name    __boolean flash_sim_erase(flash_sim* const me, u32 page)
+ * 
+ * @brief   sets all bytes of a page to 0xFF and counts the erase cycle
+ * 
+ * @param   flash_sim* const : object pointer to the struct.
+ *          u32              : page index
+ * 
+ * @return  __boolean        : false for an invalid page or after a power cut.
+ */
+__boolean flash_sim_erase(flash_sim* const me, u32 page)
+{
+    CHECK_NULLPTR_RET(me);
+
+    if ((page >= me->page_count) || (me->powered == false))
+    {
+        return false;
+    }
+
+    memset(me->data + ((u64) page * me->page_size), FLASH_SIM_ERASED, me->page_size);
+    me->erase_counts[page]++;
+    me->stats.erases++;
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean flash_sim_program(flash_sim* const me, u32 page, u32 offset, void const * const data, u32 len)
+ * 
+ * @brief   programs bytes inside one page. Offset and length have to be multiples of
+ *          the write unit and no bit may go from 0 to 1, such a program is refused as a
+ *          whole. An armed power cut writes only the bytes left before it.
+ * 
+ * @param   flash_sim* const   : object pointer to the struct.
+ *          u32                : page index
+ *          u32                : offset inside the page
+ *          void const * const : data
+ *          u32                : number of bytes
+ * 
+ * @return  __boolean          : true if all bytes were programmed.
+ */
+__boolean flash_sim_program(flash_sim* const me, u32 page, u32 offset, void const * const data, u32 len)
+{
+    u8 const * const src = (u8 const *) data;
+    u8* dst;
+    u32 n;
+    u32 i;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(data);
+
+    if (me->powered == false)
+    {
+        return false;
+    }
+
+    if ((page >= me->page_count) || (((offset | len) & (me->write_unit - 1U)) != 0U) ||
+        (offset > me->page_size) || (len > (me->page_size - offset)))
+    {
+        me->stats.violations++;
+        return false;
+    }
+
+    dst = me->data + ((u64) page * me->page_size) + offset;
+    for (i = 0U; i < len; i++)
+    {
+        if ((dst[i] & src[i]) != src[i])
+        {
+            me->stats.violations++;
+            return false;
+        }
+    }
+
+    n = len;
+    if (me->power_cut != FLASH_SIM_NO_POWER_CUT)
+    {
+        n = (u32) GET_MIN((u64) len, me->power_cut);
+        me->power_cut -= n;
+    }
+
+    for (i = 0U; i < n; i++)
+    {
+        dst[i] &= src[i];
+    }
+    me->stats.programs++;
+    me->stats.bytes += n;
+
+    if (n < len)
+    {
+        me->powered = false;
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    u8 const * flash_sim_page(flash_sim const * const me, u32 page)
+ * 
+ * @brief   memory mapped contents of a page, reads need no call
+ * 
+ * @param   flash_sim const * const : object pointer to the struct.
+ *          u32                     : page index
+ * 
+ * @return  u8 const * : first byte of the page, NULLPTR for an invalid page.
+ */
+u8 const * flash_sim_page(flash_sim const * const me, u32 page)
+{
+    if ((me == NULLPTR) || (page >= me->page_count))
+    {
+        return NULLPTR;
+    }
+
+    return me->data + ((u64) page * me->page_size);
+}
+
+
+/**
+ * @name    u32 flash_sim_erase_count(flash_sim const * const me, u32 page)
+ * 
+ * @brief   erase cycles a page went through since the file was created
+ * 
+ * @param   flash_sim const * const : object pointer to the struct.
+ *          u32                     : page index
+ * 
+ * @return  u32 : erase cycles, 0 for an invalid page.
+ */
+u32 flash_sim_erase_count(flash_sim const * const me, u32 page)
+{
+    if ((me == NULLPTR) || (page >= me->page_count))
+    {
+        return 0U;
+    }
+
+    return me->erase_counts[page];
+}
+
+
+/**
+ * @name    __boolean flash_sim_sync(flash_sim* const me)
+ * 
+ * @brief   writes the mapping back to the file
+ * 
+ * @param   flash_sim* const : object pointer to the struct.
+ * 
+ * @return  __boolean        : true if success, also for anonymous memory.
+ */
+__boolean flash_sim_sync(flash_sim* const me)
+{
+    CHECK_NULLPTR_RET(me);
+
+    if (me->fd < 0)
+    {
+        return true;
+    }
+
+    return (msync(me->map, me->map_size, MS_SYNC) == 0);
+}
+
+
+/**
+ * @name    void flash_sim_arm_power_cut(flash_sim* const me, u64 bytes)
+ * 
+ * @brief   cuts the power after the given number of programmed bytes. Until
+ *          flash_sim_power_on() all erases and programs fail.
+ * 
+ * @param   flash_sim* const : object pointer to the struct.
+ *          u64              : bytes still programmed, FLASH_SIM_NO_POWER_CUT disarms
+ * 
+ * @return  none.
+ */
+void flash_sim_arm_power_cut(flash_sim* const me, u64 bytes)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    me->power_cut = bytes;
+
+    return;
+}
+
+
+/**
+ * @name    void flash_sim_power_on(flash_sim* const me)
+ * 
+ * @brief   restores the power after a cut, the contents stay as the cut left them
+ * 
+ * @param   flash_sim* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void flash_sim_power_on(flash_sim* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    me->powered   = true;
+    me->power_cut = FLASH_SIM_NO_POWER_CUT;
+
+    return;
+}
+
+
+/**
+ * @name    static __boolean flash_sim_header_valid(flash_sim_file const * const file, u64 map_size)
+ * 
+ * @brief   checks magic, version, checksum and that the geometry matches the file size
+ * 
+ * @param   flash_sim_file const * const : header to be checked
+ *          u64                          : size of the file
+ * 
+ * @return  __boolean : true if the header can be used.
+ */
+static __boolean flash_sim_header_valid(flash_sim_file const * const file, u64 map_size)
+{
+    if ((memcmp(file->magic, FLASH_SIM_MAGIC, sizeof(file->magic)) != 0) ||
+        (file->version != FLASH_SIM_VERSION) ||
+        (checksum_crc32c(file, offsetof(flash_sim_file, hdr_crc)) != file->hdr_crc))
+    {
+        return false;
+    }
+
+    if ((FLASH_SIM_IS_POWER_OF_TWO(file->page_size) == false) || (file->page_size < 256U) ||
+        (FLASH_SIM_IS_POWER_OF_TWO(file->write_unit) == false) || (file->write_unit > FLASH_SIM_MAX_WRITE_UNIT))
+    {
+        return false;
+    }
+
+    return (map_size == (file->data_offset + ((u64) file->page_count * file->page_size)));
+}
+
+
+/**
+ * @name    static void flash_sim_format(flash_sim* const me)
+ * 
+ * @brief   writes a fresh header and leaves all pages erased, as delivered from the factory
+ * 
+ * @param   flash_sim* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+static void flash_sim_format(flash_sim* const me)
+{
+    flash_sim_file* const file = (flash_sim_file*) me->map;
+
+    memset(me->map, 0, (size_t) (me->data - me->map));
+    memcpy(file->magic, FLASH_SIM_MAGIC, sizeof(file->magic));
+    file->version     = FLASH_SIM_VERSION;
+    file->page_size   = me->page_size;
+    file->page_count  = me->page_count;
+    file->write_unit  = me->write_unit;
+    file->data_offset = (u64) (me->data - me->map);
+    file->hdr_crc     = checksum_crc32c(file, offsetof(flash_sim_file, hdr_crc));
+
+    memset(me->data, FLASH_SIM_ERASED, (size_t) me->page_count * me->page_size);
+
+    return;
+}
@@ -0,0 +1,605 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "can_id_table.h"
+
+#define __FRAME_CACHE_H_
+#include "frame_cache.h"
+
+/**
+ * @name    __boolean frame_cache_open(frame_cache* const me, u8 __id, char const * const path, u32 ext_slots)
+ * 
+ * @brief   creates the cache for the RX thread. An existing file is formatted again, 
+ *          readers that still map it see every entry reset. A file of the right size 
+ *          is reset in place, resizing it would hand them SIGBUS.
+ * 
+ * @param   frame_cache* const : object pointer to the struct.
+ *          u8                 : module id for the registration 
+ *          char const * const : file, e.g. on /dev/shm; NULLPTR for a private mapping 
+ *          u32                : hash slots for 29 bit ids, power of two, 0 for the default
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean frame_cache_open(frame_cache* const me, u8 __id, char const * const path, u32 ext_slots)
+{
+    struct timespec ts;
+    struct stat st;
+    __boolean reset = false;
+
+    CHECK_NULLPTR_RET(me);
+
+    if (ext_slots == 0U)
+    {
+        ext_slots = FRAME_CACHE_DEFAULT_EXT_SLOTS;
+    }
+
+    if ((FRAME_CACHE_IS_POWER_OF_TWO(ext_slots) == false) || 
+        (ext_slots < FRAME_CACHE_MIN_EXT_SLOTS) || (ext_slots > FRAME_CACHE_MAX_EXT_SLOTS))
+    {
+        return false;
+    }
+
+    memset(me, 0, sizeof(*me));
+    me->fd = -1;
+    me->map_size = frame_cache_file_size(ext_slots);
+
+    if (path != NULLPTR)
+    {
+        me->fd = open(path, O_RDWR | O_CREAT, 0644);
+        if ((me->fd < 0) || (fstat(me->fd, &st) != 0))
+        {
+            frame_cache_close(me);
+            return false;
+        }
+        reset = ((u64) st.st_size == me->map_size);
+        if ((reset == false) && ((ftruncate(me->fd, 0) != 0) || (ftruncate(me->fd, (off_t) me->map_size) != 0)))
+        {
+            frame_cache_close(me);
+            return false;
+        }
+        me->file = (frame_cache_file*) mmap(NULLPTR, me->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, me->fd, 0);
+    }
+    else
+    {
+        me->file = (frame_cache_file*) mmap(NULLPTR, me->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if ((void*) me->file == MAP_FAILED)
+    {
+        me->file = NULLPTR;
+        frame_cache_close(me);
+        return false;
+    }
+
+    // a fresh file is zero filled, an existing one is cleared. Only the keys need their 
+    // free marker then.
+    if (reset == true)
+    {
+        memset(me->file, 0, me->map_size);
+    }
+    clock_gettime(CLOCK_REALTIME, &ts);
+    memcpy(me->file->magic, FRAME_CACHE_MAGIC, sizeof(me->file->magic));
+    me->file->version     = FRAME_CACHE_VERSION;
+    me->file->ext_slots   = ext_slots;
+    me->file->created_ns  = ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+    me->file->entry_size  = sizeof(frame_cache_entry);
+    me->file->group_count = (FRAME_CACHE_STD_IDS + ext_slots) / FRAME_CACHE_GROUP_SIZE;
+
+    (void) frame_cache_map(me, ext_slots);
+    memset(me->ext_keys, 0xFF, ext_slots * sizeof(u32));
+
+    me->read_only = false;
+    me->module_position = utils_register_module(FRAME_CACHE_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean frame_cache_open_read_only(frame_cache* const me, char const * const path)
+ * 
+ * @brief   maps the cache of another thread or process for reading 
+ * 
+ * @param   frame_cache* const : object pointer to the struct.
+ *          char const * const : file given to frame_cache_open()
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean frame_cache_open_read_only(frame_cache* const me, char const * const path)
+{
+    frame_cache_file hdr;
+    struct stat st;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(path);
+
+    memset(me, 0, sizeof(*me));
+    me->read_only = true;
+    me->fd = open(path, O_RDONLY);
+    if (me->fd < 0)
+    {
+        return false;
+    }
+
+    if ((fstat(me->fd, &st) != 0) || (pread(me->fd, &hdr, sizeof(hdr), 0) != (ssize_t) sizeof(hdr)) || 
+        (memcmp(hdr.magic, FRAME_CACHE_MAGIC, sizeof(hdr.magic)) != 0) || (hdr.version != FRAME_CACHE_VERSION) || 
+        (hdr.entry_size != sizeof(frame_cache_entry)) || (FRAME_CACHE_IS_POWER_OF_TWO(hdr.ext_slots) == false) || 
+        (hdr.ext_slots > FRAME_CACHE_MAX_EXT_SLOTS) || ((u64) st.st_size != frame_cache_file_size(hdr.ext_slots)))
+    {
+        frame_cache_close(me);
+        return false;
+    }
+
+    me->map_size = (u64) st.st_size;
+    me->file = (frame_cache_file*) mmap(NULLPTR, me->map_size, PROT_READ, MAP_SHARED, me->fd, 0);
+    if ((void*) me->file == MAP_FAILED)
+    {
+        me->file = NULLPTR;
+        frame_cache_close(me);
+        return false;
+    }
+
+    return frame_cache_map(me, hdr.ext_slots);
+}
+
+
+/**
+ * @name    void frame_cache_close(frame_cache* const me)
+ * 
+ * @brief   unmaps the cache, the file stays for readers that still use it 
+ * 
+ * @param   frame_cache* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void frame_cache_close(frame_cache* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->file != NULLPTR)
+    {
+        munmap(me->file, me->map_size);
+        if (me->read_only == false)
+        {
+            utils_remove_module_registration(me->module_position);
+        }
+    }
+
+    if (me->fd >= 0)
+    {
+        close(me->fd);
+    }
+
+    me->fd   = -1;
+    me->file = NULLPTR;
+
+    return;
+}
+
+
+/**
+ * @name    __boolean frame_cache_update(frame_cache* const me, can_frame_rec const * const frame)
+ * 
+ * @brief   stores a received frame as the latest one of its id. Only the RX thread 
+ *          calls this, the seqlock makes concurrent readers retry instead of waiting.
+ * 
+ * @param   frame_cache* const          : object pointer to the struct.
+ *          can_frame_rec const * const : frame, error and RTR frames are not stored 
+ * 
+ * @return  __boolean : false if the frame was not stored.
+ */
+__boolean frame_cache_update(frame_cache* const me, can_frame_rec const * const frame)
+{
+    frame_cache_entry* entry;
+    __boolean changed;
+    u32 seq;
+    u32 next;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frame);
+
+    if (((frame->can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG)) != 0U) || (frame->len > CAN_FRAME_MAX_DATA))
+    {
+        return false;
+    }
+
+    entry = frame_cache_slot(me, frame->can_id);
+    if (entry == NULLPTR)
+    {
+        return false;
+    }
+
+    // the writer is alone, its own entry can be compared without the seqlock 
+    seq = entry->seq;
+    changed = (seq == 0U) || (entry->frame.len != frame->len) || 
+              (memcmp(entry->frame.data, frame->data, frame->len) != 0);
+
+    // 0 means never received, a wrapping sequence skips it 
+    next = seq + 2U;
+    if (next == 0U)
+    {
+        next = 2U;
+    }
+
+    __atomic_store_n(&entry->seq, seq + 1U, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(&entry->frame, frame, __builtin_offsetof(can_frame_rec, data) + frame->len);
+    if (changed == true)
+    {
+        entry->changes++;
+    }
+
+    __atomic_store_n(&entry->seq, next, __ATOMIC_RELEASE);
+
+    if (changed == true)
+    {
+        u32 const group = (CAN_FRAME_IS_EXT(frame->can_id) == true) ? 
+                          ((FRAME_CACHE_STD_IDS + (u32) (entry - me->ext)) / FRAME_CACHE_GROUP_SIZE) : 
+                          ((frame->can_id & CAN_SFF_MASK) / FRAME_CACHE_GROUP_SIZE);
+
+        __atomic_store_n(&me->groups[group], me->groups[group] + 1U, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&me->file->updates, me->file->updates + 1U, __ATOMIC_RELAXED);
+
+    return true;
+}
+
+
+/**
+ * @name    u32 frame_cache_update_batch(frame_cache* const me, can_frame_rec const * const frames, u32 count)
+ * 
+ * @brief   frame_cache_update() for a receive batch 
+ * 
+ * @param   frame_cache* const          : object pointer to the struct.
+ *          can_frame_rec const * const : frames 
+ *          u32                         : number of frames 
+ * 
+ * @return  u32 : number of frames stored.
+ */
+u32 frame_cache_update_batch(frame_cache* const me, can_frame_rec const * const frames, u32 count)
+{
+    u32 stored = 0U;
+    u32 i;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frames);
+
+    for (i = 0U; i < count; ++i)
+    {
+        stored += (frame_cache_update(me, &frames[i]) == true) ? 1U : 0U;
+    }
+
+    return stored;
+}
+
+
+/**
+ * @name    __boolean frame_cache_read(frame_cache const * const me, u32 can_id, can_frame_rec* const frame, u64* const changes)
+ * 
+ * @brief   consistent copy of the latest frame of an id, from any thread or process 
+ * 
+ * @param   frame_cache const * const : object pointer to the struct.
+ *          u32                       : id in kernel layout 
+ *          can_frame_rec* const      : copy of the frame 
+ *          u64* const                : payload changes of the id so far, may be NULLPTR
+ * 
+ * @return  __boolean : false if the id was never received.
+ */
+__boolean frame_cache_read(frame_cache const * const me, u32 can_id, can_frame_rec* const frame, u64* const changes)
+{
+    frame_cache_entry const * entry;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frame);
+
+    entry = frame_cache_find(me, can_id);
+    if (entry == NULLPTR)
+    {
+        return false;
+    }
+
+    return frame_cache_copy(entry, frame, changes);
+}
+
+
+/**
+ * @name    __boolean frame_cache_cursor_init(frame_cache const * const me, frame_cache_cursor* const cursor)
+ * 
+ * @brief   cursor that has seen nothing yet, the first poll visits every known id 
+ * 
+ * @param   frame_cache const * const : object pointer to the struct.
+ *          frame_cache_cursor* const : cursor 
+ * 
+ * @return  __boolean : true if success, false if something went wrong.
+ */
+__boolean frame_cache_cursor_init(frame_cache const * const me, frame_cache_cursor* const cursor)
+{
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(cursor);
+
+    cursor->group_count = me->group_count;
+    cursor->groups  = (u64*) calloc(me->group_count, sizeof(u64));
+    cursor->changes = (u64*) calloc((size_t) me->group_count * FRAME_CACHE_GROUP_SIZE, sizeof(u64));
+
+    if ((cursor->groups == NULLPTR) || (cursor->changes == NULLPTR))
+    {
+        frame_cache_cursor_destruct(cursor);
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    void frame_cache_cursor_destruct(frame_cache_cursor* const cursor)
+ * 
+ * @brief   frees a cursor 
+ * 
+ * @param   frame_cache_cursor* const : cursor 
+ * 
+ * @return  none.
+ */
+void frame_cache_cursor_destruct(frame_cache_cursor* const cursor)
+{
+    CHECK_NULLPTR_VOID(cursor);
+
+    free(cursor->groups);
+    free(cursor->changes);
+    cursor->groups  = NULLPTR;
+    cursor->changes = NULLPTR;
+
+    return;
+}
+
+
+/**
+ * @name    u32 frame_cache_poll(frame_cache const * const me, frame_cache_cursor* const cursor, frame_cache_visit visit, void* const ctx)
+ * 
+ * @brief   visits the ids whose payload changed since the last poll of the cursor. 
+ *          Groups whose counter did not move are skipped with one load, inside a 
+ *          moved group only the entries with a new change count are copied.
+ * 
+ * @param   frame_cache const * const : object pointer to the struct.
+ *          frame_cache_cursor* const : cursor of the reader 
+ *          frame_cache_visit         : called with a consistent copy of every changed id
+ *          void* const               : passed to visit 
+ * 
+ * @return  u32 : number of ids visited.
+ */
+u32 frame_cache_poll(frame_cache const * const me, frame_cache_cursor* const cursor, frame_cache_visit visit, void* const ctx)
+{
+    can_frame_rec frame;
+    u32 visited = 0U;
+    u32 g;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(cursor);
+    CHECK_NULLPTR_RET(visit);
+
+    for (g = 0U; g < cursor->group_count; ++g)
+    {
+        u64 const current = __atomic_load_n(&me->groups[g], __ATOMIC_ACQUIRE);
+        u32 k;
+
+        if (current == cursor->groups[g])
+        {
+            continue;
+        }
+        cursor->groups[g] = current;
+
+        for (k = 0U; k < FRAME_CACHE_GROUP_SIZE; ++k)
+        {
+            u32 const pos = (g * FRAME_CACHE_GROUP_SIZE) + k;
+            frame_cache_entry const * entry;
+            u64 changes;
+
+            if (pos < FRAME_CACHE_STD_IDS)
+            {
+                entry = &me->std[pos];
+            }
+            else
+            {
+                if (__atomic_load_n(&me->ext_keys[pos - FRAME_CACHE_STD_IDS], __ATOMIC_ACQUIRE) == FRAME_CACHE_KEY_FREE)
+                {
+                    continue;
+                }
+                entry = &me->ext[pos - FRAME_CACHE_STD_IDS];
+            }
+
+            if ((__atomic_load_n(&entry->changes, __ATOMIC_RELAXED) == cursor->changes[pos]) || 
+                (frame_cache_copy(entry, &frame, &changes) == false) || (changes == cursor->changes[pos]))
+            {
+                continue;
+            }
+
+            cursor->changes[pos] = changes;
+            visit(ctx, &frame, changes);
+            visited++;
+        }
+    }
+
+    return visited;
+}
+
+
+/**
+ * @name    static __boolean frame_cache_map(frame_cache* const me, u32 ext_slots)
+ * 
+ * @brief   sets the pointers into a mapped file 
+ * 
+ * @param   frame_cache* const : object pointer to the struct.
+ *          u32                : hash slots of the file 
+ * 
+ * @return  __boolean : true.
+ */
+static __boolean frame_cache_map(frame_cache* const me, u32 ext_slots)
+{
+    u8* const base = (u8*) me->file;
+    u64 const keys = FRAME_CACHE_HEADER_SIZE + ((u64) FRAME_CACHE_STD_IDS * sizeof(frame_cache_entry));
+
+    me->groups      = (u64*) &base[FRAME_CACHE_GROUPS_OFFSET];
+    me->std         = (frame_cache_entry*) &base[FRAME_CACHE_HEADER_SIZE];
+    me->ext_keys    = (u32*) &base[keys];
+    me->ext         = (frame_cache_entry*) &base[keys + ((((u64) ext_slots * sizeof(u32)) + 63U) & ~63ULL)];
+    me->ext_mask    = ext_slots - 1U;
+    me->group_count = (FRAME_CACHE_STD_IDS + ext_slots) / FRAME_CACHE_GROUP_SIZE;
+
+    return true;
+}
+
+
+/**
+ * @name    static u64 frame_cache_file_size(u32 ext_slots)
+ * 
+ * @brief   size of a cache file 
+ * 
+ * @param   u32 : hash slots 
+ * 
+ * @return  u64 : bytes.
+ */
+static u64 frame_cache_file_size(u32 ext_slots)
+{
+    return FRAME_CACHE_HEADER_SIZE + ((u64) FRAME_CACHE_STD_IDS * sizeof(frame_cache_entry)) + 
+           ((((u64) ext_slots * sizeof(u32)) + 63U) & ~63ULL) + ((u64) ext_slots * sizeof(frame_cache_entry));
+}
+
+
+/**
+ * @name    static frame_cache_entry* frame_cache_slot(frame_cache* const me, u32 can_id)
+ * 
+ * @brief   entry of an id for the writer, 29 bit ids get a hash slot on first sight. 
+ *          The key is published after the entry exists, readers never find a slot 
+ *          of another id. The hash is kept at most 3/4 full.
+ * 
+ * @param   frame_cache* const : object pointer to the struct.
+ *          u32                : id in kernel layout 
+ * 
+ * @return  frame_cache_entry* : entry, NULLPTR if the hash is full.
+ */
+static frame_cache_entry* frame_cache_slot(frame_cache* const me, u32 can_id)
+{
+    u32 id;
+    u32 slot;
+
+    if (CAN_FRAME_IS_EXT(can_id) == false)
+    {
+        return &me->std[can_id & CAN_SFF_MASK];
+    }
+
+    id   = can_id & CAN_EFF_MASK;
+    slot = can_id_table_hash(id) & me->ext_mask;
+    while (me->ext_keys[slot] != FRAME_CACHE_KEY_FREE)
+    {
+        if (me->ext_keys[slot] == id)
+        {
+            return &me->ext[slot];
+        }
+        slot = (slot + 1U) & me->ext_mask;
+    }
+
+    if (((me->file->ext_count + 1U) * 4U) > ((me->ext_mask + 1U) * 3U))
+    {
+        me->file->ext_dropped++;
+        return NULLPTR;
+    }
+
+    __atomic_store_n(&me->ext_keys[slot], id, __ATOMIC_RELEASE);
+    me->file->ext_count++;
+
+    return &me->ext[slot];
+}
+
+
+/**
+ * @name    static frame_cache_entry const * frame_cache_find(frame_cache const * const me, u32 can_id)
+ * 
+ * @brief   entry of an id for readers 
+ * 
+ * @param   frame_cache const * const : object pointer to the struct.
+ *          u32                       : id in kernel layout 
+ * 
+ * @return  frame_cache_entry const * : entry, NULLPTR if the id has none.
+ */
+static frame_cache_entry const * frame_cache_find(frame_cache const * const me, u32 can_id)
+{
+    u32 id;
+    u32 slot;
+    u32 key;
+
+    if (CAN_FRAME_IS_EXT(can_id) == false)
+    {
+        return &me->std[can_id & CAN_SFF_MASK];
+    }
+
+    id   = can_id & CAN_EFF_MASK;
+    slot = can_id_table_hash(id) & me->ext_mask;
+    while ((key = __atomic_load_n(&me->ext_keys[slot], __ATOMIC_ACQUIRE)) != FRAME_CACHE_KEY_FREE)
+    {
+        if (key == id)
+        {
+            return &me->ext[slot];
+        }
+        slot = (slot + 1U) & me->ext_mask;
+    }
+
+    return NULLPTR;
+}
+
+
+/**
+ * @name    static __boolean frame_cache_copy(frame_cache_entry const * const entry, can_frame_rec* const frame, u64* const changes)
+ * 
+ * @brief   seqlock read side: copies until the sequence was even and unchanged 
+ *          around the copy
+ * 
+ * @param   frame_cache_entry const * const : entry 
+ *          can_frame_rec* const            : copy of the frame 
+ *          u64* const                      : copy of the change count, may be NULLPTR 
+ * 
+ * @return  __boolean : false if the entry was never written.
+ */
+static __boolean frame_cache_copy(frame_cache_entry const * const entry, can_frame_rec* const frame, u64* const changes)
+{
+    u64 count;
+
+    for (;;)
+    {
+        u32 const seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+
+        if (seq == 0U)
+        {
+            return false;
+        }
+
+        if ((seq & 1U) != 0U)
+        {
+            utils_cpu_relax();
+            continue;
+        }
+
+        memcpy(frame, &entry->frame, sizeof(*frame));
+        count = entry->changes;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&entry->seq, __ATOMIC_RELAXED) == seq)
+        {
+            break;
+        }
+    }
+
+    if (changes != NULLPTR)
+    {
+        *changes = count;
+    }
+
+    return true;
+}
@@ -0,0 +1,552 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "capture.h"
+#include "can_socket.h"
+#include "replay.h"
+
+#define __FRAME_MERGE_H_
+#include "frame_merge.h"
+
+/**
+ * @name    __boolean frame_merge_init(frame_merge* const me, u8 __id, u64 window_ns)
+ * 
+ * @brief   creates a merge without sources
+ * 
+ * @param   frame_merge* const : object pointer to the struct.
+ *          u8                 : module id for the registration
+ *          u64                : reorder window in ns for live rings, 0 for the default
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean frame_merge_init(frame_merge* const me, u8 __id, u64 window_ns)
+{
+    CHECK_NULLPTR_RET(me);
+
+    memset(me, 0, sizeof(*me));
+    me->window_ns = (window_ns != 0U) ? window_ns : FRAME_MERGE_DEFAULT_WINDOW_NS;
+    me->module_position = utils_register_module(FRAME_MERGE_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void frame_merge_destruct(frame_merge* const me)
+ * 
+ * @brief   gives the frames of the last batch back and frees the decode buffers. Rings
+ *          and files stay open, they belong to the caller.
+ * 
+ * @param   frame_merge* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void frame_merge_destruct(frame_merge* const me)
+{
+    u32 i;
+
+    CHECK_NULLPTR_VOID(me);
+
+    frame_merge_release(me);
+
+    for (i = 0U; i < me->source_count; i++)
+    {
+        free(me->sources[i].buffer);
+        me->sources[i].buffer = NULLPTR;
+    }
+    me->source_count = 0U;
+
+    utils_remove_module_registration(me->module_position);
+
+    return;
+}
+
+
+/**
+ * @name    u32 frame_merge_add_ring(frame_merge* const me, frame_ring* const ring)
+ * 
+ * @brief   adds a live ring, the merge becomes its only consumer
+ * 
+ * @param   frame_merge* const : object pointer to the struct.
+ *          frame_ring* const  : ring in timestamp order, e.g. filled by one RX thread
+ * 
+ * @return  u32 : source index, FRAME_MERGE_NONE if all sources are used.
+ */
+u32 frame_merge_add_ring(frame_merge* const me, frame_ring* const ring)
+{
+    frame_merge_source* source;
+
+    if ((me == NULLPTR) || (ring == NULLPTR) || (me->source_count == FRAME_MERGE_MAX_SOURCES))
+    {
+        return FRAME_MERGE_NONE;
+    }
+
+    source = &me->sources[me->source_count];
+    memset(source, 0, sizeof(*source));
+    source->type = FRAME_MERGE_SOURCE_RING;
+    source->bus  = FRAME_MERGE_KEEP_BUS;
+    source->ring = ring;
+
+    return me->source_count++;
+}
+
+
+/**
+ * @name    u32 frame_merge_add_file(frame_merge* const me, replay_source* const file, u8 bus)
+ * 
+ * @brief   adds an opened capture segment or candump log. Frames are decoded in batches,
+ *          a batch is sorted by time so the interleaving of a capture written from
+ *          several rings is undone as far as it fits into the batch.
+ * 
+ * @param   frame_merge* const   : object pointer to the struct.
+ *          replay_source* const : opened source, read by the merge from now on
+ *          u8                   : bus of its frames, FRAME_MERGE_KEEP_BUS for the recorded one
+ * 
+ * @return  u32 : source index, FRAME_MERGE_NONE if out of sources or memory.
+ */
+u32 frame_merge_add_file(frame_merge* const me, replay_source* const file, u8 bus)
+{
+    frame_merge_source* source;
+
+    if ((me == NULLPTR) || (file == NULLPTR) || (me->source_count == FRAME_MERGE_MAX_SOURCES))
+    {
+        return FRAME_MERGE_NONE;
+    }
+
+    source = &me->sources[me->source_count];
+    memset(source, 0, sizeof(*source));
+    source->buffer = (can_frame_rec*) malloc(FRAME_MERGE_FILE_BATCH * sizeof(can_frame_rec));
+    if (source->buffer == NULLPTR)
+    {
+        return FRAME_MERGE_NONE;
+    }
+
+    source->type   = FRAME_MERGE_SOURCE_FILE;
+    source->bus    = bus;
+    source->file   = file;
+    source->window = source->buffer;
+
+    return me->source_count++;
+}
+
+
+/**
+ * @name    void frame_merge_finish(frame_merge* const me, u32 source)
+ * 
+ * @brief   marks the producer of a ring as done, the merge no longer waits for it
+ *          once it is empty
+ * 
+ * @param   frame_merge* const : object pointer to the struct.
+ *          u32                : source index
+ * 
+ * @return  none.
+ */
+void frame_merge_finish(frame_merge* const me, u32 source)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (source < me->source_count)
+    {
+        __atomic_store_n(&me->sources[source].finished, true, __ATOMIC_RELEASE);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    u32 frame_merge_next(frame_merge* const me, can_frame_rec const ** const frames, u32 max, u64 now_ns)
+ * 
+ * @brief   gives the previous batch back and returns the next frames in timestamp order.
+ *          The batch ends early where a source has to be refilled first, or where an
+ *          empty live ring may still deliver an older frame.
+ * 
+ * @param   frame_merge* const          : object pointer to the struct.
+ *          can_frame_rec const ** const : returns pointers to the frames, valid until the
+ *                                        next call or frame_merge_release()
+ *          u32                         : maximum number of frames
+ *          u64                         : now in the clock of the timestamps,
+ *                                        FRAME_MERGE_OFFLINE to never wait
+ * 
+ * @return  u32 : number of frames, 0 if nothing can be emitted yet.
+ */
+u32 frame_merge_next(frame_merge* const me, can_frame_rec const ** const frames, u32 max, u64 now_ns)
+{
+    u64 wait_key;
+    u32 count = 0U;
+    u32 i;
+
+    if ((me == NULLPTR) || (frames == NULLPTR) || (me->source_count == 0U))
+    {
+        return 0U;
+    }
+
+    frame_merge_release(me);
+
+    wait_key = FRAME_MERGE_KEY_WAIT((now_ns > me->window_ns) ? (now_ns - me->window_ns) : 0U);
+    if (now_ns == FRAME_MERGE_OFFLINE)
+    {
+        wait_key = FRAME_MERGE_KEY_END - 1U;
+    }
+
+    for (i = 0U; i < me->source_count; i++)
+    {
+        frame_merge_refill(&me->sources[i]);
+        me->keys[i] = frame_merge_key(&me->sources[i], wait_key);
+    }
+    frame_merge_build(me);
+
+    while (count < max)
+    {
+        u32 const winner = me->tree[0];
+        u64 const key = me->keys[winner];
+        frame_merge_source* const source = &me->sources[winner];
+        can_frame_rec const * frame;
+
+        // only frames have odd keys below the end
+        if (((key & 1U) == 0U) || (key == FRAME_MERGE_KEY_END))
+        {
+            if ((key != FRAME_MERGE_KEY_REFILL) && (key != FRAME_MERGE_KEY_END))
+            {
+                me->stats.waits++;
+            }
+            break;
+        }
+
+        frame = &source->window[source->pos++];
+        frames[count++] = frame;
+        source->frames++;
+
+        if (frame->timestamp_ns < me->last_ns)
+        {
+            source->late++;
+            me->stats.late++;
+        }
+        else
+        {
+            me->last_ns = frame->timestamp_ns;
+        }
+
+        me->keys[winner] = frame_merge_key(source, wait_key);
+        frame_merge_replay(me, winner);
+    }
+
+    if (count != 0U)
+    {
+        me->stats.frames += count;
+        me->stats.batches++;
+    }
+
+    return count;
+}
+
+
+/**
+ * @name    void frame_merge_release(frame_merge* const me)
+ * 
+ * @brief   gives the frames of the last batch back to their rings and decode buffers
+ * 
+ * @param   frame_merge* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void frame_merge_release(frame_merge* const me)
+{
+    u32 i;
+
+    CHECK_NULLPTR_VOID(me);
+
+    for (i = 0U; i < me->source_count; i++)
+    {
+        frame_merge_source* const source = &me->sources[i];
+
+        if (source->pos == 0U)
+        {
+            continue;
+        }
+
+        if (source->type == FRAME_MERGE_SOURCE_RING)
+        {
+            frame_ring_release(source->ring, source->pos);
+            source->count = 0U;
+        }
+        else
+        {
+            source->count -= source->pos;
+            memmove(source->buffer, &source->buffer[source->pos], source->count * sizeof(can_frame_rec));
+        }
+        source->pos = 0U;
+    }
+
+    return;
+}
+
+
+/**
+ * @name    __boolean frame_merge_done(frame_merge const * const me)
+ * 
+ * @brief   tells whether all sources are finished and drained
+ * 
+ * @param   frame_merge const * const : object pointer to the struct.
+ * 
+ * @return  __boolean : true if no frame will come anymore.
+ */
+__boolean frame_merge_done(frame_merge const * const me)
+{
+    u32 i;
+
+    CHECK_NULLPTR_RET(me);
+
+    for (i = 0U; i < me->source_count; i++)
+    {
+        frame_merge_source const * const source = &me->sources[i];
+
+        if ((__atomic_load_n(&source->finished, __ATOMIC_ACQUIRE) == false) || (source->pos < source->count) ||
+            ((source->type == FRAME_MERGE_SOURCE_RING) && (frame_ring_count(source->ring) > source->pos)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    void frame_merge_get_stats(frame_merge const * const me, frame_merge_stats* const stats)
+ * 
+ * @brief   copies the counters
+ * 
+ * @param   frame_merge const * const : object pointer to the struct.
+ *          frame_merge_stats* const  : returns the counters
+ * 
+ * @return  none.
+ */
+void frame_merge_get_stats(frame_merge const * const me, frame_merge_stats* const stats)
+{
+    CHECK_NULLPTR_VOID(me);
+    CHECK_NULLPTR_VOID(stats);
+
+    *stats = me->stats;
+
+    return;
+}
+
+
+/*****************************************************************************************
+*****************************************************************************************
+***             --- PRIVATE FUNCTIONS
+*****************************************************************************************
+****************************************************************************************/
+
+/**
+ * @name    static void frame_merge_refill(frame_merge_source* const source)
+ * 
+ * @brief   start of a batch: a ring shows all contiguous frames, a file decodes up to a
+ *          full buffer and sorts the new frames in behind the kept ones
+ * 
+ * @param   frame_merge_source* const : source
+ * 
+ * @return  none.
+ */
+static void frame_merge_refill(frame_merge_source* const source)
+{
+    u32 const kept = source->count;
+    u32 i;
+
+    if (source->type == FRAME_MERGE_SOURCE_RING)
+    {
+        source->count = frame_ring_peek(source->ring, &source->window, frame_ring_capacity(source->ring));
+        return;
+    }
+
+    while ((source->finished == false) && (source->count < FRAME_MERGE_FILE_BATCH))
+    {
+        can_frame_rec* const frame = &source->buffer[source->count];
+
+        if (replay_source_next(source->file, frame) == false)
+        {
+            source->finished = true;
+            break;
+        }
+
+        if (source->bus != FRAME_MERGE_KEEP_BUS)
+        {
+            frame->bus = source->bus;
+        }
+        source->count++;
+    }
+
+    // insertion sort, the frames are nearly ordered and kept ones were sorted already
+    for (i = GET_MAX(kept, 1U); i < source->count; i++)
+    {
+        u32 k = i;
+
+        if (source->buffer[k - 1U].timestamp_ns <= source->buffer[k].timestamp_ns)
+        {
+            continue;
+        }
+
+        {
+            can_frame_rec const frame = source->buffer[i];
+
+            while ((k > 0U) && (source->buffer[k - 1U].timestamp_ns > frame.timestamp_ns))
+            {
+                source->buffer[k] = source->buffer[k - 1U];
+                k--;
+            }
+            source->buffer[k] = frame;
+        }
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static u64 frame_merge_key(frame_merge_source* const source, u64 wait_key)
+ * 
+ * @brief   tree key of the next frame of a source. A ring window that ran out is
+ *          extended when the producer added frames behind it.
+ * 
+ * @param   frame_merge_source* const : source
+ *          u64                       : key of an empty live ring
+ * 
+ * @return  u64 : key.
+ */
+static u64 frame_merge_key(frame_merge_source* const source, u64 wait_key)
+{
+    if (source->pos < source->count)
+    {
+        return FRAME_MERGE_KEY_FRAME(source->window[source->pos].timestamp_ns);
+    }
+
+    if (source->type == FRAME_MERGE_SOURCE_FILE)
+    {
+        return (source->finished == true) ? FRAME_MERGE_KEY_END : FRAME_MERGE_KEY_REFILL;
+    }
+
+    // the tail did not move since the batch started, peek sees the same window
+    source->count = frame_ring_peek(source->ring, &source->window, frame_ring_capacity(source->ring));
+    if (source->pos < source->count)
+    {
+        return FRAME_MERGE_KEY_FRAME(source->window[source->pos].timestamp_ns);
+    }
+
+    // frames behind the end of the ring storage need a release first
+    if (frame_ring_count(source->ring) > source->pos)
+    {
+        return FRAME_MERGE_KEY_REFILL;
+    }
+
+    return (__atomic_load_n(&source->finished, __ATOMIC_ACQUIRE) == true) ? FRAME_MERGE_KEY_END : wait_key;
+}
+
+
+/**
+ * @name    static void frame_merge_build(frame_merge* const me)
+ * 
+ * @brief   builds the loser tree bottom up, leaves beyond the sources are drained ones
+ * 
+ * @param   frame_merge* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+static void frame_merge_build(frame_merge* const me)
+{
+    u32 winners[2U * FRAME_MERGE_MAX_SOURCES];
+    u32 i;
+    u32 node;
+
+    me->leaves = 1U;
+    while (me->leaves < me->source_count)
+    {
+        me->leaves <<= 1U;
+    }
+
+    for (i = 0U; i < me->leaves; i++)
+    {
+        if (i >= me->source_count)
+        {
+            me->keys[i] = FRAME_MERGE_KEY_END;
+        }
+        winners[me->leaves + i] = i;
+    }
+
+    for (node = me->leaves - 1U; node > 0U; node--)
+    {
+        u32 const left  = winners[2U * node];
+        u32 const right = winners[(2U * node) + 1U];
+
+        if (frame_merge_less(me, left, right) == true)
+        {
+            winners[node]  = left;
+            me->tree[node] = right;
+        }
+        else
+        {
+            winners[node]  = right;
+            me->tree[node] = left;
+        }
+    }
+
+    me->tree[0] = (me->leaves > 1U) ? winners[1] : 0U;
+
+    return;
+}
+
+
+/**
+ * @name    static inline void frame_merge_replay(frame_merge* const me, u32 leaf)
+ * 
+ * @brief   plays the path of a leaf with a new key up to the root, the winner of every 
+ *          match moves on and the loser stays in the node
+ * 
+ * @param   frame_merge* const : object pointer to the struct.
+ *          u32                : leaf, the source whose key changed
+ * 
+ * @return  none.
+ */
+static inline void frame_merge_replay(frame_merge* const me, u32 leaf)
+{
+    u32 node = (me->leaves + leaf) >> 1U;
+    u32 best = leaf;
+
+    while (node != 0U)
+    {
+        if (frame_merge_less(me, me->tree[node], best) == true)
+        {
+            u32 const loser = best;
+
+            best = me->tree[node];
+            me->tree[node] = loser;
+        }
+        node >>= 1U;
+    }
+
+    me->tree[0] = best;
+
+    return;
+}
+
+
+/**
+ * @name    static inline __boolean frame_merge_less(frame_merge const * const me, u32 a, u32 b)
+ * 
+ * @brief   order of two leaves, equal timestamps keep the order of the sources
+ * 
+ * @param   frame_merge const * const : object pointer to the struct.
+ *          u32                       : leaf
+ *          u32                       : leaf
+ * 
+ * @return  __boolean : true if a goes first.
+ */
+static inline __boolean frame_merge_less(frame_merge const * const me, u32 a, u32 b)
+{
+    return (me->keys[a] < me->keys[b]) || ((me->keys[a] == me->keys[b]) && (a < b));
+}
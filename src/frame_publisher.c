@@ -0,0 +1,867 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "epoll_handler.h"
+#include "perf_counters.h"
+
+#define __FRAME_PUBLISHER_H_
+#include "frame_publisher.h"
+
+_Static_assert(__builtin_offsetof(can_frame_rec, data) == FRAME_PUBLISHER_RECORD_HEADER, 
+               "a record is the head of can_frame_rec");
+
+
+/**
+ * @name    __boolean frame_publisher_init(frame_publisher* const me, u8 __id, char const * const path, frame_publisher_config const * const config)
+ * 
+ * @brief   creates the server socket, an existing file at path is replaced 
+ * 
+ * @param   frame_publisher* const               : object pointer to the struct.
+ *          u8                                   : module id for the registration 
+ *          char const * const                   : path of the UNIX socket 
+ *          frame_publisher_config const * const : NULLPTR for the defaults 
+ * 
+ * @return  __boolean                            : true if success, false if something went wrong.
+ */
+__boolean frame_publisher_init(frame_publisher* const me, u8 __id, char const * const path, frame_publisher_config const * const config)
+{
+    struct sockaddr_un addr;
+    u32 c;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(path);
+
+    memset(me, 0, sizeof(*me));
+    me->listen_fd = -1;
+    for (c = 0U; c < FRAME_PUBLISHER_MAX_CLIENTS; ++c)
+    {
+        me->clients[c].fd    = -1;
+        me->clients[c].owner = me;
+    }
+
+    if (config != NULLPTR)
+    {
+        me->config = *config;
+    }
+    if (me->config.queue_bytes == 0U)
+    {
+        me->config.queue_bytes = FRAME_PUBLISHER_DEFAULT_QUEUE;
+    }
+    if (me->config.latency_ns == 0U)
+    {
+        me->config.latency_ns = FRAME_PUBLISHER_DEFAULT_LATENCY_NS;
+    }
+
+    if ((FRAME_PUBLISHER_IS_POWER_OF_TWO(me->config.queue_bytes) == false) || 
+        (me->config.queue_bytes < FRAME_PUBLISHER_MIN_QUEUE) || (strlen(path) >= sizeof(addr.sun_path)) || 
+        (me->config.policy > FRAME_PUBLISHER_DISCONNECT))
+    {
+        return false;
+    }
+
+    if (epoll_handler_init(&me->loop, __id) == false)
+    {
+        return false;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1U);
+    strncpy(me->path, path, sizeof(me->path) - 1U);
+
+    (void) unlink(path);
+    me->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if ((me->listen_fd < 0) || (bind(me->listen_fd, (struct sockaddr*) &addr, sizeof(addr)) != 0) || 
+        (listen(me->listen_fd, FRAME_PUBLISHER_BACKLOG) != 0) || 
+        (epoll_handler_add(&me->loop, me->listen_fd, EPOLLIN, frame_publisher_on_listen, me) == false))
+    {
+        if (me->listen_fd >= 0)
+        {
+            close(me->listen_fd);
+            (void) unlink(path);
+        }
+        me->listen_fd = -1;
+        epoll_handler_destruct(&me->loop);
+        return false;
+    }
+
+    me->module_position = utils_register_module(FRAME_PUBLISHER_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void frame_publisher_destruct(frame_publisher* const me)
+ * 
+ * @brief   disconnects the clients with what is still queued and removes the socket file
+ * 
+ * @param   frame_publisher* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void frame_publisher_destruct(frame_publisher* const me)
+{
+    u32 c;
+
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->listen_fd < 0)
+    {
+        return;
+    }
+
+    for (c = 0U; c < FRAME_PUBLISHER_MAX_CLIENTS; ++c)
+    {
+        if (me->clients[c].fd >= 0)
+        {
+            frame_publisher_close_client(me, &me->clients[c]);
+        }
+    }
+
+    (void) epoll_handler_remove(&me->loop, me->listen_fd);
+    close(me->listen_fd);
+    (void) unlink(me->path);
+    me->listen_fd = -1;
+    epoll_handler_destruct(&me->loop);
+
+    utils_remove_module_registration(me->module_position);
+
+    return;
+}
+
+
+/**
+ * @name    __boolean frame_publisher_add_source(frame_publisher* const me, frame_ring* const ring)
+ * 
+ * @brief   publishes the frames of a ring, the thread of frame_publisher_process() 
+ *          becomes its consumer 
+ * 
+ * @param   frame_publisher* const : object pointer to the struct.
+ *          frame_ring* const      : ring filled by a receive thread 
+ * 
+ * @return  __boolean : false if FRAME_PUBLISHER_MAX_SOURCES are added already.
+ */
+__boolean frame_publisher_add_source(frame_publisher* const me, frame_ring* const ring)
+{
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(ring);
+
+    if (me->source_count == FRAME_PUBLISHER_MAX_SOURCES)
+    {
+        return false;
+    }
+    me->sources[me->source_count++] = ring;
+
+    return true;
+}
+
+
+/**
+ * @name    u32 frame_publisher_publish(frame_publisher* const me, can_frame_rec const * const frames, u32 count)
+ * 
+ * @brief   queues frames for the clients whose filters match, from the thread of 
+ *          frame_publisher_process() only. Written by the next process round.
+ * 
+ * @param   frame_publisher* const      : object pointer to the struct.
+ *          can_frame_rec const * const : frames 
+ *          u32                         : number of frames 
+ * 
+ * @return  u32 : number of frames taken, count unless a parameter is invalid.
+ */
+u32 frame_publisher_publish(frame_publisher* const me, can_frame_rec const * const frames, u32 count)
+{
+    u32 i;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frames);
+
+    if ((count == 0U) || (me->client_count == 0U))
+    {
+        me->stats.frames += count;
+        return count;
+    }
+
+    me->now_ns = frame_publisher_now();
+    for (i = 0U; i < count; ++i)
+    {
+        frame_publisher_fan_out(me, &frames[i]);
+    }
+    me->stats.frames += count;
+
+    return count;
+}
+
+
+/**
+ * @name    u32 frame_publisher_process(frame_publisher* const me, s32 timeout_ms)
+ * 
+ * @brief   one round of the server thread: takes the frames of the sources, writes the 
+ *          queues that are due and serves the sockets. Waits up to timeout_ms if there 
+ *          was nothing to take, but not past the deadline of a queued frame, and with 
+ *          sources not longer than latency_ns since a ring does not wake the thread.
+ * 
+ * @param   frame_publisher* const : object pointer to the struct.
+ *          s32                    : wait, 0 to not wait, -1 forever
+ * 
+ * @return  u32 : number of frames taken from the sources.
+ */
+u32 frame_publisher_process(frame_publisher* const me, s32 timeout_ms)
+{
+    can_frame_rec* slots;
+    u32 taken = 0U;
+    u64 start;
+    u32 s;
+    u32 round;
+    u32 i;
+    u32 c;
+
+    CHECK_NULLPTR_RET(me);
+
+    me->now_ns = frame_publisher_now();
+    start = perf_counters_enter();
+
+    for (s = 0U; s < me->source_count; ++s)
+    {
+        for (round = 0U; round < FRAME_PUBLISHER_SOURCE_ROUNDS; ++round)
+        {
+            u32 const n = frame_ring_peek(me->sources[s], &slots, FRAME_PUBLISHER_SOURCE_BATCH);
+
+            for (i = 0U; (i < n) && (me->client_count != 0U); ++i)
+            {
+                frame_publisher_fan_out(me, &slots[i]);
+            }
+            frame_ring_release(me->sources[s], n);
+            taken += n;
+
+            if (n < FRAME_PUBLISHER_SOURCE_BATCH)
+            {
+                break;
+            }
+        }
+    }
+    me->stats.frames += taken;
+
+    for (c = 0U; c < FRAME_PUBLISHER_MAX_CLIENTS; ++c)
+    {
+        frame_publisher_client* const client = &me->clients[c];
+        u64 const queued = client->head - client->tail;
+
+        if (client->fd < 0)
+        {
+            continue;
+        }
+
+        frame_publisher_adapt(me, client);
+        if ((client->blocked == false) && (queued != 0U) && 
+            ((queued >= frame_publisher_batch(me, client)) || ((me->now_ns - client->oldest_ns) >= me->config.latency_ns)))
+        {
+            frame_publisher_flush(me, client);
+        }
+    }
+
+    perf_counters_exit(me->module_position, start);
+
+    (void) epoll_handler_run_once(&me->loop, (taken != 0U) ? 0 : frame_publisher_timeout(me, timeout_ms));
+
+    return taken;
+}
+
+
+/**
+ * @name    void frame_publisher_get_stats(frame_publisher const * const me, frame_publisher_stats* const stats)
+ * 
+ * @brief   copies the counters of the server
+ * 
+ * @param   frame_publisher const * const : object pointer to the struct.
+ *          frame_publisher_stats* const  : destination
+ * 
+ * @return  none.
+ */
+void frame_publisher_get_stats(frame_publisher const * const me, frame_publisher_stats* const stats)
+{
+    CHECK_NULLPTR_VOID(me);
+    CHECK_NULLPTR_VOID(stats);
+
+    *stats = me->stats;
+
+    return;
+}
+
+
+/**
+ * @name    __boolean frame_publisher_get_client_stats(frame_publisher const * const me, u32 client, frame_publisher_client_stats* const stats)
+ * 
+ * @brief   copies the counters of a connected client 
+ * 
+ * @param   frame_publisher const * const       : object pointer to the struct.
+ *          u32                                 : client slot, 0 .. FRAME_PUBLISHER_MAX_CLIENTS - 1
+ *          frame_publisher_client_stats* const : destination
+ * 
+ * @return  __boolean : false if no client uses the slot.
+ */
+__boolean frame_publisher_get_client_stats(frame_publisher const * const me, u32 client, frame_publisher_client_stats* const stats)
+{
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(stats);
+
+    if ((client >= FRAME_PUBLISHER_MAX_CLIENTS) || (me->clients[client].fd < 0))
+    {
+        return false;
+    }
+    *stats = me->clients[client].stats;
+
+    return true;
+}
+
+
+/**
+ * @name    static void frame_publisher_on_listen(void* ctx, int fd, u32 events)
+ * 
+ * @brief   accepts the waiting clients, a client beyond FRAME_PUBLISHER_MAX_CLIENTS 
+ *          is closed at once 
+ * 
+ * @param   void* : the publisher 
+ *          int   : listening socket 
+ *          u32   : epoll events 
+ * 
+ * @return  none.
+ */
+static void frame_publisher_on_listen(void* ctx, int fd, u32 events)
+{
+    frame_publisher* const me = (frame_publisher*) ctx;
+    int client_fd;
+    u32 c;
+
+    (void) events;
+
+    while ((client_fd = accept4(fd, NULLPTR, NULLPTR, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+    {
+        frame_publisher_client* client = NULLPTR;
+
+        for (c = 0U; c < FRAME_PUBLISHER_MAX_CLIENTS; ++c)
+        {
+            if (me->clients[c].fd < 0)
+            {
+                client = &me->clients[c];
+                break;
+            }
+        }
+
+        if (client != NULLPTR)
+        {
+            memset(client, 0, sizeof(*client));
+            client->owner = me;
+            client->fd    = -1;
+            client->queue = (u8*) malloc(me->config.queue_bytes);
+        }
+
+        if ((client == NULLPTR) || (client->queue == NULLPTR) || 
+            (epoll_handler_add(&me->loop, client_fd, EPOLLIN, frame_publisher_on_client, client) == false))
+        {
+            if (client != NULLPTR)
+            {
+                free(client->queue);
+                client->queue = NULLPTR;
+            }
+            close(client_fd);
+            me->stats.rejected++;
+            continue;
+        }
+
+        if (me->config.sndbuf != 0U)
+        {
+            int const size = (int) me->config.sndbuf;
+
+            (void) setsockopt(client_fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+        }
+
+        client->fd      = client_fd;
+        client->mask    = me->config.queue_bytes - 1U;
+        client->rate_ns = frame_publisher_now();
+        client->stats.batch_bytes = (u32) frame_publisher_batch(me, client);
+        me->client_count++;
+        me->stats.accepted++;
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static void frame_publisher_on_client(void* ctx, int fd, u32 events)
+ * 
+ * @brief   reads subscription lines, continues a blocked write and notices hang ups 
+ * 
+ * @param   void* : the client 
+ *          int   : client socket 
+ *          u32   : epoll events 
+ * 
+ * @return  none.
+ */
+static void frame_publisher_on_client(void* ctx, int fd, u32 events)
+{
+    frame_publisher_client* const client = (frame_publisher_client*) ctx;
+    frame_publisher* const me = client->owner;
+    char* line;
+    char* newline;
+    ssize_t n;
+
+    if ((events & EPOLLERR) != 0U)
+    {
+        me->stats.closed++;
+        frame_publisher_close_client(me, client);
+        return;
+    }
+
+    if ((events & EPOLLOUT) != 0U)
+    {
+        client->blocked = false;
+        (void) epoll_handler_modify(&me->loop, fd, EPOLLIN);
+        frame_publisher_flush(me, client);
+        if (client->fd < 0)
+        {
+            return;
+        }
+    }
+
+    if ((events & (EPOLLIN | EPOLLHUP)) == 0U)
+    {
+        return;
+    }
+
+    n = read(fd, &client->command[client->command_len], sizeof(client->command) - 1U - client->command_len);
+    if ((n == 0) || ((n < 0) && (errno != EAGAIN) && (errno != EINTR)))
+    {
+        me->stats.closed++;
+        frame_publisher_close_client(me, client);
+        return;
+    }
+    if (n < 0)
+    {
+        return;
+    }
+
+    client->command_len += (u32) n;
+    client->command[client->command_len] = '\0';
+
+    line = client->command;
+    while ((newline = strchr(line, '\n')) != NULLPTR)
+    {
+        *newline = '\0';
+        frame_publisher_command(client, line);
+        line = newline + 1;
+    }
+
+    // a line that does not fit the buffer is dropped 
+    client->command_len = (u32) strlen(line);
+    if (client->command_len == (sizeof(client->command) - 1U))
+    {
+        client->command_len = 0U;
+    }
+    memmove(client->command, line, client->command_len);
+
+    return;
+}
+
+
+/**
+ * @name    static void frame_publisher_command(frame_publisher_client* const client, char* const line)
+ * 
+ * @brief   applies a subscription line, unknown lines are ignored 
+ * 
+ * @param   frame_publisher_client* const : client 
+ *          char* const                   : line without its newline 
+ * 
+ * @return  none.
+ */
+static void frame_publisher_command(frame_publisher_client* const client, char* const line)
+{
+    frame_publisher_filter filter;
+    size_t len = strlen(line);
+    char* p;
+    char* end;
+
+    if ((len != 0U) && (line[len - 1U] == '\r'))
+    {
+        line[--len] = '\0';
+    }
+
+    if (strcmp(line, "clear") == 0)
+    {
+        client->filter_count = 0U;
+        return;
+    }
+
+    if ((strncmp(line, "filter ", 7U) != 0) || (client->filter_count == FRAME_PUBLISHER_MAX_FILTERS))
+    {
+        return;
+    }
+
+    p = &line[7];
+    filter.can_id = 0U;
+    filter.mask   = 0U;
+    filter.bus    = FRAME_PUBLISHER_ANY_BUS;
+
+    if (strcmp(p, "all") != 0)
+    {
+        filter.can_id = (u32) strtoul(p, &end, 16);
+        if (end == p)
+        {
+            return;
+        }
+
+        // 8 digits are a 29 bit id like in candump/cansend
+        if ((end - p) == 8)
+        {
+            filter.can_id = (filter.can_id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+            filter.mask   = CAN_EFF_MASK;
+        }
+        else if (filter.can_id > CAN_SFF_MASK)
+        {
+            return;
+        }
+        else
+        {
+            filter.mask = CAN_SFF_MASK;
+        }
+
+        if (*end == '/')
+        {
+            filter.mask = (u32) strtoul(end + 1, &end, 16) & CAN_EFF_MASK;
+        }
+        if (*end == '@')
+        {
+            filter.bus = (u8) strtoul(end + 1, &end, 10);
+        }
+        if (*end != '\0')
+        {
+            return;
+        }
+
+        // same format, error frames only with "all" 
+        filter.mask |= CAN_EFF_FLAG | CAN_ERR_FLAG;
+    }
+
+    client->filters[client->filter_count++] = filter;
+
+    return;
+}
+
+
+/**
+ * @name    static void frame_publisher_fan_out(frame_publisher* const me, can_frame_rec const * const frame)
+ * 
+ * @brief   copies a frame into the queue of every client with a matching filter 
+ * 
+ * @param   frame_publisher* const      : object pointer to the struct.
+ *          can_frame_rec const * const : frame 
+ * 
+ * @return  none.
+ */
+static void frame_publisher_fan_out(frame_publisher* const me, can_frame_rec const * const frame)
+{
+    u32 const size = FRAME_PUBLISHER_RECORD_HEADER + GET_MIN((u32) frame->len, CAN_FRAME_MAX_DATA);
+    u32 const clients = me->client_count;
+    u32 seen = 0U;
+    u32 c;
+    u32 f;
+
+    for (c = 0U; (c < FRAME_PUBLISHER_MAX_CLIENTS) && (seen < clients); ++c)
+    {
+        frame_publisher_client* const client = &me->clients[c];
+        __boolean match = false;
+        u64 queued;
+        u32 offset;
+        u32 first;
+
+        if (client->fd < 0)
+        {
+            continue;
+        }
+        seen++;
+
+        for (f = 0U; f < client->filter_count; ++f)
+        {
+            frame_publisher_filter const * const filter = &client->filters[f];
+
+            if ((((frame->can_id ^ filter->can_id) & filter->mask) == 0U) && 
+                ((filter->bus == FRAME_PUBLISHER_ANY_BUS) || (filter->bus == frame->bus)))
+            {
+                match = true;
+                break;
+            }
+        }
+
+        if (match == false)
+        {
+            continue;
+        }
+
+        // a full queue is only slow if its socket is full as well 
+        queued = client->head - client->tail;
+        if (((queued + size) > ((u64) client->mask + 1U)) && (client->blocked == false))
+        {
+            frame_publisher_flush(me, client);
+            if (client->fd < 0)
+            {
+                continue;
+            }
+            queued = client->head - client->tail;
+        }
+
+        if ((queued + size) > ((u64) client->mask + 1U))
+        {
+            if (me->config.policy == FRAME_PUBLISHER_DISCONNECT)
+            {
+                me->stats.disconnected++;
+                frame_publisher_close_client(me, client);
+                continue;
+            }
+            client->stats.dropped++;
+            perf_counters_fail(me->module_position, 1U);
+            continue;
+        }
+
+        if (queued == 0U)
+        {
+            client->oldest_ns = me->now_ns;
+        }
+
+        offset = (u32) client->head & client->mask;
+        first  = GET_MIN(size, (client->mask + 1U) - offset);
+        memcpy(&client->queue[offset], frame, first);
+        if (first < size)
+        {
+            memcpy(client->queue, (u8 const *) frame + first, size - first);
+        }
+
+        client->head += size;
+        client->stats.frames++;
+        if ((queued + size) > client->stats.queue_hwm)
+        {
+            client->stats.queue_hwm = (u32) (queued + size);
+        }
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static void frame_publisher_flush(frame_publisher* const me, frame_publisher_client* const client)
+ * 
+ * @brief   writes the queue of a client with one gather write over both ring segments. 
+ *          sendmsg instead of writev for MSG_NOSIGNAL, a client gone away must not 
+ *          raise SIGPIPE in the server. What the socket does not take waits for EPOLLOUT.
+ * 
+ * @param   frame_publisher* const        : object pointer to the struct.
+ *          frame_publisher_client* const : client 
+ * 
+ * @return  none.
+ */
+static void frame_publisher_flush(frame_publisher* const me, frame_publisher_client* const client)
+{
+    u64 const queued = client->head - client->tail;
+    u32 const offset = (u32) client->tail & client->mask;
+    u64 const first  = GET_MIN(queued, (u64) client->mask + 1U - offset);
+    struct iovec iov[2];
+    struct msghdr msg;
+    ssize_t n;
+
+    if ((queued == 0U) || (client->blocked == true))
+    {
+        return;
+    }
+
+    iov[0].iov_base = &client->queue[offset];
+    iov[0].iov_len  = first;
+    iov[1].iov_base = client->queue;
+    iov[1].iov_len  = queued - first;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = iov;
+    msg.msg_iovlen = (queued > first) ? 2U : 1U;
+
+    perf_counters_queue_depth(me->module_position, queued);
+    n = sendmsg(client->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n < 0)
+    {
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        {
+            client->blocked = true;
+            client->stats.blocked++;
+            (void) epoll_handler_modify(&me->loop, client->fd, EPOLLIN | EPOLLOUT);
+        }
+        else if (errno != EINTR)
+        {
+            me->stats.closed++;
+            frame_publisher_close_client(me, client);
+        }
+        return;
+    }
+
+    client->tail += (u64) n;
+    client->stats.bytes += (u64) n;
+    client->stats.writes++;
+    perf_counters_count(me->module_position, 1U, (u64) n);
+
+    if ((u64) n < queued)
+    {
+        client->blocked = true;
+        client->stats.blocked++;
+        (void) epoll_handler_modify(&me->loop, client->fd, EPOLLIN | EPOLLOUT);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static void frame_publisher_adapt(frame_publisher* const me, frame_publisher_client* const client)
+ * 
+ * @brief   measures the rate of a client over at least latency_ns and smooths it 
+ * 
+ * @param   frame_publisher* const        : object pointer to the struct.
+ *          frame_publisher_client* const : client 
+ * 
+ * @return  none.
+ */
+static void frame_publisher_adapt(frame_publisher* const me, frame_publisher_client* const client)
+{
+    u64 const elapsed = me->now_ns - client->rate_ns;
+    u64 rate;
+
+    if ((me->now_ns < client->rate_ns) || (elapsed < me->config.latency_ns))
+    {
+        return;
+    }
+
+    rate = (u64) (((f64) (client->head - client->rate_head) * 1e9) / (f64) elapsed);
+    client->rate      = (client->rate == 0U) ? rate : (((client->rate * 3U) + rate) / 4U);
+    client->rate_head = client->head;
+    client->rate_ns   = me->now_ns;
+    client->stats.batch_bytes = (u32) frame_publisher_batch(me, client);
+
+    return;
+}
+
+
+/**
+ * @name    static void frame_publisher_close_client(frame_publisher* const me, frame_publisher_client* const client)
+ * 
+ * @brief   disconnects a client, queued frames are lost. The callers count why.
+ * 
+ * @param   frame_publisher* const        : object pointer to the struct.
+ *          frame_publisher_client* const : client 
+ * 
+ * @return  none.
+ */
+static void frame_publisher_close_client(frame_publisher* const me, frame_publisher_client* const client)
+{
+    if (client->fd < 0)
+    {
+        return;
+    }
+
+    (void) epoll_handler_remove(&me->loop, client->fd);
+    close(client->fd);
+    free(client->queue);
+    client->fd    = -1;
+    client->queue = NULLPTR;
+    me->client_count--;
+
+    return;
+}
+
+
+/**
+ * @name    static s32 frame_publisher_timeout(frame_publisher const * const me, s32 timeout_ms)
+ * 
+ * @brief   wait of a round: up to the first deadline of a queued frame, with sources 
+ *          at most latency_ns 
+ * 
+ * @param   frame_publisher const * const : object pointer to the struct.
+ *          s32                           : wait of the caller, -1 forever 
+ * 
+ * @return  s32 : milliseconds for epoll_wait.
+ */
+static s32 frame_publisher_timeout(frame_publisher const * const me, s32 timeout_ms)
+{
+    s32 const latency_ms = (s32) GET_MAX(me->config.latency_ns / 1000000U, 1U);
+    s32 wait = timeout_ms;
+    u32 c;
+
+    if ((me->source_count != 0U) && ((wait < 0) || (wait > latency_ms)))
+    {
+        wait = latency_ms;
+    }
+
+    for (c = 0U; c < FRAME_PUBLISHER_MAX_CLIENTS; ++c)
+    {
+        frame_publisher_client const * const client = &me->clients[c];
+        u64 const deadline = client->oldest_ns + me->config.latency_ns;
+        s32 remaining;
+
+        if ((client->fd < 0) || (client->blocked == true) || (client->head == client->tail))
+        {
+            continue;
+        }
+
+        remaining = (deadline > me->now_ns) ? (s32) ((deadline - me->now_ns + 999999U) / 1000000U) : 0;
+        if ((wait < 0) || (remaining < wait))
+        {
+            wait = remaining;
+        }
+    }
+
+    return wait;
+}
+
+
+/**
+ * @name    static inline u64 frame_publisher_batch(frame_publisher const * const me, frame_publisher_client const * const client)
+ * 
+ * @brief   bytes that make a write worth it: half of what the client gets within 
+ *          latency_ns, at least one record, at most a quarter of the queue 
+ * 
+ * @param   frame_publisher const * const        : object pointer to the struct.
+ *          frame_publisher_client const * const : client 
+ * 
+ * @return  u64 : bytes.
+ */
+static inline u64 frame_publisher_batch(frame_publisher const * const me, frame_publisher_client const * const client)
+{
+    u64 const batch = (u64) (((f64) client->rate * (f64) me->config.latency_ns) / 2e9);
+    u64 const max = ((u64) me->config.queue_bytes) / 4U;
+
+    return GET_MIN(GET_MAX(batch, (u64) FRAME_PUBLISHER_RECORD_HEADER), max);
+}
+
+
+/**
+ * @name    static inline u64 frame_publisher_now(void)
+ * 
+ * @brief   monotonic clock for the flush deadlines and client rates 
+ * 
+ * @param   none.
+ * 
+ * @return  u64 : nanoseconds.
+ */
+static inline u64 frame_publisher_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+}
@@ -0,0 +1,255 @@
+#include <string.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+
+#define __FRAME_RING_H_
+#include "frame_ring.h"
+
+/**
+ * @name    __boolean frame_ring_init(frame_ring* const me, u8 __id, can_frame_rec* const storage, u32 capacity)
+ * 
+ * @brief   sets up a ring over caller provided storage
+ * 
+ * @param   frame_ring* const    : object pointer to the struct.
+ *          u8                   : module id for the registration 
+ *          can_frame_rec* const : storage for capacity frames
+ *          u32                  : number of frames, power of two
+ * 
+ * @return  __boolean            : true if success, false if something went wrong.
+ */
+__boolean frame_ring_init(frame_ring* const me, u8 __id, can_frame_rec* const storage, u32 capacity)
+{
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(storage);
+
+    if (FRAME_RING_IS_POWER_OF_TWO(capacity) == false)
+    {
+        return false;
+    }
+
+    memset(me, 0, sizeof(*me));
+    me->slots = storage;
+    me->mask  = capacity - 1U;
+    me->module_position = utils_register_module(FRAME_RING_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void frame_ring_destruct(frame_ring* const me)
+ * 
+ * @brief   releases the registration, the storage stays owned by the caller
+ * 
+ * @param   frame_ring* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void frame_ring_destruct(frame_ring* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    utils_remove_module_registration(me->module_position);
+    me->slots = NULLPTR;
+
+    return;
+}
+
+
+/**
+ * @name    u32 frame_ring_reserve(frame_ring* const me, can_frame_rec** const slots, u32 max)
+ * 
+ * @brief   producer side, hands out up to max free slots that are contiguous in memory.
+ *          The slots are filled in place and published with frame_ring_commit().
+ * 
+ * @param   frame_ring* const     : object pointer to the struct.
+ *          can_frame_rec** const : returns the first reserved slot 
+ *          u32                   : maximum number of slots wanted 
+ * 
+ * @return  u32 : number of reserved slots, 0 if the ring is full.
+ */
+u32 frame_ring_reserve(frame_ring* const me, can_frame_rec** const slots, u32 max)
+{
+    u64 const head = me->head;
+    u64 const capacity = (u64) me->mask + 1U;
+    u64 free_slots = capacity - (head - me->cached_tail);
+    u64 contiguous;
+
+    if (free_slots < max)
+    {
+        me->cached_tail = __atomic_load_n(&me->tail, __ATOMIC_ACQUIRE);
+        free_slots = capacity - (head - me->cached_tail);
+    }
+
+    contiguous = capacity - (head & me->mask);
+    max = (u32) GET_MIN((u64) max, GET_MIN(free_slots, contiguous));
+
+    *slots = &me->slots[head & me->mask];
+    return max;
+}
+
+
+/**
+ * @name    void frame_ring_commit(frame_ring* const me, u32 count)
+ * 
+ * @brief   producer side, publishes count slots of the last reservation
+ * 
+ * @param   frame_ring* const : object pointer to the struct.
+ *          u32               : number of filled slots 
+ * 
+ * @return  none.
+ */
+void frame_ring_commit(frame_ring* const me, u32 count)
+{
+    __atomic_store_n(&me->head, me->head + count, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @name    __boolean frame_ring_push(frame_ring* const me, can_frame_rec const * const frame)
+ * 
+ * @brief   producer side, copies a single frame into the ring. A full ring drops the 
+ *          frame and counts it, the producer never waits for the consumer.
+ * 
+ * @param   frame_ring* const          : object pointer to the struct.
+ *          can_frame_rec const * const: frame to be inserted
+ * 
+ * @return  __boolean : true if inserted, false if dropped.
+ */
+__boolean frame_ring_push(frame_ring* const me, can_frame_rec const * const frame)
+{
+    can_frame_rec* slot;
+
+    if (frame_ring_reserve(me, &slot, 1U) == 0U)
+    {
+        __atomic_store_n(&me->dropped, me->dropped + 1U, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    *slot = *frame;
+    frame_ring_commit(me, 1U);
+
+    return true;
+}
+
+
+/**
+ * @name    u32 frame_ring_peek(frame_ring* const me, can_frame_rec** const slots, u32 max)
+ * 
+ * @brief   consumer side, returns up to max contiguous filled slots without removing them.
+ *          The frames stay valid until frame_ring_release().
+ * 
+ * @param   frame_ring* const     : object pointer to the struct.
+ *          can_frame_rec** const : returns the oldest frame 
+ *          u32                   : maximum number of frames wanted 
+ * 
+ * @return  u32 : number of available frames, 0 if the ring is empty.
+ */
+u32 frame_ring_peek(frame_ring* const me, can_frame_rec** const slots, u32 max)
+{
+    u64 const tail = me->tail;
+    u64 const capacity = (u64) me->mask + 1U;
+    u64 used = me->cached_head - tail;
+    u64 contiguous;
+
+    if (used < max)
+    {
+        me->cached_head = __atomic_load_n(&me->head, __ATOMIC_ACQUIRE);
+        used = me->cached_head - tail;
+    }
+
+    contiguous = capacity - (tail & me->mask);
+    max = (u32) GET_MIN((u64) max, GET_MIN(used, contiguous));
+
+    *slots = &me->slots[tail & me->mask];
+    return max;
+}
+
+
+/**
+ * @name    void frame_ring_release(frame_ring* const me, u32 count)
+ * 
+ * @brief   consumer side, gives count consumed slots back to the producer 
+ * 
+ * @param   frame_ring* const : object pointer to the struct.
+ *          u32               : number of consumed frames 
+ * 
+ * @return  none.
+ */
+void frame_ring_release(frame_ring* const me, u32 count)
+{
+    __atomic_store_n(&me->tail, me->tail + count, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @name    __boolean frame_ring_pop(frame_ring* const me, can_frame_rec* const frame)
+ * 
+ * @brief   consumer side, copies the oldest frame out and removes it 
+ * 
+ * @param   frame_ring* const    : object pointer to the struct.
+ *          can_frame_rec* const : destination 
+ * 
+ * @return  __boolean : true if a frame was read, false if the ring is empty.
+ */
+__boolean frame_ring_pop(frame_ring* const me, can_frame_rec* const frame)
+{
+    can_frame_rec* slot;
+
+    if (frame_ring_peek(me, &slot, 1U) == 0U)
+    {
+        return false;
+    }
+
+    *frame = *slot;
+    frame_ring_release(me, 1U);
+
+    return true;
+}
+
+
+/**
+ * @name    u32 frame_ring_count(frame_ring const * const me)
+ * 
+ * @brief   number of frames in the ring, exact only from the producer or consumer thread 
+ * 
+ * @param   frame_ring const * const : object pointer to the struct.
+ * 
+ * @return  u32 : number of frames.
+ */
+u32 frame_ring_count(frame_ring const * const me)
+{
+    u64 const tail = __atomic_load_n(&me->tail, __ATOMIC_ACQUIRE);
+    return (u32) (__atomic_load_n(&me->head, __ATOMIC_ACQUIRE) - tail);
+}
+
+
+/**
+ * @name    u32 frame_ring_capacity(frame_ring const * const me)
+ * 
+ * @brief   number of slots 
+ * 
+ * @param   frame_ring const * const : object pointer to the struct.
+ * 
+ * @return  u32 : capacity.
+ */
+u32 frame_ring_capacity(frame_ring const * const me)
+{
+    return me->mask + 1U;
+}
+
+
+/**
+ * @name    u64 frame_ring_dropped(frame_ring const * const me)
+ * 
+ * @brief   frames dropped by frame_ring_push() because the ring was full
+ * 
+ * @param   frame_ring const * const : object pointer to the struct.
+ * 
+ * @return  u64 : dropped frames.
+ */
+u64 frame_ring_dropped(frame_ring const * const me)
+{
+    return __atomic_load_n(&me->dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,1079 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "can_socket.h"
+#include "can_id_table.h"
+#include "timer_wheel.h"
+
+#define __ISOTP_H_
+#include "isotp.h"
+
+/**
+ * @name    __boolean isotp_init(isotp_engine* const me, u8 __id, can_socket* const socket, u32 max_sessions, u32 buffer_count, u32 buffer_size, u64 now_ns)
+ * 
+ * @brief   engine without sessions. The reassembly pool is allocated in one piece, 
+ *          buffer_count bounds the number of segmented messages received at once.
+ * 
+ * @param   isotp_engine* const : object pointer to the struct.
+ *          u8                  : module id for the registration 
+ *          can_socket* const   : socket, non blocking for isotp_process(); NULLPTR to 
+ *                                hand the frames to the output callback 
+ *          u32                 : maximum number of sessions 
+ *          u32                 : number of reassembly buffers 
+ *          u32                 : size of a buffer, the longest message accepted 
+ *          u64                 : current time, CLOCK_MONOTONIC like all later calls 
+ * 
+ * @return  __boolean           : true if success, false if something went wrong.
+ */
+__boolean isotp_init(isotp_engine* const me, u8 __id, can_socket* const socket, u32 max_sessions, u32 buffer_count, u32 buffer_size, u64 now_ns)
+{
+    u32 i;
+
+    CHECK_NULLPTR_RET(me);
+
+    if ((max_sessions == 0U) || (buffer_count == 0U) || (buffer_size == 0U))
+    {
+        return false;
+    }
+
+    memset(me, 0, sizeof(*me));
+    me->socket        = socket;
+    me->max_sessions  = max_sessions;
+    me->buffer_count  = buffer_count;
+    me->buffer_size   = buffer_size;
+    me->now_ns        = now_ns;
+    me->sessions      = (isotp_session*) calloc(max_sessions, sizeof(isotp_session));
+    me->free_sessions = (u32*) malloc(max_sessions * sizeof(u32));
+    me->pool          = (u8*) malloc((size_t) buffer_count * buffer_size);
+    me->free_buffers  = (u32*) malloc(buffer_count * sizeof(u32));
+    me->tx_frames     = (can_frame_rec*) calloc(ISOTP_TX_BATCH, sizeof(can_frame_rec));
+    me->rx_frames     = (can_frame_rec*) calloc(CAN_SOCKET_MAX_BATCH, sizeof(can_frame_rec));
+
+    if ((me->sessions == NULLPTR) || (me->free_sessions == NULLPTR) || (me->pool == NULLPTR) || 
+        (me->free_buffers == NULLPTR) || (me->tx_frames == NULLPTR) || (me->rx_frames == NULLPTR) || 
+        (can_id_table_init(&me->rx_index, __id, max_sessions) == false))
+    {
+        isotp_destruct(me);
+        return false;
+    }
+
+    if (timer_wheel_init(&me->wheel, __id, ISOTP_WHEEL_SLOTS, ISOTP_WHEEL_TICK_NS, now_ns) == false)
+    {
+        can_id_table_destruct(&me->rx_index);
+        isotp_destruct(me);
+        return false;
+    }
+
+    // handed out from the back, session 0 first 
+    for (i = 0U; i < max_sessions; ++i)
+    {
+        me->free_sessions[i] = max_sessions - 1U - i;
+        timer_wheel_node_init(&me->sessions[i].tx_timer, i);
+        timer_wheel_node_init(&me->sessions[i].rx_timer, i);
+    }
+    me->free_session_count = max_sessions;
+
+    for (i = 0U; i < buffer_count; ++i)
+    {
+        me->free_buffers[i] = i;
+    }
+    me->free_buffer_count = buffer_count;
+
+    me->module_position = utils_register_module(ISOTP_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void isotp_destruct(isotp_engine* const me)
+ * 
+ * @brief   frees sessions and buffers, no callbacks are made for running transfers
+ * 
+ * @param   isotp_engine* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void isotp_destruct(isotp_engine* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->wheel.slots != NULLPTR)
+    {
+        timer_wheel_destruct(&me->wheel);
+        can_id_table_destruct(&me->rx_index);
+        utils_remove_module_registration(me->module_position);
+    }
+
+    free(me->sessions);
+    free(me->free_sessions);
+    free(me->pool);
+    free(me->free_buffers);
+    free(me->tx_frames);
+    free(me->rx_frames);
+    memset(me, 0, sizeof(*me));
+
+    return;
+}
+
+
+/**
+ * @name    void isotp_set_callbacks(isotp_engine* const me, isotp_receive_callback on_receive, isotp_sent_callback on_sent, void* ctx)
+ * 
+ * @brief   installs the callbacks for received messages and finished transmissions,
+ *          both may start new transfers or close sessions 
+ * 
+ * @param   isotp_engine* const    : object pointer to the struct.
+ *          isotp_receive_callback : messages and receive errors 
+ *          isotp_sent_callback    : end of every isotp_send() that returned ISOTP_OK
+ *          void*                  : passed to both 
+ * 
+ * @return  none.
+ */
+void isotp_set_callbacks(isotp_engine* const me, isotp_receive_callback on_receive, isotp_sent_callback on_sent, void* ctx)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    me->on_receive = on_receive;
+    me->on_sent    = on_sent;
+    me->ctx        = ctx;
+
+    return;
+}
+
+
+/**
+ * @name    void isotp_set_output(isotp_engine* const me, isotp_output_callback output, void* ctx)
+ * 
+ * @brief   where frames go if the engine has no socket, e.g. another engine in tests 
+ * 
+ * @param   isotp_engine* const   : object pointer to the struct.
+ *          isotp_output_callback : takes a batch of frames 
+ *          void*                 : passed to it 
+ * 
+ * @return  none.
+ */
+void isotp_set_output(isotp_engine* const me, isotp_output_callback output, void* ctx)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    me->output     = output;
+    me->output_ctx = ctx;
+
+    return;
+}
+
+
+/**
+ * @name    u32 isotp_open(isotp_engine* const me, isotp_config const * const config)
+ * 
+ * @brief   opens a session on an id pair 
+ * 
+ * @param   isotp_engine* const          : object pointer to the struct.
+ *          isotp_config const * const   : ids and parameters 
+ * 
+ * @return  u32 : session, ISOTP_NONE if the rx id is taken, the parameters are invalid 
+ *                or all sessions are in use.
+ */
+u32 isotp_open(isotp_engine* const me, isotp_config const * const config)
+{
+    isotp_session* session;
+    u32 index;
+
+    if ((me == NULLPTR) || (config == NULLPTR) || (me->free_session_count == 0U))
+    {
+        return ISOTP_NONE;
+    }
+
+    if ((config->tx_dl < ISOTP_CLASSIC_DL) || (config->tx_dl > CAN_FRAME_MAX_DATA) || 
+        (isotp_frame_len(config->tx_dl) != config->tx_dl) || 
+        (can_id_table_lookup(&me->rx_index, config->rx_id) != CAN_ID_TABLE_NONE))
+    {
+        return ISOTP_NONE;
+    }
+
+    index = me->free_sessions[me->free_session_count - 1U];
+    if (can_id_table_insert(&me->rx_index, config->rx_id, index) == false)
+    {
+        return ISOTP_NONE;
+    }
+    me->free_session_count--;
+
+    session = &me->sessions[index];
+    memset(session, 0, sizeof(*session));
+    timer_wheel_node_init(&session->tx_timer, index);
+    timer_wheel_node_init(&session->rx_timer, index);
+    session->config = *config;
+    session->in_use = 1U;
+
+    return index;
+}
+
+
+/**
+ * @name    void isotp_close(isotp_engine* const me, u32 session)
+ * 
+ * @brief   closes a session, a message still being sent is reported ISOTP_ERR_ABORTED
+ * 
+ * @param   isotp_engine* const : object pointer to the struct.
+ *          u32                 : session 
+ * 
+ * @return  none.
+ */
+void isotp_close(isotp_engine* const me, u32 session)
+{
+    isotp_session* s;
+
+    CHECK_NULLPTR_VOID(me);
+
+    if ((session >= me->max_sessions) || (me->sessions[session].in_use == 0U))
+    {
+        return;
+    }
+    s = &me->sessions[session];
+
+    timer_wheel_cancel(&me->wheel, &s->rx_timer);
+    if (s->rx_state == ISOTP_RX_RECEIVING)
+    {
+        me->free_buffers[me->free_buffer_count++] = (u32) ((s->rx_buffer - me->pool) / me->buffer_size);
+        s->rx_state = ISOTP_RX_IDLE;
+    }
+
+    s->in_use = 0U;
+    can_id_table_remove(&me->rx_index, s->config.rx_id);
+    me->free_sessions[me->free_session_count++] = session;
+
+    if (s->tx_state != ISOTP_TX_IDLE)
+    {
+        isotp_tx_done(me, session, ISOTP_ERR_ABORTED);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    u32 isotp_find(isotp_engine const * const me, u32 tx_id, u32 rx_id)
+ * 
+ * @brief   session of an id pair 
+ * 
+ * @param   isotp_engine const * const : object pointer to the struct.
+ *          u32                        : tx id, kernel layout 
+ *          u32                        : rx id, kernel layout 
+ * 
+ * @return  u32 : session, ISOTP_NONE if there is none.
+ */
+u32 isotp_find(isotp_engine const * const me, u32 tx_id, u32 rx_id)
+{
+    u32 index;
+
+    if (me == NULLPTR)
+    {
+        return ISOTP_NONE;
+    }
+
+    index = can_id_table_lookup(&me->rx_index, rx_id);
+    if ((index == CAN_ID_TABLE_NONE) || (me->sessions[index].config.tx_id != tx_id))
+    {
+        return ISOTP_NONE;
+    }
+
+    return index;
+}
+
+
+/**
+ * @name    s32 isotp_send(isotp_engine* const me, u32 session, u8 const * const data, u32 len, u64 now_ns)
+ * 
+ * @brief   starts sending a message. It goes out as a single frame if it fits, else 
+ *          the first frame is sent and the rest follows the receiver's flow control.
+ *          data is not copied and has to stay valid until the sent callback.
+ * 
+ * @param   isotp_engine* const : object pointer to the struct.
+ *          u32                 : session 
+ *          u8 const * const    : message 
+ *          u32                 : length, at least 1 
+ *          u64                 : current time 
+ * 
+ * @return  s32 : ISOTP_OK, ISOTP_ERR_BUSY or ISOTP_ERR_INVALID.
+ */
+s32 isotp_send(isotp_engine* const me, u32 session, u8 const * const data, u32 len, u64 now_ns)
+{
+    isotp_session* s;
+    can_frame_rec* frame;
+    u32 const tx_dl = ((me != NULLPTR) && (session < me->max_sessions)) ? me->sessions[session].config.tx_dl : 0U;
+    u32 const single_max = (tx_dl > ISOTP_CLASSIC_DL) ? (tx_dl - 2U) : 7U;
+    u32 n;
+
+    if ((me == NULLPTR) || (data == NULLPTR) || (len == 0U) || (tx_dl == 0U) || (me->sessions[session].in_use == 0U))
+    {
+        return ISOTP_ERR_INVALID;
+    }
+
+    s = &me->sessions[session];
+    if (s->tx_state != ISOTP_TX_IDLE)
+    {
+        return ISOTP_ERR_BUSY;
+    }
+
+    me->now_ns = now_ns;
+    s->tx_data = data;
+    s->tx_len  = len;
+
+    frame = isotp_next_frame(me, s);
+
+    if (len <= single_max)
+    {
+        // the classic single frame layout as long as the length fits into the nibble 
+        if (len <= 7U)
+        {
+            frame->data[0] = (u8) (ISOTP_PCI_SF | len);
+            memcpy(&frame->data[1], data, len);
+            isotp_finish_frame(s, frame, len + 1U);
+        }
+        else
+        {
+            frame->data[0] = ISOTP_PCI_SF;
+            frame->data[1] = (u8) len;
+            memcpy(&frame->data[2], data, len);
+            isotp_finish_frame(s, frame, len + 2U);
+        }
+
+        s->tx_state = ISOTP_TX_SENDING;
+        isotp_tx_done(me, session, ISOTP_OK);
+        isotp_flush(me);
+        return ISOTP_OK;
+    }
+
+    if (len <= ISOTP_FF_DL_12BIT_MAX)
+    {
+        frame->data[0] = (u8) (ISOTP_PCI_FF | (len >> 8U));
+        frame->data[1] = (u8) len;
+        n = tx_dl - 2U;
+    }
+    else
+    {
+        frame->data[0] = ISOTP_PCI_FF;
+        frame->data[1] = 0U;
+        frame->data[2] = (u8) (len >> 24U);
+        frame->data[3] = (u8) (len >> 16U);
+        frame->data[4] = (u8) (len >> 8U);
+        frame->data[5] = (u8) len;
+        n = tx_dl - 6U;
+    }
+    memcpy(&frame->data[tx_dl - n], data, n);
+    isotp_finish_frame(s, frame, tx_dl);
+
+    s->tx_pos        = n;
+    s->tx_sn         = 1U;
+    s->tx_wait_count = 0U;
+    s->tx_state      = ISOTP_TX_WAIT_FC;
+    timer_wheel_schedule(&me->wheel, &s->tx_timer, now_ns + ISOTP_N_BS_NS);
+
+    isotp_flush(me);
+
+    return ISOTP_OK;
+}
+
+
+/**
+ * @name    u32 isotp_receive(isotp_engine* const me, can_frame_rec const * const frames, u32 count, u64 now_ns)
+ * 
+ * @brief   handles a batch of received frames, frames of unknown ids are skipped. 
+ *          Flow control and consecutive frames produced on the way are sent together 
+ *          at the end.
+ * 
+ * @param   isotp_engine* const         : object pointer to the struct.
+ *          can_frame_rec const * const : received frames 
+ *          u32                         : number of frames 
+ *          u64                         : current time 
+ * 
+ * @return  u32 : number of frames that belonged to a session.
+ */
+u32 isotp_receive(isotp_engine* const me, can_frame_rec const * const frames, u32 count, u64 now_ns)
+{
+    u32 handled = 0U;
+    u32 i;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frames);
+
+    me->now_ns = now_ns;
+
+    for (i = 0U; i < count; ++i)
+    {
+        can_frame_rec const * const frame = &frames[i];
+        u32 index;
+
+        if (((frame->can_id & (CAN_RTR_FLAG | CAN_ERR_FLAG)) != 0U) || (frame->len == 0U))
+        {
+            continue;
+        }
+
+        index = can_id_table_lookup(&me->rx_index, frame->can_id);
+        if (index == CAN_ID_TABLE_NONE)
+        {
+            continue;
+        }
+        handled++;
+
+        switch (frame->data[0] & 0xF0U)
+        {
+            case ISOTP_PCI_SF:
+                isotp_rx_single(me, index, frame);
+                break;
+            case ISOTP_PCI_FF:
+                isotp_rx_first(me, index, frame);
+                break;
+            case ISOTP_PCI_CF:
+                isotp_rx_consecutive(me, index, frame);
+                break;
+            case ISOTP_PCI_FC:
+                isotp_rx_flow_control(me, index, frame);
+                break;
+            default:
+                break;
+        }
+    }
+
+    me->frames_rx += handled;
+    isotp_flush(me);
+
+    return handled;
+}
+
+
+/**
+ * @name    u32 isotp_poll(isotp_engine* const me, u64 now_ns)
+ * 
+ * @brief   runs the expired timers: timeouts end their transfer, STmin timers send 
+ *          the next consecutive frames, all of them in one batch 
+ * 
+ * @param   isotp_engine* const : object pointer to the struct.
+ *          u64                 : current time 
+ * 
+ * @return  u32 : number of timers fired.
+ */
+u32 isotp_poll(isotp_engine* const me, u64 now_ns)
+{
+    u32 fired;
+
+    CHECK_NULLPTR_RET(me);
+
+    me->now_ns = now_ns;
+    fired = timer_wheel_advance(&me->wheel, now_ns, isotp_timer_expired, me);
+    isotp_flush(me);
+
+    return fired;
+}
+
+
+/**
+ * @name    u32 isotp_process(isotp_engine* const me, u64 now_ns)
+ * 
+ * @brief   one turn of an event loop: reads what the socket has, up to one batch, 
+ *          and runs the timers 
+ * 
+ * @param   isotp_engine* const : object pointer to the struct.
+ *          u64                 : current time 
+ * 
+ * @return  u32 : number of frames read.
+ */
+u32 isotp_process(isotp_engine* const me, u64 now_ns)
+{
+    u32 count = 0U;
+
+    CHECK_NULLPTR_RET(me);
+
+    if (me->socket != NULLPTR)
+    {
+        count = can_socket_recv_batch(me->socket, me->rx_frames, CAN_SOCKET_MAX_BATCH);
+        isotp_receive(me, me->rx_frames, count, now_ns);
+    }
+    isotp_poll(me, now_ns);
+
+    return count;
+}
+
+
+/**
+ * @name    u32 isotp_flush(isotp_engine* const me)
+ * 
+ * @brief   sends the queued frames with one batch 
+ * 
+ * @param   isotp_engine* const : object pointer to the struct.
+ * 
+ * @return  u32 : number of frames sent.
+ */
+u32 isotp_flush(isotp_engine* const me)
+{
+    u32 sent = 0U;
+
+    CHECK_NULLPTR_RET(me);
+
+    if (me->tx_count == 0U)
+    {
+        return 0U;
+    }
+
+    if (me->socket != NULLPTR)
+    {
+        sent = can_socket_send_batch(me->socket, me->tx_frames, me->tx_count);
+    }
+    else if (me->output != NULLPTR)
+    {
+        sent = me->output(me->output_ctx, me->tx_frames, me->tx_count);
+    }
+
+    me->frames_tx      += sent;
+    me->frames_dropped += me->tx_count - sent;
+    me->tx_count = 0U;
+
+    return sent;
+}
+
+
+/**
+ * @name    static can_frame_rec* isotp_next_frame(isotp_engine* const me, isotp_session const * const session)
+ * 
+ * @brief   next free frame of the transmit batch, addressed for the session. A full 
+ *          batch is sent first.
+ * 
+ * @param   isotp_engine* const         : object pointer to the struct.
+ *          isotp_session const * const : sending session 
+ * 
+ * @return  can_frame_rec* : frame to fill.
+ */
+static can_frame_rec* isotp_next_frame(isotp_engine* const me, isotp_session const * const session)
+{
+    can_frame_rec* frame;
+
+    if (me->tx_count == ISOTP_TX_BATCH)
+    {
+        isotp_flush(me);
+    }
+
+    frame = &me->tx_frames[me->tx_count++];
+    frame->timestamp_ns = 0U;
+    frame->can_id   = session->config.tx_id;
+    frame->flags    = 0U;
+    frame->bus      = 0U;
+    frame->reserved = 0U;
+
+    if (session->config.tx_dl > ISOTP_CLASSIC_DL)
+    {
+        frame->flags = CAN_FRAME_FLAG_FD | (((session->config.flags & ISOTP_FLAG_BRS) != 0U) ? CAN_FRAME_FLAG_BRS : 0U);
+    }
+
+    return frame;
+}
+
+
+/**
+ * @name    static void isotp_finish_frame(isotp_session const * const session, can_frame_rec* const frame, u32 len)
+ * 
+ * @brief   sets the length, CAN FD frames are padded up to the next valid length and 
+ *          classic ones to 8 bytes if the session asks for it
+ * 
+ * @param   isotp_session const * const : sending session 
+ *          can_frame_rec* const        : frame 
+ *          u32                         : bytes used 
+ * 
+ * @return  none.
+ */
+static void isotp_finish_frame(isotp_session const * const session, can_frame_rec* const frame, u32 len)
+{
+    u32 padded = len;
+
+    if (session->config.tx_dl > ISOTP_CLASSIC_DL)
+    {
+        padded = isotp_frame_len(len);
+    }
+    else if ((session->config.flags & ISOTP_FLAG_PADDING) != 0U)
+    {
+        padded = ISOTP_CLASSIC_DL;
+    }
+
+    if (padded > len)
+    {
+        memset(&frame->data[len], ISOTP_PAD_BYTE, padded - len);
+    }
+    frame->len = (u8) padded;
+
+    return;
+}
+
+
+/**
+ * @name    static void isotp_send_flow_control(isotp_engine* const me, isotp_session const * const session, u8 status)
+ * 
+ * @brief   queues a flow control frame with the session's BS and STmin 
+ * 
+ * @param   isotp_engine* const         : object pointer to the struct.
+ *          isotp_session const * const : receiving session 
+ *          u8                          : ISOTP_FC_CTS / _WAIT / _OVERFLOW
+ * 
+ * @return  none.
+ */
+static void isotp_send_flow_control(isotp_engine* const me, isotp_session const * const session, u8 status)
+{
+    can_frame_rec* const frame = isotp_next_frame(me, session);
+
+    frame->data[0] = (u8) (ISOTP_PCI_FC | status);
+    frame->data[1] = session->config.block_size;
+    frame->data[2] = session->config.st_min;
+    isotp_finish_frame(session, frame, 3U);
+
+    return;
+}
+
+
+/**
+ * @name    static void isotp_send_consecutive(isotp_engine* const me, u32 index)
+ * 
+ * @brief   queues consecutive frames until the message ends, the block is full or 
+ *          STmin asks for a pause. Without STmin a whole block goes into the batch.
+ * 
+ * @param   isotp_engine* const : object pointer to the struct.
+ *          u32                 : session 
+ * 
+ * @return  none.
+ */
+static void isotp_send_consecutive(isotp_engine* const me, u32 index)
+{
+    isotp_session* const s = &me->sessions[index];
+    u32 const room = s->config.tx_dl - 1U;
+
+    for (;;)
+    {
+        can_frame_rec* const frame = isotp_next_frame(me, s);
+        u32 const n = GET_MIN(s->tx_len - s->tx_pos, room);
+
+        frame->data[0] = (u8) (ISOTP_PCI_CF | s->tx_sn);
+        memcpy(&frame->data[1], &s->tx_data[s->tx_pos], n);
+        isotp_finish_frame(s, frame, n + 1U);
+
+        s->tx_pos += n;
+        s->tx_sn = (u8) ((s->tx_sn + 1U) & 0x0FU);
+
+        if (s->tx_pos == s->tx_len)
+        {
+            isotp_tx_done(me, index, ISOTP_OK);
+            return;
+        }
+
+        if ((s->tx_block_size != 0U) && (--s->tx_block_left == 0U))
+        {
+            s->tx_state = ISOTP_TX_WAIT_FC;
+            timer_wheel_schedule(&me->wheel, &s->tx_timer, me->now_ns + ISOTP_N_BS_NS);
+            return;
+        }
+
+        if (s->tx_st_min_ns != 0U)
+        {
+            timer_wheel_schedule(&me->wheel, &s->tx_timer, me->now_ns + s->tx_st_min_ns);
+            return;
+        }
+    }
+}
+
+
+/**
+ * @name    static void isotp_tx_done(isotp_engine* const me, u32 index, s32 result)
+ * 
+ * @brief   ends a transmission and gives the message back to the caller 
+ * 
+ * @param   isotp_engine* const : object pointer to the struct.
+ *          u32                 : session 
+ *          s32                 : ISOTP_OK or the error 
+ * 
+ * @return  none.
+ */
+static void isotp_tx_done(isotp_engine* const me, u32 index, s32 result)
+{
+    isotp_session* const s = &me->sessions[index];
+
+    timer_wheel_cancel(&me->wheel, &s->tx_timer);
+    s->tx_state = ISOTP_TX_IDLE;
+    s->tx_data  = NULLPTR;
+
+    if (result == ISOTP_OK)
+    {
+        s->messages_tx++;
+        me->messages_tx++;
+    }
+    else
+    {
+        s->errors++;
+        me->errors++;
+    }
+
+    if (me->on_sent != NULLPTR)
+    {
+        me->on_sent(me->ctx, index, result);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static void isotp_rx_abort(isotp_engine* const me, u32 index, s32 result)
+ * 
+ * @brief   drops a message being received and reports why 
+ * 
+ * @param   isotp_engine* const : object pointer to the struct.
+ *          u32                 : session 
+ *          s32                 : error 
+ * 
+ * @return  none.
+ */
+static void isotp_rx_abort(isotp_engine* const me, u32 index, s32 result)
+{
+    isotp_session* const s = &me->sessions[index];
+
+    timer_wheel_cancel(&me->wheel, &s->rx_timer);
+    if (s->rx_state == ISOTP_RX_RECEIVING)
+    {
+        me->free_buffers[me->free_buffer_count++] = (u32) ((s->rx_buffer - me->pool) / me->buffer_size);
+        s->rx_state  = ISOTP_RX_IDLE;
+        s->rx_buffer = NULLPTR;
+    }
+
+    s->errors++;
+    me->errors++;
+
+    if (me->on_receive != NULLPTR)
+    {
+        me->on_receive(me->ctx, index, NULLPTR, 0U, result);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static void isotp_rx_single(isotp_engine* const me, u32 index, can_frame_rec const * const frame)
+ * 
+ * @brief   single frame, delivered straight out of the received frame 
+ * 
+ * @param   isotp_engine* const         : object pointer to the struct.
+ *          u32                         : session 
+ *          can_frame_rec const * const : frame 
+ * 
+ * @return  none.
+ */
+static void isotp_rx_single(isotp_engine* const me, u32 index, can_frame_rec const * const frame)
+{
+    isotp_session* const s = &me->sessions[index];
+    u32 len = frame->data[0] & 0x0FU;
+    u32 offset = 1U;
+
+    // CAN FD single frames longer than 7 bytes carry the length in the second byte 
+    if ((len == 0U) && (frame->len > ISOTP_CLASSIC_DL))
+    {
+        len    = frame->data[1];
+        offset = 2U;
+    }
+
+    if ((len == 0U) || ((len + offset) > frame->len) || ((offset == 1U) && (len > 7U)))
+    {
+        return;
+    }
+
+    if (s->rx_state == ISOTP_RX_RECEIVING)
+    {
+        isotp_rx_abort(me, index, ISOTP_ERR_UNEXPECTED);
+    }
+
+    s->messages_rx++;
+    me->messages_rx++;
+
+    if (me->on_receive != NULLPTR)
+    {
+        me->on_receive(me->ctx, index, &frame->data[offset], len, ISOTP_OK);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static void isotp_rx_first(isotp_engine* const me, u32 index, can_frame_rec const * const frame)
+ * 
+ * @brief   first frame: takes a pool buffer, answers with flow control and waits for 
+ *          the consecutive frames 
+ * 
+ * @param   isotp_engine* const         : object pointer to the struct.
+ *          u32                         : session 
+ *          can_frame_rec const * const : frame 
+ * 
+ * @return  none.
+ */
+static void isotp_rx_first(isotp_engine* const me, u32 index, can_frame_rec const * const frame)
+{
+    isotp_session* const s = &me->sessions[index];
+    u32 len = (((u32) frame->data[0] & 0x0FU) << 8U) | frame->data[1];
+    u32 offset = 2U;
+    u32 n;
+
+    if (frame->len < ISOTP_CLASSIC_DL)
+    {
+        return;
+    }
+
+    if (len == 0U)
+    {
+        len = ((u32) frame->data[2] << 24U) | ((u32) frame->data[3] << 16U) | ((u32) frame->data[4] << 8U) | frame->data[5];
+        offset = 6U;
+    }
+
+    // a message that would have fit into the first frame is malformed 
+    if (len <= (u32) (frame->len - offset))
+    {
+        return;
+    }
+
+    if (s->rx_state == ISOTP_RX_RECEIVING)
+    {
+        isotp_rx_abort(me, index, ISOTP_ERR_UNEXPECTED);
+    }
+
+    if ((len > me->buffer_size) || (me->free_buffer_count == 0U))
+    {
+        isotp_send_flow_control(me, s, ISOTP_FC_OVERFLOW);
+        isotp_rx_abort(me, index, ISOTP_ERR_NO_BUFFER);
+        return;
+    }
+
+    me->free_buffer_count--;
+    s->rx_buffer = &me->pool[(size_t) me->free_buffers[me->free_buffer_count] * me->buffer_size];
+
+    n = frame->len - offset;
+    memcpy(s->rx_buffer, &frame->data[offset], n);
+    s->rx_len         = len;
+    s->rx_pos         = n;
+    s->rx_sn          = 1U;
+    s->rx_block_count = 0U;
+    s->rx_dl          = frame->len;
+    s->rx_state       = ISOTP_RX_RECEIVING;
+
+    isotp_send_flow_control(me, s, ISOTP_FC_CTS);
+    timer_wheel_schedule(&me->wheel, &s->rx_timer, me->now_ns + ISOTP_N_CR_NS);
+
+    return;
+}
+
+
+/**
+ * @name    static void isotp_rx_consecutive(isotp_engine* const me, u32 index, can_frame_rec const * const frame)
+ * 
+ * @brief   consecutive frame, copied to its place in the buffer; the last one hands 
+ *          the message to the receive callback and the buffer back to the pool 
+ * 
+ * @param   isotp_engine* const         : object pointer to the struct.
+ *          u32                         : session 
+ *          can_frame_rec const * const : frame 
+ * 
+ * @return  none.
+ */
+static void isotp_rx_consecutive(isotp_engine* const me, u32 index, can_frame_rec const * const frame)
+{
+    isotp_session* const s = &me->sessions[index];
+    u32 const left = s->rx_len - s->rx_pos;
+    u32 n;
+
+    if (s->rx_state != ISOTP_RX_RECEIVING)
+    {
+        return;
+    }
+
+    // only the last consecutive frame may be shorter than the first frame 
+    if ((frame->len < s->rx_dl) && ((u32) (frame->len - 1U) < left))
+    {
+        return;
+    }
+
+    if ((frame->data[0] & 0x0FU) != s->rx_sn)
+    {
+        isotp_rx_abort(me, index, ISOTP_ERR_WRONG_SN);
+        return;
+    }
+
+    n = GET_MIN(left, (u32) (frame->len - 1U));
+    memcpy(&s->rx_buffer[s->rx_pos], &frame->data[1], n);
+    s->rx_pos += n;
+    s->rx_sn = (u8) ((s->rx_sn + 1U) & 0x0FU);
+
+    if (s->rx_pos == s->rx_len)
+    {
+        u8* const buffer = s->rx_buffer;
+
+        timer_wheel_cancel(&me->wheel, &s->rx_timer);
+        s->rx_state  = ISOTP_RX_IDLE;
+        s->rx_buffer = NULLPTR;
+        s->messages_rx++;
+        me->messages_rx++;
+
+        if (me->on_receive != NULLPTR)
+        {
+            me->on_receive(me->ctx, index, buffer, s->rx_len, ISOTP_OK);
+        }
+        me->free_buffers[me->free_buffer_count++] = (u32) ((buffer - me->pool) / me->buffer_size);
+        return;
+    }
+
+    if ((s->config.block_size != 0U) && (++s->rx_block_count == s->config.block_size))
+    {
+        s->rx_block_count = 0U;
+        isotp_send_flow_control(me, s, ISOTP_FC_CTS);
+    }
+    timer_wheel_schedule(&me->wheel, &s->rx_timer, me->now_ns + ISOTP_N_CR_NS);
+
+    return;
+}
+
+
+/**
+ * @name    static void isotp_rx_flow_control(isotp_engine* const me, u32 index, can_frame_rec const * const frame)
+ * 
+ * @brief   flow control of the receiver: continue, wait or give up 
+ * 
+ * @param   isotp_engine* const         : object pointer to the struct.
+ *          u32                         : session 
+ *          can_frame_rec const * const : frame 
+ * 
+ * @return  none.
+ */
+static void isotp_rx_flow_control(isotp_engine* const me, u32 index, can_frame_rec const * const frame)
+{
+    isotp_session* const s = &me->sessions[index];
+
+    if ((s->tx_state != ISOTP_TX_WAIT_FC) || (frame->len < 3U))
+    {
+        return;
+    }
+
+    switch (frame->data[0] & 0x0FU)
+    {
+        case ISOTP_FC_CTS:
+            timer_wheel_cancel(&me->wheel, &s->tx_timer);
+            s->tx_block_size = frame->data[1];
+            s->tx_block_left = frame->data[1];
+            s->tx_st_min_ns  = isotp_st_min_ns(frame->data[2]);
+            s->tx_wait_count = 0U;
+            s->tx_state      = ISOTP_TX_SENDING;
+            isotp_send_consecutive(me, index);
+            break;
+
+        case ISOTP_FC_WAIT:
+            if (++s->tx_wait_count > ISOTP_WFT_MAX)
+            {
+                isotp_tx_done(me, index, ISOTP_ERR_WFT_OVERRUN);
+            }
+            else
+            {
+                timer_wheel_schedule(&me->wheel, &s->tx_timer, me->now_ns + ISOTP_N_BS_NS);
+            }
+            break;
+
+        case ISOTP_FC_OVERFLOW:
+            isotp_tx_done(me, index, ISOTP_ERR_OVERFLOW);
+            break;
+
+        default:
+            isotp_tx_done(me, index, ISOTP_ERR_INVALID);
+            break;
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static void isotp_timer_expired(void* ctx, timer_wheel_node* node)
+ * 
+ * @brief   timer wheel callback, the node's cookie is the session 
+ * 
+ * @param   void*             : engine 
+ *          timer_wheel_node* : expired timer of a session 
+ * 
+ * @return  none.
+ */
+static void isotp_timer_expired(void* ctx, timer_wheel_node* node)
+{
+    isotp_engine* const me = (isotp_engine*) ctx;
+    u32 const index = node->cookie;
+    isotp_session* const s = &me->sessions[index];
+
+    if (node == &s->rx_timer)
+    {
+        isotp_rx_abort(me, index, ISOTP_ERR_TIMEOUT_CR);
+    }
+    else if (s->tx_state == ISOTP_TX_WAIT_FC)
+    {
+        isotp_tx_done(me, index, ISOTP_ERR_TIMEOUT_BS);
+    }
+    else if (s->tx_state == ISOTP_TX_SENDING)
+    {
+        isotp_send_consecutive(me, index);
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static inline u64 isotp_st_min_ns(u8 st_min)
+ * 
+ * @brief   decodes STmin: 0..127 ms, 0xF1..0xF9 100..900 us, reserved values count 
+ *          as the longest time 
+ * 
+ * @param   u8 : raw STmin 
+ * 
+ * @return  u64 : separation time in ns.
+ */
+static inline u64 isotp_st_min_ns(u8 st_min)
+{
+    if (st_min <= 0x7FU)
+    {
+        return (u64) st_min * 1000000ULL;
+    }
+
+    if ((st_min >= 0xF1U) && (st_min <= 0xF9U))
+    {
+        return (u64) (st_min - 0xF0U) * 100000ULL;
+    }
+
+    return 127ULL * 1000000ULL;
+}
+
+
+/**
+ * @name    static inline u32 isotp_frame_len(u32 len)
+ * 
+ * @brief   shortest valid CAN FD payload length that holds len bytes 
+ * 
+ * @param   u32 : bytes, at most 64 
+ * 
+ * @return  u32 : 0..8, 12, 16, 20, 24, 32, 48 or 64.
+ */
+static inline u32 isotp_frame_len(u32 len)
+{
+    if (len <= 8U)
+    {
+        return len;
+    }
+    if (len <= 24U)
+    {
+        return (len + 3U) & ~3U;
+    }
+    if (len <= 32U)
+    {
+        return 32U;
+    }
+
+    return (len <= 48U) ? 48U : 64U;
+}
@@ -0,0 +1,695 @@
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "checksum.h"
+
+#define __LOG_HISTORY_H_
+#include "log_history.h"
+
+/**
+ * @name    __boolean log_history_open(log_history* const me, u8 __id, char const * const path, u64 capacity, u32 record_size)
+ * 
+ * @brief   opens (or creates) a history file and maps it. A valid existing file keeps 
+ *          its own geometry, so reopening never destroys the stored history. A file 
+ *          with an invalid header is refused, not formatted. The valid range is 
+ *          recovered from the head hint in the header, without a full scan as long as 
+ *          the hint survived.
+ * 
+ * @param   log_history* const : object pointer to the struct.
+ *          u8                 : module id for the registration 
+ *          char const * const : path of the history file 
+ *          u64                : capacity of the record area in bytes (new files only)
+ *          u32                : slot size, power of two between 64 and 4096, 0 for default
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean log_history_open(log_history* const me, u8 __id, char const * const path, u64 capacity, u32 record_size)
+{
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(path);
+
+    if (record_size == 0U)
+    {
+        record_size = LOG_HISTORY_DEFAULT_RECORD_SIZE;
+    }
+
+    if ((LOG_HISTORY_IS_POWER_OF_TWO(record_size) == false) ||
+        (record_size < LOG_HISTORY_MIN_RECORD_SIZE) || (record_size > LOG_HISTORY_MAX_RECORD_SIZE))
+    {
+        return false;
+    }
+
+    me->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (me->fd < 0)
+    {
+        return false;
+    }
+    me->read_only = false;
+
+    if (log_history_map(me, capacity, record_size) == false)
+    {
+        close(me->fd);
+        me->fd = -1;
+        return false;
+    }
+
+    log_history_recover(me);
+
+    module_position = utils_register_module(LOG_HISTORY_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean log_history_open_read_only(log_history* const me, char const * const path)
+ * 
+ * @brief   maps an existing history file read only, used for offline analysis. The file 
+ *          is never modified, not even the head hint.
+ * 
+ * @param   log_history* const : object pointer to the struct.
+ *          char const * const : path of the history file 
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean log_history_open_read_only(log_history* const me, char const * const path)
+{
+    struct stat st;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(path);
+
+    me->fd = open(path, O_RDONLY);
+    if (me->fd < 0)
+    {
+        return false;
+    }
+    me->read_only = true;
+
+    if ((fstat(me->fd, &st) != 0) || ((u64) st.st_size <= LOG_HISTORY_HEADER_SIZE))
+    {
+        close(me->fd);
+        me->fd = -1;
+        return false;
+    }
+
+    me->map_size = (u64) st.st_size;
+    me->file = (log_history_file*) mmap(NULLPTR, me->map_size, PROT_READ, MAP_SHARED, me->fd, 0);
+    if ((void*) me->file == MAP_FAILED)
+    {
+        close(me->fd);
+        me->fd = -1;
+        return false;
+    }
+
+    if (log_history_header_valid(me->file, me->map_size) == false)
+    {
+        munmap(me->file, me->map_size);
+        close(me->fd);
+        me->fd = -1;
+        return false;
+    }
+
+    me->records     = (u8*) me->file + LOG_HISTORY_HEADER_SIZE;
+    me->slot_count  = me->file->slot_count;
+    me->record_size = me->file->record_size;
+
+    log_history_recover(me);
+
+    return true;
+}
+
+
+/**
+ * @name    void log_history_close(log_history* const me)
+ * 
+ * @brief   stores the head hint, unmaps and closes the file. The data is not synced, 
+ *          call log_history_sync() before if it must reach the medium.
+ * 
+ * @param   log_history* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void log_history_close(log_history* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->fd < 0)
+    {
+        return;
+    }
+
+    if (me->read_only == false)
+    {
+        __atomic_store_n(&me->file->head_hint, log_history_newest_seq(me), __ATOMIC_RELAXED);
+        utils_remove_module_registration(module_position);
+    }
+
+    munmap(me->file, me->map_size);
+    close(me->fd);
+
+    me->fd      = -1;
+    me->file    = NULLPTR;
+    me->records = NULLPTR;
+
+    return;
+}
+
+
+/**
+ * @name    __boolean log_history_append(log_history* const me, u8 level, u8 module_id, char const * const msg, u16 len)
+ * 
+ * @brief   appends a record, overwriting the oldest one when the file is full. Safe to 
+ *          be called from several threads, every writer claims its own sequence number.
+ *          Messages longer than the slot are truncated.
+ * 
+ * @param   log_history* const : object pointer to the struct.
+ *          u8                 : level of the event (LOG_EVENT_xxx)
+ *          u8                 : id of the module reporting the event 
+ *          char const * const : message text, does not need to be terminated
+ *          u16                : length of the message
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean log_history_append(log_history* const me, u8 level, u8 module_id, char const * const msg, u16 len)
+{
+    log_history_slot  hdr;
+    log_history_slot* slot;
+    u64 seq;
+    u64 hint;
+    u32 crc;
+    u16 max_len;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(msg);
+
+    if ((me->read_only == true) || (me->file == NULLPTR))
+    {
+        return false;
+    }
+
+    max_len = (u16) (me->record_size - sizeof(log_history_slot));
+    len     = GET_MIN(len, max_len);
+
+    seq  = __atomic_add_fetch(&me->next_seq, 1U, __ATOMIC_RELAXED);
+    slot = LOG_HISTORY_SLOT(me, seq);
+
+    hdr.seq          = seq;
+    hdr.timestamp_ns = log_history_now_ns();
+    hdr.crc          = 0U;
+    hdr.len          = len;
+    hdr.level        = level;
+    hdr.module_id    = module_id;
+    memset(hdr.reserved, 0, sizeof(hdr.reserved));
+    crc     = checksum_crc32c_update(CHECKSUM_CRC32C_INIT, &hdr, sizeof(hdr));
+    hdr.crc = checksum_crc32c_update(crc, msg, len) ^ CHECKSUM_CRC32C_INIT;
+
+    // invalidate first, a crash in the middle leaves a hole and not a mixed record
+    __atomic_store_n(&slot->seq, 0U, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy((u8*) slot + sizeof(log_history_slot), msg, len);
+    slot->timestamp_ns = hdr.timestamp_ns;
+    slot->crc          = hdr.crc;
+    slot->len          = hdr.len;
+    slot->level        = hdr.level;
+    slot->module_id    = hdr.module_id;
+    memset(slot->reserved, 0, sizeof(slot->reserved));
+
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+
+    // the hint only moves forward, recovery walks from it to the real head
+    hint = __atomic_load_n(&me->file->head_hint, __ATOMIC_RELAXED);
+    while ((hint < seq) && 
+           (__atomic_compare_exchange_n(&me->file->head_hint, &hint, seq, true, 
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED) == false))
+    {
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean log_history_sync(log_history* const me, __boolean blocking)
+ * 
+ * @brief   writes the dirty pages of the mapping back to the medium. Not needed to 
+ *          survive a crash of the process, only for power loss or a reset of the machine.
+ * 
+ * @param   log_history* const : object pointer to the struct.
+ *          __boolean          : true waits for the write back, false only schedules it
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean log_history_sync(log_history* const me, __boolean blocking)
+{
+    CHECK_NULLPTR_RET(me);
+
+    if ((me->read_only == true) || (me->file == NULLPTR))
+    {
+        return false;
+    }
+
+    return (msync(me->file, me->map_size, (blocking == true) ? MS_SYNC : MS_ASYNC) == 0);
+}
+
+
+/**
+ * @name    __boolean log_history_get(log_history const * const me, u64 seq, log_history_record* const record)
+ * 
+ * @brief   reads one record. The slot is copied first and validated afterwards, a record
+ *          overwritten in the meantime or torn by a crash is reported as missing.
+ * 
+ * @param   log_history const * const : object pointer to the struct.
+ *          u64                       : sequence number of the record 
+ *          log_history_record* const : destination of the decoded record
+ * 
+ * @return  __boolean                 : true if the record is valid.
+ */
+__boolean log_history_get(log_history const * const me, u64 seq, log_history_record* const record)
+{
+    u8 copy[LOG_HISTORY_MAX_RECORD_SIZE];
+    log_history_slot const * slot;
+    log_history_slot* hdr = (log_history_slot*) copy;
+    u32 crc;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(record);
+
+    if ((seq == 0U) || (seq < log_history_oldest_seq(me)) || (seq > log_history_newest_seq(me)))
+    {
+        return false;
+    }
+
+    slot = LOG_HISTORY_SLOT(me, seq);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq)
+    {
+        return false;
+    }
+
+    memcpy(copy, slot, me->record_size);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+    {
+        return false;
+    }
+
+    if ((hdr->seq != seq) || (hdr->len > (me->record_size - sizeof(log_history_slot))))
+    {
+        return false;
+    }
+
+    crc      = hdr->crc;
+    hdr->crc = 0U;
+    if (checksum_crc32c(copy, sizeof(log_history_slot) + hdr->len) != crc)
+    {
+        return false;
+    }
+
+    record->seq          = seq;
+    record->timestamp_ns = hdr->timestamp_ns;
+    record->level        = hdr->level;
+    record->module_id    = hdr->module_id;
+    record->len          = hdr->len;
+    memcpy(record->msg, copy + sizeof(log_history_slot), hdr->len);
+    record->msg[hdr->len] = '\0';
+
+    return true;
+}
+
+
+/**
+ * @name    u64 log_history_newest_seq(log_history const * const me)
+ * 
+ * @brief   last sequence number handed out, 0 when the history is empty
+ * 
+ * @param   log_history const * const : object pointer to the struct.
+ * 
+ * @return  u64 : newest sequence number.
+ */
+u64 log_history_newest_seq(log_history const * const me)
+{
+    CHECK_NULLPTR_RET(me);
+    return __atomic_load_n(&me->next_seq, __ATOMIC_ACQUIRE);
+}
+
+
+/**
+ * @name    u64 log_history_oldest_seq(log_history const * const me)
+ * 
+ * @brief   oldest sequence number that has not been overwritten yet 
+ * 
+ * @param   log_history const * const : object pointer to the struct.
+ * 
+ * @return  u64 : oldest sequence number, bigger than the newest one if empty.
+ */
+u64 log_history_oldest_seq(log_history const * const me)
+{
+    u64 newest;
+
+    CHECK_NULLPTR_RET(me);
+
+    newest = log_history_newest_seq(me);
+    return (newest >= me->slot_count) ? (newest - me->slot_count + 1U) : 1U;
+}
+
+
+/**
+ * @name    u64 log_history_for_each(log_history const * const me, u64 from_seq, log_history_visit visit, void* const ctx)
+ * 
+ * @brief   visits all valid records from oldest to newest, holes are skipped
+ * 
+ * @param   log_history const * const : object pointer to the struct.
+ *          u64                       : first sequence of interest, 0 for all
+ *          log_history_visit         : callback for every valid record 
+ *          void* const               : context passed to the callback 
+ * 
+ * @return  u64 : number of visited records.
+ */
+u64 log_history_for_each(log_history const * const me, u64 from_seq, log_history_visit visit, void* const ctx)
+{
+    log_history_record record;
+    u64 seq;
+    u64 newest;
+    u64 count = 0U;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(visit);
+
+    newest = log_history_newest_seq(me);
+    seq    = GET_MAX(from_seq, log_history_oldest_seq(me));
+
+    for (; seq <= newest; ++seq)
+    {
+        if (log_history_get(me, seq, &record) == true)
+        {
+            visit(ctx, &record);
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+
+/**
+ * @name    static __boolean log_history_map(log_history* const me, u64 capacity, u32 record_size)
+ * 
+ * @brief   sizes and maps the opened file. An empty file is formatted, so is a file 
+ *          whose header is still all zero because the process died between allocation 
+ *          and formatting. A file whose header is not valid is refused instead of 
+ *          being overwritten.
+ * 
+ * @param   log_history* const : object pointer to the struct.
+ *          u64                : requested capacity of the record area in bytes 
+ *          u32                : requested slot size 
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+static __boolean log_history_map(log_history* const me, u64 capacity, u32 record_size)
+{
+    struct stat st;
+    u64 slot_count = 16U;
+    __boolean format = true;
+
+    while ((slot_count * 2U * record_size) <= capacity)
+    {
+        slot_count *= 2U;
+    }
+
+    if (fstat(me->fd, &st) != 0)
+    {
+        return false;
+    }
+
+    // adopt the geometry of a valid file, whatever was requested. Data that cannot be 
+    // read is left alone, the caller decides what happens to it.
+    if (st.st_size != 0)
+    {
+        log_history_file hdr;
+        size_t const len = GET_MIN((size_t) st.st_size, sizeof(hdr));
+
+        // a short file reads as a header padded with zeros 
+        memset(&hdr, 0, sizeof(hdr));
+        if (pread(me->fd, &hdr, len, 0) != (ssize_t) len)
+        {
+            return false;
+        }
+        if (log_history_header_blank(&hdr) == false)
+        {
+            if (((u64) st.st_size <= LOG_HISTORY_HEADER_SIZE) || 
+                (log_history_header_valid(&hdr, (u64) st.st_size) == false))
+            {
+                return false;
+            }
+            slot_count  = hdr.slot_count;
+            record_size = hdr.record_size;
+            format      = false;
+        }
+    }
+
+    me->map_size = LOG_HISTORY_HEADER_SIZE + (slot_count * record_size);
+
+    // a blank file left by an earlier attempt may be larger than the requested geometry 
+    if ((format == true) && ((u64) st.st_size > me->map_size) && (ftruncate(me->fd, (off_t) me->map_size) != 0))
+    {
+        return false;
+    }
+    if ((format == true) && (posix_fallocate(me->fd, 0, (off_t) me->map_size) != 0))
+    {
+        return false;
+    }
+
+    me->file = (log_history_file*) mmap(NULLPTR, me->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, me->fd, 0);
+    if ((void*) me->file == MAP_FAILED)
+    {
+        me->file = NULLPTR;
+        return false;
+    }
+
+    me->records     = (u8*) me->file + LOG_HISTORY_HEADER_SIZE;
+    me->slot_count  = slot_count;
+    me->record_size = record_size;
+
+    if (format == true)
+    {
+        log_history_format(me, slot_count, record_size);
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    static __boolean log_history_header_valid(log_history_file const * const file, u64 map_size)
+ * 
+ * @brief   checks magic, version, checksum and that the geometry matches the file size
+ * 
+ * @param   log_history_file const * const : header to be checked 
+ *          u64                            : size of the file 
+ * 
+ * @return  __boolean : true if the header can be used.
+ */
+static __boolean log_history_header_valid(log_history_file const * const file, u64 map_size)
+{
+    if ((memcmp(file->magic, LOG_HISTORY_MAGIC, sizeof(file->magic)) != 0) || 
+        (file->version != LOG_HISTORY_VERSION))
+    {
+        return false;
+    }
+
+    if (checksum_crc32c(file, offsetof(log_history_file, hdr_crc)) != file->hdr_crc)
+    {
+        return false;
+    }
+
+    if ((LOG_HISTORY_IS_POWER_OF_TWO(file->record_size) == false) || 
+        (LOG_HISTORY_IS_POWER_OF_TWO(file->slot_count) == false)  ||
+        (file->record_size < LOG_HISTORY_MIN_RECORD_SIZE)           || 
+        (file->record_size > LOG_HISTORY_MAX_RECORD_SIZE))
+    {
+        return false;
+    }
+
+    return (map_size == (LOG_HISTORY_HEADER_SIZE + (file->slot_count * file->record_size)));
+}
+
+
+/**
+ * @name    static __boolean log_history_header_blank(log_history_file const * const file)
+ * 
+ * @brief   checks for a header that was never written, the file was allocated but not 
+ *          formatted yet 
+ * 
+ * @param   log_history_file const * const : header to be checked 
+ * 
+ * @return  __boolean : true if every byte of the header is zero.
+ */
+static __boolean log_history_header_blank(log_history_file const * const file)
+{
+    u8 const * const bytes = (u8 const *) file;
+    u32 i;
+
+    for (i = 0U; i < sizeof(*file); ++i)
+    {
+        if (bytes[i] != 0U)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    static void log_history_format(log_history* const me, u64 slot_count, u32 record_size)
+ * 
+ * @brief   writes a fresh header, the record area is zero from the allocation 
+ * 
+ * @param   log_history* const : object pointer to the struct.
+ *          u64                : number of slots 
+ *          u32                : size of a slot
+ * 
+ * @return  none.
+ */
+static void log_history_format(log_history* const me, u64 slot_count, u32 record_size)
+{
+    log_history_file* const file = me->file;
+
+    memset(file, 0, LOG_HISTORY_HEADER_SIZE);
+    memcpy(file->magic, LOG_HISTORY_MAGIC, sizeof(file->magic));
+    file->version     = LOG_HISTORY_VERSION;
+    file->record_size = record_size;
+    file->slot_count  = slot_count;
+    file->created_ns  = log_history_now_ns();
+    file->hdr_crc     = checksum_crc32c(file, offsetof(log_history_file, hdr_crc));
+    file->head_hint   = 0U;
+
+    return;
+}
+
+
+/**
+ * @name    static void log_history_recover(log_history* const me)
+ * 
+ * @brief   finds the newest valid record. Starts at the head hint and walks forward over 
+ *          the records written after the last hint update, tolerating holes left by 
+ *          writers that died half way. Only a lost hint costs a scan over all slots.
+ * 
+ * @param   log_history* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+static void log_history_recover(log_history* const me)
+{
+    u64 newest = __atomic_load_n(&me->file->head_hint, __ATOMIC_RELAXED);
+    u64 seq;
+    u64 holes = 0U;
+    u64 walked = 0U;
+
+    if ((newest != 0U) && (log_history_slot_valid(me, newest) == false))
+    {
+        u64 i;
+        newest = 0U;
+        for (i = 0U; i < me->slot_count; ++i)
+        {
+            log_history_slot const * slot = (log_history_slot const *) (me->records + (i * me->record_size));
+            seq = slot->seq;
+            if ((seq > newest) && ((seq & (me->slot_count - 1U)) == i) && 
+                (log_history_slot_valid(me, seq) == true))
+            {
+                newest = seq;
+            }
+        }
+    }
+
+    for (seq = newest + 1U; (holes < LOG_HISTORY_MAX_HOLES) && (walked < me->slot_count); ++seq, ++walked)
+    {
+        if (log_history_slot_valid(me, seq) == true)
+        {
+            newest = seq;
+            holes  = 0U;
+        }
+        else
+        {
+            ++holes;
+        }
+    }
+
+    me->next_seq = newest;
+    if (me->read_only == false)
+    {
+        me->file->head_hint = newest;
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static inline __boolean log_history_slot_valid(log_history const * const me, u64 seq)
+ * 
+ * @brief   checks that the slot of seq holds exactly that record and is not torn
+ * 
+ * @param   log_history const * const : object pointer to the struct.
+ *          u64                       : expected sequence number
+ * 
+ * @return  __boolean : true if the record is complete.
+ */
+static inline __boolean log_history_slot_valid(log_history const * const me, u64 seq)
+{
+    log_history_slot const * const slot = LOG_HISTORY_SLOT(me, seq);
+
+    if ((seq == 0U) || (slot->seq != seq) || (slot->len > (me->record_size - sizeof(log_history_slot))))
+    {
+        return false;
+    }
+
+    return (log_history_slot_crc(slot) == slot->crc);
+}
+
+
+/**
+ * @name    static inline u32 log_history_slot_crc(log_history_slot const * const slot)
+ * 
+ * @brief   CRC-32C over the slot header with the crc field taken as zero, and the message
+ * 
+ * @param   log_history_slot const * const : slot in the mapping 
+ * 
+ * @return  u32 : checksum of the slot.
+ */
+static inline u32 log_history_slot_crc(log_history_slot const * const slot)
+{
+    log_history_slot hdr = *slot;
+    u32 crc;
+
+    hdr.crc = 0U;
+    crc = checksum_crc32c_update(CHECKSUM_CRC32C_INIT, &hdr, sizeof(hdr));
+    crc = checksum_crc32c_update(crc, (u8 const *) slot + sizeof(log_history_slot), hdr.len);
+
+    return crc ^ CHECKSUM_CRC32C_INIT;
+}
+
+
+/**
+ * @name    static inline u64 log_history_now_ns(void)
+ * 
+ * @brief   wall clock time, records must stay comparable across reboots
+ * 
+ * @param   none.
+ * 
+ * @return  u64 : nanoseconds since the epoch.
+ */
+static inline u64 log_history_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+}
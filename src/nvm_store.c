@@ -0,0 +1,1035 @@
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utils.h"
+#include "checksum.h"
+#include "flash_sim.h"
+#include "perf_counters.h"
+
+#define __NVM_STORE_H_
+#include "nvm_store.h"
+
+/**
+ * @name    __boolean nvm_store_init(nvm_store* const me, u8 __id, flash_sim* const flash, u32 max_keys, u32 max_value)
+ * 
+ * @brief   recovers the store from the flash and loads every key into RAM. A blank
+ *          flash is a store without keys, nothing is formatted up front.
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ *          u8               : module id for the registration
+ *          flash_sim* const : opened flash, used by the store only from now on
+ *          u32              : keys 0 .. max_keys - 1
+ *          u32              : longest value in bytes, up to NVM_STORE_MAX_VALUE
+ * 
+ * @return  __boolean        : false if the flash is too small to hold all keys at their
+ *                             longest twice over, or out of memory.
+ */
+__boolean nvm_store_init(nvm_store* const me, u8 __id, flash_sim* const flash, u32 max_keys, u32 max_value)
+{
+    struct timespec start;
+    struct timespec end;
+    u32 unit;
+    u32 capacity;
+    u32 entries;
+    u64 needed;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(flash);
+
+    if ((max_keys == 0U) || (max_keys > NVM_STORE_MAX_KEYS) || (max_value > NVM_STORE_MAX_VALUE) ||
+        (flash->page_count < (NVM_STORE_RESERVE_PAGES + 2U)))
+    {
+        return false;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    memset(me, 0, sizeof(*me));
+    me->flash      = flash;
+    me->page_count = flash->page_count;
+    me->unit       = GET_MAX(flash->write_unit, 4U);
+    me->max_keys   = max_keys;
+    me->max_value  = max_value;
+    me->active     = NVM_STORE_NONE;
+    me->interval_ns = NVM_STORE_DEFAULT_INTERVAL_NS;
+    unit = me->unit;
+
+    // every live record also needs its summary entry; garbage collection only makes
+    // progress while the live data fills clearly less than the pages outside the reserve
+    capacity = flash->page_size - sizeof(nvm_store_page_hdr) - sizeof(nvm_store_summary_hdr) - unit;
+    needed   = (u64) max_keys * (nvm_store_record_size(me, max_value) + sizeof(nvm_store_summary_entry));
+    if ((nvm_store_record_size(me, max_value) > capacity) ||
+        ((needed * 2U) > ((u64) (me->page_count - NVM_STORE_RESERVE_PAGES - 1U) * capacity)))
+    {
+        return false;
+    }
+
+    entries      = (flash->page_size - sizeof(nvm_store_page_hdr)) / nvm_store_record_size(me, 0U);
+    me->pages    = (nvm_store_page*) calloc(me->page_count, sizeof(nvm_store_page));
+    me->index    = (nvm_store_entry*) malloc(max_keys * sizeof(nvm_store_entry));
+    me->values   = (u8*) malloc((size_t) max_keys * GET_MAX(max_value, 1U));
+    me->lengths  = (u16*) calloc(max_keys, sizeof(u16));
+    me->dirty    = (u64*) calloc((max_keys + 63U) / 64U, sizeof(u64));
+    me->pending  = (u64*) calloc((max_keys + 63U) / 64U, sizeof(u64));
+    me->scratch  = (u8*) malloc(GET_MAX(max_value, 1U));
+    me->record   = (u8*) malloc(nvm_store_record_size(me, max_value));
+    me->summary  = (u8*) malloc(NVM_STORE_ALIGN(NVM_STORE_SUMMARY_SIZE(entries), unit));
+
+    if ((me->pages == NULLPTR) || (me->index == NULLPTR) || (me->values == NULLPTR) || (me->lengths == NULLPTR) ||
+        (me->dirty == NULLPTR) || (me->pending == NULLPTR) || (me->scratch == NULLPTR) || (me->record == NULLPTR) ||
+        (me->summary == NULLPTR))
+    {
+        free(me->pages);
+        free(me->index);
+        free(me->values);
+        free(me->lengths);
+        free(me->dirty);
+        free(me->pending);
+        free(me->scratch);
+        free(me->record);
+        free(me->summary);
+        memset(me, 0, sizeof(*me));
+        return false;
+    }
+
+    pthread_mutex_init(&me->lock, NULLPTR);
+    pthread_mutex_init(&me->flash_lock, NULLPTR);
+    pthread_cond_init(&me->wake, NULLPTR);
+
+    (void) nvm_store_recover(me);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    me->stats.startup_ns = ((u64) (end.tv_sec - start.tv_sec) * 1000000000ULL) + (u64) end.tv_nsec - (u64) start.tv_nsec;
+
+    me->module_position = utils_register_module(NVM_STORE_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void nvm_store_destruct(nvm_store* const me)
+ * 
+ * @brief   stops the worker, which persists what is still pending, and frees the store.
+ *          The flash stays open.
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void nvm_store_destruct(nvm_store* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->pages == NULLPTR)
+    {
+        return;
+    }
+
+    nvm_store_stop(me);
+    pthread_cond_destroy(&me->wake);
+    pthread_mutex_destroy(&me->flash_lock);
+    pthread_mutex_destroy(&me->lock);
+    utils_remove_module_registration(me->module_position);
+
+    free(me->pages);
+    free(me->index);
+    free(me->values);
+    free(me->lengths);
+    free(me->dirty);
+    free(me->pending);
+    free(me->scratch);
+    free(me->record);
+    free(me->summary);
+    me->pages   = NULLPTR;
+    me->index   = NULLPTR;
+    me->values  = NULLPTR;
+    me->lengths = NULLPTR;
+    me->dirty   = NULLPTR;
+    me->pending = NULLPTR;
+    me->scratch = NULLPTR;
+    me->record  = NULLPTR;
+    me->summary = NULLPTR;
+
+    return;
+}
+
+
+/**
+ * @name    __boolean nvm_store_start(nvm_store* const me, u64 interval_ns)
+ * 
+ * @brief   starts the worker thread that persists the changed keys once per interval
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ *          u64              : time between two rounds, 0 for the default
+ * 
+ * @return  __boolean        : true if success, false if something went wrong.
+ */
+__boolean nvm_store_start(nvm_store* const me, u64 interval_ns)
+{
+    CHECK_NULLPTR_RET(me);
+
+    if (me->running == true)
+    {
+        return false;
+    }
+
+    me->interval_ns = (interval_ns != 0U) ? interval_ns : NVM_STORE_DEFAULT_INTERVAL_NS;
+    me->running = true;
+    if (pthread_create(&me->thread, NULLPTR, nvm_store_thread, me) != 0)
+    {
+        me->running = false;
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    void nvm_store_stop(nvm_store* const me)
+ * 
+ * @brief   stops the worker thread after a last round over the pending keys
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void nvm_store_stop(nvm_store* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    pthread_mutex_lock(&me->lock);
+    if (me->running == false)
+    {
+        pthread_mutex_unlock(&me->lock);
+        return;
+    }
+    me->running = false;
+    pthread_cond_signal(&me->wake);
+    pthread_mutex_unlock(&me->lock);
+
+    pthread_join(me->thread, NULLPTR);
+
+    return;
+}
+
+
+/**
+ * @name    __boolean nvm_store_write(nvm_store* const me, u32 key, void const * const data, u32 len)
+ * 
+ * @brief   changes the RAM copy of a key and marks it for the next round of the worker.
+ *          Never touches the flash, the lock is only shared with short copies.
+ * 
+ * @param   nvm_store* const   : object pointer to the struct.
+ *          u32                : key
+ *          void const * const : value
+ *          u32                : length of the value
+ * 
+ * @return  __boolean          : false for an unknown key or a value that is too long.
+ */
+__boolean nvm_store_write(nvm_store* const me, u32 key, void const * const data, u32 len)
+{
+    u64 bit;
+
+    CHECK_NULLPTR_RET(me);
+
+    if ((key >= me->max_keys) || (len > me->max_value) || ((data == NULLPTR) && (len != 0U)))
+    {
+        return false;
+    }
+
+    bit = 1ULL << (key & 63U);
+
+    pthread_mutex_lock(&me->lock);
+    if (len != 0U)
+    {
+        memcpy(&me->values[(size_t) key * me->max_value], data, len);
+    }
+    me->lengths[key] = (u16) len;
+    if ((me->dirty[key / 64U] & bit) != 0U)
+    {
+        me->stats.coalesced++;
+    }
+    me->dirty[key / 64U] |= bit;
+    me->stats.writes++;
+    pthread_mutex_unlock(&me->lock);
+
+    return true;
+}
+
+
+/**
+ * @name    u32 nvm_store_read(nvm_store* const me, u32 key, void* const data, u32 max)
+ * 
+ * @brief   copies the current value of a key from RAM, written or recovered
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ *          u32              : key
+ *          void* const      : destination
+ *          u32              : size of the destination, longer values are cut
+ * 
+ * @return  u32 : length of the value, 0 if the key holds none.
+ */
+u32 nvm_store_read(nvm_store* const me, u32 key, void* const data, u32 max)
+{
+    u32 len;
+
+    if ((me == NULLPTR) || (data == NULLPTR) || (key >= me->max_keys))
+    {
+        return 0U;
+    }
+
+    pthread_mutex_lock(&me->lock);
+    len = me->lengths[key];
+    memcpy(data, &me->values[(size_t) key * me->max_value], GET_MIN(len, max));
+    pthread_mutex_unlock(&me->lock);
+
+    return len;
+}
+
+
+/**
+ * @name    u32 nvm_store_flush(nvm_store* const me)
+ * 
+ * @brief   persists every key changed since the last round, one record per key with
+ *          its latest value. Done by the worker, callable directly, e.g. before a
+ *          planned shutdown or without a worker.
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ * 
+ * @return  u32 : number of records written.
+ */
+u32 nvm_store_flush(nvm_store* const me)
+{
+    u32 const words = (me != NULLPTR) ? ((me->max_keys + 63U) / 64U) : 0U;
+    u32 written = 0U;
+    u32 failed = 0U;
+    u64 start;
+    u32 w;
+
+    CHECK_NULLPTR_RET(me);
+
+    pthread_mutex_lock(&me->flash_lock);
+    start = perf_counters_enter();
+
+    pthread_mutex_lock(&me->lock);
+    for (w = 0U; w < words; w++)
+    {
+        me->pending[w] = me->dirty[w];
+        me->dirty[w]   = 0U;
+    }
+    pthread_mutex_unlock(&me->lock);
+
+    for (w = 0U; w < words; w++)
+    {
+        while (me->pending[w] != 0U)
+        {
+            u32 const key = (w * 64U) + (u32) __builtin_ctzll(me->pending[w]);
+            u32 len;
+            u32 crc;
+
+            me->pending[w] &= me->pending[w] - 1U;
+
+            pthread_mutex_lock(&me->lock);
+            len = me->lengths[key];
+            memcpy(me->scratch, &me->values[(size_t) key * me->max_value], len);
+            pthread_mutex_unlock(&me->lock);
+
+            crc = nvm_store_record_crc(key, len, me->scratch);
+            if ((me->index[key].page != NVM_STORE_NONE) && (me->index[key].crc == crc) && (me->index[key].len == len))
+            {
+                me->stats.unchanged++;
+                continue;
+            }
+
+            if (me->free_pages < NVM_STORE_RESERVE_PAGES)
+            {
+                nvm_store_collect(me);
+            }
+
+            if (nvm_store_append(me, key, me->scratch, len) == false)
+            {
+                // tried again next round
+                me->stats.errors++;
+                failed++;
+                pthread_mutex_lock(&me->lock);
+                me->dirty[w] |= 1ULL << (key & 63U);
+                pthread_mutex_unlock(&me->lock);
+                continue;
+            }
+            written++;
+        }
+    }
+
+    perf_counters_count(me->module_position, written, 0U);
+    if (failed != 0U)
+    {
+        perf_counters_fail(me->module_position, failed);
+    }
+    perf_counters_exit(me->module_position, start);
+    pthread_mutex_unlock(&me->flash_lock);
+
+    return written;
+}
+
+
+/**
+ * @name    void nvm_store_get_stats(nvm_store* const me, nvm_store_stats* const stats)
+ * 
+ * @brief   copies the counters
+ * 
+ * @param   nvm_store* const       : object pointer to the struct.
+ *          nvm_store_stats* const : destination
+ * 
+ * @return  none.
+ */
+void nvm_store_get_stats(nvm_store* const me, nvm_store_stats* const stats)
+{
+    CHECK_NULLPTR_VOID(me);
+    CHECK_NULLPTR_VOID(stats);
+
+    pthread_mutex_lock(&me->flash_lock);
+    pthread_mutex_lock(&me->lock);
+    *stats = me->stats;
+    pthread_mutex_unlock(&me->lock);
+    pthread_mutex_unlock(&me->flash_lock);
+
+    return;
+}
+
+
+/**
+ * @name    static void* nvm_store_thread(void* arg)
+ * 
+ * @brief   worker: one flush per interval, a last one when stopped
+ * 
+ * @param   void* : the store
+ * 
+ * @return  void* : NULLPTR.
+ */
+static void* nvm_store_thread(void* arg)
+{
+    nvm_store* const me = (nvm_store*) arg;
+    struct timespec deadline;
+    __boolean stop;
+
+    do
+    {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec  += (time_t) (me->interval_ns / 1000000000ULL);
+        deadline.tv_nsec += (long) (me->interval_ns % 1000000000ULL);
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        pthread_mutex_lock(&me->lock);
+        if (me->running == true)
+        {
+            (void) pthread_cond_timedwait(&me->wake, &me->lock, &deadline);
+        }
+        stop = (me->running == false) ? true : false;
+        pthread_mutex_unlock(&me->lock);
+
+        (void) nvm_store_flush(me);
+    } while (stop == false);
+
+    return NULLPTR;
+}
+
+
+/**
+ * @name    static __boolean nvm_store_recover(nvm_store* const me)
+ * 
+ * @brief   rebuilds the index from the flash. Pages are visited newest first, so the
+ *          first record found of a key is its newest. Sealed pages are read through
+ *          their summary, the others record by record.
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ * 
+ * @return  __boolean        : true if all live values passed their CRC.
+ */
+static __boolean nvm_store_recover(nvm_store* const me)
+{
+    u32* order = (u32*) malloc(me->page_count * sizeof(u32));
+    u32 valid = 0U;
+    u32 max_seq = 0U;
+    u32 max_erase = 0U;
+    __boolean ok = true;
+    u32 k;
+    u32 p;
+    u32 i;
+
+    for (k = 0U; k < me->max_keys; k++)
+    {
+        me->index[k].page = NVM_STORE_NONE;
+    }
+
+    for (p = 0U; p < me->page_count; p++)
+    {
+        u8 const * const base = flash_sim_page(me->flash, p);
+        nvm_store_page* const page = &me->pages[p];
+        nvm_store_page_hdr hdr;
+
+        memcpy(&hdr, base, sizeof(hdr));
+        memset(page, 0, sizeof(*page));
+
+        if ((hdr.magic == NVM_STORE_PAGE_MAGIC) && (checksum_crc32c(&hdr, offsetof(nvm_store_page_hdr, crc)) == hdr.crc))
+        {
+            page->state       = (hdr.summary_offset != NVM_STORE_ERASED_WORD) ? NVM_STORE_PAGE_SEALED : NVM_STORE_PAGE_ACTIVE;
+            page->seq         = hdr.seq;
+            page->erase_count = hdr.erase_count;
+            max_seq   = GET_MAX(max_seq, hdr.seq);
+            max_erase = GET_MAX(max_erase, hdr.erase_count);
+
+            // newest first, insertion into the sorted prefix
+            if (order != NULLPTR)
+            {
+                i = valid;
+                while ((i > 0U) && (me->pages[order[i - 1U]].seq < hdr.seq))
+                {
+                    order[i] = order[i - 1U];
+                    i--;
+                }
+                order[i] = p;
+            }
+            valid++;
+            continue;
+        }
+
+        // a page is written only after its header, a blank header is a blank page
+        page->state  = NVM_STORE_PAGE_FREE;
+        page->erased = true;
+        for (i = 0U; i < sizeof(hdr); i++)
+        {
+            if (base[i] != FLASH_SIM_ERASED)
+            {
+                page->erased = false;
+                break;
+            }
+        }
+        me->free_pages++;
+    }
+
+    // the flash does not keep the wear of pages without a header, assume the worst known
+    for (p = 0U; p < me->page_count; p++)
+    {
+        if (me->pages[p].state == NVM_STORE_PAGE_FREE)
+        {
+            me->pages[p].erase_count = max_erase;
+        }
+    }
+
+    if (order == NULLPTR)
+    {
+        return false;
+    }
+
+    for (i = 0U; i < valid; i++)
+    {
+        p = order[i];
+
+        // only the newest page stays open, older open pages were cut off while sealing
+        if (me->pages[p].state == NVM_STORE_PAGE_ACTIVE)
+        {
+            if (i == 0U)
+            {
+                me->active = p;
+            }
+            else
+            {
+                me->pages[p].state = NVM_STORE_PAGE_SEALED;
+            }
+        }
+        nvm_store_recover_page(me, p);
+    }
+    free(order);
+
+    me->next_seq = max_seq + 1U;
+
+    // load the values, the live accounting follows the index
+    for (k = 0U; k < me->max_keys; k++)
+    {
+        nvm_store_entry* const entry = &me->index[k];
+        u8 const * base;
+        nvm_store_record_hdr rec;
+
+        if (entry->page == NVM_STORE_NONE)
+        {
+            continue;
+        }
+
+        base = flash_sim_page(me->flash, entry->page) + entry->offset;
+        memcpy(&rec, base, sizeof(rec));
+        if ((rec.key != k) || (rec.len > me->max_value) ||
+            (nvm_store_record_crc(k, rec.len, base + sizeof(rec)) != rec.crc))
+        {
+            entry->page = NVM_STORE_NONE;
+            me->stats.errors++;
+            ok = false;
+            continue;
+        }
+
+        memcpy(&me->values[(size_t) k * me->max_value], base + sizeof(rec), rec.len);
+        me->lengths[k] = rec.len;
+        entry->len = rec.len;
+        entry->crc = rec.crc;
+        me->pages[entry->page].live += nvm_store_record_size(me, rec.len);
+        me->pages[entry->page].keys++;
+    }
+
+    return ok;
+}
+
+
+/**
+ * @name    static void nvm_store_recover_page(nvm_store* const me, u32 page)
+ * 
+ * @brief   enters the records of one page into the index, from the summary of a sealed
+ *          page or by walking the records up to the first blank or broken one
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ *          u32              : page index
+ * 
+ * @return  none.
+ */
+static void nvm_store_recover_page(nvm_store* const me, u32 page)
+{
+    u32 const page_size = me->flash->page_size;
+    u8 const * const base = flash_sim_page(me->flash, page);
+    nvm_store_page_hdr hdr;
+    nvm_store_summary_hdr summary;
+    nvm_store_record_hdr rec;
+    u32 offset = sizeof(nvm_store_page_hdr);
+    u32 i;
+
+    memcpy(&hdr, base, sizeof(hdr));
+
+    if ((hdr.summary_offset != NVM_STORE_ERASED_WORD) &&
+        (hdr.summary_offset <= (page_size - sizeof(summary))))
+    {
+        memcpy(&summary, base + hdr.summary_offset, sizeof(summary));
+        if ((summary.magic == NVM_STORE_SUMMARY_MAGIC) &&
+            (summary.count <= ((page_size - hdr.summary_offset - sizeof(summary)) / sizeof(nvm_store_summary_entry))) &&
+            (checksum_crc32c(base + hdr.summary_offset, NVM_STORE_SUMMARY_SIZE(summary.count)) == hdr.summary_crc))
+        {
+            for (i = 0U; i < summary.count; i++)
+            {
+                nvm_store_summary_entry entry;
+
+                memcpy(&entry, base + hdr.summary_offset + NVM_STORE_SUMMARY_SIZE(i), sizeof(entry));
+                if ((entry.offset + nvm_store_record_size(me, entry.len)) <= hdr.summary_offset)
+                {
+                    nvm_store_take(me, page, entry.offset, entry.key, entry.len);
+                }
+            }
+            me->stats.summary_pages++;
+            return;
+        }
+    }
+
+    while ((offset + sizeof(rec)) <= page_size)
+    {
+        memcpy(&rec, base + offset, sizeof(rec));
+        if (rec.key == NVM_STORE_ERASED_KEY)
+        {
+            break;
+        }
+
+        // a torn record ends the page, nothing is appended behind it anymore
+        if ((rec.len > NVM_STORE_MAX_VALUE) || ((offset + nvm_store_record_size(me, rec.len)) > page_size) ||
+            (nvm_store_record_crc(rec.key, rec.len, base + offset + sizeof(rec)) != rec.crc))
+        {
+            offset = page_size;
+            break;
+        }
+
+        nvm_store_take(me, page, offset, rec.key, rec.len);
+        offset += nvm_store_record_size(me, rec.len);
+    }
+
+    me->pages[page].used = offset;
+    me->stats.scanned_pages++;
+
+    return;
+}
+
+
+/**
+ * @name    static void nvm_store_take(nvm_store* const me, u32 page, u32 offset, u16 key, u16 len)
+ * 
+ * @brief   enters a record found during the recovery unless a newer page has the key
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ *          u32              : page of the record
+ *          u32              : offset of the record
+ *          u16              : key
+ *          u16              : length of the value
+ * 
+ * @return  none.
+ */
+static void nvm_store_take(nvm_store* const me, u32 page, u32 offset, u16 key, u16 len)
+{
+    nvm_store_entry* entry;
+
+    if (key >= me->max_keys)
+    {
+        return;
+    }
+
+    entry = &me->index[key];
+    if ((entry->page == NVM_STORE_NONE) || (entry->page == page))
+    {
+        entry->page   = page;
+        entry->offset = offset;
+        entry->len    = len;
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static __boolean nvm_store_append(nvm_store* const me, u32 key, u8 const * const value, u32 len)
+ * 
+ * @brief   programs one record into the active page, sealing it and opening the next
+ *          one when the record and the grown summary would not fit anymore
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ *          u32              : key
+ *          u8 const * const : value
+ *          u32              : length of the value
+ * 
+ * @return  __boolean        : false if no page could be opened or the program failed.
+ */
+static __boolean nvm_store_append(nvm_store* const me, u32 key, u8 const * const value, u32 len)
+{
+    u32 const size = nvm_store_record_size(me, len);
+    nvm_store_entry* const entry = &me->index[key];
+    nvm_store_record_hdr rec;
+    nvm_store_page* page;
+    u32 keys;
+
+    // the summary written when sealing must still fit behind the record
+    if (me->active != NVM_STORE_NONE)
+    {
+        page = &me->pages[me->active];
+        keys = page->keys + ((entry->page != me->active) ? 1U : 0U);
+        if ((page->used + size + NVM_STORE_ALIGN(NVM_STORE_SUMMARY_SIZE(keys), me->unit)) > me->flash->page_size)
+        {
+            nvm_store_seal(me);
+        }
+    }
+
+    if ((me->active == NVM_STORE_NONE) && (nvm_store_open_page(me) == false))
+    {
+        return false;
+    }
+
+    page = &me->pages[me->active];
+
+    rec.key = (u16) key;
+    rec.len = (u16) len;
+    rec.crc = nvm_store_record_crc(key, len, value);
+    memset(me->record, FLASH_SIM_ERASED, size);
+    memcpy(me->record, &rec, sizeof(rec));
+    memcpy(me->record + sizeof(rec), value, len);
+
+    if (flash_sim_program(me->flash, me->active, page->used, me->record, size) == false)
+    {
+        page->used = me->flash->page_size;
+        return false;
+    }
+
+    if (entry->page != NVM_STORE_NONE)
+    {
+        me->pages[entry->page].live -= nvm_store_record_size(me, entry->len);
+        me->pages[entry->page].keys--;
+    }
+    entry->page   = me->active;
+    entry->offset = page->used;
+    entry->crc    = rec.crc;
+    entry->len    = (u16) len;
+    page->live += size;
+    page->keys++;
+    page->used += size;
+    me->stats.records++;
+
+    return true;
+}
+
+
+/**
+ * @name    static __boolean nvm_store_open_page(nvm_store* const me)
+ * 
+ * @brief   makes the least worn free page the active one, erasing it if needed
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ * 
+ * @return  __boolean        : false if no free page is left or the flash failed.
+ */
+static __boolean nvm_store_open_page(nvm_store* const me)
+{
+    nvm_store_page_hdr hdr;
+    nvm_store_page* page;
+    u32 best = NVM_STORE_NONE;
+    u32 p;
+
+    for (p = 0U; p < me->page_count; p++)
+    {
+        if ((me->pages[p].state == NVM_STORE_PAGE_FREE) &&
+            ((best == NVM_STORE_NONE) || (me->pages[p].erase_count < me->pages[best].erase_count)))
+        {
+            best = p;
+        }
+    }
+
+    if (best == NVM_STORE_NONE)
+    {
+        return false;
+    }
+
+    page = &me->pages[best];
+    if (page->erased == false)
+    {
+        if (flash_sim_erase(me->flash, best) == false)
+        {
+            return false;
+        }
+        page->erased = true;
+        page->erase_count++;
+    }
+
+    // the summary half of the header stays erased until the page is sealed
+    memset(&hdr, 0xFF, sizeof(hdr));
+    hdr.magic       = NVM_STORE_PAGE_MAGIC;
+    hdr.seq         = me->next_seq;
+    hdr.erase_count = page->erase_count;
+    hdr.crc         = checksum_crc32c(&hdr, offsetof(nvm_store_page_hdr, crc));
+
+    page->erased = false;
+    if (flash_sim_program(me->flash, best, 0U, &hdr, offsetof(nvm_store_page_hdr, summary_offset)) == false)
+    {
+        return false;
+    }
+
+    page->state = NVM_STORE_PAGE_ACTIVE;
+    page->seq   = me->next_seq++;
+    page->used  = sizeof(nvm_store_page_hdr);
+    page->live  = 0U;
+    page->keys  = 0U;
+    me->active  = best;
+    me->free_pages--;
+
+    return true;
+}
+
+
+/**
+ * @name    static void nvm_store_seal(nvm_store* const me)
+ * 
+ * @brief   closes the active page with the summary of the keys whose newest record it
+ *          holds. A page broken by a failed program is closed without one and is
+ *          read record by record at the next start.
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+static void nvm_store_seal(nvm_store* const me)
+{
+    u32 const p = me->active;
+    nvm_store_page* const page = &me->pages[p];
+    nvm_store_summary_hdr summary = { NVM_STORE_SUMMARY_MAGIC, 0U };
+    u32 tail[4];
+    u32 size;
+    u32 k;
+
+    for (k = 0U; k < me->max_keys; k++)
+    {
+        if (me->index[k].page == p)
+        {
+            nvm_store_summary_entry const entry = { (u16) k, me->index[k].len, me->index[k].offset };
+
+            memcpy(me->summary + NVM_STORE_SUMMARY_SIZE(summary.count), &entry, sizeof(entry));
+            summary.count++;
+        }
+    }
+    memcpy(me->summary, &summary, sizeof(summary));
+
+    size = NVM_STORE_ALIGN(NVM_STORE_SUMMARY_SIZE(summary.count), me->unit);
+    memset(me->summary + NVM_STORE_SUMMARY_SIZE(summary.count), FLASH_SIM_ERASED, size - NVM_STORE_SUMMARY_SIZE(summary.count));
+
+    if (((page->used + size) <= me->flash->page_size) &&
+        (flash_sim_program(me->flash, p, page->used, me->summary, size) == true))
+    {
+        tail[0] = page->used;
+        tail[1] = checksum_crc32c(me->summary, NVM_STORE_SUMMARY_SIZE(summary.count));
+        tail[2] = NVM_STORE_ERASED_WORD;
+        tail[3] = NVM_STORE_ERASED_WORD;
+        (void) flash_sim_program(me->flash, p, offsetof(nvm_store_page_hdr, summary_offset), tail, sizeof(tail));
+    }
+
+    page->state = NVM_STORE_PAGE_SEALED;
+    me->active  = NVM_STORE_NONE;
+    me->stats.seals++;
+
+    return;
+}
+
+
+/**
+ * @name    static void nvm_store_collect(nvm_store* const me)
+ * 
+ * @brief   garbage collection until the reserve of free pages is back: the sealed page
+ *          with the least live data is moved into the log and erased. With room to spare
+ *          the least worn sealed page is moved once the wear drifted apart too far.
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+static void nvm_store_collect(nvm_store* const me)
+{
+    u32 coldest = NVM_STORE_NONE;
+    u32 max_erase = 0U;
+    u32 round;
+    u32 p;
+
+    for (round = 0U; (round < me->page_count) && (me->free_pages < NVM_STORE_RESERVE_PAGES); round++)
+    {
+        u32 victim = NVM_STORE_NONE;
+
+        for (p = 0U; p < me->page_count; p++)
+        {
+            nvm_store_page const * const page = &me->pages[p];
+
+            if ((page->state == NVM_STORE_PAGE_SEALED) &&
+                ((victim == NVM_STORE_NONE) || (page->live < me->pages[victim].live) ||
+                 ((page->live == me->pages[victim].live) && (page->seq < me->pages[victim].seq))))
+            {
+                victim = p;
+            }
+        }
+
+        if ((victim == NVM_STORE_NONE) || (nvm_store_relocate(me, victim) == false))
+        {
+            return;
+        }
+        me->stats.gc_runs++;
+    }
+
+    if (me->free_pages < NVM_STORE_RESERVE_PAGES)
+    {
+        return;
+    }
+
+    for (p = 0U; p < me->page_count; p++)
+    {
+        nvm_store_page const * const page = &me->pages[p];
+
+        max_erase = GET_MAX(max_erase, page->erase_count);
+        if ((page->state == NVM_STORE_PAGE_SEALED) &&
+            ((coldest == NVM_STORE_NONE) || (page->erase_count < me->pages[coldest].erase_count)))
+        {
+            coldest = p;
+        }
+    }
+
+    if ((coldest != NVM_STORE_NONE) && ((max_erase - me->pages[coldest].erase_count) > NVM_STORE_WEAR_DELTA) &&
+        (nvm_store_relocate(me, coldest) == true))
+    {
+        me->stats.wear_moves++;
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static __boolean nvm_store_relocate(nvm_store* const me, u32 page)
+ * 
+ * @brief   appends the live records of a sealed page to the log and erases the page
+ * 
+ * @param   nvm_store* const : object pointer to the struct.
+ *          u32              : page index
+ * 
+ * @return  __boolean        : true if the page is free now.
+ */
+static __boolean nvm_store_relocate(nvm_store* const me, u32 page)
+{
+    u8 const * const base = flash_sim_page(me->flash, page);
+    u32 k;
+
+    for (k = 0U; (k < me->max_keys) && (me->pages[page].keys != 0U); k++)
+    {
+        if (me->index[k].page != page)
+        {
+            continue;
+        }
+
+        if (nvm_store_append(me, k, base + me->index[k].offset + sizeof(nvm_store_record_hdr), me->index[k].len) == false)
+        {
+            return false;
+        }
+        me->stats.relocated++;
+    }
+
+    if (flash_sim_erase(me->flash, page) == false)
+    {
+        return false;
+    }
+
+    me->pages[page].state  = NVM_STORE_PAGE_FREE;
+    me->pages[page].erased = true;
+    me->pages[page].erase_count++;
+    me->pages[page].live   = 0U;
+    me->pages[page].keys   = 0U;
+    me->free_pages++;
+
+    return true;
+}
+
+
+/**
+ * @name    static u32 nvm_store_record_crc(u32 key, u32 len, u8 const * const value)
+ * 
+ * @brief   CRC-32C over key, length and value of a record
+ * 
+ * @param   u32              : key
+ *          u32              : length of the value
+ *          u8 const * const : value
+ * 
+ * @return  u32 : crc.
+ */
+static u32 nvm_store_record_crc(u32 key, u32 len, u8 const * const value)
+{
+    u16 const head[2] = { (u16) key, (u16) len };
+    u32 crc;
+
+    crc = checksum_crc32c_update(CHECKSUM_CRC32C_INIT, head, sizeof(head));
+    crc = checksum_crc32c_update(crc, value, len);
+
+    return crc ^ CHECKSUM_CRC32C_INIT;
+}
+
+
+/**
+ * @name    static inline u32 nvm_store_record_size(nvm_store const * const me, u32 len)
+ * 
+ * @brief   bytes a record takes on the flash
+ * 
+ * @param   nvm_store const * const : object pointer to the struct.
+ *          u32                     : length of the value
+ * 
+ * @return  u32 : size, padded to the write unit.
+ */
+static inline u32 nvm_store_record_size(nvm_store const * const me, u32 len)
+{
+    return NVM_STORE_ALIGN((u32) sizeof(nvm_store_record_hdr) + len, me->unit);
+}
@@ -0,0 +1,554 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+
+#define __PERF_COUNTERS_H_
+#include "perf_counters.h"
+
+perf_counters_cpu* perf_counters_active_slots = NULLPTR;
+u32 perf_counters_active_cpus = 1U;
+
+// the instance the registry reports to, one per process 
+static perf_counters* active = NULLPTR;
+
+/**
+ * @name    __boolean perf_counters_open(perf_counters* const me, u8 __id, char const * const path)
+ * 
+ * @brief   creates the counters of this process and enables the hot path. Modules that 
+ *          are already registered get their entry in the module table right away. An 
+ *          existing file is formatted again.
+ * 
+ * @param   perf_counters* const : object pointer to the struct.
+ *          u8                   : module id for the registration 
+ *          char const * const   : file, e.g. PERF_COUNTERS_DEFAULT_PATH; NULLPTR for a private mapping 
+ * 
+ * @return  __boolean            : true if success, false if something went wrong or 
+ *                                 other counters are open already.
+ */
+__boolean perf_counters_open(perf_counters* const me, u8 __id, char const * const path)
+{
+    struct timespec ts;
+    long cpus;
+    u8 pos;
+
+    CHECK_NULLPTR_RET(me);
+
+    if (__atomic_load_n(&active, __ATOMIC_ACQUIRE) != NULLPTR)
+    {
+        return false;
+    }
+
+    cpus = sysconf(_SC_NPROCESSORS_CONF);
+    if (cpus < 1)
+    {
+        cpus = 1;
+    }
+
+    memset(me, 0, sizeof(*me));
+    me->fd = -1;
+    me->map_size = perf_counters_file_size((u32) cpus);
+
+    if (path != NULLPTR)
+    {
+        me->fd = open(path, O_RDWR | O_CREAT, 0644);
+        if ((me->fd < 0) || (ftruncate(me->fd, 0) != 0) || (ftruncate(me->fd, (off_t) me->map_size) != 0))
+        {
+            perf_counters_close(me);
+            return false;
+        }
+        me->file = (perf_counters_file*) mmap(NULLPTR, me->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, me->fd, 0);
+    }
+    else
+    {
+        me->file = (perf_counters_file*) mmap(NULLPTR, me->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if ((void*) me->file == MAP_FAILED)
+    {
+        me->file = NULLPTR;
+        perf_counters_close(me);
+        return false;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    memcpy(me->file->magic, PERF_COUNTERS_MAGIC, sizeof(me->file->magic));
+    me->file->version      = PERF_COUNTERS_VERSION;
+    me->file->cpu_count    = (u32) cpus;
+    me->file->module_count = MAX_NUMBER_MODULES;
+    me->file->slot_size    = sizeof(perf_counters_cpu);
+    me->file->tsc_hz       = perf_counters_calibrate();
+    me->file->created_ns   = ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+    me->file->pid          = (u32) getpid();
+
+    perf_counters_map(me, (u32) cpus);
+    me->read_only = false;
+
+    // the cpu count has to be visible before the slots it indexes 
+    perf_counters_active_cpus = me->cpu_count;
+    __atomic_store_n(&active, me, __ATOMIC_RELEASE);
+    __atomic_store_n(&perf_counters_active_slots, me->slots, __ATOMIC_RELEASE);
+
+    for (pos = 0U; pos < MAX_NUMBER_MODULES; ++pos)
+    {
+        char const * const name = utils_get_registered_module_name(pos);
+
+        if (name != NULLPTR)
+        {
+            perf_counters_describe(me, pos, name, utils_get_registered_module_id(pos), true);
+        }
+    }
+
+    me->module_position = utils_register_module(PERF_COUNTERS_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean perf_counters_open_read_only(perf_counters* const me, char const * const path)
+ * 
+ * @brief   maps the counters of another process for reading 
+ * 
+ * @param   perf_counters* const : object pointer to the struct.
+ *          char const * const   : file given to perf_counters_open()
+ * 
+ * @return  __boolean            : true if success, false if something went wrong.
+ */
+__boolean perf_counters_open_read_only(perf_counters* const me, char const * const path)
+{
+    perf_counters_file hdr;
+    struct stat st;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(path);
+
+    memset(me, 0, sizeof(*me));
+    me->read_only = true;
+    me->fd = open(path, O_RDONLY);
+    if (me->fd < 0)
+    {
+        return false;
+    }
+
+    if ((fstat(me->fd, &st) != 0) || (pread(me->fd, &hdr, sizeof(hdr), 0) != (ssize_t) sizeof(hdr)) || 
+        (memcmp(hdr.magic, PERF_COUNTERS_MAGIC, sizeof(hdr.magic)) != 0) || (hdr.version != PERF_COUNTERS_VERSION) || 
+        (hdr.slot_size != sizeof(perf_counters_cpu)) || (hdr.module_count != MAX_NUMBER_MODULES) || 
+        (hdr.cpu_count == 0U) || ((u64) st.st_size != perf_counters_file_size(hdr.cpu_count)))
+    {
+        perf_counters_close(me);
+        return false;
+    }
+
+    me->map_size = (u64) st.st_size;
+    me->file = (perf_counters_file*) mmap(NULLPTR, me->map_size, PROT_READ, MAP_SHARED, me->fd, 0);
+    if ((void*) me->file == MAP_FAILED)
+    {
+        me->file = NULLPTR;
+        perf_counters_close(me);
+        return false;
+    }
+
+    perf_counters_map(me, hdr.cpu_count);
+
+    return true;
+}
+
+
+/**
+ * @name    void perf_counters_close(perf_counters* const me)
+ * 
+ * @brief   disables the hot path and unmaps the counters, the file stays for readers. 
+ *          Instrumented threads have to be stopped before, a call that already loaded 
+ *          the slots would touch the unmapped memory.
+ * 
+ * @param   perf_counters* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void perf_counters_close(perf_counters* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->file != NULLPTR)
+    {
+        if (me->read_only == false)
+        {
+            utils_remove_module_registration(me->module_position);
+            __atomic_store_n(&perf_counters_active_slots, NULLPTR, __ATOMIC_RELEASE);
+            __atomic_store_n(&active, NULLPTR, __ATOMIC_RELEASE);
+        }
+        munmap(me->file, me->map_size);
+    }
+
+    if (me->fd >= 0)
+    {
+        close(me->fd);
+    }
+
+    me->fd    = -1;
+    me->file  = NULLPTR;
+    me->slots = NULLPTR;
+
+    return;
+}
+
+
+/**
+ * @name    __boolean perf_counters_get(perf_counters const * const me, u8 module, perf_counters_total* const total)
+ * 
+ * @brief   adds up the slots of all cpus, the counters keep running meanwhile 
+ * 
+ * @param   perf_counters const * const : object pointer to the struct.
+ *          u8                          : module position 
+ *          perf_counters_total* const  : sum
+ * 
+ * @return  __boolean : false if no module is registered at the position.
+ */
+__boolean perf_counters_get(perf_counters const * const me, u8 module, perf_counters_total* const total)
+{
+    perf_counters_module const * desc;
+    u32 seq;
+    u32 cpu;
+    u32 b;
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(total);
+    CHECK_NULLPTR_RET(me->slots);
+
+    if (module >= MAX_NUMBER_MODULES)
+    {
+        return false;
+    }
+
+    desc = &me->modules[module];
+    memset(total, 0, sizeof(*total));
+
+    // the writer may register another module at the position meanwhile, retry on a torn name 
+    do
+    {
+        seq = __atomic_load_n(&desc->seq, __ATOMIC_ACQUIRE);
+        memcpy(total->name, desc->name, sizeof(total->name));
+        total->id = desc->id;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (((seq & 1U) != 0U) || (seq != __atomic_load_n(&desc->seq, __ATOMIC_RELAXED)));
+
+    if (__atomic_load_n(&desc->active, __ATOMIC_RELAXED) == 0U)
+    {
+        return false;
+    }
+    total->name[PERF_COUNTERS_NAME_SIZE - 1U] = '\0';
+
+    for (cpu = 0U; cpu < me->cpu_count; ++cpu)
+    {
+        perf_counters_cpu const * const slot = &me->slots[((u32) module * me->cpu_count) + cpu];
+        u64 const hwm = __atomic_load_n(&slot->queue_hwm, __ATOMIC_RELAXED);
+        u64 const max = __atomic_load_n(&slot->max_cycles, __ATOMIC_RELAXED);
+
+        total->ops      += __atomic_load_n(&slot->ops, __ATOMIC_RELAXED);
+        total->failures += __atomic_load_n(&slot->failures, __ATOMIC_RELAXED);
+        total->bytes    += __atomic_load_n(&slot->bytes, __ATOMIC_RELAXED);
+        total->cycles   += __atomic_load_n(&slot->cycles, __ATOMIC_RELAXED);
+        total->queue_hwm  = GET_MAX(total->queue_hwm, hwm);
+        total->max_cycles = GET_MAX(total->max_cycles, max);
+
+        for (b = 0U; b < PERF_COUNTERS_HIST_BUCKETS; ++b)
+        {
+            u64 const count = __atomic_load_n(&slot->histogram[b], __ATOMIC_RELAXED);
+
+            total->histogram[b] += count;
+            total->traces       += count;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    void perf_counters_reset(perf_counters* const me, u8 module)
+ * 
+ * @brief   zeroes the counters of a module, increments that run at the same time may 
+ *          survive the reset
+ * 
+ * @param   perf_counters* const : object pointer to the struct, not read only 
+ *          u8                   : module position 
+ * 
+ * @return  none.
+ */
+void perf_counters_reset(perf_counters* const me, u8 module)
+{
+    CHECK_NULLPTR_VOID(me);
+    CHECK_NULLPTR_VOID(me->slots);
+
+    if ((me->read_only == true) || (module >= MAX_NUMBER_MODULES))
+    {
+        return;
+    }
+
+    memset(&me->slots[(u32) module * me->cpu_count], 0, me->cpu_count * sizeof(perf_counters_cpu));
+
+    return;
+}
+
+
+/**
+ * @name    f64 perf_counters_cycles_to_ns(perf_counters const * const me, u64 cycles)
+ * 
+ * @brief   converts tracepoint ticks with the frequency measured at open 
+ * 
+ * @param   perf_counters const * const : object pointer to the struct.
+ *          u64                         : cycles 
+ * 
+ * @return  f64 : nanoseconds, 0 if the frequency is unknown.
+ */
+f64 perf_counters_cycles_to_ns(perf_counters const * const me, u64 cycles)
+{
+    if ((me == NULLPTR) || (me->file == NULLPTR) || (me->file->tsc_hz == 0U))
+    {
+        return 0.0;
+    }
+
+    return ((f64) cycles * 1e9) / (f64) me->file->tsc_hz;
+}
+
+
+/**
+ * @name    f64 perf_counters_percentile_ns(perf_counters const * const me, perf_counters_total const * const total, f64 q)
+ * 
+ * @brief   percentile of the traced sections from the histogram, the upper end of the 
+ *          bucket it falls into, so at most a factor of two above the real value 
+ * 
+ * @param   perf_counters const * const       : object pointer to the struct.
+ *          perf_counters_total const * const : counters of perf_counters_get()
+ *          f64                               : quantile, 0.0 .. 1.0 
+ * 
+ * @return  f64 : nanoseconds, 0 without traces.
+ */
+f64 perf_counters_percentile_ns(perf_counters const * const me, perf_counters_total const * const total, f64 q)
+{
+    u64 rank;
+    u64 seen = 0U;
+    u32 b;
+
+    if ((total == NULLPTR) || (total->traces == 0U))
+    {
+        return 0.0;
+    }
+
+    rank = (u64) (q * (f64) total->traces);
+    rank = GET_MIN(rank, total->traces - 1U);
+
+    for (b = 0U; b < PERF_COUNTERS_HIST_BUCKETS; ++b)
+    {
+        seen += total->histogram[b];
+        if (seen > rank)
+        {
+            // the last bucket is open ended, the maximum bounds it 
+            return (b == (PERF_COUNTERS_HIST_BUCKETS - 1U)) ? perf_counters_cycles_to_ns(me, total->max_cycles) : 
+                                                              perf_counters_cycles_to_ns(me, 2ULL << b);
+        }
+    }
+
+    return perf_counters_cycles_to_ns(me, total->max_cycles);
+}
+
+
+/**
+ * @name    void perf_counters_on_register(u8 module, char const * const name, u8 id)
+ * 
+ * @brief   called by utils_register_module(): the position starts with zero counters 
+ *          and its name in the module table 
+ * 
+ * @param   u8                 : module position 
+ *          char const * const : name of the module 
+ *          u8                 : id of the instance 
+ * 
+ * @return  none.
+ */
+void perf_counters_on_register(u8 module, char const * const name, u8 id)
+{
+    perf_counters* const me = __atomic_load_n(&active, __ATOMIC_ACQUIRE);
+
+    if ((me == NULLPTR) || (module >= MAX_NUMBER_MODULES))
+    {
+        return;
+    }
+
+    perf_counters_reset(me, module);
+    perf_counters_describe(me, module, name, id, true);
+
+    return;
+}
+
+
+/**
+ * @name    void perf_counters_on_remove(u8 module)
+ * 
+ * @brief   called by utils_remove_module_registration(), the counters stay readable 
+ *          until the position is taken again
+ * 
+ * @param   u8 : module position 
+ * 
+ * @return  none.
+ */
+void perf_counters_on_remove(u8 module)
+{
+    perf_counters* const me = __atomic_load_n(&active, __ATOMIC_ACQUIRE);
+
+    if ((me == NULLPTR) || (module >= MAX_NUMBER_MODULES))
+    {
+        return;
+    }
+
+    __atomic_store_n(&me->modules[module].active, 0U, __ATOMIC_RELEASE);
+
+    return;
+}
+
+#ifdef RUNNING_OS 
+/**
+ * @name    void perf_counters_dump(perf_counters const * const me)
+ * 
+ * @brief   prints one line per registered module 
+ * 
+ * @param   perf_counters const * const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void perf_counters_dump(perf_counters const * const me)
+{
+    perf_counters_total total;
+    u8 pos;
+
+    CHECK_NULLPTR_VOID(me);
+    CHECK_NULLPTR_VOID(me->file);
+
+    printf("%-3s %-24s %3s %14s %10s %14s %8s %12s %10s %10s %10s %10s\n", "pos", "module", "id", "ops", "failures", 
+           "bytes", "q hwm", "traces", "mean ns", "p50 ns", "p99 ns", "max ns");
+
+    for (pos = 0U; pos < MAX_NUMBER_MODULES; ++pos)
+    {
+        if (perf_counters_get(me, pos, &total) == false)
+        {
+            continue;
+        }
+
+        printf("%-3u %-24s %3u %14llu %10llu %14llu %8llu %12llu %10.0f %10.0f %10.0f %10.0f\n", pos, total.name, 
+               total.id, total.ops, total.failures, total.bytes, total.queue_hwm, total.traces, 
+               (total.traces != 0U) ? perf_counters_cycles_to_ns(me, total.cycles / total.traces) : 0.0, 
+               perf_counters_percentile_ns(me, &total, 0.5), perf_counters_percentile_ns(me, &total, 0.99), 
+               perf_counters_cycles_to_ns(me, total.max_cycles));
+    }
+
+    return;
+}
+#endif /* RUNNING_OS */
+
+
+/**
+ * @name    static void perf_counters_map(perf_counters* const me, u32 cpu_count)
+ * 
+ * @brief   points the tables into the mapping 
+ * 
+ * @param   perf_counters* const : object pointer to the struct.
+ *          u32                  : cpus of the file 
+ * 
+ * @return  none.
+ */
+static void perf_counters_map(perf_counters* const me, u32 cpu_count)
+{
+    u8* const base = (u8*) me->file;
+
+    me->cpu_count = cpu_count;
+    me->modules   = (perf_counters_module*) (base + PERF_COUNTERS_HEADER_SIZE);
+    me->slots     = (perf_counters_cpu*) (base + PERF_COUNTERS_HEADER_SIZE + (MAX_NUMBER_MODULES * sizeof(perf_counters_module)));
+
+    return;
+}
+
+
+/**
+ * @name    static u64 perf_counters_file_size(u32 cpu_count)
+ * 
+ * @brief   header page, module table and one slot per module and cpu 
+ * 
+ * @param   u32 : cpus 
+ * 
+ * @return  u64 : bytes.
+ */
+static u64 perf_counters_file_size(u32 cpu_count)
+{
+    return PERF_COUNTERS_HEADER_SIZE + (MAX_NUMBER_MODULES * sizeof(perf_counters_module)) + 
+           ((u64) MAX_NUMBER_MODULES * cpu_count * sizeof(perf_counters_cpu));
+}
+
+
+/**
+ * @name    static u64 perf_counters_calibrate(void)
+ * 
+ * @brief   measures the frequency of perf_counters_ticks() against CLOCK_MONOTONIC 
+ * 
+ * @param   none.
+ * 
+ * @return  u64 : ticks per second.
+ */
+static u64 perf_counters_calibrate(void)
+{
+    struct timespec start;
+    struct timespec now;
+    u64 tsc_start;
+    u64 tsc_end;
+    s64 elapsed_ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    tsc_start = perf_counters_ticks();
+    do
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed_ns = ((s64) (now.tv_sec - start.tv_sec) * 1000000000L) + (now.tv_nsec - start.tv_nsec);
+    } while (elapsed_ns < PERF_COUNTERS_CALIBRATE_NS);
+    tsc_end = perf_counters_ticks();
+
+    return (u64) (((f64) (tsc_end - tsc_start) * 1e9) / (f64) elapsed_ns);
+}
+
+
+/**
+ * @name    static void perf_counters_describe(perf_counters* const me, u8 module, char const * const name, u8 id, __boolean registered)
+ * 
+ * @brief   writes the module table entry of a position, readers retry while seq is odd 
+ * 
+ * @param   perf_counters* const : object pointer to the struct.
+ *          u8                   : module position 
+ *          char const * const   : name 
+ *          u8                   : id 
+ *          __boolean            : registered or not 
+ * 
+ * @return  none.
+ */
+static void perf_counters_describe(perf_counters* const me, u8 module, char const * const name, u8 id, __boolean registered)
+{
+    perf_counters_module* const desc = &me->modules[module];
+
+    __atomic_fetch_add(&desc->seq, 1U, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memset(desc->name, 0, sizeof(desc->name));
+    if (name != NULLPTR)
+    {
+        strncpy(desc->name, name, sizeof(desc->name) - 1U);
+    }
+    desc->id = id;
+    __atomic_store_n(&desc->active, (registered == true) ? 1U : 0U, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&desc->seq, 1U, __ATOMIC_RELEASE);
+
+    return;
+}
@@ -0,0 +1,782 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "capture.h"
+#include "can_socket.h"
+
+#define __REPLAY_H_
+#include "replay.h"
+
+/**
+ * @name    __boolean replay_source_open(replay_source* const me, char const * const path)
+ * 
+ * @brief   opens a capture segment or a candump log, the type is detected from the 
+ *          file magic
+ * 
+ * @param   replay_source* const : object pointer to the struct.
+ *          char const * const   : file to be replayed
+ * 
+ * @return  __boolean            : true if success, false if something went wrong.
+ */
+__boolean replay_source_open(replay_source* const me, char const * const path)
+{
+    struct stat st;
+    char magic[8U] = { 0 };
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(path);
+
+    memset(me, 0, sizeof(*me));
+    me->fd = open(path, O_RDONLY);
+    if (me->fd < 0)
+    {
+        return false;
+    }
+
+    if ((pread(me->fd, magic, sizeof(magic), 0) == (ssize_t) sizeof(magic)) && 
+        (memcmp(magic, CAPTURE_FILE_MAGIC, sizeof(magic)) == 0))
+    {
+        close(me->fd);
+        me->fd   = -1;
+        me->type = REPLAY_SOURCE_CAPTURE;
+        if (capture_reader_open(&me->reader, path) == false)
+        {
+            return false;
+        }
+        me->block = 0U;
+        if (me->reader.block_count > 0U)
+        {
+            (void) capture_cursor_init(&me->cursor, &me->reader, 0U);
+        }
+        return true;
+    }
+
+    me->type = REPLAY_SOURCE_CANDUMP;
+    if ((fstat(me->fd, &st) != 0) || (st.st_size == 0))
+    {
+        close(me->fd);
+        me->fd = -1;
+        return false;
+    }
+
+    me->size = (u64) st.st_size;
+    me->map  = (u8 const *) mmap(NULLPTR, me->size, PROT_READ, MAP_PRIVATE, me->fd, 0);
+    if ((void*) me->map == MAP_FAILED)
+    {
+        close(me->fd);
+        me->fd  = -1;
+        me->map = NULLPTR;
+        return false;
+    }
+    (void) madvise((void*) me->map, me->size, MADV_SEQUENTIAL);
+
+    return true;
+}
+
+
+/**
+ * @name    void replay_source_close(replay_source* const me)
+ * 
+ * @brief   unmaps and closes the source 
+ * 
+ * @param   replay_source* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void replay_source_close(replay_source* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->type == REPLAY_SOURCE_CAPTURE)
+    {
+        capture_reader_close(&me->reader);
+    }
+    else if (me->map != NULLPTR)
+    {
+        munmap((void*) me->map, me->size);
+        close(me->fd);
+    }
+
+    me->map = NULLPTR;
+    me->fd  = -1;
+
+    return;
+}
+
+
+/**
+ * @name    __boolean replay_source_next(replay_source* const me, can_frame_rec* const frame)
+ * 
+ * @brief   next frame in file order, keeps the read-ahead window in front of the 
+ *          read position
+ * 
+ * @param   replay_source* const : object pointer to the struct.
+ *          can_frame_rec* const : destination 
+ * 
+ * @return  __boolean : false at the end of the source.
+ */
+__boolean replay_source_next(replay_source* const me, can_frame_rec* const frame)
+{
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(frame);
+
+    if (me->type == REPLAY_SOURCE_CANDUMP)
+    {
+        return replay_source_next_candump(me, frame);
+    }
+
+    while (me->block < me->reader.block_count)
+    {
+        if (capture_cursor_next(&me->cursor, frame) == true)
+        {
+            return true;
+        }
+
+        if (++me->block < me->reader.block_count)
+        {
+            replay_readahead(me->reader.map, me->reader.map_size, me->reader.blocks[me->block].offset, &me->readahead);
+            (void) capture_cursor_init(&me->cursor, &me->reader, me->block);
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @name    __boolean replay_init(replay* const me, u8 __id, replay_config const * const config)
+ * 
+ * @brief   sets up a replay engine, buses still have to be mapped to sockets
+ * 
+ * @param   replay* const               : object pointer to the struct.
+ *          u8                          : module id for the registration 
+ *          replay_config const * const : speed and timing parameters, NULLPTR for 
+ *                                        recorded speed with default timing
+ * 
+ * @return  __boolean : true if success, false if something went wrong.
+ */
+__boolean replay_init(replay* const me, u8 __id, replay_config const * const config)
+{
+    u8 bus;
+
+    CHECK_NULLPTR_RET(me);
+
+    memset(me, 0, sizeof(*me));
+    for (bus = 0U; bus < CAN_FRAME_MAX_BUSES; ++bus)
+    {
+        me->batch_of[bus] = bus;
+    }
+
+    me->config.speed     = 1.0;
+    me->config.spin_ns   = REPLAY_DEFAULT_SPIN_NS;
+    me->config.window_ns = REPLAY_DEFAULT_WINDOW_NS;
+    if (config != NULLPTR)
+    {
+        me->config = *config;
+    }
+    if (me->config.speed < 0.0)
+    {
+        return false;
+    }
+
+    me->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (me->timer_fd < 0)
+    {
+        return false;
+    }
+
+    me->stats.error_min_ns = 0x7FFFFFFFFFFFFFFFLL;
+    me->module_position = utils_register_module(REPLAY_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void replay_destruct(replay* const me)
+ * 
+ * @brief   releases the timer, the sockets stay owned by the caller 
+ * 
+ * @param   replay* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void replay_destruct(replay* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    if (me->timer_fd >= 0)
+    {
+        close(me->timer_fd);
+    }
+    me->timer_fd = -1;
+    utils_remove_module_registration(me->module_position);
+
+    return;
+}
+
+
+/**
+ * @name    __boolean replay_map_bus(replay* const me, u8 bus, can_socket* const socket)
+ * 
+ * @brief   routes the recorded frames of a bus to an interface, several buses may share 
+ *          one interface and then share its batch 
+ * 
+ * @param   replay* const     : object pointer to the struct.
+ *          u8                : recorded bus index 
+ *          can_socket* const : opened socket, NULLPTR drops the bus
+ * 
+ * @return  __boolean : true if success, false if something went wrong.
+ */
+__boolean replay_map_bus(replay* const me, u8 bus, can_socket* const socket)
+{
+    u8 b;
+    u8 k;
+
+    CHECK_NULLPTR_RET(me);
+
+    if (bus >= CAN_FRAME_MAX_BUSES)
+    {
+        return false;
+    }
+    me->sockets[bus] = socket;
+
+    // every bus batches with the first bus mapped to the same socket 
+    for (b = 0U; b < CAN_FRAME_MAX_BUSES; ++b)
+    {
+        me->batch_of[b] = b;
+        for (k = 0U; (me->sockets[b] != NULLPTR) && (k < b); ++k)
+        {
+            if (me->sockets[k] == me->sockets[b])
+            {
+                me->batch_of[b] = k;
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    __boolean replay_run(replay* const me, replay_source* const source)
+ * 
+ * @brief   replays a source in the calling thread until its end or replay_stop(). Several
+ *          sources run one after the other continue on the time base of the first frame,
+ *          so consecutive segments replay as one recording. Frames due within the batch 
+ *          window are collected per interface and sent with one sendmmsg each.
+ * 
+ * @param   replay* const        : object pointer to the struct.
+ *          replay_source* const : opened source 
+ * 
+ * @return  __boolean : false if stopped, true at the end of the source.
+ */
+__boolean replay_run(replay* const me, replay_source* const source)
+{
+    can_frame_rec frame;
+    u64 run_start = replay_mono_ns();
+
+    CHECK_NULLPTR_RET(me);
+    CHECK_NULLPTR_RET(source);
+
+    while ((me->stop == false) && (replay_source_next(source, &frame) == true))
+    {
+        u8 const bus = frame.bus % CAN_FRAME_MAX_BUSES;
+        u8 const batch = me->batch_of[bus];
+        u64 due = 0U;
+
+        if ((me->sockets[bus] == NULLPTR) && (me->config.dry_run == false))
+        {
+            ++me->stats.unmapped;
+            continue;
+        }
+
+        if (me->started == false)
+        {
+            me->started       = true;
+            me->first_ts      = frame.timestamp_ns;
+            me->start_mono_ns = replay_mono_ns() + me->config.spin_ns;
+        }
+
+        if (me->config.speed != REPLAY_SPEED_MAX)
+        {
+            u64 const offset = (frame.timestamp_ns > me->first_ts) ? (frame.timestamp_ns - me->first_ts) : 0U;
+            due = me->start_mono_ns + (u64) ((f64) offset / me->config.speed);
+        }
+
+        if ((me->window_frames > 0U) && 
+            ((due > (me->window_start_ns + me->config.window_ns)) || (me->pending_count[batch] == REPLAY_MAX_BATCH)))
+        {
+            replay_flush(me);
+        }
+
+        if (me->window_frames == 0U)
+        {
+            me->window_start_ns = due;
+        }
+
+        me->pending[batch][me->pending_count[batch]] = frame;
+        me->due[batch][me->pending_count[batch]]     = due;
+        ++me->pending_count[batch];
+        ++me->window_frames;
+    }
+
+    replay_flush(me);
+    me->stats.elapsed_ns += replay_mono_ns() - run_start;
+
+    return (me->stop == false);
+}
+
+
+/**
+ * @name    void replay_stop(replay* const me)
+ * 
+ * @brief   makes replay_run() return after the current batch, may be called from any 
+ *          thread or a signal handler 
+ * 
+ * @param   replay* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void replay_stop(replay* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+    me->stop = true;
+}
+
+
+/**
+ * @name    void replay_get_stats(replay* const me, replay_stats* const stats)
+ * 
+ * @brief   achieved rate and timing error of everything replayed so far. The timing 
+ *          error is only measured when pacing (speed != REPLAY_SPEED_MAX).
+ * 
+ * @param   replay* const       : object pointer to the struct.
+ *          replay_stats* const : destination 
+ * 
+ * @return  none.
+ */
+void replay_get_stats(replay* const me, replay_stats* const stats)
+{
+    u64 accounted = 0U;
+    u64 seen = 0U;
+    u32 i;
+
+    CHECK_NULLPTR_VOID(me);
+    CHECK_NULLPTR_VOID(stats);
+
+    *stats = me->stats;
+
+    for (i = 0U; i < REPLAY_ERROR_BUCKETS; ++i)
+    {
+        accounted += me->stats.error_hist[i];
+    }
+
+    stats->rate_fps      = (me->stats.elapsed_ns > 0U) ? ((f64) me->stats.frames * 1e9 / (f64) me->stats.elapsed_ns) : 0.0;
+    stats->error_mean_ns = (accounted > 0U) ? (me->error_sum / (f64) accounted) : 0.0;
+    if (accounted == 0U)
+    {
+        stats->error_min_ns = 0;
+    }
+
+    for (i = 0U; i < REPLAY_ERROR_BUCKETS; ++i)
+    {
+        seen += me->stats.error_hist[i];
+        if ((stats->error_p50_ns == 0U) && ((seen * 2U) >= accounted) && (accounted > 0U))
+        {
+            stats->error_p50_ns = 1ULL << i;
+        }
+        if ((stats->error_p99_ns == 0U) && ((seen * 100U) >= (accounted * 99U)) && (accounted > 0U))
+        {
+            stats->error_p99_ns = 1ULL << i;
+        }
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static __boolean replay_source_next_candump(replay_source* const me, can_frame_rec* const frame)
+ * 
+ * @brief   parses the next frame line of a candump log, other lines are skipped 
+ * 
+ * @param   replay_source* const : object pointer to the struct.
+ *          can_frame_rec* const : destination 
+ * 
+ * @return  __boolean : false at the end of the file.
+ */
+static __boolean replay_source_next_candump(replay_source* const me, can_frame_rec* const frame)
+{
+    while (me->pos < me->size)
+    {
+        char const * const line = (char const *) me->map + me->pos;
+        char const * const eol  = (char const *) memchr(line, '\n', me->size - me->pos);
+        u32 const len = (eol != NULLPTR) ? (u32) (eol - line) : (u32) (me->size - me->pos);
+
+        replay_readahead(me->map, me->size, me->pos, &me->readahead);
+        me->pos += len + 1U;
+
+        if (replay_parse_candump(me, line, len, frame) == true)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @name    static __boolean replay_parse_candump(replay_source* const me, char const * line, u32 len, can_frame_rec* const frame)
+ * 
+ * @brief   "(1699999999.123456) can0 123#1122", "... 12345678#R", "... 123##1112233"
+ * 
+ * @param   replay_source* const : object pointer to the struct (bus names).
+ *          char const *         : line, not terminated 
+ *          u32                  : length of the line
+ *          can_frame_rec* const : destination 
+ * 
+ * @return  __boolean : true if the line holds a frame.
+ */
+static __boolean replay_parse_candump(replay_source* const me, char const * line, u32 len, can_frame_rec* const frame)
+{
+    char const * const end = line + len;
+    char const * name;
+    u64 sec = 0U;
+    u64 frac = 0U;
+    u32 frac_digits = 0U;
+    u32 id = 0U;
+    u32 id_digits = 0U;
+    u32 name_len;
+    u8  bus;
+
+    if ((len < 10U) || (*line != '('))
+    {
+        return false;
+    }
+
+    for (++line; (line < end) && (*line >= '0') && (*line <= '9'); ++line)
+    {
+        sec = (sec * 10U) + (u64) (*line - '0');
+    }
+    if ((line < end) && (*line == '.'))
+    {
+        for (++line; (line < end) && (*line >= '0') && (*line <= '9'); ++line, ++frac_digits)
+        {
+            frac = (frac * 10U) + (u64) (*line - '0');
+        }
+    }
+    for (; frac_digits < 9U; ++frac_digits)
+    {
+        frac *= 10U;
+    }
+    if ((line + 2) >= end || (line[0] != ')') || (line[1] != ' '))
+    {
+        return false;
+    }
+    line += 2;
+
+    name = line;
+    while ((line < end) && (*line != ' '))
+    {
+        ++line;
+    }
+    name_len = (u32) (line - name);
+    if ((line >= end) || (name_len == 0U) || (name_len >= CAN_SOCKET_IFNAME_SIZE))
+    {
+        return false;
+    }
+    ++line;
+
+    for (bus = 0U; bus < me->bus_count; ++bus)
+    {
+        if ((strncmp(me->bus_names[bus], name, name_len) == 0) && (me->bus_names[bus][name_len] == '\0'))
+        {
+            break;
+        }
+    }
+    if (bus == me->bus_count)
+    {
+        if (me->bus_count == CAN_FRAME_MAX_BUSES)
+        {
+            return false;
+        }
+        memcpy(me->bus_names[bus], name, name_len);
+        me->bus_names[bus][name_len] = '\0';
+        ++me->bus_count;
+    }
+
+    for (; (line < end) && (*line != '#'); ++line, ++id_digits)
+    {
+        s32 const digit = replay_hex(*line);
+        if (digit < 0)
+        {
+            return false;
+        }
+        id = (id << 4U) | (u32) digit;
+    }
+    if ((line >= end) || (id_digits == 0U))
+    {
+        return false;
+    }
+    ++line;
+
+    memset(frame, 0, 16U);
+    frame->timestamp_ns = (sec * 1000000000ULL) + frac;
+    frame->bus          = bus;
+    frame->can_id       = (id_digits > 3U) ? (((id & CAN_ERR_FLAG) != 0U) ? id : (id | CAN_EFF_FLAG)) : id;
+
+    if ((line < end) && (*line == '#'))
+    {
+        s32 const flags = ((line + 1) < end) ? replay_hex(line[1]) : -1;
+        if (flags < 0)
+        {
+            return false;
+        }
+        frame->flags = CAN_FRAME_FLAG_FD | ((u8) flags & (CAN_FRAME_FLAG_BRS | CAN_FRAME_FLAG_ESI));
+        line += 2;
+    }
+    else if ((line < end) && (*line == 'R'))
+    {
+        frame->can_id |= CAN_RTR_FLAG;
+        frame->len = ((line + 1) < end) ? (u8) GET_MAX(replay_hex(line[1]), 0) : 0U;
+        return true;
+    }
+
+    while (((line + 1) < end) && (frame->len < CAN_FRAME_MAX_DATA))
+    {
+        s32 high;
+        s32 low;
+        if (*line == '.')
+        {
+            ++line;
+            continue;
+        }
+        high = replay_hex(line[0]);
+        low  = replay_hex(line[1]);
+        if ((high < 0) || (low < 0))
+        {
+            break;
+        }
+        frame->data[frame->len++] = (u8) ((high << 4) | low);
+        line += 2;
+    }
+
+    return true;
+}
+
+
+/**
+ * @name    static void replay_readahead(u8 const * const base, u64 size, u64 pos, u64* const readahead)
+ * 
+ * @brief   asks the kernel to page in the next window once the read position passed 
+ *          half of the current one, so the scheduler never waits for the disk 
+ * 
+ * @param   u8 const * const : start of the mapping 
+ *          u64              : size of the mapping 
+ *          u64              : current read position 
+ *          u64* const       : end of the window requested so far
+ * 
+ * @return  none.
+ */
+static void replay_readahead(u8 const * const base, u64 size, u64 pos, u64* const readahead)
+{
+    u64 start;
+    u64 len;
+
+    if ((pos + (REPLAY_READAHEAD_BYTES / 2U)) < *readahead)
+    {
+        return;
+    }
+
+    start = GET_MAX(*readahead, pos) & ~4095ULL;
+    if (start >= size)
+    {
+        return;
+    }
+    len = GET_MIN((u64) REPLAY_READAHEAD_BYTES, size - start);
+    (void) madvise((void*) (base + start), len, MADV_WILLNEED);
+    *readahead = start + len;
+
+    return;
+}
+
+
+/**
+ * @name    static void replay_wait_until(replay* const me, u64 due_ns)
+ * 
+ * @brief   sleeps on the timerfd until spin_ns before the due time and busy waits the 
+ *          rest, the wake up latency of the sleep stays outside the timing error 
+ * 
+ * @param   replay* const : object pointer to the struct.
+ *          u64           : CLOCK_MONOTONIC due time
+ * 
+ * @return  none.
+ */
+static void replay_wait_until(replay* const me, u64 due_ns)
+{
+    u64 now = replay_mono_ns();
+
+    if ((due_ns > now) && ((due_ns - now) > me->config.spin_ns))
+    {
+        struct itimerspec its;
+        u64 const wake = due_ns - me->config.spin_ns;
+        u64 expirations;
+
+        memset(&its, 0, sizeof(its));
+        its.it_value.tv_sec  = (time_t) (wake / 1000000000ULL);
+        its.it_value.tv_nsec = (long) (wake % 1000000000ULL);
+        if (timerfd_settime(me->timer_fd, TFD_TIMER_ABSTIME, &its, NULLPTR) == 0)
+        {
+            (void) read(me->timer_fd, &expirations, sizeof(expirations));
+        }
+    }
+
+    while ((me->stop == false) && (replay_mono_ns() < due_ns))
+    {
+        utils_cpu_relax();
+    }
+
+    return;
+}
+
+
+/**
+ * @name    static void replay_flush(replay* const me)
+ * 
+ * @brief   waits for the start of the window and sends the collected batch of every 
+ *          interface, then accounts the timing error of each frame 
+ * 
+ * @param   replay* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+static void replay_flush(replay* const me)
+{
+    u8 batch;
+
+    if (me->window_frames == 0U)
+    {
+        return;
+    }
+
+    if (me->config.speed != REPLAY_SPEED_MAX)
+    {
+        replay_wait_until(me, me->window_start_ns);
+    }
+
+    for (batch = 0U; batch < CAN_FRAME_MAX_BUSES; ++batch)
+    {
+        u32 const n = me->pending_count[batch];
+        u32 sent;
+        u64 now;
+        u32 i;
+
+        if (n == 0U)
+        {
+            continue;
+        }
+
+        sent = (me->config.dry_run == true) ? n : can_socket_send_batch(me->sockets[batch], me->pending[batch], n);
+        now  = replay_mono_ns();
+
+        me->stats.frames    += sent;
+        me->stats.tx_errors += n - sent;
+        ++me->stats.batches;
+
+        if (me->config.speed != REPLAY_SPEED_MAX)
+        {
+            for (i = 0U; i < sent; ++i)
+            {
+                replay_account(me, (s64) (now - me->due[batch][i]));
+            }
+        }
+
+        me->pending_count[batch] = 0U;
+    }
+
+    me->window_frames = 0U;
+
+    return;
+}
+
+
+/**
+ * @name    static void replay_account(replay* const me, s64 error_ns)
+ * 
+ * @brief   adds one timing error to min/max/mean and the log2 histogram 
+ * 
+ * @param   replay* const : object pointer to the struct.
+ *          s64           : send time - due time 
+ * 
+ * @return  none.
+ */
+static void replay_account(replay* const me, s64 error_ns)
+{
+    u64 const magnitude = (error_ns < 0) ? (u64) -error_ns : (u64) error_ns;
+    u32 const bucket = (magnitude == 0U) ? 0U : (u32) (64 - __builtin_clzll(magnitude));
+
+    me->stats.error_min_ns = GET_MIN(me->stats.error_min_ns, error_ns);
+    me->stats.error_max_ns = GET_MAX(me->stats.error_max_ns, error_ns);
+    me->error_sum += (f64) error_ns;
+    ++me->stats.error_hist[GET_MIN(bucket, REPLAY_ERROR_BUCKETS - 1U)];
+
+    return;
+}
+
+
+/**
+ * @name    static inline u64 replay_mono_ns(void)
+ * 
+ * @brief   monotonic clock of the scheduler 
+ * 
+ * @param   none.
+ * 
+ * @return  u64 : nanoseconds.
+ */
+static inline u64 replay_mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+}
+
+
+/**
+ * @name    static inline s32 replay_hex(char c)
+ * 
+ * @brief   value of a hex digit 
+ * 
+ * @param   char : character 
+ * 
+ * @return  s32 : 0..15, -1 if not a hex digit.
+ */
+static inline s32 replay_hex(char c)
+{
+    if ((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+    if ((c >= 'A') && (c <= 'F'))
+    {
+        return c - 'A' + 10;
+    }
+    if ((c >= 'a') && (c <= 'f'))
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
@@ -0,0 +1,271 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+#define __TIMER_WHEEL_H_
+#include "timer_wheel.h"
+
+/**
+ * @name    __boolean timer_wheel_init(timer_wheel* const me, u8 __id, u32 slots, u64 tick_ns, u64 now_ns)
+ * 
+ * @brief   empty wheel, one revolution covers slots * tick_ns 
+ * 
+ * @param   timer_wheel* const : object pointer to the struct.
+ *          u8                 : module id for the registration 
+ *          u32                : number of slots, power of two 
+ *          u64                : resolution 
+ *          u64                : current time, the clock of all later calls 
+ * 
+ * @return  __boolean          : true if success, false if something went wrong.
+ */
+__boolean timer_wheel_init(timer_wheel* const me, u8 __id, u32 slots, u64 tick_ns, u64 now_ns)
+{
+    u32 i;
+
+    CHECK_NULLPTR_RET(me);
+
+    if ((TIMER_WHEEL_IS_POWER_OF_TWO(slots) == false) || (tick_ns == 0U))
+    {
+        return false;
+    }
+
+    memset(me, 0, sizeof(*me));
+    me->slots = (timer_wheel_node*) malloc(slots * sizeof(timer_wheel_node));
+    if (me->slots == NULLPTR)
+    {
+        return false;
+    }
+
+    for (i = 0U; i < slots; ++i)
+    {
+        me->slots[i].next = &me->slots[i];
+        me->slots[i].prev = &me->slots[i];
+    }
+    me->expired.next = &me->expired;
+    me->expired.prev = &me->expired;
+
+    me->mask    = slots - 1U;
+    me->tick_ns = tick_ns;
+    me->current = now_ns / tick_ns;
+    me->module_position = utils_register_module(TIMER_WHEEL_MODULE_NAME, __id);
+
+    return true;
+}
+
+
+/**
+ * @name    void timer_wheel_destruct(timer_wheel* const me)
+ * 
+ * @brief   frees the slots, nodes still armed are simply forgotten 
+ * 
+ * @param   timer_wheel* const : object pointer to the struct.
+ * 
+ * @return  none.
+ */
+void timer_wheel_destruct(timer_wheel* const me)
+{
+    CHECK_NULLPTR_VOID(me);
+
+    free(me->slots);
+    me->slots = NULLPTR;
+    utils_remove_module_registration(me->module_position);
+
+    return;
+}
+
+
+/**
+ * @name    void timer_wheel_node_init(timer_wheel_node* const node, u32 cookie)
+ * 
+ * @brief   prepares a node that is not armed 
+ * 
+ * @param   timer_wheel_node* const : node 
+ *          u32                     : value for the owner, e.g. its index 
+ * 
+ * @return  none.
+ */
+void timer_wheel_node_init(timer_wheel_node* const node, u32 cookie)
+{
+    CHECK_NULLPTR_VOID(node);
+
+    node->next   = node;
+    node->prev   = node;
+    node->tick   = 0U;
+    node->cookie = cookie;
+    node->armed  = 0U;
+
+    return;
+}
+
+
+/**
+ * @name    void timer_wheel_schedule(timer_wheel* const me, timer_wheel_node* const node, u64 expires_ns)
+ * 
+ * @brief   arms a node or moves an armed one. Expiry is rounded up to whole ticks 
+ *          and never lands on a tick already advanced over, a timer never fires early.
+ * 
+ * @param   timer_wheel* const      : object pointer to the struct.
+ *          timer_wheel_node* const : node 
+ *          u64                     : expiry time 
+ * 
+ * @return  none.
+ */
+void timer_wheel_schedule(timer_wheel* const me, timer_wheel_node* const node, u64 expires_ns)
+{
+    u64 tick = (expires_ns + me->tick_ns - 1U) / me->tick_ns;
+
+    if (node->armed != 0U)
+    {
+        timer_wheel_unlink(node);
+        me->armed_count--;
+    }
+
+    if (tick <= me->current)
+    {
+        tick = me->current + 1U;
+    }
+
+    node->tick  = tick;
+    node->armed = 1U;
+    timer_wheel_link(&me->slots[tick & me->mask], node);
+    me->armed_count++;
+
+    return;
+}
+
+
+/**
+ * @name    void timer_wheel_cancel(timer_wheel* const me, timer_wheel_node* const node)
+ * 
+ * @brief   disarms a node, also one already collected by a running advance 
+ * 
+ * @param   timer_wheel* const      : object pointer to the struct.
+ *          timer_wheel_node* const : node 
+ * 
+ * @return  none.
+ */
+void timer_wheel_cancel(timer_wheel* const me, timer_wheel_node* const node)
+{
+    if (node->armed == 0U)
+    {
+        return;
+    }
+
+    timer_wheel_unlink(node);
+    node->armed = 0U;
+    me->armed_count--;
+
+    return;
+}
+
+
+/**
+ * @name    u32 timer_wheel_advance(timer_wheel* const me, u64 now_ns, timer_wheel_callback callback, void* ctx)
+ * 
+ * @brief   fires every timer that expired up to now. The due nodes are collected 
+ *          first, so callbacks may schedule or cancel any node, the wheel's own 
+ *          included. A jump over more than one revolution visits every slot once.
+ * 
+ * @param   timer_wheel* const   : object pointer to the struct.
+ *          u64                  : current time 
+ *          timer_wheel_callback : called for every expired node, already disarmed
+ *          void*                : passed to the callback 
+ * 
+ * @return  u32 : number of timers fired.
+ */
+u32 timer_wheel_advance(timer_wheel* const me, u64 now_ns, timer_wheel_callback callback, void* ctx)
+{
+    u64 target;
+    u64 steps;
+    u64 s;
+    u32 fired = 0U;
+
+    CHECK_NULLPTR_RET(me);
+
+    target = now_ns / me->tick_ns;
+    if (target <= me->current)
+    {
+        return 0U;
+    }
+
+    steps = GET_MIN(target - me->current, (u64) me->mask + 1U);
+
+    for (s = 1U; (s <= steps) && (me->armed_count != 0U); ++s)
+    {
+        timer_wheel_node* const head = &me->slots[(me->current + s) & me->mask];
+        timer_wheel_node* node = head->next;
+
+        while (node != head)
+        {
+            timer_wheel_node* const next = node->next;
+
+            if (node->tick <= target)
+            {
+                timer_wheel_unlink(node);
+                timer_wheel_link(&me->expired, node);
+            }
+            node = next;
+        }
+    }
+
+    me->current = target;
+
+    while (me->expired.next != &me->expired)
+    {
+        timer_wheel_node* const node = me->expired.next;
+
+        timer_wheel_unlink(node);
+        node->armed = 0U;
+        me->armed_count--;
+        fired++;
+
+        if (callback != NULLPTR)
+        {
+            callback(ctx, node);
+        }
+    }
+
+    return fired;
+}
+
+
+/**
+ * @name    static inline void timer_wheel_link(timer_wheel_node* const head, timer_wheel_node* const node)
+ * 
+ * @brief   appends a node to a list 
+ * 
+ * @param   timer_wheel_node* const : list head 
+ *          timer_wheel_node* const : node 
+ * 
+ * @return  none.
+ */
+static inline void timer_wheel_link(timer_wheel_node* const head, timer_wheel_node* const node)
+{
+    node->next = head;
+    node->prev = head->prev;
+    head->prev->next = node;
+    head->prev = node;
+
+    return;
+}
+
+
+/**
+ * @name    static inline void timer_wheel_unlink(timer_wheel_node* const node)
+ * 
+ * @brief   removes a node from the list it is in 
+ * 
+ * @param   timer_wheel_node* const : node 
+ * 
+ * @return  none.
+ */
+static inline void timer_wheel_unlink(timer_wheel_node* const node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = node;
+    node->prev = node;
+
+    return;
+}
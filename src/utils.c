@@ -0,0 +1,114 @@
+#include "utils.h"
+#include "perf_counters.h"
+
+static char * module_names[MAX_NUMBER_MODULES] = { NULLPTR };
+static u8     module_ids[MAX_NUMBER_MODULES] = { 0U };
+static u8     registry_lock = 0U;
+
+/**
+ * @name    u8 utils_register_module(char * const __module_name, u8 const __id)
+ * 
+ * @brief   takes the first free position of the process wide module table, the
+ *          performance counters of the position start from zero
+ * 
+ * @param   char * const : name of the module, has to outlive the registration
+ *          u8 const     : id of the instance
+ * 
+ * @return  u8 : position, UNDEFINED_MODULE_ID if all MAX_NUMBER_MODULES are taken. 
+ *               Callers keep that value like a position: removing it, the getters and 
+ *               the performance counters ignore it, so a module beyond the table works 
+ *               without registry entry instead of sharing the last position as before.
+ */
+u8 utils_register_module(char * const __module_name, u8 const __id)
+{
+    u8 ret = UNDEFINED_MODULE_ID;
+    u8 pos;
+
+    while (__atomic_test_and_set(&registry_lock, __ATOMIC_ACQUIRE) == true)
+    {
+        utils_cpu_relax();
+    }
+
+    for (pos = 0U; pos < MAX_NUMBER_MODULES; ++pos)
+    {
+        if (module_names[pos] == NULLPTR)
+        {
+            module_names[pos] = (__module_name != NULLPTR) ? __module_name : "UNNAMED";
+            module_ids[pos]   = __id;
+            ret = pos;
+            break;
+        }
+    }
+
+    __atomic_clear(&registry_lock, __ATOMIC_RELEASE);
+
+    if (ret != UNDEFINED_MODULE_ID)
+    {
+        perf_counters_on_register(ret, module_names[ret], __id);
+    }
+
+    return ret;
+}
+
+
+/**
+ * @name    void utils_remove_module_registration(u8 __pos)
+ * 
+ * @brief   frees a position of the module table
+ * 
+ * @param   u8 : position returned by utils_register_module(), UNDEFINED_MODULE_ID 
+ *               is ignored 
+ * 
+ * @return  none.
+ */
+void utils_remove_module_registration(u8 __pos)
+{
+    if (__pos >= MAX_NUMBER_MODULES)
+    {
+        return;
+    }
+
+    perf_counters_on_remove(__pos);
+
+    while (__atomic_test_and_set(&registry_lock, __ATOMIC_ACQUIRE) == true)
+    {
+        utils_cpu_relax();
+    }
+
+    module_names[__pos] = NULLPTR;
+    module_ids[__pos]   = UNDEFINED_MODULE_ID;
+
+    __atomic_clear(&registry_lock, __ATOMIC_RELEASE);
+
+    return;
+}
+
+
+/**
+ * @name    char * utils_get_registered_module_name(u8 __pos)
+ * 
+ * @brief   name of the module at a position
+ * 
+ * @param   u8 : position
+ * 
+ * @return  char * : name, NULLPTR for a free position.
+ */
+char * utils_get_registered_module_name(u8 __pos)
+{
+    return (__pos < MAX_NUMBER_MODULES) ? module_names[__pos] : NULLPTR;
+}
+
+
+/**
+ * @name    u8 utils_get_registered_module_id(u8 __pos)
+ * 
+ * @brief   id of the module at a position
+ * 
+ * @param   u8 : position
+ * 
+ * @return  u8 : id, UNDEFINED_MODULE_ID for a free position.
+ */
+u8 utils_get_registered_module_id(u8 __pos)
+{
+    return ((__pos < MAX_NUMBER_MODULES) && (module_names[__pos] != NULLPTR)) ? module_ids[__pos] : UNDEFINED_MODULE_ID;
+}
@@ -0,0 +1,102 @@
+#include <pthread.h>
+#include <stdio.h> 
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "capture.h"
+#include "capture_export.h"
+
+static void usage(char const * const name)
+{
+    fprintf(stderr, "usage: %s [-f candump|asc] [-i can0,can1,...] [-o file] segment...\n", name);
+}
+
+int main(int argc, char** argv) 
+{ 
+    capture_export  exporter;
+    capture_reader  reader;
+    FILE*           out = stdout;
+    char*           names = NULLPTR;
+    u8              format = CAPTURE_EXPORT_CANDUMP;
+    u64             start_ns = 0U;
+    u64             frames = 0U;
+    int             opt;
+    int             i;
+
+    while ((opt = getopt(argc, argv, "f:i:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'f':
+                format = (strcmp(optarg, "asc") == 0) ? CAPTURE_EXPORT_ASC : CAPTURE_EXPORT_CANDUMP;
+                break;
+            case 'i':
+                names = optarg;
+                break;
+            case 'o':
+                out = fopen(optarg, "w");
+                if (out == NULLPTR)
+                {
+                    perror(optarg);
+                    return 1;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // ASC times are relative to the first segment 
+    if (capture_reader_open(&reader, argv[optind]) == true)
+    {
+        start_ns = (reader.footer != NULLPTR) ? reader.footer->first_ts : 
+                   ((reader.block_count > 0U) ? reader.blocks[0].first_ts : reader.hdr->created_ns);
+        capture_reader_close(&reader);
+    }
+
+    capture_export_init(&exporter, out, format, start_ns);
+    if (names != NULLPTR)
+    {
+        u8 bus = 0U;
+        for (char* name = strtok(names, ","); name != NULLPTR; name = strtok(NULLPTR, ","))
+        {
+            capture_export_set_bus_name(&exporter, bus++, name);
+        }
+    }
+
+    capture_export_begin(&exporter);
+    for (i = optind; i < argc; ++i)
+    {
+        if (capture_reader_open(&reader, argv[i]) == false)
+        {
+            fprintf(stderr, "%s: not a capture segment\n", argv[i]);
+            continue;
+        }
+        if (reader.footer == NULLPTR)
+        {
+            fprintf(stderr, "%s: no footer, index rebuilt from %u blocks\n", argv[i], reader.block_count);
+        }
+        frames += capture_export_segment(&exporter, &reader);
+        capture_reader_close(&reader);
+    }
+    capture_export_end(&exporter);
+
+    fprintf(stderr, "%llu frames exported\n", frames);
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+
+    return 0; 
+}
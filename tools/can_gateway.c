@@ -0,0 +1,310 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "can_socket.h"
+#include "can_id_table.h"
+#include "can_gateway.h"
+#include "perf_counters.h"
+
+#define CAN_GATEWAY_TOOL_MAX_RULES  256U
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig)
+{
+    (void) sig;
+    stop = 1;
+}
+
+static void usage(char const * const name)
+{
+    fprintf(stderr, "usage: %s -i ifname -i ifname... [-t stats_s] [-p perf file] -r rule...\n"
+                    "  rule: SRC:ID[/MASK]>DST[,id=ID[/MASK]][,bN=XX|bN&=XX|bN|=XX|bN^=XX][,rate=HZ[/BURST]]\n"
+                    "  buses are the -i interfaces in order, ids are hex, 8 digits make a 29 bit id.\n"
+                    "  example: 0:100/700>1,id=200/700,b0^=FF,rate=100/10\n"
+                    "  -p exports the performance counters for can_perf, e.g. " PERF_COUNTERS_DEFAULT_PATH "\n", name);
+}
+
+static u64 monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+}
+
+// hex id, 8 digits are an extended id like in candump/cansend
+static __boolean parse_id(char const * const text, char** const end, u32* const id)
+{
+    *id = (u32) strtoul(text, end, 16);
+    if (*end == text)
+    {
+        return false;
+    }
+    if ((*end - text) == 8)
+    {
+        *id = (*id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+    }
+    else if (*id > CAN_SFF_MASK)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+static __boolean parse_rule(char const * const text, u32 bus_count, can_gateway_rule* const rule)
+{
+    char* p;
+    u32 value;
+
+    memset(rule, 0, sizeof(*rule));
+
+    rule->src_bus = (u8) strtoul(text, &p, 10);
+    if ((*p++ != ':') || (parse_id(p, &p, &rule->can_id) == false))
+    {
+        return false;
+    }
+
+    rule->mask = CAN_EFF_MASK;
+    if (*p == '/')
+    {
+        rule->mask = (u32) strtoul(p + 1, &p, 16);
+    }
+
+    if (*p++ != '>')
+    {
+        return false;
+    }
+    rule->dst_bus = (u8) strtoul(p, &p, 10);
+
+    while (*p == ',')
+    {
+        p++;
+        if (strncmp(p, "id=", 3U) == 0)
+        {
+            if (parse_id(p + 3, &p, &rule->rewrite_id) == false)
+            {
+                return false;
+            }
+            rule->rewrite_mask = CAN_EFF_FLAG | CAN_EFF_MASK;
+            if (*p == '/')
+            {
+                rule->rewrite_mask = (u32) strtoul(p + 1, &p, 16);
+            }
+        }
+        else if (strncmp(p, "rate=", 5U) == 0)
+        {
+            rule->rate = (u32) strtoul(p + 5, &p, 10);
+            if (*p == '/')
+            {
+                rule->burst = (u32) strtoul(p + 1, &p, 10);
+            }
+        }
+        else if ((*p == 'b') && (rule->mod_count < CAN_GATEWAY_MAX_MODS))
+        {
+            can_gateway_mod* const mod = &rule->mods[rule->mod_count++];
+
+            mod->index = (u8) strtoul(p + 1, &p, 10);
+            switch (*p)
+            {
+                case '&':
+                    mod->op = CAN_GATEWAY_OP_AND;
+                    p++;
+                    break;
+                case '|':
+                    mod->op = CAN_GATEWAY_OP_OR;
+                    p++;
+                    break;
+                case '^':
+                    mod->op = CAN_GATEWAY_OP_XOR;
+                    p++;
+                    break;
+                default:
+                    mod->op = CAN_GATEWAY_OP_SET;
+                    break;
+            }
+            if (*p++ != '=')
+            {
+                return false;
+            }
+            value = (u32) strtoul(p, &p, 16);
+            mod->value = (u8) value;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return ((*p == '\0') && (rule->src_bus < bus_count) && (rule->dst_bus < bus_count));
+}
+
+static void show(can_gateway const * const gateway, char const * const * const rules, u32 count)
+{
+    can_gateway_route_stats stats;
+
+    printf("\n%-40s %12s %12s %10s %10s %10s %10s %10s\n", "route", "matched", "forwarded", "limited",
+           "dropped", "p50 us", "p99 us", "max us");
+
+    for (u32 i = 0U; i < count; ++i)
+    {
+        can_gateway_get_route_stats(gateway, i, &stats);
+        printf("%-40s %12llu %12llu %10llu %10llu %10.1f %10.1f %10.1f\n", rules[i], stats.matched, stats.forwarded,
+               stats.rate_limited, stats.tx_dropped, (f64) can_gateway_latency_percentile(&stats, 0.5) / 1e3,
+               (f64) can_gateway_latency_percentile(&stats, 0.99) / 1e3, (f64) stats.latency_max_ns / 1e3);
+    }
+
+    for (u32 b = 0U; b < gateway->bus_count; ++b)
+    {
+        printf("bus %u: %llu rx, %llu unrouted, %llu tx, %llu tx dropped\n", b, gateway->buses[b].rx_frames,
+               gateway->buses[b].unrouted, gateway->buses[b].tx_frames, gateway->buses[b].tx_dropped);
+    }
+    fflush(stdout);
+}
+
+static int run(can_gateway* const gateway, can_socket* const sockets, char const * const * const ifnames, u32 bus_count,
+               char const * const * const rules, u32 rule_count, u64 interval_ns)
+{
+    can_gateway_rule rule;
+    u64 next;
+
+    for (u32 b = 0U; b < bus_count; ++b)
+    {
+        // FD on every bus, classic frames pass through FD sockets unchanged
+        if ((can_socket_open(&sockets[b], 0U, ifnames[b], (u8) b, true) == false) ||
+            (can_gateway_add_bus(gateway, &sockets[b], NULLPTR) == CAN_GATEWAY_NONE))
+        {
+            perror(ifnames[b]);
+            return 1;
+        }
+        (void) can_socket_set_buffers(&sockets[b], 1U << 20U, 1U << 20U);
+    }
+
+    for (u32 i = 0U; i < rule_count; ++i)
+    {
+        (void) parse_rule(rules[i], bus_count, &rule);
+        (void) can_gateway_add_rule(gateway, &rule);
+    }
+
+    if (can_gateway_compile(gateway) == false)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    next = monotonic_ns() + interval_ns;
+    while (stop == 0)
+    {
+        (void) can_gateway_process(gateway, 100);
+
+        if ((interval_ns != 0U) && (monotonic_ns() >= next))
+        {
+            show(gateway, rules, rule_count);
+            next += interval_ns;
+        }
+    }
+    show(gateway, rules, rule_count);
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    static can_socket sockets[CAN_GATEWAY_MAX_BUSES];
+    static can_gateway gateway;
+    static char const * rules[CAN_GATEWAY_TOOL_MAX_RULES];
+    static perf_counters perf;
+    char const * perf_path = NULLPTR;
+    char const * ifnames[CAN_GATEWAY_MAX_BUSES];
+    can_gateway_rule rule;
+    u32 bus_count = 0U;
+    u32 rule_count = 0U;
+    u64 interval_ns = 1000000000ULL;
+    int ret;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:r:t:p:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'i':
+                if (bus_count == CAN_GATEWAY_MAX_BUSES)
+                {
+                    fprintf(stderr, "at most %u buses\n", CAN_GATEWAY_MAX_BUSES);
+                    return 1;
+                }
+                ifnames[bus_count++] = optarg;
+                break;
+            case 'r':
+                if (rule_count == CAN_GATEWAY_TOOL_MAX_RULES)
+                {
+                    fprintf(stderr, "at most %u rules\n", CAN_GATEWAY_TOOL_MAX_RULES);
+                    return 1;
+                }
+                rules[rule_count++] = optarg;
+                break;
+            case 't':
+                interval_ns = (u64) strtoull(optarg, NULLPTR, 0) * 1000000000ULL;
+                break;
+            case 'p':
+                perf_path = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if ((bus_count == 0U) || (rule_count == 0U))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for (u32 i = 0U; i < rule_count; ++i)
+    {
+        if (parse_rule(rules[i], bus_count, &rule) == false)
+        {
+            fprintf(stderr, "%s: invalid rule\n", rules[i]);
+            return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    // sockets that are never opened must not be closed
+    for (u32 b = 0U; b < CAN_GATEWAY_MAX_BUSES; ++b)
+    {
+        sockets[b].fd = -1;
+    }
+
+    if ((perf_path != NULLPTR) && (perf_counters_open(&perf, 0U, perf_path) == false))
+    {
+        fprintf(stderr, "%s: cannot create\n", perf_path);
+        return 1;
+    }
+
+    (void) can_gateway_init(&gateway, 0U, rule_count);
+    ret = run(&gateway, sockets, ifnames, bus_count, rules, rule_count, interval_ns);
+    can_gateway_destruct(&gateway);
+    for (u32 b = 0U; b < bus_count; ++b)
+    {
+        can_socket_close(&sockets[b]);
+    }
+
+    if (perf_path != NULLPTR)
+    {
+        perf_counters_close(&perf);
+    }
+
+    return ret;
+}
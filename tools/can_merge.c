@@ -0,0 +1,138 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "capture.h"
+#include "capture_export.h"
+#include "can_socket.h"
+#include "replay.h"
+#include "frame_merge.h"
+
+#define CAN_MERGE_BATCH     256U
+
+static void usage(char const * const name)
+{
+    fprintf(stderr, "usage: %s [-o directory] [-p prefix] [-f candump|asc] [-k] file...\n"
+                    "  merges capture segments and candump logs into one timeline, as capture segments\n"
+                    "  with -o, else as text. File N becomes bus N unless -k keeps the recorded buses.\n", name);
+}
+
+int main(int argc, char** argv)
+{
+    static replay_source sources[FRAME_MERGE_MAX_SOURCES];
+    static frame_merge merge;
+    can_frame_rec const * batch[CAN_MERGE_BATCH];
+    capture_config config = { NULLPTR, "merged", 0U, 0U, 0U };
+    capture_export exporter;
+    capture writer;
+    frame_merge_stats stats;
+    u8 format = CAPTURE_EXPORT_CANDUMP;
+    __boolean keep_bus = false;
+    u32 source_count = 0U;
+    u32 n;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:p:f:kh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'o':
+                config.directory = optarg;
+                break;
+            case 'p':
+                config.prefix = optarg;
+                break;
+            case 'f':
+                format = (strcmp(optarg, "asc") == 0) ? CAPTURE_EXPORT_ASC : CAPTURE_EXPORT_CANDUMP;
+                break;
+            case 'k':
+                keep_bus = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if ((optind >= argc) || ((argc - optind) > (int) FRAME_MERGE_MAX_SOURCES))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    (void) frame_merge_init(&merge, 0U, 0U);
+    for (int i = optind; i < argc; ++i)
+    {
+        if (replay_source_open(&sources[source_count], argv[i]) == false)
+        {
+            fprintf(stderr, "%s: cannot open\n", argv[i]);
+            continue;
+        }
+        if (frame_merge_add_file(&merge, &sources[source_count], (keep_bus == true) ? FRAME_MERGE_KEEP_BUS : (u8) source_count) == FRAME_MERGE_NONE)
+        {
+            fprintf(stderr, "%s: out of memory\n", argv[i]);
+            replay_source_close(&sources[source_count]);
+            continue;
+        }
+        source_count++;
+    }
+
+    if (config.directory != NULLPTR)
+    {
+        if (capture_init(&writer, 0U, &config) == false)
+        {
+            fprintf(stderr, "%s: invalid capture configuration\n", config.directory);
+            return 1;
+        }
+    }
+    else
+    {
+        capture_export_init(&exporter, stdout, format, 0U);
+        capture_export_begin(&exporter);
+    }
+
+    // the capture writer has no thread here, it takes the merged batches directly
+    while ((n = frame_merge_next(&merge, batch, CAN_MERGE_BATCH, FRAME_MERGE_OFFLINE)) != 0U)
+    {
+        if (config.directory != NULLPTR)
+        {
+            if (capture_write_ptrs(&writer, batch, n) != n)
+            {
+                fprintf(stderr, "%s: write failed\n", config.directory);
+                break;
+            }
+            continue;
+        }
+
+        for (u32 i = 0U; i < n; ++i)
+        {
+            capture_export_frame(&exporter, batch[i]);
+        }
+    }
+
+    frame_merge_get_stats(&merge, &stats);
+    frame_merge_destruct(&merge);
+
+    if (config.directory != NULLPTR)
+    {
+        capture_destruct(&writer);
+    }
+    else
+    {
+        capture_export_end(&exporter);
+    }
+
+    for (u32 i = 0U; i < source_count; ++i)
+    {
+        replay_source_close(&sources[i]);
+    }
+
+    fprintf(stderr, "%llu frames from %u files, %llu out of order\n", stats.frames, source_count, stats.late);
+
+    return 0;
+}
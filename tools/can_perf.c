@@ -0,0 +1,72 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "perf_counters.h"
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig)
+{
+    (void) sig;
+    stop = 1;
+}
+
+static void usage(char const * const name)
+{
+    fprintf(stderr, "usage: %s [-p file] [-t interval_ms]\n"
+                    "  prints the performance counters a process exports into file, default " PERF_COUNTERS_DEFAULT_PATH "\n"
+                    "  once, or every interval until interrupted\n", name);
+}
+
+int main(int argc, char** argv)
+{
+    static perf_counters perf;
+    char const * path = PERF_COUNTERS_DEFAULT_PATH;
+    u32 interval_ms = 0U;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:t:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p':
+                path = optarg;
+                break;
+            case 't':
+                interval_ms = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (perf_counters_open_read_only(&perf, path) == false)
+    {
+        fprintf(stderr, "%s: no performance counters\n", path);
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    printf("pid %u, %u cpus, tsc %.3f GHz\n", perf.file->pid, perf.cpu_count, (f64) perf.file->tsc_hz / 1e9);
+    do
+    {
+        perf_counters_dump(&perf);
+        fflush(stdout);
+
+        if (interval_ms != 0U)
+        {
+            usleep(interval_ms * 1000U);
+            printf("\n");
+        }
+    } while ((interval_ms != 0U) && (stop == 0));
+
+    perf_counters_close(&perf);
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "can_socket.h"
+#include "epoll_handler.h"
+#include "frame_publisher.h"
+
+#define CAN_PUBLISH_DEFAULT_PATH    "/tmp/can4linux.sock"
+#define CAN_PUBLISH_MAX_BUSES       8U
+#define CAN_PUBLISH_MAX_FILTERS     FRAME_PUBLISHER_MAX_FILTERS
+#define CAN_PUBLISH_BATCH           CAN_SOCKET_MAX_BATCH
+
+struct bus_t
+{
+    can_socket          socket;
+    frame_publisher*    publisher;
+};
+
+typedef struct bus_t bus;
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig)
+{
+    (void) sig;
+    stop = 1;
+}
+
+static void usage(char const * const name)
+{
+    fprintf(stderr, "usage: %s -i ifname [-i ifname...] [-s socket] [-q queue bytes] [-l latency us] [-d]   serve\n"
+                    "       %s -c [-s socket] [-f filter...]                                           subscribe\n"
+                    "  the server publishes the frames of the interfaces to the clients of socket,\n"
+                    "  default " CAN_PUBLISH_DEFAULT_PATH "; -d disconnects slow clients instead of dropping.\n"
+                    "  filter: ID[/MASK][@BUS] in hex like candump or all (default), e.g. 100/700@0\n", name, name);
+}
+
+// the loop wakes on the CAN sockets themselves, no receive thread 
+static void on_frames(void* ctx, int fd, u32 events)
+{
+    bus* const me = (bus*) ctx;
+    can_frame_rec frames[CAN_PUBLISH_BATCH];
+    u32 count;
+
+    (void) fd;
+    (void) events;
+
+    while ((count = can_socket_recv_batch(&me->socket, frames, CAN_PUBLISH_BATCH)) != 0U)
+    {
+        (void) frame_publisher_publish(me->publisher, frames, count);
+    }
+}
+
+static int serve(char const * const path, char const * const * const ifnames, u32 bus_count,
+                 frame_publisher_config const * const config)
+{
+    static frame_publisher publisher;
+    static bus buses[CAN_PUBLISH_MAX_BUSES];
+    frame_publisher_stats stats;
+    int ret = 0;
+
+    if (frame_publisher_init(&publisher, 0U, path, config) == false)
+    {
+        perror(path);
+        return 1;
+    }
+
+    for (u32 b = 0U; b < CAN_PUBLISH_MAX_BUSES; ++b)
+    {
+        buses[b].socket.fd = -1;
+        buses[b].publisher = &publisher;
+    }
+
+    for (u32 b = 0U; (b < bus_count) && (ret == 0); ++b)
+    {
+        if ((can_socket_open(&buses[b].socket, 0U, ifnames[b], (u8) b, true) == false) || 
+            (can_socket_set_nonblocking(&buses[b].socket, true) == false) || 
+            (epoll_handler_add(&publisher.loop, buses[b].socket.fd, EPOLLIN, on_frames, &buses[b]) == false))
+        {
+            perror(ifnames[b]);
+            ret = 1;
+        }
+    }
+
+    while ((stop == 0) && (ret == 0))
+    {
+        (void) frame_publisher_process(&publisher, 100);
+    }
+
+    frame_publisher_get_stats(&publisher, &stats);
+    fprintf(stderr, "%llu frames, %llu clients, %llu rejected, %llu disconnected, %llu closed\n", stats.frames,
+            stats.accepted, stats.rejected, stats.disconnected, stats.closed);
+
+    for (u32 b = 0U; b < bus_count; ++b)
+    {
+        (void) epoll_handler_remove(&publisher.loop, buses[b].socket.fd);
+        can_socket_close(&buses[b].socket);
+    }
+    frame_publisher_destruct(&publisher);
+
+    return ret;
+}
+
+static int subscribe(char const * const path, char const * const * const filters, u32 filter_count)
+{
+    static u8 buf[1U << 16U];
+    struct sockaddr_un addr;
+    char line[64];
+    u32 used = 0U;
+    ssize_t n;
+    int fd;
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1U);
+    if ((fd < 0) || (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0))
+    {
+        perror(path);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return 1;
+    }
+
+    for (u32 f = 0U; f < GET_MAX(filter_count, 1U); ++f)
+    {
+        snprintf(line, sizeof(line), "filter %s\n", (filter_count != 0U) ? filters[f] : "all");
+        (void) write(fd, line, strlen(line));
+    }
+
+    while ((stop == 0) && ((n = read(fd, &buf[used], sizeof(buf) - used)) > 0))
+    {
+        u32 pos = 0U;
+
+        used += (u32) n;
+        while ((used - pos) >= FRAME_PUBLISHER_RECORD_HEADER)
+        {
+            can_frame_rec rec;
+            u32 const len = buf[pos + __builtin_offsetof(can_frame_rec, len)];
+            u32 const size = FRAME_PUBLISHER_RECORD_HEADER + GET_MIN(len, CAN_FRAME_MAX_DATA);
+
+            if ((used - pos) < size)
+            {
+                break;
+            }
+            memcpy(&rec, &buf[pos], size);
+            pos += size;
+
+            printf("(%llu.%06llu) bus%u %*X [%u]", rec.timestamp_ns / 1000000000ULL, 
+                   (rec.timestamp_ns % 1000000000ULL) / 1000ULL, rec.bus, CAN_FRAME_IS_EXT(rec.can_id) ? 8 : 3, 
+                   CAN_FRAME_ID(rec.can_id), rec.len);
+            for (u32 i = 0U; i < rec.len; ++i)
+            {
+                printf(" %02X", rec.data[i]);
+            }
+            printf("\n");
+        }
+        fflush(stdout);
+
+        memmove(buf, &buf[pos], used - pos);
+        used -= pos;
+    }
+
+    close(fd);
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    char const * ifnames[CAN_PUBLISH_MAX_BUSES];
+    char const * filters[CAN_PUBLISH_MAX_FILTERS];
+    char const * path = CAN_PUBLISH_DEFAULT_PATH;
+    frame_publisher_config config;
+    __boolean client = false;
+    u32 bus_count = 0U;
+    u32 filter_count = 0U;
+    int opt;
+
+    memset(&config, 0, sizeof(config));
+    config.sndbuf = 1U << 20U;
+
+    while ((opt = getopt(argc, argv, "i:s:q:l:dcf:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'i':
+                if (bus_count == CAN_PUBLISH_MAX_BUSES)
+                {
+                    fprintf(stderr, "at most %u buses\n", CAN_PUBLISH_MAX_BUSES);
+                    return 1;
+                }
+                ifnames[bus_count++] = optarg;
+                break;
+            case 's':
+                path = optarg;
+                break;
+            case 'q':
+                config.queue_bytes = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'l':
+                config.latency_ns = (u64) strtoull(optarg, NULLPTR, 0) * 1000ULL;
+                break;
+            case 'd':
+                config.policy = FRAME_PUBLISHER_DISCONNECT;
+                break;
+            case 'c':
+                client = true;
+                break;
+            case 'f':
+                if (filter_count == CAN_PUBLISH_MAX_FILTERS)
+                {
+                    fprintf(stderr, "at most %u filters\n", CAN_PUBLISH_MAX_FILTERS);
+                    return 1;
+                }
+                filters[filter_count++] = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    if (client == true)
+    {
+        return subscribe(path, filters, filter_count);
+    }
+
+    if (bus_count == 0U)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    return serve(path, ifnames, bus_count, &config);
+}
@@ -0,0 +1,259 @@
+#include <pthread.h>
+#include <stdio.h> 
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "capture.h"
+#include "capture_export.h"
+#include "capture_query.h"
+
+struct query_output_t
+{
+    capture_export  exporter;
+    u8              count_only;
+};
+
+static void usage(char const * const name)
+{
+    fprintf(stderr, "usage: %s [-i id[/mask]]... [-f from] [-t to] [-b bus]... [-j threads] [-c] [-F candump|asc] segment...\n"
+                    "  ids: hex with optional 0x, more than three digits or above 7FF select a 29 bit ID\n"
+                    "  times: unix seconds[.frac], HH:MM[:SS[.frac]] on the day of the first segment, +seconds from its start\n", name);
+}
+
+static void print_frames(void* ctx, can_frame_rec const * frames, u32 count)
+{
+    struct query_output_t* const output = (struct query_output_t*) ctx;
+
+    if (output->count_only == false)
+    {
+        for (u32 i = 0U; i < count; ++i)
+        {
+            capture_export_frame(&output->exporter, &frames[i]);
+        }
+    }
+}
+
+// seconds with up to nine fractional digits 
+static __boolean parse_seconds(char const * text, u64* const ns)
+{
+    char* end;
+    u64 const seconds = strtoull(text, &end, 10);
+    u64 frac = 0U;
+    u32 digits = 0U;
+
+    if (*end == '.')
+    {
+        for (++end; (*end >= '0') && (*end <= '9'); ++end)
+        {
+            if (digits < 9U)
+            {
+                frac = (frac * 10U) + (u64) (*end - '0');
+                ++digits;
+            }
+        }
+    }
+    for (; digits < 9U; ++digits)
+    {
+        frac *= 10U;
+    }
+
+    *ns = (seconds * 1000000000ULL) + frac;
+    return (end != text) && (*end == '\0');
+}
+
+static __boolean parse_time(char const * text, u64 start_ns, u64* const ns)
+{
+    unsigned hour;
+    unsigned minute;
+    int used = 0;
+
+    if (text[0] == '+')
+    {
+        u64 offset;
+        if (parse_seconds(&text[1], &offset) == false)
+        {
+            return false;
+        }
+        *ns = start_ns + offset;
+        return true;
+    }
+
+    if ((sscanf(text, "%u:%u%n", &hour, &minute, &used) == 2) && (hour < 24U) && (minute < 60U))
+    {
+        time_t const start = (time_t) (start_ns / 1000000000ULL);
+        struct tm day;
+        u64 seconds = 0U;
+
+        if ((text[used] == ':') && (parse_seconds(&text[used + 1], &seconds) == false))
+        {
+            return false;
+        }
+        if ((text[used] != ':') && (text[used] != '\0'))
+        {
+            return false;
+        }
+        localtime_r(&start, &day);
+        day.tm_hour  = (int) hour;
+        day.tm_min   = (int) minute;
+        day.tm_sec   = 0;
+        day.tm_isdst = -1;
+        *ns = ((u64) mktime(&day) * 1000000000ULL) + seconds;
+        return true;
+    }
+
+    return parse_seconds(text, ns);
+}
+
+int main(int argc, char** argv) 
+{ 
+    static struct query_output_t output;
+    capture_query   query;
+    capture_reader  reader;
+    char const *    from = NULLPTR;
+    char const *    to = NULLPTR;
+    u8              format = CAPTURE_EXPORT_CANDUMP;
+    u8              threads = 1U;
+    u32             bus_mask = 0U;
+    u64             start_ns = 0U;
+    u64             from_ns = 0U;
+    u64             to_ns = (u64) -1;
+    u64             frames = 0U;
+    int             opt;
+    int             i;
+
+    capture_query_init(&query);
+
+    while ((opt = getopt(argc, argv, "i:f:t:b:j:cF:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'i':
+            {
+                char const * digits = optarg;
+                char* end;
+                u32 id;
+                u32 mask;
+
+                if ((digits[0] == '0') && ((digits[1] == 'x') || (digits[1] == 'X')))
+                {
+                    digits += 2;
+                }
+                id = (u32) strtoul(digits, &end, 16);
+                if ((end == digits) || (strspn(digits, "0123456789abcdefABCDEF") != (size_t) (end - digits)) || 
+                    ((*end != '/') && (*end != '\0')))
+                {
+                    fprintf(stderr, "%s: invalid ID\n", optarg);
+                    return 1;
+                }
+                // more than three hex digits or an ID above 0x7FF select an extended ID 
+                if (((end - digits) > 3) || (id > CAN_SFF_MASK))
+                {
+                    id |= CAN_EFF_FLAG;
+                }
+                mask = CAN_EFF_FLAG | (((id & CAN_EFF_FLAG) != 0U) ? CAN_EFF_MASK : CAN_SFF_MASK);
+                if (*end == '/')
+                {
+                    char const * const text = end + 1;
+
+                    mask = CAN_EFF_FLAG | (u32) strtoul(text, &end, 16);
+                    if ((end == text) || (strspn(text, "0123456789abcdefABCDEFxX") != (size_t) (end - text)) || (*end != '\0'))
+                    {
+                        fprintf(stderr, "%s: invalid mask\n", optarg);
+                        return 1;
+                    }
+                }
+                if (capture_query_add_id(&query, id, mask) == false)
+                {
+                    fprintf(stderr, "too many ID filters\n");
+                    return 1;
+                }
+                break;
+            }
+            case 'f':
+                from = optarg;
+                break;
+            case 't':
+                to = optarg;
+                break;
+            case 'b':
+                bus_mask |= 1U << (strtoul(optarg, NULLPTR, 0) % 32U);
+                break;
+            case 'j':
+                threads = (u8) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'c':
+                output.count_only = true;
+                break;
+            case 'F':
+                format = (strcmp(optarg, "asc") == 0) ? CAPTURE_EXPORT_ASC : CAPTURE_EXPORT_CANDUMP;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // relative times and time of day refer to the first segment 
+    if (capture_reader_open(&reader, argv[optind]) == true)
+    {
+        start_ns = (reader.footer != NULLPTR) ? reader.footer->first_ts : 
+                   ((reader.block_count > 0U) ? reader.blocks[0].first_ts : reader.hdr->created_ns);
+        capture_reader_close(&reader);
+    }
+
+    if (((from != NULLPTR) && (parse_time(from, start_ns, &from_ns) == false)) || 
+        ((to != NULLPTR) && (parse_time(to, start_ns, &to_ns) == false)))
+    {
+        fprintf(stderr, "invalid time\n");
+        return 1;
+    }
+
+    capture_query_set_time(&query, from_ns, to_ns);
+    capture_query_set_threads(&query, threads);
+    if (bus_mask != 0U)
+    {
+        query.bus_mask = bus_mask;
+    }
+
+    capture_export_init(&output.exporter, stdout, format, start_ns);
+    if (output.count_only == false)
+    {
+        capture_export_begin(&output.exporter);
+    }
+
+    for (i = optind; i < argc; ++i)
+    {
+        if (capture_reader_open(&reader, argv[i]) == false)
+        {
+            fprintf(stderr, "%s: not a capture segment\n", argv[i]);
+            continue;
+        }
+        frames += capture_query_segment(&query, &reader, print_frames, &output);
+        capture_reader_close(&reader);
+    }
+
+    if (output.count_only == false)
+    {
+        capture_export_end(&output.exporter);
+    }
+    else
+    {
+        printf("%llu\n", frames);
+    }
+
+    fprintf(stderr, "%llu frames matched, %llu scanned, %llu of %llu blocks read\n", 
+            frames, query.stats.frames_scanned, query.stats.blocks_candidate, query.stats.blocks_total);
+
+    return 0; 
+}
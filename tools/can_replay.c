@@ -0,0 +1,123 @@
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h> 
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "frame_ring.h"
+#include "capture.h"
+#include "can_socket.h"
+#include "replay.h"
+
+static replay engine;
+
+static void on_signal(int sig)
+{
+    (void) sig;
+    replay_stop(&engine);
+}
+
+static void usage(char const * const name)
+{
+    fprintf(stderr, "usage: %s [-s speed|max] [-i vcan0,vcan1,...] [-w window_us] [-S spin_us] [-n] file...\n"
+                    "  bus N of the recording is sent on the N-th interface, -n replays without sending\n", name);
+}
+
+int main(int argc, char** argv) 
+{ 
+    static can_socket sockets[CAN_FRAME_MAX_BUSES];
+    replay_config   config = { 1.0, REPLAY_DEFAULT_SPIN_NS, REPLAY_DEFAULT_WINDOW_NS, false };
+    replay_source   source;
+    replay_stats    stats;
+    char*           names = NULLPTR;
+    u8              bus = 0U;
+    int             opt;
+    int             i;
+
+    while ((opt = getopt(argc, argv, "s:i:w:S:nh")) != -1)
+    {
+        switch (opt)
+        {
+            case 's':
+                config.speed = (strcmp(optarg, "max") == 0) ? REPLAY_SPEED_MAX : strtod(optarg, NULLPTR);
+                break;
+            case 'i':
+                names = optarg;
+                break;
+            case 'w':
+                config.window_ns = (u32) strtoul(optarg, NULLPTR, 0) * 1000U;
+                break;
+            case 'S':
+                config.spin_ns = (u32) strtoul(optarg, NULLPTR, 0) * 1000U;
+                break;
+            case 'n':
+                config.dry_run = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if ((optind >= argc) || ((names == NULLPTR) && (config.dry_run == false)))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (replay_init(&engine, 6U, &config) == false)
+    {
+        fprintf(stderr, "invalid replay configuration\n");
+        return 1;
+    }
+
+    for (char* name = (names != NULLPTR) ? strtok(names, ",") : NULLPTR; name != NULLPTR; name = strtok(NULLPTR, ","), ++bus)
+    {
+        if ((can_socket_open(&sockets[bus], 20U + bus, name, bus, true) == false) &&
+            (can_socket_open(&sockets[bus], 20U + bus, name, bus, false) == false))
+        {
+            perror(name);
+            return 1;
+        }
+        (void) replay_map_bus(&engine, bus, &sockets[bus]);
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    for (i = optind; i < argc; ++i)
+    {
+        if (replay_source_open(&source, argv[i]) == false)
+        {
+            fprintf(stderr, "%s: cannot open\n", argv[i]);
+            continue;
+        }
+        if (replay_run(&engine, &source) == false)
+        {
+            replay_source_close(&source);
+            break;
+        }
+        replay_source_close(&source);
+    }
+
+    replay_get_stats(&engine, &stats);
+    printf("frames      %llu (%llu batches, %llu tx errors, %llu unmapped)\n", 
+           stats.frames, stats.batches, stats.tx_errors, stats.unmapped);
+    printf("elapsed     %.3f s, %.0f frames/s\n", (f64) stats.elapsed_ns / 1e9, stats.rate_fps);
+    if (config.speed != REPLAY_SPEED_MAX)
+    {
+        printf("error (ns)  min %lld mean %.0f max %lld p50 < %llu p99 < %llu\n", 
+               stats.error_min_ns, stats.error_mean_ns, stats.error_max_ns, stats.error_p50_ns, stats.error_p99_ns);
+    }
+
+    replay_destruct(&engine);
+    for (u8 b = 0U; b < bus; ++b)
+    {
+        can_socket_close(&sockets[b]);
+    }
+
+    return 0; 
+}
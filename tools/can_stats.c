@@ -0,0 +1,206 @@
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "utils.h"
+#include "can_data_types.h"
+#include "can_socket.h"
+#include "bus_stats.h"
+
+#define CAN_STATS_DEFAULT_PATH      "/dev/shm/can_stats"
+#define CAN_STATS_MAX_IDS           (BUS_STATS_STD_IDS + BUS_STATS_MAX_EXT_SLOTS)
+#define CAN_STATS_BATCH             64U
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig)
+{
+    (void) sig;
+    stop = 1;
+}
+
+static void usage(char const * const name)
+{
+    fprintf(stderr, "usage: %s -i ifname -b bitrate [-d data_bitrate] [-t interval_ms] [-p file]   collect\n"
+                    "       %s [-p file] [-f]                                                   show, -f follows\n"
+                    "  the collector publishes a snapshot per interval into file, default " CAN_STATS_DEFAULT_PATH "\n",
+                    name, name);
+}
+
+static u64 realtime_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ((u64) ts.tv_sec * 1000000000ULL) + (u64) ts.tv_nsec;
+}
+
+static void show(bus_stats_bus const * const bus, bus_stats_id const * const ids, u32 count)
+{
+    printf("\n%.3f s: %llu frames %.0f/s, load %.1f %%, %llu error frames, %llu ids without slot\n",
+           (f64) (bus->end_ns - bus->start_ns) / 1e9, bus->frames, bus->frame_rate, bus->load * 100.0,
+           bus->error_frames, bus->dropped_ids);
+
+    printf("dlc");
+    for (u32 d = 0U; d < BUS_STATS_DLC_COUNT; ++d)
+    {
+        if (bus->dlc[d] != 0U)
+        {
+            printf(" %u:%llu", d, bus->dlc[d]);
+        }
+    }
+    printf("\n%-10s %10s %12s %12s %12s %12s %12s %4s\n", "id", "frames/s", "period ms", "jitter us",
+           "min ms", "max ms", "total", "dlc");
+
+    for (u32 i = 0U; i < count; ++i)
+    {
+        printf("%-10X %10.1f %12.3f %12.2f %12.3f %12.3f %12llu %4u\n", CAN_FRAME_ID(ids[i].can_id), ids[i].rate,
+               ids[i].period_mean_ns / 1e6, ids[i].jitter_ns / 1e3, (f64) ids[i].period_min_ns / 1e6,
+               (f64) ids[i].period_max_ns / 1e6, ids[i].frames_total, ids[i].dlc);
+    }
+}
+
+static int collect(char const * const ifname, char const * const path, u32 bitrate, u32 data_bitrate, u64 interval_ns)
+{
+    static bus_stats stats;
+    static can_socket sock;
+    can_frame_rec frames[CAN_STATS_BATCH];
+    struct pollfd pfd;
+
+    if (can_socket_open(&sock, 0U, ifname, 0U, (data_bitrate != 0U) ? true : false) == false)
+    {
+        perror(ifname);
+        return 1;
+    }
+
+    if (bus_stats_init(&stats, 1U, path, bitrate, data_bitrate, 0U, interval_ns) == false)
+    {
+        fprintf(stderr, "%s: cannot create\n", path);
+        can_socket_close(&sock);
+        return 1;
+    }
+
+    can_socket_set_nonblocking(&sock, true);
+    pfd.fd     = sock.fd;
+    pfd.events = POLLIN;
+
+    while (stop == 0)
+    {
+        u32 const count = can_socket_recv_batch(&sock, frames, CAN_STATS_BATCH);
+
+        if (count != 0U)
+        {
+            bus_stats_update_batch(&stats, frames, count);
+            continue;
+        }
+
+        // an idle bus still needs its snapshots, the frame clock is CLOCK_REALTIME
+        (void) poll(&pfd, 1, 100);
+        if ((stats.next_snapshot != 0U) && (realtime_ns() >= stats.next_snapshot))
+        {
+            bus_stats_snapshot(&stats, realtime_ns());
+        }
+    }
+
+    bus_stats_destruct(&stats);
+    can_socket_close(&sock);
+
+    return 0;
+}
+
+static int display(char const * const path, __boolean follow)
+{
+    static bus_stats stats;
+    static bus_stats_id ids[CAN_STATS_MAX_IDS];
+    bus_stats_bus bus;
+    u64 last_end = 0U;
+    u32 count;
+
+    if (bus_stats_open_read_only(&stats, path) == false)
+    {
+        fprintf(stderr, "%s: no bus statistics\n", path);
+        return 1;
+    }
+
+    do
+    {
+        count = bus_stats_read(&stats, &bus, ids, CAN_STATS_MAX_IDS);
+        if ((count != 0U) && (bus.end_ns != last_end))
+        {
+            show(&bus, ids, GET_MIN(count, CAN_STATS_MAX_IDS));
+            fflush(stdout);
+            last_end = bus.end_ns;
+        }
+        else if (follow == false)
+        {
+            printf("no snapshot yet\n");
+        }
+
+        if (follow == true)
+        {
+            usleep(100000U);
+        }
+    } while ((follow == true) && (stop == 0));
+
+    bus_stats_destruct(&stats);
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    char const * ifname = NULLPTR;
+    char const * path = CAN_STATS_DEFAULT_PATH;
+    u32 bitrate = 0U;
+    u32 data_bitrate = 0U;
+    u64 interval_ns = BUS_STATS_DEFAULT_INTERVAL_NS;
+    __boolean follow = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:b:d:t:p:fh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'i':
+                ifname = optarg;
+                break;
+            case 'b':
+                bitrate = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 'd':
+                data_bitrate = (u32) strtoul(optarg, NULLPTR, 0);
+                break;
+            case 't':
+                interval_ns = (u64) strtoull(optarg, NULLPTR, 0) * 1000000ULL;
+                break;
+            case 'p':
+                path = optarg;
+                break;
+            case 'f':
+                follow = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    if (ifname != NULLPTR)
+    {
+        if (bitrate == 0U)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        return collect(ifname, path, bitrate, data_bitrate, interval_ns);
+    }
+
+    return display(path, follow);
+}
@@ -0,0 +1,351 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2023 Houssem Chekili <houssem.chekili@outlook.de>
+# SPDX-License-Identifier: MIT
+#
+# CANopen object dictionary generator. Reads a JSON description and writes a C source
+# and header with const tables for inc/canopen_od.h:
+#   - <name>_keys:    sorted (index << 8 | subindex) keys in whole cache lines and the
+#                     first key of every line, searched by canopen_od_find()
+#   - <name>_entries: access metadata in key order (offset, type, size, access)
+#   - <name>_data:    one struct holding all values, initialised with the defaults
+#   - <NAME>_POS_<index>_<sub> and <NAME>_VAR_<index>_<sub> macros for entries known at
+#     compile time, so application code reaches them without a lookup
+#
+# JSON format:
+#   {
+#     "name": "device_od",
+#     "objects": [
+#       { "index": "0x1017", "name": "Producer heartbeat time", "type": "UNSIGNED16",
+#         "access": "rw", "default": 1000 },
+#       { "index": "0x1018", "name": "Identity object", "subs": [
+#           { "sub": 0, "name": "Highest sub-index", "type": "UNSIGNED8", "access": "const", "default": 4 },
+#           { "sub": 1, "name": "Vendor-ID", "type": "UNSIGNED32", "access": "ro", "pdo": "t" } ] },
+#       { "index": "0x1008", "name": "Device name", "type": "VISIBLE_STRING", "size": 16,
+#         "access": "const", "default": "can4linux" }
+#     ]
+#   }
+# access is one of ro, wo, rw, const; pdo is "t", "r" or "tr". Defaults may be numbers,
+# "0x" strings or "$NODEID+<value>" which is resolved with --node-id. REAL defaults must be
+# finite and fit the type, there is no literal for inf or nan without <math.h>.
+#
+# usage: canopen_od_gen.py [-o dir] [--name name] [--node-id n] od.json
+#        canopen_od_gen.py [-o dir] [--name name] --synthetic <entries>
+
+import argparse
+import json
+import math
+import os
+import re
+import struct
+import sys
+
+TYPES = {
+    # name: (code, size, C type, struct format)
+    "BOOLEAN":        (0x0001, 1, "u8",   "<B"),
+    "INTEGER8":       (0x0002, 1, "s8",   "<b"),
+    "INTEGER16":      (0x0003, 2, "s16",  "<h"),
+    "INTEGER32":      (0x0004, 4, "s32",  "<i"),
+    "UNSIGNED8":      (0x0005, 1, "u8",   "<B"),
+    "UNSIGNED16":     (0x0006, 2, "u16",  "<H"),
+    "UNSIGNED32":     (0x0007, 4, "u32",  "<I"),
+    "REAL32":         (0x0008, 4, "f32",  "<f"),
+    "VISIBLE_STRING": (0x0009, 0, "char", None),
+    "OCTET_STRING":   (0x000A, 0, "u8",   None),
+    "DOMAIN":         (0x000F, 0, "u8",   None),
+    "REAL64":         (0x0011, 8, "f64",  "<d"),
+    "INTEGER64":      (0x0015, 8, "s64",  "<q"),
+    "UNSIGNED64":     (0x001B, 8, "u64",  "<Q"),
+}
+
+ACCESS = {
+    "ro":    0x01,
+    "wo":    0x02,
+    "rw":    0x03,
+    "const": 0x05,
+}
+
+PDO = {
+    "":   0x00,
+    "t":  0x10,
+    "r":  0x20,
+    "tr": 0x30,
+    "rt": 0x30,
+}
+
+
+class GeneratorError(Exception):
+    pass
+
+
+def parse_int(value, what):
+    if isinstance(value, bool):
+        return int(value)
+    if isinstance(value, int):
+        return value
+    try:
+        return int(str(value), 0)
+    except ValueError:
+        raise GeneratorError("%s: not a number: %r" % (what, value))
+
+
+def resolve_default(value, node_id, what):
+    if isinstance(value, str) and value.upper().startswith("$NODEID"):
+        rest = value[len("$NODEID"):].strip()
+        offset = parse_int(rest.lstrip("+").strip(), what) if rest else 0
+        return node_id + offset
+    return value
+
+
+def identifier(text):
+    ident = re.sub(r"[^0-9a-zA-Z]+", "_", text).strip("_").lower()
+    return ident[:40] if ident else "entry"
+
+
+def flatten(objects, node_id):
+    """One entry per (index, sub) with size, access and default resolved."""
+    entries = []
+    for obj in objects:
+        index = parse_int(obj["index"], "index")
+        subs = obj.get("subs")
+        if subs is None:
+            subs = [dict(obj, sub=0)]
+        for sub in subs:
+            what = "0x%04X sub %s" % (index, sub.get("sub"))
+            type_name = sub.get("type", obj.get("type", "")).upper()
+            if type_name not in TYPES:
+                raise GeneratorError("%s: unknown type %r" % (what, type_name))
+            code, size, ctype, fmt = TYPES[type_name]
+            if size == 0:
+                size = parse_int(sub.get("size", 0), what + " size")
+                if size <= 0 or size > 0xFFFF:
+                    raise GeneratorError("%s: %s needs a size" % (what, type_name))
+            access = sub.get("access", obj.get("access", "rw")).lower()
+            if access not in ACCESS:
+                raise GeneratorError("%s: unknown access %r" % (what, access))
+            pdo = sub.get("pdo", obj.get("pdo", "")).lower()
+            if pdo not in PDO:
+                raise GeneratorError("%s: unknown pdo mapping %r" % (what, pdo))
+            entries.append({
+                "index":   index,
+                "sub":     parse_int(sub.get("sub", 0), what),
+                "name":    sub.get("name", obj.get("name", "")),
+                "object":  obj.get("name", ""),
+                "type":    type_name,
+                "code":    code,
+                "size":    size,
+                "ctype":   ctype,
+                "fmt":     fmt,
+                "access":  ACCESS[access] | PDO[pdo],
+                "default": resolve_default(sub.get("default", 0 if fmt else ""), node_id, what),
+            })
+
+    entries.sort(key=lambda e: (e["index"], e["sub"]))
+    for a, b in zip(entries, entries[1:]):
+        if (a["index"], a["sub"]) == (b["index"], b["sub"]):
+            raise GeneratorError("0x%04X sub %u defined twice" % (a["index"], a["sub"]))
+    for e in entries:
+        if not (0 <= e["index"] <= 0xFFFF and 0 <= e["sub"] <= 0xFF):
+            raise GeneratorError("0x%X sub %u out of range" % (e["index"], e["sub"]))
+    return entries
+
+
+def c_initializer(entry):
+    value = entry["default"]
+    if entry["fmt"] is None:
+        data = value.encode("utf-8") if isinstance(value, str) else bytes(value)
+        if len(data) > entry["size"]:
+            raise GeneratorError("0x%04X sub %u: default longer than %u bytes" %
+                                 (entry["index"], entry["sub"], entry["size"]))
+        return "{ " + ", ".join("0x%02X" % b for b in data) + (" }" if data else "0 }")
+    if entry["ctype"] in ("f32", "f64"):
+        what = "0x%04X sub %u default" % (entry["index"], entry["sub"])
+        try:
+            number = float(value)
+            struct.pack(entry["fmt"], number)
+        except (TypeError, ValueError, OverflowError, struct.error):
+            raise GeneratorError("%s: %r is not a %s" % (what, value, entry["type"]))
+        if not math.isfinite(number):
+            raise GeneratorError("%s: %r is not finite" % (what, value))
+        return repr(number)
+    number = parse_int(value, "0x%04X sub %u default" % (entry["index"], entry["sub"]))
+    try:
+        struct.pack(entry["fmt"], number)
+    except struct.error:
+        raise GeneratorError("0x%04X sub %u: default %d does not fit %s" %
+                             (entry["index"], entry["sub"], number, entry["type"]))
+    if entry["ctype"].startswith("u"):
+        return "0x%XU" % number + ("LL" if entry["size"] == 8 else "")
+    if entry["size"] == 8:
+        return "%dLL" % number
+    return "%d" % number
+
+
+def field(entry):
+    return "x%04X_%02X_%s" % (entry["index"], entry["sub"], identifier(entry["name"] or entry["object"]))
+
+
+def access_text(access):
+    flags = []
+    for bit, name in ((0x01, "CANOPEN_OD_READ"), (0x02, "CANOPEN_OD_WRITE"), (0x04, "CANOPEN_OD_CONST"),
+                      (0x10, "CANOPEN_OD_TPDO"), (0x20, "CANOPEN_OD_RPDO")):
+        if access & bit:
+            flags.append(name)
+    return " | ".join(flags) if flags else "0U"
+
+
+# keys per 64 byte cache line, CANOPEN_OD_LINE_KEYS
+LINE_KEYS = 16
+
+LICENSE = """/*
+ * Generated by tools/canopen_od_gen.py from %s, do not edit.
+ */
+"""
+
+
+def generate(entries, name, source, out_dir):
+    upper = name.upper()
+    fields = [field(e) for e in entries]
+
+    # largest members first, the struct then needs no padding between values
+    order = sorted(range(len(entries)), key=lambda i: (-(entries[i]["size"] if entries[i]["fmt"] else 1), i))
+
+    h = []
+    h.append(LICENSE % source)
+    h.append("#ifndef __%s_H_\n#define __%s_H_\n" % (upper, upper))
+    h.append("#include \"utils.h\"\n#include \"canopen_od.h\"\n")
+    h.append("#define %s_COUNT %uU\n" % (upper, len(entries)))
+    h.append("// positions in the tables, for entries known at compile time ")
+    for pos, e in enumerate(entries):
+        h.append("#define %s_POS_%04X_%02X %uU" % (upper, e["index"], e["sub"], pos))
+    h.append("")
+    h.append("struct %s_data_t\n{" % name)
+    for i in order:
+        e = entries[i]
+        if e["fmt"] is None:
+            h.append("    %-6s %s[%u];" % (e["ctype"], fields[i], e["size"]))
+        else:
+            h.append("    %-6s %s;" % (e["ctype"], fields[i]))
+    h.append("};\n")
+    h.append("typedef struct %s_data_t %s_data_type;\n" % (name, name))
+    h.append("extern %s_data_type %s_data;" % (name, name))
+    h.append("extern canopen_od const %s;\n" % name)
+    h.append("// values of entries known at compile time ")
+    for e, f in zip(entries, fields):
+        h.append("#define %s_VAR_%04X_%02X (%s_data.%s)" % (upper, e["index"], e["sub"], name, f))
+    h.append("\n#endif /* __%s_H_ */" % upper)
+
+    c = []
+    c.append(LICENSE % source)
+    c.append("#include <stddef.h>\n")
+    c.append("#include \"utils.h\"\n#include \"canopen_od.h\"\n#include \"%s.h\"\n" % name)
+    c.append("%s_data_type %s_data =\n{" % (name, name))
+    for i in order:
+        c.append("    .%s = %s," % (fields[i], c_initializer(entries[i])))
+    c.append("};\n")
+    keys = [(e["index"] << 8) | e["sub"] for e in entries]
+    lines = (len(keys) + LINE_KEYS - 1) // LINE_KEYS
+    c.append("// padded to whole cache lines, fences hold the first key of every line ")
+    c.append("static u32 const %s_keys[%u] __attribute__ ((aligned(64))) =\n{" % (name, lines * LINE_KEYS))
+    for line in range(lines):
+        chunk = keys[line * LINE_KEYS:(line + 1) * LINE_KEYS]
+        chunk += [0xFFFFFFFF] * (LINE_KEYS - len(chunk))
+        c.append("    " + " ".join("0x%06XU," % k for k in chunk))
+    c.append("};\n")
+    c.append("static u32 const %s_fences[%u] =\n{" % (name, lines))
+    for line in range(lines):
+        c.append("    0x%06XU," % keys[line * LINE_KEYS])
+    c.append("};\n")
+    c.append("static canopen_od_entry const %s_entries[%s_COUNT] =\n{" % (name, upper))
+    for e, f in zip(entries, fields):
+        c.append("    { offsetof(%s_data_type, %s), 0x%04XU, 0x%02XU, %s, CANOPEN_OD_%s, sizeof(%s_data.%s) }," %
+                 (name, f, e["index"], e["sub"], access_text(e["access"]), e["type"], name, f))
+    c.append("};\n")
+    c.append("static char const * const %s_names[%s_COUNT] =\n{" % (name, upper))
+    for e in entries:
+        text = e["name"] if e["name"] == e["object"] or not e["object"] else "%s: %s" % (e["object"], e["name"])
+        c.append("    %s," % json.dumps(text))
+    c.append("};\n")
+    c.append("canopen_od const %s =\n{" % name)
+    c.append("    .keys        = %s_keys," % name)
+    c.append("    .fences      = %s_fences," % name)
+    c.append("    .fence_count = %uU," % lines)
+    c.append("    .entries     = %s_entries," % name)
+    c.append("    .names       = %s_names," % name)
+    c.append("    .count       = %s_COUNT," % upper)
+    c.append("    .data        = (u8*) &%s_data," % name)
+    c.append("    .data_size   = sizeof(%s_data)," % name)
+    c.append("};")
+
+    os.makedirs(out_dir, exist_ok=True)
+    write_if_changed(os.path.join(out_dir, name + ".h"), "\n".join(h) + "\n")
+    write_if_changed(os.path.join(out_dir, name + ".c"), "\n".join(c) + "\n")
+
+
+def write_if_changed(path, text):
+    # unchanged outputs keep their timestamps, nothing depending on them is rebuilt
+    try:
+        with open(path, "r") as f:
+            if f.read() == text:
+                return
+    except OSError:
+        pass
+    with open(path, "w") as f:
+        f.write(text)
+
+
+def synthetic(count):
+    """Manufacturer specific records with mixed types, for lookup benchmarks."""
+    types = ["UNSIGNED8", "UNSIGNED16", "UNSIGNED32", "INTEGER16", "INTEGER32", "REAL32", "UNSIGNED64"]
+    objects = []
+    index = 0x2000
+    made = 0
+    while made < count:
+        subs = min(1 + (index * 7) % 32, count - made)
+        objects.append({
+            "index": index,
+            "name": "Record %04X" % index,
+            "subs": [{"sub": s, "name": "Value %u" % s, "type": types[(index + s) % len(types)],
+                      "access": "rw", "pdo": "tr", "default": s} for s in range(subs)],
+        })
+        made += subs
+        index += 1
+    return {"objects": objects}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="CANopen object dictionary code generator")
+    parser.add_argument("json", nargs="?", help="object dictionary description")
+    parser.add_argument("-o", "--output", default=".", help="output directory")
+    parser.add_argument("--name", help="C name of the dictionary, default from the JSON")
+    parser.add_argument("--node-id", type=int, default=1, help="value of $NODEID in defaults")
+    parser.add_argument("--synthetic", type=int, metavar="ENTRIES", help="generate a benchmark dictionary")
+    args = parser.parse_args()
+
+    try:
+        if args.synthetic:
+            description = synthetic(args.synthetic)
+            source = "--synthetic %u" % args.synthetic
+        elif args.json:
+            with open(args.json) as f:
+                description = json.load(f)
+            source = os.path.basename(args.json)
+        else:
+            parser.error("a JSON file or --synthetic is needed")
+
+        name = identifier(args.name or description.get("name", "od"))
+        if not 1 <= args.node_id <= 127:
+            raise GeneratorError("node id %d out of range" % args.node_id)
+        entries = flatten(description.get("objects", []), args.node_id)
+        if not entries:
+            raise GeneratorError("no objects")
+        generate(entries, name, source, args.output)
+    except (GeneratorError, KeyError, OSError, json.JSONDecodeError) as e:
+        sys.stderr.write("canopen_od_gen: %s\n" % e)
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())